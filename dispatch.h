@@ -629,6 +629,10 @@ namespace giac {
     _ANN_LEARNING_RATE = 168,      // learning_rate
     _ANN_WEIGHT_DECAY = 169,       // weight_decay
     _ANN_RELU = 170,               // ReLU
+    _GT_TOLERANCE = 171,           // tolerance
+    _GT_MAXITER = 172,             // maxiter
+    _GT_SPECTRAL = 173,            // spectral
+    _GT_BITSET = 174,              // bitset
   };
 
   enum mupad_operator {
@@ -14229,6 +14229,14 @@ void sprint_double(char * s,double d){
         return "bipartite";
       case _GT_ACYCLIC:
         return "acyclic";
+      case _GT_TOLERANCE:
+        return "tolerance";
+      case _GT_MAXITER:
+        return "maxiter";
+      case _GT_SPECTRAL:
+        return "spectral";
+      case _GT_BITSET:
+        return "bitset";
       case _KDE_BANDWIDTH:
         return "bandwidth";
       case _KDE_BINS:
@@ -25,7 +25,10 @@
 #include "optimization.h"
 #include <ctype.h>
 #include <math.h>
+#include <float.h>
+#include <limits.h>
 #include <ctime>
+#include <complex>
 #include <stdio.h>
 #include <stdlib.h>
 #ifdef HAVE_LIBNAUTY
@@ -199,6 +202,7 @@ void graphe::ivectors2vecteur(const ivectors &v,vecteur &res,bool sort_all) cons
 void graphe::vertex::assign_defaults() {
     m_subgraph=-1;
     m_visited=false;
+    m_leaf=false;
     m_ancestor=-1;
     m_low=-1;
     m_disc=-1;
@@ -208,120 +212,171 @@ void graphe::vertex::assign_defaults() {
 }
 
 graphe::vertex::vertex(bool support_attributes) {
-    m_attributes=support_attributes?new attrib():NULL;
-    m_neighbor_attributes=support_attributes?new map<int,attrib>():NULL;
+    m_supports_attributes=support_attributes;
+    m_data=new vertex_data();
     assign_defaults();
 }
 
 graphe::vertex::vertex(const gen &lab,const attrib &attr) {
-    m_attributes=new attrib();
-    m_neighbor_attributes=new map<int,attrib>();
+    m_supports_attributes=true;
+    m_data=new vertex_data();
     assign_defaults();
     if (!attr.empty())
         set_attributes(attr);
     set_label(lab);
 }
 
+#if defined HAVE_LIBPTHREAD && !defined __GNUC__
+static pthread_mutex_t refcount_mutex=PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* add delta to the reference count atomically and return the new count, since
+ * the copies of a graph sharing the vertex data may live in different threads */
+static inline int refcount_add(int &count,int delta) {
+#if defined HAVE_LIBPTHREAD && defined __GNUC__
+    return __sync_add_and_fetch(&count,delta);
+#elif defined HAVE_LIBPTHREAD
+    pthread_mutex_lock(&refcount_mutex);
+    int res=(count+=delta);
+    pthread_mutex_unlock(&refcount_mutex);
+    return res;
+#else
+    return count+=delta;
+#endif
+}
+
+/* copy the traversal data of other and share its adjacency and attributes */
 void graphe::vertex::assign(const vertex &other) {
     m_subgraph=other.subgraph();
     m_visited=other.is_visited();
+    m_leaf=other.is_leaf();
     m_ancestor=other.ancestor();
     m_low=other.low();
     m_disc=other.disc();
     m_color=other.color();
     m_embedded=other.is_embedded();
     m_number=other.number();
-    m_faces=other.edge_faces();
-    if (!other.supports_attributes()) {
+    m_supports_attributes=other.supports_attributes();
+    refcount_add(other.m_data->refcount,1);
+    m_data=other.m_data;
+}
+
+/* drop the reference to the shared data, deleting it if this was the last one */
+void graphe::vertex::release() {
+    if (refcount_add(m_data->refcount,-1)==0)
+        delete m_data;
+}
+
+/* return the data of this vertex for writing, making a private copy of it first if it is shared */
+graphe::vertex::vertex_data &graphe::vertex::data() {
+    if (m_data->refcount>1) {
+        vertex_data *d=new vertex_data();
+        d->neighbors=m_data->neighbors;
+        d->multiedges=m_data->multiedges;
+        d->faces=m_data->faces;
         if (supports_attributes()) {
-            delete m_attributes;
-            delete m_neighbor_attributes;
-        }
-        unsupport_attributes();
-    } else {
-        if (!supports_attributes()) {
-            m_attributes=new attrib();
-            m_neighbor_attributes=new map<int,attrib>();
+            d->attributes=m_data->attributes;
+            d->neighbor_attributes=m_data->neighbor_attributes;
         }
-        m_neighbor_attributes->clear();
-        set_attributes(other.attributes());
-    }
-    m_multiedges.clear();
-    m_neighbors.resize(other.degree());
-    int k;
-    for (ivector_iter it=other.neighbors().begin();it!=other.neighbors().end();++it) {
-        m_neighbors[it-other.neighbors().begin()]=*it;
-        if (other.supports_attributes())
-            copy_attributes(other.neighbor_attributes(*it),(*m_neighbor_attributes)[*it]);
-        if ((k=other.multiedges(*it))>0)
-            m_multiedges.insert(make_pair(*it,k));
+        release(); // the other owners may have released it meanwhile
+        m_data=d;
     }
+    return *m_data;
 }
 
 graphe::vertex::~vertex() {
-    if (supports_attributes()) {
-        delete m_attributes;
-        delete m_neighbor_attributes;
-    }
+    release();
+}
+
+/* stop storing attributes for this vertex */
+void graphe::vertex::unsupport_attributes() {
+    if (!supports_attributes())
+        return;
+    m_supports_attributes=false;
+    /* a shared block is copied without the attributes, the other owners keep them */
+    vertex_data &d=data();
+    d.attributes.clear();
+    d.neighbor_attributes.clear();
 }
 
 int graphe::vertex::multiedges(int v) const {
-    map<int,int>::const_iterator it=m_multiedges.find(v);
-    if (it!=m_multiedges.end())
+    map<int,int>::const_iterator it=m_data->multiedges.find(v);
+    if (it!=m_data->multiedges.end())
         return it->second;
     return 0;
 }
 
 int graphe::vertex::multiedge_count() const {
     int count=0;
-    for (map<int,int>::const_iterator it=m_multiedges.begin();it!=m_multiedges.end();++it) {
+    for (map<int,int>::const_iterator it=m_data->multiedges.begin();it!=m_data->multiedges.end();++it) {
         count+=it->second;
     }
     return count;
 }
 
 void graphe::vertex::set_multiedge(int v,int k) {
-    map<int,int>::iterator it=m_multiedges.find(v);
+    map<int,int> &multiedges=data().multiedges;
+    map<int,int>::iterator it=multiedges.find(v);
     if (k>0)
-        if (it!=m_multiedges.end())
+        if (it!=multiedges.end())
             it->second=k;
-        else m_multiedges.insert(make_pair(v,k));
+        else multiedges.insert(make_pair(v,k));
     else {
-        if (it!=m_multiedges.end())
-            m_multiedges.erase(it);
+        if (it!=multiedges.end())
+            multiedges.erase(it);
     }
 }
 
 gen graphe::vertex::label() const {
     assert(supports_attributes());
-    attrib_iter it=m_attributes->find(_GT_ATTRIB_LABEL);
-    if (it==m_attributes->end())
+    attrib_iter it=m_data->attributes.find(_GT_ATTRIB_LABEL);
+    if (it==m_data->attributes.end())
         return undef;
     return it->second;
 }
 
 graphe::vertex::vertex(const vertex &other) {
-    m_attributes=other.supports_attributes()?new attrib():NULL;
-    m_neighbor_attributes=other.supports_attributes()?new map<int,attrib>():NULL;
     assign(other);
 }
 
 graphe::vertex& graphe::vertex::operator =(const vertex &other) {
-    assign(other);
+    if (m_data!=other.m_data) {
+        release();
+        assign(other);
+    } else if (this!=&other) {
+        refcount_add(m_data->refcount,-1);
+        assign(other);
+    }
     return *this;
 }
 
 void graphe::vertex::add_neighbor(int i,const attrib &attr) {
-    if (m_neighbors.empty())
-        m_neighbors.push_back(i);
+    vertex_data &d=data();
+    if (d.neighbors.empty())
+        d.neighbors.push_back(i);
     else {
-        ivector::iterator it=std::lower_bound(m_neighbors.begin(),m_neighbors.end(),i);
-        if (it!=m_neighbors.end() && *it==i)
+        ivector::iterator it=std::lower_bound(d.neighbors.begin(),d.neighbors.end(),i);
+        if (it!=d.neighbors.end() && *it==i)
             return;
-        m_neighbors.insert(it,i);
+        d.neighbors.insert(it,i);
     }
     if (supports_attributes())
-        copy_attributes(attr,(*m_neighbor_attributes)[i]);
+        copy_attributes(attr,d.neighbor_attributes[i]);
+}
+
+/* merge the sorted list nb of new neighbors (none of them adjacent yet) into the adjacency list */
+void graphe::vertex::add_neighbors(const ivector &nb) {
+    if (nb.empty())
+        return;
+    vertex_data &d=data();
+    ivector merged(d.neighbors.size()+nb.size());
+    std::merge(d.neighbors.begin(),d.neighbors.end(),nb.begin(),nb.end(),merged.begin());
+    d.neighbors.swap(merged);
+    if (supports_attributes()) {
+        for (ivector_iter it=nb.begin();it!=nb.end();++it) {
+            d.neighbor_attributes[*it];
+        }
+    }
 }
 
 bool graphe::vertex::is_temporary(int i) const {
@@ -332,78 +387,100 @@ bool graphe::vertex::is_temporary(int i) const {
 
 graphe::attrib &graphe::vertex::neighbor_attributes(int i) {
     assert(supports_attributes());
-    map<int,attrib>::iterator it=m_neighbor_attributes->find(i);
-    assert(it!=m_neighbor_attributes->end());
+    map<int,attrib> &neighbor_attributes=data().neighbor_attributes;
+    map<int,attrib>::iterator it=neighbor_attributes.find(i);
+    assert(it!=neighbor_attributes.end());
     return it->second;
 }
 
 const graphe::attrib &graphe::vertex::neighbor_attributes(int i) const {
     assert(supports_attributes());
-    neighbor_iter it=m_neighbor_attributes->find(i);
-    assert(it!=m_neighbor_attributes->end());
+    neighbor_iter it=m_data->neighbor_attributes.find(i);
+    assert(it!=m_data->neighbor_attributes.end());
     return it->second;
 }
 
 void graphe::vertex::remove_neighbor(int i) {
-    ivector::iterator it;
-    if ((it=std::find(m_neighbors.begin(),m_neighbors.end(),i))==m_neighbors.end())
+    ivector_iter it=std::find(m_data->neighbors.begin(),m_data->neighbors.end(),i);
+    if (it==m_data->neighbors.end())
         return;
-    m_neighbors.erase(it);
+    int pos=it-m_data->neighbors.begin();
+    vertex_data &d=data();
+    d.neighbors.erase(d.neighbors.begin()+pos);
     if (supports_attributes()) {
-        map<int,attrib>::iterator jt=m_neighbor_attributes->find(i);
-        assert(jt!=m_neighbor_attributes->end());
-        m_neighbor_attributes->erase(jt);
+        map<int,attrib>::iterator jt=d.neighbor_attributes.find(i);
+        assert(jt!=d.neighbor_attributes.end());
+        d.neighbor_attributes.erase(jt);
     }
-    map<int,int>::iterator kt=m_multiedges.find(i);
-    if (kt!=m_multiedges.end())
-        m_multiedges.erase(kt);
+    map<int,int>::iterator kt=d.multiedges.find(i);
+    if (kt!=d.multiedges.end())
+        d.multiedges.erase(kt);
 }
 
 void graphe::vertex::clear_neighbors() {
-    m_neighbors.clear();
-    if (supports_attributes())
-        m_neighbor_attributes->clear();
-    m_multiedges.clear();
+    if (m_data->refcount>1) {
+        /* no need to copy the data which is about to be erased */
+        attrib attr;
+        if (supports_attributes())
+            attr=m_data->attributes;
+        map<int,int> faces=m_data->faces;
+        release();
+        m_data=new vertex_data();
+        m_data->attributes.swap(attr);
+        m_data->faces.swap(faces);
+        return;
+    }
+    m_data->neighbors.clear();
+    m_data->neighbor_attributes.clear();
+    m_data->multiedges.clear();
 }
 
 void graphe::vertex::map_neighbors(const map<int,int> &m) {
-    ivector::iterator it=m_neighbors.begin(),itend=m_neighbors.end();
+    vertex_data &d=data();
+    ivector::iterator it=d.neighbors.begin(),itend=d.neighbors.end();
     map<int,attrib>::iterator jt;
     map<int,int>::iterator mt;
     attrib attr;
     bool sa=supports_attributes();
     for (;it!=itend;++it) {
         if (sa) {
-            jt=m_neighbor_attributes->find(*it);
-            assert(jt!=m_neighbor_attributes->end());
+            jt=d.neighbor_attributes.find(*it);
+            assert(jt!=d.neighbor_attributes.end());
         }
-        mt=m_multiedges.find(*it);
+        mt=d.multiedges.find(*it);
         *it=m.at(*it);
         if (sa) {
             copy_attributes(jt->second,attr);
-            m_neighbor_attributes->erase(jt);
-            copy_attributes(attr,(*m_neighbor_attributes)[*it]);
+            d.neighbor_attributes.erase(jt);
+            copy_attributes(attr,d.neighbor_attributes[*it]);
         }
-        if (mt!=m_multiedges.end()) {
+        if (mt!=d.multiedges.end()) {
             int me=mt->second;
-            m_multiedges.erase(mt);
-            m_multiedges[*it]=me;
+            d.multiedges.erase(mt);
+            d.multiedges[*it]=me;
         }
     }
 }
 
 void graphe::vertex::incident_faces(ivector &F) const {
-    F.resize(m_faces.size());
+    F.resize(m_data->faces.size());
     int i=0,f;
-    for (map<int,int>::const_iterator it=m_faces.begin();it!=m_faces.end();++it) {
+    for (map<int,int>::const_iterator it=m_data->faces.begin();it!=m_data->faces.end();++it) {
         assert((f=it->second)>0);
         F[i++]=f-1;
     }
 }
 
 void graphe::vertex::add_edge_face(int nb,int f) {
-    assert(m_faces.find(nb)==m_faces.end());
-    m_faces[nb]=f+1;
+    map<int,int> &faces=data().faces;
+    assert(faces.find(nb)==faces.end());
+    faces[nb]=f+1;
+}
+
+/* return the face assigned to the edge from this vertex to nb, or -1 if there is none */
+int graphe::vertex::edge_face(int nb) const {
+    map<int,int>::const_iterator it=m_data->faces.find(nb);
+    return it==m_data->faces.end()?-1:it->second-1;
 }
 
 /* set the given planar embedding */
@@ -749,7 +826,7 @@ graphe::graphe(GIAC_CONTEXT,bool support_attributes) {
     set_graph_attribute(_GT_ATTRIB_WEIGHTED,FAUX);
 }
 
-/* graphe constructor, create a copy of G */
+/* graphe constructor, create a copy of G (the vertex data is shared with G until modified) */
 graphe::graphe(const graphe &G) {
     m_supports_attributes=G.supports_attributes();
     set_graph_attribute(_GT_ATTRIB_DIRECTED,boole(G.is_directed()));
@@ -1037,7 +1114,7 @@ graphe::graphe(const string &name,GIAC_CONTEXT,bool support_attributes) {
         graphe G;
         G.read_special(icosahedral_graph);
         ivectors faces;
-        assert(G.demoucron(faces));
+        G.planar_faces(faces);
         G.truncate(*this,faces);
         if (support_attributes) {
             hull=make_ivector(5,4,0,1,2,3);
@@ -2618,11 +2695,15 @@ void graphe::copy(graphe &G) const {
         G.set_graph_attributes(attributes);
     }
     G.copy_nodes(nodes);
+    if (G.supports_attributes() && label_idx.is_valid())
+        G.label_idx=label_idx;
     G.copy_marked_nodes(get_marked_nodes());
 }
 
 void graphe::copy_nodes(const vector<vertex> &V) {
     nodes=V;
+    invalidate_adjacency_snapshot();
+    invalidate_label_index();
     if (!supports_attributes()) {
         for (vector<vertex>::iterator it=nodes.begin();it!=nodes.end();++it) {
             it->unsupport_attributes();
@@ -2630,6 +2711,15 @@ void graphe::copy_nodes(const vector<vertex> &V) {
     }
 }
 
+/* make private copies of the vertex data which this graph shares with its copies (the
+ * reference counts are updated atomically, so this is not required before handing the
+ * graph to another thread, but the copies are then made by the calling thread) */
+void graphe::detach_nodes() {
+    for (vector<vertex>::iterator it=nodes.begin();it!=nodes.end();++it) {
+        it->detach();
+    }
+}
+
 /* copies the nodes from sg into G, without attributes except node labels */
 void graphe::copy_nodes(graphe &G,map<int,int> &vmap,int sg) const {
     int n=subgraph_size(sg);
@@ -2666,6 +2756,8 @@ const graphe::attrib &graphe::node_attributes(int i) const {
     return node(i).attributes();
 }
 
+/* returns the modifiable attributes of the i-th node, labels must be changed
+ * by set_node_attribute to keep the label index valid */
 graphe::attrib &graphe::node_attributes(int i) {
     assert(i>=0 && i<node_count() && supports_attributes());
     return node(i).attributes();
@@ -2682,6 +2774,8 @@ const graphe::attrib &graphe::edge_attributes(int i,int j) const {
 /* return the modifiable reference to the attributes assigned to edge [i,j] */
 graphe::attrib &graphe::edge_attributes(int i,int j) {
     assert(supports_attributes());
+    if (frozen_adj.has_weights())
+        invalidate_adjacency_snapshot();
     if (is_directed())
         return node(i).neighbor_attributes(j);
     return node(i<j?i:j).neighbor_attributes(i<j?j:i);
@@ -2700,6 +2794,7 @@ bool graphe::add_edge(int i,int j,const gen &w) {
     assert(i>=0 && i<node_count() && j>=0 && j<node_count());
     if (has_edge(i,j))
         return false;
+    invalidate_adjacency_snapshot();
     node(i).add_neighbor(j);
     if (!is_directed())
         node(j).add_neighbor(i);
@@ -2715,6 +2810,7 @@ bool graphe::add_edge(int i,int j,const attrib &attr) {
     assert(i>=0 && i<node_count() && j>=0 && j<node_count() && supports_attributes());
     if (has_edge(i,j))
         return false;
+    invalidate_adjacency_snapshot();
     if (is_directed())
         node(i).add_neighbor(j,attr);
     else {
@@ -2725,6 +2821,70 @@ bool graphe::add_edge(int i,int j,const attrib &attr) {
     return true;
 }
 
+/* add all edges (or arcs) from E at once, assigning them the corresponding weights
+ * if the graph is weighted, return the number of edges actually added (loops and
+ * edges which already exist are ignored, as well as repeated edges in E) */
+int graphe::add_edges(const ipairs &E,const vecteur *weights) {
+    int n=node_count(),m=E.size(),i,j,k,count=0;
+    bool isdir=is_directed(),isweighted=is_weighted();
+    assert(weights==NULL || int(weights->size())==m);
+    assert(!isweighted || supports_attributes());
+    /* bucket the arcs by their tails, remembering the edge they come from */
+    ivector offsets(n+1,0);
+    for (ipairs_iter it=E.begin();it!=E.end();++it) {
+        assert(it->first>=0 && it->first<n && it->second>=0 && it->second<n);
+        if (it->first==it->second)
+            continue;
+        ++offsets[it->first+1];
+        if (!isdir)
+            ++offsets[it->second+1];
+    }
+    for (i=0;i<n;++i) {
+        offsets[i+1]+=offsets[i];
+    }
+    ipairs arcs(offsets[n]);
+    ivector pos(offsets.begin(),offsets.end()-1);
+    for (k=0;k<m;++k) {
+        const ipair &e=E[k];
+        if (e.first==e.second)
+            continue;
+        arcs[pos[e.first]++]=make_pair(e.second,k);
+        if (!isdir)
+            arcs[pos[e.second]++]=make_pair(e.first,k);
+    }
+    invalidate_adjacency_snapshot();
+    /* merge the new neighbors into each adjacency list in one pass */
+    ivector nb;
+    ipairs weighted_arcs;
+    ipairs::iterator first,last,it;
+    for (i=0;i<n;++i) {
+        first=arcs.begin()+offsets[i];
+        last=arcs.begin()+offsets[i+1];
+        if (first==last)
+            continue;
+        sort(first,last);
+        vertex &v=node(i);
+        nb.clear();
+        weighted_arcs.clear();
+        for (it=first;it!=last;++it) {
+            j=it->first;
+            if ((it!=first && (it-1)->first==j) || v.has_neighbor(j))
+                continue;
+            nb.push_back(j);
+            if (isdir || i<j) {
+                ++count;
+                if (isweighted)
+                    weighted_arcs.push_back(*it);
+            }
+        }
+        v.add_neighbors(nb);
+        for (it=weighted_arcs.begin();it!=weighted_arcs.end();++it) {
+            v.neighbor_attributes(it->first)[_GT_ATTRIB_WEIGHT]=weights==NULL?gen(1):weights->at(it->second);
+        }
+    }
+    return count;
+}
+
 /* add edge {v,w} or arc [v,w], adding vertices v and/or w if necessary */
 bool graphe::add_edge(const gen &v,const gen &w,const gen &weight) {
     assert(supports_attributes());
@@ -2777,6 +2937,7 @@ void graphe::remove_temporary_edges() {
 bool graphe::remove_edge(int i,int j) {
     if (!has_edge(i,j))
         return false;
+    invalidate_adjacency_snapshot();
     node(i).remove_neighbor(j);
     if (!is_directed())
         node(j).remove_neighbor(i);
@@ -2786,6 +2947,7 @@ bool graphe::remove_edge(int i,int j) {
 /* add new vertex to the graph */
 int graphe::add_node() {
     assert(!supports_attributes());
+    invalidate_adjacency_snapshot();
     nodes.push_back(vertex(false));
     return node_count()-1;
 }
@@ -2809,13 +2971,14 @@ int graphe::add_node(const gen &v,const attrib &attr) {
             return -1; // error
         return add_node(lab,a);
     }
-    node_iter it=nodes.begin(),itend=nodes.end();
-    for (;it!=itend;++it) {
-        if (it->label()==v)
-            return it-nodes.begin();
-    }
+    int i=node_index(v);
+    if (i>=0)
+        return i;
+    invalidate_adjacency_snapshot();
     nodes.push_back(vertex(v,attr));
-    return node_count()-1;
+    i=node_count()-1;
+    label_idx.insert(*this,i);
+    return i;
 }
 
 /* add vertices from list v to the graph */
@@ -2829,6 +2992,7 @@ void graphe::add_nodes(const vecteur &v) {
 /* adds n new nodes to the graph */
 void graphe::add_nodes(int n) {
     assert(!supports_attributes());
+    invalidate_adjacency_snapshot();
     for (int i=0;i<n;++i)
         nodes.push_back(vertex(false));
 }
@@ -2872,12 +3036,9 @@ vecteur graphe::get_node_labels(const ivector &v) const {
 /* return index of vertex v */
 int graphe::node_index(const gen &v) const {
     assert(supports_attributes());
-    node_iter it=nodes.begin(),itend=nodes.end();
-    for (;it!=itend;++it) {
-        if (it->label()==v)
-            return it-nodes.begin();
-    }
-    return -1;
+    if (!label_idx.is_valid())
+        label_idx.build(*this);
+    return label_idx.find(*this,v);
 }
 
 /* return index of edge (i,j) as returned by get_edges_as_pairs */
@@ -3002,6 +3163,10 @@ void graphe::make_cycle_graph() {
 /* set vertex attribute key=val */
 void graphe::set_node_attribute(int index,int key,const gen &val) {
     assert (index>=0 && index<node_count());
+    if (key==_GT_ATTRIB_LABEL)
+        invalidate_label_index();
+    else if (key==_GT_ATTRIB_COLOR)
+        canonical_cert.clear();
     node(index).set_attribute(key,val);
 }
 
@@ -3056,6 +3221,8 @@ void graphe::discard_graph_attribute(int key) {
 
 /* discard the attribute assigned to i-th node and specified by key */
 void graphe::discard_node_attribute(int i,int key) {
+    if (key==_GT_ATTRIB_LABEL)
+        invalidate_label_index();
     attrib &attr=node(i).attributes();
     attrib::iterator it=attr.find(key);
     if (it!=attr.end())
@@ -3732,44 +3899,293 @@ void graphe::create_random_layout(layout &x,int dim) {
     }
 }
 
-/* lay out the graph using a force-directed algorithm with spring-electrical model */
-void graphe::force_directed_placement(layout &x,double K,double R,double tol,bool ac) {
+/*
+ * BARNES-HUT TREE:
+ * the points are recursively split into 2^d boxes until at most BH_LEAF_SIZE
+ * points remain in each box, the coordinates are kept in flat arrays (one per
+ * dimension) which are reordered so that each box holds a contiguous range.
+ * A box which is small compared to its distance from a point acts on it as a
+ * single body placed at the center of mass of the box. The tree is rebuilt
+ * once per sweep, and the centers of mass are updated whenever a point moves.
+ */
+
+/* construct an empty tree in dimension d with the given opening angle */
+graphe::barnes_hut::barnes_hut(int d,double theta) {
+    assert(d==2 || d==3);
+    dim=d;
+    nch=1<<d;
+    theta2=theta*theta;
+}
+
+/* build the tree for n points with coordinates stored by points in x */
+void graphe::barnes_hut::build(const dvector &x,int n) {
+    int t,k;
+    double lo[3],hi[3],ext=0;
+    for (k=0;k<dim;++k) {
+        m_pos[k].resize(n);
+        lo[k]=DBL_MAX;
+        hi[k]=-DBL_MAX;
+    }
+    m_index.resize(n);
+    m_octant.resize(n);
+    m_tmp_index.resize(n);
+    m_tmp_pos.resize(n);
+    for (t=0;t<n;++t) {
+        m_index[t]=t;
+        for (k=0;k<dim;++k) {
+            double c=x[t*dim+k];
+            m_pos[k][t]=c;
+            if (c<lo[k]) lo[k]=c;
+            if (c>hi[k]) hi[k]=c;
+        }
+    }
+    m_cells.resize(1);
+    cell &root=m_cells.front();
+    for (k=0;k<dim;++k) {
+        root.center[k]=(lo[k]+hi[k])/2.0;
+        ext=std::max(ext,hi[k]-lo[k]);
+    }
+    root.half=ext/2.0*(1.0+1e-9)+1e-12;
+    root.lo=0;
+    root.hi=n;
+    root.child=-1;
+    root.parent=-1;
+    subdivide(0,0);
+    m_slot.resize(n);
+    m_leaf.resize(n);
+    for (t=0;t<n;++t) {
+        m_slot[m_index[t]]=t;
+    }
+    /* compute the masses and the centers of mass bottom-up (children follow their parents) */
+    for (int c=m_cells.size()-1;c>=0;--c) {
+        cell &C=m_cells[c];
+        for (k=0;k<dim;++k) C.cm[k]=0;
+        if (C.child<0) {
+            C.mass=C.hi-C.lo;
+            for (t=C.lo;t<C.hi;++t) {
+                m_leaf[t]=c;
+                for (k=0;k<dim;++k) C.cm[k]+=m_pos[k][t];
+            }
+        } else {
+            C.mass=0;
+            for (int o=0;o<nch;++o) {
+                const cell &ch=m_cells[C.child+o];
+                C.mass+=ch.mass;
+                for (k=0;k<dim;++k) C.cm[k]+=ch.mass*ch.cm[k];
+            }
+        }
+        if (C.mass>0) {
+            for (k=0;k<dim;++k) C.cm[k]/=C.mass;
+        }
+    }
+}
+
+/* split the c-th cell into 2^d children unless it is small enough */
+void graphe::barnes_hut::subdivide(int c,int depth) {
+    int lo=m_cells[c].lo,hi=m_cells[c].hi,t,k,o,first;
+    if (hi-lo<=BH_LEAF_SIZE || depth>=BH_MAX_DEPTH)
+        return;
+    int count[8],start[8];
+    std::fill(count,count+nch,0);
+    for (t=lo;t<hi;++t) {
+        for (o=k=0;k<dim;++k) {
+            if (m_pos[k][t]>=m_cells[c].center[k])
+                o|=1<<k;
+        }
+        m_octant[t]=o;
+        ++count[o];
+    }
+    for (start[0]=lo,o=1;o<nch;++o) {
+        start[o]=start[o-1]+count[o-1];
+    }
+    /* reorder the points by their octants (counting sort) */
+    int pos[8];
+    std::copy(start,start+nch,pos);
+    for (t=lo;t<hi;++t) {
+        m_tmp_index[pos[m_octant[t]]++]=m_index[t];
+    }
+    std::copy(m_tmp_index.begin()+lo,m_tmp_index.begin()+hi,m_index.begin()+lo);
+    for (k=0;k<dim;++k) {
+        std::copy(start,start+nch,pos);
+        for (t=lo;t<hi;++t) {
+            m_tmp_pos[pos[m_octant[t]]++]=m_pos[k][t];
+        }
+        std::copy(m_tmp_pos.begin()+lo,m_tmp_pos.begin()+hi,m_pos[k].begin()+lo);
+    }
+    first=m_cells.size();
+    m_cells.resize(first+nch);
+    m_cells[c].child=first;
+    for (o=0;o<nch;++o) {
+        cell &ch=m_cells[first+o];
+        const cell &parent=m_cells[c];
+        ch.half=parent.half/2.0;
+        for (k=0;k<dim;++k) {
+            ch.center[k]=parent.center[k]+(((o>>k)&1)!=0?ch.half:-ch.half);
+        }
+        ch.lo=start[o];
+        ch.hi=start[o]+count[o];
+        ch.child=-1;
+        ch.parent=c;
+    }
+    for (o=0;o<nch;++o) {
+        subdivide(first+o,depth+1);
+    }
+}
+
+/* move the i-th point to p, updating the centers of mass of the cells containing it
+ * (the cells themselves are kept until the tree is rebuilt) */
+void graphe::barnes_hut::move(int i,const double *p) {
+    int t=m_slot[i],k;
+    double delta[3];
+    for (k=0;k<dim;++k) {
+        delta[k]=p[k]-m_pos[k][t];
+        m_pos[k][t]=p[k];
+    }
+    for (int c=m_leaf[t];c>=0;c=m_cells[c].parent) {
+        cell &C=m_cells[c];
+        for (k=0;k<dim;++k) C.cm[k]+=delta[k]/C.mass;
+    }
+}
+
+/* add the repulsive forces D*(p-q)/|p-q|^2 acting on the i-th point p to force,
+ * ignoring the points q farther than R, return the number of points q which
+ * coincide with p (their forces are not added) */
+int graphe::barnes_hut::repulsive_force(int i,const double *p,double D,double R,double *force) const {
+    int stack[BH_MAX_DEPTH*8+8],sp=0,coincident=0,t,k,o,mass,self=m_slot[i];
+    double d[3],r2,f,a,dmin,dmax;
+    bool cutoff=R<DBL_MAX,inside,within=true,own;
+    stack[sp++]=0;
+    while (sp>0) {
+        const cell &C=m_cells[stack[--sp]];
+        if (C.mass==0)
+            continue;
+        if (cutoff) {
+            /* skip the cell if it lies entirely outside the ball of radius R,
+             * approximate it only if it lies entirely inside */
+            for (dmin=dmax=0,k=0;k<dim;++k) {
+                a=std::abs(p[k]-C.center[k]);
+                if (a>C.half)
+                    dmin+=(a-C.half)*(a-C.half);
+                dmax+=(a+C.half)*(a+C.half);
+            }
+            if (dmin>R*R)
+                continue;
+            within=dmax<=R*R;
+        }
+        if (C.child>=0) {
+            /* the i-th point may have left the cell containing it, in which
+             * case its own contribution is removed from the center of mass */
+            own=self>=C.lo && self<C.hi;
+            if ((mass=C.mass-(own?1:0))==0)
+                continue;
+            for (r2=0,inside=true,k=0;k<dim;++k) {
+                d[k]=p[k]-(own?(C.mass*C.cm[k]-m_pos[k][self])/mass:C.cm[k]);
+                r2+=d[k]*d[k];
+                if (std::abs(p[k]-C.center[k])>C.half)
+                    inside=false;
+            }
+            if (within && !inside && 4.0*C.half*C.half<theta2*r2) {
+                /* far enough, approximate the cell by its center of mass */
+                f=mass*D/r2;
+                for (k=0;k<dim;++k) force[k]+=f*d[k];
+            } else {
+                for (o=0;o<nch;++o) stack[sp++]=C.child+o;
+            }
+            continue;
+        }
+        for (t=C.lo;t<C.hi;++t) {
+            if (m_index[t]==i)
+                continue;
+            for (r2=0,k=0;k<dim;++k) {
+                d[k]=p[k]-m_pos[k][t];
+                r2+=d[k]*d[k];
+            }
+            if (r2==0) {
+                ++coincident;
+                continue;
+            }
+            if (cutoff && r2>R*R)
+                continue;
+            f=D/r2;
+            for (k=0;k<dim;++k) force[k]+=f*d[k];
+        }
+    }
+    return coincident;
+}
+
+/*
+ * END OF BARNES-HUT TREE
+ */
+
+/* lay out the graph using a force-directed algorithm with spring-electrical model,
+ * the repulsive forces are approximated by using Barnes-Hut tree with the given
+ * opening angle theta for larger graphs (theta=0 forces the exact computation) */
+void graphe::force_directed_placement(layout &x,double K,double R,double tol,bool ac,double theta) {
     double step_length=K,shrinking_factor=0.9,eps=K*tol,C=0.01,D=C*K*K;
-    double energy=DBL_MAX,energy0,norm,max_displacement;
-    int progress=0,n=x.size(),i,j;
+    double energy=DBL_MAX,energy0,norm,max_displacement,dist,r2;
+    int progress=0,n=x.size(),i,j,k,coincident;
     if (n==0)
         return;
     assert (n==node_count() && n>0);
     int d=x.front().size();
-    point force(d),p(d),f(d);
+    /* the positions are kept in a flat buffer during the computation */
+    dvector pos(n*d);
+    for (i=0;i<n;++i) {
+        std::copy(x[i].begin(),x[i].end(),pos.begin()+i*d);
+    }
+    bool use_tree=theta>0 && n>=BH_MIN_VERTICES && (d==2 || d==3);
+    barnes_hut tree(use_tree?d:2,theta);
+    point force(d),f(d);
+    double *xi,*xj;
     /* keep updating the positions until the system freezes */
     do {
         energy0=energy;
         energy=0;
         max_displacement=0;
+        if (use_tree)
+            tree.build(pos,n);
         node_iter nt=nodes.begin(),ntend=nodes.end();
         for (i=0;nt!=ntend;++nt,++i) {
-            point &xi=x[i];
+            xi=&pos[i*d];
             clear_point_coords(force);
             /* compute the attractive forces between vertices adjacent to the i-th vertex */
             for (ivector_iter it=nt->neighbors().begin();it!=nt->neighbors().end();++it) {
-                j=*it;
-                scale_point(p,point_distance(xi,x[j],p)/K);
-                add_point(force,p);
+                xj=&pos[*it*d];
+                for (r2=0,k=0;k<d;++k) {
+                    f[k]=xj[k]-xi[k];
+                    r2+=f[k]*f[k];
+                }
+                dist=std::sqrt(r2)/K;
+                for (k=0;k<d;++k) force[k]+=dist*f[k];
             }
             /* compute the repulsive forces for all vertices j!=i which are not too far from the i-th vertex */
-            for (layout_iter it=x.begin();it!=x.end();++it) {
-                j=it-x.begin();
-                if (i!=j) {
-                    norm=point_distance(*it,xi,f);
-                    if (norm>R)
+            if (use_tree)
+                coincident=tree.repulsive_force(i,xi,D,R,&force.front());
+            else {
+                coincident=0;
+                for (j=0;j<n;++j) {
+                    if (i==j)
+                        continue;
+                    xj=&pos[j*d];
+                    for (r2=0,k=0;k<d;++k) {
+                        f[k]=xi[k]-xj[k];
+                        r2+=f[k]*f[k];
+                    }
+                    if (r2==0) {
+                        ++coincident;
                         continue;
-                    if (norm==0)
-                        rand_point(f,norm=shrinking_factor*eps);
-                    scale_point(f,D/(norm*norm));
-                    add_point(force,f);
+                    }
+                    if (r2>R*R)
+                        continue;
+                    for (k=0;k<d;++k) force[k]+=f[k]*D/r2;
                 }
             }
+            /* push coincident vertices apart in random directions */
+            for (j=0;j<coincident;++j) {
+                rand_point(f,norm=shrinking_factor*eps);
+                scale_point(f,D/(norm*norm));
+                add_point(force,f);
+            }
             /* move the location of the i-th vertex in the direction of the force f */
             norm=point_displacement(force);
             if (norm==0)
@@ -3778,7 +4194,9 @@ void graphe::force_directed_placement(layout &x,double K,double R,double tol,boo
                 scale_point(force,step_length/norm);
                 norm=step_length;
             }
-            add_point(xi,force);
+            for (k=0;k<d;++k) xi[k]+=force[k];
+            if (use_tree)
+                tree.move(i,xi);
             /* update the maximal displacement for this iteration */
             if (norm>max_displacement)
                 max_displacement=norm;
@@ -3799,6 +4217,9 @@ void graphe::force_directed_placement(layout &x,double K,double R,double tol,boo
             }
         } else step_length*=shrinking_factor; /* simple cooling scheme */
     } while (max_displacement>eps);
+    for (i=0;i<n;++i) {
+        std::copy(pos.begin()+i*d,pos.begin()+(i+1)*d,x[i].begin());
+    }
 }
 
 /* compute optimal positions of edge labels and store them as "position" attributes of the respective edges */
@@ -4031,7 +4452,7 @@ void graphe::coarsening_ec(const ipairs &M,graphe &G,sparsemat &P) const {
 static int multilevel_depth;
 static bool multilevel_mis;
 
-void graphe::multilevel_recursion(layout &x,int d,double R,double K,double tol,int depth) {
+void graphe::multilevel_recursion(layout &x,int d,double R,double K,double tol,double theta,int depth) {
     ivector mis;
     ipairs M;
     if (multilevel_mis)
@@ -4043,14 +4464,14 @@ void graphe::multilevel_recursion(layout &x,int d,double R,double K,double tol,i
     if (m>0.75*n) {
         /* coarsening is slow, switch from EC to MIS method since it's faster */
         multilevel_mis=true;
-        multilevel_recursion(x,d,R,K,tol,depth);
+        multilevel_recursion(x,d,R,K,tol,theta,depth);
         return;
     }
     if (m<2) {
         /* the coarsest level, apply force directed algorithm on a random initial layout */
         multilevel_depth=depth;
         create_random_layout(x,d);
-        force_directed_placement(x,K,R*(depth+1)*K,tol,false);
+        force_directed_placement(x,K,R*(depth+1)*K,tol,false,theta);
     } else {
         /* create coarser graph H and lay it out */
         graphe G(ctx);
@@ -4060,29 +4481,29 @@ void graphe::multilevel_recursion(layout &x,int d,double R,double K,double tol,i
         else
             coarsening_ec(M,G,P);
         layout y;
-        G.multilevel_recursion(y,d,R,K,tol,depth+1);
-        /* compute x=P*y (layout lifting) */
-        ipair pij;
+        G.multilevel_recursion(y,d,R,K,tol,theta,depth+1);
+        /* compute x=P*y (layout lifting), visiting only the nonzero elements of P */
         point yj(d);
+        sparsemat::const_iterator rt;
         for (int i=0;i<n;++i) {
             x[i]=point(d,0);
-            for (int j=0;j<m;++j) {
-                if (sparse_matrix_element(P,i,j,pij)) {
-                    copy_point(y[j],yj);
-                    scale_point(yj,to_real_number(ipair2rat(pij),ctx).to_double(ctx));
-                    add_point(x[i],yj);
-                }
+            if ((rt=P.find(i))==P.end())
+                continue;
+            for (sparsematrow::const_iterator jt=rt->second.begin();jt!=rt->second.end();++jt) {
+                copy_point(y[jt->first],yj);
+                scale_point(yj,double(jt->second.first)/double(jt->second.second));
+                add_point(x[i],yj);
             }
         }
         /* make the natural spring length K shorter with respect to
      * the current depth level and subsequently refine x */
         double L=K*std::pow(PLASTIC_NUMBER,depth-multilevel_depth);
-        force_directed_placement(x,L,R*(depth+1)*L,K*tol/L,false);
+        force_directed_placement(x,L,R*(depth+1)*L,K*tol/L,false,theta);
     }
 }
 
 /* apply multilevel force directed algorithm to layout x */
-void graphe::make_spring_layout(layout &x,int d,double tol) {
+void graphe::make_spring_layout(layout &x,int d,double tol,double theta) {
     int n=node_count();
     if (n==0)
         return;
@@ -4092,10 +4513,10 @@ void graphe::make_spring_layout(layout &x,int d,double tol) {
     } else if (n<30) {
         x.resize(n);
         create_random_layout(x,d);
-        force_directed_placement(x,10.0,DBL_MAX,tol);
+        force_directed_placement(x,10.0,DBL_MAX,tol,true,theta);
     } else {
         multilevel_mis=false;
-        multilevel_recursion(x,d,DBL_MAX,10.0,tol);
+        multilevel_recursion(x,d,DBL_MAX,10.0,tol,theta);
     }
     if (d==3) {
         /* z-center the layout */
@@ -4280,22 +4701,33 @@ void graphe::tomita(iset &R,iset &P,iset &X,map<int,int> &m,int mode) {
     }
 }
 
-/* a modified version of the Bron-Kerbosch algorithm for listing all maximal cliques,
-* developed by Tomita et al. Number of k-cliques will be stored to m[k] for each k.
-* If store_matching is true, store 2-cliques (v,w) as m[v]=w. */
+/* list all maximal cliques of this graph, the number of k-cliques will be stored to m[k] for each k.
+ * If mode=1, store 2-cliques (v,w) as m[v]=w, using the algorithm of Tomita et al.
+ * Otherwise, the cliques are found by the bron_kerbosch class and stored to maxcliques
+ * if mode=2 or mode=3. */
 void graphe::clique_stats(map<int,int> &m,int mode) {
-    iset R,X,P;
-    for (int i=0;i<node_count();++i) P.insert(i);
-    tomita(R,P,X,m,mode);
+    if (mode==1) {
+        iset R,X,P;
+        for (int i=0;i<node_count();++i) P.insert(i);
+        tomita(R,P,X,m,mode);
+        return;
+    }
+    if (mode==2 || mode==3)
+        enumerate_maximal_cliques(m,&maxcliques);
+    else enumerate_maximal_cliques(m);
 }
 
 /* generate a clique vertex cover of this graph */
 void graphe::find_maximal_cliques() {
     map<int,int> m;
-    iset R,X,P;
-    for (int i=0;i<node_count();++i) P.insert(i);
-    clear_maximal_cliques();
-    tomita(R,P,X,m,2);
+    enumerate_maximal_cliques(m,&maxcliques);
+}
+
+/* enumerate the maximal cliques of this graph (see the bron_kerbosch class), if handler
+ * is given, the cliques are passed to it (along with data) as soon as they are found */
+void graphe::enumerate_maximal_cliques(map<int,int> &stats,ivectors *cliques,clique_handler handler,void *data) const {
+    bron_kerbosch bk(this);
+    bk.enumerate(stats,cliques,handler,data);
 }
 
 /* CP recursive subroutine */
@@ -4444,11 +4876,18 @@ int graphe::ostergard::maxclique(ivector &clique) {
 * End of ostergard class
 */
 
-/* find maximum clique in this graph and return its size */
-int graphe::maximum_clique(ivector &clique) {
+/* find maximum clique in this graph and return its size, the search
+ * is parallelized if parallel=true; solver is one of _GT_CLIQUE_AUTO,
+ * _GT_CLIQUE_BITSET (bit-parallel branch and bound) and _GT_CLIQUE_CLASSIC
+ * (Carraghan-Pardalos for sparse graphs, else Ostergard) */
+int graphe::maximum_clique(ivector &clique,bool parallel,int solver) {
     assert(!is_directed());
     clique.clear();
     int n=node_count(),m=edge_count();
+    if (solver==_GT_CLIQUE_BITSET || (solver==_GT_CLIQUE_AUTO && n<=BBMC_MAX_VERTICES)) {
+        bbmc solver(this);
+        return solver.maxclique(clique,parallel);
+    }
     if (20*m<=n*(n-1)) // edge density smaller than or equal to 0.1
         return cp_maxclique(clique);
     ostergard ost(this);
@@ -5279,12 +5718,180 @@ bool graphe::is_clique(int sg) const {
 }
 
 /* find maximum independent set in this graph and return its size */
-int graphe::maximum_independent_set(ivector &v) const {
+int graphe::maximum_independent_set(ivector &v,bool parallel) const {
+    if (node_count()<=BBMC_MAX_VERTICES) {
+        bbmc solver(this,true);
+        return solver.maxclique(v,parallel);
+    }
     graphe C(ctx,false);
     complement(C);
-    return C.maximum_clique(v);
+    return C.maximum_clique(v,parallel);
+}
+
+/*
+ * TRIANGLE COUNTING:
+ * the compact-forward algorithm of Latapy. Vertices are ranked by their
+ * degrees and every edge is oriented towards the vertex with the higher rank,
+ * so that each triangle is found exactly once, from its lowest-ranked vertex,
+ * as a common out-neighbor of the endpoints of an arc. Out-neighbor lists are
+ * intersected by merging or, when their lengths differ a lot, by galloping.
+ * The vertices are distributed over threads in blocks of about equal work.
+ */
+
+/* store the common elements of the sorted arrays [a,a_end) and [b,b_end) to c, return their number */
+int graphe::intersect_sorted(const int *a,const int *a_end,const int *b,const int *b_end,int *c) {
+    int *c0=c,x,y;
+    if (a_end-a>b_end-b) {
+        std::swap(a,b);
+        std::swap(a_end,b_end);
+    }
+    if ((a_end-a)*TRIANGLE_GALLOP_RATIO<b_end-b) {
+        /* galloping search for the elements of the short list in the long one */
+        int step;
+        for (;a!=a_end && b!=b_end;++a) {
+            x=*a;
+            for (step=1;b+step<b_end && b[step]<x;step*=2);
+            b=std::lower_bound(b+step/2,std::min(b+step+1,b_end),x);
+            if (b!=b_end && *b==x)
+                *(c++)=*(b++);
+        }
+        return c-c0;
+    }
+    /* branch-free merge */
+    while (a!=a_end && b!=b_end) {
+        x=*a; y=*b;
+        *c=x;
+        c+=x==y;
+        a+=x<=y;
+        b+=y<=x;
+    }
+    return c-c0;
+}
+
+void *graphe::triangle_thread(void *arg) {
+    triangle_thread_data *data=static_cast<triangle_thread_data*>(arg);
+    const ivector &offsets=*data->offsets,&targets=*data->targets;
+    const int *adj=targets.empty()?NULL:&targets.front();
+    std::vector<ulong> &counts=data->counts;
+    ivector common;
+    ivector trg(3);
+    int u,k,cnt;
+    for (int v=data->begin;v<data->end;++v) {
+        const int *vb=adj+offsets[v],*ve=adj+offsets[v+1];
+        if (common.size()<size_t(ve-vb))
+            common.resize(ve-vb);
+        for (const int *it=vb;it!=ve;++it) {
+            u=*it;
+            cnt=intersect_sorted(it+1,ve,adj+offsets[u],adj+offsets[u+1],common.empty()?NULL:&common.front());
+            if (cnt==0)
+                continue;
+            counts[v]+=cnt;
+            counts[u]+=cnt;
+            for (k=0;k<cnt;++k) {
+                ++counts[common[k]];
+            }
+            if (data->triangles!=NULL) {
+                trg[0]=v; trg[1]=u;
+                for (k=0;k<cnt;++k) {
+                    trg[2]=common[k];
+                    data->triangles->push_back(trg);
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+/* count the triangles through every vertex of this undirected graph and store the
+ * numbers to tri, return the total number of triangles (which are also stored to
+ * dest, if not NULL, sorted lexicographically) */
+ulong graphe::vertex_triangle_counts(vector<ulong> &tri,ivectors *dest) const {
+    assert(!is_directed());
+    const csr_adjacency &A=adjacency_snapshot(false);
+    int n=node_count(),i,j,r,k;
+    /* rank vertices by degree */
+    ivector order(n),rank(n);
+    vector<ipair> key(n);
+    for (i=0;i<n;++i) {
+        key[i]=make_pair(A.degree(i),i);
+    }
+    std::sort(key.begin(),key.end());
+    for (r=0;r<n;++r) {
+        order[r]=key[r].second;
+        rank[order[r]]=r;
+    }
+    /* orient the edges towards higher ranks */
+    ivector offsets(n+1,0),targets;
+    targets.reserve(A.arc_count()/2);
+    for (r=0;r<n;++r) {
+        i=order[r];
+        for (k=A.arc_begin(i);k<A.arc_end(i);++k) {
+            if ((j=rank[A.head(k)])>r)
+                targets.push_back(j);
+        }
+        std::sort(targets.begin()+offsets[r],targets.end());
+        offsets[r+1]=targets.size();
+    }
+    /* split the vertices into blocks requiring about the same work */
+    int m=targets.size(),nt=std::max(1,std::min(max_threads(),m/TRIANGLE_MIN_ARCS+1));
+    vector<double> work(n+1,0);
+    for (r=0;r<n;++r) {
+        double w=1;
+        for (k=offsets[r];k<offsets[r+1];++k) {
+            w+=offsets[r+1]-k+offsets[targets[k]+1]-offsets[targets[k]];
+        }
+        work[r+1]=work[r]+w;
+    }
+    vector<triangle_thread_data> data(nt);
+    vector<ivectors> triangles(dest!=NULL?nt:0);
+    vector<void*> args(nt);
+    for (int t=0,b=0;t<nt;++t) {
+        triangle_thread_data &d=data[t];
+        d.offsets=&offsets;
+        d.targets=&targets;
+        d.begin=b;
+        if (t==nt-1)
+            b=n;
+        else b=std::lower_bound(work.begin()+b,work.end(),work[n]*(t+1)/nt)-work.begin();
+        d.end=b;
+        d.counts.assign(n,0);
+        d.triangles=dest!=NULL?&triangles[t]:NULL;
+        args[t]=(void*)&d;
+    }
+    run_threads(triangle_thread,args);
+    /* collect the results */
+    tri.assign(n,0);
+    ulong total=0;
+    for (int t=0;t<nt;++t) {
+        for (r=0;r<n;++r) {
+            tri[order[r]]+=data[t].counts[r];
+        }
+    }
+    for (i=0;i<n;++i) {
+        total+=tri[i];
+    }
+    total/=3;
+    if (dest!=NULL) {
+        dest->clear();
+        dest->reserve(total);
+        for (int t=0;t<nt;++t) {
+            for (ivectors::iterator it=triangles[t].begin();it!=triangles[t].end();++it) {
+                for (k=0;k<3;++k) {
+                    it->at(k)=order[it->at(k)];
+                }
+                std::sort(it->begin(),it->end());
+                dest->push_back(*it);
+            }
+        }
+        std::sort(dest->begin(),dest->end());
+    }
+    return total;
 }
 
+/*
+ * END OF TRIANGLE COUNTING
+ */
+
 /* return the number of (directed) triangles in (di)graph */
 gen graphe::triangle_count(ivectors *dest,bool ccoeff,bool exact) {
     if (is_directed()) {
@@ -5301,43 +5908,25 @@ gen graphe::triangle_count(ivectors *dest,bool ccoeff,bool exact) {
         }
         return _ratnormal(trace/gen(3),ctx);
     }
+    int n=node_count();
+    vector<ulong> tri;
+    ulong total=vertex_triangle_counts(tri,ccoeff?NULL:dest);
+    if (!ccoeff)
+        return total<=(ulong)INT_MAX?gen(int(total)):gen(longlong(total));
+    /* average the local clustering coefficients */
     gen c(0);
-    int n=node_count(),i,j,sz1,sz2,sz3,isz,p1,p2,p3;
     double sum=0.0;
-    ivector offset(n,0),intersection,trg(3),sigma;
-    ivector_iter iter;
-    graphe G(ctx,false);
-    sort_by_degrees(G,sigma);
-    node_iter it=nodes.begin(),itend=nodes.end();
-    for (i=0;it!=itend;++it,++i) {
-        const ivector &vn=it->neighbors();
-        if (ccoeff) { sz1=vn.size(); p1=(sz1*(sz1-1))/2; }
-        for (ivector_iter jt=vn.begin();jt!=vn.end();++jt) {
-            if ((j=*jt)<i) continue;
-            const ivector &wn=node(j).neighbors();
-            if (ccoeff) { sz2=wn.size(); p2=(sz2*(sz2-1))/2; }
-            if (!ccoeff && dest==NULL)
-                c+=intersect_linear(vn.begin(),vn.begin()+offset[i],wn.begin(),wn.begin()+offset[j]);
-            else {
-                intersection.resize(std::min(offset[i],offset[j]));
-                iter=set_intersection(vn.begin(),vn.begin()+offset[i],wn.begin(),wn.begin()+offset[j],intersection.begin());
-                intersection.resize(isz=iter-intersection.begin());
-                for (ivector_iter kt=intersection.begin();kt!=intersection.end();++kt) {
-                    if (ccoeff) { sz3=node(*kt).neighbors().size(); p3=(sz3*(sz3-1))/2; }
-                    if (!ccoeff) {
-                        trg[0]=i; trg[1]=j; trg[2]=*kt;
-                        dest->push_back(trg);
-                        c+=1;
-                    } else if (exact) c+=gen(1)/harmonic_mean_exact(p1,p2,p3);
-                    else sum+=1.0/harmonic_mean(p1,p2,p3);
-                }
-            }
-            ++offset[j];
-        }
+    int d;
+    for (int i=0;i<n;++i) {
+        if (tri[i]==0)
+            continue;
+        d=degree(i);
+        if (exact)
+            c+=fraction(gen(longlong(2*tri[i])),gen(d)*gen(d-1));
+        else sum+=2.0*tri[i]/(double(d)*(d-1.0));
     }
-    if (!ccoeff) return c;
-    if (!exact) return 3.0*sum/double(n);
-    return _ratnormal(gen(3)*c/gen(n),ctx);
+    if (!exact) return sum/double(n);
+    return _ratnormal(c/gen(n),ctx);
 }
 
 /* remove i-th node which is assumed to be isolated */
@@ -5347,6 +5936,8 @@ void graphe::remove_isolated_nodes(const iset &I) {
     for (i=0;i<n;++i) {
         sigma[i]=i;
     }
+    invalidate_adjacency_snapshot();
+    invalidate_label_index();
     iset::const_reverse_iterator it=I.rbegin(),itend=I.rend();
     for (;it!=itend;++it) {
         nodes.erase(nodes.begin()+*it);
@@ -5810,6 +6401,7 @@ bool graphe::make_intersection_graph(int n,int k,int sz,bool lab_sets) {
                 if (a.test(c)) lab.push_back(c+1);
             }
             node(i).set_label(lab);
+            invalidate_label_index();
         }
         for (int j=i+1;j<nchoosek;++j) {
             const bitset<32> &b=vert[j];
@@ -6183,48 +6775,55 @@ int graphe::connected_components_to_subgraphs(int sg) {
     return s;
 }
 
-void graphe::strongconnect_dfs(ivectors &components,bvector &onstack,int i,int sg) {
-    vertex &v=node(i);
-    v.set_visited(true);
-    v.set_disc(disc_time++);
-    v.set_low(v.disc());
-    node_stack.push(i);
-    onstack[i]=true;
-    int j;
-    for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-        vertex &w=node(j=*it);
-        if (sg>=0 && w.subgraph()!=sg)
-            continue;
-        if (!w.is_visited()) {
-            strongconnect_dfs(components,onstack,j,sg);
-            v.set_low(std::min(v.low(),w.low()));
-        } else if (onstack[j])
-            v.set_low(std::min(v.low(),w.disc()));
-    }
-    if (v.low()==v.disc()) {
-        /* output a strongly connected component */
-        components.resize(components.size()+1);
-        ivector &component=components.back();
-        do {
-            j=node_stack.top();
-            node_stack.pop();
-            component.push_back(j);
-            onstack[j]=false;
-        } while (j!=i);
-    }
-}
-
 /* find all strongly connected components in directed graph using Tarjan's algorithm */
 void graphe::strongly_connected_components(ivectors &components,int sg) {
     assert(node_stack.empty());
     unvisit_all_nodes(sg);
     bvector onstack(node_count(),false);
     disc_time=0;
-    int i=0;
+    dfs_walker walker(this,sg);
+    int i=0,v,w,j;
     node_iter it=nodes.begin(),itend=nodes.end();
     for (;it!=itend;++it,++i) {
-        if ((sg<0 || it->subgraph()==sg) && !it->is_visited())
-            strongconnect_dfs(components,onstack,i,sg);
+        if ((sg>=0 && it->subgraph()!=sg) || it->is_visited())
+            continue;
+        walker.start(i);
+        while (true) {
+            dfs_walker::event_type e=walker.next(v,w);
+            if (e==dfs_walker::DONE)
+                break;
+            vertex &x=node(v);
+            switch (e) {
+            case dfs_walker::DISCOVER:
+                x.set_disc(disc_time++);
+                x.set_low(x.disc());
+                node_stack.push(v);
+                onstack[v]=true;
+                break;
+            case dfs_walker::RETURN:
+                x.set_low(std::min(x.low(),node(w).low()));
+                break;
+            case dfs_walker::NONTREE_ARC:
+                if (onstack[w])
+                    x.set_low(std::min(x.low(),node(w).disc()));
+                break;
+            case dfs_walker::FINISH:
+                if (x.low()==x.disc()) {
+                    /* output a strongly connected component */
+                    components.resize(components.size()+1);
+                    ivector &component=components.back();
+                    do {
+                        j=node_stack.top();
+                        node_stack.pop();
+                        component.push_back(j);
+                        onstack[j]=false;
+                    } while (j!=v);
+                }
+                break;
+            default:
+                break;
+            }
+        }
     }
 }
 
@@ -6264,125 +6863,103 @@ void graphe::condensation(graphe &G) {
     }
 }
 
-/* return true iff the connected graph is not biconnected (i.e. has an articulation point) */
+/* return true iff the connected graph is not biconnected (i.e. has an articulation point),
+ * the search starts from the first vertex with index i or larger (in the subgraph sg) */
 bool graphe::has_cut_vertex(int sg,int i) {
-    vertex &v=node(i);
-    if (i==0) {
-        unvisit_all_nodes();
-        unset_all_ancestors();
-        disc_time=0;
-    }
-    if (sg>=0 && v.subgraph()!=sg)
-        return i==node_count()-1?false:has_cut_vertex(sg,i+1);
-    v.set_visited(true);
-    ++disc_time;
-    v.set_disc(disc_time);
-    v.set_low(disc_time);
-    int children=0;
-    for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-        int j=*it;
-        vertex &w=node(j);
-        if (sg>=0 && w.subgraph()!=sg)
-            continue;
-        if (!w.is_visited()) {
-            ++children;
-            w.set_ancestor(i);
-            if (has_cut_vertex(sg,j))
-                return true;
-            if (v.ancestor()<0) {
-                if (children==2)
+    int n=node_count(),v,w,children=0;
+    for (;i<n && sg>=0 && node(i).subgraph()!=sg;++i);
+    if (i>=n)
+        return false;
+    unvisit_all_nodes();
+    unset_all_ancestors();
+    disc_time=0;
+    dfs_walker walker(this,sg);
+    walker.start(i);
+    while (true) {
+        dfs_walker::event_type e=walker.next(v,w);
+        if (e==dfs_walker::DONE)
+            break;
+        vertex &x=node(v);
+        switch (e) {
+        case dfs_walker::DISCOVER:
+            x.set_disc(++disc_time);
+            x.set_low(disc_time);
+            break;
+        case dfs_walker::TREE_ARC:
+            node(w).set_ancestor(v);
+            break;
+        case dfs_walker::RETURN:
+            if (v==i) {
+                if (++children==2)
                     return true;
             } else {
-                v.set_low(std::min(v.low(),w.low()));
-                if (w.low()>=v.disc())
+                x.set_low(std::min(x.low(),node(w).low()));
+                if (node(w).low()>=x.disc())
                     return true;
             }
-        } else if (j!=v.ancestor() && w.disc()<v.disc())
-            v.set_low(std::min(v.low(),w.disc()));
+            break;
+        case dfs_walker::NONTREE_ARC:
+            if (w!=x.ancestor() && node(w).disc()<x.disc())
+                x.set_low(std::min(x.low(),node(w).disc()));
+            break;
+        default:
+            break;
+        }
     }
     return false;
 }
 
-void graphe::find_cut_vertices_dfs(int i,std::set<int> &ap,int sg) {
-    vertex &v=node(i);
-    v.set_visited(true);
-    ++disc_time;
-    v.set_disc(disc_time);
-    v.set_low(disc_time);
-    int children=0;
-    for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-        int j=*it;
-        vertex &w=node(j);
-        if (sg>=0 && w.subgraph()!=sg)
-            continue;
-        if (!w.is_visited()) {
-            ++children;
-            w.set_ancestor(i);
-            find_cut_vertices_dfs(j,ap,sg);
-            if (v.ancestor()<0) {
-                if (children==2)
-                    ap.insert(i);
-            } else {
-                v.set_low(std::min(v.low(),w.low()));
-                if (w.low()>=v.disc())
-                    ap.insert(i);
-            }
-        } else if (j!=v.ancestor() && w.disc()<v.disc())
-            v.set_low(std::min(v.low(),w.disc()));
-    }
-}
-
 /* return list of cut vertices obtained by using depth-first search, time complexity O(n+m) */
 void graphe::find_cut_vertices(ivector &articulation_points,int sg) {
     unvisit_all_nodes();
     unset_all_ancestors();
     disc_time=0;
-    int i=0;
-    std::set<int> ap;
+    int i=0,v,w;
+    ivector children(node_count(),0);
+    bvector ap(node_count(),false);
+    dfs_walker walker(this,sg);
     node_iter it=nodes.begin(),itend=nodes.end();
     for (;it!=itend;++it,++i) {
-        if ((sg<0 || it->subgraph()==sg) && !it->is_visited())
-            find_cut_vertices_dfs(i,ap,sg);
-    }
-    std::set<int>::const_iterator jt=ap.begin(),jtend=ap.end();
-    for (;jt!=jtend;++jt) {
-        articulation_points.push_back(*jt);
-    }
-}
-
-void graphe::find_blocks_dfs(int i,vector<ipairs> &blocks,int sg) {
-    ++disc_time;
-    vertex &v=node(i);
-    v.set_disc(disc_time);
-    v.set_low(disc_time);
-    v.set_visited(true);
-    int j;
-    ipair edge;
-    for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-        j=*it;
-        vertex &w=node(j);
-        if (sg>=0 && w.subgraph()!=sg)
+        if ((sg>=0 && it->subgraph()!=sg) || it->is_visited())
             continue;
-        edge=make_pair(i<j?i:j,i<j?j:i);
-        if (!w.is_visited()) {
-            w.set_ancestor(i);
-            edge_stack.push(edge);
-            find_blocks_dfs(j,blocks,sg);
-            v.set_low(std::min(v.low(),w.low()));
-            if (w.low()>=v.disc()) {
-                /* output biconnected component to 'blocks' */
-                blocks.resize(blocks.size()+1);
-                ipairs &block=blocks.back();
-                do {
-                    block.push_back(edge_stack.top());
-                    edge_stack.pop();
-                } while (block.back()!=edge);
+        walker.start(i);
+        while (true) {
+            dfs_walker::event_type e=walker.next(v,w);
+            if (e==dfs_walker::DONE)
+                break;
+            vertex &x=node(v);
+            switch (e) {
+            case dfs_walker::DISCOVER:
+                x.set_disc(++disc_time);
+                x.set_low(disc_time);
+                break;
+            case dfs_walker::TREE_ARC:
+                node(w).set_ancestor(v);
+                ++children[v];
+                break;
+            case dfs_walker::RETURN:
+                if (x.ancestor()<0) {
+                    if (children[v]==2)
+                        ap[v]=true;
+                } else {
+                    x.set_low(std::min(x.low(),node(w).low()));
+                    if (node(w).low()>=x.disc())
+                        ap[v]=true;
+                }
+                break;
+            case dfs_walker::NONTREE_ARC:
+                if (w!=x.ancestor() && node(w).disc()<x.disc())
+                    x.set_low(std::min(x.low(),node(w).disc()));
+                break;
+            default:
+                break;
             }
-        } else if (w.disc()<v.disc() && j!=v.ancestor()) {
-            edge_stack.push(edge);
-            v.set_low(std::min(v.low(),w.disc()));
         }
     }
+    for (bvector::const_iterator jt=ap.begin();jt!=ap.end();++jt) {
+        if (*jt)
+            articulation_points.push_back(jt-ap.begin());
+    }
 }
 
 /* create list of all biconnected components (as lists of edges) of the (sub)graph */
@@ -6391,12 +6968,52 @@ void graphe::find_blocks(vector<ipairs> &blocks,int sg) {
     unvisit_all_nodes(sg);
     unset_all_ancestors(sg);
     disc_time=0;
-    int i=0;
+    int i=0,v,w;
+    ipair edge;
+    dfs_walker walker(this,sg);
     node_iter it=nodes.begin(),itend=nodes.end();
     for (;it!=itend;++it,++i) {
-        if ((sg<0 || it->subgraph()==sg) && !it->is_visited())
-            find_blocks_dfs(i,blocks,sg);
-    }
+        if ((sg>=0 && it->subgraph()!=sg) || it->is_visited())
+            continue;
+        walker.start(i);
+        while (true) {
+            dfs_walker::event_type e=walker.next(v,w);
+            if (e==dfs_walker::DONE)
+                break;
+            vertex &x=node(v);
+            switch (e) {
+            case dfs_walker::DISCOVER:
+                x.set_disc(++disc_time);
+                x.set_low(disc_time);
+                break;
+            case dfs_walker::TREE_ARC:
+                node(w).set_ancestor(v);
+                edge_stack.push(make_pair(v<w?v:w,v<w?w:v));
+                break;
+            case dfs_walker::RETURN:
+                x.set_low(std::min(x.low(),node(w).low()));
+                if (node(w).low()>=x.disc()) {
+                    /* output biconnected component to 'blocks' */
+                    edge=make_pair(v<w?v:w,v<w?w:v);
+                    blocks.resize(blocks.size()+1);
+                    ipairs &block=blocks.back();
+                    do {
+                        block.push_back(edge_stack.top());
+                        edge_stack.pop();
+                    } while (block.back()!=edge);
+                }
+                break;
+            case dfs_walker::NONTREE_ARC:
+                if (node(w).disc()<x.disc() && w!=x.ancestor()) {
+                    edge_stack.push(make_pair(v<w?v:w,v<w?w:v));
+                    x.set_low(std::min(x.low(),node(w).disc()));
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    }
     while (!edge_stack.empty()) edge_stack.pop();
 }
 
@@ -6459,40 +7076,46 @@ void graphe::find_ears(ivectors &ears,int sg) {
     }
 }
 
-void graphe::find_bridges_dfs(int i,ipairs &B,int sg) {
-    vertex &v=node(i);
-    v.set_visited(true);
-    ++disc_time;
-    v.set_disc(disc_time);
-    v.set_low(disc_time);
-    for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-        int j=*it;
-        vertex &w=node(j);
-        if (sg>=0 && w.subgraph()!=sg)
-            continue;
-        if (!w.is_visited()) {
-            w.set_ancestor(i);
-            find_bridges_dfs(j,B,sg);
-            v.set_low(std::min(v.low(),w.low()));
-            if (w.low()>v.disc())
-                B.push_back(make_pair(i<j?i:j,i<j?j:i));
-        } else if (j!=v.ancestor() && w.disc()<v.disc())
-            v.set_low(std::min(v.low(),w.disc()));
-    }
-}
-
 /* create list B of all bridges in an undirected graph */
 void graphe::find_bridges(ipairs &B,int sg) {
     assert(!is_directed());
     unvisit_all_nodes(sg);
     unset_all_ancestors(sg);
     disc_time=0;
-    int i=0;
+    int i=0,v,w;
     B.clear();
+    dfs_walker walker(this,sg);
     node_iter it=nodes.begin(),itend=nodes.end();
     for (;it!=itend;++it,++i) {
-        if ((sg<0 || it->subgraph()==sg) && !it->is_visited())
-            find_bridges_dfs(i,B,sg);
+        if ((sg>=0 && it->subgraph()!=sg) || it->is_visited())
+            continue;
+        walker.start(i);
+        while (true) {
+            dfs_walker::event_type e=walker.next(v,w);
+            if (e==dfs_walker::DONE)
+                break;
+            vertex &x=node(v);
+            switch (e) {
+            case dfs_walker::DISCOVER:
+                x.set_disc(++disc_time);
+                x.set_low(disc_time);
+                break;
+            case dfs_walker::TREE_ARC:
+                node(w).set_ancestor(v);
+                break;
+            case dfs_walker::RETURN:
+                x.set_low(std::min(x.low(),node(w).low()));
+                if (node(w).low()>x.disc())
+                    B.push_back(make_pair(v<w?v:w,v<w?w:v));
+                break;
+            case dfs_walker::NONTREE_ARC:
+                if (w!=x.ancestor() && node(w).disc()<x.disc())
+                    x.set_low(std::min(x.low(),node(w).disc()));
+                break;
+            default:
+                break;
+            }
+        }
     }
 }
 
@@ -6691,162 +7314,522 @@ bool graphe::find_path(int i,int j,ivector &path,int sg,bool skip_embedded) {
 void graphe::clear() {
     unmark_all_nodes();
     nodes.clear();
+    invalidate_adjacency_snapshot();
+    invalidate_label_index();
 }
 
-/* return true iff the given face contains the edge {i,j} */
-int graphe::face_has_edge(const ivector &face,int i,int j) {
-    int v,w,k;
-    for (ivector_iter it=face.begin();it!=face.end();++it) {
-        v=*it;
-        k=(it-face.begin()+1)%face.size();
-        w=face[k];
-        if ((i==v && j==w) || (i==w && j==v))
-            return k;
+/*
+ * LR PLANARITY:
+ * The left-right planarity test by Brandes ("The left-right planarity test",
+ * 2009) runs in linear time. The first DFS orients the edges and computes
+ * their lowpoints and nesting depths, the second one checks the left-right
+ * constraints using a stack of conflict pairs and the third one builds a
+ * rotation system, i.e. the cyclic order of half-edges around each vertex,
+ * which represents a planar embedding. All traversals use explicit stacks.
+ */
+
+graphe::lr_planarity::lr_planarity(int nv,const ipairs &edges) {
+    n=nv;
+    m=edges.size();
+    m_offsets.resize(n+1,0);
+    for (ipairs_iter it=edges.begin();it!=edges.end();++it) {
+        ++m_offsets[it->first+1];
+        ++m_offsets[it->second+1];
     }
-    return -1;
+    for (int i=0;i<n;++i) {
+        m_offsets[i+1]+=m_offsets[i];
+    }
+    m_heads.resize(2*m);
+    m_tails.resize(2*m);
+    m_twin.resize(2*m);
+    ivector pos(m_offsets.begin(),m_offsets.end()-1);
+    int h,g;
+    for (ipairs_iter it=edges.begin();it!=edges.end();++it) {
+        h=pos[it->first]++;
+        g=pos[it->second]++;
+        m_tails[h]=m_heads[g]=it->first;
+        m_heads[h]=m_tails[g]=it->second;
+        m_twin[h]=g;
+        m_twin[g]=h;
+    }
+}
+
+/* return the lowest lowpoint of return edges in the conflict pair P */
+int graphe::lr_planarity::lowest(const conflict_pair &P) const {
+    if (P.left.empty())
+        return m_lowpt[P.right.low];
+    if (P.right.empty())
+        return m_lowpt[P.left.low];
+    return std::min(m_lowpt[P.left.low],m_lowpt[P.right.low]);
+}
+
+/* orient the edges reachable from root in DFS order, computing lowpoints and nesting depths */
+void graphe::lr_planarity::orient(int root) {
+    ivector stack(1,root);
+    int v,w,e,h;
+    while (!stack.empty()) {
+        v=stack.back();
+        stack.pop_back();
+        e=m_parent[v];
+        for (int &k=m_position[v];k<m_offsets[v+1];++k) {
+            w=m_heads[h=k];
+            if (!m_visited[h]) {
+                if (m_oriented[h] || m_oriented[m_twin[h]])
+                    continue;
+                m_oriented[h]=true;
+                m_lowpt[h]=m_lowpt2[h]=m_height[v];
+                if (m_height[w]<0) {
+                    /* tree edge, come back to h when w is finished */
+                    m_parent[w]=h;
+                    m_height[w]=m_height[v]+1;
+                    m_visited[h]=true;
+                    stack.push_back(v);
+                    stack.push_back(w);
+                    break;
+                }
+                /* back edge */
+                m_lowpt[h]=m_height[w];
+            }
+            m_nesting[h]=2*m_lowpt[h];
+            if (m_lowpt2[h]<m_height[v]) // h is chordal
+                ++m_nesting[h];
+            if (e>=0) {
+                /* update lowpoints of the parent edge */
+                if (m_lowpt[h]<m_lowpt[e]) {
+                    m_lowpt2[e]=std::min(m_lowpt[e],m_lowpt2[h]);
+                    m_lowpt[e]=m_lowpt[h];
+                } else if (m_lowpt[h]>m_lowpt[e])
+                    m_lowpt2[e]=std::min(m_lowpt2[e],m_lowpt[h]);
+                else m_lowpt2[e]=std::min(m_lowpt2[e],m_lowpt2[h]);
+            }
+        }
+    }
+}
+
+/* sort the oriented edges leaving each vertex by nesting depth */
+void graphe::lr_planarity::sort_out_edges() {
+    nesting_comparator comp(m_nesting);
+    for (int v=0;v<n;++v) {
+        std::sort(m_out.begin()+m_out_offsets[v],m_out.begin()+m_out_offsets[v+1],comp);
+    }
+}
+
+/* check the left-right constraints in the DFS tree rooted at root */
+bool graphe::lr_planarity::test(int root) {
+    ivector stack(1,root);
+    int v,w,e,ei;
+    bool finished;
+    while (!stack.empty()) {
+        v=stack.back();
+        stack.pop_back();
+        e=m_parent[v];
+        finished=true;
+        for (int &k=m_position[v];k<m_out_offsets[v+1];++k) {
+            w=m_heads[ei=m_out[k]];
+            if (!m_visited[ei]) {
+                m_stack_bottom[ei]=m_stack.size();
+                if (ei==m_parent[w]) {
+                    /* tree edge, come back to ei when w is finished */
+                    m_visited[ei]=true;
+                    stack.push_back(v);
+                    stack.push_back(w);
+                    finished=false;
+                    break;
+                }
+                /* back edge */
+                m_lowpt_edge[ei]=ei;
+                m_stack.push_back(conflict_pair());
+                m_stack.back().right.low=m_stack.back().right.high=ei;
+            }
+            /* integrate new return edges */
+            if (m_lowpt[ei]<m_height[v]) {
+                if (k==m_out_offsets[v])
+                    m_lowpt_edge[e]=m_lowpt_edge[ei];
+                else if (!add_constraints(ei,e))
+                    return false;
+            }
+        }
+        if (finished && e>=0)
+            remove_back_edges(e);
+    }
+    return true;
 }
 
-/* set 'embedded' field of all given nodes to 'true' */
-void graphe::set_nodes_embedded(const ivector &v,bool yes) {
-    for (ivector_iter it=v.begin();it!=v.end();++it) {
-        node(*it).set_embedded(yes);
+/* merge the return edges of ei into the conflict pairs of its parent edge e,
+ * returns false if the constraints cannot be satisfied */
+bool graphe::lr_planarity::add_constraints(int ei,int e) {
+    conflict_pair P,Q;
+    /* merge return edges of ei into P.right */
+    do {
+        Q=m_stack.back();
+        m_stack.pop_back();
+        if (!Q.left.empty())
+            Q.swap();
+        if (!Q.left.empty())
+            return false;
+        if (m_lowpt[Q.right.low]>m_lowpt[e]) {
+            if (P.right.empty())
+                P.right=Q.right;
+            else m_ref[P.right.low]=Q.right.high;
+            P.right.low=Q.right.low;
+        } else m_ref[Q.right.low]=m_lowpt_edge[e];
+    } while (int(m_stack.size())!=m_stack_bottom[ei]);
+    /* merge conflicting return edges of the preceding siblings of ei into P.left */
+    while (!m_stack.empty() && (conflicting(m_stack.back().left,ei) || conflicting(m_stack.back().right,ei))) {
+        Q=m_stack.back();
+        m_stack.pop_back();
+        if (conflicting(Q.right,ei))
+            Q.swap();
+        if (conflicting(Q.right,ei))
+            return false;
+        if (P.right.low>=0)
+            m_ref[P.right.low]=Q.right.high;
+        if (Q.right.low>=0)
+            P.right.low=Q.right.low;
+        if (P.left.empty())
+            P.left=Q.left;
+        else m_ref[P.left.low]=Q.left.high;
+        P.left.low=Q.left.low;
+    }
+    if (!P.left.empty() || !P.right.empty())
+        m_stack.push_back(P);
+    return true;
+}
+
+/* remove the back edges which end at the tail of the tree edge e */
+void graphe::lr_planarity::remove_back_edges(int e) {
+    int u=m_tails[e];
+    /* drop entire conflict pairs */
+    while (!m_stack.empty() && lowest(m_stack.back())==m_height[u]) {
+        if (m_stack.back().left.low>=0)
+            m_side[m_stack.back().left.low]=-1;
+        m_stack.pop_back();
+    }
+    if (!m_stack.empty()) {
+        /* trim the intervals of the topmost conflict pair */
+        conflict_pair &P=m_stack.back();
+        while (P.left.high>=0 && m_heads[P.left.high]==u) {
+            P.left.high=m_ref[P.left.high];
+        }
+        if (P.left.high<0 && P.left.low>=0) {
+            m_ref[P.left.low]=P.right.low;
+            m_side[P.left.low]=-1;
+            P.left.low=-1;
+        }
+        while (P.right.high>=0 && m_heads[P.right.high]==u) {
+            P.right.high=m_ref[P.right.high];
+        }
+        if (P.right.high<0 && P.right.low>=0) {
+            m_ref[P.right.low]=P.left.low;
+            m_side[P.right.low]=-1;
+            P.right.low=-1;
+        }
+    }
+    /* the side of e is the side of a highest return edge */
+    if (m_lowpt[e]<m_height[u] && !m_stack.empty()) {
+        int hl=m_stack.back().left.high,hr=m_stack.back().right.high;
+        m_ref[e]=hl>=0 && (hr<0 || m_lowpt[hl]>m_lowpt[hr])?hl:hr;
     }
 }
 
-/* set 'embedded' filed for all nodes to 'false' */
-void graphe::unembed_all_nodes() {
-    for (vector<vertex>::iterator it=nodes.begin();it!=nodes.end();++it) {
-        it->set_embedded(false);
+/* return the side of the edge e (1 for right, -1 for left), resolving its chain of references */
+int graphe::lr_planarity::sign(int e) {
+    ivector chain;
+    for (int f=e;m_ref[f]>=0;f=m_ref[f]) {
+        chain.push_back(f);
     }
+    for (ivector::reverse_iterator it=chain.rbegin();it!=chain.rend();++it) {
+        m_side[*it]*=m_side[m_ref[*it]];
+        m_ref[*it]=-1;
+    }
+    return m_side[e];
 }
 
-/* finds planar embedding of a biconnected graph as a list of faces,
-* returns true iff the graph is planar */
-bool graphe::demoucron(ivectors &faces,int sg) {
-    ivector cycle,path,updated_face;
-    ivectors bridges,components(node_count());
-    ipairs admissible_faces;
-    int i,j,k,n,f,s=sg,bc=max_subgraph_index(),cnt;
-    ivectors_iter ft,ftend;
-    ivector_iter ct;
-    std::set<int> contact_nodes;
-    unembed_all_nodes();
-    save_subgraphs();
-    /* adding two initial faces, obtained by finding a cycle in graph */
-    find_cycle(cycle,s);
-    set_nodes_embedded(cycle);
-    faces.clear();
-    faces.push_back(ivector(cycle.begin(),cycle.end()));
-    faces.push_back(ivector(cycle.rbegin(),cycle.rend()));
-    while (true) {
-        /* find bridges */
-        node_iter nt=nodes.begin(),ntend=nodes.end();
-        ivector_iter jt,jtend;
-        for (i=0;nt!=ntend;++nt,++i) {
-            if (!nt->is_embedded() || (s>=0 && nt->subgraph()!=s))
-                continue;
-            for (jt=nt->neighbors().begin(),jtend=nt->neighbors().end();jt!=jtend;++jt) {
-                const vertex &w=node(j=*jt);
-                if (!w.is_embedded() || (w.subgraph()==s && j<i))
-                    continue;
-                for (ft=faces.begin(),ftend=faces.end();ft!=ftend;++ft) {
-                    if (face_has_edge(*ft,i,j)>=0)
-                        break;
-                }
-                if (ft==faces.end()) {
-                    /* create a bridge consisting only of edge (i,j) */
-                    ivector bridge(4);
-                    bridge.front()=++bc; // subgraph index
-                    bridge[1]=0; // bridge size
-                    bridge[2]=i; // contact vertex 1
-                    bridge[3]=j; // contact vertex 2
-                    bridges.push_back(bridge);
-                }
-            }
-        }
-        n=bridges.size();
-        connected_components(components,s,true,&cnt);
-        bridges.resize(n+cnt);
-        for (k=0;k<cnt;++k) {
-            ivector comp=components[k];
-            ivector &bridge=bridges[n++];
-            bridge.clear();
-            bridge.push_back(++bc);
-            bridge.push_back(comp.size());
-            contact_nodes.clear();
-            for (ivector_iter it=comp.begin();it!=comp.end();++it) {
-                vertex &v=node(*it);
-                v.set_subgraph(bc);
-                for (ivector_iter jt=v.neighbors().begin();jt!=v.neighbors().end();++jt) {
-                    if (node(*jt).is_embedded())
-                        contact_nodes.insert(*jt);
-                }
+/* insert the half-edge h leaving v right after ref in the clockwise order around v */
+void graphe::lr_planarity::add_half_edge_cw(int v,int h,int ref) {
+    if (ref<0) {
+        m_cw[h]=m_ccw[h]=h;
+        m_first[v]=h;
+        return;
+    }
+    int c=m_cw[ref];
+    m_cw[ref]=h;
+    m_ccw[h]=ref;
+    m_cw[h]=c;
+    m_ccw[c]=h;
+}
+
+/* insert the half-edge h leaving v right before ref in the clockwise order around v */
+void graphe::lr_planarity::add_half_edge_ccw(int v,int h,int ref) {
+    if (ref<0) {
+        add_half_edge_cw(v,h,-1);
+        return;
+    }
+    add_half_edge_cw(v,h,m_ccw[ref]);
+    if (ref==m_first[v])
+        m_first[v]=h;
+}
+
+/* insert back edges into the rotation system in the DFS tree rooted at root */
+void graphe::lr_planarity::embed(int root) {
+    ivector stack(1,root);
+    int v,w,ei,h;
+    while (!stack.empty()) {
+        v=stack.back();
+        stack.pop_back();
+        for (int &k=m_position[v];k<m_out_offsets[v+1];) {
+            w=m_heads[ei=m_out[k++]];
+            h=m_twin[ei];
+            if (ei==m_parent[w]) {
+                /* tree edge, its reverse becomes the first half-edge around w */
+                add_half_edge_ccw(w,h,m_first[w]);
+                m_left_ref[v]=m_right_ref[v]=ei;
+                stack.push_back(v);
+                stack.push_back(w);
+                break;
             }
-            bridge.resize(2+contact_nodes.size());
-            i=2;
-            for (std::set<int>::const_iterator it=contact_nodes.begin();it!=contact_nodes.end();++it) {
-                bridge[i++]=*it;
+            if (m_side[ei]==1)
+                add_half_edge_cw(w,h,m_right_ref[w]);
+            else {
+                add_half_edge_ccw(w,h,m_left_ref[w]);
+                m_left_ref[w]=h;
             }
         }
-        if (bridges.empty())
-            break;
-        /* for each bridge, find all faces in which it can be drawn (admissible faces) */
-        admissible_faces.resize(bridges.size());
-        for (ivectors_iter it=bridges.begin();it!=bridges.end();++it) {
-            ipair &admissible=admissible_faces[it-bridges.begin()];
-            admissible.first=0;
-            for (ft=faces.begin(),ftend=faces.end();ft!=ftend;++ft) {
-                for (ct=it->begin()+2;ct!=it->end();++ct) {
-                    if (find(ft->begin(),ft->end(),*ct)==ft->end())
-                        break;
-                }
-                if (ct==it->end()) {
-                    admissible.first++;
-                    admissible.second=ft-faces.begin();
-                }
-            }
-            if (admissible.first==0) { // the graph is not planar
-                restore_subgraphs();
-                return false;
-            }
+    }
+}
+
+/* return true iff the graph is planar, if embedding=true also build the rotation system */
+bool graphe::lr_planarity::is_planar(bool embedding) {
+    if (n>2 && m>3*n-6)
+        return false;
+    int v,h;
+    m_height.assign(n,-1);
+    m_parent.assign(n,-1);
+    m_roots.clear();
+    m_lowpt.resize(2*m);
+    m_lowpt2.resize(2*m);
+    m_nesting.resize(2*m);
+    m_oriented.assign(2*m,false);
+    m_visited.assign(2*m,false);
+    m_position.assign(m_offsets.begin(),m_offsets.end()-1);
+    for (v=0;v<n;++v) {
+        if (m_height[v]<0) {
+            m_height[v]=0;
+            m_roots.push_back(v);
+            orient(v);
+        }
+    }
+    /* collect the oriented edges leaving each vertex */
+    m_out_offsets.assign(n+1,0);
+    for (h=0;h<2*m;++h) {
+        if (m_oriented[h])
+            ++m_out_offsets[m_tails[h]+1];
+    }
+    for (v=0;v<n;++v) {
+        m_out_offsets[v+1]+=m_out_offsets[v];
+    }
+    m_out.resize(m);
+    m_position.assign(m_out_offsets.begin(),m_out_offsets.end()-1);
+    for (h=0;h<2*m;++h) {
+        if (m_oriented[h])
+            m_out[m_position[m_tails[h]]++]=h;
+    }
+    sort_out_edges();
+    /* testing phase */
+    m_ref.assign(2*m,-1);
+    m_side.assign(2*m,1);
+    m_lowpt_edge.assign(2*m,-1);
+    m_stack_bottom.assign(2*m,0);
+    m_stack.clear();
+    m_visited.assign(2*m,false);
+    m_position.assign(m_out_offsets.begin(),m_out_offsets.end()-1);
+    for (ivector_iter it=m_roots.begin();it!=m_roots.end();++it) {
+        if (!test(*it))
+            return false;
+    }
+    if (!embedding)
+        return true;
+    /* embedding phase */
+    for (h=0;h<2*m;++h) {
+        if (m_oriented[h])
+            m_nesting[h]*=sign(h);
+    }
+    sort_out_edges();
+    m_cw.assign(2*m,-1);
+    m_ccw.assign(2*m,-1);
+    m_first.assign(n,-1);
+    m_left_ref.assign(n,-1);
+    m_right_ref.assign(n,-1);
+    for (v=0;v<n;++v) {
+        h=-1;
+        for (int k=m_out_offsets[v];k<m_out_offsets[v+1];++k) {
+            add_half_edge_cw(v,m_out[k],h);
+            h=m_out[k];
+        }
+    }
+    m_position.assign(m_out_offsets.begin(),m_out_offsets.end()-1);
+    for (ivector_iter it=m_roots.begin();it!=m_roots.end();++it) {
+        embed(*it);
+    }
+    return true;
+}
+
+/* store the clockwise order of neighbors around each vertex to rot (requires is_planar(true)) */
+void graphe::lr_planarity::rotation_system(ivectors &rot) const {
+    rot.resize(n);
+    for (int v=0;v<n;++v) {
+        ivector &r=rot[v];
+        r.clear();
+        if (m_first[v]<0)
+            continue;
+        int h=m_first[v];
+        do {
+            r.push_back(m_heads[h]);
+            h=m_cw[h];
+        } while (h!=m_first[v]);
+    }
+}
+
+/* store the faces of the embedding as consistently oriented vertex cycles (requires is_planar(true)) */
+void graphe::lr_planarity::faces(ivectors &F) const {
+    std::vector<bool> traced(2*m,false);
+    F.clear();
+    for (int h=0;h<2*m;++h) {
+        if (traced[h])
+            continue;
+        F.push_back(ivector());
+        ivector &face=F.back();
+        int g=h;
+        do {
+            traced[g]=true;
+            face.push_back(m_tails[g]);
+            g=m_ccw[m_twin[g]];
+        } while (g!=h);
+    }
+}
+
+/* store the vertices of the subgraph sg (all vertices if sg<0) to V and the edges of the
+ * underlying undirected subgraph, with endpoints given as indices in V, to E */
+void graphe::planarity_input(int sg,ivector &V,ipairs &E) const {
+    int n=node_count(),i,j;
+    ivector index(n,-1);
+    V.clear();
+    E.clear();
+    for (i=0;i<n;++i) {
+        if (sg<0 || node(i).subgraph()==sg) {
+            index[i]=V.size();
+            V.push_back(i);
         }
-        /* select the first bridge with the smallest number of admissible faces */
-        n=rand_max2;
-        for (ipairs_iter it=admissible_faces.begin();it!=admissible_faces.end();++it) {
-            if (it->first<n) {
-                k=it-admissible_faces.begin();
-                if ((n=it->first)==1)
-                    break;
-            }
+    }
+    for (ivector_iter it=V.begin();it!=V.end();++it) {
+        const ivector &ngh=node(*it).neighbors();
+        i=index[*it];
+        for (ivector_iter jt=ngh.begin();jt!=ngh.end();++jt) {
+            if ((j=index[*jt])<0)
+                continue;
+            if (i<j)
+                E.push_back(make_pair(i,j));
+            else if (is_directed() && i>j)
+                E.push_back(make_pair(j,i));
         }
-        ivector &bridge=bridges[k];
-        /* draw a path between the first two connecting vertices to the admissible face */
-        s=bridge.front(); // subgraph index
-        if ((n=bridge[1])>0) {
-            i=first_neighbor_from_subgraph(node(bridge[2]),s);
-            j=first_neighbor_from_subgraph(node(bridge[3]),s);
-            assert(i>=0 && j>=0);
-            find_path(i,j,path,s,true);
-            set_nodes_embedded(path);
-        } else path.clear();
-        f=admissible_faces[k].second;
-        faces.resize(faces.size()+1);
-        ivector &face=faces[f],&new_face=faces.back();
-        i=find(face.begin(),face.end(),bridge[2])-face.begin();
-        j=find(face.begin(),face.end(),bridge[3])-face.begin();
-        arc_path(i,j,face,updated_face);
-        arc_path(j,i,face,new_face);
-        if (path.size()>0) {
-            updated_face.insert(updated_face.end(),path.begin(),path.end());
-            new_face.insert(new_face.end(),path.rbegin(),path.rend());
-        }
-        face=updated_face;
-        bridges.erase(bridges.begin()+k); // we're done with this bridge
     }
-    restore_subgraphs();
+    if (is_directed()) {
+        std::sort(E.begin(),E.end());
+        E.erase(std::unique(E.begin(),E.end()),E.end());
+    }
+}
+
+/* return true iff the (sub)graph is planar */
+bool graphe::is_planar(int sg) const {
+    ivector V;
+    ipairs E;
+    planarity_input(sg,V,E);
+    lr_planarity lr(V.size(),E);
+    return lr.is_planar();
+}
+
+/* find a planar embedding of the (sub)graph as a rotation system: rot[i] is the clockwise
+ * list of neighbors of the i-th vertex, returns false if the graph is not planar */
+bool graphe::planar_rotation_system(ivectors &rot,int sg) const {
+    ivector V;
+    ipairs E;
+    ivectors local;
+    planarity_input(sg,V,E);
+    lr_planarity lr(V.size(),E);
+    if (!lr.is_planar(true))
+        return false;
+    lr.rotation_system(local);
+    rot.clear();
+    rot.resize(node_count());
+    for (ivectors_iter it=local.begin();it!=local.end();++it) {
+        ivector &r=rot[V[it-local.begin()]];
+        r.reserve(it->size());
+        for (ivector_iter jt=it->begin();jt!=it->end();++jt) {
+            r.push_back(V[*jt]);
+        }
+    }
+    return true;
+}
+
+/* find a planar embedding of the (sub)graph as a list of consistently oriented faces,
+ * returns false if the graph is not planar (faces are simple cycles if the graph is biconnected) */
+bool graphe::planar_faces(ivectors &faces,int sg) const {
+    ivector V;
+    ipairs E;
+    planarity_input(sg,V,E);
+    lr_planarity lr(V.size(),E);
+    if (!lr.is_planar(true))
+        return false;
+    lr.faces(faces);
+    for (ivectors::iterator it=faces.begin();it!=faces.end();++it) {
+        for (ivector::iterator jt=it->begin();jt!=it->end();++jt) {
+            *jt=V[*jt];
+        }
+    }
+    return true;
+}
+
+/* find a Kuratowski subgraph (a subdivision of K5 or K3,3) of the (sub)graph and store its
+ * edges to E, returns false if the graph is planar. Blocks of edges of adaptive size are
+ * deleted while the rest remains nonplanar, so what is left is minimally nonplanar. */
+bool graphe::kuratowski_subgraph(ipairs &E,int sg) const {
+    ivector V;
+    ipairs edges,rest;
+    planarity_input(sg,V,edges);
+    int n=V.size(),pos=0,len=std::max(1,int(edges.size())/2);
+    if (lr_planarity(n,edges).is_planar())
+        return false;
+    while (pos<int(edges.size())) {
+        if (interrupted || ctrl_c)
+            throw std::runtime_error("Stopped by user interruption");
+        len=std::min(len,int(edges.size())-pos);
+        rest.clear();
+        rest.insert(rest.end(),edges.begin(),edges.begin()+pos);
+        rest.insert(rest.end(),edges.begin()+pos+len,edges.end());
+        if (!lr_planarity(n,rest).is_planar()) {
+            /* these edges are not needed */
+            edges.swap(rest);
+            len*=2;
+        } else if (len>1)
+            len/=2;
+        else {
+            /* the edge at pos is essential */
+            ++pos;
+            len=2;
+        }
+    }
+    E.clear();
+    E.reserve(edges.size());
+    for (ipairs_iter it=edges.begin();it!=edges.end();++it) {
+        E.push_back(make_pair(V[it->first],V[it->second]));
+    }
     return true;
 }
 
+/*
+ * END OF LR PLANARITY
+ */
+
 /* return the common element of two sorted lists of integers if there is one, else return -1 */
 int graphe::common_element(const ivector &v1,const ivector &v2,int offset) {
     ivector_iter it1=v1.begin()+offset,it2=v2.begin()+offset;
@@ -6971,7 +7954,7 @@ int graphe::planar_embedding(ivectors &faces) {
     vector<ipairs> blocks;
     find_blocks(blocks);
     if (blocks.size()==1)
-        return demoucron(faces)?choose_outer_face(faces):-1;
+        return planar_faces(faces)?choose_outer_face(faces):-1;
     /* there exist at least one articulation point */
     unset_subgraphs();
     int sg=0;
@@ -6985,7 +7968,7 @@ int graphe::planar_embedding(ivectors &faces) {
         ivectors &block_faces=blocks_faces[i++];
         if ((ssz=subgraph_size(sg))>2) {
             /* block has three or more vertices */
-            if (int(it->size())+6>3*ssz || !demoucron(block_faces,sg))
+            if (int(it->size())+6>3*ssz || !planar_faces(block_faces,sg))
                 return -1;
         } else {
             /* block contains only one edge (a bridge)  */
@@ -7827,6 +8810,7 @@ void graphe::make_random_regular(int d,bool connected) {
             for (vector<vertex>::iterator it=nodes.begin();it!=nodes.end();++it) {
                 it->clear_neighbors();
             }
+            invalidate_adjacency_snapshot();
         }
         for (int i=0;i<n;++i) {
             degrees[i]=degree(i);
@@ -8119,6 +9103,7 @@ bool graphe::relabel_nodes(const vecteur &labels) {
     int n=node_count();
     if (int(labels.size())<n)
         return false;
+    invalidate_label_index();
     int i=0;
     for (vector<vertex>::iterator it=nodes.begin();it!=nodes.end();++it) {
         it->set_label(labels[i++]);
@@ -8443,2411 +9428,4732 @@ void graphe::unionfind::select(int id) {
  * END OF DISJOINT_SET CLASS
  */
 
-/* make planar layout */
-bool graphe::make_planar_layout(layout &x,double *score) {
-    int n=node_count(),of,m;
-    for (vector<vertex>::iterator it=nodes.begin();it!=nodes.end();++it) {
-        it->clear_edge_faces();
-    }
-    ivectors faces;
-    /* create the faces (adding temporary edges if necessary),
- * return the index of the outer face */
-    int ec=edge_count();
-    of=planar_embedding(faces);
-    if (of<0)
-        return false; // the graph is not planar
-    /* subdivide the concave faces */
-    augment(faces,of,false);
-    bool is_3conn=edge_count()==ec; // no temporary edges were added
-    const ivector &outer_face=faces[of];
-    m=outer_face.size();
-    /* create a fake outer face */
-    ivector fake_outer_face(m);
-    int label=largest_integer_label();
-    for (ivector_iter it=outer_face.begin();it!=outer_face.end();++it) {
-        add_temporary_edge(*it,fake_outer_face[it-outer_face.begin()]=add_node(++label));
+/*
+ * CSR ADJACENCY SNAPSHOT:
+ * adjacency lists packed into two contiguous arrays (row offsets and
+ * arc heads) with optional arc weights, built once and used by the
+ * read-only traversal algorithms until the graph is modified
+ */
+
+/* pack the adjacency lists of G, also extract arc weights if with_weights=true */
+void graphe::csr_adjacency::build(const graphe &G,bool with_weights) {
+    n=G.node_count();
+    m_offsets.resize(n+1);
+    m_offsets[0]=0;
+    for (int i=0;i<n;++i) {
+        m_offsets[i+1]=m_offsets[i]+G.node(i).degree();
     }
-    make_tutte_layout(x,fake_outer_face); // create the layout
-    /* remove temporary vertices and edges */
-    if (score!=NULL && !is_3conn) { // compute the ratio of the largest to smallest face
-        double fa_min=DBL_MAX,fa_max=0;
-        ivectors_iter it=faces.begin();
-        for (;it!=faces.end();++it) {
-            if (int(it-faces.begin())==of)
-                continue; // skip the outer face since its area is infinitely large
-            int fs=it->size(),i=0;
-            for (;i<fs && !is_temporary_edge(it->at(i),it->at((i+1)%fs));++i);
-            if (i==fs) {
-                layout fl(fs);
-                for (i=0;i<fs;++i) fl[i]=x[it->at(i)];
-                double a=poly_area(fl);
-                if (a<fa_min) fa_min=a;
-                if (a>fa_max) fa_max=a;
+    m_targets.resize(m_offsets[n]);
+    int k=0;
+    for (int i=0;i<n;++i) {
+        const ivector &ngh=G.node(i).neighbors();
+        for (ivector_iter it=ngh.begin();it!=ngh.end();++it) {
+            m_targets[k++]=*it;
+        }
+    }
+    m_weighted=with_weights;
+    m_numeric=m_integral=m_exact=true;
+    m_weights.clear();
+    if (with_weights) {
+        /* weights are numeric if they are integers or floats (integral if
+         * they are all machine integers, exact if they are all stored without
+         * rounding), rationals and symbolic values are stored approximately,
+         * +infinity (used for hiding arcs) is stored as DBL_MAX */
+        m_weights.resize(m_targets.size());
+        gen w;
+        for (int i=0;i<n;++i) {
+            for (k=m_offsets[i];k<m_offsets[i+1];++k) {
+                w=G.weight(i,m_targets[k]);
+                if (is_inf(w) && is_positive(w,G.giac_context())) {
+                    m_weights[k]=DBL_MAX;
+                    continue;
+                }
+                if (w.type!=_INT_ && w.type!=_ZINT && w.type!=_DOUBLE_)
+                    m_numeric=false;
+                if (w.type!=_INT_)
+                    m_integral=false;
+                if (is_real_number(w,G.giac_context()))
+                    m_weights[k]=to_real_number(w,G.giac_context()).to_double(G.giac_context());
+                else m_weights[k]=DBL_MAX;
+                if (!m_numeric || (w.type==_ZINT && !(std::abs(m_weights[k])<=9007199254740992.0)))
+                    m_exact=false; // beyond 2^53 large integers may be rounded
             }
         }
-        *score=fa_min==0?DBL_MAX:fa_max/fa_min;
-    } else if (score!=NULL) *score=0;
-    remove_temporary_edges();
-    while (node_count()>n) nodes.pop_back();
-    x.resize(n);
-    return true;
+    }
+    m_valid=true;
 }
 
-bool graphe::make_best_planar_layout(layout &x,int iter) {
-    assert(iter>0);
-    double s,min_s=-1;
-    for (int i=0;i<iter;++i) {
-        layout y;
-        if (!make_planar_layout(y,&s))
-            return false;
-        if (s==0) { // the graph is 3-connected
-            x=y;
-            break;
-        }
-        if (min_s<0 || s<min_s) {
-            min_s=s;
-            x=y;
-        }
-    }
-    return true;
+/* mark the snapshot as outdated and release the memory */
+void graphe::csr_adjacency::invalidate() {
+    if (!m_valid)
+        return;
+    m_valid=false;
+    ivector().swap(m_targets);
+    dvector().swap(m_weights);
 }
 
-/* get the convex hull of 2D graph layout */
-void graphe::convex_hull(const layout &x,layout &hull) {
-    vecteur v(x.size());
-    for (iterateur it=v.begin();it!=v.end();++it) {
-        const point &p=x[it-v.begin()];
-        *it=makecomplex(p.front(),p.back());
-    }
-    vecteur h=*_convexhull(v,ctx)._VECTptr;
-    hull.resize(h.size());
-    for (const_iterateur it=h.begin();it!=h.end();++it) {
-        point &p=hull[it-h.begin()];
-        p.resize(2);
-        p.front()=to_real_number(*it->_CPLXptr,ctx).to_double(ctx);
-        p.back()=to_real_number(*(it->_CPLXptr+1),ctx).to_double(ctx);
-    }
+/* return the index of the arc (i,j) or -1 if there is no such arc */
+int graphe::csr_adjacency::arc_index(int i,int j) const {
+    ivector_iter first=m_targets.begin()+m_offsets[i],last=m_targets.begin()+m_offsets[i+1];
+    ivector_iter it=std::lower_bound(first,last,j);
+    if (it==last || *it!=j)
+        return -1;
+    return it-m_targets.begin();
 }
 
-/* rotate layout x such that left to right symmetry is exposed */
-void graphe::layout_best_rotation(layout &x) {
-    /* center layout in the origin */
-    point center=layout_center(x);
-    scale_point(center,-1);
-    translate_layout(x,center);
-    layout hull;
-    convex_hull(x,hull);
-    int n=hull.size();
-    /* compute the hull perimeter */
-    double perim=0,score,maxscore=-1;
-    point tmp(2),mp(2),rp(2),rq(2),origin(2,0.0),proj(2);
-    for (int i=0;i<n;++i) {
-        const point &p=hull[i],&q=hull[(i+1)%n];
-        perim+=point_distance(p,q,tmp);
-    }
-    double a,b,c,d,tol,angle=0,half_perim=perim/2.0;
-    bvector matched(hull.size());
-    for (int i=0;i<n;++i) {
-        const point &p=hull[i];
-        for (int j=i+1;j<n;++j) {
-            const point &q=hull[j];
-            if (!point2segment_projection(origin,p,q,proj))
-                continue;
-            /* obtain the perpendicular bisector ax+by+c=0 of the segment pq */
-            copy_point(p,mp);
-            add_point(mp,q);
-            scale_point(mp,0.5);
-            if (p.front()==q.front()) {
-                a=1;
-                c=-mp.front();
-                b=0;
-            } else {
-                a=(p.back()-q.back())/(p.front()-q.front());
-                b=-1;
-                c=mp.back()-a*mp.front();
-            }
-            /* try to match hull edges that are reflections of each other */
-            score=0;
-            std::fill(matched.begin(),matched.end(),false);
-            for (layout_iter it=hull.begin();it!=hull.end();++it) {
-                if (matched[it-hull.begin()])
-                    continue;
-                const point &p1=*it,&q1=it+1==hull.end()?hull.front():*(it+1);
-                tol=(d=point_distance(p1,q1,tmp))*MARGIN_FACTOR/2.0;
-                point_mirror(a,b,c,p1,rp);
-                point_mirror(a,b,c,q1,rq);
-                for (layout_iter jt=it;jt!=hull.end();++jt) {
-                    if (matched[jt-hull.begin()])
-                        continue;
-                    const point &p2=*jt,&q2=jt+1==hull.end()?hull.front():*(jt+1);
-                    if ((points_coincide(rp,p2,tol) && points_coincide(rq,q2,tol)) ||
-                            (points_coincide(rp,q2,tol) && points_coincide(rq,p2,tol))) {
-                        score+=d;
-                        matched[it-hull.begin()]=true;
-                        matched[jt-hull.begin()]=true;
-                    }
-                }
-            }
-            score/=half_perim;
-            double bigpart=std::pow(PLASTIC_NUMBER,4); // hull symmetry is more important
-            score*=bigpart;
-            score+=1.0-point_distance(proj,mp,tmp)/point_distance(p,q,tmp);
-            score/=bigpart+1;
-            if (score>maxscore) {
-                maxscore=score;
-                angle=a==0?M_PI_2:std::atan(b/a);
-            }
+/* return the CSR snapshot of this graph, (re)building it if necessary */
+const graphe::csr_adjacency &graphe::adjacency_snapshot(bool weighted) const {
+    bool with_weights=weighted && supports_attributes() && is_weighted();
+    if (!frozen_adj.is_valid() || (with_weights && !frozen_adj.has_weights()))
+        frozen_adj.build(*this,with_weights);
+    assert(frozen_adj.node_count()==node_count());
+    return frozen_adj;
+}
+
+/*
+ * END OF CSR ADJACENCY SNAPSHOT
+ */
+
+/*
+ * VERTEX LABEL INDEX:
+ * Hash table of vertex labels which makes node_index run in expected constant time.
+ * Labels are hashed structurally, so that labels which compare equal always fall in
+ * the same bucket, and collisions are resolved by comparing the labels themselves.
+ * The index is built on demand and extended incrementally when a vertex is added.
+ */
+
+/* return the hash value of the real number d, consistent with the hash values of
+ * integers and of fractions with small numerator and denominator */
+unsigned graphe::label_index::hash_double(double d) {
+    if (d==std::floor(d) && std::abs(d)<9e18)
+        return std::abs(d)<2147483647.0?unsigned(int(d))*2654435761u:hash(gen(longlong(d)));
+    if (d==0)
+        d=0; // -0.0 and 0.0 are equal
+    unsigned h=2166136261u;
+    unsigned char bytes[sizeof(double)];
+    memcpy(bytes,&d,sizeof(double));
+    for (unsigned k=0;k<sizeof(double);++k) {
+        h=(h^bytes[k])*16777619u;
+    }
+    return h;
+}
+
+/* return the hash value of the vertex label lab, numbers are hashed by their normal
+ * forms (exact integers and fractions) or by their values (floating-point numbers) */
+unsigned graphe::label_index::hash(const gen &lab) {
+    unsigned h=2166136261u;
+    std::string str;
+    switch (lab.type) {
+    case _INT_:
+        return unsigned(lab.val)*2654435761u;
+    case _DOUBLE_:
+        return hash_double(lab._DOUBLE_val);
+    case _REAL: case _FLOAT_:
+        return hash_double(lab.to_double(context0));
+    case _FRAC:
+        if (lab._FRACptr->num.type==_INT_ && lab._FRACptr->den.type==_INT_) // may be equal to a double
+            return hash_double(double(lab._FRACptr->num.val)/double(lab._FRACptr->den.val));
+        str=lab.print(context0);
+        break;
+    case _VECT:
+        for (const_iterateur it=lab._VECTptr->begin();it!=lab._VECTptr->end();++it) {
+            h=(h^hash(*it))*16777619u;
         }
+        return h;
+    case _STRNG:
+        str=*lab._STRNGptr;
+        break;
+    default:
+        str=lab.print(context0);
+        break;
     }
-    rotate_layout(x,M_PI_2-angle);
-    rectangle rect=layout_bounding_rect(x);
-    if (rect.y()+rect.height()/2.0<0)
-        rotate_layout(x,M_PI);
+    for (std::string::const_iterator it=str.begin();it!=str.end();++it) {
+        h=(h^(unsigned char)*it)*16777619u;
+    }
+    return h;
 }
 
-/* return true iff the degrees of vertices in v all coincide */
-bool graphe::degrees_equal(const ivector &v,int deg) const {
-    int D=deg,d;
-    for (ivector_iter it=v.begin();it!=v.end();++it) {
-        d=degree(*it);
-        if (D==0)
-            D=d;
-        else if (d!=D)
-            return false;
+/* distribute the vertices of G into nbuckets buckets (nbuckets must be a power of two) */
+void graphe::label_index::rehash(const graphe &G,int nbuckets) {
+    m_buckets.assign(nbuckets,ivector(0));
+    int n=G.node_count();
+    for (int i=0;i<n;++i) {
+        m_buckets[hash(G.node_label(i))&(nbuckets-1)].push_back(i);
     }
-
-    return true;
 }
 
-/* customize the Giac display */
-gen graphe::customize_display(int options) {
-    return symb_equal(at_display,change_subtype(options,_INT_COLOR));
+/* build the index for the vertices of G */
+void graphe::label_index::build(const graphe &G) {
+    int nbuckets=16;
+    m_count=G.node_count();
+    while (nbuckets<m_count) nbuckets*=2;
+    rehash(G,nbuckets);
+    m_valid=true;
 }
 
-/* append the line segment [p,q] to vecteur v */
-void graphe::append_segment(vecteur &drawing,const point &p,const point &q,int color,int width,int style,bool arrow) const {
-    vecteur attributs(1,color | width | style);
-    vecteur seg=p.size()==2?
-                makevecteur(makecomplex(p[0],p[1]),makecomplex(q[0],q[1]))
-            : makevecteur(gen(makevecteur(p[0],p[1],p[2]),_POINT__VECT),gen(makevecteur(q[0],q[1],q[2]),_POINT__VECT));
-    drawing.push_back(pnt_attrib(gen(seg,arrow?_VECTOR__VECT:_GROUP__VECT),attributs,ctx));
+/* clear the index and release its memory */
+void graphe::label_index::invalidate() {
+    m_valid=false;
+    m_count=0;
+    std::vector<ivector>().swap(m_buckets);
 }
 
-/* append the vertex (as a circle) to vecteur v */
-void graphe::append_node(vecteur &drawing,const point &p,int color,int width,int shape) const {
-    gen P=point2gen(p,true),args;
-    args=makesequence(P,customize_display(color | width | shape));
-    drawing.push_back(_point(args,ctx));
+/* return the smallest index of a vertex of G labeled by lab, or -1 if there is none */
+int graphe::label_index::find(const graphe &G,const gen &lab) const {
+    assert(m_valid);
+    const ivector &bucket=m_buckets[hash(lab)&(m_buckets.size()-1)];
+    for (ivector_iter it=bucket.begin();it!=bucket.end();++it) {
+        if (G.node_label(*it)==lab)
+            return *it;
+    }
+    return -1;
 }
 
-/* append label to vecteur v at the specified quadrant */
-void graphe::append_label(vecteur &drawing,const point &p,const gen &label,int quadrant,int color) const {
-    gen P=point2gen(p),args=makesequence(P,label,customize_display(quadrant | color));
-    drawing.push_back(_legende(args,ctx));
+/* register the newly added i-th vertex of G, growing the table if necessary */
+void graphe::label_index::insert(const graphe &G,int i) {
+    assert(m_valid && i==m_count);
+    if (++m_count>int(m_buckets.size()))
+        rehash(G,2*m_buckets.size());
+    else m_buckets[hash(G.node_label(i))&(m_buckets.size()-1)].push_back(i);
 }
 
-/* convert gen to point coordinates */
-bool graphe::gen2point(const gen &g,point &p,GIAC_CONTEXT) {
-    if (g.type==_VECT || g.is_symb_of_sommet(at_point)) {
-        const vecteur &v=g.type==_VECT?*g._VECTptr:*g._SYMBptr->feuille._VECTptr;
-        p.resize(v.size());
-        for (const_iterateur it=v.begin();it!=v.end();++it) {
-            if (!is_real_number(*it,contextptr))
-                return false;
-            p[it-v.begin()]=to_real_number(*it,contextptr).to_double(contextptr);
-        }
-    } else { /* assuming that pos is a complex number */
-        p.resize(2);
-        if (g.type==_CPLX) {
-            gen &real=*g._CPLXptr,&imag=*(g._CPLXptr+1);
-            if (!is_real_number(real,contextptr) || !is_real_number(imag,contextptr))
-                return false;
-            p.front()=to_real_number(real,contextptr).to_double(contextptr);
-            p.back()=to_real_number(imag,contextptr).to_double(contextptr);
-        } else {
-            if (!is_real_number(g,contextptr))
-                return false;
-            p.front()=to_real_number(g,contextptr).to_double(contextptr);
-            p.back()=0;
-        }
+/*
+ * END OF VERTEX LABEL INDEX
+ */
+
+/*
+ * D-ARY HEAP:
+ * priority queue of vertex indices keyed by doubles, in which every vertex is
+ * contained at most once and its key may be decreased while it is in the queue
+ */
+
+/* move the element at position p towards the root until the heap property holds */
+void graphe::dary_heap::sift_up(int p) {
+    int i=m_heap[p],q;
+    double key=m_key[i];
+    while (p>0 && m_key[m_heap[q=(p-1)/4]]>key) {
+        m_heap[p]=m_heap[q];
+        m_pos[m_heap[p]]=p;
+        p=q;
+    }
+    m_heap[p]=i;
+    m_pos[i]=p;
+}
+
+/* move the element at position p towards the leaves until the heap property holds */
+void graphe::dary_heap::sift_down(int p) {
+    int sz=m_heap.size(),i=m_heap[p],c,cend,best;
+    double key=m_key[i];
+    while ((c=4*p+1)<sz) {
+        cend=std::min(c+4,sz);
+        best=c;
+        for (++c;c<cend;++c) {
+            if (m_key[m_heap[c]]<m_key[m_heap[best]])
+                best=c;
+        }
+        if (m_key[m_heap[best]]>=key)
+            break;
+        m_heap[p]=m_heap[best];
+        m_pos[m_heap[p]]=p;
+        p=best;
     }
-    return true;
+    m_heap[p]=i;
+    m_pos[i]=p;
 }
 
-/* extract position attribute from attr */
-bool graphe::get_node_position(const attrib &attr,point &p,GIAC_CONTEXT) {
-    attrib_iter it=attr.find(_GT_ATTRIB_POSITION);
-    if (it==attr.end())
-        return false;
-    return gen2point(it->second,p,contextptr);
+/* insert vertex i with the given key, or decrease its key if i is already in the heap */
+void graphe::dary_heap::push(int i,double key) {
+    m_key[i]=key;
+    if (m_pos[i]<0) {
+        m_pos[i]=m_heap.size();
+        m_heap.push_back(i);
+    }
+    sift_up(m_pos[i]);
 }
 
-/* add a single edge to the drawing */
-vecteur graphe::draw_edge(int i,int j,const layout &x) const {
-    int color,width,style;
-    const attrib &attr=node(i).neighbor_attributes(j);
-    color=default_edge_color;
-    attrib_iter ait;
-    if ((ait=attr.find(_GT_ATTRIB_COLOR))!=attr.end() && ait->second.is_integer()) {
-        color=ait->second.val;
-        if (color==7) color=0; /* draw white (invisible) edges as black */
-    } else if ((ait=attr.find(_GT_ATTRIB_TEMPORARY))!=attr.end() && giac::is_one(ait->second))
-        color=29; // gray
-    style=0;
-    width=default_edge_width;
-    if ((ait=attr.find(_GT_ATTRIB_STYLE))!=attr.end()) {
-        const gen &val=ait->second;
-        string s=val.type==_STRNG?genstring2str(val):gen2string(val);
-        if (s=="dashed")
-            style=_DASH_LINE;
-        else if (s=="dotted")
-            style=_DOT_LINE;
-        else if (s=="bold")
-            width=bold_edge_width;
+/* remove the vertex with the smallest key from the heap and return it */
+int graphe::dary_heap::pop() {
+    assert(!m_heap.empty());
+    int i=m_heap.front(),last=m_heap.back();
+    m_heap.pop_back();
+    m_pos[i]=-1;
+    if (!m_heap.empty()) {
+        m_heap.front()=last;
+        m_pos[last]=0;
+        sift_down(0);
     }
-    if ((ait=attr.find(_GT_ATTRIB_WIDTH))!=attr.end()) {
-        const gen &val=ait->second;
-        string s=val.type==_STRNG?genstring2str(val):gen2string(val);
-        if (s=="thin" || s=="1")
-            width=_LINE_WIDTH_1;
-        else if (s=="normal" || s=="2")
-            style=_LINE_WIDTH_2;
-        else if (s=="thick" || s=="3")
-            width=_LINE_WIDTH_3;
-        else if (s=="thicker" || s=="4")
-            width=_LINE_WIDTH_4;
-        else if (s=="very thick" || s=="5")
-            width=_LINE_WIDTH_5;
-        else if (s=="6")
-            width=_LINE_WIDTH_6;
-        else if (s=="7")
-            width=_LINE_WIDTH_7;
-        else if (s=="8")
-            width=_LINE_WIDTH_8;
+    return i;
+}
+
+/* remove all vertices from the heap */
+void graphe::dary_heap::clear() {
+    for (ivector_iter it=m_heap.begin();it!=m_heap.end();++it) {
+        m_pos[*it]=-1;
     }
-    vecteur res;
-    point r(x.front().size());
-    const point &p=x[i],&q=x[j];
-    if (is_directed()) {
-        assert((ait=attr.find(_GT_ATTRIB_POSITION))!=attr.end());
-        double d=to_real_number(ait->second,ctx).to_double(ctx);
-        point_lincomb(p,q,d,1-d,r);
-        append_segment(res,p,r,color,width,style,true);
-        append_segment(res,r,q,color,width,style,false);
-    } else
-        append_segment(res,p,q,color,style,width);
-    return res;
+    m_heap.clear();
 }
 
-/* append line segments representing edges (arcs) of the graph to vecteur v */
-void graphe::draw_edges(vecteur &drawing,const layout &x) {
-    if (x.empty())
+/*
+ * END OF D-ARY HEAP
+ */
+
+/* return the number of threads available for parallel computations */
+int graphe::max_threads() {
+#ifdef HAVE_LIBPTHREAD
+    return threads_allowed && threads>1?threads:1;
+#else
+    return 1;
+#endif
+}
+
+/* call routine for each element of args, in separate threads if possible
+ * (the last call is made from the calling thread, which then waits for the others) */
+void graphe::run_threads(void *(*routine)(void *),const vector<void*> &args) {
+    int nt=args.size(),j;
+#ifdef HAVE_LIBPTHREAD
+    if (nt>1) {
+        vector<pthread_t> tab(nt);
+        bvector created(nt,false);
+        for (j=0;j<nt;++j) {
+            if (j<nt-1)
+                created[j]=pthread_create(&tab[j],(pthread_attr_t *)NULL,routine,args[j])==0;
+            if (!created[j])
+                routine(args[j]);
+        }
+        for (j=0;j<nt-1;++j) {
+            if (created[j])
+                pthread_join(tab[j],NULL);
+        }
         return;
-    ipairs E,white,standard,highlighted,other;
-    get_edges_as_pairs(E);
-    attrib_iter ait;
-    for (ipairs_iter it=E.begin();it!=E.end();++it) {
-        const attrib &attr=node(it->first).neighbor_attributes(it->second);
-        if ((ait=attr.find(_GT_ATTRIB_COLOR))!=attr.end() && ait->second.is_integer()) {
-            if (ait->second.val==default_highlighted_edge_color)
-                highlighted.push_back(*it);
-            else if (ait->second.val==default_edge_color)
-                standard.push_back(*it);
-            else if (ait->second.val==_WHITE)
-                white.push_back(*it);
-            else other.push_back(*it);
-        } else if ((ait=attr.find(_GT_ATTRIB_TEMPORARY))!=attr.end() && giac::is_one(ait->second))
-            other.push_back(*it);
-        else standard.push_back(*it);
     }
-    E=white;
-    E.insert(E.end(),standard.begin(),standard.end());
-    E.insert(E.end(),other.begin(),other.end());
-    E.insert(E.end(),highlighted.begin(),highlighted.end());
-    for (ipairs_iter it=E.begin();it!=E.end();++it) {
-        vecteur res=draw_edge(it->first,it->second,x);
-        drawing=mergevecteur(drawing,res);
+#endif
+    for (j=0;j<nt;++j) {
+        routine(args[j]);
     }
 }
 
-/* append points representing vertices of the graph to vecteur v */
-void graphe::draw_nodes(vecteur &drawing,const layout &x) const {
-    if (x.empty())
-        return;
-    int color,width,n=node_count();
-    if (n<=30)
-        width=_POINT_WIDTH_4;
-    else if (n<=130)
-        width=_POINT_WIDTH_3;
-    else if (n<=330)
-        width=_POINT_WIDTH_2;
-    else
-        width=_POINT_WIDTH_1;
-    int shape,i=0;
-    attrib_iter ait;
-    node_iter it=nodes.begin(),itend=nodes.end();
-    for (;it!=itend;++it,++i) {
-        const attrib &attr=it->attributes();
-        const point &p=x[i];
-        color=default_vertex_color;
-        if ((ait=attr.find(_GT_ATTRIB_COLOR))!=attr.end() && ait->second.is_integer()) {
-            color=ait->second.val;
-            if (color==7)
-                color=0; // draw white (invisible) nodes as black
-        }
-        shape=_POINT_POINT;
-        if ((ait=attr.find(_GT_ATTRIB_SHAPE))!=attr.end()) {
-            const gen &val=ait->second;
-            string s=val.type==_STRNG?genstring2str(val):gen2string(val);
-            if (s=="box" || s=="square")
-                shape=_POINT_CARRE;
-            else if (s=="triangle")
-                shape=_POINT_TRIANGLE;
-            else if (s=="diamond")
-                shape=_POINT_LOSANGE;
-            else if (s=="star")
-                shape=_POINT_ETOILE;
-            else if (s=="plus")
-                shape=_POINT_PLUS;
+/*
+ * SPARSE MATRIX:
+ * a square matrix of doubles stored by rows, used by the iterative solvers
+ * for centrality measures. Products of large matrices with vectors are
+ * computed in parallel, the rows being split into blocks with about the same
+ * number of nonzero entries.
+ */
+
+/* set this matrix to the transpose of the adjacency matrix in A, so that the
+ * row i holds the arcs incoming to the vertex i (the entries are the arc
+ * weights if weighted=true and ones otherwise) */
+void graphe::sparse_matrix::transposed_adjacency(const csr_adjacency &A,bool weighted) {
+    n=A.node_count();
+    int i,j,k,nnz=A.arc_count();
+    m_offsets.assign(n+1,0);
+    for (k=0;k<nnz;++k) {
+        ++m_offsets[A.head(k)+1];
+    }
+    for (i=0;i<n;++i) {
+        m_offsets[i+1]+=m_offsets[i];
+    }
+    m_columns.resize(nnz);
+    m_values.resize(nnz);
+    ivector pos(m_offsets.begin(),m_offsets.end()-1);
+    for (i=0;i<n;++i) {
+        for (k=A.arc_begin(i);k<A.arc_end(i);++k) {
+            j=pos[A.head(k)]++;
+            m_columns[j]=i;
+            m_values[j]=weighted?A.weight(k):1.0;
         }
-        append_node(drawing,p,color,width,shape);
     }
 }
 
-/* return the best quadrant for the placement of the i-th vertex label
-* (minimize the collision with the adjacent edges) */
-int graphe::best_quadrant(const point &p,const layout &adj) {
-    int bestq,n=adj.size();
-    if (n==0 || p.size()!=2)
-        return _QUADRANT1;
-    layout quad(4);
-    quad[0]=make_point(0.7071,0.7071);
-    quad[1]=make_point(-0.7071,0.7071);
-    quad[2]=make_point(-0.7071,-0.7071);
-    quad[3]=make_point(0.7071,-0.7071);
-    vector<double> min_angular_dist(4,M_PI);
-    point u(2);
-    double a;
-    for (int i=0;i<4;++i) {
-        const point &q=quad[i];
-        double &mindist=min_angular_dist[i];
-        for (layout_iter it=adj.begin();it!=adj.end();++it) {
-            scale_point(u,1/point_distance(p,*it,u));
-            a=std::acos(point_dotprod(u,q));
-            if (a<mindist)
-                mindist=a;
-        }
+/* multiply the j-th column of this matrix by s[j] for all j */
+void graphe::sparse_matrix::scale_columns(const dvector &s) {
+    for (int k=0;k<nonzeros();++k) {
+        m_values[k]*=s[m_columns[k]];
     }
-    a=-1;
-    for (int i=0;i<4;++i) {
-        const double &dist=min_angular_dist[i];
-        if (a<0 || dist>a) {
-            a=dist;
-            bestq=i;
+}
+
+/* set this matrix to the Laplacian D-A of the undirected graph in A (using the
+ * edge weights if weighted=true) or to the normalized Laplacian I-D^(-1/2)*A*D^(-1/2)
+ * if normalized=true, in which case the rows of isolated vertices are zero */
+void graphe::sparse_matrix::laplacian(const csr_adjacency &A,bool weighted,bool normalized) {
+    n=A.node_count();
+    int i,j,k,p=0,nnz=A.arc_count();
+    double w;
+    dvector deg(n,0.0);
+    for (i=0;i<n;++i) {
+        for (k=A.arc_begin(i);k<A.arc_end(i);++k) {
+            deg[i]+=weighted?A.weight(k):1.0;
         }
     }
-    switch (bestq) {
-    case 0: return _QUADRANT1;
-    case 1: return _QUADRANT2;
-    case 2: return _QUADRANT3;
-    case 3: return _QUADRANT4;
-    default: break;
+    m_offsets.resize(n+1);
+    m_columns.resize(nnz+n);
+    m_values.resize(nnz+n);
+    for (i=0;i<n;++i) {
+        m_offsets[i]=p;
+        m_columns[p]=i;
+        m_values[p++]=normalized?(deg[i]>0?1.0:0.0):deg[i];
+        for (k=A.arc_begin(i);k<A.arc_end(i);++k) {
+            j=A.head(k);
+            w=weighted?A.weight(k):1.0;
+            m_columns[p]=j;
+            m_values[p++]=normalized?-w/std::sqrt(deg[i]*deg[j]):-w;
+        }
+    }
+    m_offsets[n]=p;
+}
+
+/* match each vertex of the graph with the Laplacian (or adjacency) matrix to
+ * the unmatched neighbor connected by the heaviest edge, store the index of the
+ * pair (or singleton) containing i to agg[i] and return the number of pairs */
+int graphe::sparse_matrix::heavy_edge_matching(ivector &agg) const {
+    int i,j,k,best,nc=0;
+    double w,wmax;
+    agg.assign(n,-1);
+    for (i=0;i<n;++i) {
+        if (agg[i]>=0)
+            continue;
+        best=-1;
+        wmax=0;
+        for (k=m_offsets[i];k<m_offsets[i+1];++k) {
+            j=m_columns[k];
+            if (j!=i && agg[j]<0 && (w=std::abs(m_values[k]))>wmax) {
+                wmax=w;
+                best=j;
+            }
+        }
+        agg[i]=nc;
+        if (best>=0)
+            agg[best]=nc;
+        ++nc;
     }
-    /* unreachable */
-    return -1;
+    return nc;
 }
 
-/* append labels of the nodes of this graph to vecteur v */
-void graphe::draw_labels(vecteur &drawing,const layout &x) const {
-    if (is_null())
-        return;
-    assert(!x.empty());
-    ivector adjv;
-    layout adj(2);
-    attrib_iter ait;
-    double d;
-    int color,n=node_count();
-    point r(x.front().size());
-    bool isdirected=is_directed(),isweighted=is_weighted();
-    if (isweighted && x.front().size()==2) {
-        /* draw weight labels */
-        for (int i=0;i<n;++i) {
-            const point &p=x[i];
-            const vertex &v=node(i);
-            for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-                if (!isdirected && *it<i)
-                    continue;
-                const point &q=x[*it];
-                const attrib &attr=v.neighbor_attributes(*it);
-                color=default_edge_color;
-                if ((ait=attr.find(_GT_ATTRIB_COLOR))!=attr.end())
-                    color=ait->second.val;
-                assert((ait=attr.find(_GT_ATTRIB_POSITION))!=attr.end());
-                d=to_real_number(ait->second,ctx).to_double(ctx);
-                point_lincomb(p,q,d,1-d,r);
-                adj.front()=p;
-                adj.back()=q;
-                ait=attr.find(_GT_ATTRIB_WEIGHT);
-                append_label(drawing,r,ait==attr.end()?undef:ait->second,best_quadrant(r,adj),color);
+/* store the product P'*M*P to C, where P is the n times nc matrix of zeros and ones
+ * such that P[i,j]=1 if and only if agg[i]=j */
+void graphe::sparse_matrix::galerkin_product(const ivector &agg,int nc,sparse_matrix &C) const {
+    int i,j,k,l,c;
+    ivector first(nc+1,0),members(n),pos(nc,-1);
+    for (i=0;i<n;++i) {
+        ++first[agg[i]+1];
+    }
+    for (j=0;j<nc;++j) {
+        first[j+1]+=first[j];
+    }
+    ivector fill(first.begin(),first.end()-1);
+    for (i=0;i<n;++i) {
+        members[fill[agg[i]]++]=i;
+    }
+    C.n=nc;
+    C.m_offsets.resize(nc+1);
+    C.m_columns.clear();
+    C.m_values.clear();
+    for (j=0;j<nc;++j) {
+        C.m_offsets[j]=C.m_columns.size();
+        for (l=first[j];l<first[j+1];++l) {
+            i=members[l];
+            for (k=m_offsets[i];k<m_offsets[i+1];++k) {
+                c=agg[m_columns[k]];
+                if (pos[c]<C.m_offsets[j]) {
+                    pos[c]=C.m_columns.size();
+                    C.m_columns.push_back(c);
+                    C.m_values.push_back(m_values[k]);
+                } else C.m_values[pos[c]]+=m_values[k];
             }
         }
     }
-    /* draw vertex labels */
-    for (int i=0;i<n;++i) {
-        const point &p=x[i];
-        adjacent_nodes(i,adjv);
-        adj.resize(adjv.size());
-        for (ivector_iter it=adjv.begin();it!=adjv.end();++it) {
-            adj[it-adjv.begin()]=x[*it];
+    C.m_offsets[nc]=C.m_columns.size();
+}
+
+/* compute the rows begin..end-1 of the product of this matrix and x */
+void graphe::sparse_matrix::multiply_rows(const dvector &x,dvector &y,int begin,int end) const {
+    double s;
+    for (int i=begin;i<end;++i) {
+        s=0;
+        for (int k=m_offsets[i];k<m_offsets[i+1];++k) {
+            s+=m_values[k]*x[m_columns[k]];
         }
-        append_label(drawing,p,node(i).label(),best_quadrant(p,adj));
+        y[i]=s;
     }
 }
 
-void graphe::rdfs(int i,ivector &d,bool rec,int sg,bool skip_embedded) {
-    vertex &v=node(i);
-    v.set_visited(true);
-    v.set_disc(++disc_time);
-    v.set_low(v.disc());
-    if (rec)
-        d.push_back(i);
-    int j;
-    for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-        j=*it;
-        vertex &w=node(j);
-        if ((sg>=0 && w.subgraph()!=sg) || (skip_embedded && w.is_embedded()))
-            continue;
-        if (!w.is_visited()) {
-            w.set_ancestor(i);
-            v.set_leaf(false);
-            rdfs(j,d,rec,sg,skip_embedded);
-            v.set_low(std::min(v.low(),w.low()));
-        } else if (j!=v.ancestor())
-            v.set_low(std::min(v.low(),w.disc()));
-    }
+void *graphe::sparse_matrix::product_thread(void *arg) {
+    product_data *data=static_cast<product_data*>(arg);
+    data->M->multiply_rows(*data->x,*data->y,data->begin,data->end);
+    return NULL;
 }
 
-/* depth-first graph traversal with O(n+m) time and O(m) space complexity */
-void graphe::dfs(int root,bool rec,bool clr,ivector *D,int sg,bool skip_embedded) {
-    if (clr) {
-        unvisit_all_nodes(sg);
-        unset_all_ancestors(sg);
-        for (std::vector<vertex>::iterator it=nodes.begin();it!=nodes.end();++it) {
-            if (sg<0 || it->subgraph()==sg)
-                it->set_leaf(true);
-        } 
-        disc_time=0;
+/* store the product of this matrix and x to y (x and y must be distinct) */
+void graphe::sparse_matrix::multiply(const dvector &x,dvector &y) const {
+    y.resize(n);
+    int nnz=nonzeros(),nt=nnz<SPMV_MIN_NONZEROS?1:std::min(max_threads(),n);
+    if (nt<=1) {
+        multiply_rows(x,y,0,n);
+        return;
     }
-    ivector &d=D!=NULL?*D:disc_nodes;
-    if (rec) {
-        d.clear();
-        d.reserve(node_count());
+    vector<product_data> data(nt);
+    vector<void*> args(nt);
+    int i=0;
+    for (int j=0;j<nt;++j) {
+        product_data &dt=data[j];
+        dt.M=this;
+        dt.x=&x;
+        dt.y=&y;
+        dt.begin=i;
+        while (i<n && m_offsets[i]<(double(j+1)*nnz)/nt) ++i;
+        dt.end=j+1<nt?i:n;
+        args[j]=(void *)&dt;
     }
-    assert(sg<0 || node(root).subgraph()==sg);
-    rdfs(root,d,rec,sg,skip_embedded);
+    run_threads(product_thread,args);
 }
 
-/* breadth-first graph traversal with O(n+m) time and O(m) space complexity */
-void graphe::bfs(int root,bool rec,bool clr,ivector *D,int sg,bool skip_embedded) {
-    if (clr) {
-        unvisit_all_nodes(sg);
-        unset_all_ancestors(sg);
-        disc_time=0;
+/*
+ * END OF SPARSE MATRIX
+ */
+
+/*
+ * DENSE SYMMETRIC EIGENSOLVER:
+ * a real symmetric matrix, stored by rows in a dvector, is reduced to a
+ * tridiagonal form by Householder reflections, after which the eigenvalues
+ * and eigenvectors are found by the implicit QL method (these are the
+ * tred2 and tql2 procedures from EISPACK).
+ */
+
+/* reduce the symmetric n x n matrix Z to the tridiagonal form, store the
+ * diagonal to d and the subdiagonal to e (with e[0]=0) and overwrite Z with
+ * the orthogonal matrix which accomplishes the reduction */
+void graphe::householder_tridiagonalize(int n,dvector &Z,dvector &d,dvector &e) {
+    int i,j,k;
+    double scale,f,g,h,hh;
+    d.resize(n);
+    e.resize(n);
+    for (j=0;j<n;++j) {
+        d[j]=Z[(n-1)*n+j];
+    }
+    for (i=n-1;i>0;--i) {
+        scale=h=0;
+        for (k=0;k<i;++k) {
+            scale+=std::abs(d[k]);
+        }
+        if (scale==0) {
+            e[i]=d[i-1];
+            for (j=0;j<i;++j) {
+                d[j]=Z[(i-1)*n+j];
+                Z[i*n+j]=Z[j*n+i]=0;
+            }
+        } else {
+            for (k=0;k<i;++k) {
+                d[k]/=scale;
+                h+=d[k]*d[k];
+            }
+            f=d[i-1];
+            g=std::sqrt(h);
+            if (f>0)
+                g=-g;
+            e[i]=scale*g;
+            h-=f*g;
+            d[i-1]=f-g;
+            for (j=0;j<i;++j) {
+                e[j]=0;
+            }
+            for (j=0;j<i;++j) {
+                f=d[j];
+                Z[j*n+i]=f;
+                g=e[j]+Z[j*n+j]*f;
+                for (k=j+1;k<i;++k) {
+                    g+=Z[k*n+j]*d[k];
+                    e[k]+=Z[k*n+j]*f;
+                }
+                e[j]=g;
+            }
+            f=0;
+            for (j=0;j<i;++j) {
+                e[j]/=h;
+                f+=e[j]*d[j];
+            }
+            hh=f/(h+h);
+            for (j=0;j<i;++j) {
+                e[j]-=hh*d[j];
+            }
+            for (j=0;j<i;++j) {
+                f=d[j];
+                g=e[j];
+                for (k=j;k<i;++k) {
+                    Z[k*n+j]-=f*e[k]+g*d[k];
+                }
+                d[j]=Z[(i-1)*n+j];
+                Z[i*n+j]=0;
+            }
+        }
+        d[i]=h;
     }
-    ivector &d=D!=NULL?*D:disc_nodes;
-    if (rec) {
-        d.clear();
-        d.reserve(node_count());
+    /* accumulate the transformations */
+    for (i=0;i<n-1;++i) {
+        Z[(n-1)*n+i]=Z[i*n+i];
+        Z[i*n+i]=1;
+        h=d[i+1];
+        if (h!=0) {
+            for (k=0;k<=i;++k) {
+                d[k]=Z[k*n+i+1]/h;
+            }
+            for (j=0;j<=i;++j) {
+                g=0;
+                for (k=0;k<=i;++k) {
+                    g+=Z[k*n+i+1]*Z[k*n+j];
+                }
+                for (k=0;k<=i;++k) {
+                    Z[k*n+j]-=g*d[k];
+                }
+            }
+        }
+        for (k=0;k<=i;++k) {
+            Z[k*n+i+1]=0;
+        }
     }
-    assert(node_queue.empty());
-    node_queue.push(root);
-    int i,j;
-    while (!node_queue.empty()) {
-        i=node_queue.front();
-        node_queue.pop();
-        vertex &v=node(i);
-        if (!v.is_visited()) {
-            v.set_disc(disc_time++);
-            if (rec)
-                d.push_back(i);
-            v.set_visited(true);
-            for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-                vertex &w=node(j=*it);
-                if ((sg>=0 && w.subgraph()!=sg) || (skip_embedded && w.is_embedded()))
-                    continue;
-                if (!w.is_visited()) {
-                    if (w.ancestor()<0)
-                        w.set_ancestor(i);
-                    node_queue.push(j);
+    for (j=0;j<n;++j) {
+        d[j]=Z[(n-1)*n+j];
+        Z[(n-1)*n+j]=0;
+    }
+    Z[n*n-1]=1;
+    e[0]=0;
+}
+
+/* compute the eigenvalues of the symmetric tridiagonal matrix with diagonal d
+ * and subdiagonal e (where e[0] is ignored) by the implicit QL method, sort
+ * them in ascending order and store them to d (e is destroyed), if Z is not
+ * NULL then it must contain the transformation matrix from the reduction to
+ * the tridiagonal form (or the identity) and it is overwritten by the matrix
+ * with the corresponding eigenvectors as columns, return false if the
+ * iteration failed to converge */
+bool graphe::tridiagonal_ql(int n,dvector &d,dvector &e,dvector *Z) {
+    int i,j,k,l,m,iter;
+    double f=0,tst1=0,eps=std::pow(2.0,-52.0),g,p,r,c,c2,c3,s,s2,h,dl1,el1;
+    for (i=1;i<n;++i) {
+        e[i-1]=e[i];
+    }
+    e[n-1]=0;
+    for (l=0;l<n;++l) {
+        tst1=std::max(tst1,std::abs(d[l])+std::abs(e[l]));
+        for (m=l;m<n && std::abs(e[m])>eps*tst1;++m);
+        if (m>l) {
+            iter=0;
+            do {
+                if (++iter>30*n)
+                    return false;
+                g=d[l];
+                p=(d[l+1]-g)/(2*e[l]);
+                r=std::sqrt(p*p+1);
+                if (p<0)
+                    r=-r;
+                d[l]=e[l]/(p+r);
+                d[l+1]=e[l]*(p+r);
+                dl1=d[l+1];
+                h=g-d[l];
+                for (i=l+2;i<n;++i) {
+                    d[i]-=h;
+                }
+                f+=h;
+                p=d[m];
+                c=c2=c3=1;
+                el1=e[l+1];
+                s=s2=0;
+                for (i=m-1;i>=l;--i) {
+                    c3=c2;
+                    c2=c;
+                    s2=s;
+                    g=c*e[i];
+                    h=c*p;
+                    r=std::sqrt(p*p+e[i]*e[i]);
+                    e[i+1]=s*r;
+                    s=e[i]/r;
+                    c=p/r;
+                    p=c*d[i]-s*g;
+                    d[i+1]=h+s*(c*g+s*d[i]);
+                    if (Z!=NULL) {
+                        for (k=0;k<n;++k) {
+                            double &zi=(*Z)[k*n+i],&zi1=(*Z)[k*n+i+1];
+                            h=zi1;
+                            zi1=s*zi+c*h;
+                            zi=c*zi-s*h;
+                        }
+                    }
+                }
+                p=-s*s2*c3*el1*e[l]/dl1;
+                e[l]=s*p;
+                d[l]=c*p;
+            } while (std::abs(e[l])>eps*tst1);
+        }
+        d[l]+=f;
+        e[l]=0;
+    }
+    /* sort the eigenvalues and eigenvectors */
+    for (i=0;i<n-1;++i) {
+        k=i;
+        for (j=i+1;j<n;++j) {
+            if (d[j]<d[k])
+                k=j;
+        }
+        if (k!=i) {
+            std::swap(d[i],d[k]);
+            if (Z!=NULL) {
+                for (j=0;j<n;++j) {
+                    std::swap((*Z)[j*n+i],(*Z)[j*n+k]);
                 }
             }
         }
     }
+    return true;
 }
 
-/* return true iff the graph is connected */
-bool graphe::is_connected(int sg) {
-    assert(!is_null());
-    if (is_directed()) {
-        graphe G(ctx,false);
-        underlying(G);
-        return G.is_connected(sg);
+/*
+ * END OF DENSE SYMMETRIC EIGENSOLVER
+ */
+
+/*
+ * LANCZOS EIGENSOLVER:
+ * a few extremal eigenpairs of a large sparse symmetric matrix are found by
+ * the thick-restart Lanczos method (Wu and Simon, 2000). A Krylov basis with
+ * full reorthogonalization is extended up to a fixed size and the Ritz pairs
+ * are computed by the dense solver. Then the basis is shrunk to the most
+ * wanted Ritz vectors and the residual direction, and the process repeats
+ * until the residuals of the wanted pairs are small enough. Some directions
+ * (e.g. the constant vector for Laplacians) may be excluded from the search.
+ */
+
+graphe::lanczos::lanczos(const sparse_matrix &mat,double a,double b,double c) {
+    M=&mat;
+    n=mat.size();
+    m_a=a;
+    m_b=b;
+    m_c=c;
+    m_sign=1;
+    m_seed=1;
+    m_norm=0;
+    m_deflated_count=0;
+}
+
+/* store the product of (the signed) a*M+b*I+c*J and x to y */
+void graphe::lanczos::apply(const dvector &x,dvector &y) const {
+    M->multiply(x,y);
+    double s=0;
+    if (m_c!=0) {
+        for (int i=0;i<n;++i) {
+            s+=x[i];
+        }
+        s*=m_c;
     }
-    int i=sg<0?0:first_vertex_from_subgraph(sg);
-    assert(i>=0);
-    dfs(i,false,true,NULL,sg);
-    node_iter it=nodes.begin()+i,itend=nodes.end();
-    for (;it!=itend;++it) {
-        if ((sg<0 || it->subgraph()==sg) && !it->is_visited())
-            return false;
+    for (int i=0;i<n;++i) {
+        y[i]=m_sign*(m_a*y[i]+m_b*x[i]+s);
     }
-    return true;
 }
 
-/* return true iff the graph is biconnected */
-bool graphe::is_biconnected(int sg) {
-    assert(!is_null());
-    if (is_directed()) {
-        graphe G(ctx,false);
-        underlying(G);
-        return G.is_biconnected(sg);
+/* fill v with pseudorandom numbers from [-1/2,1/2) (the sequence is reproducible) */
+void graphe::lanczos::random_vector(dvector &v) {
+    v.resize(n);
+    for (int i=0;i<n;++i) {
+        m_seed=m_seed*1103515245+12345;
+        v[i]=((m_seed>>8)&0xFFFF)/65536.0-0.5;
     }
-    return is_connected(sg) && !has_cut_vertex(sg);
 }
 
-/* return true iff the graph is triconnected, using a simple O(n*(n+m)) algorithm */
-bool graphe::is_triconnected(int sg) {
-    assert(!is_null());
-    if (is_directed()) {
-        graphe G(ctx,false);
-        underlying(G);
-        return G.is_triconnected(sg);
-    }
-    int color=max_subgraph_index()+1;
-    for (int i=node_count();i-->0;) {
-        vertex &v=node(i);
-        if (sg>=0 && v.subgraph()!=sg)
-            continue;
-        if (degree(i)<3)
-            return false;
-        v.set_subgraph(color);
+/* orthogonalize w against the deflated vectors and the first k columns of V
+ * by two passes of the classical Gram-Schmidt process, store the projections
+ * of w to the columns of V to h and return the norm of the result */
+double graphe::lanczos::orthogonalize(dvector &w,const dvector &V,int k,dvector &h) const {
+    int i,j,pass;
+    double p,nrm=0;
+    h.assign(k,0);
+    for (pass=0;pass<2;++pass) {
+        for (j=0;j<m_deflated_count;++j) {
+            const double *d=&m_deflated[j*n];
+            p=0;
+            for (i=0;i<n;++i) p+=d[i]*w[i];
+            for (i=0;i<n;++i) w[i]-=p*d[i];
+        }
+        for (j=0;j<k;++j) {
+            const double *v=&V[j*n];
+            p=0;
+            for (i=0;i<n;++i) p+=v[i]*w[i];
+            for (i=0;i<n;++i) w[i]-=p*v[i];
+            h[j]+=p;
+        }
     }
-    for (vector<vertex>::iterator it=nodes.begin();it!=nodes.end();++it) {
-        if (it->subgraph()!=color)
-            continue;
-        it->set_subgraph(color+1);
-        if (!is_biconnected(color))
-            return false;
-        it->set_subgraph(color);
+    for (i=0;i<n;++i) {
+        nrm+=w[i]*w[i];
     }
-    return true;
+    return std::sqrt(nrm);
 }
 
-/* return true iff the (sub)graph is a cycle, linear time */
-bool graphe::is_cycle(ipairs &E,int sg) {
-    int root=-1,i=0;
-    node_iter it=nodes.begin(),itend=nodes.end();
-    for (;it!=itend;++it,++i) {
-        if (sg>=0 && it->subgraph()!=sg)
-            continue;
-        if (degree(i,sg)>0) {
-            root=i;
-            break;
+/* exclude the direction of v from the search (v should be an eigenvector) */
+void graphe::lanczos::deflate(const dvector &v) {
+    dvector w(v),h;
+    double nrm=orthogonalize(w,dvector(),0,h);
+    if (nrm==0)
+        return;
+    for (int i=0;i<n;++i) {
+        m_deflated.push_back(w[i]/nrm);
+    }
+    ++m_deflated_count;
+}
+
+/* find the k largest eigenpairs of the operator by forming it as a dense matrix,
+ * the deflated directions are shifted below the spectrum */
+bool graphe::lanczos::dense_eigenpairs(int k,dvector &lambda,dvector *X) const {
+    int i,j,l;
+    dvector B(n*n),e(n),d,x(n,0),y(n);
+    double shift=0,r;
+    for (j=0;j<n;++j) {
+        x[j]=1;
+        apply(x,y);
+        x[j]=0;
+        r=0;
+        for (i=0;i<n;++i) {
+            B[i*n+j]=y[i];
+            r+=std::abs(y[i]);
         }
+        shift=std::max(shift,r);
     }
-    if (root<0)
-        return false;
-    dfs(root,true,true,NULL,sg);
-    int n=disc_nodes.size();
-    ipairs ev;
-    get_edges_as_pairs(ev,sg);
-    if (n!=int(ev.size()))
+    shift=2*shift+1;
+    for (l=0;l<m_deflated_count;++l) {
+        const double *v=&m_deflated[l*n];
+        for (i=0;i<n;++i) {
+            for (j=0;j<n;++j) {
+                B[i*n+j]-=shift*v[i]*v[j];
+            }
+        }
+    }
+    householder_tridiagonalize(n,B,d,e);
+    if (!tridiagonal_ql(n,d,e,X==NULL?NULL:&B))
         return false;
-    ipair e;
-    E.resize(n);
-    for (i=0;i<n;++i) {
-        e=make_pair(disc_nodes[i],disc_nodes[(i+1)%n]);
-        if (!has_edge(e))
-            return false;
-        E[i]=e;
+    lambda.resize(k);
+    if (X!=NULL)
+        X->resize(k*n);
+    for (j=0;j<k;++j) {
+        lambda[j]=m_sign*d[n-1-j];
+        if (X!=NULL) {
+            for (i=0;i<n;++i) {
+                (*X)[j*n+i]=B[i*n+n-1-j];
+            }
+        }
     }
     return true;
 }
 
-/* return true iff the graph is a forest (check that the connected components are all trees) */
-bool graphe::is_forest(int sg,gt_conn_check cc) {
-    assert(!is_null() && !is_directed());
-    int s,cmp;
-    switch (cc) {
-    case _GT_CC_CONNECTED:
-        return is_tree(sg);
-    case _GT_CC_FIND_COMPONENTS:
-        s=sg<0?1:1+max_subgraph_index();
-        cmp=connected_components_to_subgraphs(sg);
-    case _GT_CC_COMPONENTS_ARE_SUBGRAPHS:
-        s=1;
-        cmp=max_subgraph_index();
-        for (;s<=cmp;++s) {
-            if (edge_count(s)+1!=subgraph_size(s))
-                return false;
+/* find the k largest eigenpairs of the (signed) operator by the thick-restart Lanczos
+ * method, store them to lambda (in descending order) and X, the number of products is
+ * added to iter, return false if it exceeds maxiter */
+bool graphe::lanczos::restarted_lanczos(int k,dvector &lambda,dvector &X,double tol,int maxiter,int &iter) {
+    int dim=n-m_deflated_count,m=std::min(dim,std::max(LANCZOS_MIN_BASIS,2*k+20)),i,j,l=0,q;
+    dvector V((m+1)*n),T(m*m,0),Z,d,e,h,x(n),w(n),Y;
+    double beta=0,anorm=0,wn;
+    bool converged;
+    if (int(m_start.size())==n)
+        w=m_start;
+    else random_vector(w);
+    wn=orthogonalize(w,V,0,h);
+    if (wn<=1e-8*std::sqrt(double(n))) {
+        /* the starting vector lies in the deflated subspace */
+        random_vector(w);
+        wn=orthogonalize(w,V,0,h);
+    }
+    for (i=0;i<n;++i) {
+        V[i]=w[i]/wn;
+    }
+    while (true) {
+        /* extend the basis to m vectors */
+        for (j=l;j<m;++j) {
+            std::copy(V.begin()+j*n,V.begin()+(j+1)*n,x.begin());
+            apply(x,w);
+            ++iter;
+            wn=0;
+            for (i=0;i<n;++i) {
+                wn+=w[i]*w[i];
+            }
+            beta=orthogonalize(w,V,j+1,h);
+            for (i=0;i<=j;++i) {
+                T[i*m+j]=T[j*m+i]=h[i];
+            }
+            if (beta<=1e-10*std::sqrt(wn)) {
+                /* an invariant subspace is found, continue with a random vector
+                 * (at j=m-1 it becomes the residual direction kept on restart) */
+                beta=0;
+                if (j+1<dim) {
+                    random_vector(w);
+                    wn=orthogonalize(w,V,j+1,h);
+                    for (i=0;i<n;++i) {
+                        V[(j+1)*n+i]=w[i]/wn;
+                    }
+                } else std::fill(V.begin()+m*n,V.end(),0.0);
+                continue;
+            }
+            for (i=0;i<n;++i) {
+                V[(j+1)*n+i]=w[i]/beta;
+            }
+        }
+        /* Rayleigh-Ritz projection */
+        Z=T;
+        householder_tridiagonalize(m,Z,d,e);
+        if (!tridiagonal_ql(m,d,e,&Z))
+            return false;
+        anorm=std::max(anorm,std::max(std::abs(d.front()),std::abs(d.back())));
+        converged=true;
+        for (j=0;j<k && converged;++j) {
+            converged=std::abs(beta*Z[(m-1)*m+m-1-j])<=tol*anorm;
+        }
+        if (converged || m==dim) {
+            lambda.resize(k);
+            X.assign(k*n,0);
+            for (j=0;j<k;++j) {
+                lambda[j]=d[m-1-j];
+                for (q=0;q<m;++q) {
+                    double z=Z[q*m+m-1-j];
+                    for (i=0;i<n;++i) {
+                        X[j*n+i]+=z*V[q*n+i];
+                    }
+                }
+            }
+            m_norm=std::max(m_norm,anorm);
+            return true;
+        }
+        if (iter>=maxiter)
+            return false;
+        if (interrupted || ctrl_c)
+            throw std::runtime_error("Stopped by user interruption");
+        /* thick restart: keep the l best Ritz vectors and the residual direction */
+        l=std::min(m-1,k+(m-k)/2);
+        Y.assign(l*n,0);
+        for (j=0;j<l;++j) {
+            for (q=0;q<m;++q) {
+                double z=Z[q*m+m-l+j];
+                for (i=0;i<n;++i) {
+                    Y[j*n+i]+=z*V[q*n+i];
+                }
+            }
+        }
+        std::copy(Y.begin(),Y.end(),V.begin());
+        std::copy(V.begin()+m*n,V.begin()+(m+1)*n,V.begin()+l*n);
+        std::fill(T.begin(),T.end(),0.0);
+        for (j=0;j<l;++j) {
+            T[j*m+j]=d[m-l+j];
         }
-        return true;
-    default: break;
     }
-    assert(false);
 }
 
-/* return true iff the graph is a tournament */
-bool graphe::is_tournament(int sg) const {
-    int n=subgraph_size(sg);
-    if (!is_directed() || edge_count(sg)!=n*(n-1)/2)
+/* find the k largest (or smallest if largest=false) eigenvalues and store them to lambda
+ * in that order, if X is not NULL then store the corresponding unit eigenvectors to X one
+ * after another, return false if the iteration did not converge within maxiter products */
+bool graphe::lanczos::eigenpairs(int k,bool largest,dvector &lambda,dvector *X,double tol,int maxiter) {
+    m_sign=largest?1:-1;
+    assert(k>0 && k<=n-m_deflated_count);
+    if (n<=LANCZOS_DENSE_MAX)
+        return dense_eigenpairs(k,lambda,X);
+    int i,j,iter=0;
+    dvector Y,mu,y;
+    m_norm=0;
+    if (!restarted_lanczos(k,lambda,Y,tol,maxiter,iter))
         return false;
-    for (int i=0;i<n;++i) {
-        if (sg>=0 && node(i).subgraph()!=sg)
-            continue;
-        for (int j=0;j<n;++j) {
-            if (i==j || (sg>=0 && node(j).subgraph()!=sg))
-                continue;
-            if (has_edge(i,j)==has_edge(j,i))
+    if (k>1) {
+        /* a single Krylov sequence finds only one copy of each multiple eigenvalue,
+         * hence look for a better eigenpair orthogonally to the ones already found */
+        while (k<n-m_deflated_count) {
+            lanczos aux(*this);
+            for (j=0;j<k;++j) {
+                aux.deflate(dvector(Y.begin()+j*n,Y.begin()+(j+1)*n));
+            }
+            if (!aux.restarted_lanczos(1,mu,y,tol,maxiter,iter))
                 return false;
+            if (mu.front()<=lambda.back()+tol*std::max(m_norm,aux.m_norm))
+                break;
+            for (j=k-1;j>0 && lambda[j-1]<mu.front();--j) {
+                lambda[j]=lambda[j-1];
+                std::copy(Y.begin()+(j-1)*n,Y.begin()+j*n,Y.begin()+j*n);
+            }
+            lambda[j]=mu.front();
+            std::copy(y.begin(),y.end(),Y.begin()+j*n);
         }
     }
+    for (j=0;j<k;++j) {
+        lambda[j]*=m_sign;
+    }
+    if (X!=NULL)
+        X->swap(Y);
     return true;
 }
 
-/* return true iff the graph is planar */
-bool graphe::is_planar(int sg) {
-    ivectors comp,faces;
-    int m,s=sg<0?1:1+max_subgraph_index();
-    int cmp=connected_components_to_subgraphs(sg);
-    int tmp_sg=max_subgraph_index()+1;
-    for (;s<=cmp;++s) {
-        int sz=subgraph_size(s);
-        if (sz<5) continue;
-        m=edge_count(s);
-        if (m>3*sz-6) {
-            return false;
-        }
-        if (m<9) continue;
-        vector<ipairs> blocks;
-        find_blocks(blocks,s);
-        for (vector<ipairs>::const_iterator jt=blocks.begin();jt!=blocks.end();++jt) {
-            if (jt->size()<9) continue;
-            set_subgraph(*jt,tmp_sg);
-            if (subgraph_size(tmp_sg)<5) continue;
-            if (!demoucron(faces,tmp_sg))
-                return false;
-            renumber_subgraph(tmp_sg,s);
-        }
-        if (sg>=0)
-            renumber_subgraph(s,sg);
+/*
+ * END OF LANCZOS EIGENSOLVER
+ */
+
+/*
+ * MULTI-MODULAR DETERMINANT:
+ * the number of spanning forests of a graph is the determinant of its Laplacian
+ * with one row and column removed per connected component (the matrix-tree
+ * theorem). This matrix is positive definite, so it is factored as LDL' without
+ * pivoting in a minimum degree order, which keeps the factor sparse. The
+ * elimination tree and the column counts are computed once, then the numeric
+ * factorization is repeated modulo word-size primes in parallel. The integer
+ * is reconstructed by the Chinese remaindering once the product of the primes
+ * exceeds twice the Hadamard bound (the product of the diagonal entries).
+ */
+
+/* return the largest prime smaller than p (p>3) */
+static int previous_prime(int p) {
+    int d;
+    for (p-=p%2==0?1:2;;p-=2) {
+        for (d=3;d<=p/d && p%d!=0;d+=2);
+        if (d>p/d)
+            return p;
     }
-    return true;
 }
 
-/* create set of vertices for product P of this graph and graph G */
-void graphe::make_product_nodes(const graphe &G,graphe &P) const {
-    int n=node_count(),m=G.node_count();
-    for (int i=0;i<n;++i) {
-        for (int j=0;j<m;++j) {
-            const gen &v=node_label(i),&w=G.node_label(j);
-            string str;
-            str+=v.type==_STRNG?genstring2str(v):gen2string(v);
-            str+=":";
-            str+=w.type==_STRNG?genstring2str(w):gen2string(w);
-            P.add_node(str2gen(str,true));
-        }
+/* return the inverse of a modulo the prime p */
+static int modular_inverse(int a,int p) {
+    longlong r0=p,r1=a,s0=0,s1=1,q,t;
+    while (r1!=0) {
+        q=r0/r1;
+        t=r0-q*r1; r0=r1; r1=t;
+        t=s0-q*s1; s0=s1; s1=t;
     }
+    return s0<0?s0+p:s0;
 }
 
-/* compute the cartesian product of this graph and graph G and store it in P */
-void graphe::cartesian_product(const graphe &G,graphe &P) const {
-    assert(supports_attributes()==G.supports_attributes());
-    assert(supports_attributes()==P.supports_attributes());
-    int n=node_count(),m=G.node_count();
-    P.clear();
-    P.reserve_nodes(n*m);
-    if (supports_attributes())
-        make_product_nodes(G,P);
-    else P.add_nodes(n*m);
-    bool G_isdir=G.is_directed(),isdir=is_directed();
-    P.set_directed(G_isdir || isdir);
-    for (int i=0;i<n;++i) {
-        for (int j=0;j<m;++j) {
-            const vertex &w=G.node(j);
-            for (ivector_iter it=w.neighbors().begin();it!=w.neighbors().end();++it) {
-                if (G_isdir || *it>j)
-                    P.add_edge(i*m+j,i*m+(*it));
+/* construct the reduced Laplacian of the graph with adjacency A, from each component
+ * the vertex of maximum degree is removed (using the weights if weighted=true) */
+graphe::laplacian_minor::laplacian_minor(const csr_adjacency &A,bool weighted) {
+    int nv=A.node_count(),i,j,k,c,head,tail;
+    ivector index(nv,-2),queue(nv);
+    /* find the components and remove a vertex of maximum degree from each */
+    n=nv;
+    for (i=0;i<nv;++i) {
+        if (index[i]!=-2)
+            continue;
+        index[i]=-1;
+        queue[0]=i;
+        head=0;
+        tail=1;
+        c=i;
+        while (head<tail) {
+            j=queue[head++];
+            if (A.degree(j)>A.degree(c))
+                c=j;
+            for (k=A.arc_begin(j);k<A.arc_end(j);++k) {
+                if (index[A.head(k)]==-2) {
+                    index[A.head(k)]=-1;
+                    queue[tail++]=A.head(k);
+                }
             }
         }
+        index[c]=-3;
+        --n;
     }
-    for (int j=0;j<m;++j) {
-        for (int i=0;i<n;++i) {
-            const vertex &v=node(i);
-            for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-                if (isdir || *it>i)
-                    P.add_edge(i*m+j,(*it)*m+j);
+    for (i=0,j=0;i<nv;++i) {
+        index[i]=index[i]==-3?-1:j++;
+    }
+    m_offsets.resize(n+1);
+    m_rows.clear();
+    m_values.clear();
+    double w,d;
+    for (i=0;i<nv;++i) {
+        if ((c=index[i])<0)
+            continue;
+        m_offsets[c]=m_rows.size();
+        m_rows.push_back(c);
+        m_values.push_back(0);
+        d=0;
+        for (k=A.arc_begin(i);k<A.arc_end(i);++k) {
+            if ((j=A.head(k))==i)
+                continue;
+            w=weighted?A.weight(k):1.0;
+            d+=w;
+            if (index[j]>=0) {
+                m_rows.push_back(index[j]);
+                m_values.push_back(-w);
             }
         }
+        m_values[m_offsets[c]]=d;
     }
+    m_offsets[n]=m_rows.size();
+    minimum_degree_ordering();
+    symbolic_factorization();
 }
 
-/* compute tensor product of this graph and graph G and store it in P */
-void graphe::tensor_product(const graphe &G,graphe &P) const {
-    assert(supports_attributes()==G.supports_attributes());
-    assert(supports_attributes()==P.supports_attributes());
-    int n=node_count(),m=G.node_count();
-    P.clear();
-    P.reserve_nodes(m*n);
-    if (supports_attributes())
-        make_product_nodes(G,P);
-    else P.add_nodes(m*n);
-    bool G_isdir=G.is_directed(),isdir=is_directed();
-    P.set_directed(G_isdir || isdir);
-    for (int i=0;i<n;++i) {
-        const vertex &v=node(i);
-        for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-            for (int j=0;j<m;++j) {
-                const vertex &w=G.node(j);
-                for (ivector_iter jt=w.neighbors().begin();jt!=w.neighbors().end();++jt) {
-                    if (G_isdir || *jt>j)
-                        P.add_edge(i*m+j,(*it)*m+(*jt));
+/* compute a fill-reducing elimination order by the minimum degree heuristic,
+ * simulating the elimination on the explicit graph of the matrix */
+void graphe::laplacian_minor::minimum_degree_ordering() {
+    int i,j,v,u;
+    std::vector<ivector> adj(n);
+    std::set<ipair> queue;
+    ivector merged;
+    for (i=0;i<n;++i) {
+        for (j=m_offsets[i];j<m_offsets[i+1];++j) {
+            if (m_rows[j]!=i)
+                adj[i].push_back(m_rows[j]);
+        }
+        std::sort(adj[i].begin(),adj[i].end());
+        queue.insert(std::make_pair(int(adj[i].size()),i));
+    }
+    m_perm.clear();
+    m_perm.reserve(n);
+    while (!queue.empty()) {
+        v=queue.begin()->second;
+        queue.erase(queue.begin());
+        m_perm.push_back(v);
+        const ivector &N=adj[v];
+        /* the neighbors of v become a clique */
+        for (ivector_iter it=N.begin();it!=N.end();++it) {
+            ivector &Nu=adj[u=*it];
+            queue.erase(std::make_pair(int(Nu.size()),u));
+            merged.clear();
+            ivector_iter jt=Nu.begin(),kt=N.begin();
+            while (jt!=Nu.end() || kt!=N.end()) {
+                if (kt==N.end() || (jt!=Nu.end() && *jt<*kt))
+                    j=*(jt++);
+                else if (jt==Nu.end() || *kt<*jt)
+                    j=*(kt++);
+                else {
+                    j=*(jt++);
+                    ++kt;
                 }
+                if (j!=u && j!=v)
+                    merged.push_back(j);
             }
+            Nu.swap(merged);
+            queue.insert(std::make_pair(int(Nu.size()),u));
         }
+        ivector().swap(adj[v]);
+        if (interrupted || ctrl_c)
+            throw std::runtime_error("Stopped by user interruption");
+    }
+    m_iperm.resize(n);
+    for (i=0;i<n;++i) {
+        m_iperm[m_perm[i]]=i;
     }
 }
 
-/* compute the distance between i-th and J nodes using BFS and store them to dist
-* (also output paths if shortest_paths!=NULL) */
-void graphe::distance(int i,const ivector &J,ivector &dist,ivectors *shortest_paths) {
-    bfs(i,false);
-    int k,len;
-    if (shortest_paths!=NULL) {
-        shortest_paths->resize(J.size());
-    }
-    dist.resize(J.size());
-    ivector *shortest_path=NULL;
-    for (ivector_iter it=J.begin();it!=J.end();++it) {
-        k=*it;
-        len=0;
-        if (shortest_paths!=NULL) {
-            shortest_path=&shortest_paths->at(it-J.begin());
-            shortest_path->clear();
-            shortest_path->push_back(*it);
-        }
-        while (k!=i) {
-            if ((k=node(k).ancestor())<0) {
-                len=-1;
-                break;
+/* compute the elimination tree and the column pointers of the factor L of the
+ * permuted matrix (Davis, 2005) */
+void graphe::laplacian_minor::symbolic_factorization() {
+    int i,k,q;
+    ivector flag(n),lnz(n,0);
+    m_parent.resize(n);
+    for (k=0;k<n;++k) {
+        m_parent[k]=-1;
+        flag[k]=k;
+        for (q=m_offsets[m_perm[k]];q<m_offsets[m_perm[k]+1];++q) {
+            if ((i=m_iperm[m_rows[q]])>=k)
+                continue;
+            for (;flag[i]!=k;i=m_parent[i]) {
+                if (m_parent[i]==-1)
+                    m_parent[i]=k;
+                ++lnz[i];
+                flag[i]=k;
             }
-            if (shortest_path!=NULL)
-                shortest_path->push_back(k);
-            ++len;
         }
-        if (shortest_path!=NULL)
-            std::reverse(shortest_path->begin(),shortest_path->end());
-        dist[it-J.begin()]=len;
+    }
+    m_lp.resize(n+1);
+    m_lp[0]=0;
+    for (k=0;k<n;++k) {
+        m_lp[k+1]=m_lp[k]+lnz[k];
     }
 }
 
-/* compute the distances between all pairs of vertices */
-void graphe::allpairs_distance(matrice &m) {
-    int n=node_count(),i,j,k;
-    m.reserve(n);
-    for (i=0;i<n;++i) m.push_back(vecteur(n,plusinf()));
-    gen s;
-    if (is_weighted()) { // Floyd & Warshall algorithm, O(n^3)
-        node_iter it=nodes.begin(),itend=nodes.end();
-        for (i=0;it!=itend;++it,++i) {
-            m[i]._VECTptr->at(i)=0;
-            for (ivector_iter jt=it->neighbors().begin();jt!=it->neighbors().end();++jt) {
-                j=*jt;
-                m[i]._VECTptr->at(j)=weight(i,j);
-            }
-        }
-        for (k=0;k<n;++k) {
-            for (i=0;i<n;++i) {
-                const gen &mik=m[i][k];
-                for (j=0;j<n;++j) {
-                    s=mik+m[k][j];
-                    gen &mij=m[i]._VECTptr->at(j);
-                    if (is_strictly_greater(mij,s,ctx))
-                        mij=s;
-                }
-            }
-        }
-    } else { // compute shortest paths using BFS
-        ivector V(n),dist;
-        ivector_iter it,itend;
-        for (i=0;i<n;++i) V[i]=i;
-        for (i=0;i<n;++i) {
-            distance(i,V,dist);
-            for (it=dist.begin(),itend=dist.end();it!=itend;++it) {
-                j=it-dist.begin();
-                if (*it>=0)
-                    m[i]._VECTptr->at(j)=*it;
-            }
-        }
+/* return the binary logarithm of the Hadamard bound for the determinant */
+double graphe::laplacian_minor::log2_bound() const {
+    double res=0;
+    for (int i=0;i<n;++i) {
+        res+=std::log(m_values[m_offsets[i]])/M_LN2;
     }
+    return res;
 }
 
-/* return the length of the shortest path from src to dest in weighted
-* graph (Dijkstra's algorithm), also fill shortest_path with the respective vertices */
-void graphe::dijkstra(int src,const ivector &dest,vecteur &path_weights,ivectors *cheapest_paths,int sg) {
-    int n=node_count();
-    ivector Q;
-    vecteur dist(n);
-    bool isweighted=is_weighted();
-    if (sg>=0) {
-        assert(node(src).subgraph()==sg);
-        for (ivector_iter it=dest.begin();it!=dest.end();++it) {
-            assert(node(*it).subgraph()==sg);
-        }
+/* compute the determinant modulo the prime p<2^31 by up-looking LDL' factorization,
+ * return false if a zero pivot is encountered (i.e. p divides a leading minor) */
+bool graphe::laplacian_minor::determinant_mod(int p,int &det) const {
+    int i,k,q,qend,top,len;
+    longlong yi,lki,dk,a,res=1;
+    ivector flag(n),pattern(n),lnz(n,0),Li(m_lp[n]),Lx(m_lp[n]),Dinv(n);
+    std::vector<longlong> Y(n,0);
+    for (k=0;k<n;++k) {
+        top=n;
+        flag[k]=k;
+        /* scatter the k-th column and find the nonzero pattern of the k-th row of L */
+        for (q=m_offsets[m_perm[k]];q<m_offsets[m_perm[k]+1];++q) {
+            if ((i=m_iperm[m_rows[q]])>k)
+                continue;
+            a=longlong(m_values[q])%p;
+            Y[i]=(Y[i]+(a<0?a+p:a))%p;
+            for (len=0;flag[i]!=k;i=m_parent[i]) {
+                pattern[len++]=i;
+                flag[i]=k;
+            }
+            while (len>0) {
+                pattern[--top]=pattern[--len];
+            }
+        }
+        dk=Y[k];
+        Y[k]=0;
+        /* sparse triangular solve */
+        for (;top<n;++top) {
+            i=pattern[top];
+            yi=Y[i];
+            Y[i]=0;
+            for (q=m_lp[i],qend=m_lp[i]+lnz[i];q<qend;++q) {
+                Y[Li[q]]=(Y[Li[q]]+(p-Lx[q])*yi)%p;
+            }
+            lki=yi*Dinv[i]%p;
+            dk=(dk+(p-lki)*yi)%p;
+            Li[q]=k;
+            Lx[q]=lki;
+            ++lnz[i];
+        }
+        if (dk==0)
+            return false;
+        Dinv[k]=modular_inverse(dk,p);
+        res=res*dk%p;
     }
-    unset_all_ancestors(sg);
-    for (int i=0;i<n;++i) {
-        vertex &v=node(i);
-        if (sg>=0 && v.subgraph()!=sg) continue;
-        Q.push_back(i);
-        dist[i]=i==src?gen(0):plusinf();
+    det=res;
+    return true;
+}
+
+/* compute the natural logarithm of the determinant in floating-point arithmetic,
+ * return false if the matrix is not (numerically) positive definite */
+bool graphe::laplacian_minor::log_determinant(double &res) const {
+    int i,k,q,qend,top,len;
+    double yi,lki,dk;
+    ivector flag(n),pattern(n),lnz(n,0),Li(m_lp[n]);
+    dvector Y(n,0),Lx(m_lp[n]),D(n);
+    res=0;
+    for (k=0;k<n;++k) {
+        top=n;
+        flag[k]=k;
+        for (q=m_offsets[m_perm[k]];q<m_offsets[m_perm[k]+1];++q) {
+            if ((i=m_iperm[m_rows[q]])>k)
+                continue;
+            Y[i]+=m_values[q];
+            for (len=0;flag[i]!=k;i=m_parent[i]) {
+                pattern[len++]=i;
+                flag[i]=k;
+            }
+            while (len>0) {
+                pattern[--top]=pattern[--len];
+            }
+        }
+        dk=Y[k];
+        Y[k]=0;
+        for (;top<n;++top) {
+            i=pattern[top];
+            yi=Y[i];
+            Y[i]=0;
+            for (q=m_lp[i],qend=m_lp[i]+lnz[i];q<qend;++q) {
+                Y[Li[q]]-=Lx[q]*yi;
+            }
+            lki=yi/D[i];
+            dk-=lki*yi;
+            Li[q]=k;
+            Lx[q]=lki;
+            ++lnz[i];
+        }
+        if (dk<=0)
+            return false;
+        D[k]=dk;
+        res+=std::log(dk);
     }
-    unvisit_all_nodes(sg);
-    gen min_dist,alt;
-    int pos,u;
-    while (!Q.empty()) {
-        min_dist=plusinf();
-        pos=-1;
-        for (ivector_iter it=Q.begin();it!=Q.end();++it) {
-            if (is_strictly_greater(min_dist,dist[*it],ctx)) {
-                min_dist=dist[*it];
-                pos=it-Q.begin();
-                u=*it;
-            }
+    return true;
+}
+
+/* thread routine: compute the determinant modulo each of the assigned primes */
+void *graphe::modular_det_thread(void *arg) {
+    det_thread_data *data=static_cast<det_thread_data*>(arg);
+    for (int j=data->begin;j<data->end;++j) {
+        if (interrupted || ctrl_c)
+            break;
+        if (!data->M->determinant_mod(data->primes->at(j),data->residues->at(j)))
+            data->residues->at(j)=-1;
+    }
+    return NULL;
+}
+
+/* return the number of spanning forests of this undirected graph (with edge weights
+ * as multiplicities if the graph is weighted), or undef if the weights are not
+ * positive machine integers */
+gen graphe::spanning_forest_count() const {
+    bool weighted=is_weighted();
+    const csr_adjacency &A=adjacency_snapshot(weighted);
+    int k,j,nt=max_threads(),cnt,p=2147483647;
+    if (weighted) {
+        if (!A.has_integral_weights())
+            return undef;
+        for (k=0;k<A.arc_count();++k) {
+            if (A.weight(k)<=0 || A.weight(k)==DBL_MAX) // +infinity is stored as DBL_MAX
+                return undef;
         }
-        if (pos<0) break;
-        Q.erase(Q.begin()+pos);
-        vertex &v=node(u);
-        v.set_visited(true);
-        for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-            vertex &w=node(*it);
-            if ((sg>=0 && w.subgraph()!=sg) || w.is_visited())
+    }
+    laplacian_minor M(A,weighted);
+    if (M.size()==0)
+        return 1;
+    double bits=M.log2_bound()+1,got=0;
+    vecteur rem,mods;
+    ivector primes,residues;
+    std::vector<det_thread_data> data(nt);
+    std::vector<void*> args(nt);
+    while (got<bits) {
+        /* the primes below 2^31 have almost 31 bits */
+        cnt=std::max(nt,int(std::ceil((bits-got)/30.99)));
+        primes.resize(cnt);
+        residues.resize(cnt);
+        for (j=0;j<cnt;++j) {
+            primes[j]=p=previous_prime(p);
+        }
+        for (j=0;j<nt;++j) {
+            det_thread_data &d=data[j];
+            d.M=&M;
+            d.primes=&primes;
+            d.residues=&residues;
+            d.begin=(j*cnt)/nt;
+            d.end=((j+1)*cnt)/nt;
+            args[j]=&d;
+        }
+        run_threads(modular_det_thread,args);
+        if (interrupted || ctrl_c)
+            throw std::runtime_error("Stopped by user interruption");
+        for (j=0;j<cnt;++j) {
+            if (residues[j]<0)
                 continue;
-            alt=dist[u]+(isweighted?weight(u,*it):gen(1));
-            if (is_strictly_greater(dist[*it],alt,ctx)) {
-                dist[*it]=alt;
-                w.set_ancestor(u);
-            }
+            rem.push_back(residues[j]);
+            mods.push_back(primes[j]);
+            got+=std::log(double(primes[j]))/M_LN2;
         }
     }
-    path_weights.resize(dest.size());
-    for (ivector_iter it=dest.begin();it!=dest.end();++it) {
-        path_weights[it-dest.begin()]=dist[*it];
-    }
-    if (cheapest_paths!=NULL) {
-        cheapest_paths->resize(dest.size());
-        for (ivector_iter it=dest.begin();it!=dest.end();++it) {
-            ivector &path=cheapest_paths->at(it-dest.begin());
-            path.clear();
-            if (is_inf(dist[*it])) continue;
-            path.push_back(*it);
-            int p=*it;
-            while ((p=node(p).ancestor())>=0) path.push_back(p);
-            std::reverse(path.begin(),path.end());
+    /* Chinese remaindering along a product tree */
+    while (rem.size()>1) {
+        for (j=0;2*j+1<int(rem.size());++j) {
+            rem[j]=ichinrem(rem[2*j],rem[2*j+1],mods[2*j],mods[2*j+1]);
+            mods[j]=mods[2*j]*mods[2*j+1];
+        }
+        if (rem.size()%2) {
+            rem[j]=rem.back();
+            mods[j]=mods.back();
+            ++j;
         }
+        rem.resize(j);
+        mods.resize(j);
     }
+    if (is_positive(-rem.front(),ctx))
+        return rem.front()+mods.front();
+    return rem.front();
 }
 
-/* return the length of the shortest path from src to dest in weighted
-* graph (Bellman-Ford algorithm), also fill shortest_path with the respective vertices */
-bool graphe::bellman_ford(int src,const ivector &dest,vecteur &path_weights,ivectors *cheapest_paths) {
-    int n=node_count(),u,v;
-    ivector prev(n);
-    vecteur dist(n);
-    bool isweighted=is_weighted();
-    for (int i=0;i<n;++i) {
-        dist[i]=i==src?gen(0):plusinf();
-        prev[i]=-1;
+/* store the natural logarithm of the number of spanning forests of this undirected
+ * graph to res, computed in floating-point arithmetic, return false if the weights
+ * are not positive real numbers */
+bool graphe::spanning_forest_count_log(double &res) const {
+    bool weighted=is_weighted();
+    const csr_adjacency &A=adjacency_snapshot(weighted);
+    if (weighted) {
+        if (!A.has_numeric_weights())
+            return false;
+        for (int k=0;k<A.arc_count();++k) {
+            if (A.weight(k)<=0 || A.weight(k)==DBL_MAX)
+                return false;
+        }
     }
-    ipairs E;
-    get_edges_as_pairs(E);
-    gen w(1);
-    for (int i=1;i<n;++i) {
-        for (ipairs_iter it=E.begin();it!=E.end();++it) {
-            u=it->first; v=it->second;
-            if (isweighted)
-                get_edge_attribute(u,v,_GT_ATTRIB_WEIGHT,w);
-            if (is_strictly_greater(dist[v],dist[u]+w,ctx)) {
-                dist[v]=dist[u]+w;
-                prev[v]=u;
+    laplacian_minor M(A,weighted);
+    return M.log_determinant(res);
+}
+
+/*
+ * END OF MULTI-MODULAR DETERMINANT
+ */
+
+/*
+ * ALL-PAIRS DISTANCES:
+ * the distances are computed in floating-point arithmetic and stored in a
+ * contiguous row-major matrix, with DBL_MAX standing for infinity. Unweighted
+ * graphs are handled by breadth-first searches, sparse weighted graphs by
+ * Johnson's algorithm (Dijkstra's algorithm from each source after reweighting
+ * the arcs to nonnegative weights) and dense ones by blocked Floyd-Warshall
+ * algorithm. The sources, resp. the tiles, are distributed among the threads.
+ */
+
+/* thread routine: BFS from each source in the assigned range */
+void *graphe::apsp_bfs_thread(void *arg) {
+    apsp_thread_data *data=static_cast<apsp_thread_data*>(arg);
+    const csr_adjacency &A=*data->A;
+    int n=data->n,head,tail,v,w,l;
+    ivector d(n,-1),Q(n);
+    for (int s=data->begin;s<data->end;++s) {
+        double *row=data->D+size_t(s)*n;
+        d[s]=0;
+        Q[0]=s;
+        head=0;
+        tail=1;
+        while (head<tail) {
+            v=Q[head++];
+            for (l=A.arc_begin(v);l<A.arc_end(v);++l) {
+                if (d[w=A.head(l)]<0) {
+                    d[w]=d[v]+1;
+                    Q[tail++]=w;
+                }
+            }
+        }
+        for (l=0;l<tail;++l) {
+            v=Q[l];
+            row[v]=d[v];
+            d[v]=-1;
+        }
+    }
+    return arg;
+}
+
+/* thread routine: Dijkstra's algorithm from each source in the assigned range,
+ * using the reweighting w(u,v)+h[u]-h[v] if vertex potentials h are given */
+void *graphe::apsp_dijkstra_thread(void *arg) {
+    apsp_thread_data *data=static_cast<apsp_thread_data*>(arg);
+    const csr_adjacency &A=*data->A;
+    const dvector *h=data->h;
+    int n=data->n,u,v,k;
+    dvector dist(n,DBL_MAX);
+    ivector touched;
+    touched.reserve(n);
+    dary_heap Q(n);
+    double w,alt;
+    for (int s=data->begin;s<data->end;++s) {
+        double *row=data->D+size_t(s)*n;
+        dist[s]=0;
+        touched.push_back(s);
+        Q.push(s,0);
+        while (!Q.empty()) {
+            u=Q.pop();
+            row[u]=h==NULL?dist[u]:dist[u]-(*h)[s]+(*h)[u];
+            for (k=A.arc_begin(u);k<A.arc_end(u);++k) {
+                if ((w=A.weight(k))==DBL_MAX)
+                    continue;
+                v=A.head(k);
+                if (h!=NULL && (w+=(*h)[u]-(*h)[v])<0)
+                    w=0; // rounding error
+                alt=dist[u]+w;
+                if (alt<dist[v]) {
+                    if (dist[v]==DBL_MAX)
+                        touched.push_back(v);
+                    dist[v]=alt;
+                    Q.push(v,alt);
+                }
             }
         }
+        for (ivector_iter it=touched.begin();it!=touched.end();++it) {
+            dist[*it]=DBL_MAX;
+        }
+        touched.clear();
     }
-    /* check for negative-weight cycles */
-    for (ipairs_iter it=E.begin();it!=E.end();++it) {
-        if (isweighted)
-            get_edge_attribute(u,v,_GT_ATTRIB_WEIGHT,w);
-        if (is_strictly_greater(dist[v],dist[u]+w,ctx))
-            return false; // a negative-weight cycle is found
+    return arg;
+}
+
+/* relax the distances in tile (ib,jb) of D through the vertices in block kb,
+ * the innermost loop is a branch-free min-plus update over a row segment */
+void graphe::floyd_warshall_tile(double *D,int n,int ib,int jb,int kb) {
+    int i0=ib*FW_BLOCK_SIZE,i1=std::min(n,i0+FW_BLOCK_SIZE);
+    int j0=jb*FW_BLOCK_SIZE,j1=std::min(n,j0+FW_BLOCK_SIZE);
+    int k0=kb*FW_BLOCK_SIZE,k1=std::min(n,k0+FW_BLOCK_SIZE);
+    double dik,s,*Di;
+    const double *Dk;
+    for (int k=k0;k<k1;++k) {
+        Dk=D+size_t(k)*n;
+        for (int i=i0;i<i1;++i) {
+            Di=D+size_t(i)*n;
+            if ((dik=Di[k])==DBL_MAX)
+                continue;
+            for (int j=j0;j<j1;++j) {
+                s=dik+Dk[j];
+                Di[j]=s<Di[j]?s:Di[j];
+            }
+        }
     }
-    if (cheapest_paths!=NULL) {
-        cheapest_paths->resize(dest.size());
-        for (ivector_iter it=dest.begin();it!=dest.end();++it) {
-            ivector &path=cheapest_paths->at(it-dest.begin());
-            path.clear();
-            path.push_back(*it);
-            int p=*it;
-            while ((p=prev[p])>=0) path.push_back(p);
-            std::reverse(path.begin(),path.end());
+}
+
+/* thread routine: relax the assigned tiles in the given phase of blocked Floyd-Warshall
+ * algorithm (phase 1: tiles in the pivot row and column, phase 2: all other tiles) */
+void *graphe::floyd_warshall_thread(void *arg) {
+    apsp_thread_data *data=static_cast<apsp_thread_data*>(arg);
+    int n=data->n,kb=data->kb,nb=(n+FW_BLOCK_SIZE-1)/FW_BLOCK_SIZE,ib,jb;
+    for (int t=data->begin;t<data->end;++t) {
+        if (data->phase==1) {
+            if (t<nb-1) {
+                ib=kb;
+                jb=t<kb?t:t+1;
+            } else {
+                ib=t-nb+1<kb?t-nb+1:t-nb+2;
+                jb=kb;
+            }
+        } else {
+            ib=t/(nb-1);
+            jb=t%(nb-1);
+            if (ib>=kb) ++ib;
+            if (jb>=kb) ++jb;
         }
+        floyd_warshall_tile(data->D,n,ib,jb,kb);
     }
-    path_weights.resize(dest.size());
-    for (ivector_iter it=dest.begin();it!=dest.end();++it) {
-        path_weights[it-dest.begin()]=dist[*it];
+    return arg;
+}
+
+/* compute vertex potentials h such that w(u,v)+h[u]-h[v]>=0 for every arc (u,v)
+ * (Bellman-Ford algorithm from a virtual source joined to all vertices by
+ * arcs of zero weight), return false if there is a negative cycle */
+bool graphe::johnson_potentials(const csr_adjacency &A,dvector &h) {
+    int n=A.node_count(),v;
+    h.assign(n,0);
+    double w;
+    bool changed;
+    for (int r=0;r<=n;++r) {
+        changed=false;
+        for (int u=0;u<n;++u) {
+            for (int k=A.arc_begin(u);k<A.arc_end(u);++k) {
+                if ((w=A.weight(k))==DBL_MAX)
+                    continue;
+                if (h[u]+w<h[v=A.head(k)]) {
+                    h[v]=h[u]+w;
+                    changed=true;
+                }
+            }
+        }
+        if (!changed)
+            return true;
     }
-    return true; // success
+    return false;
 }
 
-/* return true iff the graph has a topological ordering and output the indices
-* of thus sorted vertices in list v, use Kahn's algorithm with time complexity O(n+m) */
-bool graphe::topologic_sort(ivector &ordering) {
-    assert(is_directed() && node_stack.empty());
-    int n=node_count(),v;
-    ordering.clear();
-    ordering.reserve(n);
+/* compute the distances between all pairs of vertices in floating-point arithmetic
+ * and store them by rows in D, using edge weights if weighted=true */
+void graphe::allpairs_distance_numeric(dvector &D,bool weighted) const {
+    int n=node_count(),nt,nb,tiles,j,k;
+    D.assign(size_t(n)*n,DBL_MAX);
+    if (n==0)
+        return;
+    const csr_adjacency &A=adjacency_snapshot(weighted);
+    nt=std::min(max_threads(),n);
+    vector<apsp_thread_data> data(nt);
+    vector<void*> args(nt);
+    for (j=0;j<nt;++j) {
+        apsp_thread_data &dt=data[j];
+        dt.A=&A;
+        dt.h=NULL;
+        dt.D=&D.front();
+        dt.n=n;
+        dt.kb=dt.phase=0;
+        dt.begin=(j*n)/nt;
+        dt.end=((j+1)*n)/nt;
+        args[j]=(void *)&dt;
+    }
+    if (!weighted) {
+        run_threads(apsp_bfs_thread,args);
+        return;
+    }
+    dvector h;
+    if (8.0*A.arc_count()<double(n)*n) { // sparse graph, try Johnson's algorithm
+        bool negative=false;
+        for (k=0;k<A.arc_count() && !negative;++k) {
+            negative=A.weight(k)<0;
+        }
+        if (!negative || johnson_potentials(A,h)) {
+            for (j=0;j<nt;++j) {
+                data[j].h=negative?&h:NULL;
+            }
+            run_threads(apsp_dijkstra_thread,args);
+            return;
+        }
+    }
+    /* blocked Floyd-Warshall algorithm */
     for (int i=0;i<n;++i) {
-        if (in_degree(i)==0)
-            node_stack.push(i);
+        double *row=&D[size_t(i)*n];
+        for (k=A.arc_begin(i);k<A.arc_end(i);++k) {
+            row[A.head(k)]=A.weight(k);
+        }
+        row[i]=0;
     }
-    graphe G(ctx,false);
-    copy(G);
-    while (!node_stack.empty()) {
-        v=node_stack.top();
-        node_stack.pop();
-        ordering.push_back(v);
-        vertex &vert=G.node(v);
-        for (ivector_iter it=vert.neighbors().begin();it!=vert.neighbors().end();++it) {
-            if (G.in_degree(*it)==1)
-                node_stack.push(*it);
+    nb=(n+FW_BLOCK_SIZE-1)/FW_BLOCK_SIZE;
+    for (int kb=0;kb<nb;++kb) {
+        floyd_warshall_tile(&D.front(),n,kb,kb,kb);
+        for (int phase=1;phase<=2 && nb>1;++phase) {
+            tiles=phase==1?2*(nb-1):(nb-1)*(nb-1);
+            nt=std::min(int(data.size()),tiles);
+            args.resize(nt);
+            for (j=0;j<nt;++j) {
+                apsp_thread_data &dt=data[j];
+                dt.kb=kb;
+                dt.phase=phase;
+                dt.begin=(j*tiles)/nt;
+                dt.end=((j+1)*tiles)/nt;
+                args[j]=(void *)&dt;
+            }
+            run_threads(floyd_warshall_thread,args);
         }
-        vert.clear_neighbors();
     }
-    return G.edge_count()==0;
 }
 
-/* return true iff the graph is an arborescence, i.e. a directed tree */
-bool graphe::is_arborescence() const {
-    assert(is_directed());
-    bool has_root=false;
-    ivector deg(node_count(),0);
-    node_iter it=nodes.begin(),itend=nodes.end();
-    ivector_iter jt,jtend;
-    for (;it!=itend;++it) {
-        for (jt=it->neighbors().begin(),jtend=it->neighbors().end();jt!=jtend;++jt) {
-            ++deg[*jt];
-        }
+/*
+ * END OF ALL-PAIRS DISTANCES
+ */
+
+/*
+ * FLOW NETWORK:
+ * residual network stored in flat arrays, with the highest-label push-relabel
+ * algorithm (using the gap and global relabeling heuristics) for general
+ * capacities and Dinic's algorithm for unit capacities
+ */
+
+/* create an empty network with nv vertices */
+graphe::flow_network::flow_network(int nv) {
+    n=nv;
+    m_unit=true;
+    m_eps=0;
+    m_max_active=-1;
+}
+
+/* add an arc (i,j) with capacity cap, its reverse arc (j,i) gets capacity rcap
+ * (set rcap=cap for an undirected edge), return the index of the arc */
+int graphe::flow_network::add_arc(int i,int j,double cap,double rcap) {
+    assert(m_first.empty() && cap>=0 && rcap>=0);
+    m_tail.push_back(i);
+    m_head.push_back(j);
+    m_capacity.push_back(cap);
+    m_capacity.push_back(rcap);
+    if ((cap!=0 && cap!=1) || (rcap!=0 && rcap!=1))
+        m_unit=false;
+    return m_tail.size()-1;
+}
+
+/* arrange the arcs by their tails, must be called after adding all arcs */
+void graphe::flow_network::build() {
+    int m=m_tail.size(),i,j,a,b;
+    m_first.assign(n+1,0);
+    for (int k=0;k<m;++k) {
+        ++m_first[m_tail[k]+1];
+        ++m_first[m_head[k]+1];
     }
-    for (jt=deg.begin(),jtend=deg.end();jt!=jtend;++jt) {
-        if (*jt==0) {
-            if (has_root)
-                return false;
-            has_root=true;
-        } else if (*jt>1)
-            return false;
+    for (i=0;i<n;++i) {
+        m_first[i+1]+=m_first[i];
+    }
+    ivector pos(m_first.begin(),m_first.end()-1),head(2*m),rev(2*m);
+    dvector cap(2*m);
+    double maxcap=0,mincap=DBL_MAX,total=0;
+    bool integral=true;
+    m_position.resize(m);
+    for (int k=0;k<m;++k) {
+        i=m_tail[k];
+        j=m_head[k];
+        a=pos[i]++;
+        b=pos[j]++;
+        head[a]=j; head[b]=i;
+        rev[a]=b; rev[b]=a;
+        cap[a]=m_capacity[2*k];
+        cap[b]=m_capacity[2*k+1];
+        maxcap=std::max(maxcap,std::max(cap[a],cap[b]));
+        for (int l=0;l<2;++l) {
+            double c=l==0?cap[a]:cap[b];
+            if (c>0)
+                mincap=std::min(mincap,c);
+            if (c!=std::floor(c))
+                integral=false;
+            total+=c;
+        }
+        m_position[k]=a;
+    }
+    ivector().swap(m_tail);
+    m_head.swap(head);
+    m_reverse.swap(rev);
+    m_capacity.swap(cap);
+    /* residual capacities not above m_eps are considered zero, the flows are exact
+     * if the capacities are integers whose sum is exactly representable */
+    if (integral && total<=9007199254740992.0)
+        m_eps=0;
+    else m_eps=std::min(maxcap*1e-12,mincap/2);
+    reset();
+}
+
+/* remove the flow from the network */
+void graphe::flow_network::reset() {
+    m_residual=m_capacity;
+}
+
+/* return the flow through the k-th arc (negative if it flows in the opposite direction) */
+double graphe::flow_network::flow(int k) const {
+    int a=m_position[k];
+    return m_capacity[a]-m_residual[a];
+}
+
+/* mark the vertices reachable from s in the residual network */
+void graphe::flow_network::source_side(int s,bvector &side) const {
+    side.assign(n,false);
+    ivector queue(1,s);
+    side[s]=true;
+    int v,w;
+    for (int q=0;q<int(queue.size());++q) {
+        v=queue[q];
+        for (int a=m_first[v];a<m_first[v+1];++a) {
+            if (m_residual[a]>m_eps && !side[w=m_head[a]]) {
+                side[w]=true;
+                queue.push_back(w);
+            }
+        }
+    }
+}
+
+/* put v into the bucket of active vertices with its label */
+void graphe::flow_network::activate(int v) {
+    int d=m_label[v];
+    m_active[d].push_back(v);
+    if (d>m_max_active)
+        m_max_active=d;
+}
+
+/* set the labels to the exact distances to the sink t in the residual network,
+ * then collect the active vertices */
+void graphe::flow_network::global_relabel(int s,int t) {
+    std::fill(m_label.begin(),m_label.end(),n);
+    std::fill(m_count.begin(),m_count.end(),0);
+    m_label[t]=0;
+    ivector queue(1,t);
+    int v,u,d;
+    for (int q=0;q<int(queue.size());++q) {
+        v=queue[q];
+        d=m_label[v]+1;
+        ++m_count[d-1];
+        for (int a=m_first[v];a<m_first[v+1];++a) {
+            u=m_head[a];
+            if (u!=s && m_label[u]==n && m_residual[m_reverse[a]]>m_eps) {
+                m_label[u]=d;
+                queue.push_back(u);
+            }
+        }
+    }
+    for (d=0;d<=m_max_active;++d) {
+        m_active[d].clear();
+    }
+    m_max_active=-1;
+    for (v=0;v<n;++v) {
+        m_current[v]=m_first[v];
+        if (v!=s && v!=t && m_label[v]<n && m_excess[v]>m_eps)
+            activate(v);
+    }
+}
+
+/* no vertex has label k, hence the vertices with larger labels cannot reach the sink */
+void graphe::flow_network::gap(int k) {
+    for (int v=0;v<n;++v) {
+        if (m_label[v]>k && m_label[v]<n) {
+            --m_count[m_label[v]];
+            m_label[v]=n;
+        }
+    }
+    for (int d=k;d<=m_max_active;++d) {
+        m_active[d].clear();
+    }
+    m_max_active=k-1;
+}
+
+/* push the excess of the active vertex v to its neighbors, relabeling v when necessary */
+void graphe::flow_network::discharge(int v,int s,int t,long &work) {
+    int a,w,d,old,aend=m_first[v+1];
+    double delta;
+    bool inactive;
+    while (m_excess[v]>m_eps) {
+        if (m_current[v]==aend) {
+            /* relabel v */
+            old=m_label[v];
+            d=n;
+            for (a=m_first[v];a<aend;++a) {
+                if (m_residual[a]>m_eps && m_label[m_head[a]]<d)
+                    d=m_label[m_head[a]];
+            }
+            work+=aend-m_first[v]+12;
+            if (--m_count[old]==0) {
+                m_label[v]=n;
+                gap(old);
+                return;
+            }
+            m_label[v]=std::min(d+1,n);
+            if (m_label[v]==n)
+                return;
+            ++m_count[m_label[v]];
+            m_current[v]=m_first[v];
+            continue;
+        }
+        a=m_current[v];
+        w=m_head[a];
+        if (m_residual[a]>m_eps && m_label[v]==m_label[w]+1) {
+            delta=std::min(m_excess[v],m_residual[a]);
+            inactive=m_excess[w]<=m_eps;
+            m_residual[a]-=delta;
+            m_residual[m_reverse[a]]+=delta;
+            m_excess[v]-=delta;
+            m_excess[w]+=delta;
+            if (inactive && w!=s && w!=t)
+                activate(w);
+            if (m_residual[a]<=m_eps)
+                ++m_current[v];
+        } else ++m_current[v];
+    }
+}
+
+/* turn the maximum preflow into a flow by returning the excess stuck in the
+ * vertices which cannot reach the sink t back to the source s */
+void graphe::flow_network::return_excess(int s,int t) {
+    std::queue<int> Q;
+    int v,w,a,d,aend;
+    double delta;
+    /* label the vertices by their distances to s in the residual network */
+    std::fill(m_label.begin(),m_label.end(),-1);
+    m_label[s]=0;
+    ivector queue(1,s);
+    for (int q=0;q<int(queue.size());++q) {
+        v=queue[q];
+        for (a=m_first[v];a<m_first[v+1];++a) {
+            w=m_head[a];
+            if (w!=t && m_label[w]<0 && m_residual[m_reverse[a]]>m_eps) {
+                m_label[w]=m_label[v]+1;
+                queue.push_back(w);
+            }
+        }
+    }
+    for (v=0;v<n;++v) {
+        m_current[v]=m_first[v];
+        if (v!=s && v!=t && m_excess[v]>m_eps)
+            Q.push(v);
+    }
+    /* FIFO push-relabel towards the source */
+    while (!Q.empty()) {
+        v=Q.front();
+        Q.pop();
+        aend=m_first[v+1];
+        while (m_excess[v]>m_eps) {
+            if (m_current[v]==aend) {
+                d=-1;
+                for (a=m_first[v];a<aend;++a) {
+                    w=m_head[a];
+                    if (w!=t && m_residual[a]>m_eps && m_label[w]>=0 && (d<0 || m_label[w]<d))
+                        d=m_label[w];
+                }
+                if (d<0) { // only a rounding residue is left
+                    m_excess[v]=0;
+                    break;
+                }
+                m_label[v]=d+1;
+                m_current[v]=m_first[v];
+                continue;
+            }
+            a=m_current[v];
+            w=m_head[a];
+            if (w!=t && m_residual[a]>m_eps && m_label[w]>=0 && m_label[v]==m_label[w]+1) {
+                delta=std::min(m_excess[v],m_residual[a]);
+                if (w!=s && m_excess[w]<=m_eps)
+                    Q.push(w);
+                m_residual[a]-=delta;
+                m_residual[m_reverse[a]]+=delta;
+                m_excess[v]-=delta;
+                m_excess[w]+=delta;
+                if (m_residual[a]<=m_eps)
+                    ++m_current[v];
+            } else ++m_current[v];
+        }
     }
-    return has_root;
 }
 
-/* write this (directed) graph with arc directions reversed to G */
-void graphe::reverse(graphe &G) const {
-    assert(is_directed());
-    G.set_directed(true);
-    G.reserve_nodes(node_count());
-    int i;
-    node_iter it,itend;
-    ivector_iter jt,jtend;
-    if (supports_attributes()) {
-        G.set_graph_attributes(attributes);
-        for (it=nodes.begin(),itend=nodes.end();it!=itend;++it) {
-            G.add_node(it->label(),it->attributes());
+/* return the value of the maximum flow from s to t computed by the highest-label
+ * push-relabel algorithm, the flow is stored in the network */
+double graphe::flow_network::push_relabel(int s,int t) {
+    assert(!m_first.empty());
+    reset();
+    if (s==t)
+        return 0;
+    m_label.resize(n);
+    m_current.resize(n);
+    m_count.resize(n+1);
+    m_excess.assign(n,0);
+    m_active.resize(n+1);
+    for (int d=0;d<=n;++d) {
+        m_active[d].clear();
+    }
+    m_max_active=n;
+    /* saturate the arcs leaving the source */
+    double delta;
+    for (int a=m_first[s];a<m_first[s+1];++a) {
+        if ((delta=m_residual[a])>0) {
+            m_residual[a]=0;
+            m_residual[m_reverse[a]]+=delta;
+            m_excess[m_head[a]]+=delta;
+        }
+    }
+    global_relabel(s,t);
+    long work=0,threshold=6*(long)n+(long)m_head.size();
+    int v,d;
+    while (m_max_active>=0) {
+        ivector &bucket=m_active[d=m_max_active];
+        if (bucket.empty()) {
+            --m_max_active;
+            continue;
         }
-    } else G.add_nodes(node_count());
-    for (it=nodes.begin(),itend=nodes.end(),i=0;it!=itend;++it,++i) {
-        for (jt=it->neighbors().begin(),jtend=it->neighbors().end();jt!=jtend;++jt) {
-            if (supports_attributes())
-                G.add_edge(*jt,i,it->neighbor_attributes(*jt));
-            else G.add_edge(*jt,i);
+        v=bucket.back();
+        bucket.pop_back();
+        if (m_label[v]!=d || m_excess[v]<=m_eps)
+            continue; // stale entry
+        discharge(v,s,t,work);
+        if (work>threshold) {
+            work=0;
+            global_relabel(s,t);
         }
     }
+    double value=m_excess[t];
+    return_excess(s,t);
+    return value;
 }
 
-/* write a spanning tree of this graph with i-th node as root to T, time complexity O(n+m) */
-void graphe::spanning_tree(int i,graphe &T,int sg) {
-    T.clear();
-    vecteur V=vertices(sg);
-    T.reserve_nodes(V.size());
-    T.add_nodes(V);
-    ivector indices(V.size());
-    int v,p;
-    if (sg>=0) {
-        const_iterateur vt=V.begin(),vtend=V.end();
-        for (v=0;vt!=vtend;++vt,++v) {
-            indices[v]=node_index(*vt);
+/* compute the BFS levels from s in the residual network, return true iff t is reachable */
+bool graphe::flow_network::dinic_levels(int s,int t) {
+    std::fill(m_label.begin(),m_label.end(),-1);
+    m_label[s]=0;
+    ivector queue(1,s);
+    int v,w;
+    for (int q=0;q<int(queue.size()) && m_label[t]<0;++q) {
+        v=queue[q];
+        for (int a=m_first[v];a<m_first[v+1];++a) {
+            if (m_residual[a]>m_eps && m_label[w=m_head[a]]<0) {
+                m_label[w]=m_label[v]+1;
+                queue.push_back(w);
+            }
         }
     }
-    dfs(i,false,true,NULL,sg);
-    node_iter it=nodes.begin(),itend=nodes.end();
-    for (v=0;it!=itend;++it,++v) {
-        if (sg>=0 && it->subgraph()!=sg)
-            continue;
-        if ((p=it->ancestor())>=0) {
-            if (sg>=0)
-                T.add_edge(indices[v],indices[p]);
-            else
-                T.add_edge(v,p);
-        }
+    for (v=0;v<n;++v) {
+        m_current[v]=m_first[v];
     }
+    return m_label[t]>=0;
 }
 
-/* write the minimal spanning tree of this graph to T,
-* use Kruskal's algorithm with time complexity O(m*log(n)) */
-void graphe::minimal_spanning_tree(graphe &T,int sg) {
-    assert(!is_directed() && is_weighted());
-    ipairs E,res;
-    get_edges_as_pairs(E,sg);
-    edges_comparator comp(this);
-    std::sort(E.begin(),E.end(),comp);
-    int v,u;
-    unionfind ds(node_count());
-    for (ipairs_iter it=E.begin();it!=E.end();++it) {
-        ds.make_set(it->first);
-        ds.make_set(it->second);
-    }
-    for (ipairs_iter it=E.begin();it!=E.end();++it) {
-        u=it->first;
-        v=it->second;
-        if (ds.find(u)!=ds.find(v)) {
-            res.push_back(*it);
-            ds.unite(u,v);
-        }
-    }
-    extract_subgraph(res,T);
-}
-
-/* Tarjan's offline algorithm for the lowest common ancestor, time complexity O(n) */
-void graphe::lca_recursion(int u,const ipairs &p,ivector &lca,unionfind &ds) {
-    ds.make_set(u);
-    vertex &U=node(u);
-    U.set_ancestor(u);
-    U.set_visited(true);
-    int v;
-    for (ivector_iter it=U.neighbors().begin();it!=U.neighbors().end();++it) {
-        v=*it;
-        vertex &V=node(v);
-        if (V.is_visited())
-            continue;
-        lca_recursion(v,p,lca,ds);
-        ds.unite(u,v);
-        node(ds.find(u)).set_ancestor(u);
-    }
-    U.set_color(1); // black
-    node_iter it=nodes.begin(),itend=nodes.end();
-    ipairs_iter jt,jtend;
-    for (v=0;it!=itend;++it,++v) {
-        if (u==v)
+/* find a blocking flow in the level graph by iterative DFS, return its value */
+double graphe::flow_network::dinic_augment(int s,int t) {
+    ivector path;
+    double total=0,delta;
+    int v=s,a,w,k;
+    while (true) {
+        if (v==t) {
+            /* augment along the path */
+            delta=DBL_MAX;
+            for (ivector_iter it=path.begin();it!=path.end();++it) {
+                delta=std::min(delta,m_residual[*it]);
+            }
+            for (ivector_iter it=path.begin();it!=path.end();++it) {
+                m_residual[*it]-=delta;
+                m_residual[m_reverse[*it]]+=delta;
+            }
+            total+=delta;
+            /* retreat to the tail of the first saturated arc */
+            for (k=0;m_residual[path[k]]>m_eps;++k);
+            path.resize(k);
+            v=k==0?s:m_head[path.back()];
             continue;
-        for (jt=p.begin(),jtend=p.end();jt!=jtend;++jt) {
-            if ((jt->first==u && jt->second==v) || (jt->first==v && jt->second==u)) {
-                if (it->color()==1)
-                    lca[jt-p.begin()]=node(ds.find(v)).ancestor();
+        }
+        for (a=m_current[v];a<m_first[v+1];++a) {
+            w=m_head[a];
+            if (m_residual[a]>m_eps && m_label[w]==m_label[v]+1)
                 break;
-            }
+        }
+        m_current[v]=a;
+        if (a<m_first[v+1]) {
+            path.push_back(a);
+            v=w;
+        } else {
+            /* dead end, remove v from the level graph */
+            if (v==s)
+                break;
+            m_label[v]=-2;
+            a=path.back();
+            path.pop_back();
+            v=m_head[m_reverse[a]];
+            ++m_current[v];
         }
     }
+    return total;
 }
 
-/* find the lowest common ancestors for all pairs of vertices in p (this must be a tree) */
-void graphe::lowest_common_ancestors(int root,const ipairs &p,ivector &lca) {
-    unvisit_all_nodes();
-    unset_all_ancestors();
-    uncolor_all_nodes();
-    lca.resize(p.size(),-1);
-    unionfind ds(node_count());
-    lca_recursion(root,p,lca,ds);
-    assert(find(lca.begin(),lca.end(),-1)==lca.end());
-}
-
-/* return the lowest common ancestor of i-th node and j-th node of this tree */
-int graphe::lowest_common_ancestor(int i,int j,int root) {
-    ipairs p;
-    p.push_back(make_pair(i,j));
-    ivector lca;
-    lowest_common_ancestors(root,p,lca);
-    return lca.front();
-}
-
-/* return true iff v is a descendant of anc wrt the last dfs traversal */
-bool graphe::is_descendant(int v,int anc) const {
-    int i=v;
-    while ((i=node(i).ancestor())>=0) {
-        if (i==anc)
-            return true;
+/* return the value of the maximum flow from s to t computed by Dinic's algorithm,
+ * the flow is stored in the network */
+double graphe::flow_network::dinic(int s,int t) {
+    assert(!m_first.empty());
+    reset();
+    if (s==t)
+        return 0;
+    m_label.resize(n);
+    m_current.resize(n);
+    double value=0;
+    while (dinic_levels(s,t)) {
+        value+=dinic_augment(s,t);
     }
-    return false;
+    return value;
 }
 
-void graphe::st_numbering_dfs(int i,ivector &preorder) {
-    vertex &v=node(i);
-    v.set_disc(++disc_time);
-    v.set_low(i);
-    int j;
-    for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-        vertex &w=node(j=*it);
-        if (w.disc()==0) {
-            st_numbering_dfs(j,preorder);
-            w.set_ancestor(i);
-            preorder.push_back(j);
-            if (node(w.low()).disc()<node(v.low()).disc())
-                v.set_low(w.low());
-        } else if (w.disc()!=0 && w.disc()<node(v.low()).disc())
-            v.set_low(*it);
-    }
-}
+/*
+ * END OF FLOW NETWORK
+ */
 
-/* find st-numbering using Tarjan's algorithm (1986), time complexity O(n+m) */
-void graphe::compute_st_numbering(int s,int t) {
-    /* assuming that the graph is biconnected */
-    assert(has_edge(s,t) && node_stack.empty());
-    int n=node_count(),i;
+/* make planar layout */
+bool graphe::make_planar_layout(layout &x,double *score) {
+    int n=node_count(),of,m;
     for (vector<vertex>::iterator it=nodes.begin();it!=nodes.end();++it) {
-        it->set_disc(0);
-    }
-    disc_time=1;
-    node(s).set_disc(1);
-    ivector preorder,L;
-    st_numbering_dfs(t,preorder);
-    L.push_back(s);
-    L.push_back(t);
-    bvector sign(n);
-    ivector::iterator lit;
-    bool sign_plus=true,sign_minus=false;
-    sign[s]=sign_minus;
-    for (ivector::const_reverse_iterator it=preorder.rbegin();it!=preorder.rend();++it) {
-        vertex &v=node(*it);
-        lit=find(L.begin(),L.end(),v.ancestor());
-        assert(lit!=L.end());
-        if (sign[v.low()]==sign_minus) {
-            L.insert(lit,*it);
-            sign[v.ancestor()]=sign_plus;
-        } else if (sign[v.low()]==sign_plus) {
-            L.insert(lit+1,*it);
-            sign[v.ancestor()]=sign_minus;
-        }
+        it->clear_edge_faces();
     }
-    i=0;
-    for (ivector_iter it=L.begin();it!=L.end();++it) {
-        node(*it).set_number(++i);
+    ivectors faces;
+    /* create the faces (adding temporary edges if necessary),
+ * return the index of the outer face */
+    int ec=edge_count();
+    of=planar_embedding(faces);
+    if (of<0)
+        return false; // the graph is not planar
+    /* subdivide the concave faces */
+    augment(faces,of,false);
+    bool is_3conn=edge_count()==ec; // no temporary edges were added
+    const ivector &outer_face=faces[of];
+    m=outer_face.size();
+    /* create a fake outer face */
+    ivector fake_outer_face(m);
+    int label=largest_integer_label();
+    for (ivector_iter it=outer_face.begin();it!=outer_face.end();++it) {
+        add_temporary_edge(*it,fake_outer_face[it-outer_face.begin()]=add_node(++label));
     }
+    make_tutte_layout(x,fake_outer_face); // create the layout
+    /* remove temporary vertices and edges */
+    if (score!=NULL && !is_3conn) { // compute the ratio of the largest to smallest face
+        double fa_min=DBL_MAX,fa_max=0;
+        ivectors_iter it=faces.begin();
+        for (;it!=faces.end();++it) {
+            if (int(it-faces.begin())==of)
+                continue; // skip the outer face since its area is infinitely large
+            int fs=it->size(),i=0;
+            for (;i<fs && !is_temporary_edge(it->at(i),it->at((i+1)%fs));++i);
+            if (i==fs) {
+                layout fl(fs);
+                for (i=0;i<fs;++i) fl[i]=x[it->at(i)];
+                double a=poly_area(fl);
+                if (a<fa_min) fa_min=a;
+                if (a>fa_max) fa_max=a;
+            }
+        }
+        *score=fa_min==0?DBL_MAX:fa_max/fa_min;
+    } else if (score!=NULL) *score=0;
+    remove_temporary_edges();
+    while (node_count()>n) nodes.pop_back();
+    invalidate_adjacency_snapshot();
+    invalidate_label_index();
+    x.resize(n);
+    return true;
 }
 
-/* return st-numbering in form of vecteur */
-vecteur graphe::get_st_numbering() const {
-    /* assuming that st numbering has been computed */
-    vecteur st(node_count());
-    int ofs=1-array_start(ctx);
-    for (iterateur it=st.begin();it!=st.end();++it) {
-        *it=node(it-st.begin()).number()-ofs;
+bool graphe::make_best_planar_layout(layout &x,int iter) {
+    assert(iter>0);
+    double s,min_s=-1;
+    for (int i=0;i<iter;++i) {
+        layout y;
+        if (!make_planar_layout(y,&s))
+            return false;
+        if (s==0) { // the graph is 3-connected
+            x=y;
+            break;
+        }
+        if (min_s<0 || s<min_s) {
+            min_s=s;
+            x=y;
+        }
     }
-    return st;
+    return true;
 }
 
-/* assign directions to edges according to the st-numbering */
-void graphe::assign_edge_directions_from_st() {
-    bool isweighted=is_weighted();
-    matrice W;
-    if (isweighted)
-        weight_matrix(W);
-    ipairs E;
-    get_edges_as_pairs(E);
-    for (ipairs_iter it=E.begin();it!=E.end();++it) {
-        discard_edge_attribute(it->first,it->second,_GT_ATTRIB_WEIGHT);
+/* get the convex hull of 2D graph layout */
+void graphe::convex_hull(const layout &x,layout &hull) {
+    vecteur v(x.size());
+    for (iterateur it=v.begin();it!=v.end();++it) {
+        const point &p=x[it-v.begin()];
+        *it=makecomplex(p.front(),p.back());
     }
-    set_weighted(false);
-    set_directed(true);
-    for (vector<vertex>::iterator it=nodes.begin();it!=nodes.end();++it) {
-        vertex &v=*it;
-        ivector ngh=v.neighbors();
-        for (ivector_iter jt=ngh.begin();jt!=ngh.end();++jt) {
-            const vertex &w=node(*jt);
-            if (v.number()>w.number())
-                v.remove_neighbor(*jt);
-        }
+    vecteur h=*_convexhull(v,ctx)._VECTptr;
+    hull.resize(h.size());
+    for (const_iterateur it=h.begin();it!=h.end();++it) {
+        point &p=hull[it-h.begin()];
+        p.resize(2);
+        p.front()=to_real_number(*it->_CPLXptr,ctx).to_double(ctx);
+        p.back()=to_real_number(*(it->_CPLXptr+1),ctx).to_double(ctx);
     }
-    if (isweighted)
-        make_weighted(W);
 }
 
-void graphe::strec(int i,int t,int counter,int np,iset &Q,vecteur &timestamp,vecteur &l) {
-    bool isweighted=is_weighted();
-    ++counter;
-    vertex &v=node(i);
-    v.set_number(counter);
-    gen w(1);
-    for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-        if (node(*it).subgraph()!=0)
-            continue;
-        if (*it!=t)
-            Q.insert(*it);
-        if (isweighted)
-            get_edge_attribute(i,*it,_GT_ATTRIB_WEIGHT,w);
-        if (is_strictly_greater(l[i]+w,l[*it],ctx))
-            l[*it]=l[i]+w;
-        timestamp[*it]=isweighted?l[*it]:gen(counter);
-    }
-    Q.erase(i);
-    v.set_subgraph(1);
-    if (Q.empty()) {
-        node(t).set_number(node_count());
-        return;
+/* rotate layout x such that left to right symmetry is exposed */
+void graphe::layout_best_rotation(layout &x) {
+    /* center layout in the origin */
+    point center=layout_center(x);
+    scale_point(center,-1);
+    translate_layout(x,center);
+    layout hull;
+    convex_hull(x,hull);
+    int n=hull.size();
+    /* compute the hull perimeter */
+    double perim=0,score,maxscore=-1;
+    point tmp(2),mp(2),rp(2),rq(2),origin(2,0.0),proj(2);
+    for (int i=0;i<n;++i) {
+        const point &p=hull[i],&q=hull[(i+1)%n];
+        perim+=point_distance(p,q,tmp);
     }
-    /* update blocks */
-    vector<iset> B;
-    vector<ipairs> blocks;
-    find_blocks(blocks,0);
-    int nb=blocks.size();
-    B.resize(nb);
-    for (vector<ipairs>::const_iterator it=blocks.begin();it!=blocks.end();++it) {
-        iset &b=B[it-blocks.begin()];
-        for (ipairs_iter jt=it->begin();jt!=it->end();++jt) {
-            b.insert(jt->first);
-            b.insert(jt->second);
-        }
-    }
-    iset df;
-    bool has_root=false;
-    if (nb>1) { // G-v is not biconnected
-        ivector cv;
-        find_cut_vertices(cv,0);
-        for (int k=nb;k-->0;) {
-            iset &b=B[k];
-            if (!has_root && b.find(t)!=b.end()) { // root block, delete it
-                B.erase(B.begin()+k);
-                has_root=true;
+    double a,b,c,d,tol,angle=0,half_perim=perim/2.0;
+    bvector matched(hull.size());
+    for (int i=0;i<n;++i) {
+        const point &p=hull[i];
+        for (int j=i+1;j<n;++j) {
+            const point &q=hull[j];
+            if (!point2segment_projection(origin,p,q,proj))
+                continue;
+            /* obtain the perpendicular bisector ax+by+c=0 of the segment pq */
+            copy_point(p,mp);
+            add_point(mp,q);
+            scale_point(mp,0.5);
+            if (p.front()==q.front()) {
+                a=1;
+                c=-mp.front();
+                b=0;
             } else {
-                sets_intersection(cv,b,df);
-                if (df.size()!=1) // non-leaf tree node, delete it
-                    B.erase(B.begin()+k);
-                else b.erase(*df.begin()); // b is leaf node, detach it
+                a=(p.back()-q.back())/(p.front()-q.front());
+                b=-1;
+                c=mp.back()-a*mp.front();
             }
-        }
-    }
-    /* recurse */
-    for (vector<iset>::const_iterator it=B.begin();it!=B.end();++it) {
-        sets_intersection(*it,Q,df);
-        if (df.empty()) continue;
-        gen_map m;
-        gen ts,max_ts(undef),min_ts(undef);
-        for (iset_iter jt=df.begin();jt!=df.end();++jt) {
-            ts=timestamp[*jt];
-            max_ts=is_undef(max_ts)?ts:_max(makevecteur(max_ts,ts),ctx);
-            min_ts=is_undef(min_ts)?ts:_min(makevecteur(min_ts,ts),ctx);
-            if (m.find(ts)==m.end())
-                m[ts]=vecteur(1,*jt);
-            else m[ts]._VECTptr->push_back(*jt);
-        }
-        const vecteur &cand=*m[counter<=np?max_ts:min_ts]._VECTptr;
-        int choice=(cand.size()==1?cand.front():cand[rand_integer(cand.size())]).val;
-        strec(choice,t,counter,np,Q,timestamp,l);
-    }
-}
-
-/* impose parametrized st-orientation on this graph with parameter p in [0,1] */
-void graphe::parametrized_st_orientation(int s,int t,double p) {
-    assert(p>=0 && p<=1);
-    int n=node_count(),counter=0,np=(int)(n*p);
-    vecteur timestamp(n,0),l(n,0);
-    iset Q;
-    Q.insert(s);
-    unset_subgraphs(0);
-    strec(s,t,counter,np,Q,timestamp,l);
-    unset_subgraphs();
-}
-
-/* greedy vertex coloring algorithm due to Biggs, also records vertex inclusion time */
-void graphe::greedy_vertex_coloring_biggs(ivector &ordering) {
-    uncolor_all_nodes();
-    int n=node_count(),k=0,i,maxdeg,d,col=0;
-    ordering.resize(n);
-    ivector_iter jt;
-    node_iter it,itend;
-    while (k<n) {
-        ++col;
-        do {
-            maxdeg=-1;
-            i=-1;
-            for (it=nodes.begin(),itend=nodes.end();it!=itend;++it) {
-                if (it->color()>0)
+            /* try to match hull edges that are reflections of each other */
+            score=0;
+            std::fill(matched.begin(),matched.end(),false);
+            for (layout_iter it=hull.begin();it!=hull.end();++it) {
+                if (matched[it-hull.begin()])
                     continue;
-                for (jt=it->neighbors().begin();jt!=it->neighbors().end();++jt) {
-                    if (node(*jt).color()==col)
-                        break;
-                }
-                if (jt==it->neighbors().end() && (maxdeg<0 || (d=it->neighbors().size())>maxdeg)) {
-                    maxdeg=d;
-                    i=it-nodes.begin();
+                const point &p1=*it,&q1=it+1==hull.end()?hull.front():*(it+1);
+                tol=(d=point_distance(p1,q1,tmp))*MARGIN_FACTOR/2.0;
+                point_mirror(a,b,c,p1,rp);
+                point_mirror(a,b,c,q1,rq);
+                for (layout_iter jt=it;jt!=hull.end();++jt) {
+                    if (matched[jt-hull.begin()])
+                        continue;
+                    const point &p2=*jt,&q2=jt+1==hull.end()?hull.front():*(jt+1);
+                    if ((points_coincide(rp,p2,tol) && points_coincide(rq,q2,tol)) ||
+                            (points_coincide(rp,q2,tol) && points_coincide(rq,p2,tol))) {
+                        score+=d;
+                        matched[it-hull.begin()]=true;
+                        matched[jt-hull.begin()]=true;
+                    }
                 }
             }
-            if (i>=0) {
-                node(i).set_color(col);
-                ordering[k++]=i;
+            score/=half_perim;
+            double bigpart=std::pow(PLASTIC_NUMBER,4); // hull symmetry is more important
+            score*=bigpart;
+            score+=1.0-point_distance(proj,mp,tmp)/point_distance(p,q,tmp);
+            score/=bigpart+1;
+            if (score>maxscore) {
+                maxscore=score;
+                angle=a==0?M_PI_2:std::atan(b/a);
             }
-        } while (i>=0);
+        }
     }
+    rotate_layout(x,M_PI_2-angle);
+    rectangle rect=layout_bounding_rect(x);
+    if (rect.y()+rect.height()/2.0<0)
+        rotate_layout(x,M_PI);
 }
 
-/* classical greedy vertex coloring algorithm, time complexity O(n+m) */
-int graphe::greedy_vertex_coloring(const ivector &p) {
-    if (is_directed()) {
-        graphe G(ctx,false);
-        underlying(G);
-        return G.greedy_vertex_coloring(p);
-    }
-    uncolor_all_nodes();
-    int c=0,k;
-    std::set<int> used;
-    for (ivector_iter it=p.begin();it!=p.end();++it) {
-        vertex &v=node(*it);
-        if (c==0) {
-            v.set_color(++c);
-            continue;
-        }
-        used.clear();
-        for (ivector_iter jt=v.neighbors().begin();jt!=v.neighbors().end();++jt) {
-            vertex &v=node(*jt);
-            if (v.color()>0)
-                used.insert(v.color());
-        }
-        k=1;
-        for (std::set<int>::const_iterator jt=used.begin();jt!=used.end();++jt) {
-            if (*jt>k)
-                break;
-            ++k;
-        }
-        v.set_color(k);
-        if (k>c)
-            c=k;
+/* return true iff the degrees of vertices in v all coincide */
+bool graphe::degrees_equal(const ivector &v,int deg) const {
+    int D=deg,d;
+    for (ivector_iter it=v.begin();it!=v.end();++it) {
+        d=degree(*it);
+        if (D==0)
+            D=d;
+        else if (d!=D)
+            return false;
     }
-    return c;
+
+    return true;
 }
 
-/* get color of the i-th node, either as attribute or from vertex */
-int graphe::get_node_color(int i) const {
-    int c;
-    const vertex &v=node(i);
-    attrib_iter it;
-    if (supports_attributes()) {
-        c=default_vertex_color;
-        if ((it=v.attributes().find(_GT_ATTRIB_COLOR))!=v.attributes().end()) {
-            c=it->second.val;
-        }
-    } else c=v.color();
-    return c;
+/* customize the Giac display */
+gen graphe::customize_display(int options) {
+    return symb_equal(at_display,change_subtype(options,_INT_COLOR));
 }
 
-/* extract colors of the vertices and return them in order */
-void graphe::get_node_colors(ivector &colors) const {
-    colors.resize(node_count());
-    node_iter it=nodes.begin(),itend=nodes.end();
-    ivector::iterator jt=colors.begin();
-    for (;it!=itend;++it,++jt) {
-        *jt=it->color();
-    }
+/* append the line segment [p,q] to vecteur v */
+void graphe::append_segment(vecteur &drawing,const point &p,const point &q,int color,int width,int style,bool arrow) const {
+    vecteur attributs(1,color | width | style);
+    vecteur seg=p.size()==2?
+                makevecteur(makecomplex(p[0],p[1]),makecomplex(q[0],q[1]))
+            : makevecteur(gen(makevecteur(p[0],p[1],p[2]),_POINT__VECT),gen(makevecteur(q[0],q[1],q[2]),_POINT__VECT));
+    drawing.push_back(pnt_attrib(gen(seg,arrow?_VECTOR__VECT:_GROUP__VECT),attributs,ctx));
 }
 
-/* return true iff the graph is bipartite, time complexity O(n+m) */
-bool graphe::is_bipartite(ivector &V1,ivector &V2,int sg,gt_conn_check cc) {
-    assert(node_queue.empty());
-    int s,cmp;
-    switch (cc) {
-    case _GT_CC_CONNECTED:
-        break;
-    case _GT_CC_COMPONENTS_ARE_SUBGRAPHS:
-    case _GT_CC_FIND_COMPONENTS:
-        if (is_directed()) {
-            graphe G(ctx,false);
-            underlying(G);
-            return G.is_bipartite(V1,V2,sg,cc);
+/* append the vertex (as a circle) to vecteur v */
+void graphe::append_node(vecteur &drawing,const point &p,int color,int width,int shape) const {
+    gen P=point2gen(p,true),args;
+    args=makesequence(P,customize_display(color | width | shape));
+    drawing.push_back(_point(args,ctx));
+}
+
+/* append label to vecteur v at the specified quadrant */
+void graphe::append_label(vecteur &drawing,const point &p,const gen &label,int quadrant,int color) const {
+    gen P=point2gen(p),args=makesequence(P,label,customize_display(quadrant | color));
+    drawing.push_back(_legende(args,ctx));
+}
+
+/* convert gen to point coordinates */
+bool graphe::gen2point(const gen &g,point &p,GIAC_CONTEXT) {
+    if (g.type==_VECT || g.is_symb_of_sommet(at_point)) {
+        const vecteur &v=g.type==_VECT?*g._VECTptr:*g._SYMBptr->feuille._VECTptr;
+        p.resize(v.size());
+        for (const_iterateur it=v.begin();it!=v.end();++it) {
+            if (!is_real_number(*it,contextptr))
+                return false;
+            p[it-v.begin()]=to_real_number(*it,contextptr).to_double(contextptr);
         }
-        V1.clear(); V1.reserve(node_count());
-        V2.clear(); V2.reserve(node_count());
-        s=(cc==_GT_CC_COMPONENTS_ARE_SUBGRAPHS || sg<0)?1:1+max_subgraph_index();
-        cmp=(cc==_GT_CC_FIND_COMPONENTS)?connected_components_to_subgraphs(sg):max_subgraph_index();
-        for (;s<=cmp;++s) {
-            if (!is_bipartite(V1,V2,s,_GT_CC_CONNECTED))
+    } else { /* assuming that pos is a complex number */
+        p.resize(2);
+        if (g.type==_CPLX) {
+            gen &real=*g._CPLXptr,&imag=*(g._CPLXptr+1);
+            if (!is_real_number(real,contextptr) || !is_real_number(imag,contextptr))
                 return false;
-            if (cc==_GT_CC_FIND_COMPONENTS)
-                renumber_subgraph(s,sg);
+            p.front()=to_real_number(real,contextptr).to_double(contextptr);
+            p.back()=to_real_number(imag,contextptr).to_double(contextptr);
+        } else {
+            if (!is_real_number(g,contextptr))
+                return false;
+            p.front()=to_real_number(g,contextptr).to_double(contextptr);
+            p.back()=0;
         }
-        return true;
-    default: assert(false);
-    }
-    // sg >= 0
-    uncolor_all_nodes(-1,sg);
-    int i=first_vertex_from_subgraph(sg);
-    assert(i>=0);
-    node(i).set_color(1);
-    node_queue.push(i);
-    ivector_iter it,itend;
-    while (!node_queue.empty()) {
-        i=node_queue.front();
-        node_queue.pop();
-        vertex &v=node(i);
-        for (it=v.neighbors().begin(),itend=v.neighbors().end();it!=itend;++it) {
-            vertex &w=node(*it);
-            if (sg>=0 && w.subgraph()!=sg)
-                continue;
-            if (w.color()==-1) {
-                w.set_color(1-v.color());
-                node_queue.push(*it);
-            } else if (w.color()==v.color()) {
-                clear_node_queue();
-                return false;
-            }
-        }
-    }
-    node_iter nt=nodes.begin(),ntend=nodes.end();
-    for (i=0;nt!=ntend;++nt,++i) {
-        if (sg>=0 && nt->subgraph()!=sg)
-            continue;
-        if (nt->color()==1)
-            V1.push_back(i);
-        else V2.push_back(i);
     }
     return true;
 }
 
-/* place vertices from partitions v1 and v2 on two parallel lines */
-void graphe::make_bipartite_layout(layout &x,const ivector &p1,const ivector &p2) {
-    double aspect_ratio;
-    int n1=p1.size(),n2=p2.size(),n=std::max(n1,n2);
-    assert(n1>1 && n2>1);
-    if (n<3)
-        aspect_ratio=1.0;
-    else if (n<5)
-        aspect_ratio=PLASTIC_NUMBER;
-    else if (n<8)
-        aspect_ratio=PLASTIC_NUMBER_2;
-    else
-        aspect_ratio=PLASTIC_NUMBER_3;
-    double step1=aspect_ratio/(double)(n1-1),step2=aspect_ratio/(double)(n2-1),xpos=0.0,ypos=1.0;
-    x.resize(node_count());
-    for (ivector_iter it=p1.begin();it!=p1.end();++it) {
-        point &p=x[*it];
-        p.resize(2);
-        p.front()=xpos;
-        p.back()=ypos;
-        xpos+=step1;
-    }
-    xpos=ypos=0.0;
-    for (ivector_iter it=p2.begin();it!=p2.end();++it) {
-        point &p=x[*it];
-        p.resize(2);
-        p.front()=xpos;
-        p.back()=ypos;
-        xpos+=step2;
-    }
+/* extract position attribute from attr */
+bool graphe::get_node_position(const attrib &attr,point &p,GIAC_CONTEXT) {
+    attrib_iter it=attr.find(_GT_ATTRIB_POSITION);
+    if (it==attr.end())
+        return false;
+    return gen2point(it->second,p,contextptr);
 }
 
-/* construct the plane dual of a planar graph with the given faces with time complexity O(n),
-* each face must be a list of vertex indices */
-void graphe::make_plane_dual(const ivectors &faces) {
-    this->clear();
-    set_directed(false);
-    reserve_nodes(faces.size());
-    if (supports_attributes()) {
-        vecteur labels;
-        make_default_labels(labels,faces.size());
-        add_nodes(labels);
-    } else add_nodes(faces.size());
-    int nc=0;
-    for (ivectors_iter it=faces.begin();it!=faces.end();++it) {
-        for (ivector_iter jt=it->begin();jt!=it->end();++jt) {
-            if (*jt>nc)
-                nc=*jt;
-        }
+/* add a single edge to the drawing */
+vecteur graphe::draw_edge(int i,int j,const layout &x) const {
+    int color,width,style;
+    const attrib &attr=node(i).neighbor_attributes(j);
+    color=default_edge_color;
+    attrib_iter ait;
+    if ((ait=attr.find(_GT_ATTRIB_COLOR))!=attr.end() && ait->second.is_integer()) {
+        color=ait->second.val;
+        if (color==7) color=0; /* draw white (invisible) edges as black */
+    } else if ((ait=attr.find(_GT_ATTRIB_TEMPORARY))!=attr.end() && giac::is_one(ait->second))
+        color=29; // gray
+    style=0;
+    width=default_edge_width;
+    if ((ait=attr.find(_GT_ATTRIB_STYLE))!=attr.end()) {
+        const gen &val=ait->second;
+        string s=val.type==_STRNG?genstring2str(val):gen2string(val);
+        if (s=="dashed")
+            style=_DASH_LINE;
+        else if (s=="dotted")
+            style=_DOT_LINE;
+        else if (s=="bold")
+            width=bold_edge_width;
     }
-    edgemap emap(++nc);
-    map<int,int>::const_iterator et;
-    int i,j,v,w,f,n;
-    for (ivectors_iter it=faces.begin();it!=faces.end();++it) {
-        f=it-faces.begin();
-        const ivector &face=*it;
-        n=face.size();
-        for (int k=0;k<n;++k) {
-            i=face[k];
-            j=face[(k+1)%n];
-            v=i<j?i:j;
-            w=i<j?j:i;
-            map<int,int> &m=emap[v];
-            if ((et=m.find(w))==m.end())
-                m[w]=f;
-            else add_edge(f,et->second);
-        }
+    if ((ait=attr.find(_GT_ATTRIB_WIDTH))!=attr.end()) {
+        const gen &val=ait->second;
+        string s=val.type==_STRNG?genstring2str(val):gen2string(val);
+        if (s=="thin" || s=="1")
+            width=_LINE_WIDTH_1;
+        else if (s=="normal" || s=="2")
+            style=_LINE_WIDTH_2;
+        else if (s=="thick" || s=="3")
+            width=_LINE_WIDTH_3;
+        else if (s=="thicker" || s=="4")
+            width=_LINE_WIDTH_4;
+        else if (s=="very thick" || s=="5")
+            width=_LINE_WIDTH_5;
+        else if (s=="6")
+            width=_LINE_WIDTH_6;
+        else if (s=="7")
+            width=_LINE_WIDTH_7;
+        else if (s=="8")
+            width=_LINE_WIDTH_8;
     }
+    vecteur res;
+    point r(x.front().size());
+    const point &p=x[i],&q=x[j];
+    if (is_directed()) {
+        assert((ait=attr.find(_GT_ATTRIB_POSITION))!=attr.end());
+        double d=to_real_number(ait->second,ctx).to_double(ctx);
+        point_lincomb(p,q,d,1-d,r);
+        append_segment(res,p,r,color,width,style,true);
+        append_segment(res,r,q,color,width,style,false);
+    } else
+        append_segment(res,p,q,color,style,width);
+    return res;
 }
 
-/* return the number of different colors adjacent to the i-th vertex in a partially colored graph */
-int graphe::saturation_degree(const vertex &v,std::set<int> &colors) const {
-    int i,c;
-    colors.clear();
-    for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-        i=*it;
-        const vertex &w=node(i);
-        if ((c=w.color())>0)
-            colors.insert(c);
+/* append line segments representing edges (arcs) of the graph to vecteur v */
+void graphe::draw_edges(vecteur &drawing,const layout &x) {
+    if (x.empty())
+        return;
+    ipairs E,white,standard,highlighted,other;
+    get_edges_as_pairs(E);
+    attrib_iter ait;
+    for (ipairs_iter it=E.begin();it!=E.end();++it) {
+        const attrib &attr=node(it->first).neighbor_attributes(it->second);
+        if ((ait=attr.find(_GT_ATTRIB_COLOR))!=attr.end() && ait->second.is_integer()) {
+            if (ait->second.val==default_highlighted_edge_color)
+                highlighted.push_back(*it);
+            else if (ait->second.val==default_edge_color)
+                standard.push_back(*it);
+            else if (ait->second.val==_WHITE)
+                white.push_back(*it);
+            else other.push_back(*it);
+        } else if ((ait=attr.find(_GT_ATTRIB_TEMPORARY))!=attr.end() && giac::is_one(ait->second))
+            other.push_back(*it);
+        else standard.push_back(*it);
     }
-    return colors.size();
-}
-
-/* return the degree of v in the uncolored subgraph of this graph */
-int graphe::uncolored_degree(const vertex &v) const {
-    int deg=0;
-    for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-        if (node(*it).color()==0)
-            ++deg;
+    E=white;
+    E.insert(E.end(),standard.begin(),standard.end());
+    E.insert(E.end(),other.begin(),other.end());
+    E.insert(E.end(),highlighted.begin(),highlighted.end());
+    for (ipairs_iter it=E.begin();it!=E.end();++it) {
+        vecteur res=draw_edge(it->first,it->second,x);
+        drawing=mergevecteur(drawing,res);
     }
-    return deg;
 }
 
-/* return true iff this graph has at least one uncolored (white) vertex */
-bool graphe::is_partially_colored() const {
+/* append points representing vertices of the graph to vecteur v */
+void graphe::draw_nodes(vecteur &drawing,const layout &x) const {
+    if (x.empty())
+        return;
+    int color,width,n=node_count();
+    if (n<=30)
+        width=_POINT_WIDTH_4;
+    else if (n<=130)
+        width=_POINT_WIDTH_3;
+    else if (n<=330)
+        width=_POINT_WIDTH_2;
+    else
+        width=_POINT_WIDTH_1;
+    int shape,i=0;
+    attrib_iter ait;
     node_iter it=nodes.begin(),itend=nodes.end();
-    for (;it!=itend;++it) {
-        if (it->color()==0)
-            return true;
+    for (;it!=itend;++it,++i) {
+        const attrib &attr=it->attributes();
+        const point &p=x[i];
+        color=default_vertex_color;
+        if ((ait=attr.find(_GT_ATTRIB_COLOR))!=attr.end() && ait->second.is_integer()) {
+            color=ait->second.val;
+            if (color==7)
+                color=0; // draw white (invisible) nodes as black
+        }
+        shape=_POINT_POINT;
+        if ((ait=attr.find(_GT_ATTRIB_SHAPE))!=attr.end()) {
+            const gen &val=ait->second;
+            string s=val.type==_STRNG?genstring2str(val):gen2string(val);
+            if (s=="box" || s=="square")
+                shape=_POINT_CARRE;
+            else if (s=="triangle")
+                shape=_POINT_TRIANGLE;
+            else if (s=="diamond")
+                shape=_POINT_LOSANGE;
+            else if (s=="star")
+                shape=_POINT_ETOILE;
+            else if (s=="plus")
+                shape=_POINT_PLUS;
+        }
+        append_node(drawing,p,color,width,shape);
     }
-    return false;
 }
 
-/* heuristic algorithm by Brelaz for nearly optimal vertex coloring, complexity O(n*m) */
-void graphe::dsatur() {
-    int col,i,sat,maxsat,deg,maxdeg=0;
-    std::set<int> colors,maxcolors;
-    ivector indices;
-    node_iter nt=nodes.begin(),ntend=nodes.end();
-    for (i=0;nt!=ntend;++nt,++i) {
-        if (nt->color()==0)
-            indices.push_back(i);
+/* return the best quadrant for the placement of the i-th vertex label
+* (minimize the collision with the adjacent edges) */
+int graphe::best_quadrant(const point &p,const layout &adj) {
+    int bestq,n=adj.size();
+    if (n==0 || p.size()!=2)
+        return _QUADRANT1;
+    layout quad(4);
+    quad[0]=make_point(0.7071,0.7071);
+    quad[1]=make_point(-0.7071,0.7071);
+    quad[2]=make_point(-0.7071,-0.7071);
+    quad[3]=make_point(0.7071,-0.7071);
+    vector<double> min_angular_dist(4,M_PI);
+    point u(2);
+    double a;
+    for (int i=0;i<4;++i) {
+        const point &q=quad[i];
+        double &mindist=min_angular_dist[i];
+        for (layout_iter it=adj.begin();it!=adj.end();++it) {
+            scale_point(u,1/point_distance(p,*it,u));
+            a=std::acos(point_dotprod(u,q));
+            if (a<mindist)
+                mindist=a;
+        }
     }
-    if (indices.empty())
+    a=-1;
+    for (int i=0;i<4;++i) {
+        const double &dist=min_angular_dist[i];
+        if (a<0 || dist>a) {
+            a=dist;
+            bestq=i;
+        }
+    }
+    switch (bestq) {
+    case 0: return _QUADRANT1;
+    case 1: return _QUADRANT2;
+    case 2: return _QUADRANT3;
+    case 3: return _QUADRANT4;
+    default: break;
+    }
+    /* unreachable */
+    return -1;
+}
+
+/* append labels of the nodes of this graph to vecteur v */
+void graphe::draw_labels(vecteur &drawing,const layout &x) const {
+    if (is_null())
         return;
-    ivector::iterator pos,it,itend;
-    std::set<int>::const_iterator jt,jtend;
-    do {
-        maxsat=-1;
-        i=-1;
-        for (it=indices.begin(),itend=indices.end();it!=itend;++it) {
-            const vertex &v=node(*it);
-            if ((sat=saturation_degree(v,colors))>maxsat ||
-                    (sat==maxsat && (deg=uncolored_degree(v))>maxdeg)) {
-                if (sat==maxsat)
-                    maxdeg=deg;
-                maxsat=sat;
-                maxcolors=colors;
-                i=*it;
-                pos=it;
+    assert(!x.empty());
+    ivector adjv;
+    layout adj(2);
+    attrib_iter ait;
+    double d;
+    int color,n=node_count();
+    point r(x.front().size());
+    bool isdirected=is_directed(),isweighted=is_weighted();
+    if (isweighted && x.front().size()==2) {
+        /* draw weight labels */
+        for (int i=0;i<n;++i) {
+            const point &p=x[i];
+            const vertex &v=node(i);
+            for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
+                if (!isdirected && *it<i)
+                    continue;
+                const point &q=x[*it];
+                const attrib &attr=v.neighbor_attributes(*it);
+                color=default_edge_color;
+                if ((ait=attr.find(_GT_ATTRIB_COLOR))!=attr.end())
+                    color=ait->second.val;
+                assert((ait=attr.find(_GT_ATTRIB_POSITION))!=attr.end());
+                d=to_real_number(ait->second,ctx).to_double(ctx);
+                point_lincomb(p,q,d,1-d,r);
+                adj.front()=p;
+                adj.back()=q;
+                ait=attr.find(_GT_ATTRIB_WEIGHT);
+                append_label(drawing,r,ait==attr.end()?undef:ait->second,best_quadrant(r,adj),color);
             }
         }
-        if (i>=0) {
-            col=1;
-            for (jt=maxcolors.begin(),jtend=maxcolors.end();jt!=jtend;++jt) {
-                if (*jt==col)
-                    ++col;
-                else break;
-            }
-            node(i).set_color(col);
-            indices.erase(pos);
+    }
+    /* draw vertex labels */
+    for (int i=0;i<n;++i) {
+        const point &p=x[i];
+        adjacent_nodes(i,adjv);
+        adj.resize(adjv.size());
+        for (ivector_iter it=adjv.begin();it!=adjv.end();++it) {
+            adj[it-adjv.begin()]=x[*it];
         }
-    } while (i>=0);
+        append_label(drawing,p,node(i).label(),best_quadrant(p,adj));
+    }
 }
 
-/* return the total number of different nonzero vertex colors in this graph */
-int graphe::color_count() const {
-    std::set<int> colors;
-    node_iter it=nodes.begin(),itend=nodes.end();
-    for (;it!=itend;++it) {
-        colors.insert(it->color());
+/*
+ * DFS WALKER:
+ * Depth-first traversal with an explicit stack, so that arbitrarily deep
+ * searches do not overflow the call stack. Instead of calling visitor
+ * functions, the walker returns the events of the traversal one by one:
+ * DISCOVER (v is visited for the first time), TREE_ARC (w is a new child of
+ * v and will be discovered next), NONTREE_ARC (w was already visited), RETURN
+ * (the subtree of the child w of v is finished) and FINISH (v is finished).
+ * Vertices are marked as visited by the walker, so that several traversals
+ * from different roots do not overlap.
+ */
+
+graphe::dfs_walker::dfs_walker(graphe *gr,int sg,bool skip_embedded) {
+    G=gr;
+    A=&G->adjacency_snapshot();
+    m_sg=sg;
+    m_skip_embedded=skip_embedded;
+    m_pending=m_returned=-1;
+}
+
+/* start the traversal from root, which must be unvisited */
+void graphe::dfs_walker::start(int root) {
+    assert(m_vertices.empty());
+    G->node(root).set_visited(true);
+    m_vertices.push_back(root);
+    m_arcs.push_back(A->arc_begin(root));
+    m_pending=root;
+    m_returned=-1;
+}
+
+/* return the next event of the traversal and the vertices involved */
+graphe::dfs_walker::event_type graphe::dfs_walker::next(int &v,int &w) {
+    if (m_pending>=0) {
+        v=m_pending;
+        m_pending=-1;
+        return DISCOVER;
+    }
+    if (m_returned>=0) {
+        v=m_vertices.back();
+        w=m_returned;
+        m_returned=-1;
+        return RETURN;
+    }
+    if (m_vertices.empty())
+        return DONE;
+    v=m_vertices.back();
+    int &k=m_arcs.back(),kend=A->arc_end(v);
+    while (k<kend) {
+        w=A->head(k++);
+        vertex &x=G->node(w);
+        if ((m_sg>=0 && x.subgraph()!=m_sg) || (m_skip_embedded && x.is_embedded()))
+            continue;
+        if (x.is_visited())
+            return NONTREE_ARC;
+        x.set_visited(true);
+        m_vertices.push_back(w);
+        m_arcs.push_back(A->arc_begin(w));
+        m_pending=w;
+        return TREE_ARC;
     }
-    return colors.size();
+    m_vertices.pop_back();
+    m_arcs.pop_back();
+    if (!m_vertices.empty())
+        m_returned=v;
+    return FINISH;
 }
 
-/* return true iff the vertices can be colored using at most k different colors,
-* the vertices will be colored after the function returns */
-bool graphe::is_vertex_colorable(int k) {
-    assert(k>=0);
-    if (k==0) {
-        uncolor_all_nodes();
-        return true;
+/*
+ * END OF DFS WALKER
+ */
+
+/* depth-first graph traversal with O(n+m) time and O(m) space complexity */
+void graphe::dfs(int root,bool rec,bool clr,ivector *D,int sg,bool skip_embedded) {
+    if (clr) {
+        unvisit_all_nodes(sg);
+        unset_all_ancestors(sg);
+        for (std::vector<vertex>::iterator it=nodes.begin();it!=nodes.end();++it) {
+            if (sg<0 || it->subgraph()==sg)
+                it->set_leaf(true);
+        } 
+        disc_time=0;
     }
-    if (k>node_count()) {
-        message(1,"there are more colors than vertices");
-        return false;
+    ivector &d=D!=NULL?*D:disc_nodes;
+    if (rec) {
+        d.clear();
+        d.reserve(node_count());
     }
-    /* try greedy coloring first (linear time), use random order of vertices */
-    ivector sigma=rand_permu(node_count());
-    if (greedy_vertex_coloring(sigma)<=k)
-        return true;
-    /* next try dsatur algorithm (quadratic time) */
-    uncolor_all_nodes();
-    dsatur();
-    if (color_count()<=k)
-        return true;
-    /* finally resort to solving MIP problem */
-    return exact_vertex_coloring(k)!=0;
-}
-
-/* return the lower and the upper bound for chromatic number (inclusive) */
-graphe::ipair graphe::chromatic_number_bounds() {
-    /* the lower bound is the size of maximum clique */
-    ivector clique;
-    ostergard ost(this,3.0); // with timeout
-    int lb=ost.maxclique(clique);
-    /* the upper bound is given by heuristic dsatur algorithm */
-    uncolor_all_nodes();
-    for (ivector_iter it=clique.begin();it!=clique.end();++it) {
-        node(*it).set_color(it-clique.begin()+1);
+    assert(sg<0 || node(root).subgraph()==sg);
+    dfs_walker walker(this,sg,skip_embedded);
+    walker.start(root);
+    int v,w;
+    while (true) {
+        dfs_walker::event_type e=walker.next(v,w);
+        if (e==dfs_walker::DONE)
+            break;
+        vertex &x=node(v);
+        switch (e) {
+        case dfs_walker::DISCOVER:
+            x.set_disc(++disc_time);
+            x.set_low(x.disc());
+            if (rec)
+                d.push_back(v);
+            break;
+        case dfs_walker::TREE_ARC:
+            node(w).set_ancestor(v);
+            x.set_leaf(false);
+            break;
+        case dfs_walker::RETURN:
+            x.set_low(std::min(x.low(),node(w).low()));
+            break;
+        case dfs_walker::NONTREE_ARC:
+            if (w!=x.ancestor())
+                x.set_low(std::min(x.low(),node(w).disc()));
+            break;
+        default:
+            break;
+        }
     }
-    dsatur();
-    int ub=color_count();
-    return make_pair(lb,ub);
 }
 
-/* store custom vertex coordinates */
-void graphe::store_layout(const layout &x) {
-    assert(int(x.size())>=node_count());
-    for (layout_iter it=x.begin();it!=x.end();++it) {
-        vertex &v=node(it-x.begin());
-        v.set_attribute(_GT_ATTRIB_POSITION,point2gen(*it));
+/* breadth-first graph traversal with O(n+m) time and O(m) space complexity */
+void graphe::bfs(int root,bool rec,bool clr,ivector *D,int sg,bool skip_embedded) {
+    if (clr) {
+        unvisit_all_nodes(sg);
+        unset_all_ancestors(sg);
+        disc_time=0;
+    }
+    ivector &d=D!=NULL?*D:disc_nodes;
+    if (rec) {
+        d.clear();
+        d.reserve(node_count());
+    }
+    assert(node_queue.empty());
+    const csr_adjacency &A=adjacency_snapshot();
+    node_queue.push(root);
+    int i,j;
+    while (!node_queue.empty()) {
+        i=node_queue.front();
+        node_queue.pop();
+        vertex &v=node(i);
+        if (!v.is_visited()) {
+            v.set_disc(disc_time++);
+            if (rec)
+                d.push_back(i);
+            v.set_visited(true);
+            for (int k=A.arc_begin(i),kend=A.arc_end(i);k<kend;++k) {
+                vertex &w=node(j=A.head(k));
+                if ((sg>=0 && w.subgraph()!=sg) || (skip_embedded && w.is_embedded()))
+                    continue;
+                if (!w.is_visited()) {
+                    if (w.ancestor()<0)
+                        w.set_ancestor(i);
+                    node_queue.push(j);
+                }
+            }
+        }
     }
 }
 
-/* retrieve the previously stored layout, return true iff successful */
-bool graphe::has_stored_layout(layout &x) const {
-    x.resize(node_count());
-    attrib_iter ait;
-    int dim=0,i=0;
-    node_iter it=nodes.begin(),itend=nodes.end();
-    for (;it!=itend;++it,++i) {
-        const attrib &attr=it->attributes();
-        point &p=x[i];
-        if ((ait=attr.find(_GT_ATTRIB_POSITION))==attr.end() ||
-                !gen2point(ait->second,p,ctx) || (dim>0 && int(p.size())!=dim))
+/* return true iff the graph is connected */
+bool graphe::is_connected(int sg) {
+    assert(!is_null());
+    if (is_directed()) {
+        graphe G(ctx,false);
+        underlying(G);
+        return G.is_connected(sg);
+    }
+    int i=sg<0?0:first_vertex_from_subgraph(sg);
+    assert(i>=0);
+    dfs(i,false,true,NULL,sg);
+    node_iter it=nodes.begin()+i,itend=nodes.end();
+    for (;it!=itend;++it) {
+        if ((sg<0 || it->subgraph()==sg) && !it->is_visited())
             return false;
-        if (dim==0)
-            dim=p.size();
     }
     return true;
 }
 
-bool graphe::bipartite_matching_bfs(ivector &dist,int sg) {
-    assert(node_queue.empty() && sg>=0);
-    int u,v;
-    node_iter it=nodes.begin(),itend=nodes.end();
-    ivector_iter jt,jtend;
-    for (u=0;it!=itend;++it,++u) {
-        if (it->subgraph()!=sg || it->color()!=1)
+/* return true iff the graph is biconnected */
+bool graphe::is_biconnected(int sg) {
+    assert(!is_null());
+    if (is_directed()) {
+        graphe G(ctx,false);
+        underlying(G);
+        return G.is_biconnected(sg);
+    }
+    return is_connected(sg) && !has_cut_vertex(sg);
+}
+
+/* return true iff the graph is triconnected, using a simple O(n*(n+m)) algorithm */
+bool graphe::is_triconnected(int sg) {
+    assert(!is_null());
+    if (is_directed()) {
+        graphe G(ctx,false);
+        underlying(G);
+        return G.is_triconnected(sg);
+    }
+    int color=max_subgraph_index()+1;
+    for (int i=node_count();i-->0;) {
+        vertex &v=node(i);
+        if (sg>=0 && v.subgraph()!=sg)
             continue;
-        if (it->number()==0) {
-            dist[u+1]=0;
-            node_queue.push(u);
-        } else dist[u+1]=rand_max2;
+        if (degree(i)<3)
+            return false;
+        v.set_subgraph(color);
     }
-    dist.front()=rand_max2;
-    while (!node_queue.empty()) {
-        u=node_queue.front();
-        node_queue.pop();
-        if (dist[u+1]<dist.front()) {
-            vertex &U=node(u);
-            for (jt=U.neighbors().begin(),jtend=U.neighbors().end();jt!=jtend;++jt) {
-                v=*jt;
-                vertex &V=node(v);
-                if (V.subgraph()==sg && dist[V.number()]==rand_max2) {
-                    dist[V.number()]=dist[u+1]+1;
-                    node_queue.push(V.number()-1);
-                }
-            }
-        }
+    for (vector<vertex>::iterator it=nodes.begin();it!=nodes.end();++it) {
+        if (it->subgraph()!=color)
+            continue;
+        it->set_subgraph(color+1);
+        if (!is_biconnected(color))
+            return false;
+        it->set_subgraph(color);
     }
-    return dist.front()!=rand_max2;
+    return true;
 }
 
-bool graphe::bipartite_matching_dfs(int u,ivector &dist,int sg) {
-    assert(sg>=0);
-    if (u>0) {
-        int v;
-        vertex &U=node(u-1);
-        for (ivector_iter it=U.neighbors().begin();it!=U.neighbors().end();++it) {
-            v=*it;
-            vertex &V=node(v);
-            if (V.subgraph()==sg && dist[V.number()]==dist[u]+1) {
-                if (bipartite_matching_dfs(V.number(),dist,sg)) {
-                    V.set_number(u);
-                    U.set_number(v+1);
-                    return true;
-                }
-            }
+/* return true iff the (sub)graph is a cycle, linear time */
+bool graphe::is_cycle(ipairs &E,int sg) {
+    int root=-1,i=0;
+    node_iter it=nodes.begin(),itend=nodes.end();
+    for (;it!=itend;++it,++i) {
+        if (sg>=0 && it->subgraph()!=sg)
+            continue;
+        if (degree(i,sg)>0) {
+            root=i;
+            break;
         }
-        dist[u]=rand_max2;
+    }
+    if (root<0)
+        return false;
+    dfs(root,true,true,NULL,sg);
+    int n=disc_nodes.size();
+    ipairs ev;
+    get_edges_as_pairs(ev,sg);
+    if (n!=int(ev.size()))
         return false;
+    ipair e;
+    E.resize(n);
+    for (i=0;i<n;++i) {
+        e=make_pair(disc_nodes[i],disc_nodes[(i+1)%n]);
+        if (!has_edge(e))
+            return false;
+        E[i]=e;
     }
     return true;
 }
 
-/* find maximum matching in a bipartite graph using Hopcroft-Karp algorithm */
-void graphe::bipartite_matching(const ivector &p1,const ivector &p2,ipairs &matching,int sg,gt_conn_check cc) {
-    int cmp,s;
+/* return true iff the graph is a forest (check that the connected components are all trees) */
+bool graphe::is_forest(int sg,gt_conn_check cc) {
+    assert(!is_null() && !is_directed());
+    int s,cmp;
     switch (cc) {
     case _GT_CC_CONNECTED:
-        break;
-    case _GT_CC_COMPONENTS_ARE_SUBGRAPHS:
+        return is_tree(sg);
     case _GT_CC_FIND_COMPONENTS:
-        matching.clear();
-        s=(cc==_GT_CC_COMPONENTS_ARE_SUBGRAPHS || sg<0)?1:1+max_subgraph_index();
-        cmp=(cc==_GT_CC_FIND_COMPONENTS)?connected_components_to_subgraphs(sg):max_subgraph_index();
+        s=sg<0?1:1+max_subgraph_index();
+        cmp=connected_components_to_subgraphs(sg);
+    case _GT_CC_COMPONENTS_ARE_SUBGRAPHS:
+        s=1;
+        cmp=max_subgraph_index();
         for (;s<=cmp;++s) {
-            int sz=subgraph_size(s);
-            assert(sz!=0);
-            if (sz==1)
-                ;
-            else if (sz<=3) {
-                int i=first_vertex_from_subgraph(s);
-                assert(!node(i).neighbors().empty());
-                int j=node(i).neighbors().front();
-                matching.push_back(make_pair(std::min(i,j),std::max(i,j)));
-            } else bipartite_matching(p1,p2,matching,s,_GT_CC_CONNECTED);
-            if (cc==_GT_CC_FIND_COMPONENTS)
-                renumber_subgraph(s,sg);
+            if (edge_count(s)+1!=subgraph_size(s))
+                return false;
         }
-        return;
-    default: assert(false);
-    }
-    // sg >= 0
-    ivector_iter it,itend;
-    for (it=p1.begin(),itend=p1.end();it!=itend;++it) {
-        if (node(*it).subgraph()==sg)
-            set_node_color(*it,1);
-    }
-    for (it=p2.begin(),itend=p2.end();it!=itend;++it) {
-        if (node(*it).subgraph()==sg)
-            set_node_color(*it,2);
-    }
-    for (vector<vertex>::iterator it=nodes.begin();it!=nodes.end();++it) {
-        it->set_number(0);
+        return true;
+    default: break;
     }
-    ivector dist(node_count()+1);
-    int count=0,u,v;
-    node_iter nt,ntend=nodes.end();
-    while (bipartite_matching_bfs(dist,sg)) {
-        for (u=0,nt=nodes.begin();nt!=ntend;++nt,++u) {
-            if (nt->subgraph()!=sg || nt->color()!=1)
+    assert(false);
+}
+
+/* return true iff the graph is a tournament */
+bool graphe::is_tournament(int sg) const {
+    int n=subgraph_size(sg);
+    if (!is_directed() || edge_count(sg)!=n*(n-1)/2)
+        return false;
+    for (int i=0;i<n;++i) {
+        if (sg>=0 && node(i).subgraph()!=sg)
+            continue;
+        for (int j=0;j<n;++j) {
+            if (i==j || (sg>=0 && node(j).subgraph()!=sg))
                 continue;
-            if (nt->number()==0 && bipartite_matching_dfs(u+1,dist,sg))
-                ++count;
+            if (has_edge(i,j)==has_edge(j,i))
+                return false;
         }
     }
-    /* extract matching */
-    for (u=0,nt=nodes.begin();nt!=ntend;++nt,++u) {
-        if (nt->subgraph()!=sg || nt->color()!=1)
-            continue;
-        v=nt->number();
-        if (v>0) {
-            matching.push_back(make_pair(std::min(u,v-1),std::max(u,v-1)));
-            --count;
+    return true;
+}
+
+/* create set of vertices for product P of this graph and graph G */
+void graphe::make_product_nodes(const graphe &G,graphe &P) const {
+    int n=node_count(),m=G.node_count();
+    for (int i=0;i<n;++i) {
+        for (int j=0;j<m;++j) {
+            const gen &v=node_label(i),&w=G.node_label(j);
+            string str;
+            str+=v.type==_STRNG?genstring2str(v):gen2string(v);
+            str+=":";
+            str+=w.type==_STRNG?genstring2str(w):gen2string(w);
+            P.add_node(str2gen(str,true));
         }
     }
-    assert(count==0);
 }
 
-/* find a maximum/minimum weighted matching in bipartite graph, return true iff successful */
-bool graphe::weighted_bipartite_matching(const ivector &p1,const ivector &p2,ipairs &matching,
-        bool minimize,double eps,int sg,gt_conn_check cc) {
-    int cmp,s;
-    switch (cc) {
-    case _GT_CC_CONNECTED:
-        break;
-    case _GT_CC_COMPONENTS_ARE_SUBGRAPHS:
-    case _GT_CC_FIND_COMPONENTS:
-        assert(supports_attributes());
-        if (is_null() || is_directed() || !is_weighted())
-            return false;
-        if (is_empty())
-            return true;
-        matching.clear();
-        s=(cc==_GT_CC_COMPONENTS_ARE_SUBGRAPHS || sg<0)?1:1+max_subgraph_index();
-        cmp=(cc==_GT_CC_FIND_COMPONENTS)?connected_components_to_subgraphs(sg):max_subgraph_index();
-        for (;s<=cmp;++s) {
-            int sz=subgraph_size(s);
-            assert(sz>0);
-            if (sz==1)
-                continue;
-            if (!weighted_bipartite_matching(p1,p2,matching,minimize,eps,s,_GT_CC_CONNECTED))
-                return false;
-            if (cc==_GT_CC_FIND_COMPONENTS)
-                renumber_subgraph(s,sg);
+/* compute the cartesian product of this graph and graph G and store it in P */
+void graphe::cartesian_product(const graphe &G,graphe &P) const {
+    assert(supports_attributes()==G.supports_attributes());
+    assert(supports_attributes()==P.supports_attributes());
+    int n=node_count(),m=G.node_count();
+    P.clear();
+    P.reserve_nodes(n*m);
+    if (supports_attributes())
+        make_product_nodes(G,P);
+    else P.add_nodes(n*m);
+    bool G_isdir=G.is_directed(),isdir=is_directed();
+    P.set_directed(G_isdir || isdir);
+    for (int i=0;i<n;++i) {
+        for (int j=0;j<m;++j) {
+            const vertex &w=G.node(j);
+            for (ivector_iter it=w.neighbors().begin();it!=w.neighbors().end();++it) {
+                if (G_isdir || *it>j)
+                    P.add_edge(i*m+j,i*m+(*it));
+            }
         }
-        return true;
-    default: assert(false);
     }
-    //sg >= 0
-    int n1,n2,i,j;
-    matrice W;
-    weight_matrix(W);
-    gen f;
-    ivector P,Q; // filtered partitions
-    P.reserve(p1.size());
-    Q.reserve(p2.size());
-    for (ivector_iter it=p1.begin();it!=p1.end();++it) {
-        if (node(*it).subgraph()==sg)
-            P.push_back(*it);
-    }
-    n1=P.size();
-    for (ivector_iter it=p2.begin();it!=p2.end();++it) {
-        if (node(*it).subgraph()==sg)
-            Q.push_back(*it);
+    for (int j=0;j<m;++j) {
+        for (int i=0;i<n;++i) {
+            const vertex &v=node(i);
+            for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
+                if (isdir || *it>i)
+                    P.add_edge(i*m+j,(*it)*m+j);
+            }
+        }
     }
-    n2=Q.size();
-    for (ivector_iter it=P.begin();it!=P.end();++it) {
-        for (ivector_iter jt=node(*it).neighbors().begin();jt!=node(*it).neighbors().end();++jt) {
-            if (node(*jt).subgraph()!=sg)
-                continue;
-            if(find(Q.begin(),Q.end(),*jt)==Q.end())
-                return false; // not bipartite
-            const gen &w=W[*it][*jt];
-            if (w.is_integer())
-                continue;
-            if (!is_real_number(f,ctx)) {
-                message(2,"edge weights must be real");
-                return false;
+}
+
+/* compute tensor product of this graph and graph G and store it in P */
+void graphe::tensor_product(const graphe &G,graphe &P) const {
+    assert(supports_attributes()==G.supports_attributes());
+    assert(supports_attributes()==P.supports_attributes());
+    int n=node_count(),m=G.node_count();
+    P.clear();
+    P.reserve_nodes(m*n);
+    if (supports_attributes())
+        make_product_nodes(G,P);
+    else P.add_nodes(m*n);
+    bool G_isdir=G.is_directed(),isdir=is_directed();
+    P.set_directed(G_isdir || isdir);
+    for (int i=0;i<n;++i) {
+        const vertex &v=node(i);
+        for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
+            for (int j=0;j<m;++j) {
+                const vertex &w=G.node(j);
+                for (ivector_iter jt=w.neighbors().begin();jt!=w.neighbors().end();++jt) {
+                    if (G_isdir || *jt>j)
+                        P.add_edge(i*m+j,(*it)*m+(*jt));
+                }
             }
-            if (!is_rational(w))
-                W[*it]._VECTptr->at(*jt)=to_real_number(f,ctx);
         }
     }
-#if 0 //def HAVE_LIBGLPK
-    /* integralize the weight matrix */
-    if (!is_integer_matrice(W,true))
-        W=*_apply(makesequence(at_round,divvecteur(W,eps)),ctx)._VECTptr;
-    if (minimize) W=multvecteur(-1,W);
-    gen minw=_min(_min(W,ctx),ctx);
-    /* create the assignment problem as a GLPK graph */
-    glp_graph *G;
-    G=glp_create_graph(sizeof(wbm_v_data),sizeof(wbm_a_data));
-    int start1=glp_add_vertices(G,n1);
-    int start2=glp_add_vertices(G,n2);
-    glp_arc *a;
-    glp_vertex *v;
-    for (i=0;i<std::max(n1,n2);++i) {
-        if (i<n1) ((wbm_v_data*)(G->v)[start1+i]->data)->set=0;
-        if (i<n2) ((wbm_v_data*)(G->v)[start2+i]->data)->set=1;
+}
+
+/* compute the distance between i-th and J nodes using BFS and store them to dist
+* (also output paths if shortest_paths!=NULL) */
+void graphe::distance(int i,const ivector &J,ivector &dist,ivectors *shortest_paths) {
+    bfs(i,false);
+    int k,len;
+    if (shortest_paths!=NULL) {
+        shortest_paths->resize(J.size());
     }
-    for (ivector_iter it=P.begin();it!=P.end();++it) {
-        i=it-P.begin();
-        for (ivector_iter jt=node(*it).neighbors().begin();jt!=node(*it).neighbors().end();++jt) {
-            if (sg>=0 && node(*jt).subgraph()!=sg)
-                continue;
-            j=find(Q.begin(),Q.end(),*jt)-Q.begin();
-            a=glp_add_arc(G,U_start+i,V_start+j);
-            ((wbm_a_data*)a->data)->cost=(W[*it][*jt]-minw).val;
+    dist.resize(J.size());
+    ivector *shortest_path=NULL;
+    for (ivector_iter it=J.begin();it!=J.end();++it) {
+        k=*it;
+        len=0;
+        if (shortest_paths!=NULL) {
+            shortest_path=&shortest_paths->at(it-J.begin());
+            shortest_path->clear();
+            shortest_path->push_back(*it);
         }
+        while (k!=i) {
+            if ((k=node(k).ancestor())<0) {
+                len=-1;
+                break;
+            }
+            if (shortest_path!=NULL)
+                shortest_path->push_back(k);
+            ++len;
+        }
+        if (shortest_path!=NULL)
+            std::reverse(shortest_path->begin(),shortest_path->end());
+        dist[it-J.begin()]=len;
     }
-    /* solve the problem using out-of-kilter algorithm */
-    int res=glp_asnprob_okalg(GLP_ASN_MMP,G,
-                offsetof(wbm_v_data,set),offsetof(wbm_a_data,cost),NULL,offsetof(wbm_a_data,x));
-    if (res!=0) {
-        if (verbose)
-            message("Error: GLPK solver error %d",res);
-        glp_delete_graph(G);
-        return false;
-    }
-    /* retrieve the matching */
-    for (i=0;i<n1;++i) {
-        glp_vertex *v=G->v[U_start+i];
-        for (a=v->out;a!=NULL;a=a->t_next) {
-            if (((wbm_a_data*)a->data)->x==0)
-                continue;
-            j=a->head->i;
-            assert(j-V_start>=0);
-            if (has_edge(U[i],V[j-V_start]))
-                matching.push_back(make_pair(U[i],Q[j-V_start]));
+}
+
+/* compute the distances between all pairs of vertices, in floating-point arithmetic
+ * unless some edge weights are rational, symbolic or integers larger than 2^53
+ * (then exact Floyd-Warshall algorithm is used); if all weights are integers,
+ * so are the distances */
+void graphe::allpairs_distance(matrice &m) {
+    int n=node_count(),i,j,k;
+    bool isweighted=is_weighted();
+    m.reserve(n);
+    const csr_adjacency &A=adjacency_snapshot(isweighted);
+    if (!isweighted || A.has_exact_weights()) {
+        bool integral=!isweighted || A.has_integral_weights();
+        dvector D;
+        allpairs_distance_numeric(D,isweighted);
+        gen inf=plusinf();
+        double d;
+        for (i=0;i<n;++i) {
+            vecteur row(n);
+            for (j=0;j<n;++j) {
+                d=D[size_t(i)*n+j];
+                if (d==DBL_MAX)
+                    row[j]=inf;
+                else if (integral)
+                    row[j]=std::abs(d)<1e9?gen(int(std::floor(d+0.5))):gen(longlong(std::floor(d+0.5)));
+                else row[j]=d;
+            }
+            m.push_back(row);
         }
+        return;
     }
-    glp_delete_graph(G);
-    return true;
-#else
-    /* convert the assignment problem to transportation problem */
-    if (!minimize) W=multvecteur(-1,W);
-    gen minw=_min(_min(W,ctx),ctx);
-    int n=std::max(n1,n2);
-    vecteur sd(n,1);
-    gen M=identificateur(" M");
-    _purge(M,ctx);
-    tprob prob(sd,sd,M,ctx);
-    matrice C=*_matrix(makesequence(n,n,0),ctx)._VECTptr;
-    for (ivector_iter it=P.begin();it!=P.end();++it) {
-        i=it-P.begin();
-        for (ivector_iter jt=Q.begin();jt!=Q.end();++jt) {
-            j=jt-Q.begin();
-            C[i]._VECTptr->at(j)=has_edge(*it,*jt)?W[*it][*jt]-minw:M;
+    /* Floyd & Warshall algorithm with exact arithmetic, O(n^3) */
+    for (i=0;i<n;++i) m.push_back(vecteur(n,plusinf()));
+    gen s;
+    node_iter it=nodes.begin(),itend=nodes.end();
+    for (i=0;it!=itend;++it,++i) {
+        m[i]._VECTptr->at(i)=0;
+        for (ivector_iter jt=it->neighbors().begin();jt!=it->neighbors().end();++jt) {
+            j=*jt;
+            m[i]._VECTptr->at(j)=weight(i,j);
         }
     }
-    matrice sol;
-    prob.solve(C,sol);
-    /* retrieve the matching */
-    for (ivector_iter it=P.begin();it!=P.end();++it) {
-        i=it-P.begin();
-        for (ivector_iter jt=Q.begin();jt!=Q.end();++jt) {
-            j=jt-Q.begin();
-            if (giac::is_one(sol[i][j])) {
-                if (!has_edge(P[i],Q[j]))
-                    return false;
-                matching.push_back(make_pair(P[i],Q[j]));
-                break;
+    for (k=0;k<n;++k) {
+        for (i=0;i<n;++i) {
+            const gen &mik=m[i][k];
+            for (j=0;j<n;++j) {
+                s=mik+m[k][j];
+                gen &mij=m[i]._VECTptr->at(j);
+                if (is_strictly_greater(mij,s,ctx))
+                    mij=s;
             }
         }
     }
-    return true;
-#endif
 }
 
-/* construct the line graph of this graph */
-void graphe::line_graph(graphe &G,ipairs &E) const {
-    assert(supports_attributes() || !G.supports_attributes());
-    if (E.empty())
-        get_edges_as_pairs(E);
-    G.clear();
-    G.reserve_nodes(E.size());
-    bool isdir=G.is_directed();
-    G.set_directed(isdir);
-    if (G.supports_attributes()) {
-        vecteur labels;
-        gen label;
-        for (ipairs_iter it=E.begin();it!=E.end();++it) {
-            label=_cat(makesequence(node_label(it->first),str2gen("-",true),node_label(it->second)),ctx);
-            labels.push_back(label);
+/* return the sum of edge weights along the given path */
+gen graphe::path_weight(const ivector &path) const {
+    bool isweighted=is_weighted();
+    gen w(0);
+    for (ivector_iter it=path.begin();it!=path.end() && it+1!=path.end();++it) {
+        w+=isweighted?weight(*it,*(it+1)):gen(1);
+    }
+    return w;
+}
+
+/* compute the tree of cheapest paths from src (Dijkstra's algorithm on a 4-ary heap
+ * with floating-point weights), stop as soon as all vertices in dest are settled;
+ * parent[i] is set to the predecessor of i-th vertex or to -1 if i is not reached */
+void graphe::dijkstra_tree(int src,const ivector &dest,ivector &parent,int sg) {
+    int n=node_count(),u,v,remaining=0;
+    const csr_adjacency &A=adjacency_snapshot(true);
+    dvector dist(n,DBL_MAX);
+    bvector settled(n,false),wanted(n,false);
+    for (ivector_iter it=dest.begin();it!=dest.end();++it) {
+        if (!wanted[*it]) {
+            wanted[*it]=true;
+            ++remaining;
         }
-        G.add_nodes(labels);
-    } else G.add_nodes(E.size());
-    int i,j;
-    for (ipairs_iter it=E.begin();it!=E.end();++it) {
-        i=it-E.begin();
-        for (ipairs_iter jt=(isdir?E.begin():it+1);jt!=E.end();++jt) {
-            j=jt-E.begin();
-            if (i==j) continue;
-            if ((isdir && it->second==jt->first) || (!isdir && edges_incident(*it,*jt)))
-                G.add_edge(i,j);
+    }
+    parent.assign(n,-1);
+    dary_heap Q(n);
+    dist[src]=0;
+    Q.push(src,0);
+    double w,alt;
+    while (!Q.empty()) {
+        u=Q.pop();
+        settled[u]=true;
+        if (wanted[u] && --remaining==0)
+            break;
+        for (int k=A.arc_begin(u),kend=A.arc_end(u);k<kend;++k) {
+            v=A.head(k);
+            if (settled[v] || (sg>=0 && node(v).subgraph()!=sg) || (w=A.weight(k))==DBL_MAX)
+                continue;
+            alt=dist[u]+w;
+            if (alt<dist[v]) {
+                dist[v]=alt;
+                parent[v]=u;
+                Q.push(v,alt);
+            }
         }
     }
 }
 
-/* construct the transitive closure of this graph */
-void graphe::transitive_closure(graphe &G,bool weighted) {
-    int n=node_count();
-    bool isdir=is_directed(),iswei=is_weighted();
-    G.clear();
-    G.set_directed(isdir);
-    G.set_weighted(weighted);
-    G.reserve_nodes(n);
-    G.add_nodes(vertices());
-    if (weighted) {
-        matrice m;
-        gen wgh;
-        ivector dist,J(n-1);
-        int cnt;
-        if (iswei)
-            allpairs_distance(m);
-        for (int i=0;i<n;++i) {
-            if (!iswei) {
-                cnt=0;
-                for (int k=0;k<n;++k) {
-                    if (k!=i)
-                        J[cnt++]=k;
+/* Dijkstra's algorithm with exact arithmetic, used when some weights are
+ * rational or symbolic; the cheapest path weights are stored in dist */
+void graphe::dijkstra_tree_exact(int src,const ivector &dest,ivector &parent,vecteur &dist,int sg) {
+    int n=node_count(),u,v,remaining=0;
+    const csr_adjacency &A=adjacency_snapshot();
+    bool isweighted=is_weighted();
+    bvector settled(n,false),wanted(n,false);
+    for (ivector_iter it=dest.begin();it!=dest.end();++it) {
+        if (!wanted[*it]) {
+            wanted[*it]=true;
+            ++remaining;
+        }
+    }
+    parent.assign(n,-1);
+    dist=vecteur(n,plusinf());
+    gen_key_comparator comp(ctx);
+    std::priority_queue<pair<gen,int>,vector<pair<gen,int> >,gen_key_comparator> Q(comp);
+    dist[src]=0;
+    Q.push(make_pair(dist[src],src));
+    gen alt;
+    while (!Q.empty()) {
+        u=Q.top().second;
+        Q.pop();
+        if (settled[u])
+            continue; // outdated entry
+        settled[u]=true;
+        if (wanted[u] && --remaining==0)
+            break;
+        for (int k=A.arc_begin(u),kend=A.arc_end(u);k<kend;++k) {
+            v=A.head(k);
+            if (settled[v] || (sg>=0 && node(v).subgraph()!=sg))
+                continue;
+            alt=dist[u]+(isweighted?weight(u,v):gen(1));
+            if (is_strictly_greater(dist[v],alt,ctx)) {
+                dist[v]=alt;
+                parent[v]=u;
+                Q.push(make_pair(alt,v));
+            }
+        }
+    }
+}
+
+/* find a cheapest path from src to dst in an undirected graph by growing
+ * search trees from both ends until the sum of the smallest tentative
+ * distances exceeds the weight of the best connection found so far,
+ * return false if dst is not reachable from src */
+bool graphe::bidirectional_dijkstra(int src,int dst,ivector &path,int sg) {
+    assert(!is_directed() && src!=dst);
+    int n=node_count(),u,v,side,meet=-1;
+    const csr_adjacency &A=adjacency_snapshot(true);
+    dvector dist[2];
+    ivector parent[2];
+    bvector settled[2];
+    dary_heap Qf(n),Qb(n);
+    dary_heap *Q[2]={&Qf,&Qb};
+    for (side=0;side<2;++side) {
+        dist[side].assign(n,DBL_MAX);
+        parent[side].assign(n,-1);
+        settled[side].assign(n,false);
+    }
+    dist[0][src]=dist[1][dst]=0;
+    Qf.push(src,0);
+    Qb.push(dst,0);
+    double mu=DBL_MAX,w,alt;
+    while (!Qf.empty() && !Qb.empty() && Qf.top_key()+Qb.top_key()<mu) {
+        side=Qf.top_key()<=Qb.top_key()?0:1;
+        dvector &d=dist[side];
+        const dvector &od=dist[1-side];
+        u=Q[side]->pop();
+        settled[side][u]=true;
+        for (int k=A.arc_begin(u),kend=A.arc_end(u);k<kend;++k) {
+            v=A.head(k);
+            if (settled[side][v] || (sg>=0 && node(v).subgraph()!=sg) || (w=A.weight(k))==DBL_MAX)
+                continue;
+            alt=d[u]+w;
+            if (alt<d[v]) {
+                d[v]=alt;
+                parent[side][v]=u;
+                Q[side]->push(v,alt);
+                if (od[v]<DBL_MAX && alt+od[v]<mu) {
+                    mu=alt+od[v];
+                    meet=v;
                 }
-                distance(i,J,dist);
-            }
-            for (int j=isdir?0:i+1;j<n;++j) {
-                if (i==j)
-                    continue;
-                if ((iswei && !is_inf(wgh=m[i][j])) ||
-                        (!iswei && is_positive(wgh=dist[j<i?j:j-1],ctx)))
-                    G.add_edge(i,j,wgh);
-            }
-        }
-    } else {
-        for (int i=0;i<n;++i) {
-            dfs(i,false);
-            for (int j=isdir?0:i+1;j<n;++j) {
-                if (i==j)
-                    continue;
-                if (node(j).is_visited())
-                    G.add_edge(i,j);
             }
         }
     }
+    path.clear();
+    if (meet<0)
+        return false;
+    for (v=meet;v>=0;v=parent[0][v]) {
+        path.push_back(v);
+    }
+    std::reverse(path.begin(),path.end());
+    for (v=parent[1][meet];v>=0;v=parent[1][v]) {
+        path.push_back(v);
+    }
+    return true;
 }
 
-/* return true iff this graph is isomorphic to other, also obtain an isomorphism */
-bool graphe::is_isomorphic(graphe &other,map<int,int> &isom,bool use_colors) {
-    if (is_directed()!=other.is_directed())
-        return false;
-    int n=node_count(),sz;
-    if (other.node_count()!=n || edge_count()!=other.edge_count())
-        return false;
-#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
-    int *adj1=to_array(sz,use_colors);
-    int *adj2=other.to_array(sz,use_colors);
-    int *sigma=new int[n];
-    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE,NULL);
-    bool res=nautywrapper_is_isomorphic(is_directed()?1:0,n,adj1,adj2,sigma)!=0;
-    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE,NULL);
-    if (res) {
-        /* obtain the isomorphism */
-        isom.clear();
-        for (int i=0;i<n;++i) {
-            isom[i]=sigma[i];
+/* return the weights of the cheapest paths from src to the vertices in dest
+ * (Dijkstra's algorithm, the weights must be nonnegative), also fill
+ * cheapest_paths with the respective vertices if it is not NULL.
+ * Floating-point arithmetic is used for searching unless some weights are
+ * not numeric, but the path weights are always summed exactly */
+void graphe::dijkstra(int src,const ivector &dest,vecteur &path_weights,ivectors *cheapest_paths,int sg) {
+    int n=node_count(),nd=dest.size(),p;
+    if (sg>=0) {
+        assert(node(src).subgraph()==sg);
+        for (ivector_iter it=dest.begin();it!=dest.end();++it) {
+            assert(node(*it).subgraph()==sg);
         }
     }
-    delete[] adj1;
-    delete[] adj2;
-    delete[] sigma;
-    return res;
-#else
-    ivector d1=degree_sequence(),d2=other.degree_sequence();
-    std::sort(d1.begin(),d1.end());
-    std::sort(d2.begin(),d2.end());
-    if (d1!=d2 || connected_component_count()!=other.connected_component_count())
-        return false;
-    /* use Ullmann's algorithm */
-    ivectors uv;
-    subgraph_isomorphism(other,1,true,uv);
-    if (uv.empty())
-        return false;
-    else {
-        isom.clear();
-        for (int i=0;i<n;++i) {
-            isom[uv.front()[i]]=i;
+    bool numeric=adjacency_snapshot(true).has_numeric_weights(),isweighted=is_weighted();
+    path_weights.resize(nd);
+    if (cheapest_paths!=NULL)
+        cheapest_paths->resize(nd);
+    if (numeric && !is_directed() && nd==1 && dest.front()!=src) {
+        /* single pair query */
+        ivector path;
+        path_weights.front()=bidirectional_dijkstra(src,dest.front(),path,sg)?path_weight(path):plusinf();
+        if (cheapest_paths!=NULL)
+            cheapest_paths->front()=path;
+        return;
+    }
+    ivector parent,chain;
+    vecteur dist;
+    bvector known;
+    if (numeric) {
+        dijkstra_tree(src,dest,parent,sg);
+        /* sum the weights exactly, going down the tree from the known vertices */
+        dist=vecteur(n,plusinf());
+        known.resize(n,false);
+        dist[src]=0;
+        known[src]=true;
+        for (ivector_iter it=dest.begin();it!=dest.end();++it) {
+            if (*it!=src && parent[*it]<0)
+                continue;
+            chain.clear();
+            for (p=*it;!known[p];p=parent[p]) {
+                chain.push_back(p);
+            }
+            for (ivector::const_reverse_iterator jt=chain.rbegin();jt!=chain.rend();++jt) {
+                p=parent[*jt];
+                dist[*jt]=dist[p]+(isweighted?weight(p,*jt):gen(1));
+                known[*jt]=true;
+            }
         }
-        return true;
+    } else dijkstra_tree_exact(src,dest,parent,dist,sg);
+    for (ivector_iter it=dest.begin();it!=dest.end();++it) {
+        path_weights[it-dest.begin()]=dist[*it];
     }
-#endif
-}
-
-/* convert a sequence of nd digits to nonnegative integer */
-int digits2int(char *digits,int nd) {
-    int n=1,res=0;
-    for (int i=nd;i-->0;) {
-        res+=*(digits+i)*n;
-        n*=10;
+    if (cheapest_paths!=NULL) {
+        for (ivector_iter it=dest.begin();it!=dest.end();++it) {
+            ivector &path=cheapest_paths->at(it-dest.begin());
+            path.clear();
+            if (*it!=src && parent[*it]<0) continue;
+            for (p=*it;p>=0;p=parent[p]) {
+                path.push_back(p);
+            }
+            std::reverse(path.begin(),path.end());
+        }
     }
-    return res;
 }
 
-/* return the set of generators of the automorphism group of this graph */
-gen graphe::aut_generators() const {
-#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
-    int n=node_count(),ofs=array_start(ctx),sz;
-    vecteur out(0);
-    if (n>0) {
-        int *adj=to_array(sz,true);
-        temp_file f("nauty-autg");
-        if (f.fail()) {
-            message (2,"failed to create temporary file");
-            return undef;
+/* return the length of the shortest path from src to dest in weighted
+* graph (Bellman-Ford algorithm), also fill shortest_path with the respective vertices */
+bool graphe::bellman_ford(int src,const ivector &dest,vecteur &path_weights,ivectors *cheapest_paths) {
+    int n=node_count(),u,v;
+    ivector prev(n);
+    vecteur dist(n);
+    bool isweighted=is_weighted();
+    for (int i=0;i<n;++i) {
+        dist[i]=i==src?gen(0):plusinf();
+        prev[i]=-1;
+    }
+    ipairs E;
+    get_edges_as_pairs(E);
+    gen w(1);
+    for (int i=1;i<n;++i) {
+        for (ipairs_iter it=E.begin();it!=E.end();++it) {
+            u=it->first; v=it->second;
+            if (isweighted)
+                get_edge_attribute(u,v,_GT_ATTRIB_WEIGHT,w);
+            if (is_strictly_greater(dist[v],dist[u]+w,ctx)) {
+                dist[v]=dist[u]+w;
+                prev[v]=u;
+            }
         }
-        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE,NULL);
-        nautywrapper_aut_generators(is_directed()?1:0,n,adj,f.handle);
-        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE,NULL);
-        // parse the generators and output them as a sequence of permutations,
-        // each in form of a list of disjoint cycles
-        int sz=ftell(f.handle);
-        rewind(f.handle);
-        int i=0,nd=0;
-        char c;
-        vecteur perm,cycle;
-        char digits[32];
-        for (int cnt=0;cnt<sz;++cnt) {
-            c=fgetc(f.handle);
-            if (c=='(')
-                cycle.clear();
-            else if (c==')') {
-                cycle.push_back(ofs+digits2int(digits,nd));
-                perm.push_back(cycle);
-                nd=0;
-            } else if (c=='\n') {
-                out.push_back(gen(perm,_LIST__VECT));
-                perm.clear();
-            } else if (c>47 && c<58)
-                digits[nd++]=c-48;
-            else if (c==32) {
-                cycle.push_back(ofs+digits2int(digits,nd));
-                nd=0;
-            }
-            ++i;
+    }
+    /* check for negative-weight cycles */
+    for (ipairs_iter it=E.begin();it!=E.end();++it) {
+        if (isweighted)
+            get_edge_attribute(u,v,_GT_ATTRIB_WEIGHT,w);
+        if (is_strictly_greater(dist[v],dist[u]+w,ctx))
+            return false; // a negative-weight cycle is found
+    }
+    if (cheapest_paths!=NULL) {
+        cheapest_paths->resize(dest.size());
+        for (ivector_iter it=dest.begin();it!=dest.end();++it) {
+            ivector &path=cheapest_paths->at(it-dest.begin());
+            path.clear();
+            path.push_back(*it);
+            int p=*it;
+            while ((p=prev[p])>=0) path.push_back(p);
+            std::reverse(path.begin(),path.end());
         }
-        delete[] adj;
     }
-    return gen(out,_LIST__VECT);
-#else
-    return gensizeerr("nauty library is required for finding graph automorphisms");
-#endif
+    path_weights.resize(dest.size());
+    for (ivector_iter it=dest.begin();it!=dest.end();++it) {
+        path_weights[it-dest.begin()]=dist[*it];
+    }
+    return true; // success
 }
 
-/* return the canonical labeling of this graph as a permutation */
-bool graphe::canonical_labeling(ivector &lab) const {
-#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
-    int n=node_count(),sz;
-    if (n==0)
-        return false;
-    int *adj=to_array(sz,true);
-    int *clab=new int[n];
-    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE,NULL);
-    nautywrapper_canonical(is_directed()?1:0,n,adj,clab,NULL,NULL);
-    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE,NULL);
-    lab.resize(n);
+/* return true iff the graph has a topological ordering and output the indices
+* of thus sorted vertices in list v, use Kahn's algorithm with time complexity O(n+m) */
+bool graphe::topologic_sort(ivector &ordering) {
+    assert(is_directed() && node_stack.empty());
+    int n=node_count(),v;
+    ordering.clear();
+    ordering.reserve(n);
     for (int i=0;i<n;++i) {
-        lab[i]=clab[i];
+        if (in_degree(i)==0)
+            node_stack.push(i);
     }
-    delete[] adj;
-    delete[] clab;
-    return true;
-#else
-    return false;
-#endif
-}
-
-/* construct the closure of this graph and store it to G, complexity O(n^3) */
-bool graphe::bondy_chvatal_closure(graphe &G,ivector &d) {
-    underlying(G);
-    int n=node_count(),di;
-    bool yes=false,have_pair;
-    do {
-        have_pair=false;
-        for (int i=0;i<n && !have_pair;++i) {
-            di=d[i];
-            for (int j=i+1;j<n;++j) {
-                if (!G.has_edge(i,j) && di+d[j]>=n) {
-                    G.add_edge(i,j);
-                    ++d[i]; ++d[j];
-                    yes=have_pair=true;
-                    break;
-                }
-            }
+    graphe G(ctx,false);
+    copy(G);
+    while (!node_stack.empty()) {
+        v=node_stack.top();
+        node_stack.pop();
+        ordering.push_back(v);
+        vertex &vert=G.node(v);
+        for (ivector_iter it=vert.neighbors().begin();it!=vert.neighbors().end();++it) {
+            if (G.in_degree(*it)==1)
+                node_stack.push(*it);
         }
-    } while (have_pair);
-    return yes;
+        vert.clear_neighbors();
+    }
+    return G.edge_count()==0;
 }
 
-/* return 1 if the graph is Hamiltonian, 0 if it is not and -1 if inconclusive */
-int graphe::hamcond(bool make_closure) {
-    /* test biconnectivity, complexity O(n) */
-    if (!is_biconnected())
-        return 0;
-    int mindeg=rand_max2,deg,n=node_count(),m=edge_count(),i;
-    ivector d=degree_sequence();
-    /* Dirac criterion, complexity O(n) */
+/* return true iff the graph is an arborescence, i.e. a directed tree */
+bool graphe::is_arborescence() const {
+    assert(is_directed());
+    bool has_root=false;
+    ivector deg(node_count(),0);
     node_iter it=nodes.begin(),itend=nodes.end();
-    for (i=0;it!=itend;++it,++i) {
-        if ((deg=d[i]=it->neighbors().size())<mindeg)
-            mindeg=deg;
-    }
-    if (2*mindeg>=n)
-        return 1;
-    ivector V1,V2,v;
-    /* unbalanced bipartite graph is not Hamiltonian, complexity O(n+m) */
-    if (is_bipartite(V1,V2) && V1.size()!=V2.size())
-        return 0;
-    /* Ore criterion, complexity O(n^2) */
-    bool yes=true;
-    for (int i=0;i<n && yes;++i) {
-        deg=d[i];
-        for (int j=i+1;j<n;++j) {
-            if (!has_edge(i,j) && deg+d[j]<n) {
-                yes=false;
-                break;
-            }
+    ivector_iter jt,jtend;
+    for (;it!=itend;++it) {
+        for (jt=it->neighbors().begin(),jtend=it->neighbors().end();jt!=jtend;++jt) {
+            ++deg[*jt];
         }
     }
-    if (yes) return 1;
-    if (make_closure) {
-        /* apply the Bondy-Chvátal theorem: the graph is Hamiltonian if
-           and only if its closure is Hamiltonian, complexity O(n^2) */
-        graphe G(ctx);
-        if (bondy_chvatal_closure(G,d))
-            return G.hamcond(false);
+    for (jt=deg.begin(),jtend=deg.end();jt!=jtend;++jt) {
+        if (*jt==0) {
+            if (has_root)
+                return false;
+            has_root=true;
+        } else if (*jt>1)
+            return false;
     }
-    if (double(m)/(double(n*n)>1.0-2.0/(1.0+std::exp(.0015*double(n))))) {
-        /* Nash-Williams criterion */
-        int inum=maximum_independent_set(v);
-        if (3*mindeg>=std::max(n+2,3*inum))
-            return 1;
+    return has_root;
+}
+
+/* write this (directed) graph with arc directions reversed to G */
+void graphe::reverse(graphe &G) const {
+    assert(is_directed());
+    G.set_directed(true);
+    G.reserve_nodes(node_count());
+    int i;
+    node_iter it,itend;
+    ivector_iter jt,jtend;
+    if (supports_attributes()) {
+        G.set_graph_attributes(attributes);
+        for (it=nodes.begin(),itend=nodes.end();it!=itend;++it) {
+            G.add_node(it->label(),it->attributes());
+        }
+    } else G.add_nodes(node_count());
+    for (it=nodes.begin(),itend=nodes.end(),i=0;it!=itend;++it,++i) {
+        for (jt=it->neighbors().begin(),jtend=it->neighbors().end();jt!=jtend;++jt) {
+            if (supports_attributes())
+                G.add_edge(*jt,i,it->neighbor_attributes(*jt));
+            else G.add_edge(*jt,i);
+        }
     }
-    return -1;
 }
 
-/* return true iff the graph is Hamiltonian */
-bool graphe::is_hamiltonian(ivector &hc) {
-    hc.clear();
-    if (!is_directed()) {
-      switch (hamcond()) {
-      case 0: return false;
-      case 1: return true;
-      default: break;
-      }
-    } else {
-        ivectors components;
-        strongly_connected_components(components);  
-        if (components.size()>1) return false; // graph is not strongly connected
-        ivector dv=degree_sequence();
-        bool isham=true;
-        int n=node_count();
-        for (ivector_iter it=dv.begin();it!=dv.end();++it) {
-            if (*it<n) {
-               isham=false;
-               break;
-            }
+/* write a spanning tree of this graph with i-th node as root to T, time complexity O(n+m) */
+void graphe::spanning_tree(int i,graphe &T,int sg) {
+    T.clear();
+    vecteur V=vertices(sg);
+    T.reserve_nodes(V.size());
+    T.add_nodes(V);
+    ivector indices(V.size());
+    int v,p;
+    if (sg>=0) {
+        const_iterateur vt=V.begin(),vtend=V.end();
+        for (v=0;vt!=vtend;++vt,++v) {
+            indices[v]=node_index(*vt);
         }
-        if (isham) return true;
-        isham=true;
-        for (int i=0;isham && i<n;++i) {
-            for (int j=0;j<n;++j) {
-                if (i==j) continue;
-                if (!has_edge(i,j) && !has_edge(j,i) && dv[i]+dv[j]<2*n-1) {
-                    isham=false;
-                    break;
-                }
-            }
+    }
+    dfs(i,false,true,NULL,sg);
+    node_iter it=nodes.begin(),itend=nodes.end();
+    for (v=0;it!=itend;++it,++v) {
+        if (sg>=0 && it->subgraph()!=sg)
+            continue;
+        if ((p=it->ancestor())>=0) {
+            if (sg>=0)
+                T.add_edge(indices[v],indices[p]);
+            else
+                T.add_edge(v,p);
         }
-        if (isham) return true;
     }
-    return hamcycle(hc);
 }
 
-bool graphe::hamcycle_recurse(ivector &path,int pos) {
-    if (pos==node_count()) return has_edge(path[pos-1],path[0]);
-    const vertex &v=node(path[pos-1]);
-    for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-        vertex &w=node(*it);
-        if (w.is_visited()) continue;
-        path[pos]=*it;
-        w.set_visited(true);
-        if (hamcycle_recurse(path,pos+1)) return true;
-        w.set_visited(false);
+/* write the minimal spanning tree of this graph to T, use the filter-Kruskal algorithm
+ * if the weights are exactly representable as doubles and Kruskal's algorithm with exact
+ * comparisons otherwise */
+void graphe::minimal_spanning_tree(graphe &T,int sg) {
+    assert(!is_directed() && is_weighted());
+    ipairs E,res;
+    if (adjacency_snapshot(true).has_exact_weights()) {
+        minimal_spanning_forest(res,sg);
+        extract_subgraph(res,T);
+        return;
     }
-    return false;
+    get_edges_as_pairs(E,sg);
+    edges_comparator comp(this);
+    std::sort(E.begin(),E.end(),comp);
+    int v,u;
+    unionfind ds(node_count());
+    for (ipairs_iter it=E.begin();it!=E.end();++it) {
+        ds.make_set(it->first);
+        ds.make_set(it->second);
+    }
+    for (ipairs_iter it=E.begin();it!=E.end();++it) {
+        u=it->first;
+        v=it->second;
+        if (ds.find(u)!=ds.find(v)) {
+            res.push_back(*it);
+            ds.unite(u,v);
+        }
+    }
+    extract_subgraph(res,T);
 }
 
-bool graphe::hamcycle(ivector &path) {
-    int n=node_count();
-    path.resize(n+1);
-    unvisit_all_nodes();
-    path[0]=0;
-    nodes[0].set_visited(true);
-    if (!hamcycle_recurse(path,1)) return false;
-    path[n]=path[0];
-    return true;
+/* store the edges of the minimal spanning forest of this undirected graph (or of its
+ * subgraph sg) to E and return its weight, the weights must be numeric */
+double graphe::minimal_spanning_forest(ipairs &E,int sg) const {
+    assert(!is_directed());
+    const csr_adjacency &A=adjacency_snapshot(true);
+    if (sg<0)
+        return mst_finder(A).find_forest(E);
+    bvector include(node_count());
+    int i=0;
+    for (node_iter it=nodes.begin();it!=nodes.end();++it,++i) {
+        include[i]=it->subgraph()==sg;
+    }
+    return mst_finder(A,&include).find_forest(E);
 }
 
-/*
-* TSP CLASS IMPLEMENTATION
-*/
+/* Tarjan's offline algorithm for the lowest common ancestor, time complexity O(n) */
+void graphe::lca_recursion(int u,const ipairs &p,ivector &lca,unionfind &ds) {
+    ds.make_set(u);
+    vertex &U=node(u);
+    U.set_ancestor(u);
+    U.set_visited(true);
+    int v;
+    for (ivector_iter it=U.neighbors().begin();it!=U.neighbors().end();++it) {
+        v=*it;
+        vertex &V=node(v);
+        if (V.is_visited())
+            continue;
+        lca_recursion(v,p,lca,ds);
+        ds.unite(u,v);
+        node(ds.find(u)).set_ancestor(u);
+    }
+    U.set_color(1); // black
+    node_iter it=nodes.begin(),itend=nodes.end();
+    ipairs_iter jt,jtend;
+    for (v=0;it!=itend;++it,++v) {
+        if (u==v)
+            continue;
+        for (jt=p.begin(),jtend=p.end();jt!=jtend;++jt) {
+            if ((jt->first==u && jt->second==v) || (jt->first==v && jt->second==u)) {
+                if (it->color()==1)
+                    lca[jt-p.begin()]=node(ds.find(v)).ancestor();
+                break;
+            }
+        }
+    }
+}
 
-#ifdef HAVE_LIBGLPK
+/* find the lowest common ancestors for all pairs of vertices in p (this must be a tree) */
+void graphe::lowest_common_ancestors(int root,const ipairs &p,ivector &lca) {
+    unvisit_all_nodes();
+    unset_all_ancestors();
+    uncolor_all_nodes();
+    lca.resize(p.size(),-1);
+    unionfind ds(node_count());
+    lca_recursion(root,p,lca,ds);
+    assert(find(lca.begin(),lca.end(),-1)==lca.end());
+}
 
-/* MINIMAL CUT implementation, adapted from glpk/examples/tsp (maxflow.c, mincut.c and main.c)
- * Originally written by Andrew Makhorin <mao@gnu.org>
- */
+/* return the lowest common ancestor of i-th node and j-th node of this tree */
+int graphe::lowest_common_ancestor(int i,int j,int root) {
+    ipairs p;
+    p.push_back(make_pair(i,j));
+    ivector lca;
+    lowest_common_ancestors(root,p,lca);
+    return lca.front();
+}
 
-/* compute maximal flow */
-int graphe::tsp::max_flow(int nn,int nedg,const ivector &beg,
-        const ivector &end,const ivector &cap,int s,int t,
-        ivector &x) {
-    int k;
-    assert(nn>=2);
-    assert(nedg>=0);
-    assert(1<=s && s<=nn);
-    assert(1<=t && t<=nn);
-    assert(s!=t);
-    for (k=0; k<nedg; k++) {
-        assert(1<=beg[k] && beg[k]<end[k] && end[k]<=nn && cap[k]>0);
+/* return true iff v is a descendant of anc wrt the last dfs traversal */
+bool graphe::is_descendant(int v,int anc) const {
+    int i=v;
+    while ((i=node(i).ancestor())>=0) {
+        if (i==anc)
+            return true;
     }
-    glp_prob *lp;
-    glp_smcp smcp;
-    int i,nz,flow,*rn,*cn;
-    double temp,*aa;
-    lp=glp_create_prob();
-    glp_add_rows(lp,nn);
-    for (i=1;i<=nn;++i) {
-        glp_set_row_bnds(lp,i,GLP_FX,0.0,0.0);
+    return false;
+}
+
+/* find st-numbering using Tarjan's algorithm (1986), time complexity O(n+m) */
+void graphe::compute_st_numbering(int s,int t) {
+    /* assuming that the graph is biconnected */
+    assert(has_edge(s,t) && node_stack.empty());
+    int n=node_count(),i,v,w,p;
+    unvisit_all_nodes();
+    for (vector<vertex>::iterator it=nodes.begin();it!=nodes.end();++it) {
+        it->set_disc(0);
     }
-    glp_add_cols(lp,nedg+1);
-    for (k=0; k<nedg; k++) {
-        glp_set_col_bnds(lp,k+1,GLP_DB,-cap[k],+cap[k]);
+    disc_time=1;
+    node(s).set_disc(1);
+    node(s).set_visited(true);
+    /* compute the lowpoint vertices and the postorder of the DFS tree rooted at t */
+    ivector postorder;
+    postorder.reserve(n);
+    dfs_walker walker(this);
+    walker.start(t);
+    while (true) {
+        dfs_walker::event_type e=walker.next(v,w);
+        if (e==dfs_walker::DONE)
+            break;
+        vertex &x=node(v);
+        switch (e) {
+        case dfs_walker::DISCOVER:
+            x.set_disc(++disc_time);
+            x.set_low(v);
+            break;
+        case dfs_walker::TREE_ARC:
+            node(w).set_ancestor(v);
+            break;
+        case dfs_walker::RETURN:
+            postorder.push_back(w);
+            if (node(node(w).low()).disc()<node(x.low()).disc())
+                x.set_low(node(w).low());
+            break;
+        case dfs_walker::NONTREE_ARC:
+            if (node(w).disc()<node(x.low()).disc())
+                x.set_low(w);
+            break;
+        default:
+            break;
+        }
     }
-    glp_set_col_bnds(lp,nedg+1,GLP_FR,0.0,0.0);
-    rn=new int[1+2*(nedg+1)];
-    cn=new int[1+2*(nedg+1)];
-    aa=new double[1+2*(nedg+1)];
-    nz=0;
-    for (k=0;k<nedg;k++) {
-        rn[++nz]=beg[k]; cn[nz]=k+1; aa[nz]=-1.0;
-        rn[++nz]=end[k]; cn[nz]=k+1; aa[nz]=+1.0;
+    /* build the list L, stored as a doubly linked list, starting with s,t */
+    ivector prev(n,-1),next(n,-1);
+    next[s]=t;
+    prev[t]=s;
+    int head=s;
+    bvector sign(n);
+    bool sign_plus=true,sign_minus=false;
+    sign[s]=sign_minus;
+    for (ivector::const_reverse_iterator it=postorder.rbegin();it!=postorder.rend();++it) {
+        vertex &x=node(v=*it);
+        w=x.ancestor();
+        if (sign[x.low()]==sign_minus) {
+            /* insert v before its parent */
+            p=prev[w];
+            prev[v]=p;
+            next[v]=w;
+            prev[w]=v;
+            if (p>=0) next[p]=v; else head=v;
+            sign[w]=sign_plus;
+        } else {
+            /* insert v after its parent */
+            p=next[w];
+            next[v]=p;
+            prev[v]=w;
+            next[w]=v;
+            if (p>=0) prev[p]=v;
+            sign[w]=sign_minus;
+        }
     }
-    rn[++nz]=t; cn[nz]=nedg+1; aa[nz]=-1.0;
-    rn[++nz]=s; cn[nz]=nedg+1; aa[nz]=+1.0;
-    assert(nz==2*(nedg+1));
-    glp_load_matrix(lp,nz,rn,cn,aa);
-    delete[] rn;
-    delete[] cn;
-    delete[] aa;
-    glp_set_obj_dir(lp,GLP_MAX);
-    glp_set_obj_coef(lp,nedg+1,1.0);
-    int old_term=glp_term_out(GLP_OFF);
-    glp_adv_basis(lp,0);
-    glp_term_out(old_term);
-    glp_init_smcp(&smcp);
-    smcp.msg_lev=GLP_MSG_OFF;
-    assert(glp_simplex(lp,&smcp)==0);
-    assert(glp_get_status(lp)==GLP_OPT);
-    for (k=0;k<nedg;k++) {
-        temp=glp_get_col_prim(lp,k+1);
-        x[k]=(int)floor(temp+.5);
-        assert(std::abs(x[k]-temp)<=1e-6);
+    i=0;
+    for (v=head;v>=0;v=next[v]) {
+        node(v).set_number(++i);
     }
-    temp=glp_get_col_prim(lp,nedg+1);
-    flow=(int)floor(temp+.5);
-    assert(std::abs(flow-temp)<=1e-6);
-    glp_delete_prob(lp);
-    return flow;
 }
 
-/* find min (s,t)-cut for known max flow */
-int graphe::tsp::min_st_cut(int nn,int nedg,const ivector &beg,
-        const ivector &end,const ivector &cap,int s,int t,
-        const ivector &x,ivector &cut) {
-    int i,j,k,p,q,temp;
-    ivector &head1=mincut_data[18]; if (int(head1.size())<nn) head1.resize(nn);
-    ivector &head2=mincut_data[19]; if (int(head2.size())<nn) head2.resize(nn);
-    ivector &next1=mincut_data[20]; if (int(next1.size())<nn) next1.resize(nn);
-    ivector &next2=mincut_data[21]; if (int(next2.size())<nn) next2.resize(nn);
-    for (i=0;i<nn;i++) head1[i]=head2[i]=0;
-    for (k=0;k<nedg;k++) {
-        i=beg[k]-1; next1[k]=head1[i]; head1[i]=k+1;
-        j=end[k]-1; next2[k]=head2[j]; head2[j]=k+1;
-    }
-    ivector &list=mincut_data[4]; list.resize(nn);
-    for (i=0;i<nn;i++) cut[i]=0;
-    p=q=0; list[0]=s; cut[s-1]=1;
-    while (p<=q) {
-        i=list[p++];
+/* return st-numbering in form of vecteur */
+vecteur graphe::get_st_numbering() const {
+    /* assuming that st numbering has been computed */
+    vecteur st(node_count());
+    int ofs=1-array_start(ctx);
+    for (iterateur it=st.begin();it!=st.end();++it) {
+        *it=node(it-st.begin()).number()-ofs;
+    }
+    return st;
+}
+
+/* assign directions to edges according to the st-numbering */
+void graphe::assign_edge_directions_from_st() {
+    bool isweighted=is_weighted();
+    matrice W;
+    if (isweighted)
+        weight_matrix(W);
+    ipairs E;
+    get_edges_as_pairs(E);
+    for (ipairs_iter it=E.begin();it!=E.end();++it) {
+        discard_edge_attribute(it->first,it->second,_GT_ATTRIB_WEIGHT);
+    }
+    set_weighted(false);
+    set_directed(true);
+    invalidate_adjacency_snapshot();
+    for (vector<vertex>::iterator it=nodes.begin();it!=nodes.end();++it) {
+        vertex &v=*it;
+        ivector ngh=v.neighbors();
+        for (ivector_iter jt=ngh.begin();jt!=ngh.end();++jt) {
+            const vertex &w=node(*jt);
+            if (v.number()>w.number())
+                v.remove_neighbor(*jt);
+        }
+    }
+    if (isweighted)
+        make_weighted(W);
+}
+
+void graphe::strec(int i,int t,int counter,int np,iset &Q,vecteur &timestamp,vecteur &l) {
+    bool isweighted=is_weighted();
+    ++counter;
+    vertex &v=node(i);
+    v.set_number(counter);
+    gen w(1);
+    for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
+        if (node(*it).subgraph()!=0)
+            continue;
+        if (*it!=t)
+            Q.insert(*it);
+        if (isweighted)
+            get_edge_attribute(i,*it,_GT_ATTRIB_WEIGHT,w);
+        if (is_strictly_greater(l[i]+w,l[*it],ctx))
+            l[*it]=l[i]+w;
+        timestamp[*it]=isweighted?l[*it]:gen(counter);
+    }
+    Q.erase(i);
+    v.set_subgraph(1);
+    if (Q.empty()) {
+        node(t).set_number(node_count());
+        return;
+    }
+    /* update blocks */
+    vector<iset> B;
+    vector<ipairs> blocks;
+    find_blocks(blocks,0);
+    int nb=blocks.size();
+    B.resize(nb);
+    for (vector<ipairs>::const_iterator it=blocks.begin();it!=blocks.end();++it) {
+        iset &b=B[it-blocks.begin()];
+        for (ipairs_iter jt=it->begin();jt!=it->end();++jt) {
+            b.insert(jt->first);
+            b.insert(jt->second);
+        }
+    }
+    iset df;
+    bool has_root=false;
+    if (nb>1) { // G-v is not biconnected
+        ivector cv;
+        find_cut_vertices(cv,0);
+        for (int k=nb;k-->0;) {
+            iset &b=B[k];
+            if (!has_root && b.find(t)!=b.end()) { // root block, delete it
+                B.erase(B.begin()+k);
+                has_root=true;
+            } else {
+                sets_intersection(cv,b,df);
+                if (df.size()!=1) // non-leaf tree node, delete it
+                    B.erase(B.begin()+k);
+                else b.erase(*df.begin()); // b is leaf node, detach it
+            }
+        }
+    }
+    /* recurse */
+    for (vector<iset>::const_iterator it=B.begin();it!=B.end();++it) {
+        sets_intersection(*it,Q,df);
+        if (df.empty()) continue;
+        gen_map m;
+        gen ts,max_ts(undef),min_ts(undef);
+        for (iset_iter jt=df.begin();jt!=df.end();++jt) {
+            ts=timestamp[*jt];
+            max_ts=is_undef(max_ts)?ts:_max(makevecteur(max_ts,ts),ctx);
+            min_ts=is_undef(min_ts)?ts:_min(makevecteur(min_ts,ts),ctx);
+            if (m.find(ts)==m.end())
+                m[ts]=vecteur(1,*jt);
+            else m[ts]._VECTptr->push_back(*jt);
+        }
+        const vecteur &cand=*m[counter<=np?max_ts:min_ts]._VECTptr;
+        int choice=(cand.size()==1?cand.front():cand[rand_integer(cand.size())]).val;
+        strec(choice,t,counter,np,Q,timestamp,l);
+    }
+}
+
+/* impose parametrized st-orientation on this graph with parameter p in [0,1] */
+void graphe::parametrized_st_orientation(int s,int t,double p) {
+    assert(p>=0 && p<=1);
+    int n=node_count(),counter=0,np=(int)(n*p);
+    vecteur timestamp(n,0),l(n,0);
+    iset Q;
+    Q.insert(s);
+    unset_subgraphs(0);
+    strec(s,t,counter,np,Q,timestamp,l);
+    unset_subgraphs();
+}
+
+/* greedy vertex coloring algorithm due to Biggs, also records vertex inclusion time */
+void graphe::greedy_vertex_coloring_biggs(ivector &ordering) {
+    uncolor_all_nodes();
+    int n=node_count(),k=0,i,maxdeg,d,col=0;
+    ordering.resize(n);
+    ivector_iter jt;
+    node_iter it,itend;
+    while (k<n) {
+        ++col;
+        do {
+            maxdeg=-1;
+            i=-1;
+            for (it=nodes.begin(),itend=nodes.end();it!=itend;++it) {
+                if (it->color()>0)
+                    continue;
+                for (jt=it->neighbors().begin();jt!=it->neighbors().end();++jt) {
+                    if (node(*jt).color()==col)
+                        break;
+                }
+                if (jt==it->neighbors().end() && (maxdeg<0 || (d=it->neighbors().size())>maxdeg)) {
+                    maxdeg=d;
+                    i=it-nodes.begin();
+                }
+            }
+            if (i>=0) {
+                node(i).set_color(col);
+                ordering[k++]=i;
+            }
+        } while (i>=0);
+    }
+}
+
+/* classical greedy vertex coloring algorithm, time complexity O(n+m) */
+int graphe::greedy_vertex_coloring(const ivector &p) {
+    if (is_directed()) {
+        graphe G(ctx,false);
+        underlying(G);
+        return G.greedy_vertex_coloring(p);
+    }
+    uncolor_all_nodes();
+    int c=0,k;
+    std::set<int> used;
+    for (ivector_iter it=p.begin();it!=p.end();++it) {
+        vertex &v=node(*it);
+        if (c==0) {
+            v.set_color(++c);
+            continue;
+        }
+        used.clear();
+        for (ivector_iter jt=v.neighbors().begin();jt!=v.neighbors().end();++jt) {
+            vertex &v=node(*jt);
+            if (v.color()>0)
+                used.insert(v.color());
+        }
+        k=1;
+        for (std::set<int>::const_iterator jt=used.begin();jt!=used.end();++jt) {
+            if (*jt>k)
+                break;
+            ++k;
+        }
+        v.set_color(k);
+        if (k>c)
+            c=k;
+    }
+    return c;
+}
+
+/* get color of the i-th node, either as attribute or from vertex */
+int graphe::get_node_color(int i) const {
+    int c;
+    const vertex &v=node(i);
+    attrib_iter it;
+    if (supports_attributes()) {
+        c=default_vertex_color;
+        if ((it=v.attributes().find(_GT_ATTRIB_COLOR))!=v.attributes().end()) {
+            c=it->second.val;
+        }
+    } else c=v.color();
+    return c;
+}
+
+/* extract colors of the vertices and return them in order */
+void graphe::get_node_colors(ivector &colors) const {
+    colors.resize(node_count());
+    node_iter it=nodes.begin(),itend=nodes.end();
+    ivector::iterator jt=colors.begin();
+    for (;it!=itend;++it,++jt) {
+        *jt=it->color();
+    }
+}
+
+/* return true iff the graph is bipartite, time complexity O(n+m) */
+bool graphe::is_bipartite(ivector &V1,ivector &V2,int sg,gt_conn_check cc) {
+    assert(node_queue.empty());
+    int s,cmp;
+    switch (cc) {
+    case _GT_CC_CONNECTED:
+        break;
+    case _GT_CC_COMPONENTS_ARE_SUBGRAPHS:
+    case _GT_CC_FIND_COMPONENTS:
+        if (is_directed()) {
+            graphe G(ctx,false);
+            underlying(G);
+            return G.is_bipartite(V1,V2,sg,cc);
+        }
+        V1.clear(); V1.reserve(node_count());
+        V2.clear(); V2.reserve(node_count());
+        s=(cc==_GT_CC_COMPONENTS_ARE_SUBGRAPHS || sg<0)?1:1+max_subgraph_index();
+        cmp=(cc==_GT_CC_FIND_COMPONENTS)?connected_components_to_subgraphs(sg):max_subgraph_index();
+        for (;s<=cmp;++s) {
+            if (!is_bipartite(V1,V2,s,_GT_CC_CONNECTED))
+                return false;
+            if (cc==_GT_CC_FIND_COMPONENTS)
+                renumber_subgraph(s,sg);
+        }
+        return true;
+    default: assert(false);
+    }
+    // sg >= 0
+    uncolor_all_nodes(-1,sg);
+    int i=first_vertex_from_subgraph(sg);
+    assert(i>=0);
+    node(i).set_color(1);
+    node_queue.push(i);
+    ivector_iter it,itend;
+    while (!node_queue.empty()) {
+        i=node_queue.front();
+        node_queue.pop();
+        vertex &v=node(i);
+        for (it=v.neighbors().begin(),itend=v.neighbors().end();it!=itend;++it) {
+            vertex &w=node(*it);
+            if (sg>=0 && w.subgraph()!=sg)
+                continue;
+            if (w.color()==-1) {
+                w.set_color(1-v.color());
+                node_queue.push(*it);
+            } else if (w.color()==v.color()) {
+                clear_node_queue();
+                return false;
+            }
+        }
+    }
+    node_iter nt=nodes.begin(),ntend=nodes.end();
+    for (i=0;nt!=ntend;++nt,++i) {
+        if (sg>=0 && nt->subgraph()!=sg)
+            continue;
+        if (nt->color()==1)
+            V1.push_back(i);
+        else V2.push_back(i);
+    }
+    return true;
+}
+
+/* place vertices from partitions v1 and v2 on two parallel lines */
+void graphe::make_bipartite_layout(layout &x,const ivector &p1,const ivector &p2) {
+    double aspect_ratio;
+    int n1=p1.size(),n2=p2.size(),n=std::max(n1,n2);
+    assert(n1>1 && n2>1);
+    if (n<3)
+        aspect_ratio=1.0;
+    else if (n<5)
+        aspect_ratio=PLASTIC_NUMBER;
+    else if (n<8)
+        aspect_ratio=PLASTIC_NUMBER_2;
+    else
+        aspect_ratio=PLASTIC_NUMBER_3;
+    double step1=aspect_ratio/(double)(n1-1),step2=aspect_ratio/(double)(n2-1),xpos=0.0,ypos=1.0;
+    x.resize(node_count());
+    for (ivector_iter it=p1.begin();it!=p1.end();++it) {
+        point &p=x[*it];
+        p.resize(2);
+        p.front()=xpos;
+        p.back()=ypos;
+        xpos+=step1;
+    }
+    xpos=ypos=0.0;
+    for (ivector_iter it=p2.begin();it!=p2.end();++it) {
+        point &p=x[*it];
+        p.resize(2);
+        p.front()=xpos;
+        p.back()=ypos;
+        xpos+=step2;
+    }
+}
+
+/* place the vertices of a connected graph by using the eigenvectors of the normalized
+ * Laplacian belonging to its d smallest nonzero eigenvalues as coordinates (Koren's
+ * degree-normalized eigenvectors), return false if the layout could not be computed */
+bool graphe::make_spectral_layout(layout &x,int d,double tol,int maxiter) const {
+    int n=node_count(),i,j;
+    if (n<=d)
+        return false;
+    const csr_adjacency &A=adjacency_snapshot();
+    dvector s(n),lambda,U;
+    for (i=0;i<n;++i) {
+        if (A.degree(i)==0)
+            return false;
+        s[i]=std::sqrt(double(A.degree(i)));
+    }
+    sparse_matrix L;
+    L.laplacian(A,false,true);
+    lanczos S(L);
+    S.deflate(s);
+    if (!S.eigenpairs(d,false,lambda,&U,tol,maxiter))
+        return false;
+    x.resize(n);
+    for (i=0;i<n;++i) {
+        point &p=x[i];
+        p.resize(d);
+        for (j=0;j<d;++j) {
+            p[j]=U[j*n+i]/s[i];
+        }
+    }
+    return true;
+}
+
+/* construct the plane dual of a planar graph with the given faces with time complexity O(n),
+* each face must be a list of vertex indices */
+void graphe::make_plane_dual(const ivectors &faces) {
+    this->clear();
+    set_directed(false);
+    reserve_nodes(faces.size());
+    if (supports_attributes()) {
+        vecteur labels;
+        make_default_labels(labels,faces.size());
+        add_nodes(labels);
+    } else add_nodes(faces.size());
+    int nc=0;
+    for (ivectors_iter it=faces.begin();it!=faces.end();++it) {
+        for (ivector_iter jt=it->begin();jt!=it->end();++jt) {
+            if (*jt>nc)
+                nc=*jt;
+        }
+    }
+    edgemap emap(++nc);
+    map<int,int>::const_iterator et;
+    int i,j,v,w,f,n;
+    for (ivectors_iter it=faces.begin();it!=faces.end();++it) {
+        f=it-faces.begin();
+        const ivector &face=*it;
+        n=face.size();
+        for (int k=0;k<n;++k) {
+            i=face[k];
+            j=face[(k+1)%n];
+            v=i<j?i:j;
+            w=i<j?j:i;
+            map<int,int> &m=emap[v];
+            if ((et=m.find(w))==m.end())
+                m[w]=f;
+            else add_edge(f,et->second);
+        }
+    }
+}
+
+/* return the number of different colors adjacent to the i-th vertex in a partially colored graph */
+int graphe::saturation_degree(const vertex &v,std::set<int> &colors) const {
+    int i,c;
+    colors.clear();
+    for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
+        i=*it;
+        const vertex &w=node(i);
+        if ((c=w.color())>0)
+            colors.insert(c);
+    }
+    return colors.size();
+}
+
+/* return the degree of v in the uncolored subgraph of this graph */
+int graphe::uncolored_degree(const vertex &v) const {
+    int deg=0;
+    for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
+        if (node(*it).color()==0)
+            ++deg;
+    }
+    return deg;
+}
+
+/* return true iff this graph has at least one uncolored (white) vertex */
+bool graphe::is_partially_colored() const {
+    node_iter it=nodes.begin(),itend=nodes.end();
+    for (;it!=itend;++it) {
+        if (it->color()==0)
+            return true;
+    }
+    return false;
+}
+
+/* heuristic algorithm by Brelaz for nearly optimal vertex coloring, complexity O(n*m) */
+void graphe::dsatur() {
+    int col,i,sat,maxsat,deg,maxdeg=0;
+    std::set<int> colors,maxcolors;
+    ivector indices;
+    node_iter nt=nodes.begin(),ntend=nodes.end();
+    for (i=0;nt!=ntend;++nt,++i) {
+        if (nt->color()==0)
+            indices.push_back(i);
+    }
+    if (indices.empty())
+        return;
+    ivector::iterator pos,it,itend;
+    std::set<int>::const_iterator jt,jtend;
+    do {
+        maxsat=-1;
+        i=-1;
+        for (it=indices.begin(),itend=indices.end();it!=itend;++it) {
+            const vertex &v=node(*it);
+            if ((sat=saturation_degree(v,colors))>maxsat ||
+                    (sat==maxsat && (deg=uncolored_degree(v))>maxdeg)) {
+                if (sat==maxsat)
+                    maxdeg=deg;
+                maxsat=sat;
+                maxcolors=colors;
+                i=*it;
+                pos=it;
+            }
+        }
+        if (i>=0) {
+            col=1;
+            for (jt=maxcolors.begin(),jtend=maxcolors.end();jt!=jtend;++jt) {
+                if (*jt==col)
+                    ++col;
+                else break;
+            }
+            node(i).set_color(col);
+            indices.erase(pos);
+        }
+    } while (i>=0);
+}
+
+/* return the total number of different nonzero vertex colors in this graph */
+int graphe::color_count() const {
+    std::set<int> colors;
+    node_iter it=nodes.begin(),itend=nodes.end();
+    for (;it!=itend;++it) {
+        colors.insert(it->color());
+    }
+    return colors.size();
+}
+
+/* return true iff the vertices can be colored using at most k different colors,
+* the vertices will be colored after the function returns */
+bool graphe::is_vertex_colorable(int k) {
+    assert(k>=0);
+    if (k==0) {
+        uncolor_all_nodes();
+        return true;
+    }
+    if (k>node_count()) {
+        message(1,"there are more colors than vertices");
+        return false;
+    }
+    /* try greedy coloring first (linear time), use random order of vertices */
+    ivector sigma=rand_permu(node_count());
+    if (greedy_vertex_coloring(sigma)<=k)
+        return true;
+    /* next try dsatur algorithm (quadratic time) */
+    uncolor_all_nodes();
+    dsatur();
+    if (color_count()<=k)
+        return true;
+    /* finally resort to solving MIP problem */
+    return exact_vertex_coloring(k)!=0;
+}
+
+/* return the lower and the upper bound for chromatic number (inclusive) */
+graphe::ipair graphe::chromatic_number_bounds() {
+    /* the lower bound is the size of maximum clique */
+    ivector clique;
+    ostergard ost(this,3.0); // with timeout
+    int lb=ost.maxclique(clique);
+    /* the upper bound is given by heuristic dsatur algorithm */
+    uncolor_all_nodes();
+    for (ivector_iter it=clique.begin();it!=clique.end();++it) {
+        node(*it).set_color(it-clique.begin()+1);
+    }
+    dsatur();
+    int ub=color_count();
+    return make_pair(lb,ub);
+}
+
+/* store custom vertex coordinates */
+void graphe::store_layout(const layout &x) {
+    assert(int(x.size())>=node_count());
+    for (layout_iter it=x.begin();it!=x.end();++it) {
+        vertex &v=node(it-x.begin());
+        v.set_attribute(_GT_ATTRIB_POSITION,point2gen(*it));
+    }
+}
+
+/* retrieve the previously stored layout, return true iff successful */
+bool graphe::has_stored_layout(layout &x) const {
+    x.resize(node_count());
+    attrib_iter ait;
+    int dim=0,i=0;
+    node_iter it=nodes.begin(),itend=nodes.end();
+    for (;it!=itend;++it,++i) {
+        const attrib &attr=it->attributes();
+        point &p=x[i];
+        if ((ait=attr.find(_GT_ATTRIB_POSITION))==attr.end() ||
+                !gen2point(ait->second,p,ctx) || (dim>0 && int(p.size())!=dim))
+            return false;
+        if (dim==0)
+            dim=p.size();
+    }
+    return true;
+}
+
+bool graphe::bipartite_matching_bfs(ivector &dist,int sg) {
+    assert(node_queue.empty() && sg>=0);
+    int u,v;
+    node_iter it=nodes.begin(),itend=nodes.end();
+    ivector_iter jt,jtend;
+    for (u=0;it!=itend;++it,++u) {
+        if (it->subgraph()!=sg || it->color()!=1)
+            continue;
+        if (it->number()==0) {
+            dist[u+1]=0;
+            node_queue.push(u);
+        } else dist[u+1]=rand_max2;
+    }
+    dist.front()=rand_max2;
+    while (!node_queue.empty()) {
+        u=node_queue.front();
+        node_queue.pop();
+        if (dist[u+1]<dist.front()) {
+            vertex &U=node(u);
+            for (jt=U.neighbors().begin(),jtend=U.neighbors().end();jt!=jtend;++jt) {
+                v=*jt;
+                vertex &V=node(v);
+                if (V.subgraph()==sg && dist[V.number()]==rand_max2) {
+                    dist[V.number()]=dist[u+1]+1;
+                    node_queue.push(V.number()-1);
+                }
+            }
+        }
+    }
+    return dist.front()!=rand_max2;
+}
+
+bool graphe::bipartite_matching_dfs(int u,ivector &dist,int sg) {
+    assert(sg>=0);
+    if (u>0) {
+        int v;
+        vertex &U=node(u-1);
+        for (ivector_iter it=U.neighbors().begin();it!=U.neighbors().end();++it) {
+            v=*it;
+            vertex &V=node(v);
+            if (V.subgraph()==sg && dist[V.number()]==dist[u]+1) {
+                if (bipartite_matching_dfs(V.number(),dist,sg)) {
+                    V.set_number(u);
+                    U.set_number(v+1);
+                    return true;
+                }
+            }
+        }
+        dist[u]=rand_max2;
+        return false;
+    }
+    return true;
+}
+
+/* find maximum matching in a bipartite graph using Hopcroft-Karp algorithm */
+void graphe::bipartite_matching(const ivector &p1,const ivector &p2,ipairs &matching,int sg,gt_conn_check cc) {
+    int cmp,s;
+    switch (cc) {
+    case _GT_CC_CONNECTED:
+        break;
+    case _GT_CC_COMPONENTS_ARE_SUBGRAPHS:
+    case _GT_CC_FIND_COMPONENTS:
+        matching.clear();
+        s=(cc==_GT_CC_COMPONENTS_ARE_SUBGRAPHS || sg<0)?1:1+max_subgraph_index();
+        cmp=(cc==_GT_CC_FIND_COMPONENTS)?connected_components_to_subgraphs(sg):max_subgraph_index();
+        for (;s<=cmp;++s) {
+            int sz=subgraph_size(s);
+            assert(sz!=0);
+            if (sz==1)
+                ;
+            else if (sz<=3) {
+                int i=first_vertex_from_subgraph(s);
+                assert(!node(i).neighbors().empty());
+                int j=node(i).neighbors().front();
+                matching.push_back(make_pair(std::min(i,j),std::max(i,j)));
+            } else bipartite_matching(p1,p2,matching,s,_GT_CC_CONNECTED);
+            if (cc==_GT_CC_FIND_COMPONENTS)
+                renumber_subgraph(s,sg);
+        }
+        return;
+    default: assert(false);
+    }
+    // sg >= 0
+    ivector_iter it,itend;
+    for (it=p1.begin(),itend=p1.end();it!=itend;++it) {
+        if (node(*it).subgraph()==sg)
+            set_node_color(*it,1);
+    }
+    for (it=p2.begin(),itend=p2.end();it!=itend;++it) {
+        if (node(*it).subgraph()==sg)
+            set_node_color(*it,2);
+    }
+    for (vector<vertex>::iterator it=nodes.begin();it!=nodes.end();++it) {
+        it->set_number(0);
+    }
+    ivector dist(node_count()+1);
+    int count=0,u,v;
+    node_iter nt,ntend=nodes.end();
+    while (bipartite_matching_bfs(dist,sg)) {
+        for (u=0,nt=nodes.begin();nt!=ntend;++nt,++u) {
+            if (nt->subgraph()!=sg || nt->color()!=1)
+                continue;
+            if (nt->number()==0 && bipartite_matching_dfs(u+1,dist,sg))
+                ++count;
+        }
+    }
+    /* extract matching */
+    for (u=0,nt=nodes.begin();nt!=ntend;++nt,++u) {
+        if (nt->subgraph()!=sg || nt->color()!=1)
+            continue;
+        v=nt->number();
+        if (v>0) {
+            matching.push_back(make_pair(std::min(u,v-1),std::max(u,v-1)));
+            --count;
+        }
+    }
+    assert(count==0);
+}
+
+/* find a maximum/minimum weighted matching in bipartite graph, return true iff successful */
+bool graphe::weighted_bipartite_matching(const ivector &p1,const ivector &p2,ipairs &matching,
+        bool minimize,double eps,int sg,gt_conn_check cc) {
+    int cmp,s;
+    switch (cc) {
+    case _GT_CC_CONNECTED:
+        break;
+    case _GT_CC_COMPONENTS_ARE_SUBGRAPHS:
+    case _GT_CC_FIND_COMPONENTS:
+        assert(supports_attributes());
+        if (is_null() || is_directed() || !is_weighted())
+            return false;
+        if (is_empty())
+            return true;
+        matching.clear();
+        s=(cc==_GT_CC_COMPONENTS_ARE_SUBGRAPHS || sg<0)?1:1+max_subgraph_index();
+        cmp=(cc==_GT_CC_FIND_COMPONENTS)?connected_components_to_subgraphs(sg):max_subgraph_index();
+        for (;s<=cmp;++s) {
+            int sz=subgraph_size(s);
+            assert(sz>0);
+            if (sz==1)
+                continue;
+            if (!weighted_bipartite_matching(p1,p2,matching,minimize,eps,s,_GT_CC_CONNECTED))
+                return false;
+            if (cc==_GT_CC_FIND_COMPONENTS)
+                renumber_subgraph(s,sg);
+        }
+        return true;
+    default: assert(false);
+    }
+    //sg >= 0
+    int n1,n2,i,j;
+    matrice W;
+    weight_matrix(W);
+    gen f;
+    ivector P,Q; // filtered partitions
+    P.reserve(p1.size());
+    Q.reserve(p2.size());
+    for (ivector_iter it=p1.begin();it!=p1.end();++it) {
+        if (node(*it).subgraph()==sg)
+            P.push_back(*it);
+    }
+    n1=P.size();
+    for (ivector_iter it=p2.begin();it!=p2.end();++it) {
+        if (node(*it).subgraph()==sg)
+            Q.push_back(*it);
+    }
+    n2=Q.size();
+    for (ivector_iter it=P.begin();it!=P.end();++it) {
+        for (ivector_iter jt=node(*it).neighbors().begin();jt!=node(*it).neighbors().end();++jt) {
+            if (node(*jt).subgraph()!=sg)
+                continue;
+            if(find(Q.begin(),Q.end(),*jt)==Q.end())
+                return false; // not bipartite
+            const gen &w=W[*it][*jt];
+            if (w.is_integer())
+                continue;
+            if (!is_real_number(f,ctx)) {
+                message(2,"edge weights must be real");
+                return false;
+            }
+            if (!is_rational(w))
+                W[*it]._VECTptr->at(*jt)=to_real_number(f,ctx);
+        }
+    }
+#if 0 //def HAVE_LIBGLPK
+    /* integralize the weight matrix */
+    if (!is_integer_matrice(W,true))
+        W=*_apply(makesequence(at_round,divvecteur(W,eps)),ctx)._VECTptr;
+    if (minimize) W=multvecteur(-1,W);
+    gen minw=_min(_min(W,ctx),ctx);
+    /* create the assignment problem as a GLPK graph */
+    glp_graph *G;
+    G=glp_create_graph(sizeof(wbm_v_data),sizeof(wbm_a_data));
+    int start1=glp_add_vertices(G,n1);
+    int start2=glp_add_vertices(G,n2);
+    glp_arc *a;
+    glp_vertex *v;
+    for (i=0;i<std::max(n1,n2);++i) {
+        if (i<n1) ((wbm_v_data*)(G->v)[start1+i]->data)->set=0;
+        if (i<n2) ((wbm_v_data*)(G->v)[start2+i]->data)->set=1;
+    }
+    for (ivector_iter it=P.begin();it!=P.end();++it) {
+        i=it-P.begin();
+        for (ivector_iter jt=node(*it).neighbors().begin();jt!=node(*it).neighbors().end();++jt) {
+            if (sg>=0 && node(*jt).subgraph()!=sg)
+                continue;
+            j=find(Q.begin(),Q.end(),*jt)-Q.begin();
+            a=glp_add_arc(G,U_start+i,V_start+j);
+            ((wbm_a_data*)a->data)->cost=(W[*it][*jt]-minw).val;
+        }
+    }
+    /* solve the problem using out-of-kilter algorithm */
+    int res=glp_asnprob_okalg(GLP_ASN_MMP,G,
+                offsetof(wbm_v_data,set),offsetof(wbm_a_data,cost),NULL,offsetof(wbm_a_data,x));
+    if (res!=0) {
+        if (verbose)
+            message("Error: GLPK solver error %d",res);
+        glp_delete_graph(G);
+        return false;
+    }
+    /* retrieve the matching */
+    for (i=0;i<n1;++i) {
+        glp_vertex *v=G->v[U_start+i];
+        for (a=v->out;a!=NULL;a=a->t_next) {
+            if (((wbm_a_data*)a->data)->x==0)
+                continue;
+            j=a->head->i;
+            assert(j-V_start>=0);
+            if (has_edge(U[i],V[j-V_start]))
+                matching.push_back(make_pair(U[i],Q[j-V_start]));
+        }
+    }
+    glp_delete_graph(G);
+    return true;
+#else
+    /* convert the assignment problem to transportation problem */
+    if (!minimize) W=multvecteur(-1,W);
+    gen minw=_min(_min(W,ctx),ctx);
+    int n=std::max(n1,n2);
+    vecteur sd(n,1);
+    gen M=identificateur(" M");
+    _purge(M,ctx);
+    tprob prob(sd,sd,M,ctx);
+    matrice C=*_matrix(makesequence(n,n,0),ctx)._VECTptr;
+    for (ivector_iter it=P.begin();it!=P.end();++it) {
+        i=it-P.begin();
+        for (ivector_iter jt=Q.begin();jt!=Q.end();++jt) {
+            j=jt-Q.begin();
+            C[i]._VECTptr->at(j)=has_edge(*it,*jt)?W[*it][*jt]-minw:M;
+        }
+    }
+    matrice sol;
+    prob.solve(C,sol);
+    /* retrieve the matching */
+    for (ivector_iter it=P.begin();it!=P.end();++it) {
+        i=it-P.begin();
+        for (ivector_iter jt=Q.begin();jt!=Q.end();++jt) {
+            j=jt-Q.begin();
+            if (giac::is_one(sol[i][j])) {
+                if (!has_edge(P[i],Q[j]))
+                    return false;
+                matching.push_back(make_pair(P[i],Q[j]));
+                break;
+            }
+        }
+    }
+    return true;
+#endif
+}
+
+/* construct the line graph of this graph */
+void graphe::line_graph(graphe &G,ipairs &E) const {
+    assert(supports_attributes() || !G.supports_attributes());
+    if (E.empty())
+        get_edges_as_pairs(E);
+    G.clear();
+    G.reserve_nodes(E.size());
+    bool isdir=G.is_directed();
+    G.set_directed(isdir);
+    if (G.supports_attributes()) {
+        vecteur labels;
+        gen label;
+        for (ipairs_iter it=E.begin();it!=E.end();++it) {
+            label=_cat(makesequence(node_label(it->first),str2gen("-",true),node_label(it->second)),ctx);
+            labels.push_back(label);
+        }
+        G.add_nodes(labels);
+    } else G.add_nodes(E.size());
+    int i,j;
+    for (ipairs_iter it=E.begin();it!=E.end();++it) {
+        i=it-E.begin();
+        for (ipairs_iter jt=(isdir?E.begin():it+1);jt!=E.end();++jt) {
+            j=jt-E.begin();
+            if (i==j) continue;
+            if ((isdir && it->second==jt->first) || (!isdir && edges_incident(*it,*jt)))
+                G.add_edge(i,j);
+        }
+    }
+}
+
+/* construct the transitive closure of this graph */
+void graphe::transitive_closure(graphe &G,bool weighted) {
+    int n=node_count();
+    bool isdir=is_directed(),iswei=is_weighted();
+    G.clear();
+    G.set_directed(isdir);
+    G.set_weighted(weighted);
+    G.reserve_nodes(n);
+    G.add_nodes(vertices());
+    if (weighted) {
+        matrice m;
+        gen wgh;
+        ivector dist,J(n-1);
+        int cnt;
+        if (iswei)
+            allpairs_distance(m);
+        for (int i=0;i<n;++i) {
+            if (!iswei) {
+                cnt=0;
+                for (int k=0;k<n;++k) {
+                    if (k!=i)
+                        J[cnt++]=k;
+                }
+                distance(i,J,dist);
+            }
+            for (int j=isdir?0:i+1;j<n;++j) {
+                if (i==j)
+                    continue;
+                if ((iswei && !is_inf(wgh=m[i][j])) ||
+                        (!iswei && is_positive(wgh=dist[j<i?j:j-1],ctx)))
+                    G.add_edge(i,j,wgh);
+            }
+        }
+    } else {
+        for (int i=0;i<n;++i) {
+            dfs(i,false);
+            for (int j=isdir?0:i+1;j<n;++j) {
+                if (i==j)
+                    continue;
+                if (node(j).is_visited())
+                    G.add_edge(i,j);
+            }
+        }
+    }
+}
+
+#ifdef HAVE_LIBPTHREAD
+static pthread_mutex_t nauty_mutex=PTHREAD_MUTEX_INITIALIZER; // nauty uses static workspace
+#endif
+
+/* compute the canonical labeling and the canonical certificate of this graph
+ * (vertex colors are taken into account if colored=true) unless they are cached,
+ * return false if nauty is not available. The colors may be changed in many ways
+ * (including traversals of graphs without attributes), so they are compared with
+ * those stored with the cached certificate instead of tracking the changes. */
+bool graphe::compute_canonical_form(bool colored) const {
+#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
+    int n=node_count(),sz,i;
+    if (!canonical_cert.empty() && canonical_colored==colored) {
+        if (!colored)
+            return true;
+        for (i=0;i<n && i<int(canonical_colors.size()) && get_node_color(i)==canonical_colors[i];++i);
+        if (i==n && n==int(canonical_colors.size()))
+            return true;
+    }
+    size_t cg_sz=n>0?nautywrapper_words_needed(n)*(size_t)n:0;
+    canonical_lab.resize(n);
+    canonical_cert.resize(2+n+cg_sz);
+    canonical_cert[0]=is_directed()?1:0;
+    canonical_cert[1]=n;
+    canonical_colored=colored;
+    canonical_colors.resize(colored?n:0);
+    for (i=0;colored && i<n;++i) {
+        canonical_colors[i]=get_node_color(i);
+    }
+    if (n==0)
+        return true;
+    int *adj=to_array(sz,colored);
+    ivector col(n);
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE,NULL);
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&nauty_mutex);
+#endif
+    nautywrapper_canonical(is_directed()?1:0,n,adj,&canonical_lab.front(),&canonical_cert[2+n],&col.front());
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&nauty_mutex);
+#endif
+    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE,NULL);
+    for (int i=0;i<n;++i) {
+        canonical_cert[2+i]=col[i];
+    }
+    delete[] adj;
+    return true;
+#else
+    return false;
+#endif
+}
+
+/* store the canonical certificate of this graph to cert, return false if nauty is not available.
+ * Two graphs are isomorphic iff their certificates are equal. */
+bool graphe::canonical_certificate(vector<ulong> &cert,bool colored) const {
+    if (!compute_canonical_form(colored))
+        return false;
+    cert=canonical_cert;
+    return true;
+}
+
+/* return true iff this graph is isomorphic to other, also obtain an isomorphism */
+bool graphe::is_isomorphic(graphe &other,map<int,int> &isom,bool use_colors) {
+    if (is_directed()!=other.is_directed())
+        return false;
+    int n=node_count();
+    if (other.node_count()!=n || edge_count()!=other.edge_count())
+        return false;
+#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
+    compute_canonical_form(use_colors);
+    other.compute_canonical_form(use_colors);
+    if (canonical_cert!=other.canonical_cert)
+        return false;
+    /* obtain the isomorphism */
+    isom.clear();
+    for (int i=0;i<n;++i) {
+        isom[canonical_lab[i]]=other.canonical_lab[i];
+    }
+    return true;
+#else
+    ivector d1=degree_sequence(),d2=other.degree_sequence();
+    std::sort(d1.begin(),d1.end());
+    std::sort(d2.begin(),d2.end());
+    if (d1!=d2 || connected_component_count()!=other.connected_component_count())
+        return false;
+    /* use the VF2++ algorithm */
+    ivectors uv;
+    subgraph_isomorphism(other,1,true,uv);
+    if (uv.empty())
+        return false;
+    else {
+        isom.clear();
+        for (int i=0;i<n;++i) {
+            isom[uv.front()[i]]=i;
+        }
+        return true;
+    }
+#endif
+}
+
+/* store the indices of graphs in G which are not isomorphic to any of their predecessors to rep,
+ * graphs are grouped by their canonical certificates (or by simple invariants if nauty is not available) */
+void graphe::nonisomorphic_representatives(const vector<graphe*> &G,ivector &rep) {
+    map<vector<ulong>,ivector> classes;
+    map<int,int> isom;
+    vector<ulong> key;
+    rep.clear();
+    for (vector<graphe*>::const_iterator it=G.begin();it!=G.end();++it) {
+        if (interrupted || ctrl_c)
+            throw std::runtime_error("Stopped by user interruption");
+        graphe *g=*it;
+        int i=it-G.begin();
+        if (g->canonical_certificate(key)) {
+            ivector &c=classes[key];
+            if (c.empty()) {
+                c.push_back(i);
+                rep.push_back(i);
+            }
+            continue;
+        }
+        /* compare with the graphs which share the same invariants */
+        ivector deg=g->degree_sequence();
+        std::sort(deg.begin(),deg.end());
+        key.resize(3);
+        key[0]=g->is_directed()?1:0;
+        key[1]=g->node_count();
+        key[2]=g->edge_count();
+        key.insert(key.end(),deg.begin(),deg.end());
+        ivector &c=classes[key];
+        ivector_iter jt=c.begin();
+        for (;jt!=c.end();++jt) {
+            if (g->is_isomorphic(*G[*jt],isom))
+                break;
+        }
+        if (jt==c.end()) {
+            c.push_back(i);
+            rep.push_back(i);
+        }
+    }
+}
+
+/* passes the automorphism generators obtained by nauty to a list of permutations */
+struct aut_generator_collector {
+    vecteur *out;
+    int ofs;
+};
+
+/* store the permutation perm as a list of disjoint cycles of length at least two */
+static void store_aut_generator(int n,const int *perm,void *data) {
+    aut_generator_collector *ag=static_cast<aut_generator_collector*>(data);
+    vector<bool> seen(n,false);
+    vecteur cycles;
+    for (int i=0;i<n;++i) {
+        if (seen[i] || perm[i]==i)
+            continue;
+        vecteur cycle;
+        for (int j=i;!seen[j];j=perm[j]) {
+            seen[j]=true;
+            cycle.push_back(ag->ofs+j);
+        }
+        cycles.push_back(cycle);
+    }
+    ag->out->push_back(gen(cycles,_LIST__VECT));
+}
+
+/* return the set of generators of the automorphism group of this graph */
+gen graphe::aut_generators() const {
+#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
+    int n=node_count(),sz;
+    vecteur out(0);
+    if (n>0) {
+        int *adj=to_array(sz,true);
+        aut_generator_collector ag;
+        ag.out=&out;
+        ag.ofs=array_start(ctx);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE,NULL);
+#ifdef HAVE_LIBPTHREAD
+        pthread_mutex_lock(&nauty_mutex);
+#endif
+        nautywrapper_aut_generators(is_directed()?1:0,n,adj,store_aut_generator,static_cast<void*>(&ag));
+#ifdef HAVE_LIBPTHREAD
+        pthread_mutex_unlock(&nauty_mutex);
+#endif
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE,NULL);
+        delete[] adj;
+    }
+    return gen(out,_LIST__VECT);
+#else
+    return gensizeerr("nauty library is required for finding graph automorphisms");
+#endif
+}
+
+/* return the canonical labeling of this graph as a permutation */
+bool graphe::canonical_labeling(ivector &lab) const {
+    if (node_count()==0 || !compute_canonical_form(true))
+        return false;
+    lab=canonical_lab;
+    return true;
+}
+
+/* construct the closure of this graph and store it to G, complexity O(n^3) */
+bool graphe::bondy_chvatal_closure(graphe &G,ivector &d) {
+    underlying(G);
+    int n=node_count(),di;
+    bool yes=false,have_pair;
+    do {
+        have_pair=false;
+        for (int i=0;i<n && !have_pair;++i) {
+            di=d[i];
+            for (int j=i+1;j<n;++j) {
+                if (!G.has_edge(i,j) && di+d[j]>=n) {
+                    G.add_edge(i,j);
+                    ++d[i]; ++d[j];
+                    yes=have_pair=true;
+                    break;
+                }
+            }
+        }
+    } while (have_pair);
+    return yes;
+}
+
+/* return 1 if the graph is Hamiltonian, 0 if it is not and -1 if inconclusive */
+int graphe::hamcond(bool make_closure) {
+    /* test biconnectivity, complexity O(n) */
+    if (!is_biconnected())
+        return 0;
+    int mindeg=rand_max2,deg,n=node_count(),m=edge_count(),i;
+    ivector d=degree_sequence();
+    /* Dirac criterion, complexity O(n) */
+    node_iter it=nodes.begin(),itend=nodes.end();
+    for (i=0;it!=itend;++it,++i) {
+        if ((deg=d[i]=it->neighbors().size())<mindeg)
+            mindeg=deg;
+    }
+    if (2*mindeg>=n)
+        return 1;
+    ivector V1,V2,v;
+    /* unbalanced bipartite graph is not Hamiltonian, complexity O(n+m) */
+    if (is_bipartite(V1,V2) && V1.size()!=V2.size())
+        return 0;
+    /* Ore criterion, complexity O(n^2) */
+    bool yes=true;
+    for (int i=0;i<n && yes;++i) {
+        deg=d[i];
+        for (int j=i+1;j<n;++j) {
+            if (!has_edge(i,j) && deg+d[j]<n) {
+                yes=false;
+                break;
+            }
+        }
+    }
+    if (yes) return 1;
+    if (make_closure) {
+        /* apply the Bondy-Chvátal theorem: the graph is Hamiltonian if
+           and only if its closure is Hamiltonian, complexity O(n^2) */
+        graphe G(ctx);
+        if (bondy_chvatal_closure(G,d))
+            return G.hamcond(false);
+    }
+    if (double(m)/(double(n*n)>1.0-2.0/(1.0+std::exp(.0015*double(n))))) {
+        /* Nash-Williams criterion */
+        int inum=maximum_independent_set(v);
+        if (3*mindeg>=std::max(n+2,3*inum))
+            return 1;
+    }
+    return -1;
+}
+
+/* return true iff the graph is Hamiltonian */
+bool graphe::is_hamiltonian(ivector &hc) {
+    hc.clear();
+    if (!is_directed()) {
+      switch (hamcond()) {
+      case 0: return false;
+      case 1: return true;
+      default: break;
+      }
+    } else {
+        ivectors components;
+        strongly_connected_components(components);  
+        if (components.size()>1) return false; // graph is not strongly connected
+        ivector dv=degree_sequence();
+        bool isham=true;
+        int n=node_count();
+        for (ivector_iter it=dv.begin();it!=dv.end();++it) {
+            if (*it<n) {
+               isham=false;
+               break;
+            }
+        }
+        if (isham) return true;
+        isham=true;
+        for (int i=0;isham && i<n;++i) {
+            for (int j=0;j<n;++j) {
+                if (i==j) continue;
+                if (!has_edge(i,j) && !has_edge(j,i) && dv[i]+dv[j]<2*n-1) {
+                    isham=false;
+                    break;
+                }
+            }
+        }
+        if (isham) return true;
+    }
+    return hamcycle(hc);
+}
+
+bool graphe::hamcycle_recurse(ivector &path,int pos) {
+    if (pos==node_count()) return has_edge(path[pos-1],path[0]);
+    const vertex &v=node(path[pos-1]);
+    for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
+        vertex &w=node(*it);
+        if (w.is_visited()) continue;
+        path[pos]=*it;
+        w.set_visited(true);
+        if (hamcycle_recurse(path,pos+1)) return true;
+        w.set_visited(false);
+    }
+    return false;
+}
+
+bool graphe::hamcycle(ivector &path) {
+    int n=node_count();
+    path.resize(n+1);
+    unvisit_all_nodes();
+    path[0]=0;
+    nodes[0].set_visited(true);
+    if (!hamcycle_recurse(path,1)) return false;
+    path[n]=path[0];
+    return true;
+}
+
+/*
+* TSP CLASS IMPLEMENTATION
+*/
+
+#ifdef HAVE_LIBGLPK
+
+/* MINIMAL CUT implementation, adapted from glpk/examples/tsp (maxflow.c, mincut.c and main.c)
+ * Originally written by Andrew Makhorin <mao@gnu.org>
+ */
+
+/* compute maximal flow */
+int graphe::tsp::max_flow(int nn,int nedg,const ivector &beg,
+        const ivector &end,const ivector &cap,int s,int t,
+        ivector &x) {
+    int k;
+    assert(nn>=2);
+    assert(nedg>=0);
+    assert(1<=s && s<=nn);
+    assert(1<=t && t<=nn);
+    assert(s!=t);
+    for (k=0; k<nedg; k++) {
+        assert(1<=beg[k] && beg[k]<end[k] && end[k]<=nn && cap[k]>0);
+    }
+    glp_prob *lp;
+    glp_smcp smcp;
+    int i,nz,flow,*rn,*cn;
+    double temp,*aa;
+    lp=glp_create_prob();
+    glp_add_rows(lp,nn);
+    for (i=1;i<=nn;++i) {
+        glp_set_row_bnds(lp,i,GLP_FX,0.0,0.0);
+    }
+    glp_add_cols(lp,nedg+1);
+    for (k=0; k<nedg; k++) {
+        glp_set_col_bnds(lp,k+1,GLP_DB,-cap[k],+cap[k]);
+    }
+    glp_set_col_bnds(lp,nedg+1,GLP_FR,0.0,0.0);
+    rn=new int[1+2*(nedg+1)];
+    cn=new int[1+2*(nedg+1)];
+    aa=new double[1+2*(nedg+1)];
+    nz=0;
+    for (k=0;k<nedg;k++) {
+        rn[++nz]=beg[k]; cn[nz]=k+1; aa[nz]=-1.0;
+        rn[++nz]=end[k]; cn[nz]=k+1; aa[nz]=+1.0;
+    }
+    rn[++nz]=t; cn[nz]=nedg+1; aa[nz]=-1.0;
+    rn[++nz]=s; cn[nz]=nedg+1; aa[nz]=+1.0;
+    assert(nz==2*(nedg+1));
+    glp_load_matrix(lp,nz,rn,cn,aa);
+    delete[] rn;
+    delete[] cn;
+    delete[] aa;
+    glp_set_obj_dir(lp,GLP_MAX);
+    glp_set_obj_coef(lp,nedg+1,1.0);
+    int old_term=glp_term_out(GLP_OFF);
+    glp_adv_basis(lp,0);
+    glp_term_out(old_term);
+    glp_init_smcp(&smcp);
+    smcp.msg_lev=GLP_MSG_OFF;
+    assert(glp_simplex(lp,&smcp)==0);
+    assert(glp_get_status(lp)==GLP_OPT);
+    for (k=0;k<nedg;k++) {
+        temp=glp_get_col_prim(lp,k+1);
+        x[k]=(int)floor(temp+.5);
+        assert(std::abs(x[k]-temp)<=1e-6);
+    }
+    temp=glp_get_col_prim(lp,nedg+1);
+    flow=(int)floor(temp+.5);
+    assert(std::abs(flow-temp)<=1e-6);
+    glp_delete_prob(lp);
+    return flow;
+}
+
+/* find min (s,t)-cut for known max flow */
+int graphe::tsp::min_st_cut(int nn,int nedg,const ivector &beg,
+        const ivector &end,const ivector &cap,int s,int t,
+        const ivector &x,ivector &cut) {
+    int i,j,k,p,q,temp;
+    ivector &head1=mincut_data[18]; if (int(head1.size())<nn) head1.resize(nn);
+    ivector &head2=mincut_data[19]; if (int(head2.size())<nn) head2.resize(nn);
+    ivector &next1=mincut_data[20]; if (int(next1.size())<nn) next1.resize(nn);
+    ivector &next2=mincut_data[21]; if (int(next2.size())<nn) next2.resize(nn);
+    for (i=0;i<nn;i++) head1[i]=head2[i]=0;
+    for (k=0;k<nedg;k++) {
+        i=beg[k]-1; next1[k]=head1[i]; head1[i]=k+1;
+        j=end[k]-1; next2[k]=head2[j]; head2[j]=k+1;
+    }
+    ivector &list=mincut_data[4]; list.resize(nn);
+    for (i=0;i<nn;i++) cut[i]=0;
+    p=q=0; list[0]=s; cut[s-1]=1;
+    while (p<=q) {
+        i=list[p++];
         for (k=head1[i-1];k!=0;k=next1[k-1]) {
             j=end[k-1];
             assert(beg[k-1]==i);
@@ -10855,2635 +14161,4537 @@ int graphe::tsp::min_st_cut(int nn,int nedg,const ivector &beg,
                 list[++q]=j; cut[j-1]=1;
             }
         }
-        for (k=head2[i-1];k!=0;k=next2[k-1]) {
-            j=beg[k-1];
-            assert(end[k-1]==i);
-            if (cut[j-1]==0 && x[k-1]>-cap[k-1]) {
-                list[++q]=j; cut[j-1]=1;
+        for (k=head2[i-1];k!=0;k=next2[k-1]) {
+            j=beg[k-1];
+            assert(end[k-1]==i);
+            if (cut[j-1]==0 && x[k-1]>-cap[k-1]) {
+                list[++q]=j; cut[j-1]=1;
+            }
+        }
+    }
+    assert(!cut[t-1]);
+    temp=0;
+    for (k=0;k<nedg;k++) {
+        i=beg[k],j=end[k];
+        if ((cut[i-1] && !cut[j-1]) || (!cut[i-1] && cut[j-1]))
+            temp+=cap[k];
+    }
+    return temp;
+}
+
+/* find min cut with Stoer and Wagner algorithm */
+int graphe::tsp::minimal_cut(int nn,int nedg,const ivector &beg,
+                             const ivector &end,const ivector &cap,ivector &cut) {
+    int k;
+    assert(nn>=2);
+    assert(nedg>=0);
+    for (k=0;k<nedg;k++) {
+        assert(1<=beg[k] && beg[k]<end[k] && end[k]<=nn);
+        assert(cap[k]>0);
+    }
+    int i,j,min_cut,flow,temp,I,J,K,S,T,DEG,NV,NE;
+    ivector &head1=mincut_data[0]; if (int(head1.size())<nn) head1.resize(nn);
+    ivector &head2=mincut_data[1]; if (int(head2.size())<nn) head2.resize(nn);
+    ivector &next1=mincut_data[2]; if (int(next1.size())<nedg) next1.resize(nedg);
+    ivector &next2=mincut_data[3]; if (int(next2.size())<nedg) next2.resize(nedg);
+    for (i=0;i<nn;i++) head1[i]=head2[i]=0;
+    for (k=0;k<nedg;k++) {
+        i=beg[k]; next1[k]=head1[i-1]; head1[i-1]=k+1;
+        j=end[k]; next2[k]=head2[j-1]; head2[j-1]=k+1;
+    }
+    NV=nn;
+    ivector &HEAD=mincut_data[4]; if (int(HEAD.size())<nn) HEAD.resize(nn);
+    ivector &NEXT=mincut_data[5]; if (int(NEXT.size())<nn) NEXT.resize(nn);
+    ivector &NUMB=mincut_data[6]; if (int(NUMB.size())<nn) NUMB.resize(nn);
+    for (i=0;i<nn;i++) {
+        HEAD[i]=i+1; NEXT[i]=0; NUMB[i]=i+1;
+    }
+    ivector &BEG=mincut_data[7]; if (int(BEG.size())<nedg) BEG.resize(nedg);
+    ivector &END=mincut_data[8]; if (int(END.size())<nedg) END.resize(nedg);
+    ivector &CAP=mincut_data[9]; if (int(CAP.size())<nedg) CAP.resize(nedg);
+    ivector &X=mincut_data[10]; if (int(X.size())<nedg) X.resize(nedg);
+    ivector &ADJ=mincut_data[11]; if (int(ADJ.size())<nn) ADJ.resize(nn);
+    ivector &SUM=mincut_data[12]; if (int(SUM.size())<nn) SUM.resize(nn);
+    ivector &CUT=mincut_data[13]; if (int(CUT.size())<nn) CUT.resize(nn);
+    min_cut=rand_max2;
+    while (NV>1) {
+        for (I=0;I<NV;I++) SUM[I]=0.0;
+        for (I=1;I<=NV;I++) {
+            DEG=0;
+            for (i=HEAD[I-1];i!=0;i=NEXT[i-1]) {
+                for (k=head1[i-1];k!=0;k=next1[k-1]) {
+                    j=end[k-1];
+                    J=NUMB[j-1];
+                    if (I>=J)
+                        continue;
+                    if (SUM[J-1]==0.0)
+                        ADJ[DEG++]=J;
+                    assert(cap[k-1]>0.0);
+                    SUM[J-1]+=cap[k-1];
+                }
+                for (k=head2[i-1];k!=0;k=next2[k-1]) {
+                    j=beg[k-1];
+                    J=NUMB[j-1];
+                    if (I>=J)
+                        continue;
+                    if (SUM[J-1]==0.0)
+                        ADJ[DEG++]=J;
+                    assert(cap[k-1]>0.0);
+                    SUM[J-1]+=cap[k-1];
+                }
+            }
+            NE=0;
+            for (K=0;K<DEG;K++) {
+                assert(NE<nedg);
+                J=ADJ[K];
+                BEG[NE]=I; END[NE]=J; CAP[NE]=SUM[J-1];
+                SUM[J-1]=0.0;
+                ++NE;
+            }
+        }
+        S=1; T=NV;
+        flow=max_flow(NV,NE,BEG,END,CAP,S,T,X);
+        if (min_cut>flow)
+        {  min_cut=flow;
+            temp=min_st_cut(NV,NE,BEG,END,CAP,S,T,X,CUT);
+            assert(flow==temp);
+            for (i=0;i<nn;i++) cut[i]=CUT[NUMB[i]-1];
+            if (min_cut==0)
+                break;
+        }
+        assert(T==NV);
+        for (i=HEAD[T-1];i!=0;i=NEXT[i-1]) NUMB[i-1]=S;
+        i=HEAD[S-1];
+        assert(i!=0);
+        while (NEXT[i-1]!=0)
+            i=NEXT[i-1];
+        NEXT[i-1]=HEAD[T-1];
+        NV--;
+    }
+    return min_cut;
+}
+
+/* TSP constructor */
+graphe::tsp::tsp(graphe *gr,double gap_tolerance,bool is_verbose,const layout *x) {
+    assert(!gr->is_directed());
+    G=gr;
+    verbose=is_verbose;
+    gap_tol=gap_tolerance;
+    isweighted=G->is_weighted();
+    ipairs E;
+    G->get_edges_as_pairs(E);
+    edges_comparator comp(G);
+    std::sort(E.begin(),E.end(),comp); // sort edges by weight (ascending)
+    nv=G->node_count();
+    ne=E.size();
+    tour.reserve(nv);
+    obj.resize(ne);
+    xev.resize(ne);
+    can_branch.resize(ne);
+    coeff=new double[ne+1];
+    indices=new int[ne+1];
+    visited=new bool[nv];
+    arcs=new arc[ne];
+    heuristic=new tsp_heuristic(G->adjacency_snapshot(true),x);
+    send_incumbent=false;
+    int i;
+    for (ipairs_iter it=E.begin();it!=E.end();++it) {
+        i=it-E.begin();
+        arc &a=arcs[i];
+        a.head=it->second;
+        a.tail=it->first;
+        loc_map[a.tail][a.head]=i;
+    }
+}
+
+/* TSP destructor */
+graphe::tsp::~tsp() {
+    delete[] coeff;
+    delete[] indices;
+    delete[] visited;
+    delete[] arcs;
+    delete heuristic;
+}
+
+/* create an edge or arc */
+graphe::ipair graphe::tsp::make_edge(int i,int j) const {
+    return make_pair(i<j?i:j,i<j?j:i);
+}
+
+/* return the subgraph index of edge e */
+int graphe::tsp::edge_index(const ipair &e) {
+    return loc_map[e.first][e.second];
+}
+
+/* formulate TSP as MIP, initially without any subtour elimination constraints */
+void graphe::tsp::formulate_mip() {
+    ivectors rows;
+    int nonzeros=0,i,j,k,l,cnt=0,nrows,ncols;
+    for (j=0;j<ne;++j) {
+        const arc &a=arcs[j];
+        obj[j]=weight(a.tail,a.head);
+    }
+    for (j=0;j<nv;++j) {
+        rows.resize(rows.size()+1);
+        ivector &row=rows.back();
+        row.push_back(j);
+        for (i=0;i<nv;++i) {
+            if (i!=j && G->has_edge(i,j)) {
+                row.push_back(i);
+                ++nonzeros;
+            }
+        }
+    }
+    ncols=ne;
+    nrows=rows.size();
+    if (isweighted)
+        nonzeros+=ne;
+    int *ia=new int[nonzeros+1];
+    int *ja=new int[nonzeros+1];
+    double *ar=new double[nonzeros+1];
+    for (ivectors_iter it=rows.begin();it!=rows.end();++it) {
+        const ivector &row=*it;
+        k=it-rows.begin();
+        i=row.front();
+        for (ivector_iter rt=row.begin()+1;rt!=row.end();++rt) {
+            j=*rt;
+            l=edge_index(make_edge(i,j));
+            assert(l<ne);
+            ia[++cnt]=k+1; ja[cnt]=l+1; ar[cnt]=1;
+        }
+    }
+    /* build MIP */
+    glp_add_rows(mip,nrows);
+    double rh=2.0;
+    for (i=0;i<nrows;++i) glp_set_row_bnds(mip,i+1,GLP_FX,rh,rh);
+    if (isweighted) {
+        int r=glp_add_rows(mip,1);
+        double lb=lower_bound();
+        glp_set_row_bnds(mip,r,GLP_LO,lb,DBL_MAX);
+        for (i=0;i<ne;++i) {
+            ia[++cnt]=r; ja[cnt]=i+1; ar[cnt]=obj[i];
+        }
+    }
+    glp_add_cols(mip,ncols);
+    for (j=0;j<ne;++j) {
+        glp_set_col_kind(mip,j+1,GLP_BV);
+        glp_set_obj_coef(mip,j+1,obj[j]);
+    }
+    assert(cnt<=nonzeros);
+    glp_load_matrix(mip,cnt,ia,ja,ar);
+    delete[] ia; delete[] ja; delete[] ar;
+}
+
+/* compute lower bound for the objective function by using a minimal spanning tree */
+double graphe::tsp::lower_bound() {
+    double cost,maxcost=0;
+    for (int i=0;i<nv;++i) {
+        vertex &v=G->node(i);
+        G->unset_subgraphs(0);
+        v.set_subgraph(1);
+        ipairs E;
+        cost=G->minimal_spanning_forest(E,0);
+        dvector c;
+        for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
+            c.push_back(weight(i,*it));
+        }
+        assert(c.size()>1);
+        std::sort(c.begin(),c.end());
+        cost+=c[0];
+        cost+=c[1];
+        if (cost>maxcost)
+            maxcost=cost;
+    }
+    return maxcost;
+}
+
+/* find the subtours (sv) in the subgraph induced by vertices in v */
+bool graphe::tsp::find_tours(int k,ivectors &sv,solution_status &status) {
+    sv.clear();
+    if (k<=0)
+        return true;
+    sv.reserve(k);
+    glp_erase_prob(mip);
+    glp_set_obj_dir(mip,GLP_MIN);
+    formulate_mip();
+    glp_smcp lparm;
+    glp_init_smcp(&lparm);
+    lparm.msg_lev=GLP_MSG_OFF;
+    glp_iocp parm;
+    glp_init_iocp(&parm);
+    parm.msg_lev=GLP_MSG_ON;
+    parm.gmi_cuts=GLP_ON;
+    parm.cov_cuts=GLP_ON;
+    parm.br_tech=GLP_BR_PCH;
+    parm.bt_tech=GLP_BT_BPH;
+    parm.sr_heur=GLP_OFF;
+    parm.cb_func=&callback;
+    parm.cb_info=static_cast<void*>(this);
+    parm.mip_gap=gap_tol;
+    bool retval=true;
+    int res,lres,stat;
+    is_symmetric_tsp=isweighted && G->is_clique();
+    heur_type=is_symmetric_tsp?_GT_TSP_CHRISTOFIDES_SA:(isweighted?_GT_TSP_FARTHEST_INSERTION_HEUR:_GT_TSP_NO_HEUR);
+    int term_old;
+    if (verbose)
+        glp_term_hook(term_hook,static_cast<void*>(logptr(G->giac_context())));
+    else term_old=glp_term_out(GLP_OFF);
+    do {
+        do {
+            /* append subtour elimination constraints */
+            for (set<ivector>::const_iterator it=subtours.begin();it!=subtours.end();++it) {
+                append_sce(*it);
+            }
+            subtours.clear();
+            /* solve */
+            if ((lres=glp_simplex(mip,&lparm))==0 &&
+                ((stat=glp_get_status(mip))==GLP_OPT || stat==GLP_FEAS)) {
+                send_incumbent=sv.empty() && !incumbent.empty();
+                res=glp_intopt(mip,&parm);
+            }
+            else if (lres!=0 || stat==GLP_UNDEF || stat==GLP_UNBND) {
+                status=_GT_TSP_ERROR;
+                break;
+            } else {
+                status=_GT_TSP_NOT_HAMILTONIAN;
+                break;
+            }
+            stat=glp_mip_status(mip);
+            if ((res!=0 && res!=GLP_EMIPGAP && res!=GLP_ESTOP) || stat==GLP_UNDEF) {
+                status=_GT_TSP_ERROR;
+                retval=false;
+                break;
+            }
+            switch (stat) {
+            case GLP_FEAS:
+                G->message(1,"the solution is not necessarily optimal");
+            case GLP_OPT:
+                status=_GT_TSP_OPTIMAL;
+                break;
+            case GLP_NOFEAS:
+                status=_GT_TSP_NOT_HAMILTONIAN;
+                break;
+            }
+            if (status==_GT_TSP_NOT_HAMILTONIAN) break;
+            if (!get_subtours()) {
+                status=_GT_TSP_NOT_HAMILTONIAN;
+                break;
+            }
+            if (subtours.size()>1 && verbose)
+                G->message(0,"Excluded %d subtours",subtours.size());
+        } while (subtours.size()>1 && res!=GLP_ESTOP);
+        if (status==_GT_TSP_ERROR)
+            break;
+        if (status==_GT_TSP_NOT_HAMILTONIAN) {
+            if (!sv.empty())
+                status=_GT_TSP_OPTIMAL;
+            break;
+        }
+        if (subtours.size()>1) // the solver was terminated
+            break;
+        sv.push_back(*subtours.begin());
+        if (verbose)
+            G->message(0,"Found tour %d",sv.size());
+    } while (int(sv.size())<k);
+    if (verbose)
+        glp_term_hook(NULL,NULL);
+    else glp_term_out(term_old);
+    return retval;
+}
+
+/* append subtour elimination constraint to MIP */
+void graphe::tsp::append_sce(const ivector &subtour) {
+    int i,j,r=glp_add_rows(mip,1),cnt=0,sz=subtour.size();
+    if (3*sz>2*nv+1) {
+        for (int k=0;k<ne;++k) {
+            if (find(subtour.begin(),subtour.end(),k)!=subtour.end())
+                continue;
+            i=k;
+            const arc &a1=arcs[i];
+            for (ivector_iter jt=subtour.begin();jt!=subtour.end();++jt) {
+                j=*jt;
+                assert(i!=j);
+                const arc &a2=arcs[j];
+                if (a1.head==a2.head || a1.tail==a2.tail ||
+                        a1.head==a2.tail || a1.tail==a2.head) {
+                    indices[++cnt]=k+1;
+                    coeff[cnt]=1.0;
+                    break;
+                }
+            }
+        }
+        glp_set_row_bnds(mip,r,GLP_LO,2,DBL_MAX);
+    } else {
+        for (ivector_iter it=subtour.begin();it!=subtour.end();++it) {
+            indices[++cnt]=*it+1;
+            coeff[cnt]=1.0;
+        }
+        glp_set_row_bnds(mip,r,GLP_UP,0.0,sz-1);
+    }
+    glp_set_mat_row(mip,r,cnt,indices,coeff);
+}
+
+/* append subtours from sv */
+void graphe::tsp::add_subtours(const ivectors &sv) {
+    ivector subtour;
+    for (ivectors_iter it=sv.begin();it!=sv.end();++it) {
+        subtours.insert(canonical_subtour(*it));
+    }
+}
+
+/* collect subtours from the current best MIP integer solution */
+bool graphe::tsp::get_subtours() {
+    ivector sol;
+    int m=glp_get_num_cols(mip),i,j;
+    for (i=0;i<m;++i) {
+        if (glp_mip_col_val(mip,i+1)>0.5)
+            sol.push_back(i);
+    }
+    if (sol==old_sol) return false;
+    old_sol=sol;
+    bvector vst(sol.size(),false);
+    ivector subtour;
+    subtour.reserve(ne);
+    arc a;
+    for (ivector_iter st=sol.begin();st!=sol.end();++st) {
+        const arc &fa=arcs[*st];
+        i=st-sol.begin();
+        if (vst[i])
+            continue;
+        subtour.clear();
+        subtour.push_back(*st);
+        vst[i]=true;
+        a=fa;
+        ivector_iter it;
+        do {
+            for (it=sol.begin();it!=sol.end();++it) {
+                j=it-sol.begin();
+                const arc &aa=arcs[*it];
+                if (i==j || vst[j])
+                    continue;
+                if (aa.tail==a.head || aa.tail==a.tail || aa.head==a.head || aa.head==a.tail) {
+                    vst[j]=true;
+                    subtour.push_back(*it);
+                    a.head=aa.head;
+                    a.tail=aa.tail;
+                    i=j;
+                    break;
+                }
+            }
+        } while (it!=sol.end());
+        subtours.insert(canonical_subtour(subtour));
+    }
+    return true;
+}
+
+/* return canonical representation of the subtour (starting with the lowest edge index) */
+graphe::ivector graphe::tsp::canonical_subtour(const ivector &subtour) {
+    int minv=-1,pos;
+    for (ivector_iter it=subtour.begin();it!=subtour.end();++it) {
+        if (minv<0 || *it<minv) {
+            minv=*it;
+            pos=it-subtour.begin();
+        }
+    }
+    ivector res(subtour.begin()+pos,subtour.end());
+    res.insert(res.end(),subtour.begin(),subtour.begin()+pos);
+    if (res.size()>2 && res[1]>res.back())
+        std::reverse(res.begin()+1,res.end()); // canonical orientation
+    return res;
+}
+
+/* find k shortest tours */
+int graphe::tsp::solve(int k,ivectors &hcv,dvector &costs) {
+    /* find a good tour by local search, it is passed to the MIP solver as the incumbent */
+    double cost=heuristic->find_tour(incumbent);
+    if (heuristic->is_feasible(cost)) {
+        if (verbose)
+            *logptr(G->giac_context()) << "Found a tour with weight " << cost << " by local search\n";
+    } else incumbent.clear();
+    mip=glp_create_prob();
+    hcv.clear(); hcv.reserve(k);
+    costs.clear(); costs.reserve(k);
+    ivectors sv;
+    ivector hc; hc.reserve(nv);
+    solution_status status;
+    if (!find_tours(k,sv,status))
+        return -1;
+    int retval;
+    switch (status) {
+    case _GT_TSP_OPTIMAL:
+        for (ivectors_iter t=sv.begin();t!=sv.end();++t) {
+            assert(int(t->size())==nv);
+            hc.clear();
+            const arc &first=arcs[t->front()],&last=arcs[t->back()];
+            int i=first.tail,j=first.head,k;
+            if (i==last.tail || i==last.head) {
+                hc.push_back(i);
+                hc.push_back(k=j);
+            } else {
+                hc.push_back(j);
+                hc.push_back(k=i);
+            }
+            for (ivector_iter it=t->begin()+1;it!=t->end();++it) {
+                const arc &a=arcs[*it];
+                if (a.tail==k) hc.push_back(k=a.head);
+                else {
+                    assert(a.head==k);
+                    hc.push_back(k=a.tail);
+                }
+            }
+            if (gap_tol>0)
+                improve_tour(hc);
+            hcv.push_back(hc);
+            costs.push_back(tour_cost(hc));
+        }
+        retval=1; // success
+        break;
+    case _GT_TSP_NOT_HAMILTONIAN:
+        retval=0; // fail
+        break;
+    case _GT_TSP_ERROR:
+        retval=-1; // error
+        break;
+    }
+    glp_delete_prob(mip);
+    return retval;
+}
+
+/* find a shortest tour */
+int graphe::tsp::solve(ivector &hc,double &cost) {
+    ivectors hcv;
+    dvector costs;
+    int res=solve(1,hcv,costs);
+    if (res==1 && !hcv.empty() && !costs.empty()) {
+        hc=hcv.front();
+        cost=costs.front();
+    }
+    return res;
+}
+
+/* return the weight of the edge (i,j) */
+double graphe::tsp::weight(int i,int j) {
+    return heuristic->dist(i,j);
+}
+
+/* return the cost of the tour hc */
+double graphe::tsp::tour_cost(const ivector &hc) {
+    int n=hc.size()-1,v,w;
+    if (!isweighted)
+        return n;
+    double cost=0;
+    for (int i=0;i<n;++i) {
+        v=hc[i];
+        w=hc[i+1];
+        assert(G->has_edge(v,w));
+        cost+=weight(v,w);
+    }
+    return cost;
+}
+
+/* apply heuristics */
+void graphe::tsp::heur(glp_tree *tree) {
+    int i,j,k;
+    if (send_incumbent) { // the tour found by local search before solving
+        tour=incumbent;
+        send_incumbent=false;
+    } else {
+        if (heur_type==_GT_TSP_NO_HEUR)
+            return;
+        if (heur_type==_GT_TSP_CHRISTOFIDES_SA) { // symmetric TSP
+            heur_type=_GT_TSP_FARTHEST_INSERTION_RANDOM;
+            if (!christofides(tour)) {
+                heur(tree);
+                return;
+            }
+        } else { // weighted undirected TSP
+            /* choose the initial arc a by random such that weight(e) >= median weight,
+             * in the first pass try to construct a tour starting from heaviest edge */
+            int index=heur_type==_GT_TSP_FARTHEST_INSERTION_RANDOM?(ne+1)/2+G->rand_integer(ne/2):ne-1;
+            farthest_insertion(index,tour);
+            heur_type=_GT_TSP_FARTHEST_INSERTION_RANDOM;
+            if (int(tour.size())<=nv)
+                return;
+        }
+        assert(int(tour.size())==nv+1);
+        /* optimize the tour */
+        improve_tour(tour);
+    }
+    /* construct the heuristic solution and pass it to the MIP solver */
+    for (i=0;i<ne;++i) coeff[i+1]=0.0;
+    for (i=0;i<nv;++i) {
+        j=i+1;
+        k=edge_index(make_edge(tour[i],tour[j]));
+        coeff[k+1]=1.0;
+    }
+    glp_ios_heur_sol(tree,coeff);
+}
+
+/* farthest insertion heuristic for obtaining a Hamiltonian tour */
+void graphe::tsp::farthest_insertion(int index,ivector &hc) {
+    int i,j,k,f;
+    const arc &a=arcs[index];
+    i=a.tail;
+    j=a.head;
+    hc.clear();
+    hc.push_back(i);
+    hc.push_back(j);
+    hc.push_back(i);
+    ivector_iter jt;
+    for (int vis=0;vis<nv;++vis) visited[vis]=false;
+    visited[i]=visited[j]=true;
+    dvector W;
+    double w,maxw,minw;
+    /* proceed with farthest insertion heuristic */
+    do {
+        maxw=0;
+        f=-1;
+        for (k=0;k<nv;++k) {
+            if (visited[k])
+                continue;
+            W.clear();
+            for (ivector_iter it=hc.begin();it!=hc.end();++it) {
+                if (G->has_edge(k,*it))
+                    W.push_back(weight(k,*it));
+            }
+            minw=DBL_MAX;
+            if (W.size()<2)
+                continue;
+            else for (dvector_iter wt=W.begin();wt!=W.end();++wt) {
+                if (*wt<minw)
+                    minw=*wt;
+            }
+            if (minw>maxw) {
+                maxw=minw;
+                f=k;
+            }
+        }
+        if ((k=f)<0)
+            break;
+        i=-1;
+        minw=DBL_MAX;
+        for (ivector_iter it=hc.begin();it!=hc.end();++it) {
+            jt=it+1;
+            if (jt!=hc.end() && G->has_edge(*it,k) && G->has_edge(k,*jt) &&
+                    minw>(w=weight(*it,k)+weight(k,*jt)-weight(*it,*jt))) {
+                minw=w;
+                i=it-hc.begin();
+            }
+        }
+        if (i<0)
+            break;
+        hc.insert(hc.begin()+i+1,k);
+        visited[k]=true;
+    } while (int(hc.size())<=nv);
+}
+
+/* find minimum weight perfect matching in an undirected bipartite graph with
+ * even number of vertices, edge set E and edge weights W */
+bool graphe::tsp::min_weight_matching_bipartite(const ivector &eind,const dvector &weights,ivector &matched_arcs,bool msg) {
+    set<int> Vset; // set of vertices
+    for (ivector_iter it=eind.begin();it!=eind.end();++it) {
+        const arc &a=arcs[*it];
+        Vset.insert(a.head);
+        Vset.insert(a.tail);
+    }
+    ivector V;
+    for (set<int>::const_iterator it=Vset.begin();it!=Vset.end();++it) {
+        V.push_back(*it);
+    }
+    int m=eind.size(),n=V.size(),nz=2*m,cnt=0,v;
+    assert((n%2)==0);
+    glp_prob *wp=glp_create_prob();
+    glp_add_rows(wp,n);
+    glp_add_cols(wp,m);
+    glp_set_obj_dir(wp,GLP_MIN);
+    int *ia=new int[nz+1];
+    int *ja=new int[nz+1];
+    double *ar=new double[nz+1];
+    for (int i=0;i<n;++i) {
+        v=V[i];
+        for (int j=0;j<m;++j) {
+            const arc &a=arcs[eind[j]];
+            if (a.head==v || a.tail==v) {
+                ia[++cnt]=i+1; ja[cnt]=j+1;
+                ar[cnt]=1.0;
+            }
+        }
+    }
+    assert(cnt==nz);
+    for (int i=0;i<n;++i) glp_set_row_bnds(wp,i+1,GLP_FX,1.0,1.0);
+    for (int j=0;j<m;++j) {
+        glp_set_col_kind(wp,j+1,GLP_BV);
+        glp_set_obj_coef(wp,j+1,weights[j]);
+    }
+    glp_load_matrix(wp,nz,ia,ja,ar);
+    delete[] ia; delete[] ja;
+    delete[] ar;
+    glp_smcp lparm;
+    glp_init_smcp(&lparm);
+    lparm.msg_lev=GLP_MSG_OFF;
+    glp_iocp parm;
+    glp_init_iocp(&parm);
+    parm.br_tech=GLP_BR_PCH;
+    parm.bt_tech=GLP_BT_BPH;
+    parm.gmi_cuts=GLP_ON;
+    parm.mir_cuts=GLP_ON;
+    parm.clq_cuts=GLP_ON;
+    parm.cov_cuts=GLP_ON;
+    parm.msg_lev=GLP_MSG_ON;
+    parm.fp_heur=GLP_ON;
+    parm.sr_heur=GLP_ON;
+    parm.cb_func=&min_wpm_callback;
+    pair<const ivector*,tsp*> info;
+    info.first=&eind;
+    info.second=this;
+    parm.cb_info=static_cast<void*>(&info);
+    if (msg) // TSP approximation
+        parm.mip_gap=gap_tol;
+    int term_old,res;
+    if (msg)
+        glp_term_hook(term_hook,static_cast<void*>(logptr(G->giac_context())));
+    else term_old=glp_term_out(GLP_OFF);
+    if (glp_simplex(wp,&lparm)!=0 || ((res=glp_intopt(wp,&parm))!=0 && res!=GLP_EMIPGAP && res!=GLP_ESTOP))
+        return false;
+    int stat=glp_mip_status(wp);
+    bool ret=true;
+    if (stat==GLP_OPT || stat==GLP_FEAS) {
+        for (int j=0;j<m;++j) {
+            if (glp_mip_col_val(wp,j+1)!=0)
+                matched_arcs.push_back(j);
+        }
+    } else ret=false;
+    glp_delete_prob(wp);
+    if (msg)
+        glp_term_hook(NULL,NULL);
+    else glp_term_out(term_old);
+    return ret;
+}
+
+void graphe::tsp::min_wpm_heur(glp_tree *tree,const ivector &eind) {
+    bvector vertex_matched(nv,false),arc_matched(eind.size(),false);
+    iset V;
+    int i,j,k,n=eind.size();
+    glp_prob *lp=glp_ios_get_prob(tree);
+    for (i=0;i<n;++i) {
+        if (glp_ios_can_branch(tree,i+1)==0 && glp_get_col_prim(lp,i+1)>0.9) {
+            const arc &a=arcs[eind[i]];
+            if (vertex_matched[a.head] || vertex_matched[a.tail])
+                continue;
+            arc_matched[i]=true;
+            vertex_matched[a.head]=vertex_matched[a.tail]=true;
+        }
+    }
+    for (ivector_iter it=eind.begin();it!=eind.end();++it) {
+        k=it-eind.begin();
+        if (arc_matched[k])
+            continue;
+        const arc &a=arcs[*it];
+        i=a.tail; j=a.head;
+        V.insert(i); V.insert(j);
+        if (vertex_matched[i] || vertex_matched[j])
+            continue;
+        arc_matched[k]=true;
+        vertex_matched[i]=vertex_matched[j]=true;
+    }
+    int cnt=0;
+    for (bvector::const_iterator it=arc_matched.begin();it!=arc_matched.end();++it) {
+        if (*it) ++cnt;
+        coeff[it-arc_matched.begin()+1]=*it?1.0:0.0;
+    }
+    if (int(V.size())==2*cnt)
+        glp_ios_heur_sol(tree,coeff);
+}
+
+/* construct a tour using the method of Christofides for symmetric TSP */
+bool graphe::tsp::christofides(ivector &hc,bool show_progress) {
+    hc.clear();
+    /* create spanning tree T */
+    if (show_progress)
+        G->message(0,"Finding a minimal spanning tree...");
+    graphe T(G->giac_context());
+    G->minimal_spanning_tree(T);
+    ivector V;
+    for (int i=0;i<nv;++i) {
+        if ((T.degree(i)%2)!=0)
+            V.push_back(G->node_index(T.node_label(i)));
+    }
+    /* the number of odd degree vertices in T must be even */
+    if (V.size()<=0 || (V.size()%2)!=0)
+        return false;
+    /* get edges in SG\T connecting the vertices from V,
+     * these form a bipartite graph B(V,E) */
+    ivector eind,matched_arcs;
+    dvector weights;
+    for (int k=0;k<ne;++k) {
+        const arc &a=arcs[k];
+        if (find(V.begin(),V.end(),a.head)!=V.end() &&
+                find(V.begin(),V.end(),a.tail)!=V.end() &&
+                !T.has_edge(T.node_index(G->node_label(a.tail)),
+                            T.node_index(G->node_label(a.head)))) {
+            eind.push_back(k);
+            weights.push_back(weight(a.tail,a.head));
+        }
+    }
+    if (show_progress)
+        G->message(0,"Finding a minimum weight matching in a bipartite graph with %d edges...",eind.size());
+    bool has_mwm=true;
+    if (eind.size()==1)
+        matched_arcs.resize(1,0);
+    else has_mwm=min_weight_matching_bipartite(eind,weights,matched_arcs,show_progress);
+    if (!has_mwm || 2*matched_arcs.size()!=V.size())
+        return false;
+    /* add matched edges to T and find Eulerian circuit,
+     * such exists because T now has all vertex degrees even */
+    for (ivector_iter it=matched_arcs.begin();it!=matched_arcs.end();++it) {
+        const arc &a=arcs[eind[*it]];
+        const attrib &attr=static_cast<const graphe*>(G)->edge_attributes(a.tail,a.head);
+        T.add_edge(G->node_label(a.tail),G->node_label(a.head),attr);
+    }
+    ivector etrail; // eulerian trail
+    if (!T.find_eulerian_trail(etrail) || etrail.front()!=etrail.back())
+        return false;
+    bvector visited(nv,false);
+    for (ivector_iter it=etrail.begin();it!=etrail.end();++it) {
+        if (visited[*it])
+            continue;
+        hc.push_back(G->node_index(T.node_label(*it)));
+        visited[*it]=true;
+    }
+    hc.push_back(hc.front());
+    return true;
+}
+
+/* improve the tour hc by local search */
+void graphe::tsp::improve_tour(ivector &hc) {
+    heuristic->improve(hc);
+}
+
+/* compute the mean and the standard deviation of the given sample */
+void graphe::tsp::sample_mean_stddev(const dvector &sample,double &mean,double &stddev) {
+    assert(!sample.empty());
+    /* compute the mean */
+    double sum=0;
+    for (dvector_iter it=sample.begin();it!=sample.end();++it) {
+        sum+=*it;
+    }
+    mean=sum/double(sample.size());
+    if (sample.size()==1)
+        stddev=0;
+    else {
+        double d;
+        sum=0;
+        for (dvector_iter it=sample.begin();it!=sample.end();++it) {
+            d=*it-mean;
+            sum+=d*d;
+        }
+        stddev=std::sqrt(sum/double(sample.size()-1));
+    }
+}
+
+/* branching variable selection technique proposed by Padberg & Rinaldi */
+void graphe::tsp::select_branching_variable(glp_tree *tree) {
+    glp_prob *lp=glp_ios_get_prob(tree);
+    int n=glp_get_num_cols(lp),b=-1;
+    double x0=0.0,x1=1.0,xe;
+    double par=0.5,rho=3.5,bctol=0.05; // constants
+    for (int i=0;i<n;++i) {
+        can_branch[i]=glp_ios_can_branch(tree,i+1)!=0;
+        xe=xev[i]=glp_get_col_prim(lp,i+1);
+        if (xe-0.5>=0 && xe<x1) x1=xe;
+        if (xe-0.5<=0 && xe>x0) x0=xe;
+        obj[i]=glp_get_obj_coef(lp,i+1);
+    }
+    ivector I;
+    for (int i=0;i<n;++i) {
+        xe=xev[i];
+        if (can_branch[i] && (1-par)*x0<=xe && xe<=x1+par*(1-x1))
+            I.push_back(i);
+    }
+    assert(!I.empty());
+    if (I.size()==1)
+        b=I.front();
+    else {
+        int N=I.size();
+        vector<pair<double,int> > sorted_by_obj_coeff;
+        ivector ind(N);
+        for (ivector_iter it=I.begin();it!=I.end();++it) {
+            sorted_by_obj_coeff.push_back(make_pair(obj[*it],*it));
+        }
+        std::sort(sorted_by_obj_coeff.begin(),sorted_by_obj_coeff.end());
+        dvector data2(N),data1(0);
+        for (int i=0;i<N;++i) {
+            ind[i]=sorted_by_obj_coeff[i].second;
+            data2[i]=sorted_by_obj_coeff[i].first;
+        }
+        std::reverse(data2.begin(),data2.end());
+        double mu1,mu2,sigma1,sigma2;
+        int i=1;
+        for (;i<N;++i) {
+            data1.push_back(data2.back());
+            data2.pop_back();
+            sample_mean_stddev(data1,mu1,sigma1);
+            sample_mean_stddev(data2,mu2,sigma2);
+            if (mu1+rho*sigma1<mu2-rho*sigma2)
+                break;
+        }
+        if (i==N) i=0;
+        /* the set I2 starts from i in ind */
+        ivector I2(ind.begin()+i,ind.end());
+        assert(!I2.empty());
+        N=I2.size();
+        double dist,mindist=DBL_MAX;
+        int j0=-1;
+        for (int j=0;j<N;++j) {
+            if ((dist=std::abs(0.5-xev[I2[j]]))<mindist) {
+                mindist=dist;
+                j0=j;
+            }
+        }
+        assert(j0>=0);
+        x0=xev[I2[j0]];
+        double c,maxc=0.0;
+        for (ivector_iter it=I2.begin();it!=I2.end();++it) {
+            xe=xev[*it];
+            if (xe>=x0-bctol && xe<=x0+bctol && (c=obj[*it])>maxc) {
+                maxc=c;
+                b=*it;
             }
         }
     }
-    assert(!cut[t-1]);
-    temp=0;
-    for (k=0;k<nedg;k++) {
-        i=beg[k],j=end[k];
-        if ((cut[i-1] && !cut[j-1]) || (!cut[i-1] && cut[j-1]))
-            temp+=cap[k];
-    }
-    return temp;
+    assert(b>=0);
+    /* Padberg & Rinaldi suggest exploring the upper branch first */
+    glp_ios_branch_upon(tree,b+1,GLP_UP_BRNCH);
 }
 
-/* find min cut with Stoer and Wagner algorithm */
-int graphe::tsp::minimal_cut(int nn,int nedg,const ivector &beg,
-                             const ivector &end,const ivector &cap,ivector &cut) {
-    int k;
-    assert(nn>=2);
-    assert(nedg>=0);
-    for (k=0;k<nedg;k++) {
-        assert(1<=beg[k] && beg[k]<end[k] && end[k]<=nn);
-        assert(cap[k]>0);
+/* row generation (originally written by Andrew Makhorin) */
+void graphe::tsp::rowgen(glp_tree *tree) {
+    if (mincut_data.empty())
+        mincut_data.resize(22);
+    glp_prob *prob=glp_ios_get_prob(tree);
+    int i,j,k,m=ne,n=nv,nedg=0,nz;
+    double sum,xk;
+    for (k=0;k<m;k++) {
+        if (glp_get_col_prim(prob,k+1)>=.001)
+            nedg++;
     }
-    int i,j,min_cut,flow,temp,I,J,K,S,T,DEG,NV,NE;
-    ivector &head1=mincut_data[0]; if (int(head1.size())<nn) head1.resize(nn);
-    ivector &head2=mincut_data[1]; if (int(head2.size())<nn) head2.resize(nn);
-    ivector &next1=mincut_data[2]; if (int(next1.size())<nedg) next1.resize(nedg);
-    ivector &next2=mincut_data[3]; if (int(next2.size())<nedg) next2.resize(nedg);
-    for (i=0;i<nn;i++) head1[i]=head2[i]=0;
-    for (k=0;k<nedg;k++) {
-        i=beg[k]; next1[k]=head1[i-1]; head1[i-1]=k+1;
-        j=end[k]; next2[k]=head2[j-1]; head2[j-1]=k+1;
+    /* build the capacitated network */
+    assert(nedg<=m);
+    ivector &beg=mincut_data[14]; if (int(beg.size())<nedg) beg.resize(nedg);
+    ivector &end=mincut_data[15]; if (int(end.size())<nedg) end.resize(nedg);
+    ivector &cap=mincut_data[16]; if (int(cap.size())<nedg) cap.resize(nedg);
+    nz=0;
+    for (k=0;k<m;k++) {
+        if ((xk=glp_get_col_prim(prob,k+1))>=.001) {
+            const arc &a=arcs[k];
+            beg[nz]=a.tail+1; end[nz]=a.head+1;
+            rlx_sol_map[a.tail][a.head]=xk;
+            cap[nz++]=std::ceil(1000*xk); // scale edge capacities to make them integral
+        }
     }
-    NV=nn;
-    ivector &HEAD=mincut_data[4]; if (int(HEAD.size())<nn) HEAD.resize(nn);
-    ivector &NEXT=mincut_data[5]; if (int(NEXT.size())<nn) NEXT.resize(nn);
-    ivector &NUMB=mincut_data[6]; if (int(NUMB.size())<nn) NUMB.resize(nn);
-    for (i=0;i<nn;i++) {
-        HEAD[i]=i+1; NEXT[i]=0; NUMB[i]=i+1;
+    assert(nz==nedg);
+    ivector &cut=mincut_data[17]; if (int(cut.size())<n) cut.resize(n);
+    minimal_cut(n,nedg,beg,end,cap,cut); // find minimal cut in the capacitated network
+    nedg=0; sum=0;
+    for (i=0;i<n;i++) {
+        for (j=i+1;j<n;j++) {
+            if ((cut[i] && !cut[j]) || (!cut[i] && cut[j])) {
+                nedg++;
+                sum+=rlx_sol_map[i][j];
+            }
+        }
     }
-    ivector &BEG=mincut_data[7]; if (int(BEG.size())<nedg) BEG.resize(nedg);
-    ivector &END=mincut_data[8]; if (int(END.size())<nedg) END.resize(nedg);
-    ivector &CAP=mincut_data[9]; if (int(CAP.size())<nedg) CAP.resize(nedg);
-    ivector &X=mincut_data[10]; if (int(X.size())<nedg) X.resize(nedg);
-    ivector &ADJ=mincut_data[11]; if (int(ADJ.size())<nn) ADJ.resize(nn);
-    ivector &SUM=mincut_data[12]; if (int(SUM.size())<nn) SUM.resize(nn);
-    ivector &CUT=mincut_data[13]; if (int(CUT.size())<nn) CUT.resize(nn);
-    min_cut=rand_max2;
-    while (NV>1) {
-        for (I=0;I<NV;I++) SUM[I]=0.0;
-        for (I=1;I<=NV;I++) {
-            DEG=0;
-            for (i=HEAD[I-1];i!=0;i=NEXT[i-1]) {
-                for (k=head1[i-1];k!=0;k=next1[k-1]) {
-                    j=end[k-1];
-                    J=NUMB[j-1];
-                    if (I>=J)
-                        continue;
-                    if (SUM[J-1]==0.0)
-                        ADJ[DEG++]=J;
-                    assert(cap[k-1]>0.0);
-                    SUM[J-1]+=cap[k-1];
-                }
-                for (k=head2[i-1];k!=0;k=next2[k-1]) {
-                    j=beg[k-1];
-                    J=NUMB[j-1];
-                    if (I>=J)
-                        continue;
-                    if (SUM[J-1]==0.0)
-                        ADJ[DEG++]=J;
-                    assert(cap[k-1]>0.0);
-                    SUM[J-1]+=cap[k-1];
+    /* if the (unscaled) capacity of min cut is less than 2, the
+     * corresponding subtour elimination constraint is violated */
+    if (sum<=1.999) {
+        nz=0;
+        for (i=0;i<n;i++) {
+            for (j=i+1;j<n;j++) {
+                if ((cut[i] && !cut[j]) || (!cut[i] && cut[j])) {
+                    nz++;
+                    assert(nz<=nedg);
+                    indices[nz]=edge_index(make_pair(i,j))+1;
+                    coeff[nz]=1.0;
                 }
             }
-            NE=0;
-            for (K=0;K<DEG;K++) {
-                assert(NE<nedg);
-                J=ADJ[K];
-                BEG[NE]=I; END[NE]=J; CAP[NE]=SUM[J-1];
-                SUM[J-1]=0.0;
-                ++NE;
-            }
-        }
-        S=1; T=NV;
-        flow=max_flow(NV,NE,BEG,END,CAP,S,T,X);
-        if (min_cut>flow)
-        {  min_cut=flow;
-            temp=min_st_cut(NV,NE,BEG,END,CAP,S,T,X,CUT);
-            assert(flow==temp);
-            for (i=0;i<nn;i++) cut[i]=CUT[NUMB[i]-1];
-            if (min_cut==0)
-                break;
         }
-        assert(T==NV);
-        for (i=HEAD[T-1];i!=0;i=NEXT[i-1]) NUMB[i-1]=S;
-        i=HEAD[S-1];
-        assert(i!=0);
-        while (NEXT[i-1]!=0)
-            i=NEXT[i-1];
-        NEXT[i-1]=HEAD[T-1];
-        NV--;
+        assert(nz==nedg);
+        i=glp_add_rows(prob,1);
+        glp_set_row_bnds(prob,i,GLP_LO,2.0,0.0);
+        glp_set_mat_row(prob,i,nz,indices,coeff);
     }
-    return min_cut;
 }
 
-/* TSP constructor */
-graphe::tsp::tsp(graphe *gr,double gap_tolerance,bool is_verbose) {
-    assert(!gr->is_directed());
-    G=gr;
-    verbose=is_verbose;
-    gap_tol=gap_tolerance;
-    isweighted=G->is_weighted();
-    ipairs E;
-    G->get_edges_as_pairs(E);
-    edges_comparator comp(G);
-    std::sort(E.begin(),E.end(),comp); // sort edges by weight (ascending)
-    nv=G->node_count();
-    ne=E.size();
-    tour.reserve(nv);
-    obj.resize(ne);
-    xev.resize(ne);
-    can_branch.resize(ne);
-    coeff=new double[ne+1];
-    indices=new int[ne+1];
-    visited=new bool[nv];
-    arcs=new arc[ne];
-    cancellable=false;
-    int i;
-    for (ipairs_iter it=E.begin();it!=E.end();++it) {
-        i=it-E.begin();
-        arc &a=arcs[i];
-        a.head=it->second;
-        a.tail=it->first;
-        loc_map[a.tail][a.head]=i;
-        weight_map[a.tail][a.head]=isweighted?to_real_number(G->weight(*it),G->giac_context()).to_double(G->giac_context()):1.0;
+/* MIP callback routine */
+void graphe::tsp::callback(glp_tree *tree,void *info) {
+    if (is_interrupted()) {
+        glp_ios_terminate(tree);
+        return;
+    }
+    tsp *tsprob=static_cast<tsp*>(info);
+    switch (glp_ios_reason(tree)) {
+    case GLP_IHEUR:
+        tsprob->heur(tree);
+        break;
+    case GLP_IBRANCH:
+        if (tsprob->isweighted && _rand(makesequence(0,1),tsprob->G->giac_context()).DOUBLE_val()<0.14)
+            tsprob->select_branching_variable(tree);
+        break;
+    case GLP_IROWGEN:
+        if (tsprob->is_symmetric_tsp)
+            tsprob->rowgen(tree);
+        break;
+    default:
+        break;
     }
 }
 
-/* TSP destructor */
-graphe::tsp::~tsp() {
-    delete[] coeff;
-    delete[] indices;
-    delete[] visited;
-    delete[] arcs;
+/* min weight perfect matching solver callback routine */
+void graphe::tsp::min_wpm_callback(glp_tree *tree,void *info) {
+    if (is_interrupted()) {
+        glp_ios_terminate(tree);
+        return;
+    }
+    pair<const ivector*,tsp*> *origin=static_cast<pair<const ivector*,tsp*>*>(info);
+    const ivector *eind=origin->first;
+    tsp *tsprob=origin->second;
+    switch (glp_ios_reason(tree)) {
+    case GLP_IHEUR:
+        tsprob->min_wpm_heur(tree,*eind);
+        break;
+    default:
+        break;
+    }
 }
 
-/* create an edge or arc */
-graphe::ipair graphe::tsp::make_edge(int i,int j) const {
-    return make_pair(i<j?i:j,i<j?j:i);
+/*
+* END OF TSP CLASS IMPLEMENTATION
+*/
+
+/*
+ * ATSP CLASS (asymmetric traveling salesman problem)
+ */
+ 
+graphe::atsp::atsp(graphe *gr,const ipairs &must_include_arcs,double gap_tolerance,bool is_verbose) {
+    G=gr;
+    mia=must_include_arcs;
+    mip=NULL;
+    isweighted=G->is_weighted();
+    gap_tol=gap_tolerance;
+    verbose=is_verbose;
 }
 
-/* return the subgraph index of edge e */
-int graphe::tsp::edge_index(const ipair &e) {
-    return loc_map[e.first][e.second];
+graphe::atsp::~atsp() {
+    if (mip!=NULL) glp_delete_prob(mip);
 }
 
-/* formulate TSP as MIP, initially without any subtour elimination constraints */
-void graphe::tsp::formulate_mip() {
-    ivectors rows;
-    int nonzeros=0,i,j,k,l,cnt=0,nrows,ncols;
-    for (j=0;j<ne;++j) {
-        const arc &a=arcs[j];
-        obj[j]=weight(a.tail,a.head);
+bool graphe::atsp::solve(ivector &hc,double &cost) {
+    if (mip!=NULL) glp_erase_prob(mip);
+    else mip=glp_create_prob();
+    glp_set_obj_dir(mip,GLP_MIN);
+    int n=G->node_count(),nz=8+8*n*(n-2)+n*ft.size(),i,j,r,c=0,res;
+    int *u=new int[n];
+    int **x=new int*[n];
+    for (i=0;i<n;++i) x[i]=new int[n];
+    int *ia=new int[nz+1];
+    int *ja=new int[nz+1];
+    double *ar=new double[nz+1];
+    double w;
+    gen e;
+    ipairs E;
+    G->get_edges_as_pairs(E);
+    /* add variables */
+    for (ipairs_iter it=E.begin();it!=E.end();++it) {
+        i=it->first; j=it->second;
+        x[i][j]=glp_add_cols(mip,1);
+        if (find(mia.begin(),mia.end(),*it)!=mia.end())
+            glp_set_col_bnds(mip,x[i][j],GLP_FX,1,1);
+        else glp_set_col_kind(mip,x[i][j],GLP_BV);
+        if (isweighted) {
+            if (!is_real_number(G->weight(i,j),G->giac_context())) {
+                G->message(1,"arc weight is not numeric, replacing by 1");
+                w=1;
+            } else w=to_real_number(G->weight(i,j),G->giac_context()).to_double(G->giac_context());
+        } else w=1;
+        glp_set_obj_coef(mip,x[i][j],w);
     }
-    for (j=0;j<nv;++j) {
-        rows.resize(rows.size()+1);
-        ivector &row=rows.back();
-        row.push_back(j);
-        for (i=0;i<nv;++i) {
-            if (i!=j && G->has_edge(i,j)) {
-                row.push_back(i);
-                ++nonzeros;
-            }
-        }
+    for (i=1;i<n;++i) {
+        u[i]=glp_add_cols(mip,1);
+        glp_set_col_bnds(mip,u[i],GLP_DB,2,n);
     }
-    ncols=ne;
-    nrows=rows.size();
-    if (isweighted)
-        nonzeros+=ne;
-    int *ia=new int[nonzeros+1];
-    int *ja=new int[nonzeros+1];
-    double *ar=new double[nonzeros+1];
-    for (ivectors_iter it=rows.begin();it!=rows.end();++it) {
-        const ivector &row=*it;
-        k=it-rows.begin();
-        i=row.front();
-        for (ivector_iter rt=row.begin()+1;rt!=row.end();++rt) {
-            j=*rt;
-            l=edge_index(make_edge(i,j));
-            assert(l<ne);
-            ia[++cnt]=k+1; ja[cnt]=l+1; ar[cnt]=1;
+    /* create the basic constraints */
+    for (i=0;i<n;++i) {
+        r=glp_add_rows(mip,2);
+        glp_set_row_bnds(mip,r,GLP_FX,1,1);
+        glp_set_row_bnds(mip,r+1,GLP_FX,1,1);
+        for (j=0;j<n;++j) {
+            if (i==j) continue;
+            if (G->has_edge(i,j)) { ia[++c]=x[i][j]; ja[c]=r; ar[c]=1; }
+            if (G->has_edge(j,i)) { ia[++c]=x[j][i]; ja[c]=r+1; ar[c]=1; }
         }
     }
-    /* build MIP */
-    glp_add_rows(mip,nrows);
-    double rh=2.0;
-    for (i=0;i<nrows;++i) glp_set_row_bnds(mip,i+1,GLP_FX,rh,rh);
-    if (isweighted) {
-        int r=glp_add_rows(mip,1);
-        double lb=lower_bound();
-        glp_set_row_bnds(mip,r,GLP_LO,lb,DBL_MAX);
-        for (i=0;i<ne;++i) {
-            ia[++cnt]=r; ja[cnt]=i+1; ar[cnt]=obj[i];
+    /* SEC: an enhanced formulation of Miller et al. */
+    for (i=1;i<n;++i) {
+        for (j=1;j<n;++j) {
+            if (i==j) continue;
+            r=glp_add_rows(mip,1);
+            glp_set_row_bnds(mip,r,GLP_UP,0,n-1);
+            ia[++c]=u[i]; ja[c]=r; ar[c]=1;
+            ia[++c]=u[j]; ja[c]=r; ar[c]=-1;
+            if (G->has_edge(i,j)) { ia[++c]=x[i][j]; ja[c]=r; ar[c]=n; }
+            if (G->has_edge(j,i)) { ia[++c]=x[j][i]; ja[c]=r; ar[c]=n-2; }
         }
     }
-    glp_add_cols(mip,ncols);
-    for (j=0;j<ne;++j) {
-        glp_set_col_kind(mip,j+1,GLP_BV);
-        glp_set_obj_coef(mip,j+1,obj[j]);
-    }
-    assert(cnt<=nonzeros);
-    glp_load_matrix(mip,cnt,ia,ja,ar);
-    delete[] ia; delete[] ja; delete[] ar;
-}
-
-/* compute lower bound for the objective function by using a minimal spanning tree */
-double graphe::tsp::lower_bound() {
-    double cost,maxcost=0;
-    for (int i=0;i<nv;++i) {
-        vertex &v=G->node(i);
-        G->unset_subgraphs(0);
-        v.set_subgraph(1);
-        graphe T(G->giac_context());
-        G->minimal_spanning_tree(T,0);
-        ipairs E;
-        cost=0;
-        T.get_edges_as_pairs(E);
-        for (ipairs_iter it=E.begin();it!=E.end();++it) {
-            cost+=to_real_number(T.weight(*it),G->giac_context()).to_double(G->giac_context());
-        }
-        dvector c;
-        for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-            c.push_back(weight(i,*it));
+    /* forbid the specified tours */
+    for (ivectors_iter it=ft.begin();it!=ft.end();++it) {
+        r=glp_add_rows(mip,1);
+        glp_set_row_bnds(mip,r,GLP_UP,0,n-1);
+        for (int k=0;k<n;++k) {
+            i=it->at(k); j=it->at(k+1);
+            assert(G->has_edge(i,j));
+            ia[++c]=x[i][j]; ja[c]=r; ar[c]=1;
         }
-        assert(c.size()>1);
-        std::sort(c.begin(),c.end());
-        cost+=c[0];
-        cost+=c[1];
-        if (cost>maxcost)
-            maxcost=cost;
     }
-    return maxcost;
-}
-
-/* find the subtours (sv) in the subgraph induced by vertices in v */
-bool graphe::tsp::find_tours(int k,ivectors &sv,solution_status &status) {
-    sv.clear();
-    if (k<=0)
-        return true;
-    sv.reserve(k);
-    glp_erase_prob(mip);
-    glp_set_obj_dir(mip,GLP_MIN);
-    formulate_mip();
-    glp_smcp lparm;
-    glp_init_smcp(&lparm);
-    lparm.msg_lev=GLP_MSG_OFF;
+    assert(c<=nz);
+    glp_load_matrix(mip,c,ja,ia,ar);
+    delete[] ia; delete[] ja; delete[] ar; delete[] u;
+    /* solve the problem */
     glp_iocp parm;
     glp_init_iocp(&parm);
     parm.msg_lev=GLP_MSG_ON;
+    parm.br_tech=GLP_BR_MFV;
+    parm.bt_tech=GLP_BT_DFS;
+    parm.presolve=GLP_ON;
     parm.gmi_cuts=GLP_ON;
+    parm.mir_cuts=GLP_ON;
     parm.cov_cuts=GLP_ON;
-    parm.br_tech=GLP_BR_PCH;
-    parm.bt_tech=GLP_BT_BPH;
-    parm.sr_heur=GLP_OFF;
+    parm.clq_cuts=GLP_ON;
+    parm.fp_heur=GLP_ON;
+    parm.sr_heur=GLP_ON;
+    parm.mip_gap=gap_tol;
     parm.cb_func=&callback;
     parm.cb_info=static_cast<void*>(this);
-    parm.mip_gap=gap_tol;
-    bool retval=true;
-    int res,lres,stat;
-    is_symmetric_tsp=isweighted && G->is_clique();
-    heur_type=is_symmetric_tsp?_GT_TSP_CHRISTOFIDES_SA:(isweighted?_GT_TSP_FARTHEST_INSERTION_HEUR:_GT_TSP_NO_HEUR);
-    int term_old;
-    if (verbose)
-        glp_term_hook(term_hook,static_cast<void*>(logptr(G->giac_context())));
-    else term_old=glp_term_out(GLP_OFF);
-    do {
-        do {
-            /* append subtour elimination constraints */
-            for (set<ivector>::const_iterator it=subtours.begin();it!=subtours.end();++it) {
-                append_sce(*it);
-            }
-            subtours.clear();
-            /* solve */
-            if ((lres=glp_simplex(mip,&lparm))==0 &&
-                ((stat=glp_get_status(mip))==GLP_OPT || stat==GLP_FEAS))
-                res=glp_intopt(mip,&parm);
-            else if (lres!=0 || stat==GLP_UNDEF || stat==GLP_UNBND) {
-                status=_GT_TSP_ERROR;
-                break;
-            } else {
-                status=_GT_TSP_NOT_HAMILTONIAN;
-                break;
-            }
-            stat=glp_mip_status(mip);
-            if ((res!=0 && res!=GLP_EMIPGAP && res!=GLP_ESTOP) || stat==GLP_UNDEF) {
-                status=_GT_TSP_ERROR;
-                retval=false;
-                break;
-            }
-            switch (stat) {
-            case GLP_FEAS:
+    select_blb=false;
+    bool ret=false;
+    if ((res=glp_intopt(mip,&parm))==0 || res==GLP_EMIPGAP || res==GLP_ESTOP) {
+        ret=true;
+        switch(glp_mip_status(mip)) {
+        case GLP_FEAS:
+            if (verbose)
                 G->message(1,"the solution is not necessarily optimal");
-            case GLP_OPT:
-                status=_GT_TSP_OPTIMAL;
-                break;
-            case GLP_NOFEAS:
-                status=_GT_TSP_NOT_HAMILTONIAN;
-                break;
-            }
-            if (status==_GT_TSP_NOT_HAMILTONIAN) break;
-            if (!get_subtours()) {
-                status=_GT_TSP_NOT_HAMILTONIAN;
-                break;
-            }
-            if (subtours.size()>1 && verbose)
-                G->message(0,"Excluded %d subtours",subtours.size());
-        } while (subtours.size()>1 && res!=GLP_ESTOP);
-        if (status==_GT_TSP_ERROR)
-            break;
-        if (status==_GT_TSP_NOT_HAMILTONIAN) {
-            if (!sv.empty())
-                status=_GT_TSP_OPTIMAL;
+        case GLP_OPT:
             break;
-        }
-        if (subtours.size()>1) // the solver was terminated
+        case GLP_UNDEF:
+            if (verbose)
+                G->message(1,"the solution is undefined");
+        case GLP_NOFEAS:
+            ret=false;
             break;
-        sv.push_back(*subtours.begin());
-        if (verbose)
-            G->message(0,"Found tour %d",sv.size());
-    } while (int(sv.size())<k);
-    if (verbose)
-        glp_term_hook(NULL,NULL);
-    else glp_term_out(term_old);
-    return retval;
-}
-
-/* append subtour elimination constraint to MIP */
-void graphe::tsp::append_sce(const ivector &subtour) {
-    int i,j,r=glp_add_rows(mip,1),cnt=0,sz=subtour.size();
-    if (3*sz>2*nv+1) {
-        for (int k=0;k<ne;++k) {
-            if (find(subtour.begin(),subtour.end(),k)!=subtour.end())
-                continue;
-            i=k;
-            const arc &a1=arcs[i];
-            for (ivector_iter jt=subtour.begin();jt!=subtour.end();++jt) {
-                j=*jt;
-                assert(i!=j);
-                const arc &a2=arcs[j];
-                if (a1.head==a2.head || a1.tail==a2.tail ||
-                        a1.head==a2.tail || a1.tail==a2.head) {
-                    indices[++cnt]=k+1;
-                    coeff[cnt]=1.0;
-                    break;
-                }
-            }
-        }
-        glp_set_row_bnds(mip,r,GLP_LO,2,DBL_MAX);
-    } else {
-        for (ivector_iter it=subtour.begin();it!=subtour.end();++it) {
-            indices[++cnt]=*it+1;
-            coeff[cnt]=1.0;
         }
-        glp_set_row_bnds(mip,r,GLP_UP,0.0,sz-1);
-    }
-    glp_set_mat_row(mip,r,cnt,indices,coeff);
-}
-
-/* append subtours from sv */
-void graphe::tsp::add_subtours(const ivectors &sv) {
-    ivector subtour;
-    for (ivectors_iter it=sv.begin();it!=sv.end();++it) {
-        subtours.insert(canonical_subtour(*it));
-    }
-}
-
-/* collect subtours from the current best MIP integer solution */
-bool graphe::tsp::get_subtours() {
-    ivector sol;
-    int m=glp_get_num_cols(mip),i,j;
-    for (i=0;i<m;++i) {
-        if (glp_mip_col_val(mip,i+1)>0.5)
-            sol.push_back(i);
-    }
-    if (sol==old_sol) return false;
-    old_sol=sol;
-    bvector vst(sol.size(),false);
-    ivector subtour;
-    subtour.reserve(ne);
-    arc a;
-    for (ivector_iter st=sol.begin();st!=sol.end();++st) {
-        const arc &fa=arcs[*st];
-        i=st-sol.begin();
-        if (vst[i])
-            continue;
-        subtour.clear();
-        subtour.push_back(*st);
-        vst[i]=true;
-        a=fa;
-        ivector_iter it;
-        do {
-            for (it=sol.begin();it!=sol.end();++it) {
-                j=it-sol.begin();
-                const arc &aa=arcs[*it];
-                if (i==j || vst[j])
-                    continue;
-                if (aa.tail==a.head || aa.tail==a.tail || aa.head==a.head || aa.head==a.tail) {
-                    vst[j]=true;
-                    subtour.push_back(*it);
-                    a.head=aa.head;
-                    a.tail=aa.tail;
-                    i=j;
-                    break;
+        if (ret) {
+            cost=glp_mip_obj_val(mip);
+            int n=G->node_count(),i,j,pos=0;
+            hc.resize(n+1,0);
+            while (pos<n) {
+                i=hc[pos];
+                for (j=0;j<n;++j) {
+                    if (i==j || !G->has_edge(i,j)) continue;
+                    if (glp_mip_col_val(mip,x[i][j])>0.5) {
+                        hc[++pos]=j;
+                        break;
+                    }
                 }
+                assert(j<n);
             }
-        } while (it!=sol.end());
-        subtours.insert(canonical_subtour(subtour));
-    }
-    return true;
-}
-
-/* return canonical representation of the subtour (starting with the lowest edge index) */
-graphe::ivector graphe::tsp::canonical_subtour(const ivector &subtour) {
-    int minv=-1,pos;
-    for (ivector_iter it=subtour.begin();it!=subtour.end();++it) {
-        if (minv<0 || *it<minv) {
-            minv=*it;
-            pos=it-subtour.begin();
+            assert(hc.back()==hc.front());
         }
     }
-    ivector res(subtour.begin()+pos,subtour.end());
-    res.insert(res.end(),subtour.begin(),subtour.begin()+pos);
-    if (res.size()>2 && res[1]>res.back())
-        std::reverse(res.begin()+1,res.end()); // canonical orientation
-    return res;
+    terminated=(res==GLP_ESTOP);
+    for (i=0;i<n;++i) delete[] x[i];
+    delete[] x;
+    return ret;
 }
 
-/* find k shortest tours */
-int graphe::tsp::solve(int k,ivectors &hcv,dvector &costs) {
-    mip=glp_create_prob();
-    hcv.clear(); hcv.reserve(k);
-    costs.clear(); costs.reserve(k);
-    ivectors sv;
-    ivector hc; hc.reserve(nv);
-    solution_status status;
-    if (!find_tours(k,sv,status))
-        return -1;
-    int retval;
-    switch (status) {
-    case _GT_TSP_OPTIMAL:
-        for (ivectors_iter t=sv.begin();t!=sv.end();++t) {
-            assert(int(t->size())==nv);
-            hc.clear();
-            const arc &first=arcs[t->front()],&last=arcs[t->back()];
-            int i=first.tail,j=first.head,k;
-            if (i==last.tail || i==last.head) {
-                hc.push_back(i);
-                hc.push_back(k=j);
-            } else {
-                hc.push_back(j);
-                hc.push_back(k=i);
-            }
-            for (ivector_iter it=t->begin()+1;it!=t->end();++it) {
-                const arc &a=arcs[*it];
-                if (a.tail==k) hc.push_back(k=a.head);
-                else {
-                    assert(a.head==k);
-                    hc.push_back(k=a.tail);
-                }
-            }
-            if (gap_tol>0)
-                improve_tour(hc);
-            hcv.push_back(hc);
-            costs.push_back(tour_cost(hc));
-        }
-        retval=1; // success
+/* MIP callback routine */
+void graphe::atsp::callback(glp_tree *tree,void *info) {
+    if (is_interrupted()) {
+        glp_ios_terminate(tree);
+        return;
+    }
+    atsp *atsprob=static_cast<atsp*>(info);
+    switch (glp_ios_reason(tree)) {
+    case GLP_ISELECT:
+        if (atsprob->select_blb)
+            glp_ios_select_node(tree,glp_ios_best_node(tree));
         break;
-    case _GT_TSP_NOT_HAMILTONIAN:
-        retval=0; // fail
+    case GLP_IBINGO:
+        atsprob->select_blb=true;
         break;
-    case _GT_TSP_ERROR:
-        retval=-1; // error
+    default:
         break;
     }
-    glp_delete_prob(mip);
-    return retval;
-}
-
-/* find a shortest tour */
-int graphe::tsp::solve(ivector &hc,double &cost) {
-    ivectors hcv;
-    dvector costs;
-    int res=solve(1,hcv,costs);
-    if (res==1 && !hcv.empty() && !costs.empty()) {
-        hc=hcv.front();
-        cost=costs.front();
-    }
-    return res;
-}
-
-/* return the weight of the edge (i,j) */
-double graphe::tsp::weight(int i,int j) {
-    ipair e=make_edge(i,j);
-    return weight_map[e.first][e.second];
-}
-
-/* return the cost of the tour hc */
-double graphe::tsp::tour_cost(const ivector &hc) {
-    int n=hc.size()-1,v,w;
-    if (!isweighted)
-        return n;
-    double cost=0;
-    for (int i=0;i<n;++i) {
-        v=hc[i];
-        w=hc[i+1];
-        assert(G->has_edge(v,w));
-        cost+=weight(v,w);
-    }
-    return cost;
 }
 
-/* apply heuristics */
-void graphe::tsp::heur(glp_tree *tree) {
-    if (heur_type==_GT_TSP_NO_HEUR)
-        return;
-    int i,j,k;
-    if (heur_type==_GT_TSP_CHRISTOFIDES_SA) { // symmetric TSP
-        heur_type=_GT_TSP_FARTHEST_INSERTION_RANDOM;
-        if (!christofides(tour)) {
-            heur(tree);
-            return;
-        }
-    } else { // weighted undirected TSP
-        /* choose the initial arc a by random such that weight(e) >= median weight,
-         * in the first pass try to construct a tour starting from heaviest edge */
-        int index=heur_type==_GT_TSP_FARTHEST_INSERTION_RANDOM?(ne+1)/2+G->rand_integer(ne/2):ne-1;
-        farthest_insertion(index,tour);
-        heur_type=_GT_TSP_FARTHEST_INSERTION_RANDOM;
-        if (int(tour.size())<=nv)
-            return;
-    }
-    assert(int(tour.size())==nv+1);
-    /* optimize the tour */
-    lin_kernighan(tour);
-    /* construct the heuristic solution and pass it to the MIP solver */
-    for (i=0;i<ne;++i) coeff[i+1]=0.0;
-    for (i=0;i<nv;++i) {
-        j=i+1;
-        k=edge_index(make_edge(tour[i],tour[j]));
-        coeff[k+1]=1.0;
+void graphe::atsp::ksolve(int k,ivectors &hcv,dvector &costs) {
+    hcv.clear();
+    costs.clear();
+    ft.clear();
+    hcv.reserve(k);
+    costs.reserve(k);
+    ft.reserve(k-1);
+    ivector hc;
+    double cost;
+    int term_old;
+    if (verbose)
+        glp_term_hook(term_hook,static_cast<void*>(logptr(G->giac_context())));
+    else term_old=glp_term_out(GLP_OFF);
+    terminated=false;
+    for (int cnt=0;!terminated && cnt<k;++cnt) {
+        if (!solve(hc,cost)) break;
+        if (verbose)
+            G->message(0,"Found the tour %d",cnt+1);
+        hcv.push_back(hc);
+        costs.push_back(cost);
+        if (cnt<k-1) ft.push_back(hc);
     }
-    glp_ios_heur_sol(tree,coeff);
-}
-
-/* farthest insertion heuristic for obtaining a Hamiltonian tour */
-void graphe::tsp::farthest_insertion(int index,ivector &hc) {
-    int i,j,k,f;
-    const arc &a=arcs[index];
-    i=a.tail;
-    j=a.head;
-    hc.clear();
-    hc.push_back(i);
-    hc.push_back(j);
-    hc.push_back(i);
-    ivector_iter jt;
-    for (int vis=0;vis<nv;++vis) visited[vis]=false;
-    visited[i]=visited[j]=true;
-    dvector W;
-    double w,maxw,minw;
-    /* proceed with farthest insertion heuristic */
-    do {
-        maxw=0;
-        f=-1;
-        for (k=0;k<nv;++k) {
-            if (visited[k])
-                continue;
-            W.clear();
-            for (ivector_iter it=hc.begin();it!=hc.end();++it) {
-                if (G->has_edge(k,*it))
-                    W.push_back(weight(k,*it));
-            }
-            minw=DBL_MAX;
-            if (W.size()<2)
-                continue;
-            else for (dvector_iter wt=W.begin();wt!=W.end();++wt) {
-                if (*wt<minw)
-                    minw=*wt;
-            }
-            if (minw>maxw) {
-                maxw=minw;
-                f=k;
-            }
-        }
-        if ((k=f)<0)
-            break;
-        i=-1;
-        minw=DBL_MAX;
-        for (ivector_iter it=hc.begin();it!=hc.end();++it) {
-            jt=it+1;
-            if (jt!=hc.end() && G->has_edge(*it,k) && G->has_edge(k,*jt) &&
-                    minw>(w=weight(*it,k)+weight(k,*jt)-weight(*it,*jt))) {
-                minw=w;
-                i=it-hc.begin();
-            }
-        }
-        if (i<0)
-            break;
-        hc.insert(hc.begin()+i+1,k);
-        visited[k]=true;
-    } while (int(hc.size())<=nv);
-}
-
-/* try to lower the cost of the tour hc */
-bool graphe::tsp::perform_3opt_moves(ivector &hc) {
-    int n=hc.size()-1,b1,e1,b2,e2,b3,e3,i1,j1,i2,j2,i3,j3,i,j,k,var,iter_count=0,moves_count=0;
-    double opt_timeout=5.0+25.0*std::exp(-std::pow(std::max(0,1000-n),2)/2e5);
-    bvector visited(nv);
-    ivectors opt_moves;
-    double sw,save,maxsave,wb1e1,wb2e2,wb3e3,wb1b2,wb1e2,we1e2;
-    bool hb1e2,hb1b2,he1e2;
-    /* improve the tour by making a limited number of 3-opt moves */
-    clock_t start_time=clock();
-    ivector ijk(3);
-    bool triplet_found=false;
-    bool timed_out=false;
-    do {
-        if (cancellable && is_interrupted())
-            return false;
-        ++iter_count;
-        opt_moves.clear();
-        std::fill(visited.begin(),visited.end(),false);
-        for (i=0;i<n;++i) {
-            triplet_found=false;
-            b1=hc[i]; e1=hc[i+1];
-            if (visited[b1] || visited[e1])
-                continue;
-            wb1e1=weight(b1,e1);
-            for (j=i+2;j<n;++j) {
-                if (double(clock()-start_time)/CLOCKS_PER_SEC>opt_timeout) {
-                    timed_out=true;
-                    break;
-                }
-                b2=hc[j]; e2=hc[j+1];
-                if (visited[b2] || visited[e2])
-                    continue;
-                wb2e2=weight(b2,e2);
-                hb1e2=G->has_edge(b1,e2);
-                hb1b2=G->has_edge(b1,b2);
-                he1e2=G->has_edge(e1,e2);
-                if (hb1b2) wb1b2=weight(b1,b2);
-                if (hb1e2) wb1e2=weight(b1,e2);
-                if (he1e2) we1e2=weight(e1,e2);
-                for (k=j+2;k<n;++k) {
-                    b3=hc[k]; e3=hc[k+1];
-                    if (visited[b3] || visited[e3])
-                        continue;
-                    wb3e3=weight(b3,e3);
-                    sw=wb1e1+wb2e2+wb3e3;
-                    if ((hb1e2 && G->has_edge(b3,e1) && G->has_edge(b2,e3) && sw>wb1e2+weight(b3,e1)+weight(b2,e3)) ||
-                            (hb1e2 && G->has_edge(b3,b2) && G->has_edge(e1,e3) && sw>wb1e2+weight(b3,b2)+weight(e1,e3)) ||
-                            (hb1b2 && G->has_edge(b3,e1) && G->has_edge(e2,e3) && sw>wb1b2+weight(b3,e1)+weight(e2,e3)) ||
-                            (G->has_edge(b1,b3) && he1e2 && G->has_edge(b2,e3) && sw>weight(b1,b3)+we1e2+weight(b2,e3)))
-                    {
-                        ivector opt_move(6);
-                        opt_move[0]=b1; opt_move[1]=b2; opt_move[2]=b3;
-                        opt_move[3]=e1; opt_move[4]=e2; opt_move[5]=e3;
-                        opt_moves.push_back(opt_move);
-                        visited[b1]=visited[b2]=visited[b3]=true;
-                        visited[e1]=visited[e2]=visited[e3]=true;
-                        triplet_found=true;
-                        break;
-                    }
-                }
-                if (triplet_found)
-                    break;
-            }
-            if (timed_out)
-                break;
-        }
-        if (opt_moves.empty()) break;
-        for (ivectors_iter it=opt_moves.begin();it!=opt_moves.end();++it) {
-            const ivector &opt_move=*it;
-            i1=find(hc.begin(),hc.end(),opt_move[0])-hc.begin();
-            i2=find(hc.begin(),hc.end(),opt_move[1])-hc.begin();
-            i3=find(hc.begin(),hc.end(),opt_move[2])-hc.begin();
-            j1=find(hc.begin(),hc.end(),opt_move[3])-hc.begin();
-            j2=find(hc.begin(),hc.end(),opt_move[4])-hc.begin();
-            j3=find(hc.begin(),hc.end(),opt_move[5])-hc.begin();
-            if (std::abs(i1-j1)!=1) {
-                if (i1==0) i1=n;
-                else if (j1==0) j1=n;
-                else assert(false);
-            }
-            if (std::abs(i2-j2)!=1) {
-                if (i2==0) i2=n;
-                else if (j2==0) j2=n;
-                else assert(false);
-            }
-            if (std::abs(i3-j3)!=1) {
-                if (i3==0) i3=n;
-                else if (j3==0) j3=n;
-                else assert(false);
-            }
-            assert(std::abs(i1-j1)==1 && std::abs(i2-j2)==1 && std::abs(i3-j3)==1);
-            ijk[0]=std::min(i1,j1);
-            ijk[1]=std::min(i2,j2);
-            ijk[2]=std::min(i3,j3);
-            std::sort(ijk.begin(),ijk.end());
-            i=ijk[0]; j=ijk[1]; k=ijk[2];
-            b1=hc[i]; b2=hc[j]; b3=hc[k];
-            e1=hc[i+1]; e2=hc[j+1]; e3=hc[k+1];
-            sw=weight(b1,e1)+weight(b2,e2)+weight(b3,e3);
-            maxsave=0.0;
-            if (G->has_edge(b1,e2) && G->has_edge(b3,e1) && G->has_edge(b2,e3) &&
-                    (save=sw-weight(b1,e2)-weight(b3,e1)-weight(b2,e3))>maxsave) {
-                var=0; maxsave=save;
-            }
-            if (G->has_edge(b1,e2) && G->has_edge(b3,b2) && G->has_edge(e1,e3) &&
-                  (save=sw-weight(b1,e2)-weight(b3,b2)-weight(e1,e3))>maxsave) {
-                var=1; maxsave=save;
-            }
-            if (G->has_edge(b1,b2) && G->has_edge(b3,e1) && G->has_edge(e2,e3) &&
-                  (save=sw-weight(b1,b2)-weight(b3,e1)-weight(e2,e3))>maxsave) {
-                var=2; maxsave=save;
-            }
-            if (G->has_edge(b1,b3) && G->has_edge(e1,e2) && G->has_edge(b2,e3) &&
-                  (save=sw-weight(b1,b3)-weight(e1,e2)-weight(b2,e3))>maxsave) {
-                var=3; maxsave=save;
-            }
-            if (maxsave>.001) {
-                ivector part(hc.begin()+j+1,hc.begin()+k+1);
-                switch (var) {
-                case 1:
-                    std::reverse(hc.begin()+i+1,hc.begin()+j+1);
-                case 3:
-                    if (var==3) std::reverse(part.begin(),part.end());
-                case 0:
-                    hc.erase(hc.begin()+j+1,hc.begin()+k+1);
-                    hc.insert(hc.begin()+i+1,part.begin(),part.end());
-                    break;
-                case 2:
-                    std::reverse(hc.begin()+i+1,hc.begin()+j+1);
-                    std::reverse(hc.begin()+j+1,hc.begin()+k+1);
-                    break;
-                default:
-                    assert(false);
-                }
-                ++moves_count;
-            }
-        }
-    } while (!timed_out);
-    return true;
+    if (verbose)
+        glp_term_hook(NULL,NULL);
+    else glp_term_out(term_old);
 }
 
-void graphe::tsp::straighten(ivector &hc) {
-    ivectors opt_moves;
-    int i,j,k,l,b1,b2,e1,e2,n=hc.size()-1,iter_count=0,moves_count=0;
-    double w0;
-    bvector visited(n+1);
-    ivector opt_move(4);
-    while (true) {
-        if (cancellable && is_interrupted())
-            break;
-        ++iter_count;
-        opt_moves.clear();
-        std::fill(visited.begin(),visited.end(),false);
-        for (i=0;i<n;++i) {
-            if (visited[i] && visited[i+1]) continue;
-            b1=hc[i]; e1=hc[i+1];
-            w0=weight(b1,e1);
-            for (j=i+2;j<n;++j) {
-                if ((i==0 && j==n-1) || (visited[j] && visited[j+1])) continue;
-                b2=hc[j]; e2=hc[j+1];
-                if (G->has_edge(b1,b2) && G->has_edge(e1,e2) &&
-                        w0+weight(b2,e2)-weight(b1,b2)-weight(e1,e2)>.001) {
-                    opt_move[0]=b1; opt_move[1]=b2; opt_move[2]=e1; opt_move[3]=e2;
-                    opt_moves.push_back(opt_move);
-                    visited[i]=visited[i+1]=visited[j]=visited[j+1]=true;
-                    break;
-                }
-            }
-        }
-        if (opt_moves.empty()) break;
-        for (ivectors_iter it=opt_moves.begin();it!=opt_moves.end();++it) {
-            const ivector &opt_move=*it;
-            b1=opt_move[0]; b2=opt_move[1]; e1=opt_move[2]; e2=opt_move[3];
-            i=find(hc.begin(),hc.end(),b1)-hc.begin(); j=find(hc.begin(),hc.end(),e1)-hc.begin();
-            k=find(hc.begin(),hc.end(),b2)-hc.begin(); l=find(hc.begin(),hc.end(),e2)-hc.begin();
-            if (std::abs(i-j)!=1) {
-                if (i==0) i=n;
-                else if (j==0) j=n;
-                else assert(false);
-            }
-            if (std::abs(k-l)!=1) {
-                if (k==0) k=n;
-                else if (l==0) l=n;
-                else assert(false);
-            }
-            assert(std::abs(i-j)==1 && std::abs(k-l)==1);
-            i=std::min(i,j);
-            j=std::min(k,l);
-            std::reverse(hc.begin()+(i<j?i:j)+1,hc.begin()+(i<j?j:i)+1);
-            ++moves_count;
-        }
-    }
-}
-
-/* Helsgaun criterion for k-opt move feasibility */
-bool graphe::tsp::is_move_feasible(int k,const ivector &t,const ipairs &x) {
-    ivector incl(2*k+1,0);
-    int i,j,pi,count;
-    for (int c=0;c<k;++c) {
-        i=2*c+1;
-        j=(i+1)%(2*k);
-        incl[i+1]=j+1;
-        incl[j+1]=i+1;
-    }
-    ivector p,q;
-    ipairs xs(x.begin()+1,x.begin()+k+1);
-    std::sort(xs.begin(),xs.end());
-    for (ipairs_iter it=xs.begin();it!=xs.end();++it) {
-        p.push_back(find(t.begin()+1,t.begin()+2*k+1,it->first)-t.begin());
-    }
-    for (i=k;i-->0;) {
-        p.insert(p.begin()+i+1,((pi=p[i])%2)==0?pi-1:pi+1);
-    }
-    q.resize(p.size()+1);
-    for (i=p.size();i-->0;) {
-        assert((pi=p[i])<=2*k);
-        q[pi]=i+1;
-    }
-    for (i=2*k,count=1;(i=q[incl[p[i-1]]]^1)!=0;count++);
-    return count==k;
-}
-
-/* Lin-Kernighan backtracking k-opt heuristic for tour improvement */
-bool graphe::tsp::lin_kernighan(ivector &hc) {
-    int n=hc.size()-1;
-    int i,choice,j,j0,j_next,pos,ypos,t1,t2,t3,t4,t5,t2i,t2ip,dir;
-    static ipairs x,y,y_tmp;
-    static dvector wx,wy;
-    static ivector t,t1_alt,y1_alt,y2_alt,cheaper_hc;
-    x.resize(n+1); y.resize(n+1);
-    wx.resize(n+1); wy.resize(n+1);
-    t.resize(2*n+1);
-    cheaper_hc.resize(n+1);
-    t1_alt.clear();
-    double w,wi;
-    for (int k=0;k<n;++k) t1_alt.push_back(k); // initialize alternatives for t1
-lk2:
-    /* Let i:=1. Choose t[1] and let x1:=(t[1],t[2]=succ(t[1])) in hc.
-     * Initialize alternatives for y1. */
-    i=1;
-    if (cancellable && is_interrupted()) return false; // cancelled
-    if (t1_alt.empty()) return true; // no more alternatives for t[1]
-    choice=t1_alt.size()==1?0:G->rand_integer(t1_alt.size());
-    t1=t[1]=t1_alt[choice]; t1_alt.erase(t1_alt.begin()+choice);
-    x[1]=make_pair(t1,t2=t[2]=(t1+1)%n);
-    w=wx[1]=weight(hc[t1],hc[t2]);
-    y1_alt.clear();
-    for (int k=0;k<n;++k) {
-        if (k!=t1 && k!=t2 && k!=(t1-1+n)%n && k!=(t2+1)%n &&
-                G->has_edge(hc[t2],hc[k]) && w>weight(hc[t2],hc[k]))
-            y1_alt.push_back(k);
-    }
-lk4:
-    /* Choose y1:=(t[2],t[3]) not in hc such that G1>0. Else, go to lk2. */
-    if (y1_alt.empty()) goto lk2;
-    choice=y1_alt.size()==1?0:G->rand_integer(y1_alt.size());
-    t3=t[3]=y1_alt[choice]; y1_alt.erase(y1_alt.begin()+choice);
-    y[1]=make_pair(t2=t[2],t3);
-    wy[1]=weight(hc[t2],hc[t3]);
-lk5:
-    /* Let i:=i+1 and let xi=(t[2i-1],t[2i]) in hc.
-     * Update the tour if possible. If i=1 initialize alternatives for y2. */
-    ++i;
-    t2ip=t[2*i-1];
-    x[i]=make_pair(t2ip,t2i=t[2*i]=(t2ip+1)%n);
-    wx[i]=weight(hc[t2ip],hc[t2i]);
-    w=0.0;
-    for (int k=1;k<=i;++k) w+=wx[k]-(k==i?0.0:wy[k]);
-    if (t2i!=(t1-1+n)%n && G->has_edge(hc[t2i],hc[t1]) &&
-            w-weight(hc[t2i],hc[t1])>.001 && is_move_feasible(i,t,x)) {
-        /* update hc with the new cheaper tour starting from t[2] */
-        y[i]=make_pair(t2i,t1); // temporary yi
-        y_tmp=ipairs(y.begin()+1,y.begin()+i+1);
-        j=j0=t[2]; j_next=t[3];
-        pos=ypos=dir=0;
-        while (true) {
-            if (ypos>=0)
-                y_tmp.erase(y_tmp.begin()+ypos);
-            cheaper_hc[pos++]=hc[j];
-            j=j_next;
-            if (j==j0) break;
-            ypos=-1;
-            for (int k=y_tmp.size();k-->0;) {
-                const ipair &yk=y_tmp[k];
-                if (yk.first==j || yk.second==j) {
-                    j_next=yk.first==j?yk.second:yk.first;
-                    ypos=k;
-                    dir=0;
-                    break;
-                }
-            }
-            if (ypos<0) {
-                if (dir==0)
-                    dir=find(x.begin()+1,x.begin()+i+1,make_pair(j,(j+1)%n))==x.begin()+i+1?1:-1;
-                j_next=(j+dir+n)%n;
-            }
-        }
-        assert(pos==n);
-        cheaper_hc.back()=hc[j0];
-        hc=cheaper_hc;
-        t1_alt.clear();
-        for (int k=0;k<n;++k) t1_alt.push_back(k); // initialize alternatives for t1
-        goto lk2;
-    } else if (i==2) { // initialize alternatives for y2
-        y2_alt.clear();
-        t1=t[1]; t4=t[4];
-        for (int k=0;k<n;++k) {
-            if (find(t.begin()+1,t.begin()+5,k)==t.begin()+5 &&
-                    find(t.begin()+1,t.begin()+5,(k+1)%n)==t.begin()+5 &&
-                    G->has_edge(hc[t4],hc[k]) && w-weight(hc[t4],hc[k])>.001)
-                y2_alt.push_back(k);
-        }
-    }
-lk7:
-    /* Choose yi:=(t[2i],t[2i+1]) not in hc such that Gi>0. If successful, go to lk5. */
-    if (i==2) {
-        if (y2_alt.empty()) { i=1; goto lk4; }
-        choice=y2_alt.size()==1?0:G->rand_integer(y2_alt.size());
-        y[2]=make_pair(t4=t[4],t5=t[5]=y2_alt[choice]); y2_alt.erase(y2_alt.begin()+choice);
-        wy[2]=weight(hc[t4],hc[t5]);
-        goto lk5;
-    } else {
-        int k;
-        t2i=t[2*i]; t1=t[1];
-        for (k=0;k<n;++k) {
-            if (find(t.begin()+1,t.begin()+2*i+1,k)==t.begin()+2*i+1 &&
-                    find(t.begin()+1,t.begin()+2*i+1,(k+1)%n)==t.begin()+2*i+1 &&
-                    G->has_edge(hc[t2i],hc[k]) && w-(wi=weight(hc[t2i],hc[k]))>.001) {
-                y[i]=make_pair(t2i,t[2*i+1]=k);
-                wy[i]=wi;
-                break;
-            }
+/*
+* END OF ATSP CLASS IMPLEMENTATION
+*/
+
+#endif
+
+/* Try to find an optimal Hamiltonian cycle.
+ * Return 0 if the graph is not Hamiltonian, else store the circuit in h
+ * and return 1, if unable to solve return -1. If k=0, a short tour is found
+ * by local search, which stops after time_limit seconds if time_limit>0.
+ * If euclidean=true, the weights are Euclidean distances between the stored
+ * vertex positions; with k=0, the edges are then ignored and every pair of
+ * vertices may be joined in the tour. */
+int graphe::traveling_salesman(int k,ivectors &hcv,dvector &costs,double gap_tol,bool verbose,bool euclidean,double time_limit) {
+    layout x;
+    if (!euclidean || !has_stored_layout(x))
+        x.clear();
+    if (k==0) { // tour approximation
+        ivector h;
+        double cost;
+        if (!x.empty()) {
+            tsp_heuristic H(x);
+            cost=H.find_tour(h,NULL,time_limit);
+        } else {
+            tsp_heuristic H(adjacency_snapshot(true));
+            cost=H.find_tour(h,NULL,time_limit);
+            if (!H.is_feasible(cost))
+                return -1;
         }
-        if (k<n) goto lk5;
+        costs.push_back(cost);
+        hcv.push_back(h);
+        return 1;
     }
-    i=2;
-    goto lk7;
+#ifdef HAVE_LIBGLPK
+    tsp t(this,gap_tol,verbose,x.empty()?NULL:&x);
+    assert(k>0);
+    return t.solve(k,hcv,costs);
+#else
+    message("Error: GLPK library is required for solving traveling salesman problem");
+    return -1;
+#endif
 }
 
-/* find minimum weight perfect matching in an undirected bipartite graph with
- * even number of vertices, edge set E and edge weights W */
-bool graphe::tsp::min_weight_matching_bipartite(const ivector &eind,const dvector &weights,ivector &matched_arcs,bool msg) {
-    set<int> Vset; // set of vertices
-    for (ivector_iter it=eind.begin();it!=eind.end();++it) {
-        const arc &a=arcs[*it];
-        Vset.insert(a.head);
-        Vset.insert(a.tail);
-    }
-    ivector V;
-    for (set<int>::const_iterator it=Vset.begin();it!=Vset.end();++it) {
-        V.push_back(*it);
+/* find first k optimal tours in a directed graph */
+bool graphe::find_directed_tours(int k,ivectors &hcv,dvector &costs,const ipairs &incl,double gap_tol,bool verbose) {
+    if (!is_directed()) {
+        message(2,"the graph must be directed");
+        return false;
     }
-    int m=eind.size(),n=V.size(),nz=2*m,cnt=0,v;
-    assert((n%2)==0);
-    glp_prob *wp=glp_create_prob();
-    glp_add_rows(wp,n);
-    glp_add_cols(wp,m);
-    glp_set_obj_dir(wp,GLP_MIN);
-    int *ia=new int[nz+1];
-    int *ja=new int[nz+1];
-    double *ar=new double[nz+1];
-    for (int i=0;i<n;++i) {
-        v=V[i];
-        for (int j=0;j<m;++j) {
-            const arc &a=arcs[eind[j]];
-            if (a.head==v || a.tail==v) {
-                ia[++cnt]=i+1; ja[cnt]=j+1;
-                ar[cnt]=1.0;
+#ifdef HAVE_LIBGLPK
+    atsp t(this,incl,gap_tol,verbose);
+    t.ksolve(k,hcv,costs);
+    return true;
+#else
+    message("Error: GLPK library is required for solving traveling salesman problem");
+    return false;
+#endif
+}
+
+/* for each edge of the graph, assign the distance between endpoints as a weight */
+bool graphe::make_euclidean_distances() {
+    layout x;
+    if (is_directed() || !has_stored_layout(x))
+        return false;
+    if (!x.empty()) {
+        int n=node_count();
+        set_weighted(true);
+        point pq(x.front().size());
+        for (int i=0;i<n;++i) {
+            const vertex &v=node(i);
+            const point &p=x[i];
+            for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
+                const point &q=x[*it];
+                set_edge_attribute(i,*it,_GT_ATTRIB_WEIGHT,gen(point_distance(p,q,pq)));
             }
         }
     }
-    assert(cnt==nz);
-    for (int i=0;i<n;++i) glp_set_row_bnds(wp,i+1,GLP_FX,1.0,1.0);
-    for (int j=0;j<m;++j) {
-        glp_set_col_kind(wp,j+1,GLP_BV);
-        glp_set_obj_coef(wp,j+1,weights[j]);
-    }
-    glp_load_matrix(wp,nz,ia,ja,ar);
-    delete[] ia; delete[] ja;
-    delete[] ar;
-    glp_smcp lparm;
-    glp_init_smcp(&lparm);
-    lparm.msg_lev=GLP_MSG_OFF;
-    glp_iocp parm;
-    glp_init_iocp(&parm);
-    parm.br_tech=GLP_BR_PCH;
-    parm.bt_tech=GLP_BT_BPH;
-    parm.gmi_cuts=GLP_ON;
-    parm.mir_cuts=GLP_ON;
-    parm.clq_cuts=GLP_ON;
-    parm.cov_cuts=GLP_ON;
-    parm.msg_lev=GLP_MSG_ON;
-    parm.fp_heur=GLP_ON;
-    parm.sr_heur=GLP_ON;
-    parm.cb_func=&min_wpm_callback;
-    pair<const ivector*,tsp*> info;
-    info.first=&eind;
-    info.second=this;
-    parm.cb_info=static_cast<void*>(&info);
-    if (msg) // TSP approximation
-        parm.mip_gap=gap_tol;
-    int term_old,res;
-    if (msg)
-        glp_term_hook(term_hook,static_cast<void*>(logptr(G->giac_context())));
-    else term_old=glp_term_out(GLP_OFF);
-    if (glp_simplex(wp,&lparm)!=0 || ((res=glp_intopt(wp,&parm))!=0 && res!=GLP_EMIPGAP && res!=GLP_ESTOP))
-        return false;
-    int stat=glp_mip_status(wp);
-    bool ret=true;
-    if (stat==GLP_OPT || stat==GLP_FEAS) {
-        for (int j=0;j<m;++j) {
-            if (glp_mip_col_val(wp,j+1)!=0)
-                matched_arcs.push_back(j);
-        }
-    } else ret=false;
-    glp_delete_prob(wp);
-    if (msg)
-        glp_term_hook(NULL,NULL);
-    else glp_term_out(term_old);
-    return ret;
+    return true;
 }
 
-void graphe::tsp::min_wpm_heur(glp_tree *tree,const ivector &eind) {
-    bvector vertex_matched(nv,false),arc_matched(eind.size(),false);
-    iset V;
-    int i,j,k,n=eind.size();
-    glp_prob *lp=glp_ios_get_prob(tree);
-    for (i=0;i<n;++i) {
-        if (glp_ios_can_branch(tree,i+1)==0 && glp_get_col_prim(lp,i+1)>0.9) {
-            const arc &a=arcs[eind[i]];
-            if (vertex_matched[a.head] || vertex_matched[a.tail])
-                continue;
-            arc_matched[i]=true;
-            vertex_matched[a.head]=vertex_matched[a.tail]=true;
+/* find the maximum flow using Edmonds-Karp algorithm (exact computation) */
+gen graphe::maxflow_edmonds_karp(int s,int t,vector<map<int,gen> > &flow,const gen &limit) {
+    assert(is_directed() && node_queue.empty());
+    gen mf(0),df; // the value of maximum flow
+    int n=node_count(),i,j;
+    vector<map<int,gen> > cap(n);
+    /* initialize arc capacities and flows */
+    flow.resize(n);
+    bool isweighted=is_weighted();
+    node_iter nt=nodes.begin(),ntend=nodes.end();
+    ivector_iter it,itend;
+    for (i=0;nt!=ntend;++nt,++i) {
+        map<int,gen> &c=cap[i];
+        flow[i].clear();
+        for (it=nt->neighbors().begin(),itend=nt->neighbors().end();it!=itend;++it) {
+            j=*it;
+            c[j]=isweighted?weight(i,j):gen(1); // all capacities are set to 1 in unweighted graphs
         }
     }
-    for (ivector_iter it=eind.begin();it!=eind.end();++it) {
-        k=it-eind.begin();
-        if (arc_matched[k])
-            continue;
-        const arc &a=arcs[*it];
-        i=a.tail; j=a.head;
-        V.insert(i); V.insert(j);
-        if (vertex_matched[i] || vertex_matched[j])
-            continue;
-        arc_matched[k]=true;
-        vertex_matched[i]=vertex_matched[j]=true;
-    }
-    int cnt=0;
-    for (bvector::const_iterator it=arc_matched.begin();it!=arc_matched.end();++it) {
-        if (*it) ++cnt;
-        coeff[it-arc_matched.begin()+1]=*it?1.0:0.0;
+    ipairs pred(n);
+    ipair nullpair=make_pair(-1,-1);
+    while (true) {
+        /* run BFS */
+        node_queue.push(s);
+        std::fill(pred.begin(),pred.end(),nullpair);
+        while (!node_queue.empty()) {
+            i=node_queue.front();
+            node_queue.pop();
+            const vertex &v=node(i);
+            for (it=v.neighbors().begin(),itend=v.neighbors().end();it!=itend;++it) {
+                j=*it;
+                if (j!=s && pred[j]==nullpair && is_strictly_greater(cap[i][j],flow[i][j],ctx)) {
+                    pred[j]=make_pair(i,j);
+                    node_queue.push(j);
+                }
+            }
+        }
+        if (pred[t]!=nullpair) {
+            /* found an augmenting path */
+            df=plusinf();
+            /* compute df = how much flow can we send ... */
+            for (ipair e=pred[t];e.first>=0;e=pred[e.first]) {
+                df=min(df,cap[e.first][e.second]-flow[e.first][e.second],ctx);
+            }
+            /* ... and increase edge flows by df */
+            for (ipair e=pred[t];e.first>=0;e=pred[e.first]) {
+                flow[e.first][e.second]+=df;
+                flow[e.second][e.first]-=df;
+            }
+            mf+=df;
+            if (is_greater(mf,limit,ctx))
+                break;
+        } else break;
     }
-    if (int(V.size())==2*cnt)
-        glp_ios_heur_sol(tree,coeff);
+    return mf; // return the maximum flow
 }
 
-/* construct a tour using the method of Christofides for symmetric TSP */
-bool graphe::tsp::christofides(ivector &hc,bool show_progress) {
-    hc.clear();
-    /* create spanning tree T */
-    if (show_progress)
-        G->message(0,"Finding a minimal spanning tree...");
-    graphe T(G->giac_context());
-    G->minimal_spanning_tree(T);
-    ivector V;
-    for (int i=0;i<nv;++i) {
-        if ((T.degree(i)%2)!=0)
-            V.push_back(G->node_index(T.node_label(i)));
-    }
-    /* the number of odd degree vertices in T must be even */
-    if (V.size()<=0 || (V.size()%2)!=0)
-        return false;
-    /* get edges in SG\T connecting the vertices from V,
-     * these form a bipartite graph B(V,E) */
-    ivector eind,matched_arcs;
-    dvector weights;
-    for (int k=0;k<ne;++k) {
-        const arc &a=arcs[k];
-        if (find(V.begin(),V.end(),a.head)!=V.end() &&
-                find(V.begin(),V.end(),a.tail)!=V.end() &&
-                !T.has_edge(T.node_index(G->node_label(a.tail)),
-                            T.node_index(G->node_label(a.head)))) {
-            eind.push_back(k);
-            weights.push_back(weight(a.tail,a.head));
+/* obtain a minimum cut from maximum flow */
+void graphe::minimum_cut(int s,const vector<map<int,gen> > &flow,ipairs &cut) {
+    /* create the residual network */
+    graphe G(ctx,false);
+    G.add_nodes(node_count());
+    G.make_directed();
+    cut.clear();
+    int i,j;
+    gen c,f;
+    bool isweighted=is_weighted();
+    map<int,gen>::const_iterator mit;
+    node_iter it,itend;
+    ivector_iter jt,jtend;
+    for (i=0,it=nodes.begin(),itend=nodes.end();it!=itend;++it,++i) {
+        const map<int,gen> &flowi=flow[i];
+        for (jt=it->neighbors().begin(),jtend=it->neighbors().end();jt!=jtend;++jt) {
+            j=*jt;
+            f=max(0,(mit=flowi.find(j))!=flowi.end()?mit->second:gen(0),ctx);
+            c=isweighted?weight(i,j):gen(1);
+            if (!giac::is_zero(_ratnormal(c-f,ctx),ctx))
+                G.add_edge(i,j);
         }
     }
-    if (show_progress)
-        G->message(0,"Finding a minimum weight matching in a bipartite graph with %d edges...",eind.size());
-    bool has_mwm=true;
-    if (eind.size()==1)
-        matched_arcs.resize(1,0);
-    else has_mwm=min_weight_matching_bipartite(eind,weights,matched_arcs,show_progress);
-    if (!has_mwm || 2*matched_arcs.size()!=V.size())
-        return false;
-    /* add matched edges to T and find Eulerian circuit,
-     * such exists because T now has all vertex degrees even */
-    for (ivector_iter it=matched_arcs.begin();it!=matched_arcs.end();++it) {
-        const arc &a=arcs[eind[*it]];
-        const attrib &attr=G->edge_attributes(a.tail,a.head);
-        T.add_edge(G->node_label(a.tail),G->node_label(a.head),attr);
+    /* run DFS on the residual network, store all discovered nodes */
+    ivector disc;
+    G.dfs(s,true,true,&disc);
+    unvisit_all_nodes();
+    for (jt=disc.begin(),jtend=disc.end();jt!=jtend;++jt) {
+        node(*jt).set_visited(true);
     }
-    ivector etrail; // eulerian trail
-    if (!T.find_eulerian_trail(etrail) || etrail.front()!=etrail.back())
-        return false;
-    bvector visited(nv,false);
-    for (ivector_iter it=etrail.begin();it!=etrail.end();++it) {
-        if (visited[*it])
-            continue;
-        hc.push_back(G->node_index(T.node_label(*it)));
-        visited[*it]=true;
+    /* if, for an edge (u,v), u is discovered and v is not
+     * or vice versa, (u,v) belongs to the cut */
+    for (i=0,it=nodes.begin(),itend=nodes.end();it!=itend;++it,++i) {
+        for (jt=it->neighbors().begin(),jtend=it->neighbors().end();jt!=jtend;++jt) {
+            if (it->is_visited() && !node(*jt).is_visited())
+                cut.push_back(make_pair(i,*jt));
+        }
     }
-    hc.push_back(hc.front());
-    return true;
 }
 
-/* improve the tour hc by making k-opt moves */
-void graphe::tsp::improve_tour(ivector &hc,bool do_3opt) {
-    cancellable=true;
-    if (lin_kernighan(hc))
-        if (!do_3opt || perform_3opt_moves(hc))
-            straighten(hc);
-    cancellable=false;
-}
-
-/* construct an approximate tour, G must be a complete graph */
-bool graphe::tsp::approx(ivector &hc,double &ratio) {
-    assert(isweighted);
-    if (!christofides(hc,verbose)) {
-        if (verbose)
-            G->message(2,"failed to construct Christofides tour");
+/* make the residual network F for this graph, with edge weights as capacities
+ * (unit capacities are used if the graph is unweighted or weighted=false),
+ * the k-th arc of F is the k-th arc of the adjacency snapshot (in undirected
+ * graphs, only the arcs (i,j) with i<j are added, with capacities in both
+ * directions), return false if some weight is not a nonnegative number */
+bool graphe::make_flow_network(flow_network &F,bool weighted) const {
+    weighted=weighted && is_weighted();
+    const csr_adjacency &A=adjacency_snapshot(weighted);
+    if (weighted && !A.has_numeric_weights())
         return false;
+    int n=node_count();
+    bool isdir=is_directed();
+    double c=1;
+    for (int i=0;i<n;++i) {
+        for (int k=A.arc_begin(i);k<A.arc_end(i);++k) {
+            if (!isdir && A.head(k)<i)
+                continue;
+            if (weighted && ((c=A.weight(k))<0 || c==DBL_MAX))
+                return false;
+            F.add_arc(i,A.head(k),c,isdir?0:c);
+        }
     }
-    double old_cost=tour_cost(hc),imp_cost;
-    if (verbose)
-        *logptr(G->giac_context()) << "Constructed a tour with weight " << old_cost << "\n";
-    if (old_cost==0)
-        ratio=0;
-    else {
-        if (verbose)
-            G->message(0,"Attempting to improve the tour...");
-        improve_tour(hc);
-        imp_cost=tour_cost(hc);
-        if (verbose)
-            *logptr(G->giac_context()) << "Relative improvement: " << 100.0*(old_cost-imp_cost)/old_cost << "%\n";
-        ratio=(1+gap_tol)*1.5*imp_cost/old_cost;
-    }
+    F.build();
     return true;
 }
 
-/* compute the mean and the standard deviation of the given sample */
-void graphe::tsp::sample_mean_stddev(const dvector &sample,double &mean,double &stddev) {
-    assert(!sample.empty());
-    /* compute the mean */
-    double sum=0;
-    for (dvector_iter it=sample.begin();it!=sample.end();++it) {
-        sum+=*it;
+/* obtain a minimum cut from the maximum flow stored in F, which was created by make_flow_network */
+void graphe::minimum_cut(int s,const flow_network &F,ipairs &cut) const {
+    bvector side;
+    F.source_side(s,side);
+    cut.clear();
+    int i=0;
+    for (node_iter it=nodes.begin();it!=nodes.end();++it,++i) {
+        if (!side[i])
+            continue;
+        for (ivector_iter jt=it->neighbors().begin();jt!=it->neighbors().end();++jt) {
+            if (!side[*jt])
+                cut.push_back(make_pair(i,*jt));
+        }
     }
-    mean=sum/double(sample.size());
-    if (sample.size()==1)
-        stddev=0;
-    else {
-        double d;
-        sum=0;
-        for (dvector_iter it=sample.begin();it!=sample.end();++it) {
-            d=*it-mean;
-            sum+=d*d;
+}
+
+/* compute the Gomory-Hu tree of an undirected network F by Gusfield's algorithm
+ * (n-1 maximum flow computations, no contractions), the tree is rooted in the
+ * vertex 0 and stored as the list of parents, the edge from i to parent[i]
+ * is weighted by the capacity cut[i] of the minimum cut separating them,
+ * the minimum cut capacity between two vertices is the minimal weight on the
+ * path between them */
+void graphe::gomory_hu_tree(flow_network &F,ivector &parent,dvector &cut) {
+    int n=F.node_count();
+    parent.assign(n,0);
+    cut.assign(n,0);
+    bvector side;
+    for (int i=1;i<n;++i) {
+        cut[i]=F.max_flow(i,parent[i]);
+        F.source_side(i,side);
+        for (int j=i+1;j<n;++j) {
+            if (side[j] && parent[j]==parent[i])
+                parent[j]=i;
         }
-        stddev=std::sqrt(sum/double(sample.size()-1));
     }
+    parent[0]=-1;
 }
 
-/* branching variable selection technique proposed by Padberg & Rinaldi */
-void graphe::tsp::select_branching_variable(glp_tree *tree) {
-    glp_prob *lp=glp_ios_get_prob(tree);
-    int n=glp_get_num_cols(lp),b=-1;
-    double x0=0.0,x1=1.0,xe;
-    double par=0.5,rho=3.5,bctol=0.05; // constants
-    for (int i=0;i<n;++i) {
-        can_branch[i]=glp_ios_can_branch(tree,i+1)!=0;
-        xe=xev[i]=glp_get_col_prim(lp,i+1);
-        if (xe-0.5>=0 && xe<x1) x1=xe;
-        if (xe-0.5<=0 && xe>x0) x0=xe;
-        obj[i]=glp_get_obj_coef(lp,i+1);
+gen graphe::make_colon_label(const ivector &v) {
+    string str;
+    for (ivector_iter it=v.begin();it!=v.end();++it) {
+        str+=int2string(*it);
+        if (it+1!=v.end())
+            str+=":";
     }
-    ivector I;
-    for (int i=0;i<n;++i) {
-        xe=xev[i];
-        if (can_branch[i] && (1-par)*x0<=xe && xe<=x1+par*(1-x1))
-            I.push_back(i);
+    return graphe::str2gen(str,true);
+}
+
+gen graphe::colon_label(int i, int j) {
+    ivector v(2);
+    v[0]=i; v[1]=j;
+    return make_colon_label(v);
+}
+
+gen graphe::colon_label(int i, int j,int k) {
+    ivector v(3);
+    v[0]=i; v[1]=j; v[2]=k;
+    return make_colon_label(v);
+}
+
+/* convert this multigraph to simple graph by adding new colored vertices */
+void graphe::simplify(graphe &G,bool color_temp_vertices) const {
+    assert(!is_directed() && (supports_attributes() || !G.supports_attributes()));
+    ipairs E;
+    int lab,k,i,hcol=default_highlighted_vertex_color;
+    get_edges_as_pairs(E);
+    G.clear();
+    if (G.supports_attributes()) {
+        G.add_nodes(vertices());
+        lab=G.largest_integer_label();
+    } else G.add_nodes(node_count());
+    for (ipairs_iter it=E.begin();it!=E.end();++it) {
+        const ipair &e=*it;
+        k=multiedges(e);
+        if (k>0) {
+            for (int c=0;c<=k;++c) {
+                i=G.supports_attributes()?G.add_node(++lab):G.add_node();
+                if (color_temp_vertices) {
+                    if (G.supports_attributes())
+                        G.set_node_attribute(i,_GT_ATTRIB_COLOR,hcol);
+                    else G.set_node_color(i,hcol);
+                }
+                G.add_edge(e.first,i);
+                G.add_edge(e.second,i);
+            }
+        } else G.add_edge(e);
     }
-    assert(!I.empty());
-    if (I.size()==1)
-        b=I.front();
-    else {
-        int N=I.size();
-        vector<pair<double,int> > sorted_by_obj_coeff;
-        ivector ind(N);
-        for (ivector_iter it=I.begin();it!=I.end();++it) {
-            sorted_by_obj_coeff.push_back(make_pair(obj[*it],*it));
-        }
-        std::sort(sorted_by_obj_coeff.begin(),sorted_by_obj_coeff.end());
-        dvector data2(N),data1(0);
-        for (int i=0;i<N;++i) {
-            ind[i]=sorted_by_obj_coeff[i].second;
-            data2[i]=sorted_by_obj_coeff[i].first;
+}
+
+/* permute vertices according to SHARC ordering by Michael Monagan */
+void graphe::sharc_order() {
+    /* assuming that the graph is connected */
+    assert(!is_null() && node_queue.empty());
+    int n=node_count(),i,j;
+    unset_subgraphs(0);
+    node(0).set_subgraph(1); // the set S has subgraph=1
+    node(0).set_visited(true);
+    ivector order(1,0); // vertices in S
+    order.reserve(n);
+    set<int> adj;
+    bool has_path;
+    while (subgraph_size(1)<n) {
+        /* collect vertices adjacent to S */
+        adj.clear();
+        for (ivector_iter it=order.begin();it!=order.end();++it) {
+            const vertex &v=node(*it);
+            for (ivector_iter jt=v.neighbors().begin();jt!=v.neighbors().end();++jt) {
+                if (node(*jt).subgraph()==0)
+                    adj.insert(*jt);
+            }
         }
-        std::reverse(data2.begin(),data2.end());
-        double mu1,mu2,sigma1,sigma2;
-        int i=1;
-        for (;i<N;++i) {
-            data1.push_back(data2.back());
-            data2.pop_back();
-            sample_mean_stddev(data1,mu1,sigma1);
-            sample_mean_stddev(data2,mu2,sigma2);
-            if (mu1+rho*sigma1<mu2-rho*sigma2)
-                break;
+        /* add vertices from S to queue */
+        for (set<int>::const_iterator it=adj.begin();it!=adj.end();++it) {
+            node_queue.push(*it);
         }
-        if (i==N) i=0;
-        /* the set I2 starts from i in ind */
-        ivector I2(ind.begin()+i,ind.end());
-        assert(!I2.empty());
-        N=I2.size();
-        double dist,mindist=DBL_MAX;
-        int j0=-1;
-        for (int j=0;j<N;++j) {
-            if ((dist=std::abs(0.5-xev[I2[j]]))<mindist) {
-                mindist=dist;
-                j0=j;
+        unvisit_all_nodes(0);
+        unset_all_ancestors(0);
+        has_path=false;
+        while (!node_queue.empty()) {
+            i=node_queue.front();
+            node_queue.pop();
+            vertex &v=node(i);
+            if (!v.is_visited()) {
+                v.set_visited(true);
+                for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
+                    vertex &w=node(j=*it);
+                    if (w.is_visited())
+                        continue;
+                    if (adj.find(j)!=adj.end()) {
+                        /* path found */
+                        w.set_ancestor(i);
+                        do {
+                            order.push_back(j);
+                            node(j).set_subgraph(1);
+                        } while ((j=node(j).ancestor())>=0);
+                        clear_node_queue();
+                        has_path=true;
+                        break;
+                    }
+                    if (w.subgraph()==0) {
+                        w.set_ancestor(i);
+                        node_queue.push(j);
+                    }
+                }
             }
         }
-        assert(j0>=0);
-        x0=xev[I2[j0]];
-        double c,maxc=0.0;
-        for (ivector_iter it=I2.begin();it!=I2.end();++it) {
-            xe=xev[*it];
-            if (xe>=x0-bctol && xe<=x0+bctol && (c=obj[*it])>maxc) {
-                maxc=c;
-                b=*it;
+        if (!has_path) {
+            i=*adj.begin();
+            node(i).set_subgraph(1);
+            order.push_back(i);
+        }
+    }
+    graphe G(*this);
+    G.isomorphic_copy(*this,order);
+}
+
+graphe::poly_cache graphe::tutte_cache(TUTTE_CACHE_BUDGET);
+
+/* implementation of poly_cache class */
+
+graphe::poly_cache::poly_cache(size_t budget) {
+    m_bytes=0;
+    m_budget=budget;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_init(&m_mutex,NULL);
+#endif
+}
+
+graphe::poly_cache::~poly_cache() {
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_destroy(&m_mutex);
+#endif
+}
+
+/* return the FNV-1a hash of the given key */
+ulong graphe::poly_cache::hash(const vector<ulong> &key) {
+    ulong h=2166136261u;
+    for (vector<ulong>::const_iterator it=key.begin();it!=key.end();++it) {
+        h=(h^*it)*16777619u;
+    }
+    return h;
+}
+
+/* remove the entry it from the hash index */
+void graphe::poly_cache::unindex(const entry_list::iterator &it) {
+    map<ulong,vector<entry_list::iterator> >::iterator jt=m_index.find(it->hash);
+    assert(jt!=m_index.end());
+    vector<entry_list::iterator> &bucket=jt->second;
+    for (vector<entry_list::iterator>::iterator kt=bucket.begin();kt!=bucket.end();++kt) {
+        if (*kt==it) {
+            bucket.erase(kt);
+            break;
+        }
+    }
+    if (bucket.empty())
+        m_index.erase(jt);
+}
+
+/* if the key is in cache, store the corresponding polynomial to p, mark the
+ * entry as most recently used and return true, else return false */
+bool graphe::poly_cache::find(const vector<ulong> &key,intpoly &p) {
+    bool found=false;
+    ulong h=hash(key);
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&m_mutex);
+#endif
+    map<ulong,vector<entry_list::iterator> >::const_iterator jt=m_index.find(h);
+    if (jt!=m_index.end()) {
+        for (vector<entry_list::iterator>::const_iterator kt=jt->second.begin();kt!=jt->second.end();++kt) {
+            if ((*kt)->key==key) {
+                m_lru.splice(m_lru.begin(),m_lru,*kt);
+                p=(*kt)->poly;
+                found=true;
+                break;
             }
         }
     }
-    assert(b>=0);
-    /* Padberg & Rinaldi suggest exploring the upper branch first */
-    glp_ios_branch_upon(tree,b+1,GLP_UP_BRNCH);
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&m_mutex);
+#endif
+    return found;
+}
+
+/* add the polynomial p with the given key to cache, evicting the least
+ * recently used entries if the memory budget is exceeded */
+void graphe::poly_cache::insert(const vector<ulong> &key,const intpoly &p) {
+    entry e;
+    e.hash=hash(key);
+    e.key=key;
+    e.poly=p;
+    e.bytes=sizeof(entry)+key.size()*sizeof(ulong)+p.size()*(sizeof(intpoly::value_type)+4*sizeof(void*));
+    if (e.bytes>m_budget)
+        return;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&m_mutex);
+#endif
+    m_lru.push_front(e);
+    m_index[e.hash].push_back(m_lru.begin());
+    m_bytes+=e.bytes;
+    while (m_bytes>m_budget) {
+        entry_list::iterator it=--m_lru.end();
+        m_bytes-=it->bytes;
+        unindex(it);
+        m_lru.erase(it);
+    }
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&m_mutex);
+#endif
 }
 
-/* row generation (originally written by Andrew Makhorin) */
-void graphe::tsp::rowgen(glp_tree *tree) {
-    if (mincut_data.empty())
-        mincut_data.resize(22);
-    glp_prob *prob=glp_ios_get_prob(tree);
-    int i,j,k,m=ne,n=nv,nedg=0,nz;
-    double sum,xk;
-    for (k=0;k<m;k++) {
-        if (glp_get_col_prim(prob,k+1)>=.001)
-            nedg++;
+/* remove all entries */
+void graphe::poly_cache::clear() {
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&m_mutex);
+#endif
+    m_lru.clear();
+    m_index.clear();
+    m_bytes=0;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+/* end of poly_cache class implementation */
+
+/* add the polynomial b to a (a is changed in place) */
+void graphe::poly_add(intpoly &a,const intpoly &b) {
+    for (intpoly_iter it=b.begin();it!=b.end();++it) {
+        a[it->first]+=it->second;
     }
-    /* build the capacitated network */
-    assert(nedg<=m);
-    ivector &beg=mincut_data[14]; if (int(beg.size())<nedg) beg.resize(nedg);
-    ivector &end=mincut_data[15]; if (int(end.size())<nedg) end.resize(nedg);
-    ivector &cap=mincut_data[16]; if (int(cap.size())<nedg) cap.resize(nedg);
-    nz=0;
-    for (k=0;k<m;k++) {
-        if ((xk=glp_get_col_prim(prob,k+1))>=.001) {
-            const arc &a=arcs[k];
-            beg[nz]=a.tail+1; end[nz]=a.head+1;
-            rlx_sol_map[a.tail][a.head]=xk;
-            cap[nz++]=std::ceil(1000*xk); // scale edge capacities to make them integral
+}
+
+/* multiply the polynomial a with b (a is changed in place) */
+void graphe::poly_mult(intpoly &a,const intpoly &b) {
+    intpoly c(a);
+    a.clear();
+    for (intpoly_iter it=b.begin();it!=b.end();++it) {
+        const ipair &p=it->first;
+        for (intpoly_iter jt=c.begin();jt!=c.end();++jt) {
+            const ipair &q=jt->first;
+            a[make_pair(p.first+q.first,p.second+q.second)]+=it->second*jt->second;
         }
     }
-    assert(nz==nedg);
-    ivector &cut=mincut_data[17]; if (int(cut.size())<n) cut.resize(n);
-    minimal_cut(n,nedg,beg,end,cap,cut); // find minimal cut in the capacitated network
-    nedg=0; sum=0;
-    for (i=0;i<n;i++) {
-        for (j=i+1;j<n;j++) {
-            if ((cut[i] && !cut[j]) || (!cut[i] && cut[j])) {
-                nedg++;
-                sum+=rlx_sol_map[i][j];
-            }
-        }
+}
+
+/* return the geometric sequence in variable var (1 or 2) of length k */
+graphe::intpoly graphe::poly_geom(int var,int k,bool leading_one,bool add_other_var) {
+    assert((var==1 || var==2) && k>0);
+    intpoly res;
+    for (int i=leading_one?0:1;i<k;++i) {
+        res[make_pair(var==1?i:0,var==2?i:0)]=1;
     }
-    /* if the (unscaled) capacity of min cut is less than 2, the
-     * corresponding subtour elimination constraint is violated */
-    if (sum<=1.999) {
-        nz=0;
-        for (i=0;i<n;i++) {
-            for (j=i+1;j<n;j++) {
-                if ((cut[i] && !cut[j]) || (!cut[i] && cut[j])) {
-                    nz++;
-                    assert(nz<=nedg);
-                    indices[nz]=edge_index(make_pair(i,j))+1;
-                    coeff[nz]=1.0;
+    if (add_other_var)
+        res[make_pair(var==2?1:0,var==1?1:0)]=1;
+    return res;
+}
+
+/* return 1 as polynom */
+graphe::intpoly graphe::poly_one() {
+    intpoly res;
+    res[make_pair(0,0)]=1;
+    return res;
+}
+
+/* convert list of integers to a 2-variable polynomial with integral coefficients */
+gen graphe::intpoly2gen(const intpoly &v,const gen &x,const gen &y) {
+    int pwx,pwy,cf;
+    gen p(0);
+    for (intpoly_iter it=v.begin();it!=v.end();++it) {
+        pwx=it->first.first;
+        pwy=it->first.second;
+        cf=it->second;
+        p+=gen(cf)*(pwx==0?gen(1):pow(x,pwx))*(pwy==0?gen(1):pow(y,pwy));
+    }
+    return p;
+}
+
+/* create the budget with the given number of idle threads */
+graphe::tutte_budget::tutte_budget(int idle) {
+    m_idle=idle;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_init(&m_mutex,NULL);
+#endif
+}
+
+graphe::tutte_budget::~tutte_budget() {
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_destroy(&m_mutex);
+#endif
+}
+
+/* take an idle thread from the budget, return false if there is none */
+bool graphe::tutte_budget::acquire() {
+    bool res=false;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&m_mutex);
+    if (m_idle>0) {
+        --m_idle;
+        res=true;
+    }
+    pthread_mutex_unlock(&m_mutex);
+#endif
+    return res;
+}
+
+/* return a thread to the budget */
+void graphe::tutte_budget::release() {
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&m_mutex);
+    ++m_idle;
+    pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+void *graphe::tutte_thread(void *arg) {
+    tutte_thread_data *data=static_cast<tutte_thread_data*>(arg);
+    data->poly=data->G->tutte_poly_recurse(1,*data->budget);
+    data->budget->release();
+    return NULL;
+}
+
+/* compute the Tutte polynomial for this graph, using vorder-push heuristic */
+graphe::intpoly graphe::tutte_poly_recurse(int vc,tutte_budget &budget) {
+    intpoly p=poly_one(),fac;
+    int n=node_count(),adj_sz,snv;
+    bool spawned;
+#ifdef HAVE_LIBPTHREAD
+    pthread_t thread;
+    tutte_thread_data data;
+#endif
+    ipair e;
+    vector<ipairs> blocks;
+    ipairs E;
+    graphe G(ctx,false),Gd(ctx,false),Gc(ctx,false);
+    vector<ulong> key;
+    ivector col;
+    int *adj;
+    size_t cg_sz;
+    switch (vc) {
+    case 2:
+        assert(n>2);
+        /* process cycles with multiedges */
+        if (is_cycle(E)) {
+            p=poly_geom(2,multiedges(E[n-1])+multiedges(E[n-2])+2,false,true);
+            for (int i=1;i<=n-2;++i) {
+                poly_mult(p,poly_geom(2,1+multiedges(E[i-1]),true));
+            }
+            for (int i=1;i<=n-2;++i) {
+                intpoly q=poly_one();
+                q[make_pair(0,0)]=1;
+                for (int j=i+1;j<=n;++j) {
+                    poly_mult(q,poly_geom(2,1+multiedges(E[j-1]),false,true));
                 }
+                for (int j=1;j<=i-1;++j) {
+                    poly_mult(q,poly_geom(2,1+multiedges(E[j-1]),true));
+                }
+                poly_add(p,q);
             }
+            break;
         }
-        assert(nz==nedg);
-        i=glp_add_rows(prob,1);
-        glp_set_row_bnds(prob,i,GLP_LO,2.0,0.0);
-        glp_set_mat_row(prob,i,nz,indices,coeff);
+        /* check for cached isomorphic graph */
+        simplify(G,true);
+        adj=G.to_array(adj_sz,true,true);
+        snv=G.node_count();
+        key.assign(1,snv);
+#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
+        cg_sz=nautywrapper_words_needed(snv)*(size_t)snv;
+        col.resize(snv);
+        key.resize(1+snv+cg_sz);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE,NULL);
+#ifdef HAVE_LIBPTHREAD
+        pthread_mutex_lock(&nauty_mutex);
+#endif
+        nautywrapper_canonical(0,snv,adj,NULL,&key[1+snv],&col.front());
+#ifdef HAVE_LIBPTHREAD
+        pthread_mutex_unlock(&nauty_mutex);
+#endif
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE,NULL);
+        for (int i=0;i<snv;++i) {
+            key[1+i]=col[i];
+        }
+#else
+        key.insert(key.end(),adj,adj+adj_sz);
+#endif
+        delete[] adj;
+        if (tutte_cache.find(key,p))
+            break;
+        /* no luck, perform the delete-contract step */
+        get_edges_as_pairs(E);
+        e=E.front();
+        for (ipairs_iter it=E.begin()+1;it!=E.end();++it) {
+            if (*it<e) e=*it;
+        }
+        fac=poly_geom(2,1+multiedges(e),true);
+        set_multiedge(e,0);
+        copy(Gd); copy(Gc); // copies to perform deletion-contraction on
+        Gd.remove_edge(e);
+        Gc.contract_edge(e.second,e.first,false);
+        spawned=false;
+#ifdef HAVE_LIBPTHREAD
+        /* if a thread is idle, let it process the deletion */
+        if (Gd.edge_count()>=TUTTE_PARALLEL_CUTOFF && (spawned=budget.acquire())) {
+            Gd.detach_nodes();
+            data.G=&Gd;
+            data.budget=&budget;
+            if (pthread_create(&thread,(pthread_attr_t *)NULL,tutte_thread,(void *)&data)!=0) {
+                budget.release();
+                spawned=false;
+            }
+        }
+        if (spawned) {
+            poly_mult(fac,Gc.tutte_poly_recurse(1,budget));
+            pthread_join(thread,NULL);
+            p=data.poly;
+        }
+#endif
+        if (!spawned) {
+            p=Gd.tutte_poly_recurse(1,budget);
+            poly_mult(fac,Gc.tutte_poly_recurse(1,budget));
+        }
+        poly_add(p,fac);
+        /* cache the graph and its polynomial for future use */
+        tutte_cache.insert(key,p);
+        break;
+    case 1:
+        find_blocks(blocks);
+        for (vector<ipairs>::iterator it=blocks.begin();it!=blocks.end();++it) {
+            ipairs &block=*it;
+            assert(!block.empty());
+            if (block.size()==1) { // bridge
+                poly_mult(p,poly_geom(2,1+multiedges(block.front()),false,true));
+            } else { // non-trivial biconnected subgraph
+                std::sort(block.begin(),block.end());
+                extract_subgraph(block,G);
+                poly_mult(p,G.tutte_poly_recurse(2,budget));
+            }
+        }
+        break;
+    default:
+        assert(false);
     }
+    return p;
 }
 
-/* MIP callback routine */
-void graphe::tsp::callback(glp_tree *tree,void *info) {
-    if (is_interrupted()) {
-        glp_ios_terminate(tree);
+/* return the Tutte polynomial of this graph */
+gen graphe::tutte_polynomial(const gen &x,const gen &y) {
+    assert(!is_directed());
+    tutte_budget budget(max_threads()-1);
+    intpoly p;
+    graphe G(ctx,false);
+    ivector sigma;
+    p=poly_one();
+    connected_components_to_subgraphs();
+    int sc=max_subgraph_index(),i;
+    for (i=1;i<=sc;++i) {
+        if (subgraph_size(i)<2)
+            continue;
+        sort_by_degrees(G,sigma,i);
+        G.sharc_order();
+        poly_mult(p,G.tutte_poly_recurse(1,budget));
+    }
+    return intpoly2gen(p,x,y);
+}
+
+/* find all fundamental cycles in this graph */
+void graphe::fundamental_cycles(ivectors &cycles,int sg,gt_conn_check cc) {
+    assert(!is_directed());
+    ivectors components;
+    int cmp,s;
+    switch (cc) {
+    case _GT_CC_CONNECTED:
+        break;
+    case _GT_CC_COMPONENTS_ARE_SUBGRAPHS:
+        cmp=max_subgraph_index();
+        for (s=1;s<=cmp;++s) {
+            fundamental_cycles(cycles,s,_GT_CC_CONNECTED);
+        }
+        return;
+    case _GT_CC_FIND_COMPONENTS:
+        s=sg<0?1:1+max_subgraph_index();
+        cmp=connected_components_to_subgraphs(sg);
+        for (;s<=cmp;++s) {
+            fundamental_cycles(cycles,s,_GT_CC_CONNECTED);
+            renumber_subgraph(s,sg);
+        }
         return;
+    default: assert(false);
     }
-    tsp *tsprob=static_cast<tsp*>(info);
-    switch (glp_ios_reason(tree)) {
-    case GLP_IHEUR:
-        tsprob->heur(tree);
-        break;
-    case GLP_IBRANCH:
-        if (tsprob->isweighted && _rand(makesequence(0,1),tsprob->G->giac_context()).DOUBLE_val()<0.14)
-            tsprob->select_branching_variable(tree);
-        break;
-    case GLP_IROWGEN:
-        if (tsprob->is_symmetric_tsp)
-            tsprob->rowgen(tree);
-        break;
-    default:
-        break;
+    ipairs E,nte;
+    get_edges_as_pairs(E,sg);
+    int root=sg<0?0:first_vertex_from_subgraph(sg),i,j;
+    dfs(root,true,true,NULL,sg);
+    for (ipairs_iter it=E.begin();it!=E.end();++it) {
+        i=it->first; j=it->second;
+        if (node(i).ancestor()!=j && node(j).ancestor()!=i)
+            nte.push_back(*it);
+    }
+    for (ipairs_iter it=nte.begin();it!=nte.end();++it) {
+        const vertex &v=node(it->first),&w=node(it->second);
+        i=v.disc()>w.disc()?it->first:it->second;
+        j=v.disc()<w.disc()?it->first:it->second;
+        ivector c;
+        while (i!=j) {
+            c.push_back(i);
+            i=node(i).ancestor();
+            assert(i>=0);
+        }
+        c.push_back(j);
+        cycles.push_back(c);
     }
 }
 
-/* min weight perfect matching solver callback routine */
-void graphe::tsp::min_wpm_callback(glp_tree *tree,void *info) {
-    if (is_interrupted()) {
-        glp_ios_terminate(tree);
-        return;
+/* construct Mycielski graph with 2n+1 vertices and 3m+n edges */
+void graphe::mycielskian(graphe &G) const {
+    assert(!is_directed());
+    ipairs E;
+    get_edges_as_pairs(E);
+    int lab=largest_integer_label(),n=node_count(),m=E.size();
+    copy(G);
+    ivector u(n);
+    for (int i=0;i<n;++i) {
+        u[i]=G.add_node(++lab);
     }
-    pair<const ivector*,tsp*> *origin=static_cast<pair<const ivector*,tsp*>*>(info);
-    const ivector *eind=origin->first;
-    tsp *tsprob=origin->second;
-    switch (glp_ios_reason(tree)) {
-    case GLP_IHEUR:
-        tsprob->min_wpm_heur(tree,*eind);
-        break;
-    default:
-        break;
+    int w=G.add_node(++lab);
+    for (ipairs_iter it=E.begin();it!=E.end();++it) {
+        G.add_edge(it->first,u[it->second]);
+        G.add_edge(it->second,u[it->first]);
+    }
+    for (int i=0;i<n;++i) {
+        G.add_edge(w,u[i]);
     }
+    assert(G.node_count()==2*n+1 && G.edge_count()==3*m+n);
 }
 
-/*
-* END OF TSP CLASS IMPLEMENTATION
-*/
-
-/*
- * ATSP CLASS (asymmetric traveling salesman problem)
- */
- 
-graphe::atsp::atsp(graphe *gr,const ipairs &must_include_arcs,double gap_tolerance,bool is_verbose) {
-    G=gr;
-    mia=must_include_arcs;
-    mip=NULL;
-    isweighted=G->is_weighted();
-    gap_tol=gap_tolerance;
-    verbose=is_verbose;
+/* return the local clustering coefficient of the i-th vertex */
+gen graphe::local_clustering_coeff(int i) const {
+    assert(!is_directed());
+    const vertex &v=node(i);
+    const ivector &vn=v.neighbors();
+    int d=vn.size(),cnt=0;
+    for (ivector_iter it=vn.begin();it!=vn.end();++it) {
+        const ivector &wn=node(*it).neighbors();
+        cnt+=intersect_linear(vn.begin(),vn.end(),wn.begin(),wn.end());
+    }
+    return _ratnormal(fraction(cnt,d*(d-1)),ctx);
 }
 
-graphe::atsp::~atsp() {
-    if (mip!=NULL) glp_delete_prob(mip);
+/* return the clustering coefficient of this graph */
+gen graphe::clustering_coeff(bool approx,bool exact) {
+    assert(!is_directed());
+    int i,j,n=node_count();
+    if (n<3) return 0;
+    if (approx) {
+        /* approximate within +-1/2*1e-2 with probability 0.9999 */
+        int k=184207,l=0,u,v;
+        for (i=0;i<k;++i) {
+            j=rand_integer(n);
+            const ivector &ngh=node(j).neighbors();
+            u=ngh[rand_integer(ngh.size())];
+            while (u==(v=ngh[rand_integer(ngh.size())]));
+            if (has_edge(u,v)) ++l;
+        }
+        return _evalf(fraction(l,k),ctx);
+    }
+    return triangle_count(NULL,true,exact);
 }
 
-bool graphe::atsp::solve(ivector &hc,double &cost) {
-    if (mip!=NULL) glp_erase_prob(mip);
-    else mip=glp_create_prob();
-    glp_set_obj_dir(mip,GLP_MIN);
-    int n=G->node_count(),nz=8+8*n*(n-2)+n*ft.size(),i,j,r,c=0,res;
-    int *u=new int[n];
-    int **x=new int*[n];
-    for (i=0;i<n;++i) x[i]=new int[n];
-    int *ia=new int[nz+1];
-    int *ja=new int[nz+1];
-    double *ar=new double[nz+1];
-    double w;
-    gen e;
-    ipairs E;
-    G->get_edges_as_pairs(E);
-    /* add variables */
-    for (ipairs_iter it=E.begin();it!=E.end();++it) {
-        i=it->first; j=it->second;
-        x[i][j]=glp_add_cols(mip,1);
-        if (find(mia.begin(),mia.end(),*it)!=mia.end())
-            glp_set_col_bnds(mip,x[i][j],GLP_FX,1,1);
-        else glp_set_col_kind(mip,x[i][j],GLP_BV);
-        if (isweighted) {
-            if (!is_real_number(G->weight(i,j),G->giac_context())) {
-                G->message(1,"arc weight is not numeric, replacing by 1");
-                w=1;
-            } else w=to_real_number(G->weight(i,j),G->giac_context()).to_double(G->giac_context());
-        } else w=1;
-        glp_set_obj_coef(mip,x[i][j],w);
-    }
-    for (i=1;i<n;++i) {
-        u[i]=glp_add_cols(mip,1);
-        glp_set_col_bnds(mip,u[i],GLP_DB,2,n);
-    }
-    /* create the basic constraints */
-    for (i=0;i<n;++i) {
-        r=glp_add_rows(mip,2);
-        glp_set_row_bnds(mip,r,GLP_FX,1,1);
-        glp_set_row_bnds(mip,r+1,GLP_FX,1,1);
-        for (j=0;j<n;++j) {
-            if (i==j) continue;
-            if (G->has_edge(i,j)) { ia[++c]=x[i][j]; ja[c]=r; ar[c]=1; }
-            if (G->has_edge(j,i)) { ia[++c]=x[j][i]; ja[c]=r+1; ar[c]=1; }
+/* return the triangle density (transitivity) of this graph */
+gen graphe::transitivity() {
+    gen num_triangles(0),num_triplets(0);
+    if (!is_directed()) {
+        num_triangles=gen(3)*triangle_count();
+        node_iter it=nodes.begin(),itend=nodes.end();
+        for (;it!=itend;++it) {
+            num_triplets+=comb(it->neighbors().size(),2);
         }
-    }
-    /* SEC: an enhanced formulation of Miller et al. */
-    for (i=1;i<n;++i) {
-        for (j=1;j<n;++j) {
-            if (i==j) continue;
-            r=glp_add_rows(mip,1);
-            glp_set_row_bnds(mip,r,GLP_UP,0,n-1);
-            ia[++c]=u[i]; ja[c]=r; ar[c]=1;
-            ia[++c]=u[j]; ja[c]=r; ar[c]=-1;
-            if (G->has_edge(i,j)) { ia[++c]=x[i][j]; ja[c]=r; ar[c]=n; }
-            if (G->has_edge(j,i)) { ia[++c]=x[j][i]; ja[c]=r; ar[c]=n-2; }
+    } else {
+        ipairs E;
+        get_edges_as_pairs(E);
+        int i,j;
+        ipairs_iter it=E.begin(),itend=E.end();
+        for (;it!=itend;++it) {
+            i=it->first; j=it->second;
+            const vertex &v=node(i),&w=node(j);
+            const ivector &vn=v.neighbors(),&wn=w.neighbors();
+            num_triangles+=intersect_linear(vn.begin(),vn.end(),wn.begin(),wn.end());
+            num_triplets+=wn.size()-(w.has_neighbor(i)?1:0);
         }
     }
-    /* forbid the specified tours */
-    for (ivectors_iter it=ft.begin();it!=ft.end();++it) {
-        r=glp_add_rows(mip,1);
-        glp_set_row_bnds(mip,r,GLP_UP,0,n-1);
-        for (int k=0;k<n;++k) {
-            i=it->at(k); j=it->at(k+1);
-            assert(G->has_edge(i,j));
-            ia[++c]=x[i][j]; ja[c]=r; ar[c]=1;
+    if (giac::is_zero(num_triplets))
+        return 0;
+    return _ratnormal(fraction(num_triangles,num_triplets),ctx);
+}
+
+/* return the edge connectivity of this graph using Matula's algorithm */
+int graphe::edge_connectivity() {
+    int n=node_count();
+    assert(n>=2 && !is_directed());
+    set<int> D,A;
+    int p,lambda=rand_max2,d,v,w,lambda_vw,maxdeg,i;
+    /* set lambda to its upper bound */
+    for (i=0;i<n;++i) {
+        if ((d=degree(i))<lambda) {
+            p=i;
+            lambda=d;
         }
     }
-    assert(c<=nz);
-    glp_load_matrix(mip,c,ja,ia,ar);
-    delete[] ia; delete[] ja; delete[] ar; delete[] u;
-    /* solve the problem */
-    glp_iocp parm;
-    glp_init_iocp(&parm);
-    parm.msg_lev=GLP_MSG_ON;
-    parm.br_tech=GLP_BR_MFV;
-    parm.bt_tech=GLP_BT_DFS;
-    parm.presolve=GLP_ON;
-    parm.gmi_cuts=GLP_ON;
-    parm.mir_cuts=GLP_ON;
-    parm.cov_cuts=GLP_ON;
-    parm.clq_cuts=GLP_ON;
-    parm.fp_heur=GLP_ON;
-    parm.sr_heur=GLP_ON;
-    parm.mip_gap=gap_tol;
-    parm.cb_func=&callback;
-    parm.cb_info=static_cast<void*>(this);
-    select_blb=false;
-    bool ret=false;
-    if ((res=glp_intopt(mip,&parm))==0 || res==GLP_EMIPGAP || res==GLP_ESTOP) {
-        ret=true;
-        switch(glp_mip_status(mip)) {
-        case GLP_FEAS:
-            if (verbose)
-                G->message(1,"the solution is not necessarily optimal");
-        case GLP_OPT:
-            break;
-        case GLP_UNDEF:
-            if (verbose)
-                G->message(1,"the solution is undefined");
-        case GLP_NOFEAS:
-            ret=false;
-            break;
+    /* construct a dominating set D */
+    v=p; maxdeg=lambda;
+    for (i=0;i<n;++i) {
+        A.insert(i);
+        if (i!=v && (d=degree(i))>maxdeg) {
+            maxdeg=d;
+            v=i;
         }
-        if (ret) {
-            cost=glp_mip_obj_val(mip);
-            int n=G->node_count(),i,j,pos=0;
-            hc.resize(n+1,0);
-            while (pos<n) {
-                i=hc[pos];
-                for (j=0;j<n;++j) {
-                    if (i==j || !G->has_edge(i,j)) continue;
-                    if (glp_mip_col_val(mip,x[i][j])>0.5) {
-                        hc[++pos]=j;
-                        break;
-                    }
-                }
-                assert(j<n);
-            }
-            assert(hc.back()==hc.front());
+    }
+    set<int>::iterator sit;
+    while (true) {
+        D.insert(v);
+        A.erase(A.find(v));
+        const vertex &vv=node(v);
+        for (ivector_iter it=vv.neighbors().begin();it!=vv.neighbors().end();++it) {
+            sit=A.find(*it);
+            if (sit!=A.end())
+                A.erase(sit);
         }
+        if (A.empty()) break;
+        v=*A.begin();
     }
-    terminated=(res==GLP_ESTOP);
-    for (i=0;i<n;++i) delete[] x[i];
-    delete[] x;
-    return ret;
+    /* find lambda(G), every edge is a pair of opposite arcs with unit capacity */
+    flow_network F(n);
+    make_flow_network(F,false);
+    v=*D.begin();
+    D.erase(D.begin());
+    for (set<int>::const_iterator it=D.begin();it!=D.end();++it) {
+        w=*it;
+        lambda_vw=(int)F.dinic(v,w);
+        if (lambda_vw<lambda)
+            lambda=lambda_vw;
+    }
+    return lambda;
 }
 
-/* MIP callback routine */
-void graphe::atsp::callback(glp_tree *tree,void *info) {
-    if (is_interrupted()) {
-        glp_ios_terminate(tree);
-        return;
+/* make the network F in which every vertex i is split into the arc (2i,2i+1)
+ * with unit capacity, the arcs entering i are connected to 2i and the arcs leaving
+ * i are connected to 2i+1 (the maximum flow from 2v+1 to 2w is the number of
+ * internally vertex-disjoint paths from v to w) */
+void graphe::make_split_network(flow_network &F) const {
+    int n=node_count();
+    for (int i=0;i<n;++i) {
+        F.add_arc(2*i,2*i+1,1);
+        const vertex &u=node(i);
+        for (ivector_iter it=u.neighbors().begin();it!=u.neighbors().end();++it) {
+            F.add_arc(2*i+1,2*(*it),1);
+        }
     }
-    atsp *atsprob=static_cast<atsp*>(info);
-    switch (glp_ios_reason(tree)) {
-    case GLP_ISELECT:
-        if (atsprob->select_blb)
-            glp_ios_select_node(tree,glp_ios_best_node(tree));
-        break;
-    case GLP_IBINGO:
-        atsprob->select_blb=true;
-        break;
-    default:
-        break;
+    F.build();
+}
+
+/* return the vertex connectivity of an undirected graph */
+int graphe::vertex_connectivity() {
+    int n=node_count(),k=rand_max2,mindeg=rand_max2,deg,v;
+    for (int i=0;i<n;++i) {
+        if ((deg=degree(i))<mindeg) {
+            v=i;
+            mindeg=deg;
+        }
+    }
+    flow_network F(2*n);
+    make_split_network(F);
+    for (int i=0;i<n;++i) {
+        if (i==v || has_edge(i,v))
+            continue;
+        k=std::min(k,(int)F.dinic(2*v+1,2*i));
+    }
+    ivector adj;
+    adjacent_nodes(v,adj);
+    for (ivector_iter it=adj.begin();it!=adj.end();++it) {
+        for (ivector_iter jt=it+1;jt!=adj.end();++jt) {
+            if (has_edge(*it,*jt)) continue;
+            k=std::min(k,(int)F.dinic(2*(*it)+1,2*(*jt)));
+        }
     }
+    return k;
 }
 
-void graphe::atsp::ksolve(int k,ivectors &hcv,dvector &costs) {
-    hcv.clear();
-    costs.clear();
-    ft.clear();
-    hcv.reserve(k);
-    costs.reserve(k);
-    ft.reserve(k-1);
-    ivector hc;
-    double cost;
-    int term_old;
-    if (verbose)
-        glp_term_hook(term_hook,static_cast<void*>(logptr(G->giac_context())));
-    else term_old=glp_term_out(GLP_OFF);
-    terminated=false;
-    for (int cnt=0;!terminated && cnt<k;++cnt) {
-        if (!solve(hc,cost)) break;
-        if (verbose)
-            G->message(0,"Found the tour %d",cnt+1);
-        hcv.push_back(hc);
-        costs.push_back(cost);
-        if (cnt<k-1) ft.push_back(hc);
+/* truncate the graph, assuming that it is planar */
+void graphe::truncate(graphe &dest,const ivectors &faces) {
+    clear_embedding();
+    set_embedding(faces);
+    dest.clear();
+    int nv=node_count(),ne=edge_count(),n;
+    if (dest.supports_attributes()) {
+        vecteur V;
+        dest.make_default_labels(V,2*ne);
+        dest.add_nodes(V);
+    } else dest.add_nodes(2*ne);
+    int cnt=0,f;
+    ivector adj;
+    map<ipair,ivector> p;
+    for (int i=0;i<nv;++i) {
+        vertex &v=node(i);
+        n=v.neighbors().size();
+        ivector ngh;
+        adjacent_nodes(i,adj);
+        ngh.push_back(adj.back());
+        adj.pop_back();
+        while (!adj.empty()) {
+            f=v.edge_face(ngh.back());
+            ivector::iterator it=adj.begin();
+            for (;it!=adj.end() && f!=node(*it).edge_face(i);++it);
+            assert(it!=adj.end());
+            ngh.push_back(*it);
+            adj.erase(it);
+        }
+        for (int j=0;j<n;++j) {
+            p[make_pair(i<ngh[j]?i:ngh[j],i<ngh[j]?ngh[j]:i)].push_back(cnt+j);
+            dest.add_edge(cnt+j,cnt+(j+1)%n);
+        }
+        cnt+=n;
+    }
+    ipairs E;
+    get_edges_as_pairs(E);
+    for (ipairs_iter it=E.begin();it!=E.end();++it) {
+        const ivector &iv=p[*it];
+        assert(iv.size()==2);
+        dest.add_edge(iv.front(),iv.back());
     }
-    if (verbose)
-        glp_term_hook(NULL,NULL);
-    else glp_term_out(term_old);
 }
 
 /*
-* END OF ATSP CLASS IMPLEMENTATION
-*/
+ * BRON-KERBOSCH CLASS IMPLEMENTATION:
+ * maximal cliques are enumerated by the algorithm of Eppstein, Loeffler and
+ * Strash. The outer loop visits the vertices in degeneracy order, so that the
+ * candidate set of each vertex v consists of at most d (degeneracy) of its
+ * later neighbors. The neighborhood of v is copied into a local adjacency
+ * matrix of bitsets, in which the pivoting variant of Tomita et al. is run.
+ * The vertices of the outer loop are distributed over worker threads.
+ */
 
+/* return the number of set bits in w */
+static inline int bit_count(ulong w) {
+#ifdef __GNUC__
+    return __builtin_popcountl(w);
+#else
+    int c=0;
+    for (;w!=0;w&=w-1) ++c;
+    return c;
 #endif
+}
 
-/* Try to find an optimal Hamiltonian cycle.
- * Return 0 if the graph is not Hamiltonian, else store the circuit in h
- * and return 1, if unable to solve return -1 */
-int graphe::traveling_salesman(int k,ivectors &hcv,dvector &costs,double gap_tol,bool verbose) {
-#ifdef HAVE_LIBGLPK
-    tsp t(this,gap_tol,verbose);
-    if (k==0) { // tour approximation
-        double ratio;
-        ivector h;
-        if (t.approx(h,ratio)) {
-            //message("The tour cost is within %d%% of the optimal value",std::floor((ratio-1.0)*100.0+.5));
-            costs.push_back(t.tour_cost(h));
-            hcv.push_back(h);
-            return 1;
-        }
-        return -1;
-    }
-    assert(k>0);
-    return t.solve(k,hcv,costs);
+/* return the index of the lowest set bit in w!=0 */
+static inline int lowest_bit(ulong w) {
+#ifdef __GNUC__
+    return __builtin_ctzl(w);
 #else
-    message("Error: GLPK library is required for solving traveling salesman problem");
-    return -1;
+    int i=0;
+    for (;(w&1)==0;w>>=1) ++i;
+    return i;
 #endif
 }
 
-/* find first k optimal tours in a directed graph */
-bool graphe::find_directed_tours(int k,ivectors &hcv,dvector &costs,const ipairs &incl,double gap_tol,bool verbose) {
-    if (!is_directed()) {
-        message(2,"the graph must be directed");
-        return false;
-    }
-#ifdef HAVE_LIBGLPK
-    atsp t(this,incl,gap_tol,verbose);
-    t.ksolve(k,hcv,costs);
-    return true;
-#else
-    message("Error: GLPK library is required for solving traveling salesman problem");
-    return false;
+#define BK_WORD_BITS (8*sizeof(ulong))
+
+graphe::bron_kerbosch::bron_kerbosch(const graphe *gr) {
+    G=gr;
+    n=G->node_count();
+    m_cliques=NULL;
+    m_handler=NULL;
+    m_handler_data=NULL;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_init(&m_mutex,NULL);
 #endif
 }
 
-/* for each edge of the graph, assign the distance between endpoints as a weight */
-bool graphe::make_euclidean_distances() {
-    layout x;
-    if (is_directed() || !has_stored_layout(x))
-        return false;
-    if (!x.empty()) {
-        int n=node_count();
-        set_weighted(true);
-        point pq(x.front().size());
-        for (int i=0;i<n;++i) {
-            const vertex &v=node(i);
-            const point &p=x[i];
-            for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-                const point &q=x[*it];
-                set_edge_attribute(i,*it,_GT_ATTRIB_WEIGHT,gen(point_distance(p,q,pq)));
-            }
-        }
-    }
-    return true;
+graphe::bron_kerbosch::~bron_kerbosch() {
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_destroy(&m_mutex);
+#endif
 }
 
-/* find the maximum flow using Edmonds-Karp algorithm (exact computation) */
-gen graphe::maxflow_edmonds_karp(int s,int t,vector<map<int,gen> > &flow,const gen &limit) {
-    assert(is_directed() && node_queue.empty());
-    gen mf(0),df; // the value of maximum flow
-    int n=node_count(),i,j;
-    vector<map<int,gen> > cap(n);
-    /* initialize arc capacities and flows */
-    flow.resize(n);
-    bool isweighted=is_weighted();
-    node_iter nt=nodes.begin(),ntend=nodes.end();
-    ivector_iter it,itend;
-    for (i=0;nt!=ntend;++nt,++i) {
-        map<int,gen> &c=cap[i];
-        flow[i].clear();
-        for (it=nt->neighbors().begin(),itend=nt->neighbors().end();it!=itend;++it) {
-            j=*it;
-            c[j]=isweighted?weight(i,j):gen(1); // all capacities are set to 1 in unweighted graphs
-        }
+/* compute the degeneracy ordering of the vertices by the algorithm of Batagelj and Zaversnik */
+void graphe::bron_kerbosch::degeneracy_order() {
+    ivector deg(n),bin,vert(n);
+    int maxdeg=0,d,i,j,u,w,pu,pw;
+    m_position.resize(n);
+    for (i=0;i<n;++i) {
+        deg[i]=G->degree(i);
+        maxdeg=std::max(maxdeg,deg[i]);
     }
-    ipairs pred(n);
-    ipair nullpair=make_pair(-1,-1);
-    while (true) {
-        /* run BFS */
-        node_queue.push(s);
-        std::fill(pred.begin(),pred.end(),nullpair);
-        while (!node_queue.empty()) {
-            i=node_queue.front();
-            node_queue.pop();
-            const vertex &v=node(i);
-            for (it=v.neighbors().begin(),itend=v.neighbors().end();it!=itend;++it) {
-                j=*it;
-                if (j!=s && pred[j]==nullpair && is_strictly_greater(cap[i][j],flow[i][j],ctx)) {
-                    pred[j]=make_pair(i,j);
-                    node_queue.push(j);
+    bin.assign(maxdeg+1,0);
+    for (i=0;i<n;++i) ++bin[deg[i]];
+    for (d=0,i=0;d<=maxdeg;++d) {
+        j=bin[d];
+        bin[d]=i;
+        i+=j;
+    }
+    for (i=0;i<n;++i) {
+        m_position[i]=bin[deg[i]]++;
+        vert[m_position[i]]=i;
+    }
+    for (d=maxdeg;d>0;--d) bin[d]=bin[d-1];
+    bin[0]=0;
+    for (i=0;i<n;++i) {
+        u=vert[i];
+        const ivector &ngh=G->node(u).neighbors();
+        for (ivector_iter it=ngh.begin();it!=ngh.end();++it) {
+            w=*it;
+            if (deg[w]>deg[u]) {
+                /* move w to the beginning of its bin and decrease its degree */
+                d=deg[w];
+                pw=m_position[w];
+                pu=bin[d];
+                j=vert[pu];
+                if (j!=w) {
+                    m_position[w]=pu; vert[pu]=w;
+                    m_position[j]=pw; vert[pw]=j;
                 }
+                ++bin[d];
+                --deg[w];
             }
-        }
-        if (pred[t]!=nullpair) {
-            /* found an augmenting path */
-            df=plusinf();
-            /* compute df = how much flow can we send ... */
-            for (ipair e=pred[t];e.first>=0;e=pred[e.first]) {
-                df=min(df,cap[e.first][e.second]-flow[e.first][e.second],ctx);
-            }
-            /* ... and increase edge flows by df */
-            for (ipair e=pred[t];e.first>=0;e=pred[e.first]) {
-                flow[e.first][e.second]+=df;
-                flow[e.second][e.first]-=df;
-            }
-            mf+=df;
-            if (is_greater(mf,limit,ctx))
-                break;
-        } else break;
+        }
     }
-    return mf; // return the maximum flow
+    m_order=vert;
 }
 
-/* obtain a minimum cut from maximum flow */
-void graphe::minimum_cut(int s,const vector<map<int,gen> > &flow,ipairs &cut) {
-    /* create the residual network */
-    graphe G(ctx,false);
-    G.add_nodes(node_count());
-    G.make_directed();
-    cut.clear();
-    int i,j;
-    gen c,f;
-    bool isweighted=is_weighted();
-    map<int,gen>::const_iterator mit;
-    node_iter it,itend;
-    ivector_iter jt,jtend;
-    for (i=0,it=nodes.begin(),itend=nodes.end();it!=itend;++it,++i) {
-        const map<int,gen> &flowi=flow[i];
-        for (jt=it->neighbors().begin(),jtend=it->neighbors().end();jt!=jtend;++jt) {
-            j=*jt;
-            f=max(0,(mit=flowi.find(j))!=flowi.end()?mit->second:gen(0),ctx);
-            c=isweighted?weight(i,j):gen(1);
-            if (!giac::is_zero(_ratnormal(c-f,ctx),ctx))
-                G.add_edge(i,j);
+/* return the next vertex of the outer loop or -1 if all have been taken */
+int graphe::bron_kerbosch::next_vertex() {
+    int v=-1;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&m_mutex);
+#endif
+    if (m_next<n)
+        v=m_order[m_next++];
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&m_mutex);
+#endif
+    return v;
+}
+
+/* register the clique W.R */
+void graphe::bron_kerbosch::report(worker_data &W) {
+    ivector clique(W.R);
+    std::sort(clique.begin(),clique.end());
+    ++W.stats[clique.size()];
+    if (m_handler!=NULL) {
+#ifdef HAVE_LIBPTHREAD
+        pthread_mutex_lock(&m_mutex);
+#endif
+        m_handler(clique,m_handler_data);
+#ifdef HAVE_LIBPTHREAD
+        pthread_mutex_unlock(&m_mutex);
+#endif
+    } else if (m_cliques!=NULL)
+        W.cliques.push_back(clique);
+}
+
+/* the recursive part of the algorithm, P and X are bitsets over the local vertices,
+ * the space after them is used for deeper levels */
+void graphe::bron_kerbosch::expand(worker_data &W,ulong *P,ulong *X) {
+    int words=W.words,i,j,u=-1,w,c,maxc=-1;
+    ulong b;
+    bool empty=true;
+    for (i=0;i<words && empty;++i) {
+        if (P[i]!=0)
+            empty=false;
+    }
+    if (empty) {
+        for (i=0;i<words;++i) {
+            if (X[i]!=0)
+                return;
+        }
+        report(W);
+        return;
+    }
+    /* choose as the pivot the vertex from P or X with the most neighbors in P */
+    for (i=0;i<words;++i) {
+        for (b=P[i]|X[i];b!=0;b&=b-1) {
+            w=i*BK_WORD_BITS+lowest_bit(b);
+            const ulong *nw=&W.adj[w*words];
+            for (c=0,j=0;j<words;++j) {
+                c+=bit_count(P[j] & nw[j]);
+            }
+            if (c>maxc) {
+                maxc=c;
+                u=w;
+            }
+        }
+    }
+    /* branch on the vertices from P which are not adjacent to the pivot */
+    const ulong *nu=&W.adj[u*words];
+    ulong *Q=X+words,*Y=Q+words;
+    for (i=0;i<words;++i) {
+        for (b=P[i] & ~nu[i];b!=0;b&=b-1) {
+            j=lowest_bit(b);
+            w=i*BK_WORD_BITS+j;
+            const ulong *nw=&W.adj[w*words];
+            for (c=0;c<words;++c) {
+                Q[c]=P[c] & nw[c];
+                Y[c]=X[c] & nw[c];
+            }
+            W.R.push_back(W.local[w]);
+            expand(W,Q,Y);
+            W.R.pop_back();
+            P[i]&=~(ulong(1)<<j);
+            X[i]|=ulong(1)<<j;
+        }
+    }
+}
+
+/* enumerate the maximal cliques containing v but no vertex preceding v in the degeneracy order */
+void graphe::bron_kerbosch::process_vertex(worker_data &W,int v) {
+    const ivector &ngh=G->node(v).neighbors();
+    int k=ngh.size(),np=0,i,j,w,words,pos=m_position[v];
+    /* local vertices: later neighbors (candidates) first, then the earlier ones */
+    W.local.clear();
+    for (ivector_iter it=ngh.begin();it!=ngh.end();++it) {
+        if (m_position[*it]>pos)
+            W.local.push_back(*it);
+    }
+    np=W.local.size();
+    for (ivector_iter it=ngh.begin();it!=ngh.end();++it) {
+        if (m_position[*it]<pos)
+            W.local.push_back(*it);
+    }
+    words=W.words=std::max(1,int((k+BK_WORD_BITS-1)/BK_WORD_BITS));
+    for (i=0;i<k;++i) {
+        W.index[W.local[i]]=i;
+    }
+    /* local adjacency, edges between the earlier neighbors are not needed */
+    W.adj.assign(k*words,0);
+    for (i=0;i<np;++i) {
+        const ivector &wngh=G->node(W.local[i]).neighbors();
+        for (ivector_iter it=wngh.begin();it!=wngh.end();++it) {
+            if ((j=W.index[*it])<0)
+                continue;
+            W.adj[i*words+j/BK_WORD_BITS]|=ulong(1)<<(j%BK_WORD_BITS);
+            W.adj[j*words+i/BK_WORD_BITS]|=ulong(1)<<(i%BK_WORD_BITS);
         }
     }
-    /* run DFS on the residual network, store all discovered nodes */
-    ivector disc;
-    G.dfs(s,true,true,&disc);
-    unvisit_all_nodes();
-    for (jt=disc.begin(),jtend=disc.end();jt!=jtend;++jt) {
-        node(*jt).set_visited(true);
+    for (i=0;i<k;++i) {
+        W.index[W.local[i]]=-1;
     }
-    /* if, for an edge (u,v), u is discovered and v is not
-     * or vice versa, (u,v) belongs to the cut */
-    for (i=0,it=nodes.begin(),itend=nodes.end();it!=itend;++it,++i) {
-        for (jt=it->neighbors().begin(),jtend=it->neighbors().end();jt!=jtend;++jt) {
-            if (it->is_visited() && !node(*jt).is_visited())
-                cut.push_back(make_pair(i,*jt));
-        }
+    /* the recursion depth is at most np+1 */
+    if (W.stack.size()<size_t(2*(np+2)*words))
+        W.stack.resize(2*(np+2)*words);
+    ulong *P=&W.stack.front(),*X=P+words;
+    std::fill(P,P+2*words,0);
+    for (w=0;w<k;++w) {
+        if (w<np)
+            P[w/BK_WORD_BITS]|=ulong(1)<<(w%BK_WORD_BITS);
+        else X[w/BK_WORD_BITS]|=ulong(1)<<(w%BK_WORD_BITS);
     }
+    W.R.assign(1,v);
+    expand(W,P,X);
 }
 
-gen graphe::make_colon_label(const ivector &v) {
-    string str;
-    for (ivector_iter it=v.begin();it!=v.end();++it) {
-        str+=int2string(*it);
-        if (it+1!=v.end())
-            str+=":";
+void *graphe::bron_kerbosch::worker(void *arg) {
+    worker_data *W=static_cast<worker_data*>(arg);
+    W->index.assign(W->bk->n,-1);
+    int v;
+    while ((v=W->bk->next_vertex())>=0) {
+        W->bk->process_vertex(*W,v);
     }
-    return graphe::str2gen(str,true);
+    return NULL;
 }
 
-gen graphe::colon_label(int i, int j) {
-    ivector v(2);
-    v[0]=i; v[1]=j;
-    return make_colon_label(v);
+/* enumerate the maximal cliques, the number of k-cliques is stored to stats[k],
+ * the cliques are stored to cliques (if not NULL) in lexicographic order or passed
+ * one by one to handler (if not NULL), together with data */
+void graphe::bron_kerbosch::enumerate(map<int,int> &stats,ivectors *cliques,clique_handler handler,void *data,bool parallel) {
+    stats.clear();
+    if (cliques!=NULL)
+        cliques->clear();
+    m_cliques=cliques;
+    m_handler=handler;
+    m_handler_data=data;
+    degeneracy_order();
+    m_next=0;
+    int nt=parallel?std::min(max_threads(),std::max(1,n/BK_PARALLEL_MIN_VERTICES)):1;
+    vector<worker_data> W(nt);
+    vector<void*> args(nt);
+    for (int j=0;j<nt;++j) {
+        W[j].bk=this;
+        args[j]=(void*)&W[j];
+    }
+    run_threads(worker,args);
+    for (int j=0;j<nt;++j) {
+        for (map<int,int>::const_iterator it=W[j].stats.begin();it!=W[j].stats.end();++it) {
+            stats[it->first]+=it->second;
+        }
+        if (cliques!=NULL && handler==NULL)
+            cliques->insert(cliques->end(),W[j].cliques.begin(),W[j].cliques.end());
+    }
+    if (cliques!=NULL && handler==NULL)
+        std::sort(cliques->begin(),cliques->end());
 }
 
-gen graphe::colon_label(int i, int j,int k) {
-    ivector v(3);
-    v[0]=i; v[1]=j; v[2]=k;
-    return make_colon_label(v);
+/*
+ * END OF BRON-KERBOSCH CLASS IMPLEMENTATION
+ */
+
+/*
+ * BBMC CLASS IMPLEMENTATION:
+ * maximum clique is found by the bit-parallel branch-and-bound algorithm of
+ * San Segundo, Rodriguez-Losada and Jimenez (BBMC). The vertices are renumbered
+ * by the minimum width (degeneracy) ordering and the adjacency matrix is stored
+ * as a matrix of bitsets, so that candidate sets are intersected word by word.
+ * Candidates are bounded by greedy coloring, which is done one color class at
+ * a time. Vertices which would receive a color large enough to be branched on
+ * are first tried to be moved into a lower class by the infra-chromatic
+ * Re-NUMBER procedure of Tomita et al. (MCS). The branches at the root are
+ * distributed over worker threads which share the incumbent clique.
+ */
+
+graphe::bbmc::bbmc(const graphe *gr,bool complement) {
+    G=gr;
+    m_complement=complement;
+    n=G->node_count();
+    m_words=std::max(1,int((n+BK_WORD_BITS-1)/BK_WORD_BITS));
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_init(&m_mutex,NULL);
+#endif
 }
 
-/* convert this multigraph to simple graph by adding new colored vertices */
-void graphe::simplify(graphe &G,bool color_temp_vertices) const {
-    assert(!is_directed() && (supports_attributes() || !G.supports_attributes()));
-    ipairs E;
-    int lab,k,i,hcol=default_highlighted_vertex_color;
-    get_edges_as_pairs(E);
-    G.clear();
-    if (G.supports_attributes()) {
-        G.add_nodes(vertices());
-        lab=G.largest_integer_label();
-    } else G.add_nodes(node_count());
-    for (ipairs_iter it=E.begin();it!=E.end();++it) {
-        const ipair &e=*it;
-        k=multiedges(e);
-        if (k>0) {
-            for (int c=0;c<=k;++c) {
-                i=G.supports_attributes()?G.add_node(++lab):G.add_node();
-                if (color_temp_vertices) {
-                    if (G.supports_attributes())
-                        G.set_node_attribute(i,_GT_ATTRIB_COLOR,hcol);
-                    else G.set_node_color(i,hcol);
+graphe::bbmc::~bbmc() {
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_destroy(&m_mutex);
+#endif
+}
+
+/* create the adjacency matrix of the (complement) graph with vertices in degeneracy
+ * ordering, such that the vertex removed last gets index 0, and set the upper bound
+ * for the clique size to degeneracy+1 */
+void graphe::bbmc::make_adjacency() {
+    int words=m_words,i,j,u,w,d,pu,pw,maxdeg=0;
+    ulong b;
+    std::vector<ulong> A(n*words,0);
+    for (i=0;i<n;++i) {
+        ulong *r=&A[i*words];
+        const ivector &ngh=G->node(i).neighbors();
+        for (ivector_iter it=ngh.begin();it!=ngh.end();++it) {
+            r[*it/BK_WORD_BITS]|=ulong(1)<<(*it%BK_WORD_BITS);
+        }
+        if (m_complement) {
+            for (j=0;j<words;++j) r[j]=~r[j];
+            r[i/BK_WORD_BITS]&=~(ulong(1)<<(i%BK_WORD_BITS));
+            if (n%BK_WORD_BITS!=0)
+                r[words-1]&=(ulong(1)<<(n%BK_WORD_BITS))-1;
+        }
+    }
+    /* the algorithm of Batagelj and Zaversnik */
+    ivector deg(n),bin,vert(n),pos(n);
+    for (i=0;i<n;++i) {
+        for (d=0,j=0;j<words;++j) d+=bit_count(A[i*words+j]);
+        deg[i]=d;
+        maxdeg=std::max(maxdeg,d);
+    }
+    bin.assign(maxdeg+1,0);
+    for (i=0;i<n;++i) ++bin[deg[i]];
+    for (d=0,i=0;d<=maxdeg;++d) {
+        j=bin[d];
+        bin[d]=i;
+        i+=j;
+    }
+    for (i=0;i<n;++i) {
+        pos[i]=bin[deg[i]]++;
+        vert[pos[i]]=i;
+    }
+    for (d=maxdeg;d>0;--d) bin[d]=bin[d-1];
+    bin[0]=0;
+    m_bound=1;
+    for (i=0;i<n;++i) {
+        u=vert[i];
+        m_bound=std::max(m_bound,deg[u]+1);
+        for (int k=0;k<words;++k) {
+            for (b=A[u*words+k];b!=0;b&=b-1) {
+                w=k*BK_WORD_BITS+lowest_bit(b);
+                if (deg[w]<=deg[u])
+                    continue;
+                d=deg[w];
+                pw=pos[w];
+                pu=bin[d];
+                j=vert[pu];
+                if (j!=w) {
+                    pos[w]=pu; vert[pu]=w;
+                    pos[j]=pw; vert[pw]=j;
                 }
-                G.add_edge(e.first,i);
-                G.add_edge(e.second,i);
+                ++bin[d];
+                --deg[w];
             }
-        } else G.add_edge(e);
+        }
+    }
+    /* renumber the vertices */
+    m_order.resize(n);
+    for (i=0;i<n;++i) {
+        m_order[i]=vert[n-1-i];
+        pos[vert[n-1-i]]=i;
+    }
+    m_adj.assign(n*words,0);
+    for (i=0;i<n;++i) {
+        ulong *r=&m_adj[i*words];
+        u=m_order[i];
+        for (int k=0;k<words;++k) {
+            for (b=A[u*words+k];b!=0;b&=b-1) {
+                w=pos[k*BK_WORD_BITS+lowest_bit(b)];
+                r[w/BK_WORD_BITS]|=ulong(1)<<(w%BK_WORD_BITS);
+            }
+        }
+    }
+}
+
+/* find a large clique by extending each vertex greedily in the initial order */
+void graphe::bbmc::initial_clique() {
+    std::vector<ulong> P(m_words);
+    ivector C;
+    int i,j,w;
+    m_best=0;
+    m_clique.clear();
+    for (int v=0;v<n && m_best<m_bound;++v) {
+        C.assign(1,v);
+        std::copy(row(v),row(v)+m_words,P.begin());
+        for (i=0;i<m_words;) {
+            if (P[i]==0) {
+                ++i;
+                continue;
+            }
+            w=i*BK_WORD_BITS+lowest_bit(P[i]);
+            C.push_back(w);
+            const ulong *r=row(w);
+            for (j=i;j<m_words;++j) P[j]&=r[j];
+        }
+        if (int(C.size())>m_best) {
+            m_best=C.size();
+            m_clique=C;
+        }
     }
 }
 
-/* permute vertices according to SHARC ordering by Michael Monagan */
-void graphe::sharc_order() {
-    /* assuming that the graph is connected */
-    assert(!is_null() && node_queue.empty());
-    int n=node_count(),i,j;
-    unset_subgraphs(0);
-    node(0).set_subgraph(1); // the set S has subgraph=1
-    node(0).set_visited(true);
-    ivector order(1,0); // vertices in S
-    order.reserve(n);
-    set<int> adj;
-    bool has_path;
-    while (subgraph_size(1)<n) {
-        /* collect vertices adjacent to S */
-        adj.clear();
-        for (ivector_iter it=order.begin();it!=order.end();++it) {
-            const vertex &v=node(*it);
-            for (ivector_iter jt=v.neighbors().begin();jt!=v.neighbors().end();++jt) {
-                if (node(*jt).subgraph()==0)
-                    adj.insert(*jt);
+/* try to move v into a color class k1<kmin by moving its only neighbor w in that
+ * class into a class k2 with k1<k2<kmin which contains no neighbors of w (Re-NUMBER) */
+bool graphe::bbmc::renumber(worker_data &W,int v,int kmin) {
+    int words=m_words,k1,k2,j,c,w=-1;
+    const ulong *rv=row(v);
+    ulong b;
+    for (k1=1;k1<kmin-1;++k1) {
+        const ulong *cls=&W.classes[(k1-1)*words];
+        for (c=0,j=0;j<words && c<2;++j) {
+            if ((b=cls[j] & rv[j])!=0) {
+                c+=bit_count(b);
+                w=j*BK_WORD_BITS+lowest_bit(b);
             }
         }
-        /* add vertices from S to queue */
-        for (set<int>::const_iterator it=adj.begin();it!=adj.end();++it) {
-            node_queue.push(*it);
+        if (c!=1)
+            continue;
+        const ulong *rw=row(w);
+        for (k2=k1+1;k2<kmin;++k2) {
+            ulong *cls2=&W.classes[(k2-1)*words];
+            for (j=0;j<words;++j) {
+                if ((cls2[j] & rw[j])!=0)
+                    break;
+            }
+            if (j<words)
+                continue;
+            ulong *cls1=&W.classes[(k1-1)*words];
+            cls1[w/BK_WORD_BITS]&=~(ulong(1)<<(w%BK_WORD_BITS));
+            cls2[w/BK_WORD_BITS]|=ulong(1)<<(w%BK_WORD_BITS);
+            cls1[v/BK_WORD_BITS]|=ulong(1)<<(v%BK_WORD_BITS);
+            return true;
         }
-        unvisit_all_nodes(0);
-        unset_all_ancestors(0);
-        has_path=false;
-        while (!node_queue.empty()) {
-            i=node_queue.front();
-            node_queue.pop();
-            vertex &v=node(i);
-            if (!v.is_visited()) {
-                v.set_visited(true);
-                for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-                    vertex &w=node(j=*it);
-                    if (w.is_visited())
-                        continue;
-                    if (adj.find(j)!=adj.end()) {
-                        /* path found */
-                        w.set_ancestor(i);
-                        do {
-                            order.push_back(j);
-                            node(j).set_subgraph(1);
-                        } while ((j=node(j).ancestor())>=0);
-                        clear_node_queue();
-                        has_path=true;
-                        break;
-                    }
-                    if (w.subgraph()==0) {
-                        w.set_ancestor(i);
-                        node_queue.push(j);
-                    }
-                }
+    }
+    return false;
+}
+
+/* color the vertices in P greedily and store those with color at least kmin to U
+ * in nondecreasing order of colors, which are stored to colors */
+int graphe::bbmc::color_sort(worker_data &W,const ulong *P,int kmin,ivector &U,ivector &colors) {
+    int words=m_words,i,j,v,k=0,first=0;
+    U.clear();
+    colors.clear();
+    if (W.classes.size()<size_t(kmin*words))
+        W.classes.resize(kmin*words);
+    std::copy(P,P+words,W.Q.begin());
+    ulong *Q=&W.Q.front(),*R=&W.R.front(),bit;
+    while (true) {
+        while (first<words && Q[first]==0) ++first;
+        if (first==words)
+            break;
+        ++k;
+        std::copy(Q+first,Q+words,R+first);
+        ulong *cls=k<kmin?&W.classes[(k-1)*words]:NULL;
+        if (cls!=NULL)
+            std::fill(cls,cls+words,0);
+        for (i=first;i<words;) {
+            if (R[i]==0) {
+                ++i;
+                continue;
+            }
+            j=lowest_bit(R[i]);
+            bit=ulong(1)<<j;
+            v=i*BK_WORD_BITS+j;
+            Q[i]&=~bit;
+            R[i]&=~bit;
+            if (cls==NULL && kmin>2 && renumber(W,v,kmin))
+                continue;
+            const ulong *r=row(v);
+            for (int l=i;l<words;++l) R[l]&=~r[l];
+            if (cls!=NULL)
+                cls[i]|=bit;
+            else {
+                U.push_back(v);
+                colors.push_back(k);
             }
         }
-        if (!has_path) {
-            i=*adj.begin();
-            node(i).set_subgraph(1);
-            order.push_back(i);
+    }
+    return U.size();
+}
+
+/* store W.C as the new incumbent if it is larger than the current one */
+void graphe::bbmc::update_incumbent(worker_data &W) {
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&m_mutex);
+#endif
+    if (int(W.C.size())>m_best) {
+        m_best=W.C.size();
+        m_clique=W.C;
+        if (m_best>=m_bound)
+            m_stop=true;
+    }
+    W.best=m_best;
+    W.stop=m_stop;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+/* read the size of the incumbent and check for interruption, return false if the search should stop */
+bool graphe::bbmc::refresh(worker_data &W) {
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&m_mutex);
+#endif
+    if (interrupted || ctrl_c)
+        m_stop=true;
+    W.best=m_best;
+    W.stop=m_stop;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&m_mutex);
+#endif
+    W.steps=0;
+    return !W.stop;
+}
+
+/* the recursive part of the algorithm, P is the bitset of candidates for extending W.C,
+ * the space after it is used for deeper levels */
+void graphe::bbmc::expand(worker_data &W,ulong *P) {
+    if (++W.steps>=BBMC_REFRESH_STEPS && !refresh(W))
+        return;
+    int words=m_words,depth=W.C.size(),i,j,v,k;
+    bool empty;
+    ivector &U=W.U[depth],&colors=W.colors[depth];
+    k=color_sort(W,P,std::max(1,W.best-depth+1),U,colors);
+    ulong *Q=P+words;
+    for (i=k;i-->0 && !W.stop;) {
+        if (depth+colors[i]<=W.best)
+            break;
+        v=U[i];
+        const ulong *r=row(v);
+        empty=true;
+        for (j=0;j<words;++j) {
+            if ((Q[j]=P[j] & r[j])!=0)
+                empty=false;
+        }
+        W.C.push_back(v);
+        if (!empty)
+            expand(W,Q);
+        else if (depth+1>W.best)
+            update_incumbent(W);
+        W.C.pop_back();
+        P[v/BK_WORD_BITS]&=~(ulong(1)<<(v%BK_WORD_BITS));
+    }
+}
+
+/* return the index of the next root candidate to branch on or -1 if none is left,
+ * the candidates are taken in the reverse order because the last one has the largest color */
+int graphe::bbmc::next_root(worker_data &W) {
+    int i=-1;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&m_mutex);
+#endif
+    if (interrupted || ctrl_c)
+        m_stop=true;
+    W.best=m_best;
+    W.stop=m_stop;
+    if (!m_stop && m_next>=0) {
+        if (m_root_colors[m_next]>m_best)
+            i=m_next--;
+        else m_next=-1;
+    }
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&m_mutex);
+#endif
+    return i;
+}
+
+void *graphe::bbmc::worker(void *arg) {
+    worker_data *W=static_cast<worker_data*>(arg);
+    bbmc *S=W->solver;
+    int words=S->m_words,i,v,w,k;
+    ulong b;
+    while ((i=S->next_root(*W))>=0) {
+        /* the candidates are the neighbors of v which precede v in the root ordering */
+        v=S->m_root[i];
+        ulong *P=&W->stack.front();
+        const ulong *r=S->row(v);
+        bool empty=true;
+        for (k=0;k<words;++k) {
+            P[k]=r[k];
+            for (b=r[k];b!=0;b&=b-1) {
+                w=k*BK_WORD_BITS+lowest_bit(b);
+                if (S->m_root_position[w]>=i)
+                    P[k]&=~(ulong(1)<<(w%BK_WORD_BITS));
+            }
+            if (P[k]!=0)
+                empty=false;
+        }
+        W->C.assign(1,v);
+        if (!empty)
+            S->expand(*W,P);
+        else if (W->best<1)
+            S->update_incumbent(*W);
+    }
+    return NULL;
+}
+
+/* find maximum clique (in the complement graph, if specified in the constructor)
+ * and return its size, the root branches are processed in parallel if parallel=true */
+int graphe::bbmc::maxclique(ivector &clique,bool parallel) {
+    clique.clear();
+    if (n==0)
+        return 0;
+    make_adjacency();
+    initial_clique();
+    m_stop=m_best>=m_bound;
+    if (!m_stop) {
+        int nt=parallel?std::min(max_threads(),std::max(1,n/BBMC_PARALLEL_MIN_VERTICES)):1,j;
+        vector<worker_data> W(nt);
+        vector<void*> args(nt);
+        for (j=0;j<nt;++j) {
+            worker_data &w=W[j];
+            w.solver=this;
+            w.best=m_best;
+            w.steps=0;
+            w.stop=false;
+            w.U.resize(m_bound+2);
+            w.colors.resize(m_bound+2);
+            w.stack.resize((m_bound+2)*m_words);
+            w.Q.resize(m_words);
+            w.R.resize(m_words);
+            args[j]=(void*)&w;
+        }
+        /* color the whole graph to obtain the root candidates */
+        std::vector<ulong> P(m_words,~ulong(0));
+        if (n%BK_WORD_BITS!=0)
+            P.back()=(ulong(1)<<(n%BK_WORD_BITS))-1;
+        color_sort(W.front(),&P.front(),m_best+1,m_root,m_root_colors);
+        m_root_position.assign(n,-1);
+        for (ivector_iter it=m_root.begin();it!=m_root.end();++it) {
+            m_root_position[*it]=it-m_root.begin();
+        }
+        m_next=int(m_root.size())-1;
+        run_threads(worker,args);
+        if (interrupted || ctrl_c)
+            throw std::runtime_error("Stopped by user interruption");
+    }
+    clique.reserve(m_best);
+    for (ivector_iter it=m_clique.begin();it!=m_clique.end();++it) {
+        clique.push_back(m_order[*it]);
+    }
+    std::sort(clique.begin(),clique.end());
+    return m_best;
+}
+
+/*
+ * END OF BBMC CLASS IMPLEMENTATION
+ */
+
+/*
+ * CIRC_ENUM CLASS IMPLEMENTATION
+ *
+ * Implementation of Tarjan's algorithm published in SIAM J. Comp. 2(3), 1973
+ */
+
+graphe::circ_enum::circ_enum(graphe *gr,int lo,int hi) {
+    G=gr;
+    lb=lo; ub=hi;
+    int n=G->node_count();
+    A.resize(n);
+    for (int i=0;i<n;++i) {
+        const vertex &v=G->node(i);
+        for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
+            A[i].push_back(*it);
+        }
+    }
+}
+
+void graphe::circ_enum::backtrack(int v,bool &f) {
+    bool g;
+    f=false;
+    point_stack.push_back(v);
+    mark[v]=true;
+    marked_stack.push(v);
+    int w,u,len;
+    for (int i=A[v].size();i-->0;) {
+        w=A[v][i];
+        if (w<s) A[v].erase(A[v].begin()+i);
+        else if (w==s) {
+            len=point_stack.size();
+            if ((lb<0 || len>=lb) && (ub<0 || len<=ub))
+                res.push_back(point_stack);
+            f=true;
+        } else if (!mark[w]) {
+            backtrack(w,g);
+            f=f||g;
+        }
+    }
+    /* f is true if an elementary circuit containing
+     * the partial path has been found */
+    if (f) {
+        while (marked_stack.top()!=v) {
+            u=marked_stack.top();
+            marked_stack.pop();
+            mark[u]=false;
         }
+        marked_stack.pop();
+        mark[v]=false;
     }
-    graphe G(*this);
-    G.isomorphic_copy(*this,order);
+    point_stack.pop_back();
 }
 
-map<graphe::ivector,vector<graphe::cpol> > graphe::cache;
-
-/* implementation of cpol class */
-
-void graphe::cpol::assign(const cpol &other) {
-    nv=other.nv;
-#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
-    cg=other.cg;
-    col=other.col;
-#else
-    adj=other.adj;
-#endif
-    sz=other.sz;
-    frq=other.frq;
-    poly=other.poly;
+/* return the list of all elementary cycles in the given digraph */
+graphe::ivectors graphe::circ_enum::find_cycles() {
+    int n=G->node_count(),u;
+    bool flag;
+    mark.resize(n,false);
+    for (s=0;s<n;++s) {
+        backtrack(s,flag);
+        while (!marked_stack.empty()) {
+            u=marked_stack.top();
+            mark[u]=false;
+            marked_stack.pop();
+        }
+    }
+    return res;
 }
 
-graphe::cpol::cpol(const cpol &other) {
-    assign(other);
-}
+/*
+ * END OF CIRC_ENUM CLASS IMPLEMENTATION
+ */
 
-#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
-graphe::cpol::cpol(int n,ulong *g,int *c,size_t s,const intpoly &p) {
-    nv=n;
-    cg=g;
-    col=c;
-    sz=s;
-    frq=0;
-    poly=p;
-}
-#else
-graphe::cpol::cpol(int n,int *a,size_t s,const intpoly &p) {
-    nv=n;
-    adj=a;
-    sz=s;
-    frq=0;
-    poly=p;
+void graphe::elementary_cycles(ivectors &cyc,int lo,int hi) {
+    assert(is_directed());
+    circ_enum ce(this,lo,hi);
+    cyc=ce.find_cycles();
 }
-#endif
 
-graphe::cpol &graphe::cpol::operator =(const cpol &other) {
-    assign(other);
-    return *this;
-}
+/*
+ * YEN CLASS IMPLEMENTATION
+ */
 
-#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
-bool graphe::cpol::match(int n,ulong *g,int *c) const {
-    if (nv!=n)
-        return false;
-    for (int i=0;i<n;++i) {
-        if (c[i]!=col[i])
-            return false;
-    }
-    size_t cnt=0;
-    for (;cnt<sz;++cnt) {
-        if (g[cnt]!=cg[cnt])
-            return false;
+void graphe::yen::delete_children(tree_node *r) {
+    for (vector<tree_node*>::const_iterator it=r->children.begin();it!=r->children.end();++it) {
+        delete_children(*it);
+        delete *it;
     }
-    return true;
 }
-#else
-bool graphe::cpol::match(int n,int *a,int adj_sz) const {
-    if (nv!=n || sz!=adj_sz)
-        return false;
-    for (int i=0;i<sz;++i) {
-        if (adj[i]!=a[i])
-            return false;
+
+graphe::yen::tree_node *graphe::yen::add_tree_node(tree_node *p) {
+    if (p==NULL) {
+        root=new tree_node;
+        root->parent=NULL;
+        root->i=src;
+        return root;
     }
-    return true;
+    tree_node *t;
+    p->children.push_back(t=new tree_node);
+    t->parent=p;
+    return t;
 }
-#endif
 
-/* end of cpol class implementation */
-
-/* add the polynomial b to a (a is changed in place) */
-void graphe::poly_add(intpoly &a,const intpoly &b) {
-    for (intpoly_iter it=b.begin();it!=b.end();++it) {
-        a[it->first]+=it->second;
+graphe::yen::~yen() {
+    if (root!=NULL) {
+        delete_children(root);
+        delete root;
     }
 }
 
-/* multiply the polynomial a with b (a is changed in place) */
-void graphe::poly_mult(intpoly &a,const intpoly &b) {
-    intpoly c(a);
-    a.clear();
-    for (intpoly_iter it=b.begin();it!=b.end();++it) {
-        const ipair &p=it->first;
-        for (intpoly_iter jt=c.begin();jt!=c.end();++jt) {
-            const ipair &q=jt->first;
-            a[make_pair(p.first+q.first,p.second+q.second)]+=it->second*jt->second;
+graphe::yen::tree_node *graphe::yen::store_path(const ivector &path,tree_node *r) {
+    tree_node *t=r,*next;
+    int i,n=path.size();
+    for (i=1;i<n;++i) {
+        next=NULL;
+        for (vector<tree_node*>::const_iterator it=t->children.begin();it!=t->children.end();++it) {
+            if ((*it)->i==path[i]) {
+                next=*it;
+                break;
+            }
+        }
+        if (next!=NULL) {
+            t=next;
+            continue;
         }
+        t=add_tree_node(t);
+        t->i=path[i];
+        t->selected=false;
     }
+    return t;
 }
 
-/* return the geometric sequence in variable var (1 or 2) of length k */
-graphe::intpoly graphe::poly_geom(int var,int k,bool leading_one,bool add_other_var) {
-    assert((var==1 || var==2) && k>0);
-    intpoly res;
-    for (int i=leading_one?0:1;i<k;++i) {
-        res[make_pair(var==1?i:0,var==2?i:0)]=1;
+void graphe::yen::select_path(tree_node *p) {
+    kspaths.push_back(p);
+    tree_node *t=p;
+    while (t!=NULL) {
+        if (t->selected) break;
+        t->selected=true;
+        t=t->parent;
     }
-    if (add_other_var)
-        res[make_pair(var==2?1:0,var==1?1:0)]=1;
-    return res;
-}
-
-/* return 1 as polynom */
-graphe::intpoly graphe::poly_one() {
-    intpoly res;
-    res[make_pair(0,0)]=1;
-    return res;
 }
 
-/* convert list of integers to a 2-variable polynomial with integral coefficients */
-gen graphe::intpoly2gen(const intpoly &v,const gen &x,const gen &y) {
-    int pwx,pwy,cf;
-    gen p(0);
-    for (intpoly_iter it=v.begin();it!=v.end();++it) {
-        pwx=it->first.first;
-        pwy=it->first.second;
-        cf=it->second;
-        p+=gen(cf)*(pwx==0?gen(1):pow(x,pwx))*(pwy==0?gen(1):pow(y,pwy));
+void graphe::yen::restore_path(tree_node *p,ivector &path) {
+    tree_node *t=p;
+    path.clear();
+    while (t!=NULL) {
+        path.push_back(t->i);
+        t=t->parent;
     }
-    return p;
+    std::reverse(path.begin(),path.end());
 }
 
-static int tutte_iter_count;
-static int tutte_hits;
-static clock_t tutte_time_start;
-static double tutte_matching_time;
-
-/* compute the Tutte polynomial for this graph, using vorder-push heuristic */
-graphe::intpoly graphe::tutte_poly_recurse(int vc) {
-    ++tutte_iter_count;
-    intpoly p=poly_one(),fac;
-    int n=node_count(),adj_sz,snv;
-    bool isom;
-    ipair e;
-    vector<ipairs> blocks;
-    ipairs E;
-    graphe G(ctx,false),Gd(ctx,false),Gc(ctx,false);
-    matrice L;
-    ivector L_cp;
-    map<ivector,vector<cpol> >::iterator ct;
-    int *adj,*col;
-    ulong *cg;
-    size_t cg_sz;
-    switch (vc) {
-    case 2:
-        assert(n>2);
-        /* process cycles with multiedges */
-        if (is_cycle(E)) {
-            p=poly_geom(2,multiedges(E[n-1])+multiedges(E[n-2])+2,false,true);
-            for (int i=1;i<=n-2;++i) {
-                poly_mult(p,poly_geom(2,1+multiedges(E[i-1]),true));
-            }
-            for (int i=1;i<=n-2;++i) {
-                intpoly q=poly_one();
-                q[make_pair(0,0)]=1;
-                for (int j=i+1;j<=n;++j) {
-                    poly_mult(q,poly_geom(2,1+multiedges(E[j-1]),false,true));
-                }
-                for (int j=1;j<=i-1;++j) {
-                    poly_mult(q,poly_geom(2,1+multiedges(E[j-1]),true));
+void graphe::yen::find_kspaths(ivectors &paths) {
+    assert(G->supports_attributes());
+    ivectors cp;
+    vecteur pw;
+    matrice W;
+    if (!G->is_weighted()) {
+        G->adjacency_matrix(W);
+        G->make_weighted(W);
+    }
+    G->weight_matrix(W);
+    paths.clear();
+    G->dijkstra(src,ivector(1,dest),pw,&cp);
+    if (cp.front().empty()) return;
+    kspaths.clear();
+    tree_node *p=store_path(cp.front(),add_tree_node(NULL)),*t,*next;
+    select_path(p);
+    stack<ipair> removed_edges;
+    gen wg;
+    int i,j,spur_node,tail,head;
+    set<pair<gen,tree_node*>,kspaths_comparator> candidates;
+    set<pair<gen,tree_node*>,kspaths_comparator>::const_iterator cit;
+    ivector path;
+    path.reserve(G->node_count());
+    G->save_subgraphs();
+    G->unset_subgraphs(1);
+    for (int k=1;k<K;++k) {
+        restore_path(p,path);
+        t=root;
+        for (i=0;i+1<(int)path.size();++i) {
+            spur_node=path[i];
+            for (vector<tree_node*>::const_iterator it=t->children.begin();it!=t->children.end();++it) {
+                if ((*it)->selected) {
+                    head=(*it)->i; tail=(*it)->parent->i;
+                    G->set_edge_attribute(tail,head,_GT_ATTRIB_WEIGHT,plusinf());
+                    removed_edges.push(make_pair(tail,head));
+                    if (head==path[i+1]) next=*it;
                 }
-                poly_add(p,q);
             }
-            break;
-        }
-        /* check for cached isomorphic graph, record the time */
-        isom=false;
-        tutte_time_start=clock();
-        simplify(G,true);
-        G.laplacian_matrix(L);
-        L_cp=vecteur_2_vector_int(*_eval(symbolic(at_charpoly,L),ctx)._VECTptr); // charpoly of the Laplacian
-        adj=G.to_array(adj_sz,false,true);
-        snv=G.node_count();
-#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
-        cg_sz=nautywrapper_words_needed(snv)*(size_t)snv;
-        cg=new ulong[cg_sz];
-        col=new int[snv];
-        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE,NULL);
-        nautywrapper_canonical(0,snv,adj,NULL,cg,col);
-        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE,NULL);
-        delete[] adj;
-#endif
-        if ((ct=cache.find(L_cp))!=cache.end()) {
-            for (vector<cpol>::iterator it=ct->second.begin();it!=ct->second.end();++it) {
-                cpol &cp=*it;
-#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
-                if (cp.match(snv,cg,col)) {
-                    ++cp.frq;
-                    ++tutte_hits;
-                    delete[] cg;
-                    delete[] col;
-                    p=cp.poly;
-                    isom=true;
-                    break;
-                }
-#else
-                if (cp.match(snv,adj,adj_sz)) {
-                    ++cp.frq;
-                    ++tutte_hits;
-                    delete[] adj;
-                    p=cp.poly;
-                    isom=true;
-                    break;
-                }
-#endif
+            G->dijkstra(spur_node,ivector(1,dest),pw,&cp,1);
+            if (!cp.front().empty()) {
+                wg=pw.front();
+                for (j=0;j<i;++j) wg+=W[path[j]][path[j+1]];
+                candidates.insert(make_pair(wg,store_path(cp.front(),t)));
             }
+            G->node(spur_node).set_subgraph(0);
+            t=next;
+        }
+        for (ivector_iter it=path.begin();it+1!=path.end();++it) {
+            G->node(*it).set_subgraph(1);
         }
-        tutte_matching_time+=double(clock()-tutte_time_start)/CLOCKS_PER_SEC;
-        if (isom) break;
-        /* no luck, perform the delete-contract step */
-        get_edges_as_pairs(E);
-        e=E.front();
-        for (ipairs_iter it=E.begin()+1;it!=E.end();++it) {
-            if (*it<e) e=*it;
+        while (!removed_edges.empty()) {
+            i=removed_edges.top().first; j=removed_edges.top().second;
+            G->set_edge_attribute(i,j,_GT_ATTRIB_WEIGHT,W[i][j]);
+            removed_edges.pop();
         }
-        fac=poly_geom(2,1+multiedges(e),true);
-        set_multiedge(e,0);
-        copy(Gd); copy(Gc); // copies to perform deletion-contraction on
-        Gd.remove_edge(e);
-        Gc.contract_edge(e.second,e.first,false);
-        p=Gd.tutte_poly_recurse(1);
-        poly_mult(fac,Gc.tutte_poly_recurse(1));
-        poly_add(p,fac);
-        /* cache the graph and its polynomial for future use */
-#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
-        cache[L_cp].push_back(cpol(snv,cg,col,cg_sz,p));
-#else
-        cache[L_cp].push_back(cpol(snv,adj,adj_sz,p));
-#endif
-        break;
-    case 1:
-        find_blocks(blocks);
-        for (vector<ipairs>::iterator it=blocks.begin();it!=blocks.end();++it) {
-            ipairs &block=*it;
-            assert(!block.empty());
-            if (block.size()==1) { // bridge
-                poly_mult(p,poly_geom(2,1+multiedges(block.front()),false,true));
-            } else { // non-trivial biconnected subgraph
-                std::sort(block.begin(),block.end());
-                extract_subgraph(block,G);
-                poly_mult(p,G.tutte_poly_recurse(2));
+        if (candidates.empty()) break;
+        cit=candidates.begin();
+        p=cit->second;
+        select_path(p);
+        candidates.erase(cit);
+    }
+    G->restore_subgraphs();
+    for (vector<tree_node*>::const_iterator it=kspaths.begin();it!=kspaths.end();++it) {
+        restore_path(*it,path);
+        paths.push_back(path);
+    }
+}
+
+/*
+ * END OF YEN CLASS
+ */
+
+/*
+ * K SHORTEST PATHS:
+ * Yen's algorithm for graphs with nonnegative floating-point weights. The
+ * distances to the destination are computed once by Dijkstra's algorithm on
+ * the reversed graph. They give the first path, and they serve as a consistent
+ * heuristic for the A* searches of spur paths, which therefore usually follow
+ * the reverse shortest path tree as soon as they leave the blocked region. The
+ * spur searches of one iteration are independent and run in parallel. The
+ * candidates are kept in a binary heap, and only as many of them as may
+ * still be selected. Their largest cost bounds the spur searches.
+ */
+
+graphe::ksp_finder::ksp_finder(const csr_adjacency &adj,int s,int d,int k) {
+    A=&adj;
+    n=A->node_count();
+    src=s;
+    dest=d;
+    K=k;
+    m_threads=max_threads();
+    m_bound=DBL_MAX;
+    m_path=NULL;
+}
+
+/* return the weight of the arc (i,j) */
+double graphe::ksp_finder::arc_weight(int i,int j) const {
+    int k=A->arc_index(i,j);
+    assert(k>=0);
+    return A->weight(k);
+}
+
+/* compute the distances to the destination and the shortest paths to it
+ * by Dijkstra's algorithm on the reversed graph */
+void graphe::ksp_finder::reverse_tree() {
+    int i,j,k,u;
+    ivector offsets(n+1,0),tails(A->arc_count());
+    dvector weights(A->arc_count());
+    for (i=0;i<n;++i) {
+        for (k=A->arc_begin(i);k<A->arc_end(i);++k) {
+            ++offsets[A->head(k)+1];
+        }
+    }
+    for (i=0;i<n;++i) {
+        offsets[i+1]+=offsets[i];
+    }
+    ivector fill(offsets.begin(),offsets.end()-1);
+    for (i=0;i<n;++i) {
+        for (k=A->arc_begin(i);k<A->arc_end(i);++k) {
+            j=fill[A->head(k)]++;
+            tails[j]=i;
+            weights[j]=A->weight(k);
+        }
+    }
+    m_h.assign(n,DBL_MAX);
+    m_next.assign(n,-1);
+    bvector settled(n,false);
+    dary_heap Q(n);
+    double alt;
+    m_h[dest]=0;
+    Q.push(dest,0);
+    while (!Q.empty()) {
+        settled[u=Q.pop()]=true;
+        for (k=offsets[u];k<offsets[u+1];++k) {
+            i=tails[k];
+            if (settled[i] || weights[k]==DBL_MAX)
+                continue;
+            if ((alt=m_h[u]+weights[k])<m_h[i]) {
+                m_h[i]=alt;
+                m_next[i]=u;
+                Q.push(i,alt);
             }
         }
-        break;
-    default:
-        assert(false);
     }
-    return p;
 }
 
-/* return the Tutte polynomial of this graph */
-gen graphe::tutte_polynomial(const gen &x,const gen &y) {
-    assert(cache.empty() && !is_directed());
-    tutte_iter_count=tutte_hits=0;
-    tutte_matching_time=0;
-    intpoly p;
-    graphe G(ctx,false);
-    ivector sigma;
-    p=poly_one();
-    connected_components_to_subgraphs();
-    int sc=max_subgraph_index(),i;
-    for (i=1;i<=sc;++i) {
-        if (subgraph_size(i)<2)
-            continue;
-        sort_by_degrees(G,sigma,i);
-        G.sharc_order();
-        poly_mult(p,G.tutte_poly_recurse(1));
+/* insert the path into the prefix tree of the selected paths */
+void graphe::ksp_finder::add_to_trie(const ivector &path) {
+    if (m_trie_vertex.empty()) {
+        m_trie_vertex.push_back(path.front());
+        m_trie_children.push_back(ivector(0));
     }
-    /* clear the cache and return the Tutte polynomial p */
-    for (map<ivector,vector<cpol> >::iterator it=cache.begin();it!=cache.end();++it) {
-        for (vector<cpol>::const_iterator jt=it->second.begin();jt!=it->second.end();++jt) {
-#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
-            delete[] jt->cg;
-            delete[] jt->col;
-#else
-            delete[] jt->adj;
-#endif
+    int t=0,c;
+    for (ivector_iter it=path.begin()+1;it!=path.end();++it) {
+        const ivector &ch=m_trie_children[t];
+        for (c=0;c<int(ch.size()) && m_trie_vertex[ch[c]]!=*it;++c);
+        if (c<int(ch.size())) {
+            t=ch[c];
+            continue;
         }
-        it->second.clear();
+        m_trie_children[t].push_back(m_trie_vertex.size());
+        t=m_trie_vertex.size();
+        m_trie_vertex.push_back(*it);
+        m_trie_children.push_back(ivector(0));
     }
-    cache.clear();
-    return intpoly2gen(p,x,y);
 }
 
-/* find all fundamental cycles in this graph */
-void graphe::fundamental_cycles(ivectors &cycles,int sg,gt_conn_check cc) {
-    assert(!is_directed());
-    ivectors components;
-    int cmp,s;
-    switch (cc) {
-    case _GT_CC_CONNECTED:
-        break;
-    case _GT_CC_COMPONENTS_ARE_SUBGRAPHS:
-        cmp=max_subgraph_index();
-        for (s=1;s<=cmp;++s) {
-            fundamental_cycles(cycles,s,_GT_CC_CONNECTED);
-        }
+/* find the cheapest path from the i-th vertex of the last selected path to the
+ * destination, avoiding the vertices before it and the blocked arcs leaving it */
+void graphe::ksp_finder::spur_search(worker_data &W,int i) {
+    const ivector &P=*m_path;
+    int s=P[i],u,v,k;
+    double root=m_root_cost[i],alt,w;
+    const ivector &blocked=m_blocked[i];
+    ++W.stamp;
+    for (k=0;k<i;++k) {
+        W.mark[P[k]]=W.stamp;
+    }
+    m_spur_cost[i]=DBL_MAX;
+    if (root+m_h[s]>m_bound)
         return;
-    case _GT_CC_FIND_COMPONENTS:
-        s=sg<0?1:1+max_subgraph_index();
-        cmp=connected_components_to_subgraphs(sg);
-        for (;s<=cmp;++s) {
-            fundamental_cycles(cycles,s,_GT_CC_CONNECTED);
-            renumber_subgraph(s,sg);
+    W.g[s]=0;
+    W.parent[s]=-1;
+    W.touched.push_back(s);
+    W.Q.push(s,m_h[s]);
+    while (!W.Q.empty()) {
+        if ((u=W.Q.pop())==dest)
+            break;
+        for (k=A->arc_begin(u);k<A->arc_end(u);++k) {
+            v=A->head(k);
+            if (W.mark[v]==W.stamp || (w=A->weight(k))==DBL_MAX || m_h[v]==DBL_MAX)
+                continue;
+            if (u==s && std::find(blocked.begin(),blocked.end(),v)!=blocked.end())
+                continue;
+            if ((alt=W.g[u]+w)<W.g[v] && root+alt+m_h[v]<=m_bound) {
+                if (W.g[v]==DBL_MAX)
+                    W.touched.push_back(v);
+                W.g[v]=alt;
+                W.parent[v]=u;
+                W.Q.push(v,alt+m_h[v]);
+            }
+        }
+    }
+    if (W.g[dest]<DBL_MAX) {
+        ivector &spur=m_spur[i];
+        spur.clear();
+        for (v=dest;v>=0;v=W.parent[v]) {
+            spur.push_back(v);
         }
+        std::reverse(spur.begin(),spur.end());
+        m_spur_cost[i]=root+W.g[dest];
+    }
+    W.Q.clear();
+    for (ivector_iter it=W.touched.begin();it!=W.touched.end();++it) {
+        W.g[*it]=DBL_MAX;
+    }
+    W.touched.clear();
+}
+
+/* thread routine: process the spur vertices assigned to the thread */
+void *graphe::ksp_finder::worker(void *arg) {
+    worker_data *W=static_cast<worker_data*>(arg);
+    ksp_finder *F=W->F;
+    for (int i=W->index;i+1<int(F->m_path->size());i+=F->m_threads) {
+        if (interrupted || ctrl_c)
+            break;
+        F->spur_search(*W,i);
+    }
+    return NULL;
+}
+
+/* keep only the candidates which may be among the needed paths, with ties */
+void graphe::ksp_finder::prune_candidates(int needed) {
+    int sz=m_heap.size();
+    if (sz<needed)
         return;
-    default: assert(false);
+    dvector costs(sz);
+    for (int j=0;j<sz;++j) {
+        costs[j]=m_heap[j].first;
     }
-    ipairs E,nte;
-    get_edges_as_pairs(E,sg);
-    int root=sg<0?0:first_vertex_from_subgraph(sg),i,j;
-    dfs(root,true,true,NULL,sg);
-    for (ipairs_iter it=E.begin();it!=E.end();++it) {
-        i=it->first; j=it->second;
-        if (node(i).ancestor()!=j && node(j).ancestor()!=i)
-            nte.push_back(*it);
+    std::nth_element(costs.begin(),costs.begin()+needed-1,costs.end());
+    m_bound=costs[needed-1];
+    if (sz==needed)
+        return;
+    std::vector<std::pair<double,int> > kept;
+    kept.reserve(sz);
+    for (std::vector<std::pair<double,int> >::const_iterator it=m_heap.begin();it!=m_heap.end();++it) {
+        if (it->first<=m_bound)
+            kept.push_back(*it);
+        else ivector().swap(m_candidates[it->second]);
     }
-    for (ipairs_iter it=nte.begin();it!=nte.end();++it) {
-        const vertex &v=node(it->first),&w=node(it->second);
-        i=v.disc()>w.disc()?it->first:it->second;
-        j=v.disc()<w.disc()?it->first:it->second;
-        ivector c;
-        while (i!=j) {
-            c.push_back(i);
-            i=node(i).ancestor();
-            assert(i>=0);
+    m_heap.swap(kept);
+    std::make_heap(m_heap.begin(),m_heap.end(),std::greater<std::pair<double,int> >());
+}
+
+/* find up to K shortest loopless paths from src to dest in order of increasing cost */
+void graphe::ksp_finder::find_kspaths(ivectors &paths) {
+    paths.clear();
+    reverse_tree();
+    if (m_h[src]==DBL_MAX)
+        return;
+    ivector path;
+    for (int v=src;v>=0;v=m_next[v]) {
+        path.push_back(v);
+    }
+    m_selected.push_back(path);
+    m_seen.insert(path);
+    add_to_trie(path);
+    int i,j,len,t,c,index=0;
+    std::vector<worker_data> W(m_threads,worker_data(n));
+    std::vector<void*> args(m_threads);
+    for (j=0;j<m_threads;++j) {
+        W[j].F=this;
+        W[j].index=j;
+        args[j]=&W[j];
+    }
+    while (int(m_selected.size())<K) {
+        const ivector &P=m_selected.back();
+        m_path=&P;
+        len=P.size();
+        m_root_cost.resize(len);
+        m_blocked.resize(len);
+        m_spur.resize(len);
+        m_spur_cost.resize(len);
+        /* the arcs leaving the spur vertex along the selected paths with the same root are blocked */
+        m_root_cost[0]=0;
+        for (i=0,t=0;i+1<len;++i) {
+            if (i>0)
+                m_root_cost[i]=m_root_cost[i-1]+arc_weight(P[i-1],P[i]);
+            m_blocked[i].clear();
+            const ivector &ch=m_trie_children[t];
+            for (c=0;c<int(ch.size());++c) {
+                m_blocked[i].push_back(m_trie_vertex[ch[c]]);
+                if (m_trie_vertex[ch[c]]==P[i+1])
+                    index=ch[c];
+            }
+            t=index;
+        }
+        run_threads(worker,args);
+        if (interrupted || ctrl_c)
+            throw std::runtime_error("Stopped by user interruption");
+        for (i=0;i+1<len;++i) {
+            if (m_spur_cost[i]==DBL_MAX)
+                continue;
+            path.assign(P.begin(),P.begin()+i);
+            path.insert(path.end(),m_spur[i].begin(),m_spur[i].end());
+            if (!m_seen.insert(path).second)
+                continue;
+            m_heap.push_back(std::make_pair(m_spur_cost[i],int(m_candidates.size())));
+            std::push_heap(m_heap.begin(),m_heap.end(),std::greater<std::pair<double,int> >());
+            m_candidates.push_back(path);
         }
-        c.push_back(j);
-        cycles.push_back(c);
+        if (m_heap.empty())
+            break;
+        prune_candidates(K-m_selected.size());
+        std::pop_heap(m_heap.begin(),m_heap.end(),std::greater<std::pair<double,int> >());
+        index=m_heap.back().second;
+        m_heap.pop_back();
+        m_selected.push_back(ivector(0));
+        m_selected.back().swap(m_candidates[index]);
+        add_to_trie(m_selected.back());
     }
+    paths=m_selected;
 }
 
-/* construct Mycielski graph with 2n+1 vertices and 3m+n edges */
-void graphe::mycielskian(graphe &G) const {
-    assert(!is_directed());
-    ipairs E;
-    get_edges_as_pairs(E);
-    int lab=largest_integer_label(),n=node_count(),m=E.size();
-    copy(G);
-    ivector u(n);
-    for (int i=0;i<n;++i) {
-        u[i]=G.add_node(++lab);
+/*
+ * END OF K SHORTEST PATHS
+ */
+
+/* find K shortest paths from src to dest, in floating-point arithmetic if the
+ * weights are nonnegative numbers */
+void graphe::yen_ksp(int K,int src,int dest,ivectors &paths) {
+    const csr_adjacency &A=adjacency_snapshot(true);
+    bool numeric=A.has_numeric_weights();
+    for (int k=0;numeric && k<A.arc_count();++k) {
+        numeric=A.weight(k)>=0;
+    }
+    if (numeric) {
+        ksp_finder F(A,src,dest,K);
+        F.find_kspaths(paths);
+        return;
     }
-    int w=G.add_node(++lab);
-    for (ipairs_iter it=E.begin();it!=E.end();++it) {
-        G.add_edge(it->first,u[it->second]);
-        G.add_edge(it->second,u[it->first]);
+    yen Y(this,src,dest,K);
+    Y.find_kspaths(paths);
+}
+
+/*
+ * COMMUNITY DETECTION:
+ * the modularity is maximized by the Louvain method (Blondel et al., 2008).
+ * Each level starts with singleton communities, and the vertices are moved to
+ * the neighboring community with the largest modularity gain until no sweep
+ * improves the modularity by more than LOUVAIN_TOLERANCE. To move vertices in
+ * parallel, they are split into classes by a greedy coloring. The best moves
+ * for a class are found by the threads and then applied (Lu et al., 2015).
+ * As in the Leiden method, disconnected communities are split into their
+ * components before the communities are aggregated into the vertices of the
+ * next level, so the resulting communities are always connected.
+ */
+
+/* construct the first level from the adjacency A, using the arc weights if weighted=true */
+graphe::louvain::louvain(const csr_adjacency &A,bool weighted,double gamma) {
+    int n=A.node_count(),i,k;
+    double w;
+    m_gamma=gamma;
+    m_total=0;
+    level_graph &G=m_graph;
+    G.n=n;
+    G.offsets.resize(n+1);
+    G.targets.clear();
+    G.weights.clear();
+    G.targets.reserve(A.arc_count());
+    G.weights.reserve(A.arc_count());
+    G.loops.assign(n,0);
+    G.degrees.assign(n,0);
+    for (i=0;i<n;++i) {
+        G.offsets[i]=G.targets.size();
+        for (k=A.arc_begin(i);k<A.arc_end(i);++k) {
+            if (A.head(k)==i)
+                continue;
+            w=weighted?A.weight(k):1.0;
+            G.targets.push_back(A.head(k));
+            G.weights.push_back(w);
+            G.degrees[i]+=w;
+        }
+        m_total+=G.degrees[i];
+    }
+    G.offsets[n]=G.targets.size();
+}
+
+/* split the vertices of the current level into classes of nonadjacent vertices */
+void graphe::louvain::color_classes(ivectors &classes) const {
+    const level_graph &G=m_graph;
+    ivector color(G.n,-1),used;
+    int i,k,c;
+    classes.clear();
+    for (i=0;i<G.n;++i) {
+        for (k=G.offsets[i];k<G.offsets[i+1];++k) {
+            if ((c=color[G.targets[k]])>=0) {
+                if (c>=int(used.size()))
+                    used.resize(c+1,-1);
+                used[c]=i;
+            }
+        }
+        for (c=0;c<int(used.size()) && used[c]==i;++c);
+        color[i]=c;
+        if (c>=int(classes.size()))
+            classes.resize(c+1);
+        classes[c].push_back(i);
+    }
+}
+
+/* find the best community for each vertex of the current class in the assigned range */
+void graphe::louvain::best_moves(worker_data &W) {
+    const level_graph &G=m_graph;
+    int i,k,c,ci,best;
+    double ki,gain,best_gain;
+    for (int j=W.begin;j<W.end;++j) {
+        i=m_class->at(j);
+        ci=m_community[i];
+        ki=G.degrees[i];
+        for (k=G.offsets[i];k<G.offsets[i+1];++k) {
+            c=m_community[G.targets[k]];
+            if (W.acc[c]==0)
+                W.touched.push_back(c);
+            W.acc[c]+=G.weights[k];
+        }
+        best=ci;
+        best_gain=W.acc[ci]-m_gamma*(m_tot[ci]-ki)*ki/m_total;
+        for (ivector_iter it=W.touched.begin();it!=W.touched.end();++it) {
+            if ((c=*it)==ci)
+                continue;
+            gain=W.acc[c]-m_gamma*m_tot[c]*ki/m_total;
+            if (gain>best_gain || (gain==best_gain && c<best && best!=ci)) {
+                best=c;
+                best_gain=gain;
+            }
+        }
+        for (ivector_iter it=W.touched.begin();it!=W.touched.end();++it) {
+            W.acc[*it]=0;
+        }
+        W.touched.clear();
+        m_target[j]=best;
     }
-    for (int i=0;i<n;++i) {
-        G.add_edge(w,u[i]);
+}
+
+void *graphe::louvain::worker(void *arg) {
+    worker_data *W=static_cast<worker_data*>(arg);
+    W->L->best_moves(*W);
+    return NULL;
+}
+
+/* return the modularity of the current partition of the current level */
+double graphe::louvain::level_modularity() const {
+    const level_graph &G=m_graph;
+    double in=0,sq=0;
+    for (int i=0;i<G.n;++i) {
+        in+=G.loops[i];
+        for (int k=G.offsets[i];k<G.offsets[i+1];++k) {
+            if (m_community[G.targets[k]]==m_community[i])
+                in+=G.weights[k];
+        }
+        sq+=m_tot[i]*m_tot[i];
     }
-    assert(G.node_count()==2*n+1 && G.edge_count()==3*m+n);
+    return in/m_total-m_gamma*sq/(m_total*m_total);
 }
 
-/* return the local clustering coefficient of the i-th vertex */
-gen graphe::local_clustering_coeff(int i) const {
-    assert(!is_directed());
-    const vertex &v=node(i);
-    const ivector &vn=v.neighbors();
-    int d=vn.size(),cnt=0;
-    for (ivector_iter it=vn.begin();it!=vn.end();++it) {
-        const ivector &wn=node(*it).neighbors();
-        cnt+=intersect_linear(vn.begin(),vn.end(),wn.begin(),wn.end());
+/* move the vertices of the current level between communities while the modularity
+ * increases, return true if some vertex was moved */
+bool graphe::louvain::local_moving() {
+    const level_graph &G=m_graph;
+    int n=G.n,nt=max_threads(),i,j,t,c,sz,moves;
+    bool moved=false;
+    m_community.resize(n);
+    m_tot=G.degrees;
+    for (i=0;i<n;++i) {
+        m_community[i]=i;
+    }
+    ivectors classes;
+    color_classes(classes);
+    std::vector<worker_data> W(nt);
+    std::vector<void*> args;
+    for (j=0;j<nt;++j) {
+        W[j].L=this;
+        W[j].acc.assign(n,0);
+    }
+    double q=level_modularity(),q_new;
+    for (int sweep=0;sweep<LOUVAIN_MAX_SWEEPS;++sweep) {
+        moves=0;
+        for (ivectors_iter it=classes.begin();it!=classes.end();++it) {
+            m_class=&*it;
+            sz=it->size();
+            m_target.resize(sz);
+            t=std::max(1,std::min(nt,sz/LOUVAIN_PARALLEL_MIN));
+            args.resize(t);
+            for (j=0;j<t;++j) {
+                W[j].begin=(j*sz)/t;
+                W[j].end=((j+1)*sz)/t;
+                args[j]=&W[j];
+            }
+            run_threads(worker,args);
+            for (j=0;j<sz;++j) {
+                i=it->at(j);
+                if ((c=m_target[j])==m_community[i])
+                    continue;
+                m_tot[m_community[i]]-=G.degrees[i];
+                m_tot[c]+=G.degrees[i];
+                m_community[i]=c;
+                ++moves;
+            }
+        }
+        if (interrupted || ctrl_c)
+            throw std::runtime_error("Stopped by user interruption");
+        if (moves==0)
+            break;
+        moved=true;
+        q_new=level_modularity();
+        if (q_new-q<LOUVAIN_TOLERANCE)
+            break;
+        q=q_new;
     }
-    return _ratnormal(fraction(cnt,d*(d-1)),ctx);
+    return moved;
 }
 
-/* return the clustering coefficient of this graph */
-gen graphe::clustering_coeff(bool approx,bool exact) {
-    assert(!is_directed());
-    int i,j,n=node_count();
-    if (n<3) return 0;
-    if (approx) {
-        /* approximate within +-1/2*1e-2 with probability 0.9999 */
-        int k=184207,l=0,u,v;
-        for (i=0;i<k;++i) {
-            j=rand_integer(n);
-            const ivector &ngh=node(j).neighbors();
-            u=ngh[rand_integer(ngh.size())];
-            while (u==(v=ngh[rand_integer(ngh.size())]));
-            if (has_edge(u,v)) ++l;
+/* split the communities of the current level into connected parts, store the index
+ * of the part containing i to partition[i] and return the number of parts */
+int graphe::louvain::refine(ivector &partition) const {
+    const level_graph &G=m_graph;
+    int n=G.n,count=0,i,j,k,v,head,tail;
+    ivector queue(n);
+    partition.assign(n,-1);
+    for (i=0;i<n;++i) {
+        if (partition[i]>=0)
+            continue;
+        partition[i]=count;
+        queue[0]=i;
+        head=0;
+        tail=1;
+        while (head<tail) {
+            v=queue[head++];
+            for (k=G.offsets[v];k<G.offsets[v+1];++k) {
+                j=G.targets[k];
+                if (partition[j]<0 && m_community[j]==m_community[i]) {
+                    partition[j]=count;
+                    queue[tail++]=j;
+                }
+            }
         }
-        return _evalf(fraction(l,k),ctx);
+        ++count;
     }
-    return triangle_count(NULL,true,exact);
+    return count;
 }
 
-/* return the triangle density (transitivity) of this graph */
-gen graphe::transitivity() {
-    gen num_triangles(0),num_triplets(0);
-    if (!is_directed()) {
-        num_triangles=gen(3)*triangle_count();
-        node_iter it=nodes.begin(),itend=nodes.end();
-        for (;it!=itend;++it) {
-            num_triplets+=comb(it->neighbors().size(),2);
+/* replace the current level by the graph of its communities */
+void graphe::louvain::aggregate(const ivector &partition,int count) {
+    const level_graph &G=m_graph;
+    level_graph H;
+    int i,j,k,l,c,d;
+    ivector first(count+1,0),members(G.n);
+    for (i=0;i<G.n;++i) {
+        ++first[partition[i]+1];
+    }
+    for (c=0;c<count;++c) {
+        first[c+1]+=first[c];
+    }
+    ivector fill(first.begin(),first.end()-1);
+    for (i=0;i<G.n;++i) {
+        members[fill[partition[i]]++]=i;
+    }
+    H.n=count;
+    H.offsets.resize(count+1);
+    H.loops.assign(count,0);
+    H.degrees.assign(count,0);
+    dvector acc(count,0);
+    ivector touched,mark(count,-1);
+    for (c=0;c<count;++c) {
+        H.offsets[c]=H.targets.size();
+        for (l=first[c];l<first[c+1];++l) {
+            i=members[l];
+            H.loops[c]+=G.loops[i];
+            H.degrees[c]+=G.degrees[i];
+            for (k=G.offsets[i];k<G.offsets[i+1];++k) {
+                if ((d=partition[G.targets[k]])==c)
+                    H.loops[c]+=G.weights[k];
+                else {
+                    if (mark[d]!=c) {
+                        mark[d]=c;
+                        touched.push_back(d);
+                    }
+                    acc[d]+=G.weights[k];
+                }
+            }
         }
-    } else {
-        ipairs E;
-        get_edges_as_pairs(E);
-        int i,j;
-        ipairs_iter it=E.begin(),itend=E.end();
-        for (;it!=itend;++it) {
-            i=it->first; j=it->second;
-            const vertex &v=node(i),&w=node(j);
-            const ivector &vn=v.neighbors(),&wn=w.neighbors();
-            num_triangles+=intersect_linear(vn.begin(),vn.end(),wn.begin(),wn.end());
-            num_triplets+=wn.size()-(w.has_neighbor(i)?1:0);
+        std::sort(touched.begin(),touched.end());
+        for (ivector_iter it=touched.begin();it!=touched.end();++it) {
+            H.targets.push_back(j=*it);
+            H.weights.push_back(acc[j]);
+            acc[j]=0;
+        }
+        touched.clear();
+    }
+    H.offsets[count]=H.targets.size();
+    std::swap(m_graph,H);
+}
+
+/* find the communities, store the index of the community containing the i-th vertex
+ * to community[i] (the communities are numbered in order of their first vertices)
+ * and return the number of communities */
+int graphe::louvain::find_communities(ivector &community) {
+    int n=m_graph.n,count=n,i;
+    ivector partition;
+    community.resize(n);
+    for (i=0;i<n;++i) {
+        community[i]=i;
+    }
+    if (m_total>0) {
+        while (true) {
+            bool moved=local_moving();
+            count=refine(partition);
+            for (i=0;i<n;++i) {
+                community[i]=partition[community[i]];
+            }
+            if (!moved || count==m_graph.n)
+                break;
+            aggregate(partition,count);
         }
     }
-    if (giac::is_zero(num_triplets))
-        return 0;
-    return _ratnormal(fraction(num_triangles,num_triplets),ctx);
+    /* renumber the communities */
+    ivector index(count,-1);
+    count=0;
+    for (i=0;i<n;++i) {
+        int &c=index[community[i]];
+        if (c<0)
+            c=count++;
+        community[i]=c;
+    }
+    return count;
 }
 
-/* return the edge connectivity of this graph using Matula's algorithm */
-int graphe::edge_connectivity() {
-    int n=node_count();
-    assert(n>=2 && !is_directed());
-    set<int> D,A;
-    vector<map<int,gen> > flow;
-    int p,lambda=rand_max2,d,v,w,lambda_vw,maxdeg,i;
-    /* set lambda to its upper bound */
+/* return the modularity of the partition of the graph with adjacency A in which the
+ * i-th vertex belongs to the community with index community[i] */
+double graphe::louvain::modularity(const csr_adjacency &A,bool weighted,const ivector &community,double gamma) {
+    int n=A.node_count(),nc=0,i,k;
+    double total=0,in=0,sq=0,w;
     for (i=0;i<n;++i) {
-        if ((d=degree(i))<lambda) {
-            p=i;
-            lambda=d;
-        }
+        nc=std::max(nc,community[i]+1);
     }
-    /* construct a dominating set D */
-    v=p; maxdeg=lambda;
+    dvector tot(nc,0);
     for (i=0;i<n;++i) {
-        A.insert(i);
-        if (i!=v && (d=degree(i))>maxdeg) {
-            maxdeg=d;
-            v=i;
+        for (k=A.arc_begin(i);k<A.arc_end(i);++k) {
+            if (A.head(k)==i)
+                continue;
+            w=weighted?A.weight(k):1.0;
+            tot[community[i]]+=w;
+            total+=w;
+            if (community[A.head(k)]==community[i])
+                in+=w;
         }
     }
-    set<int>::iterator sit;
-    while (true) {
-        D.insert(v);
-        A.erase(A.find(v));
-        const vertex &vv=node(v);
-        for (ivector_iter it=vv.neighbors().begin();it!=vv.neighbors().end();++it) {
-            sit=A.find(*it);
-            if (sit!=A.end())
-                A.erase(sit);
-        }
-        if (A.empty()) break;
-        v=*A.begin();
+    if (total==0)
+        return 0;
+    for (i=0;i<nc;++i) {
+        sq+=tot[i]*tot[i];
     }
-    /* find lambda(G) */
-    v=*D.begin();
-    D.erase(D.begin());
-    set_directed(true);
-    for (set<int>::const_iterator it=D.begin();it!=D.end();++it) {
-        w=*it;
-        lambda_vw=maxflow_edmonds_karp(v,w,flow).val;
-        if (lambda_vw<lambda)
-            lambda=lambda_vw;
+    return in/total-gamma*sq/(total*total);
+}
+
+/*
+ * END OF COMMUNITY DETECTION
+ */
+
+/* find communities in this undirected graph by maximizing the modularity with resolution
+ * gamma, store them to the list of vertex sets and return the modularity of the partition
+ * (the edge weights, if any, must be nonnegative numbers) */
+double graphe::detect_communities(ivectors &communities,double gamma) const {
+    assert(!is_directed());
+    bool weighted=is_weighted();
+    const csr_adjacency &A=adjacency_snapshot(weighted);
+    louvain L(A,weighted,gamma);
+    ivector community;
+    int nc=L.find_communities(community);
+    communities.clear();
+    communities.resize(nc);
+    for (int i=0;i<node_count();++i) {
+        communities[community[i]].push_back(i);
     }
-    set_directed(false);
-    return lambda;
+    return louvain::modularity(A,weighted,community,gamma);
 }
 
-int graphe::vertex_pair_connectivity(int v,int w) {
-    int n=node_count();
-    graphe D(ctx,false);
-    D.set_directed(true);
-    D.add_nodes(2*n);
-    int u1,u2;
-    for (int i=0;i<n;++i) {
-        u1=2*i; u2=2*i+1;
-        if (i!=v || i!=w)
-            D.add_edge(u1,u2);
-        const vertex &u=node(i);
-        for (ivector_iter it=u.neighbors().begin();it!=u.neighbors().end();++it) {
-            if (i!=v) D.add_edge(*it,u1);
-            if (i!=w) D.add_edge(u2,*it);
-        }
+/* find communities in this undirected graph as above and set them as subgraphs with
+ * indices 1,2,.., return the number of communities */
+int graphe::communities_to_subgraphs(double gamma) {
+    ivectors communities;
+    detect_communities(communities,gamma);
+    unset_subgraphs();
+    int s=0;
+    for (ivectors_iter it=communities.begin();it!=communities.end();++it) {
+        set_subgraph(*it,++s);
     }
-    vector<map<int,gen> > flow;
-    return D.maxflow_edmonds_karp(2*v+1,2*w,flow).val;
+    return s;
 }
 
-/* return the vertex connectivity of an undirected graph */
-int graphe::vertex_connectivity() {
-    int n=node_count(),k=rand_max2,mindeg=rand_max2,deg,v;
-    for (int i=0;i<n;++i) {
-        if ((deg=degree(i))<mindeg) {
-            v=i;
-            mindeg=deg;
-        }
+/* return the modularity of the partition of this undirected graph in which the i-th
+ * vertex belongs to the community with index community[i] */
+double graphe::modularity(const ivector &community,double gamma) const {
+    bool weighted=is_weighted();
+    return louvain::modularity(adjacency_snapshot(weighted),weighted,community,gamma);
+}
+
+/*
+ * LIN-KERNIGHAN TOUR SEARCH:
+ * short Hamiltonian cycles are found by the chained Lin-Kernighan heuristic
+ * (Applegate et al., 2003). The tour is stored as an array of cities, and a
+ * Lin-Kernighan move is a sequence of flips (path reversals) which keeps the
+ * first city fixed. Or-opt moves, which relocate a segment of up to three
+ * cities, are tried when no Lin-Kernighan move improves the tour. Only the
+ * edges to candidate neighbors are added, and a city is examined again only
+ * if some of its tour edges changed (don't-look bits). A local optimum is
+ * perturbed by a random double-bridge kick on a short stretch of the tour
+ * and reoptimized, and the kick is undone if the tour did not get shorter.
+ * Independent searches from different initial tours run in parallel. The
+ * edges missing from the graph are given a cost which is larger than the
+ * cost of any tour, so a Hamiltonian tour is never replaced by a tour which
+ * uses such an edge.
+ */
+
+/* prepare the search on the graph with adjacency adj, if the graph is complete and the
+ * vertex coordinates x are given, the Euclidean distances are computed on the fly */
+graphe::tsp_heuristic::tsp_heuristic(const csr_adjacency &adj,const layout *x) {
+    n=adj.node_count();
+    m_threads=max_threads();
+    m_dim=0;
+    m_time_limit=0;
+    double maxw=0,minw=0,w;
+    int i,k;
+    bool complete=true;
+    for (i=0;i<n && complete;++i) {
+        if (adj.degree(i)!=n-1)
+            complete=false;
+    }
+    if (x!=NULL && complete && n>0 && int(x->size())==n) {
+        init_euclidean(*x);
+        make_candidates();
+        return;
     }
-    for (int i=0;i<n;++i) {
-        if (i==v || has_edge(i,v))
-            continue;
-        k=std::min(k,vertex_pair_connectivity(v,i));
+    A=adj;
+    for (i=0;i<n;++i) {
+        for (k=A.arc_begin(i);k<A.arc_end(i);++k) {
+            if ((w=A.weight(k))==DBL_MAX)
+                continue;
+            maxw=std::max(maxw,w);
+            minw=std::min(minw,w);
+        }
     }
-    ivector adj;
-    adjacent_nodes(v,adj);
-    for (ivector_iter it=adj.begin();it!=adj.end();++it) {
-        for (ivector_iter jt=it+1;jt!=adj.end();++jt) {
-            if (has_edge(*it,*jt)) continue;
-            k=std::min(k,vertex_pair_connectivity(*it,*jt));
+    /* a tour costs at most n*maxw, and a tour with a missing edge costs at least
+     * m_penalty+(n-1)*minw, which is larger even if some weights are negative */
+    m_penalty=(n+1)*(maxw-minw)+1;
+    m_feasible_bound=m_penalty+std::max(n-1,0)*minw;
+    m_eps=1e-12*m_penalty;
+    if (n<=TSP_DENSE_MAX) {
+        m_matrix.assign(n*n,m_penalty);
+        for (i=0;i<n;++i) {
+            for (k=A.arc_begin(i);k<A.arc_end(i);++k) {
+                if ((w=A.weight(k))!=DBL_MAX)
+                    m_matrix[i*n+A.head(k)]=w;
+            }
         }
     }
-    return k;
+    make_candidates();
 }
 
-/* truncate the graph, assuming that it is planar */
-void graphe::truncate(graphe &dest,const ivectors &faces) {
-    clear_embedding();
-    set_embedding(faces);
-    dest.clear();
-    int nv=node_count(),ne=edge_count(),n;
-    if (dest.supports_attributes()) {
-        vecteur V;
-        dest.make_default_labels(V,2*ne);
-        dest.add_nodes(V);
-    } else dest.add_nodes(2*ne);
-    int cnt=0,f;
-    ivector adj;
-    map<ipair,ivector> p;
-    for (int i=0;i<nv;++i) {
-        vertex &v=node(i);
-        n=v.neighbors().size();
-        ivector ngh;
-        adjacent_nodes(i,adj);
-        ngh.push_back(adj.back());
-        adj.pop_back();
-        while (!adj.empty()) {
-            f=v.edge_face(ngh.back());
-            ivector::iterator it=adj.begin();
-            for (;it!=adj.end() && f!=node(*it).edge_face(i);++it);
-            assert(it!=adj.end());
-            ngh.push_back(*it);
-            adj.erase(it);
+/* prepare the search on the complete graph of the cities with coordinates x, the edges
+ * are never stored */
+graphe::tsp_heuristic::tsp_heuristic(const layout &x) {
+    n=x.size();
+    m_threads=max_threads();
+    m_time_limit=0;
+    init_euclidean(x);
+    make_candidates();
+}
+
+/* store the coordinates x of the cities and build a k-d tree on them, no tour costs more
+ * than n times the diameter of the bounding box */
+void graphe::tsp_heuristic::init_euclidean(const layout &x) {
+    int i,k;
+    m_dim=x.front().size();
+    m_coords.resize(n*m_dim);
+    dvector lo(x.front().begin(),x.front().end()),hi(lo);
+    for (i=0;i<n;++i) {
+        const point &p=x[i];
+        std::copy(p.begin(),p.begin()+m_dim,m_coords.begin()+i*m_dim);
+        for (k=0;k<m_dim;++k) {
+            lo[k]=std::min(lo[k],p[k]);
+            hi[k]=std::max(hi[k],p[k]);
+        }
+    }
+    double diam=0;
+    for (k=0;k<m_dim;++k) {
+        diam+=(hi[k]-lo[k])*(hi[k]-lo[k]);
+    }
+    m_penalty=(n+1)*std::sqrt(diam)+1;
+    m_feasible_bound=m_penalty;
+    m_eps=1e-12*m_penalty;
+    m_kdtree.resize(n);
+    m_kdpos.resize(n);
+    m_kdsize.resize(n);
+    for (i=0;i<n;++i) {
+        m_kdtree[i]=i;
+    }
+    kd_build(0,n,0);
+    for (i=0;i<n;++i) {
+        m_kdpos[m_kdtree[i]]=i;
+    }
+}
+
+/* arrange the cities in m_kdtree[lo..hi) as a k-d tree which splits by the coordinate
+ * depth modulo m_dim at the root */
+void graphe::tsp_heuristic::kd_build(int lo,int hi,int depth) {
+    if (lo>=hi)
+        return;
+    int mid=(lo+hi)/2;
+    m_kdsize[mid]=hi-lo;
+    kd_comparator comp(&m_coords.front(),m_dim,depth%m_dim);
+    std::nth_element(m_kdtree.begin()+lo,m_kdtree.begin()+mid,m_kdtree.begin()+hi,comp);
+    kd_build(lo,mid,depth+1);
+    kd_build(mid+1,hi,depth+1);
+}
+
+/* find the k cities other than self nearest to the point p in the subtree m_kdtree[lo..hi),
+ * heap is a max-heap of pairs (squared distance,city) with at most k elements */
+void graphe::tsp_heuristic::kd_nearest(const double *p,int lo,int hi,int depth,int k,int self,
+                                       std::vector<std::pair<double,int> > &heap) const {
+    if (lo>=hi)
+        return;
+    int mid=(lo+hi)/2,c=m_kdtree[mid],axis=depth%m_dim;
+    const double *q=&m_coords[c*m_dim];
+    if (c!=self) {
+        double s=0,d;
+        for (int l=0;l<m_dim;++l) {
+            d=p[l]-q[l];
+            s+=d*d;
+        }
+        if (int(heap.size())<k) {
+            heap.push_back(make_pair(s,c));
+            std::push_heap(heap.begin(),heap.end());
+        } else if (s<heap.front().first) {
+            std::pop_heap(heap.begin(),heap.end());
+            heap.back()=make_pair(s,c);
+            std::push_heap(heap.begin(),heap.end());
+        }
+    }
+    double diff=p[axis]-q[axis];
+    bool left=diff<0;
+    kd_nearest(p,left?lo:mid+1,left?mid:hi,depth+1,k,self,heap);
+    if (int(heap.size())<k || diff*diff<heap.front().first)
+        kd_nearest(p,left?mid+1:lo,left?hi:mid,depth+1,k,self,heap);
+}
+
+/* find the unvisited city (where[c]>=0) nearest to the point p in the subtree m_kdtree[lo..hi),
+ * sizes[pos] is the number of unvisited cities in the subtree rooted at pos, v is the nearest
+ * city found so far and min_d is its squared distance from p */
+void graphe::tsp_heuristic::kd_nearest_unvisited(const double *p,int lo,int hi,int depth,const ivector &where,
+                                                 const ivector &sizes,double &min_d,int &v) const {
+    if (lo>=hi)
+        return;
+    int mid=(lo+hi)/2,c=m_kdtree[mid],axis=depth%m_dim;
+    if (sizes[mid]==0)
+        return;
+    const double *q=&m_coords[c*m_dim];
+    if (where[c]>=0) {
+        double s=0,d;
+        for (int l=0;l<m_dim;++l) {
+            d=p[l]-q[l];
+            s+=d*d;
         }
-        for (int j=0;j<n;++j) {
-            p[make_pair(i<ngh[j]?i:ngh[j],i<ngh[j]?ngh[j]:i)].push_back(cnt+j);
-            dest.add_edge(cnt+j,cnt+(j+1)%n);
+        if (s<min_d) {
+            min_d=s;
+            v=c;
         }
-        cnt+=n;
     }
-    ipairs E;
-    get_edges_as_pairs(E);
-    for (ipairs_iter it=E.begin();it!=E.end();++it) {
-        const ivector &iv=p[*it];
-        assert(iv.size()==2);
-        dest.add_edge(iv.front(),iv.back());
+    double diff=p[axis]-q[axis];
+    bool left=diff<0;
+    kd_nearest_unvisited(p,left?lo:mid+1,left?mid:hi,depth+1,where,sizes,min_d,v);
+    if (diff*diff<min_d)
+        kd_nearest_unvisited(p,left?mid+1:lo,left?hi:mid,depth+1,where,sizes,min_d,v);
+}
+
+/* mark the city v as visited in the subtree sizes of the k-d tree */
+void graphe::tsp_heuristic::kd_remove(int v,ivector &sizes) const {
+    int lo=0,hi=n,mid,pos=m_kdpos[v];
+    while (true) {
+        mid=(lo+hi)/2;
+        --sizes[mid];
+        if (pos==mid)
+            break;
+        if (pos<mid)
+            hi=mid;
+        else lo=mid+1;
     }
 }
 
-/*
- * CIRC_ENUM CLASS IMPLEMENTATION
- *
- * Implementation of Tarjan's algorithm published in SIAM J. Comp. 2(3), 1973
- */
+/* return the cost of traveling between the cities i and j */
+double graphe::tsp_heuristic::dist(int i,int j) const {
+    if (m_dim>0) {
+        const double *p=&m_coords[i*m_dim],*q=&m_coords[j*m_dim];
+        double s=0,d;
+        for (int k=0;k<m_dim;++k) {
+            d=p[k]-q[k];
+            s+=d*d;
+        }
+        return std::sqrt(s);
+    }
+    if (!m_matrix.empty())
+        return m_matrix[i*n+j];
+    int k=A.arc_index(i,j);
+    return k<0 || A.weight(k)==DBL_MAX?m_penalty:A.weight(k);
+}
 
-graphe::circ_enum::circ_enum(graphe *gr,int lo,int hi) {
-    G=gr;
-    lb=lo; ub=hi;
-    int n=G->node_count();
-    A.resize(n);
-    for (int i=0;i<n;++i) {
-        const vertex &v=G->node(i);
-        for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-            A[i].push_back(*it);
+/* return a pseudorandom integer in [0,k) */
+int graphe::tsp_heuristic::rand_int(worker_data &W,int k) const {
+    W.seed=W.seed*1103515245+12345;
+    return int((W.seed>>16)&0x7FFFFFFF)%k;
+}
+
+/* find the candidate neighbors of each city among its nearest neighbors, in the plane
+ * the two nearest neighbors in each quadrant are preferred; Euclidean cities are found
+ * in the k-d tree, else by scanning the arcs */
+void graphe::tsp_heuristic::make_candidates() {
+    std::vector<std::pair<double,int> > nb;
+    bvector taken;
+    int i,j,k,l,m,q,count[4];
+    m_cand.resize(n);
+    for (i=0;i<n;++i) {
+        nb.clear();
+        if (m_dim>0) {
+            kd_nearest(&m_coords[i*m_dim],0,n,0,4*TSP_CANDIDATES,i,nb);
+            std::sort_heap(nb.begin(),nb.end());
+            m=nb.size();
+        } else {
+            for (k=A.arc_begin(i);k<A.arc_end(i);++k) {
+                if ((j=A.head(k))!=i && A.weight(k)!=DBL_MAX)
+                    nb.push_back(make_pair(A.weight(k),j));
+            }
+            m=std::min(int(nb.size()),4*TSP_CANDIDATES);
+            std::partial_sort(nb.begin(),nb.begin()+m,nb.end());
+        }
+        ivector &cand=m_cand[i];
+        cand.clear();
+        cand.reserve(TSP_CANDIDATES);
+        if (m_dim==2) {
+            taken.assign(m,false);
+            std::fill(count,count+4,0);
+            for (l=0;l<m && int(cand.size())<TSP_CANDIDATES;++l) {
+                j=nb[l].second;
+                q=(m_coords[2*j]<m_coords[2*i]?1:0)+(m_coords[2*j+1]<m_coords[2*i+1]?2:0);
+                if (count[q]<2) {
+                    ++count[q];
+                    cand.push_back(j);
+                    taken[l]=true;
+                }
+            }
+            for (l=0;l<m && int(cand.size())<TSP_CANDIDATES;++l) {
+                if (!taken[l])
+                    cand.push_back(nb[l].second);
+            }
+        } else for (l=0;l<m && l<TSP_CANDIDATES;++l) {
+            cand.push_back(nb[l].second);
+        }
+    }
+}
+
+/* reverse the part of the tour between the positions i and j (inclusive), the complementary
+ * part is reversed instead if it is shorter */
+void graphe::tsp_heuristic::reverse_path(worker_data &W,int i,int j) {
+    int len=(j-i+n)%n+1,a,b,k;
+    if (2*len>n) {
+        k=i;
+        i=(j+1)%n;
+        j=(k+n-1)%n;
+        len=n-len;
+    }
+    for (k=0;k<len/2;++k) {
+        a=W.tour[i];
+        b=W.tour[j];
+        W.tour[i]=b;
+        W.pos[b]=i;
+        W.tour[j]=a;
+        W.pos[a]=j;
+        if (++i==n)
+            i=0;
+        if (--j<0)
+            j=n-1;
+    }
+}
+
+/* replace the tour edges ab and cd by ac and bd, where b follows a and d follows c in the
+ * same direction, and record the flip in the journal */
+void graphe::tsp_heuristic::flip(worker_data &W,int a,int b,int c,int d) {
+    if (succ(W,a)==b)
+        reverse_path(W,W.pos[b],W.pos[c]);
+    else reverse_path(W,W.pos[c],W.pos[b]);
+    W.journal.push_back(a);
+    W.journal.push_back(b);
+    W.journal.push_back(c);
+    W.journal.push_back(d);
+}
+
+/* undo the flips recorded in the journal after the given mark */
+void graphe::tsp_heuristic::undo(worker_data &W,int mark) {
+    int a,b,c,k;
+    while ((k=W.journal.size())>mark) {
+        a=W.journal[k-4];
+        b=W.journal[k-3];
+        c=W.journal[k-2];
+        W.journal.resize(k-4);
+        /* now c follows a and d follows b */
+        if (succ(W,a)==c)
+            reverse_path(W,W.pos[c],W.pos[b]);
+        else reverse_path(W,W.pos[b],W.pos[c]);
+    }
+}
+
+/* append the city v to the queue of cities to be examined */
+void graphe::tsp_heuristic::activate(worker_data &W,int v) {
+    if (W.queued[v])
+        return;
+    W.queued[v]=true;
+    W.queue[(W.qhead+W.qsize)%n]=v;
+    ++W.qsize;
+}
+
+/* activate the endpoints of the edges changed by the flips in the given part of the journal */
+void graphe::tsp_heuristic::activate_journal(worker_data &W,int from,int to) {
+    for (int k=from;k<to;++k) {
+        activate(W,W.journal[k]);
+    }
+}
+
+/* perform the Lin-Kernighan move which removes the edge t1t2 and adds t2t3, return the largest
+ * gain along the sequence of flips and store the journal size at that point to best_mark */
+double graphe::tsp_heuristic::lk_chain(worker_data &W,int t1,int t2,int t3,int &best_mark) {
+    double g=dist(t1,t2),best=0,crit,max_crit,d23,gain;
+    int t4,c,depth;
+    bool fwd;
+    ivector_iter it,itend;
+    W.added.clear();
+    best_mark=W.journal.size();
+    for (depth=0;depth<TSP_LK_MAX_DEPTH;++depth) {
+        fwd=succ(W,t1)==t2;
+        if (depth>0) {
+            /* choose t3 which maximizes the difference between the removed and the added edge */
+            t3=-1;
+            max_crit=-DBL_MAX;
+            for (it=m_cand[t2].begin(),itend=m_cand[t2].end();it!=itend;++it) {
+                if ((c=*it)==t1 || g-(d23=dist(t2,c))<=m_eps)
+                    continue;
+                if ((t4=next(W,c,!fwd))==t2 || std::find(W.added.begin(),W.added.end(),make_pair(std::min(c,t4),std::max(c,t4)))!=W.added.end())
+                    continue;
+                if ((crit=dist(c,t4)-d23)>max_crit) {
+                    max_crit=crit;
+                    t3=c;
+                }
+            }
+            if (t3<0)
+                break;
+        }
+        t4=next(W,t3,!fwd);
+        g+=dist(t3,t4)-dist(t2,t3);
+        flip(W,t1,t2,t4,t3);
+        W.added.push_back(make_pair(std::min(t2,t3),std::max(t2,t3)));
+        if ((gain=g-dist(t4,t1))>best) {
+            best=gain;
+            best_mark=W.journal.size();
+        }
+        t2=t4;
+    }
+    return best;
+}
+
+/* try to improve the tour by a Lin-Kernighan move starting at t1, return true on success */
+bool graphe::tsp_heuristic::lk_move(worker_data &W,int t1) {
+    int mark=W.journal.size(),best_mark,t2,t4,c,i,k,count;
+    int nb[2]={succ(W,t1),pred(W,t1)};
+    std::pair<double,int> alt[TSP_CANDIDATES];
+    double g,gain;
+    bool fwd;
+    for (i=0;i<2;++i) {
+        t2=nb[i];
+        fwd=succ(W,t1)==t2;
+        g=dist(t1,t2);
+        count=0;
+        for (ivector_iter it=m_cand[t2].begin();it!=m_cand[t2].end();++it) {
+            if ((c=*it)==t1 || g-dist(t2,c)<=m_eps || (t4=next(W,c,!fwd))==t2)
+                continue;
+            alt[count++]=make_pair(dist(t2,c)-dist(c,t4),c);
+        }
+        std::sort(alt,alt+count);
+        for (k=0;k<count && k<TSP_LK_BREADTH;++k) {
+            gain=lk_chain(W,t1,t2,alt[k].second,best_mark);
+            if (gain>m_eps) {
+                undo(W,best_mark);
+                activate_journal(W,mark,best_mark);
+                W.cost-=gain;
+                return true;
+            }
+            undo(W,mark);
         }
     }
+    return false;
 }
 
-void graphe::circ_enum::backtrack(int v,bool &f) {
-    bool g;
-    f=false;
-    point_stack.push_back(v);
-    mark[v]=true;
-    marked_stack.push(v);
-    int w,u,len;
-    for (int i=A[v].size();i-->0;) {
-        w=A[v][i];
-        if (w<s) A[v].erase(A[v].begin()+i);
-        else if (w==s) {
-            len=point_stack.size();
-            if ((lb<0 || len>=lb) && (ub<0 || len<=ub))
-                res.push_back(point_stack);
-            f=true;
-        } else if (!mark[w]) {
-            backtrack(w,g);
-            f=f||g;
+/* try to improve the tour by moving a segment of at most three cities starting at s1 next to
+ * one of its candidate neighbors, return true on success */
+bool graphe::tsp_heuristic::or_move(worker_data &W,int s1) {
+    int p,q,s2,c,d,len,i,k,mark,seg[3];
+    double g,gain;
+    bool fwd;
+    for (i=0;i<2;++i) {
+        fwd=i==0;
+        p=next(W,s1,!fwd);
+        s2=s1;
+        for (len=1;len<=3;++len) {
+            if (len>1)
+                s2=next(W,s2,fwd);
+            seg[len-1]=s2;
+            if ((q=next(W,s2,fwd))==p || next(W,q,fwd)==p)
+                break;
+            if ((g=dist(p,s1)+dist(s2,q)-dist(p,q))<=m_eps)
+                continue;
+            for (ivector_iter it=m_cand[s1].begin();it!=m_cand[s1].end();++it) {
+                c=*it;
+                if (c==p || c==q || std::find(seg,seg+len,c)!=seg+len)
+                    continue;
+                for (k=0;k<2;++k) {
+                    d=next(W,c,k==0);
+                    if (d==p || d==q || std::find(seg,seg+len,d)!=seg+len)
+                        continue;
+                    if ((gain=g+dist(c,d)-dist(c,s1)-dist(s2,d))<=m_eps)
+                        continue;
+                    /* replace the edges ps1, s2q and cd by pq, cs1 and s2d */
+                    mark=W.journal.size();
+                    if (next(W,c,fwd)==d) {
+                        flip(W,p,s1,c,d);
+                        flip(W,p,c,q,s2);
+                        flip(W,c,s2,s1,d);
+                    } else {
+                        flip(W,s2,q,d,c);
+                        flip(W,p,s1,q,c);
+                    }
+                    activate_journal(W,mark,W.journal.size());
+                    W.cost-=gain;
+                    return true;
+                }
+            }
         }
     }
-    /* f is true if an elementary circuit containing
-     * the partial path has been found */
-    if (f) {
-        while (marked_stack.top()!=v) {
-            u=marked_stack.top();
-            marked_stack.pop();
-            mark[u]=false;
+    return false;
+}
+
+/* improve the tour until none of the queued cities yields an improving move */
+void graphe::tsp_heuristic::local_search(worker_data &W) {
+    int v,steps=0;
+    while (W.qsize>0 && !W.stopped && !W.expired) {
+        v=W.queue[W.qhead];
+        if (++W.qhead==n)
+            W.qhead=0;
+        --W.qsize;
+        W.queued[v]=false;
+        if (lk_move(W,v) || or_move(W,v))
+            activate(W,v);
+        if ((++steps%1024)==0) {
+            if (interrupted || ctrl_c)
+                W.stopped=true;
+            else if (out_of_time())
+                W.expired=true;
+        }
+    }
+}
+
+/* perturb the tour by exchanging two adjacent random segments, i.e. by a double-bridge move */
+void graphe::tsp_heuristic::kick(worker_data &W) {
+    int len=std::min(TSP_KICK_LENGTH,(n-2)/2),p=rand_int(W,n),l1=1+rand_int(W,len),l2=1+rand_int(W,len);
+    int a=W.tour[p],b1=W.tour[(p+1)%n],b2=W.tour[(p+l1)%n];
+    int c1=W.tour[(p+l1+1)%n],c2=W.tour[(p+l1+l2)%n],d=W.tour[(p+l1+l2+1)%n];
+    int mark=W.journal.size();
+    W.cost+=dist(a,c1)+dist(c2,b1)+dist(b2,d)-dist(a,b1)-dist(b2,c1)-dist(c2,d);
+    /* a b1..b2 c1..c2 d becomes a c1..c2 b1..b2 d in three flips */
+    flip(W,a,b1,c2,d);
+    flip(W,a,c2,c1,b2);
+    flip(W,c2,b2,b1,d);
+    activate_journal(W,mark,W.journal.size());
+}
+
+/* construct an initial tour by the nearest neighbor heuristic from a random city */
+void graphe::tsp_heuristic::initial_tour(worker_data &W) {
+    ivector rest(n),where(n),sizes;
+    int i,j,k,v,next_v;
+    double d,min_d;
+    for (i=0;i<n;++i) {
+        rest[i]=where[i]=i;
+    }
+    if (m_dim>0)
+        sizes=m_kdsize;
+    W.tour.resize(n);
+    v=rand_int(W,n);
+    for (i=0;i<n;++i) {
+        W.tour[i]=v;
+        /* remove v from the unvisited cities */
+        j=where[v];
+        rest[j]=rest.back();
+        where[rest[j]]=j;
+        rest.pop_back();
+        where[v]=-1;
+        if (m_dim>0)
+            kd_remove(v,sizes);
+        if (rest.empty())
+            break;
+        next_v=-1;
+        min_d=DBL_MAX;
+        for (ivector_iter it=m_cand[v].begin();it!=m_cand[v].end();++it) {
+            if (where[*it]>=0 && (d=dist(v,*it))<min_d) {
+                min_d=d;
+                next_v=*it;
+            }
+        }
+        if (next_v<0) {
+            if (m_dim>0)
+                kd_nearest_unvisited(&m_coords[v*m_dim],0,n,0,where,sizes,min_d,next_v);
+            else if (!m_matrix.empty()) {
+                for (ivector_iter it=rest.begin();it!=rest.end();++it) {
+                    if ((d=dist(v,*it))<min_d) {
+                        min_d=d;
+                        next_v=*it;
+                    }
+                }
+            } else for (k=A.arc_begin(v);k<A.arc_end(v);++k) {
+                if (where[j=A.head(k)]>=0 && (d=A.weight(k))<min_d) {
+                    min_d=d;
+                    next_v=j;
+                }
+            }
         }
-        marked_stack.pop();
-        mark[v]=false;
+        v=next_v>=0?next_v:rest[rand_int(W,rest.size())];
     }
-    point_stack.pop_back();
 }
 
-/* return the list of all elementary cycles in the given digraph */
-graphe::ivectors graphe::circ_enum::find_cycles() {
-    int n=G->node_count(),u;
-    bool flag;
-    mark.resize(n,false);
-    for (s=0;s<n;++s) {
-        backtrack(s,flag);
-        while (!marked_stack.empty()) {
-            u=marked_stack.top();
-            mark[u]=false;
-            marked_stack.pop();
+/* initialize the search from the tour hc (a closed list of cities), or from a nearest
+ * neighbor tour if hc is empty */
+void graphe::tsp_heuristic::init_worker(worker_data &W,const ivector &hc) {
+    if (hc.empty())
+        initial_tour(W);
+    else W.tour.assign(hc.begin(),hc.begin()+n);
+    W.pos.resize(n);
+    W.queue.resize(n);
+    W.queued.assign(n,true);
+    W.cost=0;
+    for (int i=0;i<n;++i) {
+        W.pos[W.tour[i]]=i;
+        W.queue[i]=W.tour[i];
+        W.cost+=dist(W.tour[i],W.tour[(i+1)%n]);
+    }
+    W.qhead=0;
+    W.qsize=n;
+    W.journal.clear();
+    W.stopped=W.expired=false;
+}
+
+/* return true if the time limit is exceeded (the elapsed wall clock time is measured) */
+bool graphe::tsp_heuristic::out_of_time() const {
+    return m_time_limit>0 && realtime()-m_start_time>m_time_limit;
+}
+
+void *graphe::tsp_heuristic::worker(void *arg) {
+    worker_data &W=*static_cast<worker_data*>(arg);
+    tsp_heuristic *H=W.H;
+    double cost;
+    H->init_worker(W,W.start!=NULL?*W.start:ivector(0));
+    H->local_search(W);
+    W.journal.clear();
+    for (int k=0;k<W.kicks && !W.stopped && !W.expired && !H->out_of_time();++k) {
+        cost=W.cost;
+        H->kick(W);
+        H->local_search(W);
+        if (W.cost<cost-H->m_eps)
+            W.journal.clear();
+        else {
+            H->undo(W,0);
+            W.cost=cost;
         }
     }
-    return res;
+    return NULL;
+}
+
+/* improve the tour hc (a closed list of cities) by local search and return its cost */
+double graphe::tsp_heuristic::improve(ivector &hc) {
+    assert(int(hc.size())==n+1);
+    worker_data W;
+    W.H=this;
+    W.seed=1;
+    m_time_limit=0;
+    init_worker(W,hc);
+    local_search(W);
+    std::copy(W.tour.begin(),W.tour.end(),hc.begin());
+    hc.back()=hc.front();
+    return W.cost;
+}
+
+/* find a short tour by independent chained Lin-Kernighan searches, one per thread, store it
+ * to hc (as a closed list of cities) and return its cost, the first search starts from the
+ * tour start if given, and the searches run until the given time limit (in seconds of wall
+ * clock time, checked also during the local search) or, if it is zero, until max(n,100)
+ * kicks have been applied */
+double graphe::tsp_heuristic::find_tour(ivector &hc,const ivector *start,double time_limit) {
+    int nt=std::max(1,m_threads),j,best=0;
+    m_time_limit=time_limit;
+    m_start_time=realtime();
+    std::vector<worker_data> W(nt);
+    std::vector<void*> args(nt);
+    for (j=0;j<nt;++j) {
+        W[j].H=this;
+        W[j].seed=2*j+1;
+        W[j].kicks=n<8?0:(time_limit>0?INT_MAX:std::max(n,100));
+        W[j].start=j==0?start:NULL;
+        args[j]=&W[j];
+    }
+    run_threads(worker,args);
+    for (j=0;j<nt;++j) {
+        if (W[j].stopped)
+            throw std::runtime_error("Stopped by user interruption");
+        if (W[j].cost<W[best].cost)
+            best=j;
+    }
+    hc=W[best].tour;
+    hc.push_back(hc.front());
+    return W[best].cost;
 }
 
 /*
- * END OF CIRC_ENUM CLASS IMPLEMENTATION
+ * END OF LIN-KERNIGHAN TOUR SEARCH
  */
 
-void graphe::elementary_cycles(ivectors &cyc,int lo,int hi) {
-    assert(is_directed());
-    circ_enum ce(this,lo,hi);
-    cyc=ce.find_cycles();
-}
-
 /*
- * YEN CLASS IMPLEMENTATION
+ * MINIMAL SPANNING FOREST:
+ * the minimal spanning forest is found by the filter-Kruskal algorithm (Osipov
+ * et al., 2009). The edges are stored with their weights as doubles in a single
+ * array, which is partitioned around a random pivot weight as in quicksort. The
+ * light part is processed first, and then the edges in the heavy part which
+ * connect vertices of the same component are filtered out before the heavy part
+ * is processed. Small parts are sorted and processed by Kruskal's algorithm.
+ * Large parts are filtered in parallel, and the algorithm stops as soon as the
+ * forest spans all vertices, so the heaviest edges are often never sorted.
+ * Complete graphs given by a distance function are handled by Prim's algorithm,
+ * which evaluates each distance only once.
  */
 
-void graphe::yen::delete_children(tree_node *r) {
-    for (vector<tree_node*>::const_iterator it=r->children.begin();it!=r->children.end();++it) {
-        delete_children(*it);
-        delete *it;
+/* pack the edges of the subgraph of A induced by the vertices i with (*include)[i]=true
+ * (all vertices if include=NULL) into the array of edges */
+graphe::mst_finder::mst_finder(const csr_adjacency &A,const bvector *include) {
+    int i,j,k;
+    edge e;
+    n=A.node_count();
+    m_threads=max_threads();
+    m_limit=-1;
+    m_seed=1;
+    m_forest=NULL;
+    m_total=0;
+    m_edges.reserve(A.arc_count()/2);
+    for (i=0;i<n;++i) {
+        if (include!=NULL && !include->at(i))
+            continue;
+        ++m_limit;
+        for (k=A.arc_begin(i);k<A.arc_end(i);++k) {
+            j=A.head(k);
+            if (j<=i || (include!=NULL && !include->at(j)))
+                continue;
+            e.w=A.weight(k);
+            e.u=i;
+            e.v=j;
+            m_edges.push_back(e);
+        }
     }
 }
 
-graphe::yen::tree_node *graphe::yen::add_tree_node(tree_node *p) {
-    if (p==NULL) {
-        root=new tree_node;
-        root->parent=NULL;
-        root->i=src;
-        return root;
+/* return the representative of the component containing v, without modifying the forest */
+int graphe::mst_finder::root(int v) const {
+    while (m_parent[v]!=v) {
+        v=m_parent[v];
     }
-    tree_node *t;
-    p->children.push_back(t=new tree_node);
-    t->parent=p;
-    return t;
+    return v;
 }
 
-graphe::yen::~yen() {
-    if (root!=NULL) {
-        delete_children(root);
-        delete root;
+/* return the representative of the component containing v, using path halving */
+int graphe::mst_finder::find(int v) {
+    int p;
+    while ((p=m_parent[v])!=v) {
+        m_parent[v]=m_parent[p];
+        v=m_parent[v];
     }
+    return v;
 }
 
-graphe::yen::tree_node *graphe::yen::store_path(const ivector &path,tree_node *r) {
-    tree_node *t=r,*next;
-    int i,n=path.size();
-    for (i=1;i<n;++i) {
-        next=NULL;
-        for (vector<tree_node*>::const_iterator it=t->children.begin();it!=t->children.end();++it) {
-            if ((*it)->i==path[i]) {
-                next=*it;
-                break;
-            }
-        }
-        if (next!=NULL) {
-            t=next;
+/* sort the edges in [lo,hi) and add them to the forest by Kruskal's algorithm */
+void graphe::mst_finder::kruskal(int lo,int hi) {
+    std::sort(m_edges.begin()+lo,m_edges.begin()+hi,lighter);
+    int ru,rv;
+    for (int k=lo;k<hi && int(m_forest->size())<m_limit;++k) {
+        const edge &e=m_edges[k];
+        if ((ru=find(e.u))==(rv=find(e.v)))
             continue;
-        }
-        t=add_tree_node(t);
-        t->i=path[i];
-        t->selected=false;
+        m_parent[ru]=rv;
+        m_forest->push_back(make_pair(e.u,e.v));
+        m_total+=e.w;
     }
-    return t;
 }
 
-void graphe::yen::select_path(tree_node *p) {
-    kspaths.push_back(p);
-    tree_node *t=p;
-    while (t!=NULL) {
-        if (t->selected) break;
-        t->selected=true;
-        t=t->parent;
+/* partition the edges in [lo,hi) around the median weight of three random samples
+ * and return the index of the first edge heavier than the pivot */
+int graphe::mst_finder::partition(int lo,int hi) {
+    double s[3],pivot;
+    for (int k=0;k<3;++k) {
+        m_seed=m_seed*1103515245+12345;
+        s[k]=m_edges[lo+int((m_seed>>16)%ulong(hi-lo))].w;
+    }
+    pivot=std::max(std::min(s[0],s[1]),std::min(std::max(s[0],s[1]),s[2]));
+    int i=lo,j=hi-1;
+    while (true) {
+        while (i<=j && m_edges[i].w<=pivot) ++i;
+        while (i<=j && m_edges[j].w>pivot) --j;
+        if (i>=j)
+            break;
+        std::swap(m_edges[i],m_edges[j]);
     }
+    return i;
 }
 
-void graphe::yen::restore_path(tree_node *p,ivector &path) {
-    tree_node *t=p;
-    path.clear();
-    while (t!=NULL) {
-        path.push_back(t->i);
-        t=t->parent;
+/* move the edges in the assigned range which connect different components to its front */
+void *graphe::mst_finder::filter_worker(void *arg) {
+    filter_data *D=static_cast<filter_data*>(arg);
+    mst_finder *F=D->F;
+    std::vector<edge> &E=F->m_edges;
+    int k=D->begin;
+    for (int j=D->begin;j<D->end;++j) {
+        if (D->shared?F->root(E[j].u)!=F->root(E[j].v):F->find(E[j].u)!=F->find(E[j].v))
+            E[k++]=E[j];
     }
-    std::reverse(path.begin(),path.end());
+    D->kept=k-D->begin;
+    return NULL;
 }
 
-void graphe::yen::find_kspaths(ivectors &paths) {
-    assert(G->supports_attributes());
-    ivectors cp;
-    vecteur pw;
-    matrice W;
-    if (!G->is_weighted()) {
-        G->adjacency_matrix(W);
-        G->make_weighted(W);
+/* remove the edges in [lo,hi) which connect vertices of the same component,
+ * return the end of the range of the remaining edges */
+int graphe::mst_finder::filter(int lo,int hi) {
+    int nt=hi-lo<n?1:std::max(1,std::min(m_threads,(hi-lo)/MST_PARALLEL_MIN)),len=(hi-lo)/nt,end=lo,j;
+    if (nt>1) { // the threads cannot compress the paths, so the forest is flattened first
+        for (j=0;j<n;++j) {
+            m_parent[j]=find(j);
+        }
     }
-    G->weight_matrix(W);
-    paths.clear();
-    G->dijkstra(src,ivector(1,dest),pw,&cp);
-    if (cp.front().empty()) return;
-    kspaths.clear();
-    tree_node *p=store_path(cp.front(),add_tree_node(NULL)),*t,*next;
-    select_path(p);
-    stack<ipair> removed_edges;
-    gen wg;
-    int i,j,spur_node,tail,head;
-    set<pair<gen,tree_node*>,kspaths_comparator> candidates;
-    set<pair<gen,tree_node*>,kspaths_comparator>::const_iterator cit;
-    ivector path;
-    path.reserve(G->node_count());
-    G->save_subgraphs();
-    G->unset_subgraphs(1);
-    for (int k=1;k<K;++k) {
-        restore_path(p,path);
-        t=root;
-        for (i=0;i+1<(int)path.size();++i) {
-            spur_node=path[i];
-            for (vector<tree_node*>::const_iterator it=t->children.begin();it!=t->children.end();++it) {
-                if ((*it)->selected) {
-                    head=(*it)->i; tail=(*it)->parent->i;
-                    G->set_edge_attribute(tail,head,_GT_ATTRIB_WEIGHT,plusinf());
-                    removed_edges.push(make_pair(tail,head));
-                    if (head==path[i+1]) next=*it;
-                }
-            }
-            G->dijkstra(spur_node,ivector(1,dest),pw,&cp,1);
-            if (!cp.front().empty()) {
-                wg=pw.front();
-                for (j=0;j<i;++j) wg+=W[path[j]][path[j+1]];
-                candidates.insert(make_pair(wg,store_path(cp.front(),t)));
+    std::vector<filter_data> D(nt);
+    std::vector<void*> args(nt);
+    for (j=0;j<nt;++j) {
+        D[j].F=this;
+        D[j].begin=lo+j*len;
+        D[j].end=j+1<nt?D[j].begin+len:hi;
+        D[j].shared=nt>1;
+        args[j]=&D[j];
+    }
+    run_threads(filter_worker,args);
+    for (j=0;j<nt;++j) {
+        if (end<D[j].begin)
+            std::copy(m_edges.begin()+D[j].begin,m_edges.begin()+D[j].begin+D[j].kept,m_edges.begin()+end);
+        end+=D[j].kept;
+    }
+    return end;
+}
+
+/* add the edges of the minimal spanning forest among the edges in [lo,hi) */
+void graphe::mst_finder::filter_kruskal(int lo,int hi) {
+    if (hi<=lo || int(m_forest->size())>=m_limit)
+        return;
+    if (hi-lo<=MST_SORT_MAX) {
+        kruskal(lo,hi);
+        return;
+    }
+    int mid=partition(lo,hi);
+    if (mid==hi) { // no edge is heavier than the pivot
+        kruskal(lo,hi);
+        return;
+    }
+    filter_kruskal(lo,mid);
+    if (int(m_forest->size())<m_limit)
+        filter_kruskal(mid,filter(mid,hi));
+}
+
+/* store the edges of the minimal spanning forest to the list forest and return its weight */
+double graphe::mst_finder::find_forest(ipairs &forest) {
+    m_parent.resize(n);
+    for (int i=0;i<n;++i) {
+        m_parent[i]=i;
+    }
+    forest.clear();
+    forest.reserve(std::max(m_limit,0));
+    m_forest=&forest;
+    m_total=0;
+    filter_kruskal(0,m_edges.size());
+    m_forest=NULL;
+    return m_total;
+}
+
+/* find the minimal spanning tree of the complete graph on n vertices in which the weight
+ * of the edge {i,j} is dist(i,j,data), using Prim's algorithm with time complexity O(n^2),
+ * store its edges to tree and their weights to weights (both in the order in which they
+ * were added), return false if dist returned a negative value */
+bool graphe::mst_finder::dense_tree(int n,double (*dist)(int,int,void*),void *data,ipairs &tree,dvector &weights) {
+    tree.clear();
+    weights.clear();
+    if (n<2)
+        return true;
+    tree.reserve(n-1);
+    weights.reserve(n-1);
+    ivector parent(n,-1),rest(n-1);
+    dvector key(n,DBL_MAX);
+    int c=0,v,k,best;
+    double d;
+    for (v=1;v<n;++v) {
+        rest[v-1]=v;
+    }
+    while (!rest.empty()) {
+        best=-1;
+        for (k=0;k<int(rest.size());++k) {
+            v=rest[k];
+            if ((d=dist(v,c,data))<0)
+                return false;
+            if (parent[v]<0 || d<key[v]) {
+                key[v]=d;
+                parent[v]=c;
             }
-            G->node(spur_node).set_subgraph(0);
-            t=next;
-        }
-        for (ivector_iter it=path.begin();it+1!=path.end();++it) {
-            G->node(*it).set_subgraph(1);
-        }
-        while (!removed_edges.empty()) {
-            i=removed_edges.top().first; j=removed_edges.top().second;
-            G->set_edge_attribute(i,j,_GT_ATTRIB_WEIGHT,W[i][j]);
-            removed_edges.pop();
+            if (best<0 || key[v]<key[rest[best]])
+                best=k;
         }
-        if (candidates.empty()) break;
-        cit=candidates.begin();
-        p=cit->second;
-        select_path(p);
-        candidates.erase(cit);
-    }
-    G->restore_subgraphs();
-    for (vector<tree_node*>::const_iterator it=kspaths.begin();it!=kspaths.end();++it) {
-        restore_path(*it,path);
-        paths.push_back(path);
+        c=rest[best];
+        tree.push_back(make_pair(parent[c],c));
+        weights.push_back(key[c]);
+        rest[best]=rest.back();
+        rest.pop_back();
     }
+    return true;
 }
 
 /*
- * END OF YEN CLASS
+ * END OF MINIMAL SPANNING FOREST
  */
 
-void graphe::yen_ksp(int K,int src,int dest,ivectors &paths) {
-    yen Y(this,src,dest,K);
-    Y.find_kspaths(paths);
-}
-
 /*
  * MM CLASS IMPLEMENTATION
  * Coded as described in lecture notes by Uri Zwick:
@@ -13749,142 +18957,515 @@ vecteur graphe::distances_from(int k) {
                 while ((j=node(j).ancestor())>=0) {
                     d+=1;
                 }
-                res[i]=d;
+                res[i]=d;
+            }
+        }
+    }
+    return res;
+}
+
+/* return the closeness centrality measure for k-th vertex,
+ * if k<0 return the list of HC measures for all vertices,
+ * if harmonic=true, return harmonic centrality */
+gen graphe::closeness_centrality(int k,bool harmonic) {
+    int n=node_count();
+    assert(n>1);
+    if (k>=0) assert(k<n);
+    vecteur hc(n,0);
+    if (k<0) {
+        /* the distances towards i-th vertex are in the i-th column */
+        matrice apd;
+        allpairs_distance(apd);
+        for (int i=0;i<n;++i) {
+            gen s(0);
+            for (int j=0;j<n;++j) {
+                if (j==i)
+                    continue;
+                const gen &d=apd[j][i];
+                if (harmonic)
+                    s+=is_inf(d)?gen(0):_inv(d,ctx);
+                else s+=d;
+            }
+            hc[i]=harmonic?s:gen(n-1)/s;
+        }
+        return hc;
+    }
+    graphe H(*this);
+    if (is_directed())
+        reverse(H);
+    vecteur dv=H.distances_from(k);
+    dv.erase(dv.begin()+k);
+    if (harmonic)
+        hc[k]=_sum(_apply(makesequence(at_inv,dv),ctx),ctx);
+    else
+        hc[k]=gen(n-1)/_sum(dv,ctx);
+    return hc[k];
+}
+
+/* return the list of betweenness centrality measures for all vertices
+ * using Brandes' algorithm */
+gen graphe::betweenness_centrality(int k) const {
+    int n=node_count();
+    assert(n>1 && (k<0 || k<n));
+    const csr_adjacency &A=adjacency_snapshot();
+    vecteur cb(n,0);
+    ivector sigma(n),d(n),S(n);
+    vecteur delta(n);
+    int head,tail,v,w,l;
+    for (int s=0;s<n;++s) {
+        for (int i=0;i<n;++i) {
+            sigma[i]=i==s?1:0;
+            d[i]=i==s?0:-1;
+            delta[i]=0;
+        }
+        /* BFS from s, S serves both as the queue and as the stack of visited vertices */
+        S[0]=s;
+        head=0;
+        tail=1;
+        while (head<tail) {
+            v=S[head++];
+            for (l=A.arc_begin(v);l<A.arc_end(v);++l) {
+                w=A.head(l);
+                if (d[w]<0) {
+                    S[tail++]=w;
+                    d[w]=d[v]+1;
+                }
+                if (d[w]==d[v]+1)
+                    sigma[w]+=sigma[v];
+            }
+        }
+        /* accumulate dependencies in order of nonincreasing distance from s,
+         * the predecessors of w are exactly those v with an arc v->w and d[w]=d[v]+1 */
+        while (tail>0) {
+            v=S[--tail];
+            for (l=A.arc_begin(v);l<A.arc_end(v);++l) {
+                w=A.head(l);
+                if (d[w]==d[v]+1)
+                    delta[v]+=gen(sigma[v])/gen(sigma[w])*(gen(1)+delta[w]);
+            }
+            if (v!=s)
+                cb[v]+=delta[v];
+        }
+    }
+    if (!is_directed())
+        cb=multvecteur(fraction(1,2),cb);
+    if (k>=0)
+        return cb[k];
+    return cb;
+}
+
+/* add the dependencies of the vertices on sources[begin],...,sources[end-1] to cb
+ * (Brandes' algorithm in floating-point arithmetic, A must be a valid snapshot) */
+void graphe::brandes_accumulate(const csr_adjacency &A,const ivector &sources,int begin,int end,dvector &cb) const {
+    int n=node_count(),head,tail,count,s,v,w,l;
+    ivector d(n,-1),S(n);
+    dvector sigma(n,0),delta(n,0);
+    for (int i=begin;i<end;++i) {
+        s=sources[i];
+        sigma[s]=1;
+        d[s]=0;
+        S[0]=s;
+        head=0;
+        tail=1;
+        while (head<tail) {
+            v=S[head++];
+            for (l=A.arc_begin(v);l<A.arc_end(v);++l) {
+                w=A.head(l);
+                if (d[w]<0) {
+                    S[tail++]=w;
+                    d[w]=d[v]+1;
+                }
+                if (d[w]==d[v]+1)
+                    sigma[w]+=sigma[v];
+            }
+        }
+        count=tail;
+        while (tail>0) {
+            v=S[--tail];
+            for (l=A.arc_begin(v);l<A.arc_end(v);++l) {
+                w=A.head(l);
+                if (d[w]==d[v]+1)
+                    delta[v]+=sigma[v]/sigma[w]*(1.0+delta[w]);
+            }
+            if (v!=s)
+                cb[v]+=delta[v];
+        }
+        /* reset only the vertices reached from s */
+        for (l=0;l<count;++l) {
+            v=S[l];
+            d[v]=-1;
+            sigma[v]=delta[v]=0;
+        }
+    }
+}
+
+/* thread routine for betweenness_centrality_approx */
+void *graphe::brandes_thread(void *arg) {
+    brandes_thread_data *data=static_cast<brandes_thread_data*>(arg);
+    data->G->brandes_accumulate(*data->A,*data->sources,data->begin,data->end,*data->cb);
+    return arg;
+}
+
+/* return the betweenness centrality of k-th vertex (or the list of centralities
+ * of all vertices if k<0) in floating-point arithmetic, distributing the sources
+ * among the available threads. If 0<samples<n, only that many randomly chosen
+ * sources are used and the sums of their dependencies are scaled by n/samples */
+gen graphe::betweenness_centrality_approx(int k,int samples) const {
+    int n=node_count(),nthreads,j;
+    assert(n>1 && (k<0 || k<n));
+    const csr_adjacency &A=adjacency_snapshot();
+    ivector sources;
+    if (samples>0 && samples<n) {
+        sources=rand_permu(n);
+        sources.resize(samples);
+    } else {
+        samples=n;
+        sources.resize(n);
+        for (int i=0;i<n;++i) sources[i]=i;
+    }
+    nthreads=std::min(max_threads(),samples);
+    vector<dvector> partial(nthreads,dvector(n,0));
+    vector<brandes_thread_data> data(nthreads);
+    vector<void*> args(nthreads);
+    for (j=0;j<nthreads;++j) {
+        brandes_thread_data &dt=data[j];
+        dt.G=this;
+        dt.A=&A;
+        dt.sources=&sources;
+        dt.begin=(j*samples)/nthreads;
+        dt.end=((j+1)*samples)/nthreads;
+        dt.cb=&partial[j];
+        args[j]=(void *)&dt;
+    }
+    run_threads(brandes_thread,args);
+    double scale=double(n)/double(samples);
+    if (!is_directed())
+        scale/=2.0;
+    vecteur cb(n);
+    for (int i=0;i<n;++i) {
+        double c=0;
+        for (j=0;j<nthreads;++j) c+=partial[j][i];
+        cb[i]=c*scale;
+    }
+    if (k>=0)
+        return cb[k];
+    return cb;
+}
+
+/*
+ * COMMUNICABILITY BETWEENNESS:
+ * for an undirected graph with adjacency matrix A, the communicability
+ * betweenness of a vertex r is the sum of G_prq/G_pq over all pairs p,q of
+ * distinct vertices different from r, where G=exp(A) and G_prq=G_pq-H_pq with
+ * H=exp(A-E(r)) (E(r) holds the r-th row and column of A). The sum equals
+ * the inner product <W,G-H> with W_pq=1/G_pq, restricted to the pairs above.
+ * Writing A=V*Lambda*V^T (a single dense eigendecomposition), A-E(r) becomes
+ * the rank-two modification T=Lambda-v*u^T-u*v^T of Lambda, where v is the
+ * r-th row of V and u=Lambda*v. The function exp is replaced by the rational
+ * Chebyshev approximation of exp(-x) on [0,inf) of type (14,14), so that
+ * exp(Lambda)-exp(T) is a sum of differences of resolvents, which are given
+ * by the Sherman-Morrison-Woodbury formula. Hence each vertex r requires only
+ * O(n^2) operations, once W is transformed to V^T*W*V. The vertices are
+ * distributed among the threads. Since the eigenvalues of A-s*I and T-s*I are
+ * nonpositive, where s is the largest eigenvalue of A, each entry of G-H is
+ * off by at most twice the error of the rational approximation. The error of
+ * the result is therefore bounded by this error times the sum of the entries
+ * of W, which is large when some G_pq is small. If the bound exceeds
+ * CBC_TOLERANCE times the largest computed centrality (or if the graph is
+ * directed), the columns of G and H are computed from the Taylor series with
+ * nonnegative terms, which keeps the relative errors of the entries small
+ * even if they are tiny. This takes O(n^2*m*K) time, where K is the number of
+ * the terms, and O(n) space per thread.
+ */
+
+/* coefficients and poles of the rational approximation of exp(-x) on [0,inf)
+ * in partial fractions, exp(-x) ~ cf_alpha0+Re(sum(cf_alpha[k]/(x-cf_theta[k]))) */
+static const double cf_alpha0=0.183216998528140087e-11;
+static const double cf_alpha[7][2]={
+    {0.557503973136501826e+02,-0.204295038779771857e+03},
+    {-0.938666838877006739e+02,0.912874896775456363e+02},
+    {0.469965415550370835e+02,-0.116167609985818103e+02},
+    {-0.961424200626061065e+01,-0.264195613880262669e+01},
+    {0.752722063978321642e+00,0.670367365566377770e+00},
+    {-0.188781253158648576e-01,-0.343696176445802414e-01},
+    {0.143086431411801849e-03,0.287221133228814096e-03}
+};
+static const double cf_error=3.2e-12; // maximal absolute error of the approximation
+static const double cf_theta[7][2]={
+    {-0.562314417475317895e+01,0.119406921611247440e+01},
+    {-0.508934679728216110e+01,0.358882439228376881e+01},
+    {-0.399337136365302569e+01,0.600483209099604664e+01},
+    {-0.226978543095856366e+01,0.846173881758693369e+01},
+    {0.208756929753827868e+00,0.109912615662209418e+02},
+    {0.370327340957595652e+01,0.136563731924991884e+02},
+    {0.889777151877331107e+01,0.166309842834712071e+02}
+};
+
+void *graphe::cbc_thread(void *arg) {
+    typedef std::complex<double> cplx;
+    cbc_thread_data *data=static_cast<cbc_thread_data*>(arg);
+    const dvector &V=*data->V,&lambda=*data->lambda,&W=*data->W,&Wt=*data->Wt;
+    int n=data->n,i,j,k,r;
+    double s=lambda.back();
+    dvector v(n),u(n),t(n);
+    vector<cplx> g1(n),g2(n),h1(n),h2(n);
+    cplx zeta,di,P11,P12,P22,F11,F12,F22,vg1,vg2,tg1,tg2,det,sum;
+    for (int l=data->begin;l<data->end;++l) {
+        r=data->vertices->at(l);
+        for (i=0;i<n;++i) {
+            v[i]=V[r*n+i];
+            u[i]=lambda[i]*v[i];
+        }
+        /* t=V^T*w, where w is the r-th column of W */
+        std::fill(t.begin(),t.end(),0.0);
+        for (j=0;j<n;++j) {
+            if (W[j*n+r]==0) continue;
+            for (i=0;i<n;++i) {
+                t[i]+=V[j*n+i]*W[j*n+r];
+            }
+        }
+        sum=0;
+        for (k=0;k<7;++k) {
+            zeta=cplx(s-cf_theta[k][0],-cf_theta[k][1]);
+            P11=P12=P22=vg1=vg2=tg1=tg2=0;
+            for (i=0;i<n;++i) {
+                di=1.0/(lambda[i]-zeta);
+                g1[i]=v[i]*di;
+                g2[i]=u[i]*di;
+                P11+=v[i]*g1[i];
+                P12+=v[i]*g2[i];
+                P22+=u[i]*g2[i];
+                tg1+=t[i]*g1[i];
+                tg2+=t[i]*g2[i];
+            }
+            vg1=P11;
+            vg2=P12;
+            /* h1=Wt*g1 and h2=Wt*g2 */
+            for (i=0;i<n;++i) {
+                cplx a1=0,a2=0;
+                const double *row=&Wt[i*n];
+                for (j=0;j<n;++j) {
+                    a1+=row[j]*g1[j];
+                    a2+=row[j]*g2[j];
+                }
+                h1[i]=a1;
+                h2[i]=a2;
+            }
+            F11=F12=F22=0;
+            for (i=0;i<n;++i) {
+                F11+=g1[i]*h1[i];
+                F12+=g1[i]*h2[i];
+                F22+=g2[i]*h2[i];
             }
+            /* remove the r-th row and column of W */
+            F11-=2.0*vg1*tg1;
+            F12-=vg1*tg2+tg1*vg2;
+            F22-=2.0*vg2*tg2;
+            /* M=(C+Y^T*D*Y)^(-1) with Y=[v,u] and C=[[0,-1],[-1,0]] */
+            P12-=1.0;
+            det=P11*P22-P12*P12;
+            sum+=cplx(cf_alpha[k][0],cf_alpha[k][1])*(P22*F11-2.0*P12*F12+P11*F22)/det;
         }
+        (*data->res)[r]=-sum.real();
     }
-    return res;
+    return NULL;
 }
 
-/* return the closeness centrality measure for k-th vertex,
- * if k<0 return the list of HC measures for all vertices,
- * if harmonic=true, return harmonic centrality */
-gen graphe::closeness_centrality(int k,bool harmonic) {
-    int n=node_count();
-    assert(n>1);
-    if (k>=0) assert(k<n);
-    vecteur hc(n,0);
-    if (is_weighted()) {
-        if (k>=0) {
-            graphe H(*this);
-            if (is_directed())
-                reverse(H);
-            vecteur pw=H.distances_from(k);
-            pw.erase(pw.begin()+k);
-            if (harmonic)
-                hc[k]=_sum(_apply(makesequence(at_inv,pw),ctx),ctx);
-            else
-                hc[k]=gen(n-1)/_sum(pw,ctx);
-        } else {
-            matrice apd;
-            allpairs_distance(apd);
-            if (harmonic) {
-                apd=*_apply(makesequence(at_inv,apd),ctx)._VECTptr;
-                hc=*_sum(apd,ctx)._VECTptr;
-            } else {
-                hc=*_sum(apd,ctx)._VECTptr;
-                hc=multvecteur(n-1,*_apply(makesequence(at_inv),ctx)._VECTptr);
+/* store the q-th column of exp(B) times 2^(-e) to s, where B is the adjacency matrix A
+ * with the r-th row and column removed (nothing is removed if r<0), the terms of the
+ * Taylor series are added until they are negligible in every entry, t and u are used
+ * as workspace */
+void graphe::exp_column(const csr_adjacency &A,int q,int r,dvector &s,dvector &t,dvector &u,int &e) {
+    int n=A.node_count(),i,l,k,support=1,prev;
+    double x,smax;
+    bool small;
+    s.assign(n,0);
+    t.assign(n,0);
+    u.resize(n);
+    s[q]=t[q]=1.0;
+    e=0;
+    for (k=1;;++k) {
+        for (i=0;i<n;++i) {
+            x=0;
+            if (i!=r) {
+                for (l=A.arc_begin(i);l<A.arc_end(i);++l) x+=t[A.head(l)];
             }
+            u[i]=x/k;
         }
-    } else {
-        graphe H(*this);
-        if (is_directed())
-            reverse(H);
-        for (int i=0;i<n;++i) {
-            if (k>=0 && i!=k)
-                continue;
-            vecteur dv=H.distances_from(i);
-            dv.erase(dv.begin()+i);
-            if (harmonic)
-                hc[i]=_sum(_apply(makesequence(at_inv,dv),ctx),ctx);
-            else
-                hc[i]=gen(n-1)/_sum(dv,ctx);
+        t.swap(u);
+        prev=support;
+        support=0;
+        small=true;
+        smax=0;
+        for (i=0;i<n;++i) {
+            s[i]+=t[i];
+            if (s[i]>0)
+                ++support;
+            if (t[i]>DBL_EPSILON*s[i])
+                small=false;
+            smax=std::max(smax,s[i]);
+        }
+        /* the support grows until all reachable vertices are found */
+        if (small && support==prev)
+            break;
+        if (smax>1e150) {
+            for (i=0;i<n;++i) {
+                s[i]=std::ldexp(s[i],-500);
+                t[i]=std::ldexp(t[i],-500);
+            }
+            e+=500;
         }
     }
-    if (k>=0)
-        return hc[k];
-    return hc;
 }
 
-/* return the list of betweenness centrality measures for all vertices
- * using Brandes' algorithm */
-gen graphe::betweenness_centrality(int k) const {
-    int n=node_count();
-    assert(n>1 && (k<0 || k<n));
-    vecteur cb(n,0);
-    std::stack<int> S;
-    std::queue<int> Q;
-    std::map<int,ivector> P;
-    ivector sigma(n),d(n);
-    vecteur delta(n);
-    for (int s=0;s<n;++s) {
-        P.clear();
-        for (int i=0;i<n;++i) {
-            sigma[i]=i==s?1:0;
-            d[i]=i==s?0:-1;
-            delta[i]=0;
-        }
-        Q.push(s);
-        while (!Q.empty()) {
-            int v=Q.front();
-            Q.pop();
-            S.push(v);
-            for (ivector_iter it=node(v).neighbors().begin();it!=node(v).neighbors().end();++it) {
-                int w=*it;
-                if (d[w]<0) {
-                    Q.push(w);
-                    d[w]=d[v]+1;
-                }
-                if (d[w]==d[v]+1) {
-                    sigma[w]+=sigma[v];
-                    P[w].push_back(v);
-                }
+/* add 1-H_pq/G_pq (see above) for all pairs p,q with q in the assigned range to the sums */
+void *graphe::cbc_exact_thread(void *arg) {
+    cbc_exact_thread_data *data=static_cast<cbc_exact_thread_data*>(arg);
+    const csr_adjacency &A=*data->A;
+    int n=A.node_count(),p,q,r,eg,eh;
+    dvector g,h,t,u;
+    double f;
+    data->res.assign(n,0);
+    data->stopped=false;
+    for (q=data->begin;q<data->end;++q) {
+        exp_column(A,q,-1,g,t,u,eg);
+        for (r=0;r<n;++r) {
+            if (r==q || (data->k>=0 && r!=data->k))
+                continue;
+            if (interrupted || ctrl_c) {
+                data->stopped=true;
+                return NULL;
             }
-        }
-        while (!S.empty()) {
-            int w=S.top();
-            S.pop();
-            for (ivector_iter it=P[w].begin();it!=P[w].end();++it) {
-                int v=*it;
-                delta[v]+=gen(sigma[v])/gen(sigma[w])*(gen(1)+delta[w]);
+            exp_column(A,q,r,h,t,u,eh);
+            f=std::ldexp(1.0,eh-eg);
+            for (p=0;p<n;++p) {
+                if (p!=q && p!=r && g[p]>0)
+                    data->res[r]+=1.0-f*h[p]/g[p];
             }
-            if (w!=s)
-                cb[w]+=delta[w];
         }
     }
-    if (!is_directed())
-        cb=multvecteur(fraction(1,2),cb);
-    if (k>=0)
-        return cb[k];
-    return cb;
+    return NULL;
 }
 
 /* return the list of communicability betweenness centrality for all vertices */
 gen graphe::communicability_betweenness_centrality(int k) const {
     int n=node_count();
-    matrice A;
-    vecteur row(n),col(n),res(n,0),nullvec(n,0);
-    adjacency_matrix(A);
-    matrice eA=*exp(_evalf(A,ctx),ctx)._VECTptr;
-    for (int r=0;r<n;++r) {
-        if (k>=0 && r!=k) continue;
-        row=*A[r]._VECTptr;
-        A[r]=nullvec;
-        matrice eAk=*exp(_evalf(A,ctx),ctx)._VECTptr;
-        for (int p=0;p<n;++p) {
-            if (p==r) continue;
-            for (int q=0;q<n;++q) {
-                if (q==p || q==r) continue;
-                res[r]+=1-eAk[p][q]/eA[p][q];
-            }
-        }
-        A[r]=row;
-    }
-    res=divvecteur(res,(n-1)*(n-2));
+    int i,j,l,nt;
+    double f,bound=DBL_MAX,vmax=0;
+    dvector V,U,lambda,e,W,Wt,val;
+    if (n<=2)
+        return k>=0?gen(0):gen(vecteur(n,0));
+    const csr_adjacency &A=adjacency_snapshot();
+    if (!is_directed()) {
+        V.assign(n*n,0);
+        W.resize(n*n);
+        for (i=0;i<n;++i) {
+            for (l=A.arc_begin(i);l<A.arc_end(i);++l) {
+                V[i*n+A.head(l)]=1;
+            }
+        }
+        householder_tridiagonalize(n,V,lambda,e);
+        if (!tridiagonal_ql(n,lambda,e,&V))
+            return generr(gettext("Eigendecomposition failed to converge"));
+        double s=lambda.back(),wsum=0;
+        /* W holds the reciprocals of off-diagonal entries of exp(A-s*I) */
+        U=V;
+        for (j=0;j<n;++j) {
+            f=std::exp((lambda[j]-s)/2);
+            for (i=0;i<n;++i) U[i*n+j]*=f;
+        }
+        for (i=0;i<n;++i) {
+            W[i*n+i]=0;
+            for (j=i+1;j<n;++j) {
+                f=0;
+                for (l=0;l<n;++l) f+=U[i*n+l]*U[j*n+l];
+                W[i*n+j]=W[j*n+i]=1.0/f;
+                wsum+=f>0?2.0/f:DBL_MAX;
+            }
+        }
+        bound=2.0*cf_error*wsum/((n-1.0)*(n-2.0));
+    }
+    ivector vertices;
     if (k>=0)
-        return res[k];
-    return res;
+        vertices.push_back(k);
+    else {
+        vertices.resize(n);
+        for (i=0;i<n;++i) vertices[i]=i;
+    }
+    val.assign(n,0);
+    if (bound<DBL_MAX) {
+        Wt.assign(n*n,0);
+        /* Wt=V^T*W*V */
+        dvector &WV=U;
+        std::fill(WV.begin(),WV.end(),0.0);
+        for (i=0;i<n;++i) {
+            for (l=0;l<n;++l) {
+                if ((f=W[i*n+l])==0) continue;
+                for (j=0;j<n;++j) WV[i*n+j]+=f*V[l*n+j];
+            }
+        }
+        for (l=0;l<n;++l) {
+            for (i=0;i<n;++i) {
+                f=V[l*n+i];
+                for (j=0;j<n;++j) Wt[i*n+j]+=f*WV[l*n+j];
+            }
+        }
+        nt=std::min(max_threads(),int(vertices.size()));
+        vector<cbc_thread_data> data(nt);
+        vector<void*> args(nt);
+        for (j=0;j<nt;++j) {
+            cbc_thread_data &dt=data[j];
+            dt.V=&V;
+            dt.lambda=&lambda;
+            dt.W=&W;
+            dt.Wt=&Wt;
+            dt.vertices=&vertices;
+            dt.n=n;
+            dt.begin=(j*int(vertices.size()))/nt;
+            dt.end=((j+1)*int(vertices.size()))/nt;
+            dt.res=&val;
+            args[j]=(void *)&dt;
+        }
+        run_threads(cbc_thread,args);
+        for (ivector_iter it=vertices.begin();it!=vertices.end();++it) {
+            vmax=std::max(vmax,std::abs(val[*it])/((n-1.0)*(n-2.0)));
+        }
+    }
+    if (bound>CBC_TOLERANCE*vmax) {
+        /* the error bound is too large or the graph is directed */
+        if (!is_directed())
+            message(1,"the fast approximation is not accurate enough, computing exactly");
+        nt=std::min(max_threads(),n);
+        vector<cbc_exact_thread_data> data(nt);
+        vector<void*> args(nt);
+        for (j=0;j<nt;++j) {
+            cbc_exact_thread_data &dt=data[j];
+            dt.A=&A;
+            dt.k=k;
+            dt.begin=(j*n)/nt;
+            dt.end=((j+1)*n)/nt;
+            args[j]=(void *)&dt;
+        }
+        run_threads(cbc_exact_thread,args);
+        std::fill(val.begin(),val.end(),0.0);
+        for (j=0;j<nt;++j) {
+            if (data[j].stopped)
+                throw std::runtime_error("Stopped by user interruption");
+            for (i=0;i<n;++i) val[i]+=data[j].res[i];
+        }
+    }
+    if (k>=0)
+        return val[k]/((n-1.0)*(n-2.0));
+    vecteur cbc(n);
+    for (i=0;i<n;++i) {
+        cbc[i]=val[i]/((n-1.0)*(n-2.0));
+    }
+    return cbc;
 }
+
+/*
+ * END OF COMMUNICABILITY BETWEENNESS
+ */
  
 /* return the list of Katz centrality measures for all vertices,
  * where att is attenuation factor */
@@ -13895,6 +19476,224 @@ vecteur graphe::katz_centrality(const gen &att) const {
     return *_sum(mtran(minv(midn(n)-mscale(att,mtran(A)),ctx)),ctx)._VECTptr;
 }
 
+/* compute the Katz centrality measures x=(I-att*A^T)^(-1)*1 in floating-point
+ * arithmetic, using the conjugate gradient method for undirected graphs (then
+ * I-att*A is symmetric and positive definite for att<1/lambda_max) and Jacobi
+ * iteration x <- 1+att*A^T*x for digraphs, return 1 on success, 0 if the
+ * iteration did not converge within maxiter steps and -1 if att is too large
+ * (not smaller than the reciprocal of the spectral radius of A) */
+int graphe::katz_centrality_approx(double att,dvector &x,double tol,int maxiter) const {
+    int n=node_count(),i,iter;
+    sparse_matrix M;
+    M.transposed_adjacency(adjacency_snapshot(),false);
+    dvector y(n);
+    if (!is_directed()) {
+        dvector r(n,1.0),p(n,1.0),q(n);
+        double rr=n,bb=n,pq,a,b,rr_new;
+        x.assign(n,0);
+        for (iter=0;iter<maxiter && rr>tol*tol*bb;++iter) {
+            M.multiply(p,y);
+            pq=0;
+            for (i=0;i<n;++i) {
+                q[i]=p[i]-att*y[i];
+                pq+=p[i]*q[i];
+            }
+            if (pq<=0)
+                return -1; // the matrix is not positive definite
+            a=rr/pq;
+            rr_new=0;
+            for (i=0;i<n;++i) {
+                x[i]+=a*p[i];
+                r[i]-=a*q[i];
+                rr_new+=r[i]*r[i];
+            }
+            b=rr_new/rr;
+            rr=rr_new;
+            for (i=0;i<n;++i) {
+                p[i]=r[i]+b*p[i];
+            }
+        }
+        return rr<=tol*tol*bb?1:0;
+    }
+    /* the changes shrink by the factor att*lambda_max in the limit, so they keep
+     * growing if the series diverges */
+    double d=DBL_MAX,d_prev,xmax;
+    x.assign(n,1.0);
+    for (iter=0;iter<maxiter;++iter) {
+        M.multiply(x,y);
+        d_prev=d;
+        d=xmax=0;
+        for (i=0;i<n;++i) {
+            y[i]=1.0+att*y[i];
+            d=std::max(d,std::abs(y[i]-x[i]));
+            xmax=std::max(xmax,std::abs(y[i]));
+        }
+        x.swap(y);
+        if (d<=tol*xmax)
+            return 1;
+        if (!(xmax<DBL_MAX))
+            return -1;
+    }
+    return d<d_prev?0:-1;
+}
+
+/* compute the PageRank of the vertices by power iteration, the transition
+ * probabilities being proportional to the arc weights if the graph is weighted
+ * (which must be nonnegative), the vertices with no outgoing arcs are linked
+ * to all vertices, return false if the iteration did not converge within
+ * maxiter steps */
+bool graphe::pagerank(double damping,dvector &x,double tol,int maxiter) const {
+    int n=node_count(),i,k;
+    bool weighted=is_weighted();
+    const csr_adjacency &A=adjacency_snapshot(weighted);
+    dvector s(n,0),y(n);
+    for (i=0;i<n;++i) {
+        for (k=A.arc_begin(i);k<A.arc_end(i);++k) {
+            s[i]+=A.weight(k);
+        }
+        if (s[i]>0)
+            s[i]=1.0/s[i];
+    }
+    sparse_matrix M;
+    M.transposed_adjacency(A,weighted);
+    M.scale_columns(s);
+    double dangling,c,d;
+    x.assign(n,1.0/n);
+    for (int iter=0;iter<maxiter;++iter) {
+        M.multiply(x,y);
+        dangling=0;
+        for (i=0;i<n;++i) {
+            if (s[i]==0)
+                dangling+=x[i];
+        }
+        c=(1.0-damping+damping*dangling)/n;
+        d=0;
+        for (i=0;i<n;++i) {
+            y[i]=damping*y[i]+c;
+            d+=std::abs(y[i]-x[i]);
+        }
+        x.swap(y);
+        if (d<=tol)
+            return true;
+    }
+    return false;
+}
+
+/* compute the eigenvector centrality by power iteration with I+A^T (the shift
+ * ensures convergence for bipartite graphs), using the arc weights if the graph
+ * is weighted, the result has unit Euclidean norm, return false if the
+ * iteration did not converge within maxiter steps */
+bool graphe::eigenvector_centrality(dvector &x,double tol,int maxiter) const {
+    int n=node_count(),i;
+    bool weighted=is_weighted();
+    sparse_matrix M;
+    M.transposed_adjacency(adjacency_snapshot(weighted),weighted);
+    dvector y(n);
+    double nrm,d;
+    x.assign(n,1.0/std::sqrt(double(n)));
+    for (int iter=0;iter<maxiter;++iter) {
+        M.multiply(x,y);
+        nrm=0;
+        for (i=0;i<n;++i) {
+            y[i]+=x[i];
+            nrm+=y[i]*y[i];
+        }
+        nrm=std::sqrt(nrm);
+        d=0;
+        for (i=0;i<n;++i) {
+            y[i]/=nrm;
+            d=std::max(d,std::abs(y[i]-x[i]));
+        }
+        x.swap(y);
+        if (d<=tol)
+            return true;
+    }
+    return false;
+}
+
+/* find the second smallest eigenpair of the Laplacian L of a connected graph by
+ * contracting a heavy-edge matching, solving the coarse problem recursively and
+ * refining the interpolated vector with Lanczos iteration (Barnard and Simon),
+ * return false if the iteration did not converge within maxiter products */
+bool graphe::multilevel_fiedler(const sparse_matrix &L,dvector &x,double &lambda,double tol,int maxiter) {
+    int n=L.size(),nc,i;
+    lanczos S(L);
+    S.deflate(dvector(n,1.0));
+    if (n>LANCZOS_DENSE_MAX) {
+        ivector agg;
+        nc=L.heavy_edge_matching(agg);
+        if (nc<0.8*n) {
+            sparse_matrix C;
+            L.galerkin_product(agg,nc,C);
+            dvector y;
+            double mu;
+            /* the coarse solution serves only as a starting vector */
+            if (!multilevel_fiedler(C,y,mu,std::max(tol,1e-4),maxiter))
+                return false;
+            x.resize(n);
+            for (i=0;i<n;++i) {
+                x[i]=y[agg[i]];
+            }
+            S.set_start(x);
+        }
+    }
+    dvector lam;
+    if (!S.eigenpairs(1,false,lam,&x,tol,maxiter))
+        return false;
+    lambda=lam.front();
+    return true;
+}
+
+/* compute k largest (k>0) or -k smallest (k<0) eigenvalues of the adjacency matrix
+ * (or the Seidel matrix J-I-2A if seidel=true) of an undirected graph by the Lanczos
+ * method, return false if the iteration did not converge within maxiter products */
+bool graphe::spectrum_approx(int k,bool seidel,dvector &lambda,double tol,int maxiter) const {
+    assert(!is_directed() && k!=0 && std::abs(k)<=node_count());
+    sparse_matrix M;
+    M.transposed_adjacency(adjacency_snapshot(),false);
+    lanczos S(M,seidel?-2:1,seidel?-1:0,seidel?1:0);
+    return S.eigenpairs(std::abs(k),k>0,lambda,NULL,tol,maxiter);
+}
+
+/* compute the Fiedler vector x (with unit norm) of an undirected graph and the
+ * algebraic connectivity lambda2, using the edge weights if the graph is weighted,
+ * return false if some weight is not a number or the iteration did not converge */
+bool graphe::fiedler_vector(dvector &x,double &lambda2,double tol,int maxiter) const {
+    assert(!is_directed() && node_count()>1);
+    bool weighted=is_weighted();
+    const csr_adjacency &A=adjacency_snapshot(weighted);
+    if (weighted && !A.has_numeric_weights())
+        return false;
+    sparse_matrix L;
+    L.laplacian(A,weighted);
+    return multilevel_fiedler(L,x,lambda2,tol,maxiter);
+}
+
+/* split the vertices of an undirected graph in two halves by the median of the
+ * Fiedler vector, return false if it could not be computed */
+bool graphe::spectral_bisection(ivector &part1,ivector &part2,double tol,int maxiter) const {
+    int n=node_count();
+    dvector x;
+    double lambda2;
+    if (!fiedler_vector(x,lambda2,tol,maxiter))
+        return false;
+    std::vector<std::pair<double,int> > order(n);
+    for (int i=0;i<n;++i) {
+        order[i]=std::make_pair(x[i],i);
+    }
+    std::sort(order.begin(),order.end());
+    part1.resize(n/2);
+    part2.resize(n-n/2);
+    for (int i=0;i<n;++i) {
+        if (i<n/2)
+            part1[i]=order[i].second;
+        else part2[i-n/2]=order[i].second;
+    }
+    std::sort(part1.begin(),part1.end());
+    std::sort(part2.begin(),part2.end());
+    return true;
+}
+
 /* returns the splittance of this graph */
 int graphe::splittance(int &m,ivector &vseq) const {
     assert(!is_directed() && !is_empty());
@@ -15155,252 +20954,380 @@ void graphe::find_simplicial_vertices(ivector &res) {
     }
 }
 
-/* SIP CLASS IMPLEMENTATION */
+/*
+ * VF2++ CLASS IMPLEMENTATION:
+ * subgraph isomorphisms are found by the algorithm of Juttner and Madarasi
+ * (VF2++). The pattern vertices are matched in an order obtained by BFS from
+ * the vertex with the rarest color, in which each level is sorted so that
+ * vertices with most connections to the already ordered ones come first.
+ * Candidates for a pattern vertex are then taken from the neighborhood of an
+ * already matched neighbor. Each pair is checked incrementally by using the
+ * counts of matched neighbors of target vertices. The candidates for the first
+ * pattern vertex are distributed over worker threads, unless the number of
+ * matches is limited (then the result would depend on the thread timing).
+ */
 
-/* constructor */
-graphe::sip::sip(const graphe &G,const graphe &P,int max_sg_in) {
-    N=G.node_count();
+graphe::vf2pp::vf2pp(const graphe &Gr,const graphe &P) {
+    G=&Gr;
+    N=G->node_count();
     n=P.node_count();
-    isom=(n==N && G.edge_count()==P.edge_count());
-    dir=G.is_directed();
+    dir=G->is_directed();
     assert(P.is_directed()==dir);
-    max_sg=max_sg_in;
-    /* initialize adjacency matrices (A is transposed) */
-    matrice PA;
-    P.adjacency_matrix(PA);
-    B.resize(n);
-    for (int i=0;i<n;++i) {
-        B[i].resize(n);
-        for (int j=0;j<n;++j) {
-            B[i][j]=giac::is_one(PA[i][j]);
+    m_adj=&G->adjacency_snapshot();
+    m_padj=&P.adjacency_snapshot();
+    int i,k;
+    g_color.resize(N);
+    for (i=0;i<N;++i) g_color[i]=G->get_node_color(i);
+    p_color.resize(n);
+    for (i=0;i<n;++i) p_color[i]=P.get_node_color(i);
+    if (dir) {
+        /* in-adjacency lists of the target graph */
+        g_in_offsets.assign(N+1,0);
+        for (k=0;k<m_adj->arc_count();++k) ++g_in_offsets[m_adj->head(k)+1];
+        for (i=0;i<N;++i) g_in_offsets[i+1]+=g_in_offsets[i];
+        g_in_targets.resize(m_adj->arc_count());
+        ivector pos(g_in_offsets.begin(),g_in_offsets.end()-1);
+        for (i=0;i<N;++i) {
+            for (k=m_adj->arc_begin(i);k<m_adj->arc_end(i);++k) {
+                g_in_targets[pos[m_adj->head(k)]++]=i;
+            }
+        }
+    }
+    m_found=NULL;
+    m_handler=NULL;
+    m_handler_data=NULL;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_init(&m_mutex,NULL);
+#endif
+    matching_order(P);
+}
+
+graphe::vf2pp::~vf2pp() {
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_destroy(&m_mutex);
+#endif
+}
+
+/* compute the matching order of pattern vertices and their matched neighbors at each position */
+void graphe::vf2pp::matching_order(const graphe &P) {
+    int i,j,k,u,r,best;
+    ivectors ngh(n),in_ngh(n);
+    ivector deg(n),conn(n,0),level,next;
+    bvector visited(n,false);
+    std::map<int,int> freq;
+    for (i=0;i<N;++i) ++freq[g_color[i]];
+    for (i=0;i<n;++i) {
+        for (k=m_padj->arc_begin(i);k<m_padj->arc_end(i);++k) {
+            j=m_padj->head(k);
+            ngh[i].push_back(j);
+            if (dir) {
+                ngh[j].push_back(i);
+                in_ngh[j].push_back(i);
+            }
         }
     }
-    used_cols.resize(N,false);
-    A.resize(N); AT.resize(N);
-    nb=N/SIP_NBITS;
-    if (N%SIP_NBITS) ++nb;
-    for (int i=0;i<N;++i) {
-        A[i].resize(nb);
-        AT[i].resize(nb);
-    }
-    for (int i=0;i<N;++i) {
-        const vertex &v=G.node(i);
-        for (ivector_iter it=v.neighbors().begin();it!=v.neighbors().end();++it) {
-            set_ij(A,*it,i,true);
-            set_ij(AT,i,*it,true);
+    p_in_degree.resize(n);
+    for (i=0;i<n;++i) {
+        deg[i]=ngh[i].size();
+        p_in_degree[i]=dir?in_ngh[i].size():deg[i];
+    }
+    m_order.clear();
+    m_order.reserve(n);
+    while (int(m_order.size())<n) {
+        /* start the next component from the vertex with the rarest color and the largest degree */
+        r=-1;
+        for (i=0;i<n;++i) {
+            if (visited[i])
+                continue;
+            if (r<0 || freq[p_color[i]]<freq[p_color[r]] ||
+                    (freq[p_color[i]]==freq[p_color[r]] && deg[i]>deg[r]))
+                r=i;
+        }
+        visited[r]=true;
+        level.assign(1,r);
+        while (!level.empty()) {
+            int first=m_order.size();
+            while (!level.empty()) {
+                best=0;
+                for (i=1;i<int(level.size());++i) {
+                    u=level[i];
+                    j=level[best];
+                    if (conn[u]>conn[j] || (conn[u]==conn[j] && (deg[u]>deg[j] ||
+                            (deg[u]==deg[j] && freq[p_color[u]]<freq[p_color[j]]))))
+                        best=i;
+                }
+                u=level[best];
+                level[best]=level.back();
+                level.pop_back();
+                m_order.push_back(u);
+                --freq[p_color[u]];
+                for (ivector_iter it=ngh[u].begin();it!=ngh[u].end();++it) ++conn[*it];
+            }
+            next.clear();
+            for (k=first;k<int(m_order.size());++k) {
+                const ivector &nu=ngh[m_order[k]];
+                for (ivector_iter it=nu.begin();it!=nu.end();++it) {
+                    if (!visited[*it]) {
+                        visited[*it]=true;
+                        next.push_back(*it);
+                    }
+                }
+            }
+            level.swap(next);
         }
     }
-    /* initialize M */
-    M.resize(n);
-    bool cond;
-    for (int i=0;i<n;++i) {
-        M[i].resize(nb);
-        for (int j=0;j<N;++j) {
-            if (isom) {
-                if (dir)
-                    cond=P.in_degree(i)==G.in_degree(j) && P.out_degree(i)==G.out_degree(j);
-                else cond=P.degree(i)==G.degree(j);
-            } else {
-                if (dir)
-                    cond=P.in_degree(i)<=G.in_degree(j) && P.out_degree(i)<=G.out_degree(j);
-                else cond=P.degree(i)<=G.degree(j);
-            }
-            set_ij(M,i,j,cond && P.get_node_color(i)==G.get_node_color(j));
+    m_position.resize(n);
+    for (k=0;k<n;++k) m_position[m_order[k]]=k;
+    m_pred_out.assign(n,ivector(0));
+    m_pred_in.assign(n,ivector(0));
+    for (k=0;k<n;++k) {
+        u=m_order[k];
+        for (i=m_padj->arc_begin(u);i<m_padj->arc_end(u);++i) {
+            if (m_position[j=m_padj->head(i)]<k)
+                m_pred_out[k].push_back(j);
+        }
+        for (ivector_iter it=in_ngh[u].begin();it!=in_ngh[u].end();++it) {
+            if (m_position[*it]<k)
+                m_pred_in[k].push_back(*it);
         }
     }
 }
 
-/* scalar product of r and c, it is assumed that r has exactly one 1 */
-bool graphe::sip::mult_bitrows(const bitrow &r,const bitrow &c) {
-    for (int i=0;i<N;++i) {
-        if (r[i].any())
-            return (r[i] & c[i]).any();
-    }
-    assert(false);
+/* return true iff the target vertex v has the color of the pattern vertex u and large enough degrees */
+bool graphe::vf2pp::is_candidate(int u,int v) const {
+    if (g_color[v]!=p_color[u] || m_adj->degree(v)<m_padj->degree(u))
+        return false;
+    return !dir || g_in_degree(v)>=p_in_degree[u];
 }
 
-/* fill row with zeros */
-void graphe::sip::clear_bitrow(bitrow &row) {
-    for (bitrow::iterator it=row.begin();it!=row.end();++it) {
-        it->reset();
+/* return true iff the k-th pattern vertex can be matched to the target vertex v */
+bool graphe::vf2pp::is_feasible(const worker_data &W,int k,int v) const {
+    int u=m_order[k];
+    if (W.core_g[v]>=0 || !is_candidate(u,v))
+        return false;
+    const ivector &po=m_pred_out[k],&pi=m_pred_in[k];
+    int no=po.size(),ni=pi.size();
+    /* the numbers of matched and unmatched neighbors */
+    if (m_induced) {
+        if (W.out_count[v]!=no || (dir && W.in_count[v]!=ni))
+            return false;
+    } else {
+        if (m_adj->degree(v)-W.out_count[v]<m_padj->degree(u)-no)
+            return false;
+        if (dir && g_in_degree(v)-W.in_count[v]<p_in_degree[u]-ni)
+            return false;
     }
-}
-
-/* check if M defines an isomorphism */
-bool graphe::sip::is_isomorphism() {
-    bitmatrix prod(n);
-    for (int i=0;i<n;++i) {
-        prod[i].resize(nb);
-        const bitrow &r=M[i];
-        for (int j=0;j<N;++j) {
-            if (mult_bitrows(r,A[j]))
-                set_ij(prod,i,j,true);
-        }
+    for (ivector_iter it=po.begin();it!=po.end();++it) {
+        if (m_adj->arc_index(v,W.core_p[*it])<0)
+            return false;
     }
-    for (int i=0;i<n;++i) {
-        const bitrow &r=M[i];
-        for (int j=0;j<n;++j) {
-            bool p=mult_bitrows(r,prod[j]),q=B[j][i];
-            if ((induced && p!=q) || (!induced && q && !p))
-                return false;
-        }
+    for (ivector_iter it=pi.begin();it!=pi.end();++it) {
+        if (m_adj->arc_index(W.core_p[*it],v)<0)
+            return false;
     }
     return true;
 }
 
-/* prune matrix M */
-void graphe::sip::prune() {
-    bool changed=true;
-    while (changed) {
-        changed=false;
-        for (int i=0;i<n;++i) {
-            for (int j=0;j<N;++j) {
-                if (get_ij(M,i,j)) {
-                    for (int c=0;c<n;++c) {
-                        const bitrow &r=AT[j],&s=A[j],&m=M[c];
-                        int k=0,sz=r.size();
-                        if (B[i][c]) {
-                            for (k=0;k<sz;++k) {
-                                if ((r[k] & m[k]).any())
-                                    break;
-                            }
-                        }
-                        if (dir && k<sz && B[c][i]) {
-                            for (k=0;k<sz;++k) {
-                                if ((s[k] & m[k]).any())
-                                    break;
-                            }
-                        }
-                        if (k==sz) {
-                            edit(i,j);
-                            changed=true;
-                            break;
-                        }
-                    }
-                }
-            }
+/* match (delta=1) or unmatch (delta=-1) the pattern vertex u and the target vertex v */
+void graphe::vf2pp::assign(worker_data &W,int u,int v,int delta) {
+    W.core_p[u]=delta>0?v:-1;
+    W.core_g[v]=delta>0?u:-1;
+    ivector &cnt=dir?W.in_count:W.out_count;
+    for (int k=m_adj->arc_begin(v);k<m_adj->arc_end(v);++k) {
+        cnt[m_adj->head(k)]+=delta;
+    }
+    if (dir) {
+        for (int k=g_in_offsets[v];k<g_in_offsets[v+1];++k) {
+            W.out_count[g_in_targets[k]]+=delta;
         }
     }
 }
 
-/* undo the last set of changes to M */
-void graphe::sip::revert_changes() {
-    const ipairs &ch=snapshots.top();
-    for (ipairs_iter it=ch.begin();it!=ch.end();++it) {
-        set_ij(M,it->first,it->second,true);
-    }
-    snapshots.pop();
+/* register the match W.core_p */
+void graphe::vf2pp::report(worker_data &W) {
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&m_mutex);
+#endif
+    if (!m_stop) {
+        ++m_count;
+        if (m_handler!=NULL) {
+            if (!m_handler(W.core_p,m_handler_data))
+                m_stop=true;
+        } else if (m_found!=NULL)
+            m_found->push_back(W.core_p);
+        if (m_limit>0 && m_count>=m_limit)
+            m_stop=true;
+    }
+    W.stop=m_stop;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&m_mutex);
+#endif
 }
 
-/* return true iff there is a zero-row in M */
-bool graphe::sip::M_has_empty_row() {
-    int k=0;
-    for (;k<n;++k) {
-        const bitrow &mr=M[k];
-        bitrow::const_iterator it=mr.begin();
-        for (;it!=mr.end();++it) {
-            if (it->any())
-                break;
-        }
-        if (it==mr.end())
-            break;
-    }
-    return k<n;
+/* check for termination, return false if the search should stop */
+bool graphe::vf2pp::refresh(worker_data &W) {
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&m_mutex);
+#endif
+    if (interrupted || ctrl_c)
+        m_stop=true;
+    W.stop=m_stop;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&m_mutex);
+#endif
+    W.steps=0;
+    return !W.stop;
 }
 
-/* main recursion procedure */
-bool graphe::sip::recurse(int i) {
-    if (i==n) {
-        if (is_isomorphism()) {
-            ivector sg(n);
-            for (int k=0;k<n;++k) {
-                int l=0;
-                for (;l<N;++l) {
-                    if (get_ij(M,k,l))
-                        break;
-                }
-                assert(l<N);
-                sg[k]=l;
-            }
-            found.push_back(sg);
+/* return the next candidate for the first pattern vertex or -1 if none is left */
+int graphe::vf2pp::next_root(worker_data &W) {
+    int v=-1;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&m_mutex);
+#endif
+    if (interrupted || ctrl_c)
+        m_stop=true;
+    if (!m_stop && m_next<int(m_roots.size()))
+        v=m_roots[m_next++];
+    W.stop=m_stop;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&m_mutex);
+#endif
+    return v;
+}
+
+/* try to match the k-th pattern vertex to v and continue with the next one */
+void graphe::vf2pp::extend(worker_data &W,int k,int v) {
+    if (!is_feasible(W,k,v))
+        return;
+    int u=m_order[k];
+    assign(W,u,v,1);
+    match(W,k+1);
+    assign(W,u,v,-1);
+}
+
+/* the recursive part of the algorithm, the first k pattern vertices are matched */
+void graphe::vf2pp::match(worker_data &W,int k) {
+    if (k==n) {
+        report(W);
+        return;
+    }
+    if (++W.steps>=VF2PP_REFRESH_STEPS && !refresh(W))
+        return;
+    /* take the candidates from the smallest neighborhood of an image of a matched neighbor */
+    const ivector &po=m_pred_out[k],&pi=m_pred_in[k];
+    int x=-1,d,mind=N+1,a;
+    bool in=false;
+    for (ivector_iter it=po.begin();it!=po.end();++it) {
+        if ((d=g_in_degree(W.core_p[*it]))<mind) {
+            mind=d;
+            x=W.core_p[*it];
+            in=dir;
+        }
+    }
+    for (ivector_iter it=pi.begin();it!=pi.end();++it) {
+        if ((d=m_adj->degree(W.core_p[*it]))<mind) {
+            mind=d;
+            x=W.core_p[*it];
+            in=false;
+        }
+    }
+    if (x<0) {
+        /* the pattern vertex starts a new component */
+        for (int v=0;v<N && !W.stop;++v) {
+            extend(W,k,v);
+        }
+    } else if (in) {
+        for (a=g_in_offsets[x];a<g_in_offsets[x+1] && !W.stop;++a) {
+            extend(W,k,g_in_targets[a]);
         }
     } else {
-        prune();
-        push_changes();
-        if (!M_has_empty_row()) {
-            bitrow row=M[i];
-            clear_bitrow(M[i]);
-            int res;
-            for (int j=0;j<N;++j) {
-                if (!get_j(row,j) || used_cols[j])
-                    continue;
-                set_ij(M,i,j,true);
-                /* filter */
-                for (bvector::const_iterator it=B[i].begin();it!=B[i].end();++it) {
-                    if (*it) {
-                        for (int a=0;a<N;++a) {
-                            if (!get_ij(AT,j,a) && get_ij(M,it-B[i].begin(),a))
-                                edit(it-B[i].begin(),a);
-                        }
-                    }
-                }
-                if (induced) {
-                    for (int a=0;a<N;++a) {
-                        if (get_ij(AT,j,a)) {
-                            for (bvector::const_iterator it=B[i].begin();it!=B[i].end();++it) {
-                                if (!*it && get_ij(M,it-B[i].begin(),a))
-                                    edit(it-B[i].begin(),a);
-                            }
-                        }
-                    }
-                }
-                push_changes();
-                /* recurse */
-                used_cols[j]=true;
-                res=recurse(i+1);
-                /* restore */
-                revert_changes();
-                used_cols[j]=false;
-                set_ij(M,i,j,false);
-                if (max_sg>0 && res==max_sg)
-                    break;
-            }
-            M[i]=row;
+        for (a=m_adj->arc_begin(x);a<m_adj->arc_end(x) && !W.stop;++a) {
+            extend(W,k,m_adj->head(a));
         }
-        revert_changes(); // revert pruning
     }
-    return found.size();
 }
 
-int graphe::sip::find_subgraphs(bool only_induced) {
-    found.clear();
-    while (!snapshots.empty()) snapshots.pop();
-    induced=only_induced;
-    if (M_has_empty_row())
+void *graphe::vf2pp::worker(void *arg) {
+    worker_data *W=static_cast<worker_data*>(arg);
+    vf2pp *M=W->matcher;
+    int u=M->m_order.front(),v;
+    while ((v=M->next_root(*W))>=0) {
+        M->assign(*W,u,v,1);
+        M->match(*W,1);
+        M->assign(*W,u,v,-1);
+    }
+    return NULL;
+}
+
+/* find subgraphs of the target graph isomorphic (induced or not) to the pattern,
+ * stop after limit matches (if limit>0) and return the number of matches, which are
+ * stored to found (if not NULL) in lexicographic order or passed one by one to handler
+ * (if not NULL, stop if it returns false). Each match is a list of target vertices,
+ * the i-th of which is the image of the i-th pattern vertex. */
+int graphe::vf2pp::find_subgraphs(bool only_induced,int limit,ivectors *found,match_handler handler,void *data,bool parallel) {
+    m_induced=only_induced;
+    m_limit=limit;
+    m_found=found;
+    m_handler=handler;
+    m_handler_data=data;
+    m_count=m_next=0;
+    m_stop=false;
+    if (found!=NULL)
+        found->clear();
+    if (n>N)
         return 0;
-    int res=recurse();
-    assert(snapshots.empty());
-    return res;
+    if (n==0) {
+        worker_data W;
+        report(W);
+        return m_count;
+    }
+    m_roots.clear();
+    for (int v=0;v<N;++v) {
+        if (is_candidate(m_order.front(),v))
+            m_roots.push_back(v);
+    }
+    /* with a limit, the threads would race for the first matches, which are
+     * therefore searched for sequentially to make the result deterministic */
+    int nt=parallel && limit<=0?std::min(max_threads(),std::max(1,int(m_roots.size())/VF2PP_PARALLEL_MIN_ROOTS)):1;
+    vector<worker_data> W(nt);
+    vector<void*> args(nt);
+    for (int j=0;j<nt;++j) {
+        worker_data &w=W[j];
+        w.matcher=this;
+        w.steps=0;
+        w.stop=false;
+        w.core_p.assign(n,-1);
+        w.core_g.assign(N,-1);
+        w.out_count.assign(N,0);
+        if (dir)
+            w.in_count.assign(N,0);
+        args[j]=(void*)&w;
+    }
+    run_threads(worker,args);
+    if (interrupted || ctrl_c)
+        throw std::runtime_error("Stopped by user interruption");
+    if (found!=NULL && handler==NULL)
+        std::sort(found->begin(),found->end());
+    return m_count;
 }
 
-/* END OF SIP CLASS */
+/*
+ * END OF VF2++ CLASS IMPLEMENTATION
+ */
+
+/* find at most max_sg (all if max_sg<=0) subgraphs of this graph isomorphic to P and
+ * store them to res, each subgraph is represented by the images of the vertices of P */
+void graphe::subgraph_isomorphism(const graphe &P,int max_sg,bool induced,ivectors &res,bool parallel) const {
+    vf2pp matcher(*this,P);
+    matcher.find_subgraphs(induced,max_sg,&res,NULL,NULL,parallel);
+}
 
-void graphe::subgraph_isomorphism(graphe &P,int max_sg,bool induced,ivectors &res) const {
-    int m=P.node_count();
-    graphe Q(ctx,P.supports_attributes());
-    ivector sigma;
-    P.sort_by_degrees(Q,sigma);
-    sip finder(*this,Q,max_sg);
-    int n=finder.find_subgraphs(induced);
-    res.resize(n);
-    ivector sg;
-    for (int i=0;i<n;++i) {
-        sg=finder.get_subgraph(i);
-        res[i].resize(m);
-        for (int j=0;j<m;++j) {
-            res[i][sigma[j]]=sg[j];
-        }
-    }
+/* pass at most max_sg (all if max_sg<=0) subgraphs of this graph isomorphic to P to handler,
+ * together with data, and return their number */
+int graphe::subgraph_isomorphism(const graphe &P,int max_sg,bool induced,match_handler handler,void *data,bool parallel) const {
+    vf2pp matcher(*this,P);
+    return matcher.find_subgraphs(induced,max_sg,NULL,handler,data,parallel);
 }
 
 /* Encode this graph as a Pruefer sequence <code>, return true iff it is a tree.
@@ -33,6 +33,7 @@
 #include <fstream>
 #include <queue>
 #include <stack>
+#include <list>
 #include <set>
 #include <bitset>
 #ifdef HAVE_LIBGLPK
@@ -51,7 +52,39 @@
 #define PLASTIC_NUMBER_2 1.75487766625
 #define PLASTIC_NUMBER_3 2.32471795724
 #define MARGIN_FACTOR 0.139680581996 // pow(PLASTIC_NUMBER,-7)
-#define SIP_NBITS 64
+#define FW_BLOCK_SIZE 64
+#define BH_THETA 1.2 // default opening angle for Barnes-Hut approximation
+#define BH_LEAF_SIZE 8
+#define BH_MAX_DEPTH 40
+#define BH_MIN_VERTICES 100
+#define SPMV_MIN_NONZEROS 65536 // sparse products with fewer nonzeros are computed sequentially
+#define CENTRALITY_TOLERANCE 1e-8 // default for iterative centrality solvers
+#define CENTRALITY_MAXITER 1000
+#define CBC_TOLERANCE 1e-6 // relative error bound for approximate communicability betweenness, otherwise exact
+#define LANCZOS_TOLERANCE 1e-8 // default relative residual of eigenpairs found by the Lanczos method
+#define LANCZOS_MAXITER 100000 // default maximal number of matrix-vector products in the Lanczos method
+#define LANCZOS_MIN_BASIS 40 // minimal number of Lanczos vectors kept in memory
+#define LANCZOS_DENSE_MAX 200 // eigenproblems of smaller order are solved by the dense solver
+#define LOUVAIN_TOLERANCE 1e-7 // minimal modularity gain of a local moving sweep
+#define LOUVAIN_MAX_SWEEPS 100 // maximal number of local moving sweeps per level
+#define LOUVAIN_PARALLEL_MIN 1024 // minimal number of vertices per thread in a local moving step
+#define TSP_CANDIDATES 8 // number of candidate neighbors of each city in the local tour search
+#define TSP_DENSE_MAX 2048 // distances between fewer cities are stored in a matrix
+#define TSP_LK_MAX_DEPTH 50 // maximal number of flips in a Lin-Kernighan move
+#define TSP_LK_BREADTH 5 // number of alternatives tried for the first flip of a Lin-Kernighan move
+#define TSP_KICK_LENGTH 50 // maximal segment length in a double-bridge kick
+#define MST_SORT_MAX 4096 // in filter-Kruskal, smaller sets of edges are sorted
+#define MST_PARALLEL_MIN 65536 // minimal number of edges per thread in filter-Kruskal
+#define TUTTE_CACHE_BUDGET 67108864 // memory available for caching Tutte polynomials (in bytes)
+#define TUTTE_PARALLEL_CUTOFF 24 // minors with fewer edges are processed by a single thread
+#define BK_PARALLEL_MIN_VERTICES 256 // minimal number of vertices per thread in clique enumeration
+#define TRIANGLE_GALLOP_RATIO 32 // intersect by galloping if one list is this many times longer
+#define TRIANGLE_MIN_ARCS 65536 // triangles in graphs with fewer edges are counted sequentially
+#define BBMC_MAX_VERTICES 16384 // maximum cliques in larger graphs are found without bitsets
+#define BBMC_PARALLEL_MIN_VERTICES 64 // maximum clique in smaller graphs is found by a single thread
+#define BBMC_REFRESH_STEPS 1024 // number of search steps after which a thread rereads the incumbent
+#define VF2PP_PARALLEL_MIN_ROOTS 64 // minimal number of root candidates per thread in subgraph matching
+#define VF2PP_REFRESH_STEPS 4096 // number of matching steps after which a thread checks for termination
 
 #ifndef NO_NAMESPACE_GIAC
 namespace giac {
@@ -92,7 +125,8 @@ enum gt_layout_style {
     _GT_STYLE_3D,
     _GT_STYLE_CIRCLE,
     _GT_STYLE_TREE,
-    _GT_STYLE_BIPARTITE
+    _GT_STYLE_BIPARTITE,
+    _GT_STYLE_SPECTRAL
 };
 
 enum gt_vertex_cover_algorithm {
@@ -102,6 +136,12 @@ enum gt_vertex_cover_algorithm {
     _GT_VC_EXACT
 };
 
+enum gt_clique_solver {
+    _GT_CLIQUE_AUTO, // bitsets unless the graph is very large
+    _GT_CLIQUE_BITSET,
+    _GT_CLIQUE_CLASSIC
+};
+
 enum gt_conn_check {
     _GT_CC_CONNECTED, // current subgraph is connected
     _GT_CC_COMPONENTS_ARE_SUBGRAPHS, // components are subgraphs with indices 1,2,...
@@ -153,10 +193,19 @@ public:
     typedef std::set<int> iset;
     typedef std::vector<bool> bvector;
     typedef std::vector<bvector> bvectors;
-    typedef std::vector<std::bitset<SIP_NBITS> > bitrow;
-    typedef std::vector<bitrow> bitmatrix;
+    typedef void (*clique_handler)(const ivector &clique,void *data);
+    typedef bool (*match_handler)(const ivector &match,void *data);
 
     class vertex { // vertex class
+        struct vertex_data { // adjacency and attributes, shared between copies until modified
+            int refcount; // updated atomically
+            attrib attributes;
+            ivector neighbors;
+            std::map<int,attrib> neighbor_attributes;
+            std::map<int,int> multiedges;
+            std::map<int,int> faces;
+            vertex_data() { refcount=1; }
+        };
         int m_subgraph;
         // used for traversing
         bool m_visited;
@@ -168,14 +217,13 @@ public:
         // used for planar embedding
         bool m_embedded;
         int m_number;
-        std::map<int,int> m_faces;
         // *
-        attrib *m_attributes;
-        ivector m_neighbors;
-        std::map<int,attrib> *m_neighbor_attributes;
-        std::map<int,int> m_multiedges;
+        bool m_supports_attributes;
+        vertex_data *m_data;
         void assign_defaults();
         void assign(const vertex &other);
+        void release();
+        vertex_data &data();
     public:
         vertex(bool support_attributes=true);
         vertex(const vertex &other);
@@ -183,9 +231,11 @@ public:
         ~vertex();
         vertex& operator =(const vertex &other);
         gen label() const;
-        bool supports_attributes() const { return m_attributes!=NULL; }
-        void unsupport_attributes() { m_attributes=NULL; m_neighbor_attributes=NULL; }
-        void set_label(const gen &s) { assert(supports_attributes()); (*m_attributes)[_GT_ATTRIB_LABEL]=s; }
+        bool supports_attributes() const { return m_supports_attributes; }
+        void unsupport_attributes();
+        bool is_shared() const { return m_data->refcount>1; }
+        void detach() { data(); }
+        void set_label(const gen &s) { assert(supports_attributes()); data().attributes[_GT_ATTRIB_LABEL]=s; }
         void set_subgraph(int s) { m_subgraph=s; }
         int subgraph() const { return m_subgraph; }
         void set_embedded(bool yes) { m_embedded=yes; }
@@ -205,30 +255,31 @@ public:
         int color() const { return m_color; }
         void set_leaf(bool yes) { m_leaf=yes; }
         bool is_leaf() const { return m_leaf; }
-        const attrib &attributes() const { assert(supports_attributes()); return *m_attributes; }
-        attrib &attributes() { assert(supports_attributes()); return *m_attributes; }
-        void set_attribute(int key,const gen &val) { assert(supports_attributes()); (*m_attributes)[key]=val; }
-        void set_attributes(const attrib &attr) { assert(supports_attributes()); copy_attributes(attr,*m_attributes); }
-        const ivector &neighbors() const { return m_neighbors; }
-        int degree() const { return m_neighbors.size(); }
+        const attrib &attributes() const { assert(supports_attributes()); return m_data->attributes; }
+        attrib &attributes() { assert(supports_attributes()); return data().attributes; }
+        void set_attribute(int key,const gen &val) { assert(supports_attributes()); data().attributes[key]=val; }
+        void set_attributes(const attrib &attr) { assert(supports_attributes()); copy_attributes(attr,data().attributes); }
+        const ivector &neighbors() const { return m_data->neighbors; }
+        int degree() const { return m_data->neighbors.size(); }
         void add_neighbor(int i,const attrib &attr=attrib());
+        void add_neighbors(const ivector &nb);
         bool is_temporary(int i) const;
         attrib &neighbor_attributes(int i);
         const attrib &neighbor_attributes(int i) const;
-        bool has_neighbor(int i) const { return binary_search(m_neighbors.begin(),m_neighbors.end(),i); }
+        bool has_neighbor(int i) const { return binary_search(m_data->neighbors.begin(),m_data->neighbors.end(),i); }
         void remove_neighbor(int i);
         void clear_neighbors();
         void map_neighbors(const std::map<int,int> &m);
         void incident_faces(ivector &F) const;
         void add_edge_face(int nb,int f);
-        void clear_edge_faces() { m_faces.clear(); }
-        int edge_face(int nb) { return m_faces[nb]-1; }
-        const std::map<int,int> &edge_faces() const { return m_faces; }
+        void clear_edge_faces() { if (!m_data->faces.empty()) data().faces.clear(); }
+        int edge_face(int nb) const;
+        const std::map<int,int> &edge_faces() const { return m_data->faces; }
         void set_multiedge(int v,int k);
         int multiedges(int v) const;
         int multiedge_count() const;
-        void clear_multiedges() { m_multiedges.clear(); }
-        bool has_multiedges() const { return !m_multiedges.empty(); }
+        void clear_multiedges() { if (!m_data->multiedges.empty()) data().multiedges.clear(); }
+        bool has_multiedges() const { return !m_data->multiedges.empty(); }
     };
 
     class dotgraph { // temporary structure used in dot parsing
@@ -316,6 +367,8 @@ public:
         void heur_solution(glp_tree *tree);
     };
 
+    class tsp_heuristic;
+
     class tsp { // traveling salesman
         struct arc {
             /* arc struct holds only the edge information relevant for TSP */
@@ -335,14 +388,15 @@ public:
         };
         graphe *G;
         glp_prob *mip;
-        bool isweighted,*visited,is_symmetric_tsp,verbose,cancellable;
+        bool isweighted,*visited,is_symmetric_tsp,verbose,send_incumbent;
         std::set<ivector> subtours;
-        ivector tour,old_sol;
+        ivector tour,old_sol,incumbent;
+        tsp_heuristic *heuristic;
         double *coeff,gap_tol;
         arc *arcs;
         int *indices,nv,ne,heur_type;
         solution_status status;
-        std::map<int,std::map<int,double> > weight_map,rlx_sol_map;
+        std::map<int,std::map<int,double> > rlx_sol_map;
         std::map<int,std::map<int,int> > loc_map;
         dvector xev,obj;
         bvector can_branch;
@@ -358,11 +412,7 @@ public:
         double weight(int i,int j);
         double weight(const ipair &e) { return weight(e.first,e.second); }
         double lower_bound();
-        bool is_move_feasible(int k,const ivector &t,const ipairs &x);
-        bool lin_kernighan(ivector &hc);
-        bool perform_3opt_moves(ivector &hc);
-        void straighten(ivector &hc);
-        void improve_tour(ivector &hc,bool do_3opt=true);
+        void improve_tour(ivector &hc);
         void farthest_insertion(int index,ivector &hc);
         bool christofides(ivector &hc,bool show_progress=false);
         static void sample_mean_stddev(const dvector &sample,double &mean,double &stddev);
@@ -384,11 +434,10 @@ public:
         int minimal_cut(int nn,int nedg,const ivector &beg,
                         const ivector &end,const ivector &cap,ivector &cut);
     public:
-        tsp(graphe *gr,double gap_tolerance=0,bool is_verbose=false);
+        tsp(graphe *gr,double gap_tolerance=0,bool is_verbose=false,const layout *x=NULL);
         ~tsp();
         int solve(int k,ivectors &hcv,dvector &costs);
         int solve(ivector &hc,double &cost);
-        bool approx(ivector &hc,double &ratio);
         double tour_cost(const ivector &hc);
     };
     
@@ -467,37 +516,30 @@ public:
         layout *get_layout() const { return L; }
     };
 
-    class cpol {
-        void assign(const cpol &other);
-    public:
-        int nv;
-#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
-        ulong *cg;
-        int *col;
-#else
-        int *adj;
-#endif
-        size_t sz;
-        int frq;
-        intpoly poly;
-#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
-        cpol() { nv=0; cg=NULL; col=NULL; sz=0; frq=0; }
-#else
-        cpol() { nv=0; adj=NULL; sz=0; frq=0; }
-#endif
-#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
-        cpol(int n,ulong *g,int *c,size_t s,const intpoly &p);
-#else
-        cpol(int n,int *a,size_t s,const intpoly &p);
-#endif
-        cpol(const cpol &other);
-        ~cpol() { }
-        cpol& operator =(const cpol &other);
-#if defined HAVE_LIBNAUTY && defined HAVE_NAUTY_NAUTUTIL_H
-        bool match(int n,ulong *g,int *c) const;
-#else
-        bool match(int n,int *a,int adj_sz) const;
+    class poly_cache { // LRU cache of Tutte polynomials of graphs, keyed by their canonical forms
+        struct entry {
+            ulong hash;
+            std::vector<ulong> key;
+            intpoly poly;
+            size_t bytes;
+        };
+        typedef std::list<entry> entry_list;
+        entry_list m_lru; // the most recently used entries come first
+        std::map<ulong,std::vector<entry_list::iterator> > m_index;
+        size_t m_bytes,m_budget;
+#ifdef HAVE_LIBPTHREAD
+        pthread_mutex_t m_mutex; // the cache is shared by the threads computing Tutte polynomials
 #endif
+        static ulong hash(const std::vector<ulong> &key);
+        void unindex(const entry_list::iterator &it);
+    public:
+        poly_cache(size_t budget);
+        ~poly_cache();
+        bool find(const std::vector<ulong> &key,intpoly &p);
+        void insert(const std::vector<ulong> &key,const intpoly &p);
+        void clear();
+        int size() const { return m_lru.size(); }
+        size_t memory_usage() const { return m_bytes; }
     };
 
     class ransampl { // random sampling from a given degree distribution
@@ -543,6 +585,226 @@ public:
         void clear();
     };
 
+    class csr_adjacency { // read-only compressed sparse row snapshot of the adjacency lists
+        int n;
+        bool m_valid,m_weighted,m_numeric,m_integral,m_exact;
+        ivector m_offsets,m_targets;
+        dvector m_weights;
+    public:
+        csr_adjacency() { n=0; m_valid=m_weighted=false; m_numeric=m_integral=m_exact=true; }
+        void build(const graphe &G,bool with_weights=false);
+        void invalidate();
+        bool is_valid() const { return m_valid; }
+        bool has_weights() const { return m_weighted; }
+        bool has_numeric_weights() const { return m_numeric; }
+        bool has_integral_weights() const { return m_integral; }
+        bool has_exact_weights() const { return m_exact; }
+        int node_count() const { return n; }
+        int arc_count() const { return m_targets.size(); }
+        int arc_begin(int i) const { return m_offsets[i]; }
+        int arc_end(int i) const { return m_offsets[i+1]; }
+        int degree(int i) const { return m_offsets[i+1]-m_offsets[i]; }
+        int head(int k) const { return m_targets[k]; }
+        double weight(int k) const { return m_weighted?m_weights[k]:1.0; }
+        int arc_index(int i,int j) const;
+    };
+
+    class label_index { // hash table mapping vertex labels to vertex indices
+        int m_count;
+        bool m_valid;
+        std::vector<ivector> m_buckets;
+        static unsigned hash(const gen &lab);
+        static unsigned hash_double(double d);
+        void rehash(const graphe &G,int nbuckets);
+    public:
+        label_index() { m_count=0; m_valid=false; }
+        void build(const graphe &G);
+        void invalidate();
+        bool is_valid() const { return m_valid; }
+        int find(const graphe &G,const gen &lab) const;
+        void insert(const graphe &G,int i);
+    };
+
+    class dary_heap { // 4-ary min-heap of vertices keyed by doubles, with decrease-key
+        ivector m_heap,m_pos;
+        dvector m_key;
+        void sift_up(int p);
+        void sift_down(int p);
+    public:
+        dary_heap(int n) { m_pos.resize(n,-1); m_key.resize(n,0); }
+        bool empty() const { return m_heap.empty(); }
+        bool contains(int i) const { return m_pos[i]>=0; }
+        int top() const { return m_heap.front(); }
+        double top_key() const { return m_key[m_heap.front()]; }
+        void push(int i,double key);
+        int pop();
+        void clear();
+    };
+
+    class dfs_walker { // iterative depth-first traversal which reports its events one by one
+    public:
+        enum event_type { DISCOVER, TREE_ARC, NONTREE_ARC, RETURN, FINISH, DONE };
+    private:
+        graphe *G;
+        const csr_adjacency *A;
+        int m_sg,m_pending,m_returned;
+        bool m_skip_embedded;
+        ivector m_vertices,m_arcs; // the explicit stack of vertices and their next arcs
+    public:
+        dfs_walker(graphe *gr,int sg=-1,bool skip_embedded=false);
+        void start(int root);
+        event_type next(int &v,int &w);
+    };
+
+    class lr_planarity { // left-right planarity test of Brandes with construction of a rotation system
+        struct interval {
+            int low,high; // return edges, -1 if none
+            interval() { low=high=-1; }
+            bool empty() const { return low<0 && high<0; }
+        };
+        struct conflict_pair {
+            interval left,right;
+            void swap() { std::swap(left,right); }
+        };
+        struct nesting_comparator {
+            const ivector *depth;
+            nesting_comparator(const ivector &d) { depth=&d; }
+            bool operator()(int a,int b) const { return (*depth)[a]<(*depth)[b]; }
+        };
+        int n,m;
+        ivector m_offsets,m_heads,m_tails,m_twin; // half-edges, m_twin[h] is the reverse of h
+        ivector m_height,m_parent,m_roots,m_out,m_out_offsets,m_position;
+        ivector m_lowpt,m_lowpt2,m_nesting,m_ref,m_side,m_lowpt_edge,m_stack_bottom;
+        ivector m_cw,m_ccw,m_first,m_left_ref,m_right_ref;
+        std::vector<bool> m_oriented,m_visited;
+        std::vector<conflict_pair> m_stack;
+        bool conflicting(const interval &I,int b) const { return !I.empty() && m_lowpt[I.high]>m_lowpt[b]; }
+        int lowest(const conflict_pair &P) const;
+        void orient(int root);
+        void sort_out_edges();
+        bool test(int root);
+        bool add_constraints(int ei,int e);
+        void remove_back_edges(int e);
+        int sign(int e);
+        void add_half_edge_cw(int v,int h,int ref);
+        void add_half_edge_ccw(int v,int h,int ref);
+        void embed(int root);
+    public:
+        lr_planarity(int nv,const ipairs &edges);
+        bool is_planar(bool embedding=false);
+        void rotation_system(ivectors &rot) const;
+        void faces(ivectors &F) const;
+    };
+
+    class barnes_hut { // quadtree (2D) or octree (3D) for approximating repulsive forces
+        struct cell {
+            double center[3],half,cm[3];
+            int mass,lo,hi,child,parent; // points lo..hi-1 (in tree order), children child..child+2^d-1
+        };
+        int dim,nch;
+        double theta2;
+        dvector m_pos[3]; // point coordinates in tree order
+        ivector m_index,m_slot,m_leaf,m_octant,m_tmp_index; // m_slot is the inverse of m_index
+        dvector m_tmp_pos;
+        std::vector<cell> m_cells;
+        void subdivide(int c,int depth);
+    public:
+        barnes_hut(int d,double theta);
+        void build(const dvector &x,int n);
+        void move(int i,const double *p);
+        int repulsive_force(int i,const double *p,double D,double R,double *force) const;
+    };
+
+    class sparse_matrix { // square matrix of doubles in compressed sparse row format
+        struct product_data {
+            const sparse_matrix *M;
+            const dvector *x;
+            dvector *y;
+            int begin,end;
+        };
+        int n;
+        ivector m_offsets,m_columns;
+        dvector m_values;
+        static void *product_thread(void *arg);
+        void multiply_rows(const dvector &x,dvector &y,int begin,int end) const;
+    public:
+        sparse_matrix() { n=0; }
+        void transposed_adjacency(const csr_adjacency &A,bool weighted);
+        void scale_columns(const dvector &s);
+        void laplacian(const csr_adjacency &A,bool weighted,bool normalized=false);
+        int heavy_edge_matching(ivector &agg) const;
+        void galerkin_product(const ivector &agg,int nc,sparse_matrix &C) const;
+        int size() const { return n; }
+        int nonzeros() const { return m_columns.size(); }
+        void multiply(const dvector &x,dvector &y) const;
+    };
+
+    class lanczos { // thick-restart Lanczos method for extremal eigenpairs of a*M+b*I+c*J, M sparse symmetric
+        const sparse_matrix *M;
+        int n,m_deflated_count;
+        double m_a,m_b,m_c,m_sign,m_norm;
+        ulong m_seed;
+        dvector m_deflated; // orthonormal vectors spanning the excluded subspace, stored one after another
+        dvector m_start;
+        void apply(const dvector &x,dvector &y) const;
+        void random_vector(dvector &v);
+        double orthogonalize(dvector &w,const dvector &V,int k,dvector &h) const;
+        bool dense_eigenpairs(int k,dvector &lambda,dvector *X) const;
+        bool restarted_lanczos(int k,dvector &lambda,dvector &X,double tol,int maxiter,int &iter);
+    public:
+        lanczos(const sparse_matrix &mat,double a=1,double b=0,double c=0);
+        void deflate(const dvector &v);
+        void set_start(const dvector &v) { m_start=v; }
+        bool eigenpairs(int k,bool largest,dvector &lambda,dvector *X,double tol=LANCZOS_TOLERANCE,int maxiter=LANCZOS_MAXITER);
+    };
+
+    class laplacian_minor { // reduced Laplacian (one vertex removed per component) with a sparse LDL' factorization in a fill-reducing order
+        int n;
+        ivector m_offsets,m_rows; // the symmetric matrix by columns, both triangles are stored
+        dvector m_values;
+        ivector m_perm,m_iperm,m_parent,m_lp; // elimination order, its inverse, elimination tree and column pointers of L
+        void minimum_degree_ordering();
+        void symbolic_factorization();
+    public:
+        laplacian_minor(const csr_adjacency &A,bool weighted);
+        int size() const { return n; }
+        double log2_bound() const;
+        bool determinant_mod(int p,int &det) const;
+        bool log_determinant(double &res) const;
+    };
+
+    class flow_network { // residual network with flat arc arrays for maximum flow computations
+        int n;
+        bool m_unit;
+        double m_eps;
+        ivector m_tail,m_head,m_first,m_reverse,m_position;
+        dvector m_capacity,m_residual;
+        // workspace
+        ivector m_label,m_current,m_count;
+        dvector m_excess;
+        ivectors m_active;
+        int m_max_active;
+        void global_relabel(int s,int t);
+        void activate(int v);
+        void gap(int k);
+        void discharge(int v,int s,int t,long &work);
+        void return_excess(int s,int t);
+        bool dinic_levels(int s,int t);
+        double dinic_augment(int s,int t);
+    public:
+        flow_network(int nv);
+        int add_arc(int i,int j,double cap,double rcap=0);
+        void build();
+        void reset();
+        int node_count() const { return n; }
+        bool has_unit_capacities() const { return m_unit; }
+        double push_relabel(int s,int t);
+        double dinic(int s,int t);
+        double max_flow(int s,int t) { return m_unit?dinic(s,t):push_relabel(s,t); }
+        double flow(int k) const;
+        void source_side(int s,bvector &side) const;
+    };
+
     class ostergard { // clique maximizer
         graphe *G;
         int maxsize;
@@ -556,6 +818,69 @@ public:
         int maxclique(ivector &clique);
     };
 
+    class bron_kerbosch { // maximal clique enumeration with degeneracy ordering and bitsets
+        struct worker_data {
+            bron_kerbosch *bk;
+            std::map<int,int> stats;
+            ivectors cliques;
+            ivector local,index,R;
+            int words;
+            std::vector<ulong> adj,stack;
+        };
+        const graphe *G;
+        int n,m_next;
+        ivector m_order,m_position;
+        ivectors *m_cliques;
+        clique_handler m_handler;
+        void *m_handler_data;
+#ifdef HAVE_LIBPTHREAD
+        pthread_mutex_t m_mutex;
+#endif
+        void degeneracy_order();
+        int next_vertex();
+        void process_vertex(worker_data &W,int v);
+        void expand(worker_data &W,ulong *P,ulong *X);
+        void report(worker_data &W);
+        static void *worker(void *arg);
+    public:
+        bron_kerbosch(const graphe *gr);
+        ~bron_kerbosch();
+        void enumerate(std::map<int,int> &stats,ivectors *cliques,clique_handler handler=NULL,void *data=NULL,bool parallel=true);
+    };
+
+    class bbmc { // bit-parallel branch-and-bound maximum clique solver
+        struct worker_data {
+            bbmc *solver;
+            int best,steps;
+            bool stop;
+            ivector C;
+            ivectors U,colors;
+            std::vector<ulong> stack,classes,Q,R;
+        };
+        const graphe *G;
+        bool m_complement,m_stop;
+        int n,m_words,m_next,m_best,m_bound;
+        ivector m_order,m_clique,m_root,m_root_colors,m_root_position;
+        std::vector<ulong> m_adj;
+#ifdef HAVE_LIBPTHREAD
+        pthread_mutex_t m_mutex;
+#endif
+        const ulong *row(int v) const { return &m_adj[v*m_words]; }
+        void make_adjacency();
+        void initial_clique();
+        int color_sort(worker_data &W,const ulong *P,int kmin,ivector &U,ivector &colors);
+        bool renumber(worker_data &W,int v,int kmin);
+        void expand(worker_data &W,ulong *P);
+        void update_incumbent(worker_data &W);
+        bool refresh(worker_data &W);
+        int next_root(worker_data &W);
+        static void *worker(void *arg);
+    public:
+        bbmc(const graphe *gr,bool complement=false);
+        ~bbmc();
+        int maxclique(ivector &clique,bool parallel=true);
+    };
+
     class yen { // Yen's k shortest paths algorithm
         typedef struct tree_node {
             int i;
@@ -585,6 +910,168 @@ public:
         void find_kspaths(ivectors &paths);
     };
 
+    class louvain { // community detection by modularity maximization, with parallel local moving, refinement and aggregation
+        struct level_graph { // weighted graph with loops, the vertices of which are the communities of the previous level
+            int n;
+            ivector offsets,targets;
+            dvector weights,loops,degrees;
+        };
+        struct worker_data { // vertices of the current color class assigned to a thread
+            louvain *L;
+            int begin,end;
+            dvector acc; // weights of arcs to the neighboring communities
+            ivector touched;
+        };
+        double m_gamma,m_total; // resolution and the sum of degrees
+        level_graph m_graph;
+        ivector m_community,m_target;
+        dvector m_tot; // the sum of degrees in each community
+        const ivector *m_class;
+        void color_classes(ivectors &classes) const;
+        void best_moves(worker_data &W);
+        static void *worker(void *arg);
+        double level_modularity() const;
+        bool local_moving();
+        int refine(ivector &partition) const;
+        void aggregate(const ivector &partition,int count);
+    public:
+        louvain(const csr_adjacency &A,bool weighted,double gamma=1.0);
+        int find_communities(ivector &community);
+        static double modularity(const csr_adjacency &A,bool weighted,const ivector &community,double gamma=1.0);
+    };
+
+    class ksp_finder { // Yen's k shortest paths with floating-point weights and parallel A* spur searches
+        struct worker_data { // workspace of a thread computing spur paths
+            ksp_finder *F;
+            int index,stamp;
+            dary_heap Q;
+            dvector g;
+            ivector parent,mark,touched;
+            worker_data(int n) : Q(n) { g.resize(n,DBL_MAX); parent.resize(n,-1); mark.resize(n,0); stamp=0; }
+        };
+        const csr_adjacency *A;
+        int n,src,dest,K,m_threads;
+        dvector m_h; // distances to the destination, used as a consistent heuristic
+        ivector m_next; // successors in the reverse shortest path tree
+        ivectors m_trie_children; // prefix tree of the selected paths
+        ivector m_trie_vertex;
+        ivectors m_selected,m_candidates;
+        std::vector<std::pair<double,int> > m_heap; // binary min-heap of candidate costs and indices
+        std::set<ivector> m_seen;
+        double m_bound; // no candidate costlier than this is needed
+        // the current iteration
+        const ivector *m_path;
+        dvector m_root_cost;
+        ivectors m_blocked;
+        ivectors m_spur;
+        dvector m_spur_cost;
+        double arc_weight(int i,int j) const;
+        void reverse_tree();
+        void add_to_trie(const ivector &path);
+        void spur_search(worker_data &W,int i);
+        static void *worker(void *arg);
+        void prune_candidates(int needed);
+    public:
+        ksp_finder(const csr_adjacency &adj,int s,int d,int k);
+        void find_kspaths(ivectors &paths);
+    };
+
+    class tsp_heuristic { // multi-start chained Lin-Kernighan search with candidate lists and Or-opt moves
+        struct worker_data { // tour and workspace of an independent search
+            tsp_heuristic *H;
+            ulong seed;
+            int kicks,qhead,qsize;
+            const ivector *start;
+            ivector tour,pos,queue,journal; // the journal records flips as quadruples of cities
+            bvector queued;
+            ipairs added;
+            double cost;
+            bool stopped; // interrupted by the user
+            bool expired; // the time limit is exceeded
+        };
+        struct kd_comparator { // compares Euclidean cities by a coordinate
+            const double *coords;
+            int dim,axis;
+            kd_comparator(const double *c,int d,int a) { coords=c; dim=d; axis=a; }
+            bool operator()(int i,int j) const { return coords[i*dim+axis]<coords[j*dim+axis]; }
+        };
+        csr_adjacency A; // a copy, since the graph may be modified during the search
+        int n,m_threads;
+        dvector m_matrix; // distances between all pairs of cities, if n is small
+        dvector m_coords; // coordinates of Euclidean cities
+        int m_dim;
+        ivector m_kdtree; // Euclidean cities as an implicit k-d tree, the root of [lo,hi) is at (lo+hi)/2
+        ivector m_kdpos; // the position of each city in m_kdtree
+        ivector m_kdsize; // the size of the subtree rooted at each position
+        double m_penalty; // the cost of a missing edge, larger than the cost of any tour
+        double m_feasible_bound; // the tours with missing edges cost at least this much
+        double m_eps;
+        ivectors m_cand;
+        double m_time_limit;
+        double m_start_time; // wall clock time in seconds
+        int rand_int(worker_data &W,int k) const;
+        int succ(const worker_data &W,int v) const { return W.tour[(W.pos[v]+1)%n]; }
+        int pred(const worker_data &W,int v) const { return W.tour[(W.pos[v]+n-1)%n]; }
+        int next(const worker_data &W,int v,bool fwd) const { return fwd?succ(W,v):pred(W,v); }
+        void init_euclidean(const layout &x);
+        void kd_build(int lo,int hi,int depth);
+        void kd_nearest(const double *p,int lo,int hi,int depth,int k,int self,std::vector<std::pair<double,int> > &heap) const;
+        void kd_nearest_unvisited(const double *p,int lo,int hi,int depth,const ivector &where,const ivector &sizes,double &min_d,int &v) const;
+        void kd_remove(int v,ivector &sizes) const;
+        void make_candidates();
+        void reverse_path(worker_data &W,int i,int j);
+        void flip(worker_data &W,int a,int b,int c,int d);
+        void undo(worker_data &W,int mark);
+        void activate(worker_data &W,int v);
+        void activate_journal(worker_data &W,int from,int to);
+        double lk_chain(worker_data &W,int t1,int t2,int t3,int &best_mark);
+        bool lk_move(worker_data &W,int t1);
+        bool or_move(worker_data &W,int s1);
+        void local_search(worker_data &W);
+        void kick(worker_data &W);
+        void initial_tour(worker_data &W);
+        void init_worker(worker_data &W,const ivector &hc);
+        bool out_of_time() const;
+        static void *worker(void *arg);
+    public:
+        tsp_heuristic(const csr_adjacency &adj,const layout *x=NULL);
+        tsp_heuristic(const layout &x);
+        double dist(int i,int j) const;
+        double improve(ivector &hc);
+        double find_tour(ivector &hc,const ivector *start=NULL,double time_limit=0);
+        bool is_feasible(double cost) const { return cost<m_feasible_bound; }
+    };
+
+    class mst_finder { // minimal spanning forest by filter-Kruskal on a packed array of edges with floating-point weights
+        struct edge {
+            double w;
+            int u,v;
+        };
+        struct filter_data { // part of the edge array filtered by a thread
+            mst_finder *F;
+            int begin,end,kept;
+            bool shared; // true if other threads read the forest at the same time
+        };
+        int n,m_threads,m_limit; // m_limit is the number of edges in a spanning tree
+        std::vector<edge> m_edges;
+        ivector m_parent; // disjoint-set forest of the components
+        ulong m_seed;
+        ipairs *m_forest;
+        double m_total;
+        int root(int v) const;
+        int find(int v);
+        void kruskal(int lo,int hi);
+        int partition(int lo,int hi);
+        int filter(int lo,int hi);
+        void filter_kruskal(int lo,int hi);
+        static bool lighter(const edge &a,const edge &b) { return a.w<b.w; }
+        static void *filter_worker(void *arg);
+    public:
+        mst_finder(const csr_adjacency &A,const bvector *include=NULL);
+        double find_forest(ipairs &forest);
+        static bool dense_tree(int n,double (*dist)(int,int,void*),void *data,ipairs &tree,dvector &weights);
+    };
+
     class mm { // An efficient implementation of Edmonds' blossom algorithm
         enum label_t { EVEN=0, ODD=1 };
         graphe *G;
@@ -608,31 +1095,41 @@ public:
         void find_maximum_matching(ipairs &matching,int sg=-1);
     };
 
-    class sip { // subgraph isomorphism via Ullmann's algorithm
-        int N,n,max_sg,nb;
-        bitmatrix A,AT,M;
-        bvectors B;
-        bvector used_cols;
-        ivectors found;
-        bool induced,dir,isom;
-        ipairs changes;
-        std::stack<ipairs> snapshots;
-        static void clear_bitrow(bitrow &row);
-        static bool get_j(const bitrow &row,int j) { return row[j/SIP_NBITS].test(j%SIP_NBITS); }
-        static bool get_ij(const bitmatrix &mat,int i,int j) { return get_j(mat[i],j); }
-        static void set_ij(bitmatrix &mat,int i,int j,bool val) { mat[i][j/SIP_NBITS].set(j%SIP_NBITS,val); }
-        bool mult_bitrows(const bitrow &r,const bitrow &c);
-        bool M_has_empty_row();
-        bool recurse(int i=0);
-        void prune();
-        void edit(int i,int j) { set_ij(M,i,j,false); changes.push_back(std::make_pair(i,j)); }
-        void push_changes() { snapshots.push(changes); changes.clear(); }
-        void revert_changes();
-        bool is_isomorphism();
+    class vf2pp { // subgraph isomorphism via the VF2++ algorithm
+        struct worker_data {
+            vf2pp *matcher;
+            int steps;
+            bool stop;
+            ivector core_p,core_g,out_count,in_count;
+        };
+        const graphe *G;
+        const csr_adjacency *m_adj,*m_padj;
+        bool dir,m_induced,m_stop;
+        int N,n,m_limit,m_count,m_next;
+        ivector m_order,m_position,m_roots;
+        ivector g_color,p_color,g_in_offsets,g_in_targets,p_in_degree;
+        ivectors m_pred_out,m_pred_in;
+        ivectors *m_found;
+        match_handler m_handler;
+        void *m_handler_data;
+#ifdef HAVE_LIBPTHREAD
+        pthread_mutex_t m_mutex;
+#endif
+        int g_in_degree(int v) const { return dir?g_in_offsets[v+1]-g_in_offsets[v]:m_adj->degree(v); }
+        void matching_order(const graphe &P);
+        bool is_candidate(int u,int v) const;
+        bool is_feasible(const worker_data &W,int k,int v) const;
+        void assign(worker_data &W,int u,int v,int delta);
+        void report(worker_data &W);
+        bool refresh(worker_data &W);
+        int next_root(worker_data &W);
+        void extend(worker_data &W,int k,int v);
+        void match(worker_data &W,int k);
+        static void *worker(void *arg);
     public:
-        sip(const graphe &G,const graphe &P,int max_sg_in=1);
-        int find_subgraphs(bool only_induced=true);
-        const ivector &get_subgraph(int i) const { return found[i]; }
+        vf2pp(const graphe &G,const graphe &P);
+        ~vf2pp();
+        int find_subgraphs(bool only_induced,int limit=0,ivectors *found=NULL,match_handler handler=NULL,void *data=NULL,bool parallel=true);
     };
     
     struct edges_comparator { // for sorting edges by their weight
@@ -643,6 +1140,77 @@ public:
         edges_comparator(graphe *gr) { G=gr; }
     };
 
+    struct gen_key_comparator { // for min-priority queues of (key,vertex) pairs with exact keys
+        const context *ctx;
+        bool operator()(const std::pair<gen,int> &a,const std::pair<gen,int> &b) const {
+            return is_strictly_greater(a.first,b.first,ctx);
+        }
+        gen_key_comparator(const context *contextptr) { ctx=contextptr; }
+    };
+
+    struct brandes_thread_data { // work assigned to a thread computing betweenness dependencies
+        const graphe *G;
+        const csr_adjacency *A;
+        const ivector *sources;
+        int begin,end;
+        dvector *cb;
+    };
+
+    struct apsp_thread_data { // work assigned to a thread computing all-pairs distances
+        const csr_adjacency *A;
+        const dvector *h; // vertex potentials for Johnson's reweighting, or NULL
+        double *D; // n x n distance matrix stored by rows
+        int n,begin,end; // range of sources or of Floyd-Warshall tiles
+        int kb,phase; // pivot block and phase of blocked Floyd-Warshall algorithm
+    };
+
+    struct det_thread_data { // primes assigned to a thread computing a determinant by the multi-modular method
+        const laplacian_minor *M;
+        const ivector *primes;
+        ivector *residues; // -1 means that the prime is unlucky
+        int begin,end;
+    };
+
+    class tutte_budget { // number of idle threads available to a single Tutte polynomial computation
+        int m_idle;
+#ifdef HAVE_LIBPTHREAD
+        pthread_mutex_t m_mutex;
+#endif
+    public:
+        tutte_budget(int idle);
+        ~tutte_budget();
+        bool acquire();
+        void release();
+    };
+
+    struct tutte_thread_data { // deletion branch of a deletion-contraction step, processed in a separate thread
+        graphe *G;
+        tutte_budget *budget;
+        intpoly poly;
+    };
+
+    struct cbc_thread_data { // vertices assigned to a thread computing communicability betweenness
+        const dvector *V,*lambda; // eigenvectors (by columns) and eigenvalues of the adjacency matrix
+        const dvector *W,*Wt; // reciprocals of entries of exp(A-lambda_max*I) and their transform by V
+        const ivector *vertices;
+        int n,begin,end;
+        dvector *res;
+    };
+
+    struct cbc_exact_thread_data { // columns of exp(A) assigned to a thread computing communicability betweenness exactly
+        const csr_adjacency *A;
+        int k,begin,end;
+        dvector res; // the sums for all vertices (or only for the k-th vertex if k>=0) over the assigned columns
+        bool stopped;
+    };
+
+    struct triangle_thread_data { // range of vertices assigned to a thread counting triangles
+        const ivector *offsets,*targets; // degree-oriented adjacency, vertices indexed by rank
+        int begin,end;
+        std::vector<ulong> counts; // number of triangles through each vertex (by rank)
+        ivectors *triangles; // triangles found (by ranks), or NULL
+    };
+
     struct ivectors_comparator { // for sorting ivectors by their length
         bool operator()(const ivector &a,const ivector &b) const {
             return a.size()<b.size();
@@ -698,7 +1266,7 @@ public:
     static int default_highlighted_vertex_color;
     static int default_edge_width;
     static int bold_edge_width;
-    static std::map<ivector,std::vector<cpol> > cache;
+    static poly_cache tutte_cache;
     // special graphs
     static const int clebsch_graph[];
     static const int coxeter_graph[];
@@ -784,8 +1352,17 @@ private:
     ivectors maxcliques;
     std::stack<ivector> saved_subgraphs;
     bool m_supports_attributes;
+    mutable csr_adjacency frozen_adj;
+    mutable label_index label_idx;
+    mutable ivector canonical_lab;
+    mutable std::vector<ulong> canonical_cert; // empty if not computed yet
+    mutable bool canonical_colored;
+    mutable ivector canonical_colors; // vertex colors for which the colored certificate was computed
     void clear_node_stack();
     void clear_node_queue();
+    void invalidate_adjacency_snapshot() { frozen_adj.invalidate(); canonical_cert.clear(); }
+    void invalidate_label_index() { label_idx.invalidate(); }
+    bool compute_canonical_form(bool colored) const;
     void message(const char *str) const;
     void message(int t,const char *str) const;
     void message(int t,const char *format,int a) const;
@@ -834,7 +1411,7 @@ private:
     static void multiply_sparse_matrices(const sparsemat &A,const sparsemat &B,sparsemat &P,int ncols,bool symmetric=false);
     static gen sparse_product_element(const sparsemat &A, const sparsemat &B,int i,int j);
     static void transpose_sparsemat(const sparsemat &A,sparsemat &T);
-    void multilevel_recursion(layout &x,int d,double R,double K,double tol,int depth=0);
+    void multilevel_recursion(layout &x,int d,double R,double K,double tol,double theta,int depth=0);
     int mdeg(const ivector &V,int i) const;
     void coarsening(graphe &G,const sparsemat &P,const ivector &V) const;
     void tomita(iset &R,iset &P,iset &X,std::map<int,int> &m,int mode=0);
@@ -842,23 +1419,18 @@ private:
     void cp_recurse(ivector &C,ivector &P,ivector &incumbent);
     int ost_maxclique(ivector &clique);
     void ost_recursive(ivector &U,int size,int &maxsize,ivector &incumbent,bool &found);
-    void find_cut_vertices_dfs(int i,std::set<int> &ap,int sg);
-    void find_blocks_dfs(int i,std::vector<ipairs> &blocks,int sg);
-    void find_bridges_dfs(int i,ipairs &B,int sg);
     int find_cycle_dfs(int i,int sg);
     bool find_path_dfs(int dest,int i,int sg,bool skip_embedded);
     static void sort_rectangles(std::vector<rectangle> &rectangles);
     static bool embed_rectangles(std::vector<rectangle> &rectangles,double maxheight);
     static bool segments_crossing(const point &p,const point &r,const point &q,const point &s,point &crossing);
     static bool point2segment_projection(const point &p,const point &q,const point &r,point &proj);
-    void force_directed_placement(layout &x,double K,double R=DBL_MAX,double tol=0.01,bool ac=true);
+    void force_directed_placement(layout &x,double K,double R=DBL_MAX,double tol=0.01,bool ac=true,double theta=BH_THETA);
     static bool get_node_position(const attrib &attr,point &p,GIAC_CONTEXT);
     void coarsening_mis(const ivector &V,graphe &G,sparsemat &P) const;
     void coarsening_ec(const ipairs &M,graphe &G,sparsemat &P) const;
-    static int face_has_edge(const ivector &face,int i,int j);
     int first_neighbor_from_subgraph(const vertex &v,int sg) const;
-    void set_nodes_embedded(const ivector &v,bool yes=true);
-    void unembed_all_nodes();
+    void planarity_input(int sg,ivector &V,ipairs &E) const;
     int planar_embedding(ivectors &faces);
     void set_embedding(const ivectors &faces);
     void clear_embedding();
@@ -874,11 +1446,30 @@ private:
     void make_product_nodes(const graphe &G,graphe &P) const;
     static void extract_path_from_cycle(const ivector &cycle,int i,int j,ivector &path);
     static void generate_nk_sets(int n,int k,std::vector<std::bitset<32> > &v);
-    void strongconnect_dfs(ivectors &components,bvector &onstack,int i,int sg);
+    void dijkstra_tree(int src,const ivector &dest,ivector &parent,int sg);
+    void dijkstra_tree_exact(int src,const ivector &dest,ivector &parent,vecteur &dist,int sg);
+    bool bidirectional_dijkstra(int src,int dst,ivector &path,int sg);
+    gen path_weight(const ivector &path) const;
+    void brandes_accumulate(const csr_adjacency &A,const ivector &sources,int begin,int end,dvector &cb) const;
+    static void *brandes_thread(void *arg);
+    static int max_threads();
+    static void run_threads(void *(*routine)(void *),const std::vector<void*> &args);
+    static void *apsp_bfs_thread(void *arg);
+    static void *apsp_dijkstra_thread(void *arg);
+    static void *floyd_warshall_thread(void *arg);
+    static void floyd_warshall_tile(double *D,int n,int ib,int jb,int kb);
+    static bool johnson_potentials(const csr_adjacency &A,dvector &h);
+    static void householder_tridiagonalize(int n,dvector &Z,dvector &d,dvector &e);
+    static bool tridiagonal_ql(int n,dvector &d,dvector &e,dvector *Z);
+    static void *cbc_thread(void *arg);
+    static void exp_column(const csr_adjacency &A,int q,int r,dvector &s,dvector &t,dvector &u,int &e);
+    static void *cbc_exact_thread(void *arg);
+    static void *modular_det_thread(void *arg);
+    static int intersect_sorted(const int *a,const int *a_end,const int *b,const int *b_end,int *c);
+    static void *triangle_thread(void *arg);
+    void allpairs_distance_numeric(dvector &D,bool weighted) const;
     bool degrees_equal(const ivector &v,int deg=0) const;
     void lca_recursion(int u,const ipairs &p,ivector &lca,unionfind &ds);
-    void st_numbering_dfs(int i,ivector &preorder);
-    void rdfs(int i,ivector &d,bool rec,int sg,bool skip_embedded);
     bool is_descendant(int v,int anc) const;
     static int pred(int i,int n);
     static int succ(int i,int n);
@@ -894,7 +1485,8 @@ private:
     bool bipartite_matching_dfs(int u,ivector &dist,int sg=-1);
     static gen make_colon_label(const ivector &v);
     void simplify(graphe &G,bool color_temp_vertices=false) const;
-    intpoly tutte_poly_recurse(int vc);
+    intpoly tutte_poly_recurse(int vc,tutte_budget &budget);
+    static void *tutte_thread(void *arg);
     static void poly_mult(intpoly &a,const intpoly &b);
     static void poly_add(intpoly &a,const intpoly &b);
     static intpoly poly_geom(int var,int k,bool leading_one,bool add_other_var=false);
@@ -909,9 +1501,7 @@ private:
     static gen ipair2rat(const ipair &p);
     void save_subgraphs();
     void restore_subgraphs();
-    int vertex_pair_connectivity(int v,int w);
-    static gen harmonic_mean_exact(gen a,gen b,gen c) { return 3*a*b*c/(a*b+b*c+a*c); }
-    static double harmonic_mean(double a,double b,double c) { return 3.0*a*b*c/(a*b+b*c+a*c); }
+    void make_split_network(flow_network &F) const;
     void strec(int i,int t,int counter,int np,iset &Q,vecteur &timestamp,vecteur &l);
     bool hamcycle_recurse(ivector &path,int pos);
     void grasp_construct(double aplha, ivector &Q,bool cmpl,int sg);
@@ -928,6 +1518,7 @@ private:
     int count_edges_in_Nv(int v,int sg=-1) const;
     int count_edges(const ivector &V) const;
     bool is_simplicial(int i,const sparsemat &A,double D=0.0);
+    static bool multilevel_fiedler(const sparse_matrix &L,dvector &x,double &lambda,double tol,int maxiter);
 
 public:
     graphe(const context *contextptr=context0,bool support_attributes=true);
@@ -969,10 +1560,12 @@ public:
     void copy(graphe &G) const;
     void copy_nodes(const std::vector<vertex> &V);
     void copy_nodes(graphe &G,std::map<int,int> &vmap,int sg=-1) const;
+    void detach_nodes();
     bool supports_attributes() const { return m_supports_attributes; }
     void clear();
     void clear_maximal_cliques() { maxcliques.clear(); }
     void find_maximal_cliques();
+    void enumerate_maximal_cliques(std::map<int,int> &stats,ivectors *cliques=NULL,clique_handler handler=NULL,void *data=NULL) const;
     const ivectors &maximal_cliques() const { return maxcliques; }
     int tag2index(const std::string &tag);
     std::string index2tag(int index) const;
@@ -1011,7 +1604,7 @@ public:
     void unvisit_all_nodes(int sg=-1);
     void unset_all_ancestors(int sg=-1);
     void uncolor_all_nodes(int base_color=0,int sg=-1);
-    void set_node_color(int i,int c) { node(i).set_color(c); }
+    void set_node_color(int i,int c) { node(i).set_color(c); canonical_cert.clear(); }
     void dfs(int root,bool rec=true,bool clr=true,ivector *D=NULL,int sg=-1,bool skip_embedded=false);
     void bfs(int root,bool rec=true,bool clr=true,ivector *D=NULL,int sg=-1,bool skip_embedded=false);
     const ivector &get_discovered_nodes() const { return disc_nodes; }
@@ -1032,6 +1625,7 @@ public:
     void remove_isolated_nodes(const iset &I);
     void isolate_nodes(const iset &V);
     const vertex &node(int i) const { assert(i>=0 && i<node_count()); return nodes[i]; }
+    const csr_adjacency &adjacency_snapshot(bool weighted=false) const;
     const gen node_label(int i) const { assert(i>=0 && i<node_count()); return nodes[i].label(); }
     vecteur get_node_labels(const ivector &v=ivector(0)) const;
     int node_index(const gen &v) const;
@@ -1059,6 +1653,7 @@ public:
     bool add_edge(const ipair &edge,const attrib &attr) { return add_edge(edge.first,edge.second,attr); }
     bool add_edge(const gen &v,const gen &w,const gen &weight=gen(1));
     bool add_edge(const gen &v,const gen &w,const attrib &attr);
+    int add_edges(const ipairs &E,const vecteur *weights=NULL);
     void add_temporary_edge(int i,int j);
     bool is_temporary_edge(int i,int j) const;
     void remove_temporary_edges();
@@ -1082,8 +1677,8 @@ public:
     void adjacency_sparse_matrix(sparsemat &sm,bool diag_ones=false,int sg=-1) const;
     void laplacian_matrix(matrice &m,bool normalize=false) const;
     void incidence_matrix(matrice &m) const;
-    void set_graph_attribute(int key,const gen &val) { attributes[key]=val; }
-    void set_graph_attributes(const attrib &attr) { copy_attributes(attr,attributes); }
+    void set_graph_attribute(int key,const gen &val) { attributes[key]=val; invalidate_adjacency_snapshot(); }
+    void set_graph_attributes(const attrib &attr) { copy_attributes(attr,attributes); invalidate_adjacency_snapshot(); }
     void set_node_attribute(int index,int key,const gen &val);
     void set_edge_attribute(int i,int j,int key,const gen &val);
     bool get_graph_attribute(int key,gen &val) const;
@@ -1118,28 +1713,32 @@ public:
     void maximal_independent_set(ivector &ind) const;
     void maximum_matching(ipairs &matching,int sg=-1,gt_conn_check cc=_GT_CC_FIND_COMPONENTS);
     void maximal_matching(ipairs &matching,int sg=-1) const;
-    bool demoucron(ivectors &faces,int sg=-1);
+    bool planar_rotation_system(ivectors &rot,int sg=-1) const;
+    bool planar_faces(ivectors &faces,int sg=-1) const;
+    bool kuratowski_subgraph(ipairs &E,int sg=-1) const;
     void create_random_layout(layout &x,int dim);
-    void make_spring_layout(layout &x,int d,double tol=0.001);
+    void make_spring_layout(layout &x,int d,double tol=0.001,double theta=BH_THETA);
     void make_circular_layout(layout &x,const ivector &hull,double A=0,double tol=0.005,double elongate=0.0);
     void make_tutte_layout(layout &x,const ivector &outer_face);
     bool make_planar_layout(layout &x,double *score=NULL);
     bool make_best_planar_layout(layout &x,int iter);
     void make_tree_layout(layout &x,double sep,int apex=0);
     void make_bipartite_layout(layout &x,const ivector &p1,const ivector &p2);
+    bool make_spectral_layout(layout &x,int d,double tol=LANCZOS_TOLERANCE,int maxiter=LANCZOS_MAXITER) const;
     void layout_best_rotation(layout &x);
     bool is_tree(int sg=-1) { return !is_directed() && edge_count(sg)+1==subgraph_size(sg) && is_connected(sg); }
     bool is_forest(int sg=-1,gt_conn_check cc=_GT_CC_FIND_COMPONENTS);
     bool is_tournament(int sg=-1) const;
-    bool is_planar(int sg=-1);
+    bool is_planar(int sg=-1) const;
     bool is_clique(int sg=-1) const;
     gen triangle_count(ivectors *dest=NULL,bool ccoeff=false,bool exact=true);
+    ulong vertex_triangle_counts(std::vector<ulong> &tri,ivectors *dest=NULL) const;
     int tree_height(int root=-1);
     void clique_stats(std::map<int,int> &m,int mode=0);
-    int maximum_clique(ivector &clique);
+    int maximum_clique(ivector &clique,bool parallel=true,int solver=_GT_CLIQUE_AUTO);
     void greedy_neighborhood_clique_cover_numbers(ivector &cover_numbers);
     bool clique_cover(ivectors &cover,int k=0,int tm_lim=0,bool verbose=false);
-    int maximum_independent_set(ivector &v) const;
+    int maximum_independent_set(ivector &v,bool parallel=true) const;
     int girth(bool odd=false,int sg=-1);
     bool hakimi(const ivector &L);
     void erdos_renyi(double p);
@@ -1187,6 +1786,9 @@ public:
     void connected_components(ivectors &components,int sg=-1,bool skip_embedded=false,int *count=NULL);
     int connected_component_count(int sg=-1);
     int connected_components_to_subgraphs(int sg=-1);
+    double detect_communities(ivectors &communities,double gamma=1.0) const;
+    int communities_to_subgraphs(double gamma=1.0);
+    double modularity(const ivector &community,double gamma=1.0) const;
     void biconnected_components(ivectors &components,int sg=-1);
     void strongly_connected_components(ivectors &components,int sg=-1);
     bool has_cut_vertex(int sg=-1,int i=0);
@@ -1224,6 +1826,7 @@ public:
     void reverse(graphe &G) const;
     void spanning_tree(int i,graphe &T,int sg=-1);
     void minimal_spanning_tree(graphe &T,int sg=-1);
+    double minimal_spanning_forest(ipairs &E,int sg=-1) const;
     void lowest_common_ancestors(int root,const ipairs &p,ivector &lca_recursion);
     int lowest_common_ancestor(int i,int j,int root);
     void compute_st_numbering(int s,int t);
@@ -1254,16 +1857,23 @@ public:
     bool is_isomorphic(graphe &other,std::map<int,int> &isom,bool use_colors=true);
     gen aut_generators() const;
     bool canonical_labeling(ivector &lab) const;
+    bool canonical_certificate(std::vector<ulong> &cert,bool colored=true) const;
+    static void nonisomorphic_representatives(const std::vector<graphe*> &G,ivector &rep);
     bool bondy_chvatal_closure(graphe &G,ivector &d);
     int hamcond(bool make_closure=true);
     bool is_hamiltonian(ivector &hc);
     bool hamcycle(ivector &path);
-    int traveling_salesman(int k,ivectors &hcv,dvector &costs,double gap_tol=0,bool verbose=true);
+    int traveling_salesman(int k,ivectors &hcv,dvector &costs,double gap_tol=0,bool verbose=true,bool euclidean=false,double time_limit=0);
     bool find_directed_tours(int k,ivectors &hcv,dvector &costs,const ipairs &incl,double gap_tol=0,bool verbose=false);
     bool make_euclidean_distances();
     gen maxflow_edmonds_karp(int s,int t,std::vector<std::map<int,gen> > &flow,const gen &limit=plusinf());
+    bool make_flow_network(flow_network &F,bool weighted=true) const;
+    void minimum_cut(int s,const flow_network &F,ipairs &cut) const;
+    static void gomory_hu_tree(flow_network &F,ivector &parent,dvector &cut);
     void minimum_cut(int s,const std::vector<std::map<int,gen> > &flow,ipairs &cut);
     gen tutte_polynomial(const gen &x,const gen &y);
+    gen spanning_forest_count() const;
+    bool spanning_forest_count_log(double &res) const;
     void fundamental_cycles(ivectors &cycles,int sg=-1,gt_conn_check=_GT_CC_FIND_COMPONENTS);
     void mycielskian(graphe &G) const;
     gen local_clustering_coeff(int i) const;
@@ -1278,10 +1888,17 @@ public:
     void compute_in_out_degrees(ivector &ind,ivector &outd) const;
     vecteur distances_from(int k);
     gen betweenness_centrality(int k) const;
+    gen betweenness_centrality_approx(int k,int samples=0) const;
     gen communicability_betweenness_centrality(int k) const;
     gen closeness_centrality(int k,bool harmonic=false);
     gen degree_centrality(int k) const;
     vecteur katz_centrality(const gen &att) const;
+    int katz_centrality_approx(double att,dvector &x,double tol=CENTRALITY_TOLERANCE,int maxiter=CENTRALITY_MAXITER) const;
+    bool pagerank(double damping,dvector &x,double tol=CENTRALITY_TOLERANCE,int maxiter=CENTRALITY_MAXITER) const;
+    bool eigenvector_centrality(dvector &x,double tol=CENTRALITY_TOLERANCE,int maxiter=CENTRALITY_MAXITER) const;
+    bool spectrum_approx(int k,bool seidel,dvector &lambda,double tol=LANCZOS_TOLERANCE,int maxiter=LANCZOS_MAXITER) const;
+    bool fiedler_vector(dvector &x,double &lambda2,double tol=LANCZOS_TOLERANCE,int maxiter=LANCZOS_MAXITER) const;
+    bool spectral_bisection(ivector &part1,ivector &part2,double tol=LANCZOS_TOLERANCE,int maxiter=LANCZOS_MAXITER) const;
     gen information_centrality(int k,bool approx=false) const;
     int splittance(int &m,ivector &vseq) const;
     bool is_split_graph(ivector &clq,ivector &indp) const;
@@ -1293,7 +1910,8 @@ public:
     bool is_reachable(int u,int v);
     void reachable(int u,ivector &r);
     void find_simplicial_vertices(ivector &res);
-    void subgraph_isomorphism(graphe &P,int max_sg,bool induced,ivectors &res) const;
+    void subgraph_isomorphism(const graphe &P,int max_sg,bool induced,ivectors &res,bool parallel=true) const;
+    int subgraph_isomorphism(const graphe &P,int max_sg,bool induced,match_handler handler,void *data,bool parallel=true) const;
     bool pruefer_encode(ivector &code,bool check_tree=false);
     bool pruefer_decode(const ivector &code);
     const char* identify();
@@ -294,18 +294,47 @@ bool parse_edge_with_weight(graphe &G,const vecteur &E) {
 
 bool parse_edges(graphe &G,const vecteur &E,bool is_set,int &addc) {
     if (is_set) {
+        /* the vertices are created in the input order, plain and weighted edges are
+         * added in bulk and the attributes are assigned to the remaining edges afterwards */
+        graphe::ipairs plain,weighted;
+        vecteur weights,attributed;
+        plain.reserve(E.size());
+        int i,j;
         for (const_iterateur it=E.begin();it!=E.end();++it) {
             if (it->type!=_VECT || it->_VECTptr->size()!=2)
                 return false;
-            if (it->_VECTptr->front().type!=_VECT) {
-                if (it->_VECTptr->front()==it->_VECTptr->back())
+            const gen &a=it->_VECTptr->front(),&b=it->_VECTptr->back();
+            if (a.type!=_VECT) {
+                if (a==b)
                     return false;
-                if (G.add_edge(it->_VECTptr->front(),it->_VECTptr->back()))
-                    ++addc;
-            } else {
-                if (!parse_edge_with_weight(G,*it->_VECTptr))
+                i=G.add_node(a);
+                j=G.add_node(b);
+                if (i<0 || j<0)
                     return false;
+                plain.push_back(make_pair(i,j));
+                continue;
             }
+            const vecteur &e=*a._VECTptr;
+            if (e.size()!=2 || e.front()==e.back())
+                return false;
+            i=G.add_node(e.front());
+            j=G.add_node(e.back());
+            if (i<0 || j<0)
+                return false;
+            if (b.type==_MAP)
+                attributed.push_back(*it);
+            else {
+                weighted.push_back(make_pair(i,j));
+                weights.push_back(b);
+            }
+        }
+        if (!weighted.empty() && !G.is_weighted())
+            G.set_weighted(true);
+        addc+=G.add_edges(plain);
+        G.add_edges(weighted,&weights);
+        for (const_iterateur it=attributed.begin();it!=attributed.end();++it) {
+            if (!parse_edge_with_weight(G,*it->_VECTptr))
+                return false;
         }
     } else {
         int n=E.size();
@@ -357,6 +386,67 @@ void parse_lp_options(const_iterateur opt_start,const_iterateur opt_end,bool *st
     }
 }
 
+/* parse the option tolerance=tol or maxiter=n for iterative solvers, return 1
+ * on success, 0 if g is not such an option and -1 if the value is invalid */
+int parse_iteration_option(const gen &g,double &tol,int &maxiter,GIAC_CONTEXT) {
+    if (!is_equal(g))
+        return 0;
+    const gen &lhs=g._SYMBptr->feuille._VECTptr->front();
+    const gen &rhs=g._SYMBptr->feuille._VECTptr->back();
+    if (is_mcint(lhs,_GT_TOLERANCE)) {
+        if (!is_real_number(rhs,contextptr) || (tol=to_real_number(rhs,contextptr).to_double(contextptr))<=0)
+            return -1;
+        return 1;
+    }
+    if (is_mcint(lhs,_GT_MAXITER)) {
+        if (rhs.type!=_INT_ || (maxiter=rhs.val)<=0)
+            return -1;
+        return 1;
+    }
+    return 0;
+}
+
+/* return true iff all edge weights in G are nonnegative real numbers */
+bool has_nonnegative_weights(const graphe *G) {
+    const graphe::csr_adjacency &A=G->adjacency_snapshot(true);
+    for (int k=0;k<A.arc_count();++k) {
+        if (A.weight(k)<0 || A.weight(k)==DBL_MAX)
+            return false;
+    }
+    return true;
+}
+
+/* return the floating-point centralities x as a list, or the k-th one if k>=0 */
+gen centrality_list(const graphe::dvector &x,int k) {
+    if (k>=0)
+        return x[k];
+    vecteur res(x.size());
+    for (int i=0;i<int(x.size());++i) {
+        res[i]=x[i];
+    }
+    return res;
+}
+
+struct clique_filter {
+    int lb,ub;
+    graphe::ivectors cliques;
+};
+
+/* store the clique if its size is within the bounds given in the clique_filter data */
+void store_filtered_clique(const graphe::ivector &clique,void *data) {
+    clique_filter *cf=static_cast<clique_filter*>(data);
+    int sz=clique.size();
+    if (sz>=cf->lb && sz<=cf->ub)
+        cf->cliques.push_back(clique);
+}
+
+/* return the flow value f, as an integer if the capacities are integral */
+gen flow_value(double f,bool integral) {
+    if (!integral)
+        return f;
+    return std::abs(f)<1e9?gen(int(std::floor(f+0.5))):gen(longlong(std::floor(f+0.5)));
+}
+
 bool delete_edges(graphe &G,const vecteur &E,int &delc) {
     if (ckmatrix(E)) {
         if (E.front()._VECTptr->size()!=2)
@@ -1205,14 +1295,15 @@ gen _import_graph(const gen &g,GIAC_CONTEXT) {
                 if (a->second.type==_VECT || a->second.type==_CPLX)
                     a->second=symbolic(at_point,a->second);
             }
-            if (eval_labels) {
-                if ((a=va.find(_GT_ATTRIB_LABEL))!=va.end() && a->second.type==_STRNG)
-                    a->second=gen(graphe::genstring2str(a->second),contextptr);
-            }
             if (eval_weights) {
                 if ((a=va.find(_GT_ATTRIB_WEIGHT))!=va.end() && a->second.type==_STRNG)
                     a->second=gen(graphe::genstring2str(a->second),contextptr);
             }
+            if (eval_labels) {
+                /* the label index must be updated */
+                if ((a=va.find(_GT_ATTRIB_LABEL))!=va.end() && a->second.type==_STRNG)
+                    G.set_node_attribute(i,_GT_ATTRIB_LABEL,gen(graphe::genstring2str(a->second),contextptr));
+            }
         }
         graphe::ipairs E;
         G.get_edges_as_pairs(E);
@@ -1807,7 +1898,9 @@ define_unary_function_ptr5(at_seidel_switch,alias_at_seidel_switch,&__seidel_swi
  *
  * Supported options are:
  *
- *  - spring: use force-directed method to draw graph G
+ *  - spring[=theta]: use force-directed method to draw graph G [with
+ *    the given opening angle theta>=0 for the Barnes-Hut approximation of
+ *    repulsive forces in large graphs, theta=0 forces exact computation]
  *  - tree[=r or [r1,r2,...]]: draw tree or forest G [with optional
  *    specification of root nodes]
  *  - bipartite: draw the bipartite graph G keeping the partitions separated
@@ -1837,6 +1930,8 @@ gen _draw_graph(const gen &g,GIAC_CONTEXT) {
     vecteur root_nodes,outer_vertices,ar,pos;
     gen coords_dest=undef,title=undef,sc=undef;
     int method=_GT_STYLE_DEFAULT,opt_counter=0;
+    double theta=BH_THETA;
+    bool has_theta=false;
     if (has_opts) {
         // parse options
         for (const_iterateur it=g._VECTptr->begin()+1;it!=g._VECTptr->end();++it) {
@@ -1857,6 +1952,15 @@ gen _draw_graph(const gen &g,GIAC_CONTEXT) {
                             root_nodes.push_back(rh);
                         method=_GT_STYLE_TREE;
                         break;
+                    case _GT_SPRING:
+                        if (!is_real_number(rh,contextptr) ||
+                                (theta=to_real_number(rh,contextptr).to_double(contextptr))<0)
+                            return generrtype(gettext("Expected a nonnegative real number"));
+                        has_theta=true;
+                        if (method==_GT_STYLE_3D)
+                            opt_counter--; // the opening angle is also used in 3D
+                        else method=_GT_STYLE_SPRING;
+                        break;
                     case _LABELS:
                         if (!rh.is_integer())
                             return generrtype(gettext("Expected an integer"));
@@ -1889,8 +1993,11 @@ gen _draw_graph(const gen &g,GIAC_CONTEXT) {
                 method=_GT_STYLE_CIRCLE;
             else if (opt==at_plan)
                 method=_GT_STYLE_PLANAR;
-            else if (opt==at_plot3d)
+            else if (opt==at_plot3d) {
+                if (has_theta && method==_GT_STYLE_SPRING)
+                    opt_counter--; // the opening angle is also used in 3D
                 method=_GT_STYLE_3D;
+            }
             else if (opt.is_integer()) {
                 switch (opt.val) {
                 case _GT_TREE:
@@ -1905,6 +2012,9 @@ gen _draw_graph(const gen &g,GIAC_CONTEXT) {
                 case _GT_PLANAR:
                     method=_GT_STYLE_PLANAR;
                     break;
+                case _GT_SPECTRAL:
+                    method=_GT_STYLE_SPECTRAL;
+                    break;
                 default: return generrtype(gettext("Unrecognized drawing method"));
                 }
             } else if (opt.type==_VECT) {
@@ -1998,10 +2108,10 @@ gen _draw_graph(const gen &g,GIAC_CONTEXT) {
             try {
             switch (comp_method) {
                 case _GT_STYLE_SPRING:
-                    C.make_spring_layout(x,2);
+                    C.make_spring_layout(x,2,0.001,theta);
                     break;
                 case _GT_STYLE_3D:
-                    C.make_spring_layout(x,3);
+                    C.make_spring_layout(x,3,0.001,theta);
                     break;
                 case _GT_STYLE_TREE:
                     if (check && !C.is_tree())
@@ -2030,8 +2140,13 @@ gen _draw_graph(const gen &g,GIAC_CONTEXT) {
                         return gt_err(_GT_ERR_NOT_BIPARTITE);
                     C.make_bipartite_layout(x,partition1,partition2);
                     break;
+                case _GT_STYLE_SPECTRAL:
+                    if (!C.make_spectral_layout(x,2))
+                        C.make_spring_layout(x,2);
+                    break;
                 }
-                if (C.node_count()>2 && (comp_method==_GT_STYLE_PLANAR || comp_method==_GT_STYLE_SPRING))
+                if (C.node_count()>2 && (comp_method==_GT_STYLE_PLANAR || comp_method==_GT_STYLE_SPRING ||
+                                         comp_method==_GT_STYLE_SPECTRAL))
                     C.layout_best_rotation(x);
                 if (comp_method!=_GT_TREE)
                     graphe::scale_layout(x,sep*std::sqrt((double)C.node_count()));
@@ -4081,8 +4196,9 @@ define_unary_function_ptr5(at_is_weighted,alias_at_is_weighted,&__is_weighted,0,
 
 /* USAGE:   is_planar(G,[F])
  *
- * Returns true iff graph G is planar [and store the list of its faces to F if G
- * is biconnected].
+ * Returns true iff graph G is planar. If G is planar and biconnected, the list
+ * of its faces is stored to F. If G is not planar, a Kuratowski subgraph of G
+ * (a subdivision of K5 or K3,3) is stored to F.
  */
 gen _is_planar(const gen &g,GIAC_CONTEXT) {
     if (g.type==_STRNG && g.subtype==-1) return g;
@@ -4098,27 +4214,35 @@ gen _is_planar(const gen &g,GIAC_CONTEXT) {
     if (G==NULL)
         return gt_err(_GT_ERR_NOT_A_GRAPH);
     G->underlying(U);
-    if (!is_undef(F)) {
-        if (!U.is_biconnected())
-            return gt_err(_GT_ERR_BICONNECTED_GRAPH_REQUIRED);
-        graphe::ivectors faces;
-        try {
-            if (!U.demoucron(faces))
-                return G->boole(false);
-        } catch (const std::runtime_error &e) {
-            if (strstr(e.what(),"user interruption")!=NULL || interrupted || ctrl_c) {
-                ctrl_c=interrupted=false;
-                return generr(gettext("Stopped by user interruption"));
-            }
-            return generr(e.what());
-        }
-        vecteur res;
-        for (graphe::ivectors_iter it=faces.begin();it!=faces.end();++it) {
-            res.push_back(G->get_node_labels(*it));
+    if (is_undef(F))
+        return G->boole(U.is_planar());
+    graphe::ivectors faces;
+    graphe::ipairs E;
+    bool planar;
+    try {
+        if (!(planar=U.planar_faces(faces)))
+            U.kuratowski_subgraph(E);
+    } catch (const std::runtime_error &e) {
+        if (strstr(e.what(),"user interruption")!=NULL || interrupted || ctrl_c) {
+            ctrl_c=interrupted=false;
+            return generr(gettext("Stopped by user interruption"));
         }
-        identifier_assign(*F._IDNTptr,change_subtype(res,_LIST__VECT),contextptr);
+        return generr(e.what());
     }
-    return G->boole(U.is_planar());
+    if (!planar) {
+        graphe K(contextptr);
+        U.extract_subgraph(E,K);
+        identifier_assign(*F._IDNTptr,K,contextptr);
+        return G->boole(false);
+    }
+    if (!U.is_biconnected())
+        return gt_err(_GT_ERR_BICONNECTED_GRAPH_REQUIRED);
+    vecteur res;
+    for (graphe::ivectors_iter it=faces.begin();it!=faces.end();++it) {
+        res.push_back(G->get_node_labels(*it));
+    }
+    identifier_assign(*F._IDNTptr,change_subtype(res,_LIST__VECT),contextptr);
+    return G->boole(true);
 }
 static const char _is_planar_s[]="is_planar";
 static define_unary_function_eval(__is_planar,&_is_planar,_is_planar_s);
@@ -5139,7 +5263,8 @@ define_unary_function_ptr5(at_shortest_path,alias_at_shortest_path,&__shortest_p
  *
  * Returns a square matrix D of order n(=number of vertices in G) such that
  * D(i,j) is the distance between i-th and j-th vertex of (weighted) graph G,
- * computed by using Floyd-Warshall algorithm with complexity O(n^3). If For
+ * computed by using BFS (unweighted graphs), Johnson's algorithm (sparse
+ * graphs) or Floyd-Warshall algorithm with complexity O(n^3). If For
  * some vertex pair no path exists, the corresponding entry in D is equal to
  * +infinity. Edges may have positive or negative weights but G shouldn't
  * contain negative cycles.
@@ -5198,7 +5323,8 @@ gen _graph_diameter(const gen &g,GIAC_CONTEXT) {
             const gen &dist=D[i][j];
             if (is_inf(dist))
                 continue;
-            max_dist=_max(makesequence(max_dist,dist),contextptr);
+            if (is_strictly_greater(dist,max_dist,contextptr))
+                max_dist=dist;
         }
     }
     return max_dist;
@@ -5425,20 +5551,57 @@ static const char _is_clique_s[]="is_clique";
 static define_unary_function_eval(__is_clique,&_is_clique,_is_clique_s);
 define_unary_function_ptr5(at_is_clique,alias_at_is_clique,&__is_clique,0,true)
 
-/* USAGE:   maximum_clique(G)
+/* parse the arguments G,[bitset=true|false] of maximum_clique and
+ * clique_number, set G and solver and return true on success, else set err */
+bool parse_clique_solver(const gen &g,graphe *&G,int &solver,gen &err) {
+    solver=_GT_CLIQUE_AUTO;
+    gen gr=g;
+    if (g.type==_VECT && g.subtype==_SEQ__VECT) {
+        const vecteur &gv=*g._VECTptr;
+        if (gv.size()!=2) {
+            err=gt_err(_GT_ERR_WRONG_NUMBER_OF_ARGS);
+            return false;
+        }
+        const gen &opt=gv.back();
+        if (!is_equal(opt) || !is_mcint(opt._SYMBptr->feuille._VECTptr->front(),_GT_BITSET)) {
+            err=generr(gettext("Unrecognized option"));
+            return false;
+        }
+        const gen &rh=opt._SYMBptr->feuille._VECTptr->back();
+        if (!rh.is_integer() || rh.subtype!=_INT_BOOLEAN) {
+            err=generr(gettext("Expected a boolean value"));
+            return false;
+        }
+        solver=rh.val?_GT_CLIQUE_BITSET:_GT_CLIQUE_CLASSIC;
+        gr=gv.front();
+    }
+    if ((G=graphe::from_gen(gr))==NULL) {
+        err=gt_err(_GT_ERR_NOT_A_GRAPH);
+        return false;
+    }
+    if (G->is_directed()) {
+        err=gt_err(_GT_ERR_UNDIRECTED_GRAPH_REQUIRED);
+        return false;
+    }
+    return true;
+}
+
+/* USAGE:   maximum_clique(G,[bitset=true|false])
  *
- * Returns maximum clique of undirected graph G as a list of vertices.
+ * Returns maximum clique of undirected graph G as a list of vertices. By
+ * default, the bit-parallel solver is used unless G is very large; the
+ * option bitset=true or bitset=false forces or disables it.
  */
 gen _maximum_clique(const gen &g,GIAC_CONTEXT) {
     if (g.type==_STRNG && g.subtype==-1) return g;
-    graphe *G=graphe::from_gen(g);
-    if (G==NULL)
-        return gt_err(_GT_ERR_NOT_A_GRAPH);
-    if (G->is_directed())
-        return gt_err(_GT_ERR_UNDIRECTED_GRAPH_REQUIRED);
+    graphe *G;
+    int solver;
+    gen err;
+    if (!parse_clique_solver(g,G,solver,err))
+        return err;
     graphe::ivector clique;
     try {
-        G->maximum_clique(clique);
+        G->maximum_clique(clique,true,solver);
     } catch (const std::runtime_error &e) {
         if (strstr(e.what(),"user interruption")!=NULL || interrupted || ctrl_c) {
             ctrl_c=interrupted=false;
@@ -5453,20 +5616,28 @@ static const char _maximum_clique_s[]="maximum_clique";
 static define_unary_function_eval(__maximum_clique,&_maximum_clique,_maximum_clique_s);
 define_unary_function_ptr5(at_maximum_clique,alias_at_maximum_clique,&__maximum_clique,0,true)
 
-/* USAGE:   clique_number(G)
+/* USAGE:   clique_number(G,[bitset=true|false])
  *
  * Returns the clique number of graph G, which is equal to the size of maximum
- * clique.
+ * clique. The option bitset is the same as for maximum_clique.
  */
 gen _clique_number(const gen &g,GIAC_CONTEXT) {
     if (g.type==_STRNG && g.subtype==-1) return g;
-    graphe *G=graphe::from_gen(g);
-    if (G==NULL)
-        return gt_err(_GT_ERR_NOT_A_GRAPH);
-    if (G->is_directed())
-        return gt_err(_GT_ERR_UNDIRECTED_GRAPH_REQUIRED);
+    graphe *G;
+    int solver;
+    gen err;
+    if (!parse_clique_solver(g,G,solver,err))
+        return err;
     graphe::ivector clique;
-    return G->maximum_clique(clique);
+    try {
+        return G->maximum_clique(clique,true,solver);
+    } catch (const std::runtime_error &e) {
+        if (strstr(e.what(),"user interruption")!=NULL || interrupted || ctrl_c) {
+            ctrl_c=interrupted=false;
+            return generr(gettext("Stopped by user interruption"));
+        }
+        return generr(e.what());
+    }
 }
 static const char _clique_number_s[]="clique_number";
 static define_unary_function_eval(__clique_number,&_clique_number,_clique_number_s);
@@ -5606,15 +5777,14 @@ define_unary_function_ptr5(at_chromatic_number,alias_at_chromatic_number,&__chro
  */
 gen _maximum_independent_set(const gen &g,GIAC_CONTEXT) {
     if (g.type==_STRNG && g.subtype==-1) return g;
-    graphe *G=graphe::from_gen(g),C(contextptr);
+    graphe *G=graphe::from_gen(g);
     if (G==NULL)
         return gt_err(_GT_ERR_NOT_A_GRAPH);
     if (G->is_directed())
         return gt_err(_GT_ERR_UNDIRECTED_GRAPH_REQUIRED);
     graphe::ivector clique;
     try {
-        G->complement(C);
-        C.maximum_clique(clique);
+        G->maximum_independent_set(clique);
     } catch (const std::runtime_error &e) {
         if (strstr(e.what(),"user interruption")!=NULL || interrupted || ctrl_c) {
             ctrl_c=interrupted=false;
@@ -5622,7 +5792,7 @@ gen _maximum_independent_set(const gen &g,GIAC_CONTEXT) {
         }
         return generr(e.what());
     }
-    vecteur res=C.get_node_labels(clique);
+    vecteur res=G->get_node_labels(clique);
     return sort_identifiers(res,contextptr);
 }
 static const char _maximum_independent_set_s[]="maximum_independent_set";
@@ -5636,13 +5806,14 @@ define_unary_function_ptr5(at_maximum_independent_set,alias_at_maximum_independe
  */
 gen _independence_number(const gen &g,GIAC_CONTEXT) {
     if (g.type==_STRNG && g.subtype==-1) return g;
-    graphe *G=graphe::from_gen(g),C(contextptr,false);
+    graphe *G=graphe::from_gen(g);
     if (G==NULL)
         return gt_err(_GT_ERR_NOT_A_GRAPH);
+    if (G->is_directed())
+        return gt_err(_GT_ERR_UNDIRECTED_GRAPH_REQUIRED);
     try {
-        G->complement(C);
         graphe::ivector clique;
-        return C.maximum_clique(clique);
+        return G->maximum_independent_set(clique);
     } catch (const std::runtime_error &e) {
         if (strstr(e.what(),"user interruption")!=NULL || interrupted || ctrl_c) {
             ctrl_c=interrupted=false;
@@ -5838,13 +6009,55 @@ static const char _is_arborescence_s[]="is_arborescence";
 static define_unary_function_eval(__is_arborescence,&_is_arborescence,_is_arborescence_s);
 define_unary_function_ptr5(at_is_arborescence,alias_at_is_arborescence,&__is_arborescence,0,true)
 
-/* USAGE:   graph_spectrum(G)
+/* compute k largest (k>0) or -k smallest (k<0) eigenvalues of the adjacency (or
+ * Seidel) matrix of the graph in gv[0] numerically, the arguments are G,k,[opts] */
+gen spectrum_approx(const vecteur &gv,bool seidel,GIAC_CONTEXT) {
+    int k,maxiter=LANCZOS_MAXITER,n;
+    double tol=LANCZOS_TOLERANCE;
+    graphe *G=graphe::from_gen(gv.front());
+    if (G==NULL)
+        return gt_err(_GT_ERR_NOT_A_GRAPH);
+    if (G->is_directed())
+        return gt_err(_GT_ERR_UNDIRECTED_GRAPH_REQUIRED);
+    if (gv.size()>4)
+        return gt_err(_GT_ERR_WRONG_NUMBER_OF_ARGS);
+    if (!gv[1].is_integer() || (k=gv[1].val)==0)
+        return generr(gettext("Expected a nonzero integer"));
+    for (const_iterateur it=gv.begin()+2;it!=gv.end();++it) {
+        if (parse_iteration_option(*it,tol,maxiter,contextptr)<=0)
+            return gentypeerr(contextptr);
+    }
+    n=G->node_count();
+    if (seidel && n<2)
+        return generr(gettext("Input graph must have at least two vertices"));
+    if (std::abs(k)>n)
+        return generr(gettext("The number of eigenvalues exceeds the number of vertices"));
+    graphe::dvector lambda;
+    try {
+        if (!G->spectrum_approx(k,seidel,lambda,tol,maxiter))
+            return generr(gettext("The iteration did not converge"));
+    } catch (const std::runtime_error &e) {
+        if (strstr(e.what(),"user interruption")!=NULL || interrupted || ctrl_c) {
+            ctrl_c=interrupted=false;
+            return generr(gettext("Stopped by user interruption"));
+        }
+        return generr(e.what());
+    }
+    return centrality_list(lambda,-1);
+}
+
+/* USAGE:   graph_spectrum(G,[k],[opts])
  *
  * Returns the graph spectrum of G. The return value is a list of lists with two
- * elements, each containing an eigenvalue and its multiplicity.
+ * elements, each containing an eigenvalue and its multiplicity. If a nonzero
+ * integer k is given, the list of |k| largest (k>0) or smallest (k<0)
+ * eigenvalues of an undirected graph G is computed numerically by the
+ * Lanczos method, with the options tolerance=tol and maxiter=n.
  */
 gen _graph_spectrum(const gen &g,GIAC_CONTEXT) {
     if (g.type==_STRNG && g.subtype==-1) return g;
+    if (is_seq_vect(g) && g._VECTptr->size()>1)
+        return spectrum_approx(*g._VECTptr,false,contextptr);
     graphe *G=graphe::from_gen(g);
     if (G==NULL)
         return gt_err(_GT_ERR_NOT_A_GRAPH);
@@ -5864,13 +6077,17 @@ static const char _graph_spectrum_s[]="graph_spectrum";
 static define_unary_function_eval(__graph_spectrum,&_graph_spectrum,_graph_spectrum_s);
 define_unary_function_ptr5(at_graph_spectrum,alias_at_graph_spectrum,&__graph_spectrum,0,true)
 
-/* USAGE:   seidel_spectrum(G)
+/* USAGE:   seidel_spectrum(G,[k],[opts])
  *
  * Returns the Seidel spectrum of G. The return value is a list of lists with two
- * elements, each containing an eigenvalue and its multiplicity.
+ * elements, each containing an eigenvalue and its multiplicity. If a nonzero
+ * integer k is given, the |k| largest (k>0) or smallest (k<0) eigenvalues are
+ * computed numerically, as in graph_spectrum.
  */
 gen _seidel_spectrum(const gen &g,GIAC_CONTEXT) {
     if (g.type==_STRNG && g.subtype==-1) return g;
+    if (is_seq_vect(g) && g._VECTptr->size()>1)
+        return spectrum_approx(*g._VECTptr,true,contextptr);
     graphe *G=graphe::from_gen(g);
     if (G==NULL)
         return gt_err(_GT_ERR_NOT_A_GRAPH);
@@ -5895,6 +6112,202 @@ static const char _seidel_spectrum_s[]="seidel_spectrum";
 static define_unary_function_eval(__seidel_spectrum,&_seidel_spectrum,_seidel_spectrum_s);
 define_unary_function_ptr5(at_seidel_spectrum,alias_at_seidel_spectrum,&__seidel_spectrum,0,true)
 
+/* parse the arguments G,[opts] of algebraic_connectivity (what=0), fiedler_vector
+ * (what=1) or spectral_bisection (what=2) and return the result */
+gen fiedler_command(const gen &g,int what,GIAC_CONTEXT) {
+    int maxiter=LANCZOS_MAXITER;
+    double tol=LANCZOS_TOLERANCE;
+    graphe *G;
+    if (is_seq_vect(g)) {
+        const vecteur &gv=*g._VECTptr;
+        if (gv.size()<2 || gv.size()>3)
+            return gt_err(_GT_ERR_WRONG_NUMBER_OF_ARGS);
+        for (const_iterateur it=gv.begin()+1;it!=gv.end();++it) {
+            if (parse_iteration_option(*it,tol,maxiter,contextptr)<=0)
+                return gentypeerr(contextptr);
+        }
+        G=graphe::from_gen(gv.front());
+    } else G=graphe::from_gen(g);
+    if (G==NULL)
+        return gt_err(_GT_ERR_NOT_A_GRAPH);
+    if (G->is_directed())
+        return gt_err(_GT_ERR_UNDIRECTED_GRAPH_REQUIRED);
+    if (G->node_count()<2)
+        return generr(gettext("Input graph must have at least two vertices"));
+    if (G->is_weighted() && !G->adjacency_snapshot(true).has_numeric_weights())
+        return generr(gettext("Weights must be real numbers"));
+    graphe::dvector x;
+    graphe::ivector part1,part2;
+    double lambda2;
+    bool res;
+    try {
+        res=what==2?G->spectral_bisection(part1,part2,tol,maxiter):G->fiedler_vector(x,lambda2,tol,maxiter);
+    } catch (const std::runtime_error &e) {
+        if (strstr(e.what(),"user interruption")!=NULL || interrupted || ctrl_c) {
+            ctrl_c=interrupted=false;
+            return generr(gettext("Stopped by user interruption"));
+        }
+        return generr(e.what());
+    }
+    if (!res)
+        return generr(gettext("The iteration did not converge"));
+    switch (what) {
+    case 0:
+        return lambda2;
+    case 1:
+        return centrality_list(x,-1);
+    default:
+        return makevecteur(G->get_node_labels(part1),G->get_node_labels(part2));
+    }
+}
+
+/* USAGE:   algebraic_connectivity(G,[opts])
+ *
+ * Returns the algebraic connectivity of an undirected graph G, i.e. the second
+ * smallest eigenvalue of its Laplacian (weighted if G is weighted), computed
+ * numerically by the multilevel Lanczos method. Options tolerance=tol and
+ * maxiter=n control the iteration.
+ */
+gen _algebraic_connectivity(const gen &g,GIAC_CONTEXT) {
+    if (g.type==_STRNG && g.subtype==-1) return g;
+    return fiedler_command(g,0,contextptr);
+}
+static const char _algebraic_connectivity_s[]="algebraic_connectivity";
+static define_unary_function_eval(__algebraic_connectivity,&_algebraic_connectivity,_algebraic_connectivity_s);
+define_unary_function_ptr5(at_algebraic_connectivity,alias_at_algebraic_connectivity,&__algebraic_connectivity,0,true)
+
+/* USAGE:   fiedler_vector(G,[opts])
+ *
+ * Returns the Fiedler vector of an undirected graph G, i.e. the unit eigenvector
+ * of the Laplacian belonging to the algebraic connectivity, as a list of
+ * components in order as returned by vertices(G).
+ */
+gen _fiedler_vector(const gen &g,GIAC_CONTEXT) {
+    if (g.type==_STRNG && g.subtype==-1) return g;
+    return fiedler_command(g,1,contextptr);
+}
+static const char _fiedler_vector_s[]="fiedler_vector";
+static define_unary_function_eval(__fiedler_vector,&_fiedler_vector,_fiedler_vector_s);
+define_unary_function_ptr5(at_fiedler_vector,alias_at_fiedler_vector,&__fiedler_vector,0,true)
+
+/* USAGE:   spectral_bisection(G,[opts])
+ *
+ * Returns a partition of the vertices of an undirected graph G into two halves
+ * of (almost) equal size, obtained by splitting at the median component of
+ * the Fiedler vector.
+ */
+gen _spectral_bisection(const gen &g,GIAC_CONTEXT) {
+    if (g.type==_STRNG && g.subtype==-1) return g;
+    return fiedler_command(g,2,contextptr);
+}
+static const char _spectral_bisection_s[]="spectral_bisection";
+static define_unary_function_eval(__spectral_bisection,&_spectral_bisection,_spectral_bisection_s);
+define_unary_function_ptr5(at_spectral_bisection,alias_at_spectral_bisection,&__spectral_bisection,0,true)
+
+/* parse the resolution parameter gamma, return false if it is not a positive real number */
+bool parse_resolution(const gen &g,double &gamma,GIAC_CONTEXT) {
+    if (!is_real_number(g,contextptr))
+        return false;
+    gamma=to_real_number(g,contextptr).to_double(contextptr);
+    return gamma>0;
+}
+
+/* USAGE:   communities(G,[gamma])
+ *
+ * Returns a partition of the vertices of an undirected graph G into
+ * communities, found by maximizing the modularity with resolution parameter
+ * gamma (by default 1) using the Louvain method with parallel local moving.
+ * Each community induces a connected subgraph of G. If G is weighted, the
+ * edge weights must be nonnegative.
+ */
+gen _communities(const gen &g,GIAC_CONTEXT) {
+    if (g.type==_STRNG && g.subtype==-1) return g;
+    double gamma=1.0;
+    graphe *G;
+    if (is_seq_vect(g)) {
+        const vecteur &gv=*g._VECTptr;
+        if (gv.size()!=2)
+            return gt_err(_GT_ERR_WRONG_NUMBER_OF_ARGS);
+        if (!parse_resolution(gv.back(),gamma,contextptr))
+            return generr(gettext("Resolution must be a positive real number"));
+        G=graphe::from_gen(gv.front());
+    } else G=graphe::from_gen(g);
+    if (G==NULL)
+        return gt_err(_GT_ERR_NOT_A_GRAPH);
+    if (G->is_directed())
+        return gt_err(_GT_ERR_UNDIRECTED_GRAPH_REQUIRED);
+    if (G->is_weighted() && !has_nonnegative_weights(G))
+        return generr(gettext("Weights must be nonnegative real numbers"));
+    graphe::ivectors comm;
+    int nc;
+    try {
+        nc=G->communities_to_subgraphs(gamma);
+    } catch (const std::runtime_error &e) {
+        if (strstr(e.what(),"user interruption")!=NULL || interrupted || ctrl_c) {
+            ctrl_c=interrupted=false;
+            return generr(gettext("Stopped by user interruption"));
+        }
+        return generr(e.what());
+    }
+    comm.resize(nc);
+    for (int s=0;s<nc;++s) {
+        G->get_subgraph(s+1,comm[s]);
+    }
+    vecteur res;
+    G->ivectors2vecteur(comm,res,true);
+    return change_subtype(res,_LIST__VECT);
+}
+static const char _communities_s[]="communities";
+static define_unary_function_eval(__communities,&_communities,_communities_s);
+define_unary_function_ptr5(at_communities,alias_at_communities,&__communities,0,true)
+
+/* USAGE:   modularity(G,P,[gamma])
+ *
+ * Returns the modularity of the partition P of the vertices of an undirected
+ * graph G, given as a list of lists of vertices, with resolution parameter
+ * gamma (by default 1). If G is weighted, the edge weights must be
+ * nonnegative.
+ */
+gen _modularity(const gen &g,GIAC_CONTEXT) {
+    if (g.type==_STRNG && g.subtype==-1) return g;
+    if (!is_seq_vect(g))
+        return gentypeerr(contextptr);
+    const vecteur &gv=*g._VECTptr;
+    if (gv.size()<2 || gv.size()>3)
+        return gt_err(_GT_ERR_WRONG_NUMBER_OF_ARGS);
+    double gamma=1.0;
+    if (gv.size()==3 && !parse_resolution(gv.back(),gamma,contextptr))
+        return generr(gettext("Resolution must be a positive real number"));
+    graphe *G=graphe::from_gen(gv.front());
+    if (G==NULL)
+        return gt_err(_GT_ERR_NOT_A_GRAPH);
+    if (G->is_directed())
+        return gt_err(_GT_ERR_UNDIRECTED_GRAPH_REQUIRED);
+    if (G->is_weighted() && !has_nonnegative_weights(G))
+        return generr(gettext("Weights must be nonnegative real numbers"));
+    if (gv[1].type!=_VECT)
+        return gentypeerr(contextptr);
+    graphe::ivector community(G->node_count(),-1);
+    int c=0,i;
+    for (const_iterateur it=gv[1]._VECTptr->begin();it!=gv[1]._VECTptr->end();++it,++c) {
+        if (it->type!=_VECT)
+            return gentypeerr(contextptr);
+        for (const_iterateur jt=it->_VECTptr->begin();jt!=it->_VECTptr->end();++jt) {
+            if ((i=G->node_index(*jt))<0)
+                return gt_err(*jt,_GT_ERR_VERTEX_NOT_FOUND);
+            if (community[i]>=0)
+                return generr(gettext("Communities must be disjoint"));
+            community[i]=c;
+        }
+    }
+    if (std::find(community.begin(),community.end(),-1)!=community.end())
+        return generr(gettext("Communities must cover all vertices"));
+    return G->modularity(community,gamma);
+}
+static const char _modularity_s[]="modularity";
+static define_unary_function_eval(__modularity,&_modularity,_modularity_s);
+define_unary_function_ptr5(at_modularity,alias_at_modularity,&__modularity,0,true)
+
 /* USAGE:   graph_charpoly(G,[x])
  *
  * Returns the value p(x) of the characteristic polynomial p of an undirected
@@ -5970,20 +6383,52 @@ static const char _spanning_tree_s[]="spanning_tree";
 static define_unary_function_eval(__spanning_tree,&_spanning_tree,_spanning_tree_s);
 define_unary_function_ptr5(at_spanning_tree,alias_at_spanning_tree,&__spanning_tree,0,true)
 
-/* USAGE:   number_of_spanning_trees(G)
+/* USAGE:   number_of_spanning_trees(G,[approx])
  *
  * Returns the number of spanning trees in the undirected graph G if it is
- * connected, else return the number of spanning forests.
+ * connected, else return the number of spanning forests. If G is unweighted
+ * or its weights are positive integers, the determinant of the reduced
+ * Laplacian is computed modulo word-size primes in parallel. If the option
+ * approx is given, the natural logarithm of that number is returned,
+ * computed in floating-point arithmetic.
  */
 gen _number_of_spanning_trees(const gen &g,GIAC_CONTEXT) {
     if (g.type==_STRNG && g.subtype==-1) return g;
-    graphe *G=graphe::from_gen(g);
+    graphe *G;
+    bool approx=false;
+    if (is_seq_vect(g)) {
+        const vecteur &gv=*g._VECTptr;
+        if (gv.size()!=2)
+            return gt_err(_GT_ERR_WRONG_NUMBER_OF_ARGS);
+        if (gv.back()!=at_approx)
+            return generrtype(gettext("Unrecognized option"));
+        approx=true;
+        G=graphe::from_gen(gv.front());
+    } else G=graphe::from_gen(g);
     if (G==NULL)
         return gt_err(_GT_ERR_NOT_A_GRAPH);
     if (G->is_null())
         return gt_err(_GT_ERR_GRAPH_IS_NULL);
     if (G->is_directed())
         return gt_err(_GT_ERR_UNDIRECTED_GRAPH_REQUIRED);
+    try {
+        if (approx) {
+            double res;
+            if (!G->spanning_forest_count_log(res))
+                return generr(gettext("Weights must be positive real numbers"));
+            return res;
+        }
+        gen res=G->spanning_forest_count();
+        if (!is_undef(res))
+            return res;
+    } catch (const std::runtime_error &e) {
+        if (strstr(e.what(),"user interruption")!=NULL || interrupted || ctrl_c) {
+            ctrl_c=interrupted=false;
+            return generr(gettext("Stopped by user interruption"));
+        }
+        return generr(e.what());
+    }
+    /* weights are not positive integers, compute the determinants exactly */
     if (!G->is_connected()) {
         gen res(1);
         graphe C(contextptr,false);
@@ -6245,7 +6690,7 @@ gen _plane_dual(const gen &g,GIAC_CONTEXT) {
             return generr(gettext("Input graph must have at least three vertices"));
         if (!G->is_biconnected())
             return gt_err(_GT_ERR_BICONNECTED_GRAPH_REQUIRED);
-        else if (!G->demoucron(faces))
+        else if (!G->planar_faces(faces))
             return gt_err(_GT_ERR_NOT_PLANAR);
     } else if (g.type==_VECT) {
         gen_map m;
@@ -6352,6 +6797,8 @@ define_unary_function_ptr5(at_set_vertex_positions,alias_at_set_vertex_positions
  * each s. If parameter k is given, the number of k-cliques is returned. If an
  * interval m..n is given, only cliques with size between m and n (inclusive)
  * are counted (m also may be +infinity).
+ * The cliques are enumerated in parallel, vertex neighborhoods being processed
+ * in degeneracy order. Only the cliques of the requested sizes are kept.
  */
 gen _find_cliques(const gen &g,GIAC_CONTEXT) {
     if (g.type==_STRNG && g.subtype==-1) return g;
@@ -6388,17 +6835,20 @@ gen _find_cliques(const gen &g,GIAC_CONTEXT) {
     if (G->is_directed())
         return gt_err(_GT_ERR_UNDIRECTED_GRAPH_REQUIRED);
     map<int,int> stats,tmp;
-    G->clique_stats(stats,mode);
+    clique_filter cf;
+    cf.lb=lb;
+    cf.ub=ub;
+    if (mode==3)
+        G->enumerate_maximal_cliques(stats,NULL,store_filtered_clique,(void*)&cf);
+    else G->enumerate_maximal_cliques(stats);
     if (mode==3 && !stats.empty()) {
-        const graphe::ivectors &mc=G->maximal_cliques();
+        std::sort(cf.cliques.begin(),cf.cliques.end());
         vecteur cg;
         int sz;
-        for (graphe::ivectors_iter it=mc.begin();it!=mc.end();++it) {
+        for (graphe::ivectors_iter it=cf.cliques.begin();it!=cf.cliques.end();++it) {
             sz=it->size();
-            if (sz>=lb && sz<=ub) {
-                cg.push_back(G->get_node_labels(*it));
-                ++tmp[sz];
-            }
+            cg.push_back(G->get_node_labels(*it));
+            ++tmp[sz];
         }
         gen_map gm;
         for (map<int,int>::const_iterator it=tmp.begin();it!=tmp.end();++it) {
@@ -6611,6 +7061,63 @@ static const char _is_subgraph_isomorphic_s[]="is_subgraph_isomorphic";
 static define_unary_function_eval(__is_subgraph_isomorphic,&_is_subgraph_isomorphic,_is_subgraph_isomorphic_s);
 define_unary_function_ptr5(at_is_subgraph_isomorphic,alias_at_is_subgraph_isomorphic,&__is_subgraph_isomorphic,0,true)
 
+/* USAGE:   subgraph_isomorphisms(G1,G2,[induced_subgraph],[N])
+ *
+ * Returns the list of all (at most N if specified) embeddings of graph G1 into
+ * G2, i.e. isomorphisms between G1 and subgraphs of G2 (induced subgraphs if the
+ * option 'induced_subgraph' is given). Each embedding is returned as a list of
+ * equations v=w, where w is the image of the vertex v of G1.
+ */
+gen _subgraph_isomorphisms(const gen &g,GIAC_CONTEXT) {
+    if (g.type==_STRNG && g.subtype==-1) return g;
+    if (g.type!=_VECT || g.subtype!=_SEQ__VECT)
+        return gentypeerr(contextptr);
+    bool induced=false;
+    int limit=0;
+    const vecteur &gv=*g._VECTptr;
+    if (gv.size()<2)
+        return gt_err(_GT_ERR_WRONG_NUMBER_OF_ARGS);
+    graphe *G1=graphe::from_gen(gv[0]),*G2=graphe::from_gen(gv[1]);
+    if (G1==NULL || G2==NULL)
+        return gt_err(_GT_ERR_NOT_A_GRAPH);
+    if (G1->is_directed()!=G2->is_directed())
+        return generr(gettext("Both graphs must be (un)directed"));
+    for (const_iterateur it=gv.begin()+2;it!=gv.end();++it) {
+        if (*it==at_induced_subgraph)
+            induced=true;
+        else if (it->is_integer() && it->val>0)
+            limit=it->val;
+        else return generr(gettext("Invalid argument"));
+    }
+    vecteur mappings;
+    if (G1->node_count()>G2->node_count() || G1->edge_count()>G2->edge_count())
+        return mappings;
+    /* the matches are sorted, so the result does not depend on the thread timing */
+    graphe::ivectors found;
+    try {
+        G2->subgraph_isomorphism(*G1,limit,induced,found);
+    } catch (const std::runtime_error &e) {
+        if (strstr(e.what(),"user interruption")!=NULL || interrupted || ctrl_c) {
+            ctrl_c=interrupted=false;
+            return generr(gettext("Stopped by user interruption"));
+        }
+        return generr(e.what());
+    }
+    mappings.reserve(found.size());
+    for (graphe::ivectors_iter it=found.begin();it!=found.end();++it) {
+        vecteur mapping;
+        mapping.reserve(it->size());
+        for (graphe::ivector_iter jt=it->begin();jt!=it->end();++jt) {
+            mapping.push_back(symb_equal(G1->node_label(jt-it->begin()),G2->node_label(*jt)));
+        }
+        mappings.push_back(mapping);
+    }
+    return mappings;
+}
+static const char _subgraph_isomorphisms_s[]="subgraph_isomorphisms";
+static define_unary_function_eval(__subgraph_isomorphisms,&_subgraph_isomorphisms,_subgraph_isomorphisms_s);
+define_unary_function_ptr5(at_subgraph_isomorphisms,alias_at_subgraph_isomorphisms,&__subgraph_isomorphisms,0,true)
+
 /* USAGE:   identify_graph(G,[opts])
  *
  * Returns the list of special graphs which are isomorphic to G.
@@ -6692,6 +7199,43 @@ static const char _canonical_labeling_s[]="canonical_labeling";
 static define_unary_function_eval(__canonical_labeling,&_canonical_labeling,_canonical_labeling_s);
 define_unary_function_ptr5(at_canonical_labeling,alias_at_canonical_labeling,&__canonical_labeling,0,true)
 
+/* USAGE:   nonisomorphic_graphs(L)
+ *
+ * Returns the list of graphs in L with isomorphic copies removed, i.e. only
+ * the first graph from each isomorphism class is kept. Graphs are compared by
+ * their canonical certificates, which are cached.
+ */
+gen _nonisomorphic_graphs(const gen &g,GIAC_CONTEXT) {
+    if (g.type==_STRNG && g.subtype==-1) return g;
+    if (g.type!=_VECT)
+        return gentypeerr(contextptr);
+    const vecteur &L=*g._VECTptr;
+    vector<graphe*> graphs(L.size());
+    for (const_iterateur it=L.begin();it!=L.end();++it) {
+        if ((graphs[it-L.begin()]=graphe::from_gen(*it))==NULL)
+            return gt_err(_GT_ERR_NOT_A_GRAPH);
+    }
+    graphe::ivector rep;
+    try {
+        graphe::nonisomorphic_representatives(graphs,rep);
+    } catch (const std::runtime_error &e) {
+        if (strstr(e.what(),"user interruption")!=NULL || interrupted || ctrl_c) {
+            ctrl_c=interrupted=false;
+            return generr(gettext("Stopped by user interruption"));
+        }
+        return generr(e.what());
+    }
+    vecteur res;
+    res.reserve(rep.size());
+    for (graphe::ivector_iter it=rep.begin();it!=rep.end();++it) {
+        res.push_back(L[*it]);
+    }
+    return change_subtype(res,_LIST__VECT);
+}
+static const char _nonisomorphic_graphs_s[]="nonisomorphic_graphs";
+static define_unary_function_eval(__nonisomorphic_graphs,&_nonisomorphic_graphs,_nonisomorphic_graphs_s);
+define_unary_function_ptr5(at_nonisomorphic_graphs,alias_at_nonisomorphic_graphs,&__nonisomorphic_graphs,0,true)
+
 /* USAGE:   minimal_edge_coloring(G,[sto])
  *
  * Finds the minimal edge coloring of the input graph G and returns the
@@ -6813,12 +7357,17 @@ define_unary_function_ptr5(at_is_hamiltonian,alias_at_is_hamiltonian,&__is_hamil
  * graph G. If G is not weighted, its adjacency matrix is used instead.
  * Alternatively, weight matrix may be passed as the optional parameter M.
  * If G is not Hamiltonian, an error is returned.
+ * With the option approx, a short tour in a complete graph is found by
+ * chained Lin-Kernighan searches running in parallel, for at most t seconds
+ * (a positive integer) if limit=t is given after approx. If vertex_distance
+ * is given as well, the edges of G are ignored and the tour may join any two
+ * vertices, so G need not be complete.
  */
 gen _traveling_salesman(const gen &g,GIAC_CONTEXT) {
     if (g.type==_STRNG && g.subtype==-1) return g;
     matrice M;
     vecteur options;
-    bool verbose=false;
+    bool verbose=false,implicit=false;
     double gap_tol=0;
     if (is_seq_vect(g)) {
         int pos=1;
@@ -6888,8 +7437,6 @@ gen _traveling_salesman(const gen &g,GIAC_CONTEXT) {
         if (hcv.empty())
             return generr(gettext("Unable to find a Hamiltonian cycle"));
     } else {
-        if (G->hamcond()==0)
-            return generr(gettext("Input graph is not Hamiltonian"));
         /* parse options */
         bool approximate=false,make_distances=false;
         int time_limit=rand_max2;
@@ -6914,29 +7461,43 @@ gen _traveling_salesman(const gen &g,GIAC_CONTEXT) {
                 else k=it->val;
             } else return generr(gettext("Option not supported"));
         }
-        if (time_limit<0)
-            return generr(gettext("Expected a nonnegative integer"));
+        if (time_limit<=0)
+            return generr(gettext("Expected a positive integer"));
+        /* Euclidean tours are approximated without materializing the edges */
+        implicit=approximate && make_distances;
         if (make_distances) {
+            graphe::layout x;
             if (G->is_weighted())
                 return gt_err(_GT_ERR_UNWEIGHTED_GRAPH_REQUIRED);
-            if (!G->make_euclidean_distances())
+            if (implicit ? !G->has_stored_layout(x) : !G->make_euclidean_distances())
                 return generr(gettext("Some vertex positions are invalid"));
         }
-        G->underlying(U);
+        if (implicit ? G->node_count()<3 : G->hamcond()==0)
+            return generr(gettext("Input graph is not Hamiltonian"));
         int res;
-        double cost;
-        if (approximate) {
-            if (!G->is_weighted())
-                gt_err(_GT_ERR_WEIGHTED_GRAPH_REQUIRED);
-            if (!G->is_clique())
-                return generr(gettext("Input graph must be complete"));
-            G->traveling_salesman(k=0,hcv,costs,gap_tol,verbose);
-        } else {
-            res=U.is_biconnected()?G->traveling_salesman(k=1,hcv,costs,gap_tol,verbose):0;
-            if (res==0)
-                return generr(gettext("Input graph is not Hamiltonian"));
-            if (res==-1)
-                return undef;
+        try {
+            if (approximate) {
+                if (!implicit && !G->is_weighted())
+                    return gt_err(_GT_ERR_WEIGHTED_GRAPH_REQUIRED);
+                if (!implicit && !G->is_clique())
+                    return generr(gettext("Input graph must be complete"));
+                res=G->traveling_salesman(k=0,hcv,costs,gap_tol,verbose,make_distances,time_limit<rand_max2?time_limit:0);
+                if (res!=1)
+                    return generr(gettext("Unable to find a Hamiltonian cycle"));
+            } else {
+                G->underlying(U);
+                res=U.is_biconnected()?G->traveling_salesman(k=1,hcv,costs,gap_tol,verbose,make_distances):0;
+                if (res==0)
+                    return generr(gettext("Input graph is not Hamiltonian"));
+                if (res==-1)
+                    return undef;
+            }
+        } catch (const std::runtime_error &e) {
+            if (strstr(e.what(),"user interruption")!=NULL || interrupted || ctrl_c) {
+                ctrl_c=interrupted=false;
+                return generr(gettext("Stopped by user interruption"));
+            }
+            return generr(e.what());
         }
     }
     /* success */
@@ -6946,7 +7507,7 @@ gen _traveling_salesman(const gen &g,GIAC_CONTEXT) {
     for (iterateur it=cv.begin();it!=cv.end();++it) {
         *it=gen(costs[it-cv.begin()]);
     }
-    if (G->is_weighted())
+    if (G->is_weighted() || implicit)
         return makesequence(k<=1?cv.front():cv,k<=1?res.front():res);
     return k==1?res.front():res;
 }
@@ -6981,6 +7542,10 @@ define_unary_function_ptr5(at_trail2edges,alias_at_trail2edges,&__trail2edges,0,
  *
  * Returns the optimal value for the max flow problem for network G with the
  * source s and sink t [along with an optimal flow F (as a matrix)].
+ * If the capacities are numeric and exactly representable as floating-point
+ * numbers, the highest-label push-relabel algorithm (Dinic's algorithm for
+ * unit capacities) is used, otherwise the flow is computed exactly by
+ * Edmonds-Karp algorithm.
  */
 gen _maxflow(const gen &g,GIAC_CONTEXT) {
     if (g.type==_STRNG && g.subtype==-1) return g;
@@ -7004,9 +7569,26 @@ gen _maxflow(const gen &g,GIAC_CONTEXT) {
     int s=G->node_index(S),t=G->node_index(T);
     if (s<0 || t<0)
         return gt_err(s<0?S:T,_GT_ERR_VERTEX_NOT_FOUND);
+    int n=G->node_count();
+    graphe::flow_network F(n);
+    if ((!G->is_weighted() || G->adjacency_snapshot(true).has_exact_weights()) && G->make_flow_network(F)) {
+        /* numeric capacities, use the push-relabel (or Dinic) algorithm */
+        const graphe::csr_adjacency &A=G->adjacency_snapshot(true);
+        bool integral=!G->is_weighted() || A.has_integral_weights();
+        gen mf=flow_value(F.max_flow(s,t),integral);
+        if (!is_undef(M)) {
+            matrice m=*_matrix(makesequence(n,n,0),contextptr)._VECTptr;
+            for (int i=0;i<n;++i) {
+                for (int k=A.arc_begin(i);k<A.arc_end(i);++k) {
+                    m[i]._VECTptr->at(A.head(k))=flow_value(std::max(F.flow(k),0.0),integral);
+                }
+            }
+            identifier_assign(*M._IDNTptr,m,contextptr);
+        }
+        return mf;
+    }
     vector<map<int,gen> > flow;
     gen mf=G->maxflow_edmonds_karp(s,t,flow);
-    int n=G->node_count();
     if (!is_undef(M)) {
         matrice m=*_matrix(makesequence(n,n,0),contextptr)._VECTptr;
         for (int i=0;i<n;++i) {
@@ -7044,10 +7626,16 @@ gen _minimum_cut(const gen &g,GIAC_CONTEXT) {
     int s=G->node_index(S),t=G->node_index(T);
     if (s<0 || t<0)
         return gt_err(s<0?S:T,_GT_ERR_VERTEX_NOT_FOUND);
-    vector<map<int,gen> > flow;
-    G->maxflow_edmonds_karp(s,t,flow);
     graphe::ipairs cut;
-    G->minimum_cut(s,flow,cut);
+    graphe::flow_network F(G->node_count());
+    if ((!G->is_weighted() || G->adjacency_snapshot(true).has_exact_weights()) && G->make_flow_network(F)) {
+        F.max_flow(s,t);
+        G->minimum_cut(s,F,cut);
+    } else {
+        vector<map<int,gen> > flow;
+        G->maxflow_edmonds_karp(s,t,flow);
+        G->minimum_cut(s,flow,cut);
+    }
     vecteur res=G->ipairs2edges(cut);
     return change_subtype(res,_LIST__VECT);
 }
@@ -7055,6 +7643,43 @@ static const char _minimum_cut_s[]="minimum_cut";
 static define_unary_function_eval(__minimum_cut,&_minimum_cut,_minimum_cut_s);
 define_unary_function_ptr5(at_minimum_cut,alias_at_minimum_cut,&__minimum_cut,0,true)
 
+/* USAGE:   gomory_hu_tree(G)
+ *
+ * Returns the Gomory-Hu tree of an undirected graph G with nonnegative
+ * numeric edge weights (capacities), i.e. a weighted tree on the vertices of
+ * G such that the minimum cut capacity between any two vertices in G is equal
+ * to the minimal weight on the path between them in the tree. Only n-1
+ * maximum flows are computed (Gusfield's algorithm).
+ */
+gen _gomory_hu_tree(const gen &g,GIAC_CONTEXT) {
+    if (g.type==_STRNG && g.subtype==-1) return g;
+    graphe *G=graphe::from_gen(g);
+    if (G==NULL)
+        return gt_err(_GT_ERR_NOT_A_GRAPH);
+    if (G->is_directed())
+        return gt_err(_GT_ERR_UNDIRECTED_GRAPH_REQUIRED);
+    if (G->is_null())
+        return gt_err(_GT_ERR_GRAPH_IS_NULL);
+    int n=G->node_count();
+    graphe::flow_network F(n);
+    if (!G->make_flow_network(F))
+        return generr(gettext("Weights must be nonnegative real numbers"));
+    bool integral=!G->is_weighted() || G->adjacency_snapshot(true).has_integral_weights();
+    graphe::ivector parent;
+    graphe::dvector cut;
+    graphe::gomory_hu_tree(F,parent,cut);
+    graphe T(contextptr);
+    T.add_nodes(G->vertices());
+    T.set_weighted(true);
+    for (int i=1;i<n;++i) {
+        T.add_edge(i,parent[i],flow_value(cut[i],integral));
+    }
+    return T;
+}
+static const char _gomory_hu_tree_s[]="gomory_hu_tree";
+static define_unary_function_eval(__gomory_hu_tree,&_gomory_hu_tree,_gomory_hu_tree_s);
+define_unary_function_ptr5(at_gomory_hu_tree,alias_at_gomory_hu_tree,&__gomory_hu_tree,0,true)
+
 /* USAGE:   is_network(G,[s,t])
  *
  * Returns true if the graph G is a network with the source s and sink t, else
@@ -7278,6 +7903,11 @@ define_unary_function_ptr5(at_random_network,alias_at_random_network,&__random_n
  * Returns the Tutte polynomial (with x and y as its variables or
  * their values) of an undirected graph G. If G is weighted, all weights must
  * be positive integers and are interpreted as edge multiplicities.
+ * Polynomials of the biconnected minors encountered during the computation
+ * are kept in a cache (bounded in size) which persists between calls, so
+ * that related graphs are processed faster. If threads are enabled, the
+ * deletion and contraction branches of large minors are processed in
+ * parallel.
  */
 gen _tutte_polynomial(const gen &g,GIAC_CONTEXT) {
     if (g.type==_STRNG && g.subtype==-1) return g;
@@ -7559,7 +8189,8 @@ define_unary_function_ptr5(at_mycielski,alias_at_mycielski,&__mycielski,0,true)
 /* USAGE:   clustering_coefficient(G,[v])
  *
  * Returns the [local] clustering coefficient [of the vertex v or vertices from
- * a sequence or list v] of an undirected graph G.
+ * a sequence or list v] of an undirected graph G. Local coefficients of
+ * several vertices are obtained from a single (parallel) triangle count.
  */
 gen _clustering_coefficient(const gen &g,GIAC_CONTEXT) {
     if (g.type==_STRNG && g.subtype==-1) return g;
@@ -7593,13 +8224,20 @@ gen _clustering_coefficient(const gen &g,GIAC_CONTEXT) {
         return gt_err(_GT_ERR_UNDIRECTED_GRAPH_REQUIRED);
     if (V.empty())
         return G->clustering_coeff(apprx,exct);
-    int i;
+    int i,d;
     vecteur res;
+    vector<ulong> tri;
+    if (V.size()>1) // count the triangles through all vertices in a single pass
+        G->vertex_triangle_counts(tri);
     for (const_iterateur it=V.begin();it!=V.end();++it) {
         i=G->node_index(*it);
         if (i<0)
             return gt_err(*it,_GT_ERR_VERTEX_NOT_FOUND);
-        res.push_back(G->degree(i)<2?0:G->local_clustering_coeff(i));
+        if ((d=G->degree(i))<2)
+            res.push_back(0);
+        else if (tri.empty())
+            res.push_back(G->local_clustering_coeff(i));
+        else res.push_back(_ratnormal(fraction(gen(longlong(2*tri[i])),gen(d)*gen(d-1)),contextptr));
     }
     if (res.size()==1)
         return res.front();
@@ -7807,7 +8445,7 @@ gen _truncate_graph(const gen &g,GIAC_CONTEXT) {
     if (!G->is_biconnected())
         return gt_err(_GT_ERR_BICONNECTED_GRAPH_REQUIRED);
     graphe::ivectors faces;
-    if (!G->demoucron(faces))
+    if (!G->planar_faces(faces))
         return gt_err(_GT_ERR_NOT_PLANAR);
     G->truncate(H,faces);
     return H;
@@ -8136,27 +8774,57 @@ static const char _closeness_centrality_s[]="closeness_centrality";
 static define_unary_function_eval(__closeness_centrality,&_closeness_centrality,_closeness_centrality_s);
 define_unary_function_ptr5(at_closeness_centrality,alias_at_closeness_centrality,&__closeness_centrality,0,true)
 
-/* USAGE:   betweenness_centrality(G,[v])
+/* USAGE:   betweenness_centrality(G,[v],[opt])
  *
  * Returns the betweenness centrality measure of vertex v in G.
  * If v is omitted, the list of CC measures for all vertices
  * is returned, in order as returned by vertices(G).
  * Edge weights are ignored by this type of centrality.
+ * If option "approx" is given, the computation is done with
+ * floating-point values in parallel. If approx=k is given for a
+ * positive integer k, only k randomly chosen sources are used.
+ * If approx=eps is given for 0<eps<1, the number of sources is chosen
+ * such that the error of each value, divided by n(n-2) where n is the
+ * number of vertices, is smaller than eps with probability at least 0.9.
  */
 gen _betweenness_centrality(const gen &g,GIAC_CONTEXT) {
     if (g.type==_STRNG && g.subtype==-1) return g;
-    int k=-1;
+    int k=-1,samples=0;
+    double eps=0;
+    bool approx=false;
     graphe *G;
     if (is_seq_vect(g)) {
         const vecteur &gv=*g._VECTptr;
-        if (gv.size()!=2)
+        if (gv.size()<2 || gv.size()>3)
             return gt_err(_GT_ERR_WRONG_NUMBER_OF_ARGS);
         G=graphe::from_gen(gv.front());
         if (G==NULL)
             return gt_err(_GT_ERR_NOT_A_GRAPH);
-        k=G->node_index(gv.back());
-        if (k==-1)
-            return gt_err(gv.back(),_GT_ERR_VERTEX_NOT_FOUND);
+        for (const_iterateur it=gv.begin()+1;it!=gv.end();++it) {
+            if (*it==at_approx)
+                approx=true;
+            else if (is_equal(*it) && it->_SYMBptr->feuille._VECTptr->front()==at_approx) {
+                const gen &val=it->_SYMBptr->feuille._VECTptr->back();
+                approx=true;
+                if (val.is_integer()) {
+                    if (!is_strictly_positive(val,contextptr))
+                        return gentypeerr(contextptr);
+                    /* a bignum means more samples than vertices */
+                    samples=val.type==_INT_?val.val:G->node_count();
+                } else if (is_real_number(val,contextptr) &&
+                         (eps=to_real_number(val,contextptr).to_double(contextptr))>0 && eps<1) {
+                    /* Hoeffding's inequality with union bound over all vertices, more
+                     * samples than vertices are never needed since then the exact
+                     * computation is cheaper */
+                    double ns=std::ceil(std::log(20.0*G->node_count())/(2.0*eps*eps));
+                    samples=ns<G->node_count()?int(ns):G->node_count();
+                } else return gentypeerr(contextptr);
+            } else if (it==gv.begin()+1) {
+                k=G->node_index(*it);
+                if (k==-1)
+                    return gt_err(*it,_GT_ERR_VERTEX_NOT_FOUND);
+            } else return gentypeerr(contextptr);
+        }
     } else {
         G=graphe::from_gen(g);
         if (G==NULL)
@@ -8164,6 +8832,8 @@ gen _betweenness_centrality(const gen &g,GIAC_CONTEXT) {
     }
     if (G->is_empty())
         return generr(gettext("Graph is empty"));
+    if (approx)
+        return G->betweenness_centrality_approx(k,samples);
     return G->betweenness_centrality(k);
 }
 static const char _betweenness_centrality_s[]="betweenness_centrality";
@@ -8176,6 +8846,12 @@ define_unary_function_ptr5(at_betweenness_centrality,alias_at_betweenness_centra
  * If v is omitted, the list of CBC measures for all vertices is returned,
  * in order as returned by vertices(G).
  * Edge weights are ignored by this type of centrality.
+ * For undirected graphs, a single eigendecomposition of the adjacency matrix
+ * is computed in floating-point arithmetic and the vertex removals are
+ * handled as low-rank updates, which takes O(n^3) time in total. For digraphs,
+ * or if the error bound of this approximation is too large, the columns of the
+ * matrix exponentials are summed from their Taylor series in floating-point
+ * arithmetic, which takes O(n^2*m) time.
  */
 gen _communicability_betweenness_centrality(const gen &g,GIAC_CONTEXT) {
     if (g.type==_STRNG && g.subtype==-1) return g;
@@ -8219,25 +8895,33 @@ static const char _communicability_betweenness_centrality_s[]="communicability_b
 static define_unary_function_eval(__communicability_betweenness_centrality,&_communicability_betweenness_centrality,_communicability_betweenness_centrality_s);
 define_unary_function_ptr5(at_communicability_betweenness_centrality,alias_at_communicability_betweenness_centrality,&__communicability_betweenness_centrality,0,true)
 
-/* USAGE:   katz_centrality(G,alpha,[v])
+/* USAGE:   katz_centrality(G,alpha,[v],[opts])
  *
  * Returns the katz centrality measure of vertex v in G.
  * If v is omitted, the list of KC measures for all vertices
  * is returned, in order as returned by vertices(G).
  * The parameter alpha is attenuation factor which must lie between
- * 0 and 1. Setting it to a floating-point value will trigger
- * computation with floating-point values, which is faster for
- * larger networks.
+ * 0 and 1. If alpha is exact, the measures are computed exactly by
+ * inverting a dense matrix. Setting it to a floating-point value (or
+ * passing any of the options below) will trigger an iterative sparse
+ * solver working with floating-point values, which is suitable for large
+ * networks: the conjugate gradient method for undirected graphs and Jacobi
+ * iteration for digraphs (which requires alpha to be smaller than the
+ * reciprocal of the spectral radius of the adjacency matrix).
+ * Options tolerance=tol (default 1e-8) and maxiter=n (default 1000) control
+ * the stopping criterion of the iterative solver.
  * Edge weights are ignored by this type of centrality.
  */
 gen _katz_centrality(const gen &g,GIAC_CONTEXT) {
     if (g.type==_STRNG && g.subtype==-1) return g;
-    int k=-1;
+    int k=-1,maxiter=CENTRALITY_MAXITER,opt;
+    double tol=CENTRALITY_TOLERANCE;
+    bool approx=false;
     graphe *G;
     if (g.type!=_VECT || g.subtype!=_SEQ__VECT)
         return gentypeerr(contextptr);
     const vecteur &gv=*g._VECTptr;
-    if (gv.size()<2 || gv.size()>3)
+    if (gv.size()<2 || gv.size()>5)
         return gt_err(_GT_ERR_WRONG_NUMBER_OF_ARGS);
     G=graphe::from_gen(gv.front());
     if (G==NULL)
@@ -8247,10 +8931,28 @@ gen _katz_centrality(const gen &g,GIAC_CONTEXT) {
     const gen &alpha=gv[1];
     if (!is_real_number(alpha,contextptr))
         return gentypeerr(contextptr);
-    if (gv.size()==3) {
-        k=G->node_index(gv.back());
-        if (k==-1)
-            return gt_err(gv.back(),_GT_ERR_VERTEX_NOT_FOUND);
+    for (const_iterateur it=gv.begin()+2;it!=gv.end();++it) {
+        if ((opt=parse_iteration_option(*it,tol,maxiter,contextptr))<0)
+            return gentypeerr(contextptr);
+        if (opt>0)
+            approx=true;
+        else if (k<0 && it==gv.begin()+2) {
+            k=G->node_index(*it);
+            if (k==-1)
+                return gt_err(*it,_GT_ERR_VERTEX_NOT_FOUND);
+        } else return gentypeerr(contextptr);
+    }
+    if (approx || alpha.type==_DOUBLE_) {
+        graphe::dvector x;
+        switch (G->katz_centrality_approx(to_real_number(alpha,contextptr).to_double(contextptr),x,tol,maxiter)) {
+        case 0:
+            return generr(gettext("The iteration did not converge"));
+        case -1:
+            return generr(gettext("Alpha must be smaller than the reciprocal of the spectral radius"));
+        default:
+            break;
+        }
+        return centrality_list(x,k);
     }
     vecteur kc;
     try {
@@ -8270,6 +8972,118 @@ static const char _katz_centrality_s[]="katz_centrality";
 static define_unary_function_eval(__katz_centrality,&_katz_centrality,_katz_centrality_s);
 define_unary_function_ptr5(at_katz_centrality,alias_at_katz_centrality,&__katz_centrality,0,true)
 
+/* USAGE:   pagerank(G,[d],[v],[opts])
+ *
+ * Returns the PageRank of vertex v in G, computed by power iteration with
+ * damping factor d (by default 0.85), which must be a real number in (0,1]
+ * other than an integer (use 1.0 instead of 1). If v is omitted, the list of PageRank values for
+ * all vertices is returned, in order as returned by vertices(G). Vertices
+ * without outgoing arcs are treated as if they were linked to all vertices.
+ * If G is weighted, the transition probabilities are proportional to the
+ * edge weights, which must be nonnegative.
+ * Options tolerance=tol (default 1e-8) and maxiter=n (default 1000) control
+ * the stopping criterion (the sum of absolute changes of the values).
+ */
+gen _pagerank(const gen &g,GIAC_CONTEXT) {
+    if (g.type==_STRNG && g.subtype==-1) return g;
+    int k=-1,maxiter=CENTRALITY_MAXITER,opt;
+    double tol=CENTRALITY_TOLERANCE,d=0.85;
+    graphe *G;
+    if (is_seq_vect(g)) {
+        const vecteur &gv=*g._VECTptr;
+        if (gv.size()<2 || gv.size()>5)
+            return gt_err(_GT_ERR_WRONG_NUMBER_OF_ARGS);
+        G=graphe::from_gen(gv.front());
+        if (G==NULL)
+            return gt_err(_GT_ERR_NOT_A_GRAPH);
+        const_iterateur it=gv.begin()+1;
+        if (it->type!=_INT_ && it->type!=_ZINT && is_real_number(*it,contextptr)) { // integers are vertices
+            d=to_real_number(*it,contextptr).to_double(contextptr);
+            if (d<=0 || d>1)
+                return generr(gettext("Damping factor must be in (0,1]"));
+            ++it;
+        }
+        for (;it!=gv.end();++it) {
+            if ((opt=parse_iteration_option(*it,tol,maxiter,contextptr))<0)
+                return gentypeerr(contextptr);
+            if (opt==0) {
+                if (k>=0)
+                    return gentypeerr(contextptr);
+                k=G->node_index(*it);
+                if (k==-1)
+                    return gt_err(*it,_GT_ERR_VERTEX_NOT_FOUND);
+            }
+        }
+    } else {
+        G=graphe::from_gen(g);
+        if (G==NULL)
+            return gt_err(_GT_ERR_NOT_A_GRAPH);
+    }
+    if (G->is_empty())
+        return generr(gettext("Graph is empty"));
+    if (G->is_weighted() && !has_nonnegative_weights(G))
+        return generr(gettext("Weights must be nonnegative real numbers"));
+    graphe::dvector x;
+    if (!G->pagerank(d,x,tol,maxiter))
+        return generr(gettext("The iteration did not converge"));
+    return centrality_list(x,k);
+}
+static const char _pagerank_s[]="pagerank";
+static define_unary_function_eval(__pagerank,&_pagerank,_pagerank_s);
+define_unary_function_ptr5(at_pagerank,alias_at_pagerank,&__pagerank,0,true)
+
+/* USAGE:   eigenvector_centrality(G,[v],[opts])
+ *
+ * Returns the eigenvector centrality of vertex v in G, i.e. the
+ * corresponding component of the dominant eigenvector of the transposed
+ * adjacency matrix (normalized to unit Euclidean norm), computed by power
+ * iteration. If v is omitted, the list of centralities for all vertices
+ * is returned, in order as returned by vertices(G). If G is weighted, the
+ * edge weights (which must be nonnegative) are used as the matrix entries.
+ * Options tolerance=tol (default 1e-8) and maxiter=n (default 1000) control
+ * the stopping criterion (the largest absolute change of a component).
+ */
+gen _eigenvector_centrality(const gen &g,GIAC_CONTEXT) {
+    if (g.type==_STRNG && g.subtype==-1) return g;
+    int k=-1,maxiter=CENTRALITY_MAXITER,opt;
+    double tol=CENTRALITY_TOLERANCE;
+    graphe *G;
+    if (is_seq_vect(g)) {
+        const vecteur &gv=*g._VECTptr;
+        if (gv.size()<2 || gv.size()>4)
+            return gt_err(_GT_ERR_WRONG_NUMBER_OF_ARGS);
+        G=graphe::from_gen(gv.front());
+        if (G==NULL)
+            return gt_err(_GT_ERR_NOT_A_GRAPH);
+        for (const_iterateur it=gv.begin()+1;it!=gv.end();++it) {
+            if ((opt=parse_iteration_option(*it,tol,maxiter,contextptr))<0)
+                return gentypeerr(contextptr);
+            if (opt==0) {
+                if (k>=0)
+                    return gentypeerr(contextptr);
+                k=G->node_index(*it);
+                if (k==-1)
+                    return gt_err(*it,_GT_ERR_VERTEX_NOT_FOUND);
+            }
+        }
+    } else {
+        G=graphe::from_gen(g);
+        if (G==NULL)
+            return gt_err(_GT_ERR_NOT_A_GRAPH);
+    }
+    if (G->is_empty())
+        return generr(gettext("Graph is empty"));
+    if (G->is_weighted() && !has_nonnegative_weights(G))
+        return generr(gettext("Weights must be nonnegative real numbers"));
+    graphe::dvector x;
+    if (!G->eigenvector_centrality(x,tol,maxiter))
+        return generr(gettext("The iteration did not converge"));
+    return centrality_list(x,k);
+}
+static const char _eigenvector_centrality_s[]="eigenvector_centrality";
+static define_unary_function_eval(__eigenvector_centrality,&_eigenvector_centrality,_eigenvector_centrality_s);
+define_unary_function_ptr5(at_eigenvector_centrality,alias_at_eigenvector_centrality,&__eigenvector_centrality,0,true)
+
 /* USAGE:   is_split_graph(G,[part])
  *
  * Returns TRUE iff G is a split graph. In that case, if
@@ -236,6 +236,11 @@ gen _is_arborescence(const gen &g,GIAC_CONTEXT);
 gen _graph_spectrum(const gen &g,GIAC_CONTEXT);
 gen _graph_charpoly(const gen &g,GIAC_CONTEXT);
 gen _seidel_spectrum(const gen &g,GIAC_CONTEXT);
+gen _algebraic_connectivity(const gen &g,GIAC_CONTEXT);
+gen _fiedler_vector(const gen &g,GIAC_CONTEXT);
+gen _spectral_bisection(const gen &g,GIAC_CONTEXT);
+gen _communities(const gen &g,GIAC_CONTEXT);
+gen _modularity(const gen &g,GIAC_CONTEXT);
 gen _is_integer_graph(const gen &g,GIAC_CONTEXT);
 gen _spanning_tree(const gen &g,GIAC_CONTEXT);
 gen _number_of_spanning_trees(const gen &g,GIAC_CONTEXT);
@@ -254,15 +259,18 @@ gen _transitive_closure(const gen &g,GIAC_CONTEXT);
 gen _line_graph(const gen &g,GIAC_CONTEXT);
 gen _is_isomorphic(const gen &g,GIAC_CONTEXT);
 gen _is_subgraph_isomorphic(const gen &g,GIAC_CONTEXT);
+gen _subgraph_isomorphisms(const gen &g,GIAC_CONTEXT);
 gen _identify_graph(const gen &g,GIAC_CONTEXT);
 gen _graph_automorphisms(const gen &g,GIAC_CONTEXT);
 gen _canonical_labeling(const gen &g,GIAC_CONTEXT);
+gen _nonisomorphic_graphs(const gen &g,GIAC_CONTEXT);
 gen _minimal_edge_coloring(const gen &g,GIAC_CONTEXT);
 gen _chromatic_index(const gen &g,GIAC_CONTEXT);
 gen _is_hamiltonian(const gen &g,GIAC_CONTEXT);
 gen _traveling_salesman(const gen &g,GIAC_CONTEXT);
 gen _maxflow(const gen &g,GIAC_CONTEXT);
 gen _minimum_cut(const gen &g,GIAC_CONTEXT);
+gen _gomory_hu_tree(const gen &g,GIAC_CONTEXT);
 gen _is_cut_set(const gen &g,GIAC_CONTEXT);
 gen _is_network(const gen &g,GIAC_CONTEXT);
 gen _random_network(const gen &g,GIAC_CONTEXT);
@@ -289,6 +297,8 @@ gen _betweenness_centrality(const gen &g,GIAC_CONTEXT);
 gen _communicability_betweenness_centrality(const gen &g,GIAC_CONTEXT);
 gen _closeness_centrality(const gen &g,GIAC_CONTEXT);
 gen _katz_centrality(const gen &g,GIAC_CONTEXT);
+gen _pagerank(const gen &g,GIAC_CONTEXT);
+gen _eigenvector_centrality(const gen &g,GIAC_CONTEXT);
 gen _information_centrality(const gen &g,GIAC_CONTEXT);
 gen _harmonic_centrality(const gen &g,GIAC_CONTEXT);
 gen _is_split_graph(const gen &g,GIAC_CONTEXT);
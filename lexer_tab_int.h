@@ -86,6 +86,7 @@
       {"bins",0,    _KDE_BINS, _INT_MAPLECONVERSION,T_TYPE_ID},
       {"bipartite",0,    _GT_BIPARTITE, _INT_MAPLECONVERSION,T_TYPE_ID},
       {"bisection_solver"         ,1, _BISECTION_SOLVER, _INT_SOLVER,T_NUMBER},
+      {"bitset",0,    _GT_BITSET, _INT_MAPLECONVERSION,T_TYPE_ID},
       {"blanc"         ,1, _WHITE, _INT_COLOR ,T_NUMBER},
       {"bleu"         ,1, _BLUE, _INT_COLOR ,T_NUMBER},
       {"block_size",0,    _ANN_BLOCK_SIZE, _INT_MAPLECONVERSION,T_TYPE_ID},
@@ -315,6 +316,7 @@
       {"lp_varselect",0,    _LP_VARSELECT, _INT_MAPLECONVERSION,T_TYPE_ID},
       {"lp_verbose",0,    _LP_VERBOSE, _INT_MAPLECONVERSION,T_TYPE_ID},
       {"magenta"         ,1, _MAGENTA, _INT_COLOR ,T_NUMBER},
+      {"maxiter",0,    _GT_MAXITER, _INT_MAPLECONVERSION,T_TYPE_ID},
       {"middle_point"         ,1, _POINT_MILIEU, _INT_SOLVER,T_NUMBER},
       {"minor_det"         ,1, _MINOR_DET, _INT_SOLVER,T_NUMBER},
       {"minus",0,0,0,T_MINUS},
@@ -403,6 +405,7 @@
       {"set"         ,0,_SET__VECT , _INT_MAPLECONVERSION ,T_TYPE_ID},
       {"simpson"         ,1, _SIMPSON, _INT_SOLVER,T_NUMBER},
       {"solid_line"         ,1, 0, _INT_COLOR ,T_NUMBER},
+      {"spectral",0,    _GT_SPECTRAL, _INT_MAPLECONVERSION,T_TYPE_ID},
       {"spring",0,    _GT_SPRING, _INT_MAPLECONVERSION,T_TYPE_ID},
       {"square_point"         ,1, _POINT_CARRE  , _INT_COLOR ,T_NUMBER},
       {"stack",0,0,0,T_STACK},
@@ -422,6 +425,7 @@
       {"titlefont"         ,1, _TITLEFONT, _INT_PLOT ,T_NUMBER},
       {"titre"         ,1, _TITLE, _INT_PLOT ,T_NUMBER},
       {"to",0,1,0,T_TO},
+      {"tolerance",0,    _GT_TOLERANCE, _INT_MAPLECONVERSION,T_TYPE_ID},
       {"topology",0,    _ANN_TOPOLOGY, _INT_MAPLECONVERSION,T_TYPE_ID},
       {"trames"         ,1,_FRAMES , _INT_PLOT ,T_NUMBER},
       {"trapeze"         ,1, _TRAPEZE, _INT_SOLVER,T_NUMBER},
@@ -7,14 +7,12 @@
 extern "C" {
 #endif
 
-/* return nonzero if the graphs represented by the sequences adj1 and adj2 of
- * adjacency lists are isomorphic, else return zero (use sigma=NULL to skip) */
-int nautywrapper_is_isomorphic(int isdir,int n,int *adj1,int *adj2,int *sigma);
-
-/* write the generators of Aut(G), where G is represented by the sequence
- * adj of adjacency lists, to the temporary file f and returns length of f
- * (leaves the file open, it should be closed afterwards) */
-void nautywrapper_aut_generators(int isdir,int n,int *adj,FILE *f);
+/* receives a permutation perm of 0,1,...,n-1 and the user data */
+typedef void (*nautywrapper_perm_handler)(int n,const int *perm,void *data);
+
+/* pass the generators of Aut(G), where G is represented by the sequence adj
+ * of adjacency lists, one by one to the handler (together with data) */
+void nautywrapper_aut_generators(int isdir,int n,int *adj,nautywrapper_perm_handler handler,void *data);
 
 /* compute the canonical labeling/graph for the input graph represented by the sequence
  * adj of adjacency lists, output as clab and/or cgrph and cols (use NULL to skip) */
@@ -11169,42 +11169,21 @@ int hclust::k_low(const dendrogram &dg) {
     }
     return k;
 }
+double hclust::prim_dist(int i,int j,void *data) {
+    std::pair<hclust*,bool> *hc=static_cast<std::pair<hclust*,bool>*>(data);
+    return hc->first->dist(i,j,hc->second);
+}
 bool hclust::mst_linkage(dendrogram &dg,bool cache_distances) {
-    int c=S.front();
+    std::pair<hclust*,bool> data(this,cache_distances);
+    graphe::ipairs forest;
+    vector<double> w;
     dg.clear();
+    if (!graphe::mst_finder::dense_tree(N,prim_dist,&data,forest,w))
+        return false;
     dg.reserve(N-1);
-    double *D;
-    try { D=new double[2*N]; } catch (const std::bad_alloc &ba) { return false; }
-    bool prev_first=true;
-    for (vector<int>::const_iterator it=S.begin();it!=S.end();++it) {
-        if (*it!=c)
-            D[*it]=DBL_MAX;
-    }
-    for (int i=1;i<N;++i) {
-        double minD=DBL_MAX,Dval;
-        int n=-1,offset=prev_first?0:N;
-        S.erase(std::find(S.begin(),S.end(),c));
-        for (vector<int>::const_iterator it=S.begin();it!=S.end();++it) {
-            Dval=std::min(D[*it+offset],dist(*it,c,cache_distances));
-            if (Dval<0) {
-                delete[] D;
-                return false;
-            }
-            if (Dval<minD) {
-                n=*it;
-                minD=Dval;
-            }
-            D[*it+N-offset]=Dval;
-        }
-        assert(n>=0);
-        drow r;
-        r.first=D[n+N-offset];
-        r.second=make_pair(c,n);
-        dg.push_back(r);
-        c=n;
-        prev_first=!prev_first;
+    for (int k=0;k<N-1;++k) {
+        dg.push_back(make_pair(w[k],forest[k]));
     }
-    delete[] D;
     return true;
 }
 bool hclust::nn_chain_linkage(dendrogram &dg,int meth) {
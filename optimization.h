@@ -622,6 +622,7 @@ private:
     double *_dist_cache;                                        // cached distances
     double &dist_cache(int i,int j) { return _dist_cache[(i*(2*N-i-3))/2+j-1]; }
     double dist(int i,int j,bool cache=false);                  // compute d(i,j), use caching if CACHE=true
+    static double prim_dist(int i,int j,void *data);            // distance callback for Prim's algorithm
     bool mst_linkage(dendrogram &dg,bool cache_distances);      // single linkage algorithm
     bool nn_chain_linkage(dendrogram &dg,int meth);             // complete, average, weighted, and Ward linkage algorithm
     double formula(int a,int b,int x,int na,int nb,int nx,double dab,int meth);